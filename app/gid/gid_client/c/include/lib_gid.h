@@ -12,6 +12,7 @@ extern "C" {
 
 /*  */
 #define	GID_CMD_NEXT	"new_gid"	/* ȡһΨһ gid */
+#define	GID_CMD_BLOCK	"new_block"	/* get a block of gids */
 
 /*  */
 
@@ -86,6 +87,17 @@ void gid_client_set_rw_timeout(int timeout);
  */
 long long int gid_next(const char *tag, int *errnum);
 
+/**
+ * Lease the gids from the server in blocks, gid_next() takes the gids from
+ * the leased block locally, and the next block is prefetched in background
+ * when the block is nearly used up, so few calls need a round trip. The gids
+ * of one tag are unique as before, but the ones not used before the process
+ * exits are skipped, and the gids got by the different processes interleave.
+ * @param count {int} the number of the gids in one block, 0 means getting
+ *  one gid from the server for each gid_next(), which is the default
+ */
+void gid_client_set_block(int count);
+
 /* ȡ gid ĺʹûṩ */
 
 /**
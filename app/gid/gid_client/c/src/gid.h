@@ -7,4 +7,20 @@ acl_int64 gid_cmdline_next(ACL_VSTREAM *client, const char *tag, int *errnum);
 acl_int64 gid_json_next(ACL_VSTREAM *client, const char *tag, int *errnum);
 acl_int64 gid_xml_next(ACL_VSTREAM *client, const char *tag, int *errnum);
 
+/* get a block of gids, count is the number wanted and will be set to the
+ * number allocated, step is the interval between the gids in the block */
+acl_int64 gid_cmdline_block(ACL_VSTREAM *client, const char *tag,
+	int *count, int *step, int *errnum);
+acl_int64 gid_json_block(ACL_VSTREAM *client, const char *tag,
+	int *count, int *step, int *errnum);
+acl_int64 gid_xml_block(ACL_VSTREAM *client, const char *tag,
+	int *count, int *step, int *errnum);
+
+/* in lib_gid.c, get one gid if count is NULL or else a block of gids
+ * from the server with the thread's connection, retrying if IO error */
+acl_int64 gid_fetch(const char *tag, int *count, int *step, int *errnum);
+
+/* in gid_block.c, get one gid from the block leased by gid_fetch */
+acl_int64 gid_block_next(const char *tag, int *errnum);
+
 #endif
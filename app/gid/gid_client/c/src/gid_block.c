@@ -0,0 +1,135 @@
+#include "lib_acl.h"
+#include <pthread.h>
+
+#include "global.h"
+#include "lib_gid.h"
+#include "gid.h"
+
+/* the gids leased from the server for one tag, the gids in one block are
+ * first, first + step, ..., first + step * (count - 1) */
+
+typedef struct GID_BLOCK {
+	char  tag[64];
+	acl_int64 next;		/* the next gid in the current block */
+	int   left;		/* the gids left in the current block */
+	int   step;
+	acl_int64 pre_next;	/* the block prefetched */
+	int   pre_left;
+	int   pre_step;
+	int   fetching;		/* one block is being fetched */
+} GID_BLOCK;
+
+static pthread_mutex_t __lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  __cond = PTHREAD_COND_INITIALIZER;
+static pthread_once_t  __once = PTHREAD_ONCE_INIT;
+static ACL_HTABLE *__blocks = NULL;
+static acl_pthread_pool_t *__thrpool = NULL;
+
+static void gid_block_init(void)
+{
+	__blocks = acl_htable_create(10, 0);
+	__thrpool = acl_thread_pool_create(2, 60);
+}
+
+/* prefetch the next block in the thread pool */
+
+static void gid_block_prefetch(void *ctx)
+{
+	GID_BLOCK *block = (GID_BLOCK*) ctx;
+	int   count = var_gid_block, step = 1, errnum;
+	acl_int64 gid = gid_fetch(block->tag, &count, &step, &errnum);
+
+	pthread_mutex_lock(&__lock);
+	if (gid >= 0 && count > 0) {
+		block->pre_next = gid;
+		block->pre_left = count;
+		block->pre_step = step;
+	} else
+		acl_msg_warn("%s(%d): prefetch %s error: %s", __FILE__,
+			__LINE__, block->tag, gid_client_serror(errnum));
+	block->fetching = 0;
+	pthread_cond_broadcast(&__cond);
+	pthread_mutex_unlock(&__lock);
+}
+
+acl_int64 gid_block_next(const char *tag, int *errnum)
+{
+	GID_BLOCK *block;
+	acl_int64 gid;
+	int   count, step;
+
+	if (tag == NULL || *tag == 0)
+		tag = "default";
+
+	pthread_once(&__once, gid_block_init);
+
+	pthread_mutex_lock(&__lock);
+
+	block = (GID_BLOCK*) acl_htable_find(__blocks, tag);
+	if (block == NULL) {
+		block = (GID_BLOCK*) acl_mycalloc(1, sizeof(GID_BLOCK));
+		ACL_SAFE_STRNCPY(block->tag, tag, sizeof(block->tag));
+		acl_htable_enter(__blocks, block->tag, block);
+	}
+
+	while (1) {
+		if (block->left > 0) {
+			gid = block->next;
+			block->next += block->step;
+			block->left--;
+
+			/* prefetch when only 20% of the block left */
+			if (block->left <= var_gid_block / 5
+				&& block->pre_left == 0 && !block->fetching)
+			{
+				block->fetching = 1;
+				acl_pthread_pool_add(__thrpool,
+					gid_block_prefetch, block);
+			}
+			pthread_mutex_unlock(&__lock);
+			if (errnum)
+				*errnum = GID_OK;
+			return (gid);
+		}
+
+		if (block->pre_left > 0) {
+			block->next = block->pre_next;
+			block->left = block->pre_left;
+			block->step = block->pre_step;
+			block->pre_left = 0;
+			continue;
+		}
+
+		if (block->fetching) {
+			pthread_cond_wait(&__cond, &__lock);
+			continue;
+		}
+
+		/* no block left and no prefetching, fetch it directly */
+		block->fetching = 1;
+		pthread_mutex_unlock(&__lock);
+
+		count = var_gid_block;
+		step = 1;
+		gid = gid_fetch(tag, &count, &step, errnum);
+
+		pthread_mutex_lock(&__lock);
+		block->fetching = 0;
+		pthread_cond_broadcast(&__cond);
+
+		if (gid < 0) {
+			pthread_mutex_unlock(&__lock);
+			return (-1);
+		}
+		if (count <= 0) {
+			pthread_mutex_unlock(&__lock);
+			if (errnum)
+				*errnum = GID_ERR_PROTO;
+			return (-1);
+		}
+
+		block->next = gid;
+		block->left = count;
+		block->step = step;
+	}
+}
@@ -15,14 +15,24 @@ acl_int64 gid_cmdline_get(int fd, const char *tag, int *errnum)
 	return (gid);
 }
 
-acl_int64 gid_cmdline_next(ACL_VSTREAM *client, const char *tag, int *errnum)
+/* get one gid if count is NULL, or else get a block of gids */
+
+static acl_int64 gid_cmdline_request(ACL_VSTREAM *client, const char *tag,
+	int *count, int *step, int *errnum)
 {
 	char  buf[1204];
 	ACL_ARGV *tokens;
 	ACL_ITER iter;
 	const char *status = NULL, *gid = NULL, *tag_ptr = NULL, *msg = NULL, *err = NULL;
+	const char *count_ptr = NULL, *step_ptr = NULL;
 
-	if (tag && *tag)
+	if (count && tag && *tag)
+		snprintf(buf, sizeof(buf), "CMD^%s|TAG^%s|COUNT^%d\r\n",
+			GID_CMD_BLOCK, tag, *count);
+	else if (count)
+		snprintf(buf, sizeof(buf), "CMD^%s|COUNT^%d\r\n",
+			GID_CMD_BLOCK, *count);
+	else if (tag && *tag)
 		snprintf(buf, sizeof(buf), "CMD^%s|TAG^%s\r\n", GID_CMD_NEXT, tag);
 	else
 		snprintf(buf, sizeof(buf), "CMD^%s\r\n", GID_CMD_NEXT);
@@ -52,6 +62,10 @@ acl_int64 gid_cmdline_next(ACL_VSTREAM *client, const char *tag, int *errnum)
 			msg = ptr + sizeof("MSG^") - 1;
 		} else if (strncasecmp(ptr, "ERR^", sizeof("ERR^") - 1) == 0) {
 			err = ptr + sizeof("ERR^");
+		} else if (strncasecmp(ptr, "COUNT^", sizeof("COUNT^") - 1) == 0) {
+			count_ptr = ptr + sizeof("COUNT^") - 1;
+		} else if (strncasecmp(ptr, "STEP^", sizeof("STEP^") - 1) == 0) {
+			step_ptr = ptr + sizeof("STEP^") - 1;
 		}
 	}
 
@@ -69,14 +83,29 @@ acl_int64 gid_cmdline_next(ACL_VSTREAM *client, const char *tag, int *errnum)
 		}
 		acl_argv_free(tokens);
 		return (-1);
-	} else if (gid == NULL) {
+	} else if (gid == NULL || (count && count_ptr == NULL)) {
 		if (errnum)
 			*errnum = GID_ERR_PROTO;
 		acl_argv_free(tokens);
 		return (-1);
 	} else {
 		acl_int64 ngid = atoll(gid);
+		if (count) {
+			*count = atoi(count_ptr);
+			*step = step_ptr ? atoi(step_ptr) : 1;
+		}
 		acl_argv_free(tokens);
 		return (ngid);
 	}
 }
+
+acl_int64 gid_cmdline_next(ACL_VSTREAM *client, const char *tag, int *errnum)
+{
+	return (gid_cmdline_request(client, tag, NULL, NULL, errnum));
+}
+
+acl_int64 gid_cmdline_block(ACL_VSTREAM *client, const char *tag,
+	int *count, int *step, int *errnum)
+{
+	return (gid_cmdline_request(client, tag, count, step, errnum));
+}
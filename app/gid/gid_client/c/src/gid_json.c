@@ -16,14 +16,24 @@ acl_int64 gid_json_get(int fd, const char *tag, int *errnum)
 	return (gid);
 }
 
-acl_int64 gid_json_next(ACL_VSTREAM *client, const char *tag, int *errnum)
+/* get one gid if count is NULL, or else get a block of gids */
+
+static acl_int64 gid_json_request(ACL_VSTREAM *client, const char *tag,
+	int *count, int *step, int *errnum)
 {
 	char  buf[1204];
 	ACL_ITER iter;
 	ACL_JSON *json;
 	const char *status = NULL, *gid = NULL, *tag_ptr = NULL, *msg = NULL, *err = NULL;
+	const char *count_ptr = NULL, *step_ptr = NULL;
 
-	if (tag && *tag)
+	if (count && tag && *tag)
+		snprintf(buf, sizeof(buf), "{ cmd: '%s', tag: '%s', count: '%d' }\r\n",
+			GID_CMD_BLOCK, tag, *count);
+	else if (count)
+		snprintf(buf, sizeof(buf), "{ cmd: '%s', count: '%d' }\r\n",
+			GID_CMD_BLOCK, *count);
+	else if (tag && *tag)
 		snprintf(buf, sizeof(buf), "{ cmd: '%s', tag: '%s' }\r\n",
 			GID_CMD_NEXT, tag);
 	else
@@ -68,6 +78,10 @@ acl_int64 gid_json_next(ACL_VSTREAM *client, const char *tag, int *errnum)
 			msg = STR(node->text);
 		} else if (strcasecmp(STR(node->ltag), "ERR") == 0) {
 			err = STR(node->text);
+		} else if (strcasecmp(STR(node->ltag), "COUNT") == 0) {
+			count_ptr = STR(node->text);
+		} else if (strcasecmp(STR(node->ltag), "STEP") == 0) {
+			step_ptr = STR(node->text);
 		}
 	}
 
@@ -85,14 +99,29 @@ acl_int64 gid_json_next(ACL_VSTREAM *client, const char *tag, int *errnum)
 		}
 		acl_json_free(json);
 		return (-1);
-	} else if (gid == NULL) {
+	} else if (gid == NULL || (count && count_ptr == NULL)) {
 		if (errnum)
 			*errnum = GID_ERR_PROTO;
 		acl_json_free(json);
 		return (-1);
 	} else {
 		acl_int64 ngid = atoll(gid);
+		if (count) {
+			*count = atoi(count_ptr);
+			*step = step_ptr ? atoi(step_ptr) : 1;
+		}
 		acl_json_free(json);
 		return (ngid);
 	}
 }
+
+acl_int64 gid_json_next(ACL_VSTREAM *client, const char *tag, int *errnum)
+{
+	return (gid_json_request(client, tag, NULL, NULL, errnum));
+}
+
+acl_int64 gid_json_block(ACL_VSTREAM *client, const char *tag,
+	int *count, int *step, int *errnum)
+{
+	return (gid_json_request(client, tag, count, step, errnum));
+}
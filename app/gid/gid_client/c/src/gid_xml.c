@@ -16,15 +16,25 @@ acl_int64 gid_xml_get(int fd, const char *tag, int *errnum)
 	return (gid);
 }
 
-acl_int64 gid_xml_next(ACL_VSTREAM *client, const char *tag, int *errnum)
+/* get one gid if count is NULL, or else get a block of gids */
+
+static acl_int64 gid_xml_request(ACL_VSTREAM *client, const char *tag,
+	int *count, int *step, int *errnum)
 {
 	char  buf[1204];
 	ACL_ITER iter;
 	ACL_XML *xml;
 	const char *status = NULL, *gid = NULL, *tag_ptr = NULL, *msg = NULL, *err = NULL;
+	const char *count_ptr = NULL, *step_ptr = NULL;
 	static __thread ACL_VSTRING *tt = NULL;
 
-	if (tag && *tag)
+	if (count && tag && *tag)
+		snprintf(buf, sizeof(buf), "<request cmd='%s' tag='%s' count='%d' />\r\n",
+			GID_CMD_BLOCK, tag, *count);
+	else if (count)
+		snprintf(buf, sizeof(buf), "<request cmd='%s' count='%d' />\r\n",
+			GID_CMD_BLOCK, *count);
+	else if (tag && *tag)
 		snprintf(buf, sizeof(buf), "<request cmd='%s' tag='%s' />\r\n",
 			GID_CMD_NEXT, tag);
 	else
@@ -91,6 +101,10 @@ acl_int64 gid_xml_next(ACL_VSTREAM *client, const char *tag, int *errnum)
 					msg = STR(attr->value);
 				} else if (strcasecmp(STR(attr->name), "ERR") == 0) {
 					err = STR(attr->value);
+				} else if (strcasecmp(STR(attr->name), "COUNT") == 0) {
+					count_ptr = STR(attr->value);
+				} else if (strcasecmp(STR(attr->name), "STEP") == 0) {
+					step_ptr = STR(attr->value);
 				}
 			}
 		}
@@ -110,14 +124,29 @@ acl_int64 gid_xml_next(ACL_VSTREAM *client, const char *tag, int *errnum)
 		}
 		acl_xml_free(xml);
 		return (-1);
-	} else if (gid == NULL) {
+	} else if (gid == NULL || (count && count_ptr == NULL)) {
 		if (errnum)
 			*errnum = GID_ERR_PROTO;
 		acl_xml_free(xml);
 		return (-1);
 	} else {
 		acl_int64 ngid = atoll(gid);
+		if (count) {
+			*count = atoi(count_ptr);
+			*step = step_ptr ? atoi(step_ptr) : 1;
+		}
 		acl_xml_free(xml);
 		return (ngid);
 	}
 }
+
+acl_int64 gid_xml_next(ACL_VSTREAM *client, const char *tag, int *errnum)
+{
+	return (gid_xml_request(client, tag, NULL, NULL, errnum));
+}
+
+acl_int64 gid_xml_block(ACL_VSTREAM *client, const char *tag,
+	int *count, int *step, int *errnum)
+{
+	return (gid_xml_request(client, tag, count, step, errnum));
+}
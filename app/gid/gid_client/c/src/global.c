@@ -10,6 +10,7 @@ int   var_gid_retry_limit;
 int   var_gid_keepalive;
 int   var_gid_proto;
 char  var_gid_url[1024];
+int   var_gid_block = 0;
 
 void gid_client_init(int proto, const char *server_addr)
 {
@@ -59,3 +60,8 @@ void gid_client_set_rw_timeout(int timeout)
 {
 	var_gid_rw_timeout = timeout;
 }
+
+void gid_client_set_block(int count)
+{
+	var_gid_block = count > 0 ? count : 0;
+}
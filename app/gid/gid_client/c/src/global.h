@@ -8,6 +8,7 @@ extern int   var_gid_retry_limit;
 extern int   var_gid_proto;
 extern int   var_gid_keepalive;
 extern char  var_gid_url[];
+extern int   var_gid_block;
 
 #define	GID_JSON_URL	"/gid_json"
 #define	GID_XML_URL	"/gid_xml"
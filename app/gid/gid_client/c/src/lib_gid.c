@@ -10,6 +10,13 @@
 static __thread ACL_VSTREAM *__client = NULL;
 
 acl_int64 gid_next(const char *tag, int *errnum)
+{
+	if (var_gid_block > 0)
+		return (gid_block_next(tag, errnum));
+	return (gid_fetch(tag, NULL, NULL, errnum));
+}
+
+acl_int64 gid_fetch(const char *tag, int *count, int *step, int *errnum)
 {
 	acl_int64 gid = 0;
 	int   err, nretry = 0;
@@ -31,7 +38,14 @@ acl_int64 gid_next(const char *tag, int *errnum)
 			return (-1);
 		}
 
-		if (var_gid_proto == GID_PROTO_JSON) {
+		if (count) {
+			if (var_gid_proto == GID_PROTO_JSON)
+				gid = gid_json_block(__client, tag, count, step, &err);
+			else if (var_gid_proto == GID_PROTO_XML)
+				gid = gid_xml_block(__client, tag, count, step, &err);
+			else
+				gid = gid_cmdline_block(__client, tag, count, step, &err);
+		} else if (var_gid_proto == GID_PROTO_JSON) {
 			gid = gid_json_next(__client, tag, &err);
 		} else if (var_gid_proto == GID_PROTO_XML) {
 			gid = gid_xml_next(__client, tag, &err);
@@ -47,10 +61,16 @@ acl_int64 gid_next(const char *tag, int *errnum)
 			if (errnum)
 				*errnum = err;
 			break;
-		} else if (nretry++ >= var_gid_retry_limit) {
+		}
+
+		/* the connection is broken, reconnect when retrying */
+		acl_vstream_close(__client);
+		__client = NULL;
+
+		if (nretry++ >= var_gid_retry_limit) {
 			if (errnum)
 				*errnum = err;
-			break;
+			return (-1);
 		}
 	}
 
@@ -78,20 +78,22 @@ static void usage(const char *progname)
 	printf("usage:  %s -h[help] -s server_addr[127.0.0.1:7072]"
 		" -p protocol[cmdline|json|xml|]"
 		" -n count[100] -c cmd[get] -m[use mempool]"
-		" -t tag[default:sid] -P[use thread pool]\r\n", progname);
+		" -t tag[default:sid] -P[use thread pool]"
+		" -b block_count[0, lease the gids in blocks if > 0]\r\n",
+		progname);
 }
 
 int main(int argc, char *argv[])
 {
 	int   ch, n = 100, proto = GID_PROTO_JSON;
-	int   use_mempool = 0, use_concurrent = 0;
+	int   use_mempool = 0, use_concurrent = 0, block = 0;
 	char  addr[64], cmd[32], tag[32];
 
 	snprintf(addr, sizeof(addr), "127.0.0.1:7072");
 	snprintf(cmd, sizeof(cmd), "get");
 	snprintf(tag, sizeof(tag), "default");
 
-	while ((ch = getopt(argc, argv, "hs:p:n:c:t:mP")) > 0) {
+	while ((ch = getopt(argc, argv, "hs:p:n:c:t:mPb:")) > 0) {
 		switch (ch) {
 		case 'h':
 			usage(argv[0]);
@@ -127,6 +129,9 @@ int main(int argc, char *argv[])
 		case 'P':
 			use_concurrent = 1;
 			break;
+		case 'b':
+			block = atoi(optarg);
+			break;
 		default:
 			break;
 		}
@@ -140,6 +145,7 @@ int main(int argc, char *argv[])
 	/* ʼ */
 	printf("proto: %d, addr: %s\n", proto, addr);
 	gid_client_init(proto, addr);
+	gid_client_set_block(block);
 
 	if (strcasecmp(cmd, "get") == 0) {
 		if (use_concurrent)
@@ -31,9 +31,31 @@ const char *gid_serror(int errnum);
 acl_int64 gid_next(const char *path, const char *tag,
 	unsigned int step, int *errnum);
 
+/**
+ * Lease one block of gids to the client, the gids in the block are
+ * gid, gid + step, ..., gid + (count - 1) * step, which the client may
+ * hand out without asking the server again.
+ * @param path {const char*} the directory of the files
+ * @param tag {const char*} the tag with the sid as tag:sid
+ * @param step {unsigned int} the step between two gids
+ * @param count {int} the count of the gids in the block
+ * @param errnum {int*} if not NULL, store the error number
+ * @return {acl_int64} the first gid of the block, < 0 if error
+ */
+acl_int64 gid_next_block(const char *path, const char *tag,
+	unsigned int step, int count, int *errnum);
+
+/**
+ * Set the count of the steps reserved each time the bound saved in the
+ * file is moved forward, the file is written once for so many gids.
+ * @param reserve {int} the default is 1000
+ */
+void gid_set_reserve(int reserve);
+
 /**
  * ʼӦô˺ʼڲ
  * @param fh_limit {int} ļ
+ *  (not used now, all the tags are kept in memory)
  * @param sync_gid {int} ÿһµ gid Ƿͬʱͬ
  * @param debug_section {int} õıǩֵ
  */
@@ -13,6 +13,8 @@ extern int   var_cfg_gid_step;
 extern int   var_cfg_gid_test;
 extern int   var_cfg_fh_limit;
 extern int   var_cfg_io_timeout;
+extern int   var_cfg_gid_reserve;
+extern int   var_cfg_gid_block_max;
 extern ACL_CONFIG_INT_TABLE service_conf_int_tab[];
 
 extern char *var_cfg_gid_path;
@@ -22,5 +24,6 @@ extern ACL_CONFIG_STR_TABLE service_conf_str_tab[];
 /* ֮䴫ֶ */
 #define	CMD_NEW_GID	"new_gid"
 #define CMD_TEST_GID	"test_gid"
+#define	CMD_NEW_BLOCK	"new_block"
 	
 #endif
@@ -39,7 +39,8 @@ static int send_respond_error(ACL_VSTREAM *stream,
 		return (0);
 }
 
-static int proto_new_gid(ACL_VSTREAM *stream, const char *tag)
+static int proto_new_gid(ACL_VSTREAM *stream, const char *tag,
+	int count acl_unused)
 {
 	acl_int64 gid;
 	int   errnum = 0;
@@ -57,22 +58,53 @@ static int proto_test_gid(ACL_VSTREAM *stream,
 	return (send_respond_gid(stream, tag, test_id));
 }
 
-static int proto_get_test_gid(ACL_VSTREAM *stream, const char *tag)
+static int proto_get_test_gid(ACL_VSTREAM *stream, const char *tag,
+	int count acl_unused)
 {
 	return (proto_test_gid(stream, tag, (acl_int64) var_cfg_gid_test));
 }
 
+/* lease one block of gids: STATUS^OK|GID^first|COUNT^n|STEP^n|TAG^xxx */
+
+static int proto_new_block(ACL_VSTREAM *stream, const char *tag, int count)
+{
+	acl_int64 gid;
+	int   errnum = 0;
+	char  buf[1024];
+
+	if (count <= 0)
+		count = 1;
+	else if (count > var_cfg_gid_block_max)
+		count = var_cfg_gid_block_max;
+
+	gid = gid_next_block(var_cfg_gid_path, tag, var_cfg_gid_step,
+			count, &errnum);
+	if (gid < 0)
+		return (send_respond_error(stream, tag, gid_serror(errnum)));
+
+	snprintf(buf, sizeof(buf), "STATUS^OK|GID^%lld|COUNT^%d|STEP^%d"
+		"|TAG^%s\r\n", gid, count, var_cfg_gid_step, tag);
+	if (acl_vstream_writen(stream, buf, strlen(buf)) == ACL_VSTREAM_EOF)
+	{
+		acl_msg_info("%s(%d): respond to client error",
+			__FILE__, __LINE__);
+		return (-1);
+	}
+	return (1);
+}
+
 /*--------------------------------------------------------------------------*/
 
 typedef struct PROTO_CMDLINE {
 	const char *cmd;  /*  */
-	int (*handle)(ACL_VSTREAM *, const char*);  /* Э鴦 */
+	int (*handle)(ACL_VSTREAM *, const char*, int);  /* Э鴦 */
 } PROTO_CMDLINE;
 
 /* Эӳ */
 static PROTO_CMDLINE __proto_cmdline_tab[] = {
 	{ CMD_NEW_GID, proto_new_gid },
 	{ CMD_TEST_GID, proto_get_test_gid },
+	{ CMD_NEW_BLOCK, proto_new_block },
 	{ NULL, NULL },
 };
 
@@ -81,6 +113,8 @@ static PROTO_CMDLINE __proto_cmdline_tab[] = {
 /* Эʽ:
  * ʽ: CMD^xxx|tag^xxx:sid\r\n
  * Ӧʽ: STATUS^[OK|ERR]|[GID^xxx|INFO^xxx]|tag^%s\r\n
+ * new_block: CMD^new_block|TAG^xxx:sid|COUNT^n
+ *  STATUS^OK|GID^first|COUNT^n|STEP^n|TAG^xxx
  */
 int cmdline_service(ACL_VSTREAM *client)
 {       
@@ -88,7 +122,7 @@ int cmdline_service(ACL_VSTREAM *client)
 	const char *cmd = NULL, *tag = "default";
 	char  buf[1024];
 	ACL_ARGV *argv;
-	int   i, ret;
+	int   i, ret, count = 1;
 	ACL_ITER iter;
 
 	/* ȶȡͷ */
@@ -103,6 +137,8 @@ int cmdline_service(ACL_VSTREAM *client)
 			cmd = ptr + sizeof("CMD^") - 1;
 		else if (strncasecmp(ptr, "TAG^", sizeof("TAG^") - 1) == 0)
 			tag = ptr + sizeof("TAG^") - 1;
+		else if (strncasecmp(ptr, "COUNT^", sizeof("COUNT^") - 1) == 0)
+			count = atoi(ptr + sizeof("COUNT^") - 1);
 	}
 
 	if (cmd == NULL || *tag == 0) {
@@ -114,7 +150,7 @@ int cmdline_service(ACL_VSTREAM *client)
 	
 	for (i = 0; __proto_cmdline_tab[i].cmd != NULL; i++) {
 		if (strcasecmp(cmd, __proto_cmdline_tab[i].cmd) == 0) {
-			ret = __proto_cmdline_tab[i].handle(client, tag);
+			ret = __proto_cmdline_tab[i].handle(client, tag, count);
 			acl_argv_free(argv);
 			return (ret);
 		}
@@ -5,180 +5,253 @@
 
 #include "gid_oper.h"
 
+/*
+ * All the tags are kept in memory after being loaded, and only the bound of
+ * the gids which may be allocated is saved in the file of each tag. When one
+ * allocation goes beyond the bound, the bound is moved forward by at least
+ * __reserve steps, and the bounds of all the tags waiting are saved in one
+ * group commit, so the disk is written once for many gids and many callers.
+ * After restarted, the gids start from the saved bound, so some gids may be
+ * skipped but none will be allocated twice.
+ */
+
 typedef struct GID_STORE {
-	ACL_FHANDLE fh;		/* ļ */
-	ACL_VSTREAM *logger;	/* ־ */
-	char tag[64];		/* ļʶ */
-	char sid[64];		/* ỰIDţ൱ */
-	unsigned int step;	/* ֵ */
-	acl_int64  cur_gid;	/* ǰIDֵ */
-	acl_int64  min_gid;	/* СIDֵ */
-	acl_int64  max_gid;	/* IDֵ */
+	ACL_VSTREAM *fp;	/* the file saving the bound */
+	ACL_VSTREAM *logger;
+	char tag[64];
+	char sid[64];
+	unsigned int step;
+	acl_int64  cur_gid;	/* the last gid allocated */
+	acl_int64  min_gid;
+	acl_int64  max_gid;
+	acl_int64  saved_gid;	/* the bound saved in the file */
+	acl_int64  dirty_gid;	/* the bound waiting to be saved */
+	acl_int64  flush_gid;	/* the bound being saved */
+	unsigned long flush_gen;/* the group commit saving flush_gid */
+	int   dirty;		/* if in __dirty */
 } GID_STORE;
 
-typedef struct {
-	char tag[64];		/* ļʶ */
-	char sid[64];		/* ỰIDţ൱ */
-	unsigned int step;	/* ֵ */
-	acl_int64  cur_gid;	/* ǰIDֵ */
-	acl_int64  min_gid;	/* СIDֵ */
-	acl_int64  max_gid;	/* IDֵ */
-} GID_STORE_CTX;
-
 static int __sync_gid = 1;
+static unsigned int __reserve = 1000;
+
+/* the lock protects all the stores, and is released in the disk IO */
+static pthread_mutex_t __lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  __cond = PTHREAD_COND_INITIALIZER;
 
-/* ͬڴ */
+static ACL_HTABLE *__stores = NULL;
+static ACL_ARRAY  *__dirty = NULL;	/* waiting for the next commit */
+static ACL_ARRAY  *__flushing = NULL;	/* being saved in one commit */
+static int   __syncing = 0;
+static unsigned long __gen_open = 1;	/* the next group commit */
+static unsigned long __gen_done = 0;	/* the last group commit finished */
 
-static int gid_store_sync(GID_STORE *store)
+/* save the bound into the file: tag:sid step bound min_gid max_gid\r\n */
+
+static int gid_store_save(GID_STORE *store, acl_int64 bound)
 {
 	char  buf[1024];
 
-	/* ҪȽļ */
-#if 0
-	if (acl_file_ftruncate(store->fh.fp, 0) < 0) {
-		acl_msg_error("%s(%d), %s: ftruncate %s error(%s)",
-			__FILE__, __LINE__, __FUNCTION__,
-			ACL_VSTREAM_PATH(store->fh.fp), acl_last_serror());
-		return (-1);
-	}
-#endif
-	if (acl_vstream_fseek(store->fh.fp, SEEK_SET, 0) < 0) {
+	if (acl_vstream_fseek(store->fp, 0, SEEK_SET) < 0) {
 		acl_msg_error("%s(%d), %s: fseek %s error(%s)",
 			__FILE__, __LINE__, __FUNCTION__,
-			ACL_VSTREAM_PATH(store->fh.fp), acl_last_serror());
+			ACL_VSTREAM_PATH(store->fp), acl_last_serror());
+		return (-1);
 	}
 
 	snprintf(buf, sizeof(buf), "%s:%s %d %lld %lld %lld\r\n",
-		store->tag, store->sid, store->step, store->cur_gid,
+		store->tag, store->sid, store->step, bound,
 		store->min_gid, store->max_gid);
 
-	/* ʼļ: tag:sid step cur_gid min_gid max_gid\r\n */
-	if (acl_vstream_writen(store->fh.fp,
-		buf, strlen(buf)) == ACL_VSTREAM_EOF)
+	if (acl_vstream_writen(store->fp, buf, strlen(buf)) == ACL_VSTREAM_EOF)
 	{
 		acl_msg_error("%s(%d), %s: write to %s error(%s)",
 			__FILE__, __LINE__, __FUNCTION__,
-			ACL_VSTREAM_PATH(store->fh.fp), acl_last_serror());
+			ACL_VSTREAM_PATH(store->fp), acl_last_serror());
+		return (-1);
+	}
+
+	if (__sync_gid && acl_vstream_fsync(store->fp) == ACL_VSTREAM_EOF) {
+		acl_msg_error("%s(%d), %s: fsync %s error(%s)",
+			__FILE__, __LINE__, __FUNCTION__,
+			ACL_VSTREAM_PATH(store->fp), acl_last_serror());
 		return (-1);
 	}
 
 	return (0);
 }
 
-/* ļʱĻصпǴ˻ */
+/* load the store from the file, or create the file for the new tag */
 
-static int gid_store_on_open(ACL_FHANDLE *fh, void *ctx)
+static int gid_store_load(GID_STORE *store, const char *sid,
+	unsigned int step)
 {
-	GID_STORE *store = (GID_STORE*) fh;
-	GID_STORE_CTX *sc = (GID_STORE_CTX*) ctx;
 	ACL_ARGV *argv;
 	char  buf[512], *ptr;
 	int   ret;
 
-	/* Ƿ */
-	if (fh->size != sizeof(GID_STORE))
-		acl_msg_fatal("%s(%d), %s: size(%d) != GID_STORE's size(%d)",
-			__FILE__, __LINE__, __FUNCTION__,
-			(int) fh->size, (int) sizeof(GID_STORE));
-
-	/* ļʼ */
-	if (fh->fsize == 0) {
-		ACL_SAFE_STRNCPY(store->tag, sc->tag, sizeof(store->tag));
-		ACL_SAFE_STRNCPY(store->sid, sc->sid, sizeof(store->sid));
-		store->step = sc->step;
-		store->cur_gid = sc->cur_gid;
-		store->min_gid = sc->min_gid;
-		store->max_gid = sc->max_gid;
-
-		return (gid_store_sync(store));
+	if (acl_vstream_fsize(store->fp) <= 0) {
+		ACL_SAFE_STRNCPY(store->sid, sid, sizeof(store->sid));
+		store->step = step;
+		store->cur_gid = 0;
+		store->min_gid = 1;
+		store->max_gid = 0x7FFFFFFFFFFFFFFFllu;
+		store->saved_gid = store->cur_gid;
+		return (gid_store_save(store, store->saved_gid));
 	}
 
-	/* ݸʽtag:sid step cur_gid min_gid max_gid\r\n */
-
-	/* ļл */
-	ret = acl_vstream_gets_nonl(fh->fp, buf, sizeof(buf));
+	ret = acl_vstream_gets_nonl(store->fp, buf, sizeof(buf));
 	if (ret == ACL_VSTREAM_EOF) {
 		acl_msg_error("%s(%d), %s: gets from %s error(%s)",
 			__FILE__, __LINE__, __FUNCTION__,
-			ACL_VSTREAM_PATH(fh->fp), acl_last_serror());
+			ACL_VSTREAM_PATH(store->fp), acl_last_serror());
 		return (-1);
 	}
 
-	/* ַ */
 	argv = acl_argv_split(buf, ",\t ");
 	if (argv->argc < 5) {
 		acl_msg_error("%s(%d), %s: invalid line(%s) from %s",
 			__FILE__, __LINE__, __FUNCTION__,
-			buf, ACL_VSTREAM_PATH(fh->fp));
+			buf, ACL_VSTREAM_PATH(store->fp));
 		acl_argv_free(argv);
 		return (-1);
 	}
 
-	ACL_SAFE_STRNCPY(store->tag, argv->argv[0], sizeof(store->tag));
-	ptr = strchr(store->tag, ':');
+	ptr = strchr(argv->argv[0], ':');
 	if (ptr) {
-		*ptr++ = 0;
-		ACL_SAFE_STRNCPY(store->sid, ptr, sizeof(store->sid));
+		ACL_SAFE_STRNCPY(store->sid, ptr + 1, sizeof(store->sid));
 	}
-	store->step = atoi(argv->argv[1]);
 
-	/* 洢ĲֵеĲֵһ£Ȳòֵ */
-	if (store->step != sc->step) {
+	store->step = atoi(argv->argv[1]);
+	if (store->step != step) {
 		acl_msg_warn("%s(%d), %s: change step from %d to %d for %s",
 			__FILE__, __LINE__, __FUNCTION__,
-			store->step, sc->step, ACL_VSTREAM_PATH(fh->fp));
-		store->step = sc->step;
+			store->step, step, ACL_VSTREAM_PATH(store->fp));
+		store->step = step;
 	}
+
+	/* the gids below the saved bound may have been allocated */
 	store->cur_gid = atoll(argv->argv[2]);
 	store->min_gid = atoll(argv->argv[3]);
 	store->max_gid = atoll(argv->argv[4]);
+	store->saved_gid = store->cur_gid;
 
 	acl_argv_free(argv);
 	return (0);
 }
 
-/* ļرʱĻص */
-
-static void gid_store_on_close(ACL_FHANDLE *fh acl_unused)
-{
-	GID_STORE *store = (GID_STORE*) fh;
-
-	/* ˷ʵʱͬʱҪļرʱͬ */
-	if (__sync_gid == 0 && gid_store_sync(store) < 0)
-		acl_msg_fatal("%s(%d), %s: save %s error(%s)",
-			__FILE__, __LINE__, __FUNCTION__,
-			ACL_VSTREAM_PATH(store->fh.fp), acl_last_serror());
-}
-
-/* ļļ򴴽µļļѾֱӷ */
-
 static GID_STORE *gid_store_open(const char *path, const char *tag,
 	const char *sid, unsigned int step)
 {
 	char  filepath[1024];
-	unsigned int oflags = ACL_FHANDLE_O_NOATIME
-		| ACL_FHANDLE_O_MLOCK
-		| ACL_FHANDLE_O_EXCL;
-	GID_STORE *store;
-	GID_STORE_CTX ctx;
+	GID_STORE *store = (GID_STORE*) acl_htable_find(__stores, tag);
 
-	ACL_SAFE_STRNCPY(ctx.tag, tag, sizeof(ctx.tag));
-	ACL_SAFE_STRNCPY(ctx.sid, sid, sizeof(ctx.sid));
-	ctx.step = step;
-	ctx.cur_gid = 0;
-	ctx.min_gid = 1;
-	ctx.max_gid = 0x7FFFFFFFFFFFFFFFllu;
+	if (store != NULL)
+		return (store);
 
 	snprintf(filepath, sizeof(filepath), "%s/%s", path, tag);
-	store = (GID_STORE*) acl_fhandle_open(sizeof(GID_STORE), oflags,
-			filepath, gid_store_on_open, &ctx, gid_store_on_close);
-	if (store == NULL)
-		acl_msg_fatal("%s(%d), %s: open %s error(%s)",
+	store = (GID_STORE*) acl_mycalloc(1, sizeof(GID_STORE));
+	store->fp = acl_vstream_fopen(filepath, O_RDWR | O_CREAT, 0600, 1024);
+	if (store->fp == NULL) {
+		acl_msg_error("%s(%d), %s: open %s error(%s)",
 			__FILE__, __LINE__, __FUNCTION__,
 			filepath, acl_last_serror());
+		acl_myfree(store);
+		return (NULL);
+	}
+
+	ACL_SAFE_STRNCPY(store->tag, tag, sizeof(store->tag));
+	if (gid_store_load(store, sid, step) < 0) {
+		acl_vstream_close(store->fp);
+		acl_myfree(store);
+		return (NULL);
+	}
+
+	store->dirty_gid = store->flush_gid = store->saved_gid;
+	acl_htable_enter(__stores, tag, store);
 	return (store);
 }
 
+static void gid_store_free(void *ctx)
+{
+	GID_STORE *store = (GID_STORE*) ctx;
+
+	/* save the last gid allocated, so no gid is skipped after restart */
+	if (store->cur_gid < store->saved_gid)
+		(void) gid_store_save(store, store->cur_gid);
+	acl_vstream_close(store->fp);
+	acl_myfree(store);
+}
+
+/* save all the dirty bounds in one group commit, called with the lock */
+
+static void gid_store_flush(void)
+{
+	ACL_ARRAY *batch = __dirty;
+	unsigned long gen = __gen_open++;
+	ACL_ITER iter;
+
+	__dirty = __flushing;
+	__flushing = batch;
+	__syncing = 1;
+
+	acl_foreach(iter, batch) {
+		GID_STORE *store = (GID_STORE*) iter.data;
+		store->dirty = 0;
+		store->flush_gid = store->dirty_gid;
+		store->flush_gen = gen;
+	}
+
+	/* the bounds and the files are only touched by the committer */
+	pthread_mutex_unlock(&__lock);
+
+	acl_foreach(iter, batch) {
+		GID_STORE *store = (GID_STORE*) iter.data;
+		if (gid_store_save(store, store->flush_gid) < 0)
+			store->flush_gid = store->saved_gid;
+	}
+
+	pthread_mutex_lock(&__lock);
+
+	acl_foreach(iter, batch) {
+		GID_STORE *store = (GID_STORE*) iter.data;
+		store->saved_gid = store->flush_gid;
+	}
+
+	acl_array_clean(batch, NULL);
+	__gen_done = gen;
+	__syncing = 0;
+	pthread_cond_broadcast(&__cond);
+}
+
+/* wait for the bound being saved, called with the lock */
+
+static int gid_store_commit(GID_STORE *store, acl_int64 bound)
+{
+	unsigned long gen;
+
+	if (__syncing && bound <= store->flush_gid) {
+		/* the bound is being saved by the running commit */
+		gen = store->flush_gen;
+	} else {
+		if (store->dirty_gid < bound)
+			store->dirty_gid = bound;
+		if (!store->dirty) {
+			store->dirty = 1;
+			acl_array_append(__dirty, store);
+		}
+		gen = __gen_open;
+	}
+
+	while (__gen_done < gen) {
+		if (__syncing)
+			pthread_cond_wait(&__cond, &__lock);
+		else
+			gid_store_flush();
+	}
+
+	return (store->saved_gid >= bound ? 0 : -1);
+}
+
 /* õǰʱ */
 
 static void logtime_fmt(char *buf, size_t size)
@@ -211,78 +284,94 @@ static void gid_logger(GID_STORE *store)
 	}
 }
 
-acl_int64 gid_next(const char *path, const char *tag_in,
-	unsigned int step, int *errnum)
+acl_int64 gid_next_block(const char *path, const char *tag_in,
+	unsigned int step, int count, int *errnum)
 {
-	acl_int64 gid;
-	char  tag[128], *sid;
+	acl_int64 gid, bound;
+	char  tag[128], *ptr;
+	const char *sid;
 	GID_STORE *store;
 
-	/* Ҫ tag з sid  */
+	if (count <= 0)
+		count = 1;
+
 	ACL_SAFE_STRNCPY(tag, tag_in, sizeof(tag));
-	sid = strchr(tag, ':');
-	if (sid)
-		*sid++ = 0;
-	else
+	ptr = strchr(tag, ':');
+	if (ptr) {
+		*ptr++ = 0;
+		sid = ptr;
+	} else
 		sid = "";
-	store = gid_store_open(path, tag, sid, step);
 
-	if (store->sid[0] != 0) {
-		if (sid == NULL || strcmp(sid, store->sid) != 0) {
-			acl_msg_error("%s(%d), %s: input sid(%s) invalid",
-				__FILE__, __LINE__, __FUNCTION__,
-				sid && *sid ? sid : "null");
-			if (errnum)
-				*errnum = GID_ERR_SID;
+	pthread_mutex_lock(&__lock);
 
-			/* رļӳ 60 ر */
-			acl_fhandle_close(&store->fh, 60);
-			return (-1);
-		}
+	store = gid_store_open(path, tag, sid, step);
+	if (store == NULL) {
+		pthread_mutex_unlock(&__lock);
+		if (errnum)
+			*errnum = GID_ERR_SAVE;
+		return (-1);
 	}
 
-	/* Ѿﵽֵ! */
-	if (store->max_gid - (unsigned int) store->step <= store->cur_gid) {
+	if (store->sid[0] != 0 && strcmp(sid, store->sid) != 0) {
+		pthread_mutex_unlock(&__lock);
+		acl_msg_error("%s(%d), %s: input sid(%s) invalid",
+			__FILE__, __LINE__, __FUNCTION__, *sid ? sid : "null");
+		if (errnum)
+			*errnum = GID_ERR_SID;
+		return (-1);
+	}
+
+	if (store->max_gid - (acl_int64) store->step * count
+		<= store->cur_gid)
+	{
 		acl_msg_error("%s(%d), %s: %s Override!!, max_gid: %lld,"
-			" step: %d, cur_gid: %lld", __FILE__, __LINE__,
-			__FUNCTION__, ACL_VSTREAM_PATH(store->fh.fp),
-			store->max_gid, store->step, store->cur_gid);
+			" step: %d, count: %d, cur_gid: %lld", __FILE__,
+			__LINE__, __FUNCTION__, ACL_VSTREAM_PATH(store->fp),
+			store->max_gid, store->step, count, store->cur_gid);
+		pthread_mutex_unlock(&__lock);
 
 		if (errnum)
 			*errnum = GID_ERR_OVERRIDE;
-		/* رļӳ 60 ر */
-		acl_fhandle_close(&store->fh, 60);
 		return (-1);
 	}
 
-	store->cur_gid += store->step;
-	gid = store->cur_gid;
+	gid = store->cur_gid + store->step;
+	store->cur_gid += (acl_int64) store->step * count;
 
-	if (__sync_gid && gid_store_sync(store) < 0) {
-		if (errnum)
-			*errnum = GID_ERR_SAVE;
-		acl_msg_error("%s(%d), %s: save %s error(%s)",
-			__FILE__, __LINE__, __FUNCTION__,
-			ACL_VSTREAM_PATH(store->fh.fp),
-			acl_last_serror());
+	/* reserve more gids, so the next ones needn't wait for the disk */
+	if (store->cur_gid > store->saved_gid) {
+		bound = store->cur_gid + (acl_int64) store->step * __reserve;
+		if (bound > store->max_gid || bound < store->cur_gid)
+			bound = store->max_gid;
 
-		/* رļӳ 60 ر */
-		acl_fhandle_close(&store->fh, 60);
-		return (-1);
+		if (gid_store_commit(store, bound) < 0) {
+			pthread_mutex_unlock(&__lock);
+			acl_msg_error("%s(%d), %s: save %s error",
+				__FILE__, __LINE__, __FUNCTION__,
+				ACL_VSTREAM_PATH(store->fp));
+			if (errnum)
+				*errnum = GID_ERR_SAVE;
+			return (-1);
+		}
 	}
 
-	/* ־ */
 	if (store->logger)
 		gid_logger(store);
 
-	/* رļӳ 60 ر */
-	acl_fhandle_close(&store->fh, 60);
+	pthread_mutex_unlock(&__lock);
 
 	if (errnum)
 		*errnum = GID_OK;
 	return (gid);
 }
 
+acl_int64 gid_next(const char *path, const char *tag,
+	unsigned int step, int *errnum)
+{
+	return (gid_next_block(path, tag, step, 1, errnum));
+}
+
 const char *gid_serror(int errnum)
 {
 	static const struct {
@@ -305,13 +394,40 @@ const char *gid_serror(int errnum)
 	return (unknown);
 }
 
-void gid_init(int fh_limit, int sync_gid, int debug_section)
+void gid_init(int fh_limit acl_unused, int sync_gid,
+	int debug_section acl_unused)
 {
 	__sync_gid = sync_gid;
-	 acl_fhandle_init(fh_limit, debug_section, ACL_FHANDLE_F_LOCK);
+	__stores = acl_htable_create(100, 0);
+	__dirty = acl_array_create(10);
+	__flushing = acl_array_create(10);
+}
+
+void gid_set_reserve(int reserve)
+{
+	if (reserve > 0)
+		__reserve = (unsigned int) reserve;
 }
 
 void gid_finish()
 {
-	acl_fhandle_end();
+	pthread_mutex_lock(&__lock);
+
+	while (__syncing)
+		pthread_cond_wait(&__cond, &__lock);
+
+	if (__stores) {
+		acl_htable_free(__stores, gid_store_free);
+		__stores = NULL;
+	}
+	if (__dirty) {
+		acl_array_free(__dirty, NULL);
+		__dirty = NULL;
+	}
+	if (__flushing) {
+		acl_array_free(__flushing, NULL);
+		__flushing = NULL;
+	}
+
+	pthread_mutex_unlock(&__lock);
 }
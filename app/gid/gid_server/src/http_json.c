@@ -42,6 +42,63 @@ static int json_new_gid(ACL_VSTREAM *client, int keep_alive, ACL_JSON *json)
 			buf, (int) strlen(buf)));
 }
 
+/* get the text of the first node with the name, return 0 if not found */
+
+static int json_get_text(ACL_JSON *json, const char *name,
+	char *buf, size_t size)
+{
+	ACL_ARRAY *a = acl_json_getElementsByTagName(json, name);
+	ACL_ITER iter;
+	int   found = 0;
+
+	if (a == NULL)
+		return (0);
+
+	acl_foreach(iter, a) {
+		ACL_JSON_NODE *node = (ACL_JSON_NODE*) iter.data;
+		if (ACL_VSTRING_LEN(node->text) == 0)
+			continue;
+		ACL_SAFE_STRNCPY(buf, STR(node->text), size);
+		found = 1;
+		break;
+	}
+	acl_json_free_array(a);
+	return (found);
+}
+
+/* { cmd: 'new_block', tag: 'xxx:sid', count: n } */
+
+static int json_new_block(ACL_VSTREAM *client, int keep_alive, ACL_JSON *json)
+{
+	acl_int64 gid;
+	char  buf[256], tag[64], count_s[32];
+	int   errnum = 0, count = 1;
+
+	ACL_SAFE_STRNCPY(tag, "default:", sizeof(tag));
+	(void) json_get_text(json, "tag", tag, sizeof(tag));
+	if (json_get_text(json, "count", count_s, sizeof(count_s)))
+		count = atoi(count_s);
+
+	if (count <= 0)
+		count = 1;
+	else if (count > var_cfg_gid_block_max)
+		count = var_cfg_gid_block_max;
+
+	gid = gid_next_block(var_cfg_gid_path, tag, var_cfg_gid_step,
+			count, &errnum);
+	if (gid >= 0)
+		snprintf(buf, sizeof(buf), "{ status: 'ok', gid: '%lld',"
+			" count: '%d', step: '%d', tag: '%s' }\r\n",
+			gid, count, var_cfg_gid_step, tag);
+	else
+		snprintf(buf, sizeof(buf), "{ status: 'error',"
+			" gid: '%lld', tag: '%s', err: '%d', msg: '%s' }\r\n",
+			gid, tag, errnum, gid_serror(errnum));
+
+	return (http_server_send_respond(client, 200, keep_alive,
+			buf, (int) strlen(buf)));
+}
+
 /*--------------------------------------------------------------------------*/
 
 typedef struct PROTO_JSON {
@@ -55,6 +112,7 @@ typedef struct PROTO_JSON {
 /* Эӳ */
 static PROTO_JSON __proto_json_tab[] = {
 	{ CMD_NEW_GID, json_new_gid },
+	{ CMD_NEW_BLOCK, json_new_block },
 	{ NULL, NULL },
 };
 
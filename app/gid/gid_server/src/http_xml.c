@@ -34,6 +34,47 @@ static int xml_new_gid(ACL_VSTREAM *client, int keep_alive, ACL_XML_NODE *node)
 			buf, (int) strlen(buf)));
 }
 
+/* <request cmd='new_block' tag='xxx:sid' count='n' /> */
+
+static int xml_new_block(ACL_VSTREAM *client, int keep_alive,
+	ACL_XML_NODE *node)
+{
+	acl_int64 gid;
+	char  buf[256], tag[64];
+	const char *ptr;
+	int   errnum = 0, count = 1;
+
+	ACL_SAFE_STRNCPY(tag, "default:", sizeof(tag));
+	ptr = acl_xml_getElementAttrVal(node, "tag");
+	if (ptr && *ptr) {
+		ACL_SAFE_STRNCPY(tag, ptr, sizeof(tag));
+	}
+	ptr = acl_xml_getElementAttrVal(node, "count");
+	if (ptr && *ptr)
+		count = atoi(ptr);
+
+	if (count <= 0)
+		count = 1;
+	else if (count > var_cfg_gid_block_max)
+		count = var_cfg_gid_block_max;
+
+	gid = gid_next_block(var_cfg_gid_path, tag, var_cfg_gid_step,
+			count, &errnum);
+	if (gid >= 0)
+		snprintf(buf, sizeof(buf),
+			"<respond status='ok' gid='%lld' count='%d'"
+			" step='%d' tag='%s' />\r\n",
+			gid, count, var_cfg_gid_step, tag);
+	else
+		snprintf(buf, sizeof(buf),
+			"<respond status='error' gid='%lld' tag='%s'"
+			" err='%d' msg='%s' />\r\n",
+			gid, tag, errnum, gid_serror(errnum));
+
+	return (http_server_send_respond(client, 200, keep_alive,
+			buf, (int) strlen(buf)));
+}
+
 /*--------------------------------------------------------------------------*/
 
 typedef struct PROTO_XML {
@@ -47,6 +88,7 @@ typedef struct PROTO_XML {
 /* Эӳ */
 static PROTO_XML __proto_xml_tab[] = {
 	{ CMD_NEW_GID, xml_new_gid },
+	{ CMD_NEW_BLOCK, xml_new_block },
 	{ NULL, NULL },
 };
 
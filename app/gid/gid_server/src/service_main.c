@@ -28,6 +28,8 @@ int   var_cfg_gid_step;
 int   var_cfg_gid_test;
 int   var_cfg_fh_limit;
 int   var_cfg_io_timeout;
+int   var_cfg_gid_reserve;
+int   var_cfg_gid_block_max;
 
 ACL_CONFIG_INT_TABLE service_conf_int_tab[] = {
 	/* TODO: you can add configure variables of int type here */
@@ -36,6 +38,8 @@ ACL_CONFIG_INT_TABLE service_conf_int_tab[] = {
 	{ "gid_test", 50000, &var_cfg_gid_test, 0, 0 },
 	{ "fh_limit", 100, &var_cfg_fh_limit, 0, 0 },
 	{ "io_timeout", 30, &var_cfg_io_timeout, 0, 0 },
+	{ "gid_reserve", 1000, &var_cfg_gid_reserve, 0, 0 },
+	{ "gid_block_max", 10000, &var_cfg_gid_block_max, 0, 0 },
 	{ 0, 0, 0, 0, 0 },
 };
 
@@ -124,6 +128,7 @@ void service_init(void *ctx acl_unused)
 
 	parse_proto_list();
 	gid_init(var_cfg_fh_limit, var_cfg_sync_gid, var_cfg_debug_section);
+	gid_set_reserve(var_cfg_gid_reserve);
 }
 
 void service_exit(void *ctx acl_unused)
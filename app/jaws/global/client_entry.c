@@ -48,7 +48,8 @@ CLIENT_ENTRY *client_entry_new(SERVICE *service, size_t size, ACL_ASTREAM *clien
 	ACL_VSTREAM *stream;
 
 	if (size < sizeof(CLIENT_ENTRY))
-		acl_msg_fatal("%s(%d): size(%d) invalid", myname, __LINE__, size);
+		acl_msg_fatal("%s(%d): size(%d) invalid",
+			myname, __LINE__, (int) size);
 
 	entry = (CLIENT_ENTRY* ) acl_mycalloc(1, size);
 	entry->service = service;
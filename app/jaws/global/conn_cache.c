@@ -69,7 +69,8 @@ static void conn_pool_free(CONN_POOL *conns)
 
 /* ͷӳضʱص */
 
-static void conn_pool_free_timer(int event_type acl_unused, void *context)
+static void conn_pool_free_timer(int event_type acl_unused,
+	ACL_EVENT *event acl_unused, void *context)
 {
 	CONN_POOL *conns = (CONN_POOL*) context;
 
@@ -82,25 +83,31 @@ static void conn_pool_free_timer(int event_type acl_unused, void *context)
 
 static void set_conn_pool_free_timer(CONN_POOL *conns)
 {
-	acl_aio_request_timer(conns->aio, conn_pool_free_timer, conns, 1, 1);
+	/* run only once, for the pool is freed by it */
+	acl_aio_request_timer(conns->aio, conn_pool_free_timer, conns,
+		1000000, 0);
 }
 
-static void conn_pool_stat_timer(int event_type acl_unused, void *context)
+static void conn_pool_stat_timer(int event_type acl_unused,
+	ACL_EVENT *event acl_unused, void *context)
 {
 	const char *myname = "conn_pool_stat_timer";
 	CONN_CACHE *cache = (CONN_CACHE*) context;
 
 	/* only for test */
 	if (0)
-	acl_msg_info("%s(%d): nset: %d, nget: %d, nclose: %d, inter: %d",
-		myname, __LINE__, cache->nset, cache->nget,
-		cache->nclose, cache->nset - cache->nget - cache->nclose);
+	acl_msg_info("%s(%d): nset: %d, nget: %d, nclose: %d, inter: %d,"
+		" nstale: %d, nevict: %d", myname, __LINE__, cache->nset,
+		cache->nget, cache->nclose,
+		cache->nset - cache->nget - cache->nclose,
+		cache->nstale, cache->nevict);
 }
 
 static void set_conn_pool_stat_timer(CONN_CACHE *cache)
 {
 	/* öʱ */
-	acl_aio_request_timer(cache->aio, conn_pool_stat_timer, cache, 2, 1);
+	acl_aio_request_timer(cache->aio, conn_pool_stat_timer, cache,
+		2000000, 1);
 }
 
 CONN_CACHE *conn_cache_create(ACL_AIO *aio, int conn_limit)
@@ -118,6 +125,11 @@ CONN_CACHE *conn_cache_create(ACL_AIO *aio, int conn_limit)
 	return (cache);
 }
 
+void conn_cache_set_limit(CONN_CACHE *cache, int conn_limit)
+{
+	cache->conn_limit = conn_limit;
+}
+
 /* ɶʱĻص */
 
 static int read_callback(ACL_ASTREAM *stream acl_unused, void *ctx acl_unused,
@@ -143,6 +155,15 @@ static int read_close_callback(ACL_ASTREAM *stream acl_unused, void *ctx)
 	CONN *conn = (CONN*) ctx;
 	CONN_POOL *conns = conn->conn_pool;
 
+	/* the connection has been taken out of the pool when being evicted
+	 * or checked as stale, so the pool mustn't be touched here
+	 */
+	if (conn->info == NULL) {
+		conn_free(conn);
+		conns->conn_cache->nclose++;
+		return (-1);
+	}
+
 	/* ͷŸӶڴռ䣬رոӣ
 	 * رչ첽Զر
 	 */
@@ -191,17 +212,6 @@ void conn_cache_push_stream(CONN_CACHE *cache, ACL_ASTREAM *stream,
 		acl_htable_enter(cache->cache, key, conns);
 	}
 
-#if 0
-	/* ӳеƣͷɵӶ */
-	if (acl_fifo_size(&conns->conns) >= cache->conn_limit) {
-		conn = acl_fifo_pop(&conns->conns);
-		if (conn) {
-			conn->info = NULL;
-			conn_close(conn);
-		}
-	}
-#endif
-
 	cache->nset++;
 
 	/* µ첽ӻ */
@@ -223,6 +233,34 @@ void conn_cache_push_stream(CONN_CACHE *cache, ACL_ASTREAM *stream,
 		ACL_AIO_CTL_END);
 	/* ʼ */
 	acl_aio_read(stream);
+
+	/* keep at most conn_limit idle connections for one address, the
+	 * oldest ones are closed first, the pool isn't empty after it
+	 */
+	while (cache->conn_limit > 0
+		&& acl_fifo_size(&conns->conns) > cache->conn_limit)
+	{
+		CONN *oldest = (CONN*) acl_fifo_pop(&conns->conns);
+
+		oldest->info = NULL;
+		cache->nevict++;
+		conn_close(oldest);
+	}
+}
+
+/* the idle connection is stale if the upstream has closed it or sent
+ * something unexpected, which hasn't been handled by the event loop
+ */
+
+static int conn_stale(CONN *conn)
+{
+	ACL_VSTREAM *stream = acl_aio_vstream(conn->stream);
+
+	if (stream == NULL)
+		return (1);
+	if (stream->read_cnt > 0)
+		return (1);
+	return (acl_readable(ACL_VSTREAM_SOCK(stream)));
 }
 
 CONN *conn_cache_get_conn(CONN_CACHE *cache, const char *key)
@@ -239,7 +277,17 @@ CONN *conn_cache_get_conn(CONN_CACHE *cache, const char *key)
 
 	/* ӸKEYӳȡһӣȡΪNULLͷŸӳض */
 
-	conn = acl_fifo_pop(&conns->conns);
+	/* the most recently used one is taken first, so the idle ones at
+	 * the head of the pool can be timed out or evicted
+	 */
+	while ((conn = acl_fifo_pop_back(&conns->conns)) != NULL) {
+		if (!conn_stale(conn))
+			break;
+		conn->info = NULL;
+		cache->nstale++;
+		conn_close(conn);
+	}
+
 	if (conn == NULL) {
 		/* ȴӳػɾ */
 		acl_htable_delete(cache->cache, conns->key, NULL);
@@ -253,6 +301,7 @@ CONN *conn_cache_get_conn(CONN_CACHE *cache, const char *key)
 	acl_aio_del_read_hook(conn->stream, read_callback, conn);
 	acl_aio_del_close_hook(conn->stream, read_close_callback, conn);
 	acl_aio_del_timeo_hook(conn->stream, read_timeout_callback, conn);
+	conn->info = NULL;
 #else
 	acl_aio_clean_hooks(conn->stream);
 #endif
@@ -14,6 +14,8 @@ typedef struct CONN_CACHE {
 	int   nset;
 	int   nget;
 	int   nclose;
+	int   nstale;	/* the idle connections closed by the health check */
+	int   nevict;	/* the idle connections closed for the conn_limit */
 } CONN_CACHE;
 
 typedef struct CONN CONN;
@@ -37,6 +39,14 @@ CONN_CACHE *conn_cache_create(ACL_AIO *aio, int conn_limit);
 void conn_cache_push_stream(CONN_CACHE *cache, ACL_ASTREAM *stream,
 	int timeout, void (*free_fn)(ACL_ASTREAM*, void*), void *ctx);
 
+/**
+ * Set the max number of the idle connections kept for one address, the
+ * oldest ones are closed when more connections are put into the pool
+ * @param cache {CONN_CAHCE*}
+ * @param conn_limit {int} no limit if <= 0
+ */
+void conn_cache_set_limit(CONN_CACHE *cache, int conn_limit);
+
 /**
  * ӳȡӦĳֵӶ
  * @param cache {CONN_CAHCE*} ӻ
@@ -50,7 +50,7 @@ static void inner_nslookup_ok(CLIENT_ENTRY *entry, ACL_DNS_DB *dns_db)
 }
 
 static void inner_nslookup_complete(ACL_DNS_DB *dns_db, void *ctx,
-	int errnum acl_unused)
+	int errnum acl_unused, const ACL_RFC1035_MESSAGE *res acl_unused)
 {
 	CLIENT_ENTRY *entry = (CLIENT_ENTRY*) ctx;
 
@@ -97,7 +97,7 @@ static void thrpool_nslookup_complete(const DNS_CTX *dns_ctx)
 	list = (DNS_RING *) acl_htable_find(service->dns_table,
 				dns_ctx->domain_key);
 	if (list == NULL) {
-		acl_msg_warn(NULL, "%s: domain(%s) not found maybe handled",
+		acl_msg_warn("%s: domain(%s) not found maybe handled",
 			myname, dns_ctx->domain_key);
 		return;
 	}
@@ -108,7 +108,7 @@ static void thrpool_nslookup_complete(const DNS_CTX *dns_ctx)
 	/* ѯʱϢ */
 	if (inter >= 5)
 		acl_msg_warn("%s(%d): dns search time=%d, domain(%s)",
-			myname, __LINE__, time(NULL) - dns_ctx->begin,
+			myname, __LINE__, (int) inter,
 			dns_ctx->domain_key);
 
 	while (1) {
@@ -250,11 +250,16 @@ void dns_lookup(CLIENT_ENTRY *entry, const char *domain, int port)
 {
 	const char *myname = "dns_lookup";
 	SERVICE *service = entry->service;
+	char *ptr;
 
 	if (acl_is_ip(domain)) {
 		entry->ip_idx = 0;
 		ACL_SAFE_STRNCPY(entry->dns_ctx.ip[0], domain,
 			sizeof(entry->dns_ctx.ip[0]));
+		/* strip the port as the domain name is done below */
+		ptr = strchr(entry->dns_ctx.ip[0], ':');
+		if (ptr && strchr(ptr + 1, ':') == NULL)
+			*ptr = 0;
 		entry->dns_ctx.port[0] = port;
 		entry->dns_ctx.ip_cnt = 1;
 		entry->nslookup_notify_fn(entry, NSLOOKUP_OK);
@@ -32,8 +32,9 @@ static ACL_ASTREAM *peek_server_conn(CLIENT_ENTRY *entry)
 	if (entry->service->conn_cache == NULL)
 		return (NULL);
 	for (i = entry->ip_idx; i < entry->dns_ctx.ip_cnt; i++) {
-		snprintf(addr, sizeof(addr), "%s:%d", entry->dns_ctx.ip[i],
-			entry->dns_ctx.port[i] > 0
+		/* the key is the peer address of the cached stream */
+		snprintf(addr, sizeof(addr), "%s%c%d", entry->dns_ctx.ip[i],
+			ACL_ADDR_SEP, entry->dns_ctx.port[i] > 0
 				? entry->dns_ctx.port[i] : entry->server_port);
 		stream = conn_cache_get_stream(entry->service->conn_cache, addr, NULL);
 		if (stream != NULL)
@@ -141,7 +142,7 @@ static int connect_close_callback(ACL_ASTREAM *astream, void *context)
 
 		client_entry_set_server(entry, server);
 		acl_aio_ctl(server,
-			ACL_AIO_CTL_CONNECT_HOOK_ADD, connect_callback,
+			ACL_AIO_CTL_CONNECT_HOOK_ADD, connect_callback, entry,
 			ACL_AIO_CTL_CLOSE_HOOK_ADD, connect_close_callback, entry,
 			ACL_AIO_CTL_TIMEO_HOOK_ADD, connect_timeout_callback, entry,
 			ACL_AIO_CTL_CTX, entry,
@@ -208,7 +209,7 @@ static int connect_timeout_callback(ACL_ASTREAM *astream, void *context)
 
 		client_entry_set_server(entry, server);
 		acl_aio_ctl(server,
-			ACL_AIO_CTL_CONNECT_HOOK_ADD, connect_callback,
+			ACL_AIO_CTL_CONNECT_HOOK_ADD, connect_callback, entry,
 			ACL_AIO_CTL_CLOSE_HOOK_ADD, connect_close_callback, entry,
 			ACL_AIO_CTL_TIMEO_HOOK_ADD, connect_timeout_callback, entry,
 			ACL_AIO_CTL_CTX, entry,
@@ -238,7 +239,7 @@ CONNECT_ERROR:
 	return (-1);
 }
 
-static int connect_callback(ACL_ASTREAM *server, void *context)
+static int connect_callback(ACL_ASTREAM *server acl_unused, void *context)
 {
 	CLIENT_ENTRY *entry = (CLIENT_ENTRY*) context;
 
@@ -272,7 +273,7 @@ void forward_start(CLIENT_ENTRY *entry)
 
 		client_entry_set_server(entry, server);
 		acl_aio_ctl(server,
-			ACL_AIO_CTL_CONNECT_HOOK_ADD, connect_callback,
+			ACL_AIO_CTL_CONNECT_HOOK_ADD, connect_callback, entry,
 			ACL_AIO_CTL_CTX, entry,
 			ACL_AIO_CTL_CLOSE_HOOK_ADD, connect_close_callback, entry,
 			ACL_AIO_CTL_TIMEO_HOOK_ADD, connect_timeout_callback, entry,
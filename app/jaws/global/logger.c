@@ -348,7 +348,8 @@ static void buffer_logger_write(void *ctx, const char *fmt, va_list ap)
 	}
 }
 
-static void buffed_logger_fflush(int event_type acl_unused, void *context)
+static void buffed_logger_fflush(int event_type acl_unused,
+	ACL_EVENT *event acl_unused, void *context)
 {
 	LOG_WRAP *h_log = (LOG_WRAP*) context;
 
@@ -370,7 +371,8 @@ static void buffed_logger_set(ACL_AIO *aio)
 
 	acl_msg_register(buffer_logger_open, buffer_logger_close,
 		buffer_logger_write, (void*)h_log);
-	(void) acl_aio_request_timer(aio, buffed_logger_fflush, h_log, 1, 1);
+	(void) acl_aio_request_timer(aio, buffed_logger_fflush, h_log,
+		1000000, 1);
 	__log_wrap = h_log;
 }
 
@@ -1,5 +1,6 @@
 #include "lib_acl.h"
 #include "service.h"
+#include "service_main.h"
 
 void service_free(SERVICE *service)
 {
@@ -17,7 +18,7 @@ SERVICE *service_alloc(const char *service_name, size_t size)
 
 	if (size < sizeof(SERVICE))
 		acl_msg_fatal("%s(%d): size(%d) invalid",
-			myname, __LINE__, size);
+			myname, __LINE__, (int) size);
 	service = (SERVICE *) acl_mycalloc(1, size);
 	/* ÷ */
 	ACL_SAFE_STRNCPY(service->name, service_name, sizeof(service->name));
@@ -89,15 +90,19 @@ void service_set_dns(SERVICE *service, ACL_AIO *aio,
 
 static int __timer = 10;
 
-static void service_gc_timer(int event_type acl_unused, void *context)
+static void service_gc_timer(int event_type acl_unused,
+	ACL_EVENT *event acl_unused, void *context acl_unused)
 {
-	int   n;
-	ACL_AIO *aio = (ACL_AIO*) context;
-	n = acl_mem_slice_gc();
+	(void) acl_mem_slice_gc();
 }
 
 void service_set_gctimer(ACL_AIO *aio, int timer)
 {
+	/* acl_mem_slice_gc() mustn't be called without the mem slice */
+	if (var_mem_slice == NULL)
+		return;
+
 	__timer = timer;
-	acl_aio_request_timer(aio, service_gc_timer, aio, timer, 1);
+	acl_aio_request_timer(aio, service_gc_timer, aio,
+		(acl_int64) timer * 1000000, 1);
 }
@@ -89,10 +89,9 @@ static SERVICE *service_create(ACL_AIO *aio,
 	return (curr_service);
 }
 
-static void gc_timer(int event_type acl_unused, void *context)
+static void gc_timer(int event_type acl_unused,
+	ACL_EVENT *event acl_unused, void *context acl_unused)
 {
-	ACL_AIO *aio = (ACL_AIO *) context;
-
 	acl_mem_slice_delay_destroy();
 }
 
@@ -116,7 +115,7 @@ void service_init(ACL_AIO *aio, ACL_FIFO *modules)
 	__dll_env.mem_slice = var_mem_slice;
 	if (var_mem_slice) {
 		/* 趨ʱʱ */
-		acl_aio_request_timer(aio, gc_timer, aio, 2, 1);
+		acl_aio_request_timer(aio, gc_timer, aio, 2000000, 1);
 	}
 
 	if (__dll_env.mem_slice)
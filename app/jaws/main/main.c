@@ -34,10 +34,9 @@ static int listen_callback(ACL_ASTREAM *sstream, void *context acl_unused)
 	return (0);
 }
 
-static void gc_timer(int event_type acl_unused, void *context)
+static void gc_timer(int event_type acl_unused,
+	ACL_EVENT *event acl_unused, void *context acl_unused)
 {
-	ACL_AIO *aio = (ACL_AIO *) context;
-
 	acl_mem_slice_delay_destroy();
 }
 
@@ -59,7 +58,7 @@ static void run_loop(ACL_AIO *aio, const char *listen_addr)
 		ACL_AIO_CTL_END);
 	acl_aio_listen(astream);
 	/* 趨ʱʱ */
-	acl_aio_request_timer(aio, gc_timer, aio, 2, 1);
+	acl_aio_request_timer(aio, gc_timer, aio, 2000000, 1);
 
 	while (1) {
 		acl_aio_loop(aio);
@@ -137,7 +136,7 @@ static ACL_AIO *init(const char *procname, int use_slice, int open_log acl_unuse
 		var_mem_slice = NULL;
 
 	/* ʼ acl  */
-	acl_init();
+	acl_lib_init();
 
 	/* ļ */
 	cfg = acl_xinetd_cfg_load(conf);
@@ -181,7 +180,7 @@ static ACL_AIO *init(const char *procname, int use_slice, int open_log acl_unuse
 static void end(void)
 {
 	service_exit();
-	acl_end();
+	acl_lib_end();
 }
 
 static void usage(const char *procname)
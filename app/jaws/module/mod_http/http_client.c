@@ -36,6 +36,7 @@ void http_client_free(CLIENT_ENTRY *entry)
 		acl_vstring_free(client->buf);
 		client->buf = NULL;
 	}
+	http_client_splice_close(client);
 
 	client_entry_free(entry);
 }
@@ -50,6 +51,10 @@ HTTP_CLIENT *http_client_new(HTTP_SERVICE *service, ACL_ASTREAM *stream)
 	acl_fifo_init(&client->req_list);
 	client->entry.free_fn = http_client_free;
 	client->flag = 0;
+	client->splice_fds[0] = -1;
+	client->splice_fds[1] = -1;
+	client->splice_left = 0;
+	client->splice_len = 0;
 
 	return (client);
 }
@@ -202,3 +207,17 @@ int http_client_req_filter(HTTP_CLIENT *http_client)
 	return (1);
 }
 
+void http_client_splice_close(HTTP_CLIENT *client)
+{
+#ifdef ACL_UNIX
+	if (client->splice_fds[0] >= 0) {
+		close(client->splice_fds[0]);
+		client->splice_fds[0] = -1;
+	}
+	if (client->splice_fds[1] >= 0) {
+		close(client->splice_fds[1]);
+		client->splice_fds[1] = -1;
+	}
+#endif
+	client->splice_len = 0;
+}
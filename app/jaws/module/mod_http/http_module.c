@@ -24,11 +24,15 @@ static ACL_CFG_STR_TABLE __conf_str_tab[] = {
 	{ 0, 0, 0 }
 };
 
-static int   var_cfg_http_server_conn_limit;
+int   var_cfg_http_server_conn_limit;
+int   var_cfg_http_server_idle_timeout;
+int   var_cfg_http_splice_min;
 static int   var_cfg_http_buf_size;
 
 static ACL_CONFIG_INT_TABLE __conf_int_tab[] = {
 	{ "http_server_conn_limit", 1000, &var_cfg_http_server_conn_limit, 0, 0 },
+	{ "http_server_idle_timeout", 60, &var_cfg_http_server_idle_timeout, 0, 0 },
+	{ "http_splice_min", 65536, &var_cfg_http_splice_min, 0, 0 },
 	{ "http_buf_size", 8192, &var_cfg_http_buf_size, 0, 0 },
 	{ 0, 0, 0, 0, 0 },
 };
@@ -119,6 +123,8 @@ void module_service_init(ACL_DLL_ENV *dll_env, const char *cfg_dir)
 	/* ʼӳ */
 	if (var_cfg_http_server_conn_limit < 10)
 		var_cfg_http_server_conn_limit = 10;
+	if (var_cfg_http_server_idle_timeout <= 0)
+		var_cfg_http_server_idle_timeout = 60;
 
 	/* HTTPС */
 	if (var_cfg_http_buf_size > 0) {
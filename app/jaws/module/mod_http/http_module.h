@@ -25,6 +25,9 @@ extern int   var_cfg_http_server_keepalive;
 extern int   var_cfg_http_domain_allow_all;
 extern int   var_cfg_http_method_connect_enable;
 extern int   var_cfg_http_proxy_connection_off;
+extern int   var_cfg_http_server_conn_limit;
+extern int   var_cfg_http_server_idle_timeout;
+extern int   var_cfg_http_splice_min;
 
 /* ̬صĺӿ */
 
@@ -1,3 +1,6 @@
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE  /* for splice */
+#endif
 #include "lib_acl.h"
 #include "lib_protocol.h"
 #include "assert.h"
@@ -12,6 +15,12 @@
 #define getpid _getpid
 #endif
 
+#ifdef ACL_LINUX
+#include <fcntl.h>
+#define	HTTP_SPLICE	1
+#define	SPLICE_CHUNK	(64 * 1024)
+#endif
+
 static int http_proxy_next(HTTP_CLIENT *http_client);
 static void http_proxy_req_get(HTTP_CLIENT *http_client);
 
@@ -49,7 +58,7 @@ static void http_proxy_server_complete(HTTP_CLIENT *http_client, int keep_alive)
 	sstream = acl_aio_vstream(server);
 
 	if (keep_alive) {
-		int   timeout = 60;
+		int   timeout = var_cfg_http_server_idle_timeout;
 		/*  */
 		client_entry_detach(&http_client->entry, sstream);
 		ACL_VSTRING_RESET(&server->strbuf);
@@ -380,6 +389,206 @@ static void forward_respond_hdr(HTTP_CLIENT *http_client)
 		(int) ACL_VSTRING_LEN(http_client->buf));
 }
 
+#ifdef HTTP_SPLICE
+
+/* The response body not less than http_splice_min is moved from the server
+ * socket into the pipe and then to the client socket by splice(2), so the
+ * body needn't be copied into the user space. It is used only when the
+ * streams are plain sockets without TLS or other IO hooks, and there're no
+ * body filters and the body length is known.
+ */
+
+static int splice_plain(ACL_ASTREAM *astream)
+{
+	ACL_VSTREAM *stream = acl_aio_vstream(astream);
+
+	return (stream != NULL && (stream->type & ACL_VSTREAM_TYPE_SOCK)
+		&& stream->read_fn == acl_socket_read
+		&& stream->write_fn == acl_socket_write);
+}
+
+static int splice_enabled(HTTP_CLIENT *http_client)
+{
+	HTTP_SERVICE *service = (HTTP_SERVICE*) http_client->entry.service;
+	HTTP_HDR_RES *hdr_res = http_client->hdr_res;
+
+	if (var_cfg_http_splice_min <= 0 || hdr_res->hdr.chunked)
+		return (0);
+	if (hdr_res->hdr.content_length < (acl_int64) var_cfg_http_splice_min)
+		return (0);
+	if (acl_fifo_size(&service->respond_dat_plugins) > 0)
+		return (0);
+	return (splice_plain(http_client->entry.client)
+		&& splice_plain(http_client->entry.server));
+}
+
+static int splice_pipe_open(HTTP_CLIENT *http_client)
+{
+	/* the data left in the pipe by the broken response is discarded */
+	if (http_client->splice_len > 0)
+		http_client_splice_close(http_client);
+
+	if (http_client->splice_fds[0] >= 0)
+		return (0);
+	if (pipe2(http_client->splice_fds, O_NONBLOCK | O_CLOEXEC) < 0) {
+		acl_msg_error("%s(%d): pipe2 error %s",
+			__FUNCTION__, __LINE__, acl_last_serror());
+		http_client->splice_fds[0] = -1;
+		http_client->splice_fds[1] = -1;
+		return (-1);
+	}
+	return (0);
+}
+
+/* move the data in the pipe to the client, return -1 if error */
+
+static int splice_to_client(HTTP_CLIENT *http_client)
+{
+	ACL_SOCKET fd = ACL_VSTREAM_SOCK(acl_aio_vstream(http_client->entry.client));
+	ssize_t n;
+
+	while (http_client->splice_len > 0) {
+		n = splice(http_client->splice_fds[0], NULL, fd, NULL,
+			(size_t) http_client->splice_len,
+			SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+		if (n > 0) {
+			http_client->splice_len -= (int) n;
+			http_client->sent_size += (size_t) n;
+		} else if (n < 0 && errno == EAGAIN)
+			return (0);
+		else if (n < 0 && errno == EINTR)
+			continue;
+		else
+			return (-1);
+	}
+	return (0);
+}
+
+static void splice_finish(HTTP_CLIENT *http_client, int error_happen)
+{
+	http_client->flag &= ~(HTTP_FLAG_SERVER_LOCKED | HTTP_FLAG_CLIENT_LOCKED);
+	http_client->flag |= HTTP_FLAG_FINISH;
+
+	if (error_happen)
+		http_client_splice_close(http_client);
+	else
+		acl_aio_disable_read(http_client->entry.server);
+	http_proxy_complete(http_client, error_happen);
+}
+
+static int splice_read_ready(ACL_ASTREAM *server, void *ctx);
+static int splice_write_ready(ACL_ASTREAM *client, void *ctx);
+
+/* go on reading from the server or writing to the client */
+
+static int splice_next(HTTP_CLIENT *http_client)
+{
+	if (splice_to_client(http_client) < 0) {
+		splice_finish(http_client, -1);
+		return (0);
+	}
+
+	if (http_client->splice_len > 0) {
+		/* the client is slow, wait for it being writable */
+		acl_aio_disable_read(http_client->entry.server);
+		acl_aio_enable_write(http_client->entry.client,
+			splice_write_ready, http_client);
+	} else if (http_client->splice_left > 0)
+		acl_aio_enable_read(http_client->entry.server,
+			splice_read_ready, http_client);
+	else
+		splice_finish(http_client, 0);
+	return (0);
+}
+
+static int splice_read_ready(ACL_ASTREAM *server, void *ctx)
+{
+	HTTP_CLIENT *http_client = (HTTP_CLIENT*) ctx;
+	ACL_SOCKET fd = ACL_VSTREAM_SOCK(acl_aio_vstream(server));
+	size_t size = http_client->splice_left > SPLICE_CHUNK
+		? SPLICE_CHUNK : (size_t) http_client->splice_left;
+	ssize_t n;
+
+	n = splice(fd, NULL, http_client->splice_fds[1], NULL, size,
+		SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+	if (n > 0) {
+		http_client->splice_left -= n;
+		http_client->splice_len += (int) n;
+		http_client->total_size += (size_t) n;
+	} else if (n < 0 && (errno == EAGAIN || errno == EINTR)) {
+		acl_aio_enable_read(server, splice_read_ready, http_client);
+		return (0);
+	} else {
+		/* the server closed before the whole body sent */
+		acl_msg_error("%s(%d): splice from server error %s, left %lld",
+			__FUNCTION__, __LINE__, n == 0 ? "eof" : acl_last_serror(),
+			http_client->splice_left);
+		splice_finish(http_client, -1);
+		return (0);
+	}
+
+	return (splice_next(http_client));
+}
+
+static int splice_write_ready(ACL_ASTREAM *client acl_unused, void *ctx)
+{
+	return (splice_next((HTTP_CLIENT*) ctx));
+}
+
+/* the header and the body read with it have been sent to the client */
+
+static int splice_hdr_complete(ACL_ASTREAM *client, void *ctx)
+{
+	HTTP_CLIENT *http_client = (HTTP_CLIENT*) ctx;
+
+	acl_aio_del_write_hook(client, splice_hdr_complete, http_client);
+	http_client->flag &= ~HTTP_FLAG_CLIENT_LOCKED;
+	return (splice_next(http_client));
+}
+
+static void forward_respond_splice(HTTP_CLIENT *http_client)
+{
+	ACL_VSTREAM *server = acl_aio_vstream(http_client->entry.server);
+	struct iovec iov[2];
+	int   n = 0;
+
+	http_client->splice_left = http_client->hdr_res->hdr.content_length;
+	http_client->splice_len = 0;
+
+	/* the body read with the header is sent with the header in one
+	 * writev, the left is spliced from the server socket directly
+	 */
+	iov[0].iov_base = STR(http_client->buf);
+	iov[0].iov_len  = LEN(http_client->buf);
+	if (server->read_cnt > 0) {
+		acl_int64 cnt = server->read_cnt;
+
+		if (cnt > http_client->splice_left)
+			cnt = http_client->splice_left;
+		iov[1].iov_base = (char*) server->read_ptr;
+		iov[1].iov_len  = (size_t) cnt;
+		server->read_ptr += cnt;
+		server->read_cnt -= (int) cnt;
+		http_client->splice_left -= cnt;
+		http_client->total_size += (size_t) cnt;
+		n = 1;
+	}
+
+	ACL_VSTRING_RESET(http_client->buf);
+
+	/* the client is locked while writing the header, and none of the
+	 * streams is locked when splicing, because the readable/writable
+	 * notifications are disabled when the streams being closed
+	 */
+	http_client->flag |= HTTP_FLAG_CLIENT_LOCKED;
+
+	acl_aio_add_write_hook(http_client->entry.client,
+		splice_hdr_complete, http_client);
+	acl_aio_writev(http_client->entry.client, iov, 1 + n);
+}
+
+#endif /* HTTP_SPLICE */
+
 static void start_forward_respond(HTTP_CLIENT *http_client)
 {
 	/* Ƿ˱ֳ? */
@@ -418,6 +627,12 @@ static void start_forward_respond(HTTP_CLIENT *http_client)
 	/* xxx: û content-length  content-length > 0
 	 * Ӧ״̬벻Ϊ 3xx, 4xx 
 	 */
+#ifdef HTTP_SPLICE
+	if (splice_enabled(http_client) && splice_pipe_open(http_client) == 0) {
+		forward_respond_splice(http_client);
+		return;
+	}
+#endif
 	forward_respond_hdr_body(http_client);
 }
 
@@ -264,7 +264,7 @@ static int request_header_ready(int status, void *arg)
 	if (ACL_VSTRING_LEN(req->hdr_req->url_path) <= 0) {
 		acl_msg_error("%s: url_path(%s)'s len(%d)",
 			myname, acl_vstring_str(req->hdr_req->url_path),
-			ACL_VSTRING_LEN(req->hdr_req->url_path));
+			(int) ACL_VSTRING_LEN(req->hdr_req->url_path));
 		return (-1);
 	}
 
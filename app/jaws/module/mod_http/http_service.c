@@ -31,6 +31,11 @@ void http_service_main(HTTP_SERVICE *service, ACL_ASTREAM *stream)
 {
 	HTTP_CLIENT *client;
 
+	/* the idle connections kept for each upstream address */
+	if (service->service.conn_cache)
+		conn_cache_set_limit(service->service.conn_cache,
+			var_cfg_http_server_conn_limit);
+
 	client = http_client_new(service, stream);
 	http_service_start(client);
 }
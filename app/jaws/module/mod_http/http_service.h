@@ -119,6 +119,13 @@ struct HTTP_CLIENT {
 	size_t total_size;
 	size_t sent_size;
 
+	/* the pipe used to splice the response body from the server to
+	 * the client, created when first used and kept for the next ones
+	 */
+	int   splice_fds[2];
+	acl_int64 splice_left;			/* bytes left to read from server */
+	int   splice_len;			/* bytes in the pipe */
+
 	struct {
 		time_t read_reqhdr;		/* HTTPЭͷʱ */
 		time_t read_reqbody;		/* HTTPЭʱ */
@@ -175,6 +182,7 @@ void http_client_reset(HTTP_CLIENT *client);
 HTTP_CLIENT_REQ *http_client_req_new(HTTP_CLIENT *http_client);
 void http_client_req_free(HTTP_CLIENT_REQ *req);
 int http_client_req_filter(HTTP_CLIENT *http_client);
+void http_client_splice_close(HTTP_CLIENT *client);
 
 /* in http_server.c */
 int http_server_start(HTTP_CLIENT *http_client);
@@ -0,0 +1,34 @@
+#!/bin/sh
+
+# Compare the passthrough mode with the parsing mode of the gateway by
+# redis-benchmark, the redis should be running on redis_addrs set in
+# redis_gateway.cf, and the CPU time of the gateway is shown after each run.
+#
+# usage: ./bench.sh [requests] [clients] [pipeline] [data_size]
+
+N=${1:-1000000}
+C=${2:-50}
+P=${3:-16}
+D=${4:-64}
+CONF=/tmp/redis_gateway_bench.cf
+REDIS_PORT=`grep "^[[:space:]]*redis_addrs" redis_gateway.cf | sed 's/.*://'`
+
+echo "redis on $REDIS_PORT:"
+redis-benchmark -p $REDIS_PORT -n $N -c $C -P $P -d $D -t set,get -q
+
+for mode in yes no; do
+	sed "s/^[[:space:]]*passthrough = .*/	passthrough = $mode/" \
+		redis_gateway.cf > $CONF
+	./redis_gateway alone $CONF > /dev/null 2>&1 &
+	pid=$!
+	sleep 1
+
+	echo "gateway with passthrough = $mode:"
+	redis-benchmark -p 16379 -n $N -c $C -P $P -d $D -t set,get -q
+	echo "gateway cpu time: `ps -o cputime= -p $pid`"
+
+	kill $pid
+	wait $pid 2>/dev/null
+done
+
+rm -f $CONF
@@ -2,6 +2,7 @@
 #include "redis/redis_object.h"
 #include "redis/redis_client.h"
 #include "redis/redis_transfer.h"
+#include "redis/redis_passthrough.h"
 #include "master_service.h"
 
 char *var_cfg_redis_addrs;
@@ -15,9 +16,11 @@ acl::master_str_tbl var_conf_str_tab[] = {
 };
 
 static int  var_cfg_debug_enable;
+static int  var_cfg_passthrough;
 
 acl::master_bool_tbl var_conf_bool_tab[] = {
 	{ "debug_enable",	1,		&var_cfg_debug_enable	},
+	{ "passthrough",	1,		&var_cfg_passthrough	},
 
 	{ 0, 0, 0 }
 };
@@ -50,9 +53,18 @@ void master_service::on_accept(acl::socket_stream& conn)
 {
 	conn.set_rw_timeout(var_cfg_io_timeout);
 
-	acl::dbuf_guard* dbuf = new acl::dbuf_guard;
 	redis_client client(conn);
 
+	// Forward the RESP data of the commands and the replies without
+	// parsing and rebuilding them.
+	if (var_cfg_passthrough) {
+		redis_passthrough passthrough(client, conn, *redis_pipeline_);
+		while (passthrough.run()) {}
+		return;
+	}
+
+	acl::dbuf_guard* dbuf = new acl::dbuf_guard;
+
 	redis_transfer transfer(*dbuf, conn, *redis_pipeline_);
 
 	std::vector<const redis_object*> objs;
@@ -274,6 +274,117 @@ const redis_object* redis_client::read_reply(acl::dbuf_pool& dbuf,
 	return NULL;
 }
 
+// Append one line with the "\r\n" to out.
+static bool append_line(acl::socket_stream& conn, acl::string& out)
+{
+	while (true) {
+		size_t size = 128;
+		out.space(size);
+		char* ptr = out.c_str() + out.size();
+		bool ok = conn.gets(ptr, &size, false);
+		out.set_offset(out.size() + size);
+		if (ok) {
+			return true;
+		}
+		if (size == 0) {
+			return false;
+		}
+	}
+}
+
+bool redis_client::read_raw(acl::string& out, redis_raw_args& args)
+{
+	out.clear();
+	args.argc = 0;
+
+	char ch;
+	if (conn_.read(ch) == false) {
+		return false;
+	}
+	conn_.ugetch(ch);
+
+	if (ch != '*') {
+		return read_inline(out, args);
+	}
+
+	if (!append_line(conn_, out)) {
+		return false;
+	}
+
+	long long count = atoll(out.c_str() + 1);
+	for (long long i = 0; i < count; i++) {
+		size_t off = out.size();
+		if (!append_line(conn_, out)) {
+			return false;
+		}
+
+		const char* line = out.c_str() + off;
+		long long len = atoll(line + 1);
+		if (*line != '$' || len < 0) {
+			logger_error("invalid request line: %s", line);
+			return false;
+		}
+
+		if (i < 2) {
+			args.offs[i] = out.size();
+			args.lens[i] = (size_t) len;
+		}
+
+		// Read the argument with the tail "\r\n" at once.
+		len += 2;
+		out.space((size_t) len);
+		if (conn_.read(out.c_str() + out.size(), (size_t) len) == -1) {
+			return false;
+		}
+		out.set_offset(out.size() + (size_t) len);
+	}
+
+	args.argc = count > 0 ? (size_t) count : 0;
+	return true;
+}
+
+bool redis_client::read_inline(acl::string& out, redis_raw_args& args)
+{
+	if (buff_ == NULL) {
+		buff_ = new acl::string(256);
+	}
+
+	const std::vector<acl::string>* tokens;
+	do {
+		buff_->clear();
+		if (!conn_.gets(*buff_)) {
+			logger_error("gets line from client error!");
+			return false;
+		}
+
+		if (buff_->begin_with("quit", false)) {
+			conn_.format("+OK\r\n");
+			return false;
+		}
+
+		// The empty line gets no reply from redis, just skip it.
+		tokens = &(buff_->split2(" \t"));
+	} while (tokens->empty());
+
+	out.format("*%d\r\n", (int) tokens->size());
+
+	size_t i = 0;
+	for (std::vector<acl::string>::const_iterator cit = tokens->begin();
+		cit != tokens->end(); ++cit, ++i) {
+
+		out.format_append("$%d\r\n", (int) (*cit).size());
+		if (i < 2) {
+			args.offs[i] = out.size();
+			args.lens[i] = (*cit).size();
+		}
+		out.append((*cit).c_str(), (*cit).size());
+		out.append("\r\n");
+	}
+
+	args.argc = tokens->size();
+	return true;
+}
+
 bool redis_client::read_request(acl::dbuf_pool& dbuf,
 	std::vector<const redis_object*>& out)
 {
@@ -2,6 +2,13 @@
 
 class redis_object;
 
+// The first two arguments of one raw request, which are used for routing.
+struct redis_raw_args {
+	size_t argc;
+	size_t offs[2];	// The offsets of the arguments in the request
+	size_t lens[2];
+};
+
 class redis_client {
 public:
 	redis_client(acl::socket_stream& conn);
@@ -15,6 +22,10 @@ public:
 	bool read_request(acl::dbuf_pool& dbuf,
 		std::vector<const redis_object*>& out);
 
+	// Read one request into out without parsing it into the objects, the
+	// inline command will be converted into RESP.
+	bool read_raw(acl::string& out, redis_raw_args& args);
+
 private:
 	acl::socket_stream& conn_;
 	acl::sslbase_conf* ssl_conf_;
@@ -33,4 +44,5 @@ private:
 		acl::dbuf_pool* dbuf, size_t nobjs);
 
 	redis_object* get_line(acl::socket_stream& conn, acl::dbuf_pool* dbuf);
+	bool read_inline(acl::string& out, redis_raw_args& args);
 };
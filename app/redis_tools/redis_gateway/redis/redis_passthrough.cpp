@@ -0,0 +1,115 @@
+#include "stdafx.h"
+#include "redis_client.h"
+#include "redis_transfer.h"
+#include "redis_passthrough.h"
+
+struct redis_raw_cmd {
+	acl::string req;
+	acl::string reply;
+	acl::redis_pipeline_message* msg;
+	bool forwarded;
+};
+
+redis_passthrough::redis_passthrough(redis_client& client,
+	acl::socket_stream& conn, acl::redis_client_pipeline& pipeline)
+: client_(client)
+, conn_(conn)
+, pipeline_(pipeline)
+, gbuf_(64)
+{
+}
+
+redis_passthrough::~redis_passthrough(void) {
+	for (std::vector<redis_raw_cmd*>::iterator it = cmds_.begin();
+		it != cmds_.end(); ++it) {
+
+		(*it)->msg->unrefer();
+		delete *it;
+	}
+}
+
+redis_raw_cmd* redis_passthrough::get_cmd(size_t i) {
+	if (i < cmds_.size()) {
+		return cmds_[i];
+	}
+
+	redis_raw_cmd* cmd = new redis_raw_cmd;
+	cmd->msg = new acl::redis_pipeline_message(acl::redis_pipeline_t_cmd,
+		pipeline_.create_box());
+	cmd->msg->refer();
+	cmd->forwarded = false;
+	cmds_.push_back(cmd);
+	return cmd;
+}
+
+bool redis_passthrough::run(void) {
+	ACL_VSTREAM* fp = conn_.get_vstream();
+	bool ok = true;
+	size_t n = 0;
+
+	// Read and forward the commands until the reading buffer is empty,
+	// so the pipelined commands of the client are sent in one batch.
+	do {
+		redis_raw_cmd* cmd = get_cmd(n);
+		if (!forward(*cmd)) {
+			ok = false;
+			break;
+		}
+		n++;
+	} while (fp->read_cnt > 0);
+
+	gbuf_.clear();
+
+	// All the commands forwarded must be waited for before returning,
+	// because the messages will be reused.
+	for (size_t i = 0; i < n; i++) {
+		redis_raw_cmd* cmd = cmds_[i];
+		if (cmd->forwarded && !cmd->msg->wait_raw()) {
+			// Keep the order of the replies for the client.
+			cmd->reply = "-ERR no reply from redis\r\n";
+		}
+		gbuf_.add(cmd->reply);
+	}
+
+	if (!ok) {
+		return false;
+	}
+
+	if (conn_.sendv(gbuf_) == -1) {
+		logger("Reply client error!");
+		return false;
+	}
+	return true;
+}
+
+#define	EQ(x, y) (sizeof(y) - 1 == x##_len && !strncasecmp(x, y, sizeof(y) - 1))
+
+bool redis_passthrough::forward(redis_raw_cmd& cmd) {
+	redis_raw_args args;
+
+	cmd.forwarded = false;
+	if (!client_.read_raw(cmd.req, args)) {
+		return false;
+	}
+
+	int slot = -1;
+	if (args.argc >= 2) {
+		const char* name = cmd.req.c_str() + args.offs[0];
+		size_t name_len  = args.lens[0];
+		const char* key  = cmd.req.c_str() + args.offs[1];
+		size_t key_len   = args.lens[1];
+
+		if (EQ(name, "CLUSTER") && EQ(key, "SLOTS")) {
+			cmd.reply.clear();
+			redis_transfer::build_slots(cmd.reply);
+			return true;
+		}
+
+		slot = pipeline_.hash_slot(key, key_len);
+	}
+
+	cmd.msg->set_raw(&cmd.req, slot, &cmd.reply);
+	cmd.forwarded = true;
+	pipeline_.push(cmd.msg);
+	return true;
+}
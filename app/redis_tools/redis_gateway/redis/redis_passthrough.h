@@ -0,0 +1,31 @@
+#pragma once
+
+class redis_client;
+struct redis_raw_cmd;
+
+// Forward the commands of one client in the raw mode of the pipeline: the
+// RESP data of each command is sent to redis as it is, and the replies are
+// only framed and written back to the client in order without being parsed
+// and rebuilt as redis_transfer does.
+class redis_passthrough {
+public:
+	redis_passthrough(redis_client& client, acl::socket_stream& conn,
+		acl::redis_client_pipeline& pipeline);
+
+	~redis_passthrough(void);
+
+	// Read all the commands buffered, forward them and reply the client.
+	bool run(void);
+
+private:
+	redis_client&               client_;
+	acl::socket_stream&         conn_;
+	acl::redis_client_pipeline& pipeline_;
+	acl::gather_buf             gbuf_;
+
+	// The commands are reused for the next batch of the client.
+	std::vector<redis_raw_cmd*> cmds_;
+
+	redis_raw_cmd* get_cmd(size_t i);
+	bool forward(redis_raw_cmd& cmd);
+};
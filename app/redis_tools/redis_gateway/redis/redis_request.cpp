@@ -35,6 +35,9 @@ void redis_request::build_request(const redis_object& obj) {
 	}
 
 	cmd_.build_request(argc_, argv_, lens_);
+
+	// The results will be parsed in the dbuf of the command.
+	cmd_.get_pipeline_message().set_option(cmd_.get_dbuf(), 0, NULL);
 }
 
 void redis_request::add_object(const redis_object& obj) {
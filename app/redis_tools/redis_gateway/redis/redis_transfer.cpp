@@ -164,7 +164,17 @@ bool redis_transfer::reply_add_error(const acl::redis_result& obj,
 
 bool redis_transfer::redirect2me(void) {
 	acl::string buff;
+	build_slots(buff);
 
+	if (conn_.write(buff) == (int) buff.size()) {
+		return true;
+	}
+
+	logger_error("reply to client error");
+	return false;
+}
+
+void redis_transfer::build_slots(acl::string& buff) {
 	buff += "*4\r\n";
 
 	buff += "*3\r\n";
@@ -206,11 +216,4 @@ bool redis_transfer::redirect2me(void) {
 	buff += ":16379\r\n";
 	buff += "$40\r\n";
 	buff += "8c17f9e161196446a9be4aa1c62c5e1518ece030\r\n";
-
-	if (conn_.write(buff) == (int) buff.size()) {
-		return true;
-	}
-
-	logger_error("reply to client error");
-	return false;
 }
@@ -12,6 +12,10 @@ public:
 
 	bool run(const std::vector<const redis_object*>& reqs);
 
+	// Build the reply of CLUSTER SLOTS which redirects all the slots to
+	// the gateway itself.
+	static void build_slots(acl::string& buff);
+
 private:
 	acl::dbuf_guard&            dbuf_;
 	acl::socket_stream&         conn_;
@@ -149,6 +149,8 @@ struct ACL_ASTREAM {
 #define ACL_AIO_FLAG_DELAY_CLOSE    (1 << 3) /* Ƿʱر״̬ */
 #define ACL_AIO_FLAG_DEAD           (1 << 4) /* ׽ǷѾ */
 #define	ACL_AIO_FLAG_FLUSH_CLOSE    (1 << 5) /* ǷҪݺŹر */
+#define	ACL_AIO_FLAG_READ_HOOKING   (1 << 6) /* read hooks are being called */
+#define	ACL_AIO_FLAG_WRITE_HOOKING  (1 << 7) /* write hooks are being called */
 
 	ACL_FIFO write_fifo;	/**< 첽дʱȽȳ */
 	int   write_left;	/**< дδд */
@@ -26,6 +26,36 @@ ACL_API unsigned char *acl_base64_encode(const char *plain_in, int len);
  */
 ACL_API int acl_base64_decode(const char *code_in, char **ppresult);
 
+/**
+ * The buffer size needed by acl_base64_encode_buf/acl_base64_decode_buf,
+ * including the tailing '\0'
+ * @param n {size_t} the length of the data to be encoded or decoded
+ */
+#define ACL_BASE64_ENCODE_SIZE(n)	(4 * (((size_t) (n) + 2) / 3) + 1)
+#define ACL_BASE64_DECODE_SIZE(n)	(3 * ((size_t) (n) / 4) + 1)
+
+/**
+ * BASE64 encode into the buffer given by the caller, the SIMD kernel will
+ * be used if the CPU supports it
+ * @param in {const void*} the source data
+ * @param len {size_t} the length of in
+ * @param out {char*} hold the result, its size must be at least
+ *  ACL_BASE64_ENCODE_SIZE(len)
+ * @return {size_t} the length of the result, which is terminated with '\0'
+ */
+ACL_API size_t acl_base64_encode_buf(const void *in, size_t len, char *out);
+
+/**
+ * BASE64 decode into the buffer given by the caller, same as
+ * acl_base64_decode except that no memory is allocated
+ * @param in {const char*} the BASE64 encoded data
+ * @param len {size_t} the length of in
+ * @param out {void*} hold the result, its size must be at least
+ *  ACL_BASE64_DECODE_SIZE(len)
+ * @return {int} the length of the result, or -1 if the data is invalid
+ */
+ACL_API int acl_base64_decode_buf(const char *in, size_t len, void *out);
+
 
 #ifdef  __cplusplus
 }
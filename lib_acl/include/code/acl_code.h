@@ -5,6 +5,7 @@
 extern "C" {
 # endif
 
+#include "acl_codec_simd.h"
 #include "acl_base64.h"
 #include "acl_vstring_base64.h"
 #include "acl_urlcode.h"
@@ -0,0 +1,44 @@
+#ifndef ACL_CODEC_SIMD_INCLUDE_H
+#define ACL_CODEC_SIMD_INCLUDE_H
+
+#ifdef  __cplusplus
+extern "C" {
+#endif
+
+#include "../stdlib/acl_define.h"
+
+/**
+ * The SIMD instruction set levels used by the base64/hex/url codecs, the
+ * best level supported by the current CPU is selected at runtime.
+ */
+#define ACL_CODEC_SIMD_NONE	0	/* scalar table loops only */
+#define ACL_CODEC_SIMD_SSSE3	1	/* SSE2/SSSE3 128 bits kernels */
+#define ACL_CODEC_SIMD_AVX2	2	/* AVX2 256 bits kernels */
+
+/**
+ * Get the SIMD level currently used by the codecs
+ * @return {int} one of ACL_CODEC_SIMD_XXX
+ */
+ACL_API int acl_codec_simd_level(void);
+
+/**
+ * Get the name of the given SIMD level
+ * @param level {int} one of ACL_CODEC_SIMD_XXX
+ * @return {const char*} "scalar", "ssse3" or "avx2"
+ */
+ACL_API const char *acl_codec_simd_name(int level);
+
+/**
+ * Limit the highest SIMD level the codecs may use, which is mainly used
+ * for testing or benchmarking the different kernels; the level actually
+ * used is also limited by what the current CPU supports.
+ * @param level {int} one of ACL_CODEC_SIMD_XXX
+ * @return {int} the level actually used after this call
+ */
+ACL_API int acl_codec_simd_limit(int level);
+
+#ifdef  __cplusplus
+}
+#endif
+
+#endif
@@ -26,6 +26,34 @@ ACL_API char *acl_url_encode(const char *str, ACL_DBUF_POOL *dbuf);
  */
 ACL_API char *acl_url_decode(const char *str, ACL_DBUF_POOL *dbuf);
 
+/**
+ * Get the length of the data after being url encoded
+ * @param str {const char*} the source data
+ * @param len {size_t} the length of str
+ * @return {size_t} the length of the encoded data, not including '\0'
+ */
+ACL_API size_t acl_url_encode_size(const char *str, size_t len);
+
+/**
+ * URL encode into the buffer given by the caller, the runs of chars which
+ * needn't be escaped are scanned with SIMD if the CPU supports it
+ * @param str {const char*} the source data
+ * @param len {size_t} the length of str
+ * @param out {char*} hold the result, its size must be at least
+ *  acl_url_encode_size(str, len) + 1, or len * 3 + 1 for the worst case
+ * @return {size_t} the length of the result, which is terminated with '\0'
+ */
+ACL_API size_t acl_url_encode_buf(const char *str, size_t len, char *out);
+
+/**
+ * URL decode into the buffer given by the caller
+ * @param str {const char*} the url encoded data
+ * @param len {size_t} the length of str
+ * @param out {char*} hold the result, its size must be at least len + 1
+ * @return {size_t} the length of the result, which is terminated with '\0'
+ */
+ACL_API size_t acl_url_decode_buf(const char *str, size_t len, char *out);
+
 #ifdef __cplusplus
 }
 #endif
@@ -10,6 +10,7 @@
 #include "../ioctl/acl_ioctl.h"
 #include "../aio/acl_aio.h"
 #include "../event/acl_events.h"
+#include "../net/acl_sane_inet.h"
 
 #ifndef ACL_CLIENT_ONLY
 
@@ -50,6 +51,7 @@ extern "C" {
 #define ACL_MASTER_SERVER_ON_BIND		ACL_MASTER_SERVER_ON_LISTEN
 #define ACL_MASTER_SERVER_SIGHUP		29
 #define ACL_MASTER_SERVER_ON_UNBIND		30
+#define ACL_MASTER_SERVER_ON_BATCH		31
 
 #define	ACL_APP_CTL_END			ACL_MASTER_SERVER_END
 #define	ACL_APP_CTL_CFG_INT		ACL_MASTER_SERVER_INT_TABLE
@@ -164,6 +166,30 @@ ACL_API void acl_aio_server_on_close(ACL_ASTREAM *stream);
   */
 typedef void (*ACL_UDP_SERVER_FN) (void* ctx, ACL_VSTREAM *);
 
+/**
+ * One datagram in the batch mode of the UDP server. The buffers belong to
+ * the ring preallocated by each server thread and are reused by the next
+ * batch, so they are only valid in the ACL_UDP_SERVER_BATCH_FN callback;
+ * the application may write its reply into buf (no more than size bytes),
+ * set len and pass the same packets to acl_udp_server_send_batch(), which
+ * sends each one back to its peer address.
+ */
+typedef struct ACL_UDP_PKT {
+	char        *buf;		/* the data buffer */
+	size_t       size;		/* the capacity of buf */
+	size_t       len;		/* the length of data in buf */
+	ACL_SOCKADDR peer;		/* the peer address */
+	size_t       peer_len;		/* the length of the peer address */
+} ACL_UDP_PKT;
+
+/**
+ * The batch callback registered with ACL_MASTER_SERVER_ON_BATCH, which is
+ * called with all the datagrams read by one recvmmsg() on the stream, the
+ * max number of datagrams read once is set by udp_batch_count.
+ */
+typedef void (*ACL_UDP_SERVER_BATCH_FN) (void* ctx, ACL_VSTREAM *,
+	ACL_UDP_PKT *pkts, int npkts);
+
 ACL_API const char *acl_udp_server_conf(void);
 ACL_API void acl_udp_server_request_timer(ACL_EVENT_NOTIFY_TIME timer_fn, void *arg,
 	acl_int64 delay, int keep);
@@ -171,6 +197,8 @@ ACL_API void acl_udp_server_cancel_timer(ACL_EVENT_NOTIFY_TIME timer_fn, void *a
 ACL_API void acl_udp_server_main(int, char **, ACL_UDP_SERVER_FN, ...);
 ACL_API ACL_EVENT *acl_udp_server_event(void);
 ACL_API ACL_VSTREAM **acl_udp_server_streams(void);
+ACL_API int acl_udp_server_send_batch(ACL_VSTREAM *stream,
+	const ACL_UDP_PKT *pkts, int npkts);
 
  /*
   * acl_trigger_server.c
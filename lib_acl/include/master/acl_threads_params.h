@@ -43,6 +43,9 @@ extern int   acl_var_threads_schedule_warn;
 extern int   acl_var_threads_schedule_wait;
 extern int   acl_var_threads_check_inter;
 extern int   acl_var_threads_qlen_warn;
+extern int   acl_var_threads_reuseport_threads;
+extern int   acl_var_threads_reuseport_affinity;
+extern int   acl_var_threads_reuseport_cbpf;
 extern char *acl_var_threads_dispatch_addr;
 extern char *acl_var_threads_dispatch_type;
 extern char *acl_var_threads_master_service;
@@ -32,6 +32,7 @@ extern long long int acl_var_udp_core_limit;
 extern char *acl_var_udp_log_debug;
 extern int   acl_var_udp_max_debug;
 extern int   acl_var_udp_threads;
+extern int   acl_var_udp_batch_count;
 extern int   acl_var_udp_threads_detached;
 extern int   acl_var_udp_fatal_on_bind_error;
 extern int   acl_var_udp_monitor_netlink;
@@ -0,0 +1,142 @@
+#ifndef ACL_CHTABLE_INCLUDE_H
+#define ACL_CHTABLE_INCLUDE_H
+
+#ifdef  __cplusplus
+extern "C" {
+#endif
+
+#include "acl_define.h"
+#include "acl_htable.h"		/* for ACL_HTABLE_FLAG_xxx, ACL_HTABLE_STAT_xxx */
+
+/*--------------------------------------------------------------------------*/
+
+/**
+ * The concurrent hash table, which is split into shards, each of which has
+ * its own lock and its own buckets array, so the threads operating on the
+ * keys in different shards don't contend with each other, and growing the
+ * buckets array only happens in one shard with only the shard locked. The
+ * keys are hashed by acl_hash_wyhash, the high bits of which select the
+ * shard and the low bits select the bucket in the shard.
+ */
+typedef struct ACL_CHTABLE ACL_CHTABLE;
+
+/**
+ * Create a concurrent hash table
+ * @param size {int} the initial capacity of the whole table, which will be
+ *  split into the shards
+ * @param nshards {int} the number of shards, which will be rounded up to a
+ *  power of 2, the default 16 will be used if it's <= 0; more shards than
+ *  the concurrent threads keep the contentions low
+ * @param flag {unsigned int} only ACL_HTABLE_FLAG_KEY_LOWER is supported,
+ *  the locks are always used
+ * @return {ACL_CHTABLE*} NULL if failed to allocate
+ */
+ACL_API ACL_CHTABLE *acl_chtable_create(int size, int nshards,
+		unsigned int flag);
+
+/**
+ * Add a new item into the table, the key will be copied
+ * @param table {ACL_CHTABLE*}
+ * @param key {const char*}
+ * @param value {void*} the user's data which can't be on the stack
+ * @param old_holder {void**} when the key exists and this isn't NULL, the
+ *  old value will be replaced by the new one and stored into it, else the
+ *  old value will be kept and the new one won't be added
+ * @return {int} ACL_HTABLE_STAT_OK: the key is new and was added;
+ *  ACL_HTABLE_STAT_DUPLEX_KEY: the key exists;
+ *  ACL_HTABLE_STAT_INVAL: the arguments are invalid
+ */
+ACL_API int acl_chtable_enter(ACL_CHTABLE *table, const char *key,
+		void *value, void **old_holder);
+
+/**
+ * Find the value of the given key
+ * @param table {ACL_CHTABLE*}
+ * @param key {const char*}
+ * @return {void*} NULL if not found; because the other threads may delete
+ *  the item just after returning, the application should take care of the
+ *  lifetime of the value by itself, such as the reference counting
+ */
+ACL_API void *acl_chtable_find(ACL_CHTABLE *table, const char *key);
+
+/**
+ * Delete the item of the given key
+ * @param table {ACL_CHTABLE*}
+ * @param key {const char*}
+ * @param free_fn {void (*)(void*)} if not NULL, it'll be called with the
+ *  value of the item, with the item's shard locked
+ * @return {int} 0: ok; -1: the key wasn't found
+ */
+ACL_API int acl_chtable_delete(ACL_CHTABLE *table, const char *key,
+		void (*free_fn) (void *));
+
+/**
+ * Delete the item of the given key and return its value
+ * @param table {ACL_CHTABLE*}
+ * @param key {const char*}
+ * @return {void*} the value of the deleted item, NULL if not found
+ */
+ACL_API void *acl_chtable_remove(ACL_CHTABLE *table, const char *key);
+
+/**
+ * Free the table and all the items in it
+ * @param table {ACL_CHTABLE*}
+ * @param free_fn {void (*)(void*)} if not NULL, it'll be called with the
+ *  value of each item
+ */
+ACL_API void acl_chtable_free(ACL_CHTABLE *table, void (*free_fn) (void *));
+
+/**
+ * Delete all the items in the table, the shards are reset one by one, so
+ * the items added into the shards having been reset will be kept
+ * @param table {ACL_CHTABLE*}
+ * @param free_fn {void (*)(void*)} if not NULL, it'll be called with the
+ *  value of each item
+ * @return {int} 0: ok; -1: error
+ */
+ACL_API int acl_chtable_reset(ACL_CHTABLE *table, void (*free_fn) (void *));
+
+/**
+ * Walk all the items in the table, one shard is locked at a time, so the
+ * walk_fn mustn't operate on the same table
+ * @param table {ACL_CHTABLE*}
+ * @param walk_fn {void (*)(const char*, void*, void*)} called with the key,
+ *  the value of each item and arg, can't be NULL
+ * @param arg {void*}
+ */
+ACL_API void acl_chtable_walk(ACL_CHTABLE *table,
+		void (*walk_fn) (const char *, void *, void *), void *arg);
+
+/**
+ * Get the total number of buckets of all the shards
+ * @param table {const ACL_CHTABLE*}
+ * @return {int}
+ */
+ACL_API int acl_chtable_size(const ACL_CHTABLE *table);
+
+/**
+ * Get the number of items in the table, the shards are read without being
+ * locked, so it's a snapshot when the table is being changed
+ * @param table {const ACL_CHTABLE*}
+ * @return {int}
+ */
+ACL_API int acl_chtable_used(const ACL_CHTABLE *table);
+
+/**
+ * Get the number of shards
+ * @param table {const ACL_CHTABLE*}
+ * @return {int}
+ */
+ACL_API int acl_chtable_nshards(const ACL_CHTABLE *table);
+
+/**
+ * Show the distribution of the items in the shards and buckets
+ * @param table {const ACL_CHTABLE*}
+ */
+ACL_API void acl_chtable_stat(const ACL_CHTABLE *table);
+
+#ifdef  __cplusplus
+}
+#endif
+
+#endif
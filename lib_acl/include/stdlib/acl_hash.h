@@ -26,6 +26,26 @@ ACL_API unsigned acl_hash_func4(const void *buf, size_t len);
 ACL_API unsigned acl_hash_func5(const void *buf, size_t len);
 ACL_API unsigned acl_hash_func6(const void *buf, size_t len);
 
+/**
+ * The 64 bits wyhash, which reads 8 or 16 bytes per step and is much faster
+ * than the byte-at-a-time functions above on keys longer than a few bytes,
+ * and has much better distribution in the low bits.
+ * @param buf {const void*} the data to be hashed
+ * @param len {size_t} the length of buf
+ * @param seed {acl_uint64} the seed, different seeds give different hashes
+ * @return {acl_uint64}
+ */
+ACL_API acl_uint64 acl_hash_wyhash(const void *buf, size_t len, acl_uint64 seed);
+
+/**
+ * The ACL_HASH_FN compatible version of acl_hash_wyhash with seed 0, which
+ * can be set to ACL_HTABLE by ACL_HTABLE_CTL_HASH_FN.
+ * @param buf {const void*} the data to be hashed
+ * @param len {size_t} the length of buf
+ * @return {unsigned}
+ */
+ACL_API unsigned acl_hash_wy(const void *buf, size_t len);
+
 #ifdef	__cplusplus
 }
 #endif
@@ -17,6 +17,19 @@ extern "C" {
  */
 ACL_API ACL_VSTRING *acl_hex_encode(ACL_VSTRING *buf, const char *ptr, int len);
 
+/**
+ * Hex encode into the buffer given by the caller, the SIMD kernel will be
+ * used if the CPU supports it
+ * @param in {const void*} the binary data
+ * @param len {size_t} the length of in
+ * @param out {char*} hold the result, its size must be at least len * 2 + 1
+ * @param lowercase {int} use "0-9a-f" if not 0, else use "0-9A-F" as
+ *  acl_hex_encode does
+ * @return {size_t} the length of the result, which is terminated with '\0'
+ */
+ACL_API size_t acl_hex_encode_buf(const void *in, size_t len, char *out,
+	int lowercase);
+
 /**
  * ݽн
  * @param buf {ACL_VSTRING*} 洢ת
@@ -42,6 +42,11 @@ struct ACL_HTABLE {
 	void *(*iter_prev)(ACL_ITER*, struct ACL_HTABLE*);
 	/* ȡĵǰԱṹ */
 	ACL_HTABLE_INFO *(*iter_info)(ACL_ITER*, struct ACL_HTABLE*);
+
+	/* for the incremental rehashing, see ACL_HTABLE_FLAG_INCR_REHASH */
+	ACL_HTABLE_INFO **rehash_data;  /* the old entries array being moved */
+	int     rehash_size;            /* length of the old entries array */
+	int     rehash_idx;             /* the next old bucket to be moved */
 };
 
 /**
@@ -94,6 +99,16 @@ ACL_API ACL_HTABLE *acl_htable_create(int size, unsigned int flag);
 /* ͳһתΪСдӶʵּѯִСдĹ */
 #define	ACL_HTABLE_FLAG_KEY_LOWER	(1 << 3)
 
+/* Grow the entries array incrementally: when the table is full, a doubled
+ * array is allocated, and a few buckets of the old one are moved into it in
+ * each adding or deleting, the lookups check both arrays until all of the
+ * old buckets have been moved, so there's no stall of moving all entries
+ * at once in a big table. Iterating the table, acl_htable_iter_head(),
+ * acl_htable_iter_tail(), acl_htable_data() and acl_foreach will finish
+ * the moving first.
+ */
+#define	ACL_HTABLE_FLAG_INCR_REHASH	(1 << 4)
+
 ACL_API ACL_HTABLE *acl_htable_create3(int size, unsigned int flag,
 		ACL_SLICE_POOL *slice);
 
@@ -45,6 +45,20 @@ ACL_API int acl_mbox_send(ACL_MBOX *mbox, void *msg);
  */
 ACL_API void *acl_mbox_read(ACL_MBOX *mbox, int timeout, int *success);
 
+/**
+ * Read the messages in batch from the mbox, wait as acl_mbox_read() only
+ * when no message is in the mbox, and then take all the messages pending
+ * without waiting again.
+ * @param mbox {ACL_MBOX*}
+ * @param msgs {void**} hold the messages read
+ * @param max {int} the max number of msgs
+ * @param timeout {int} same as in acl_mbox_read()
+ * @param success {int*} same as in acl_mbox_read()
+ * @return {int} the number of the messages read, 0 if timeout or error
+ */
+ACL_API int acl_mbox_read_batch(ACL_MBOX *mbox, void *msgs[], int max,
+	int timeout, int *success);
+
 /**
  * õǰϢѾɹ͵Ϣ
  * @param mbox {ACL_MBOX*} Ϣж
@@ -14,6 +14,7 @@ extern "C" {
 #include "acl_hash.h"
 #include "acl_binhash.h"
 #include "acl_htable.h"
+#include "acl_chtable.h"
 #include "acl_ring.h"
 #include "acl_fifo.h"
 #include "acl_iplink.h"
@@ -130,6 +130,7 @@ struct ACL_VSTREAM {
 
 #define ACL_VSTREAM_FLAG_BIND_IFACE_OK	(1 << 23)	/**< 󶨱ɹ */
 #define ACL_VSTREAM_FLAG_BIND_IP_OK	(1 << 24)	/**< 󶨱 IP ɹ */
+#define ACL_VSTREAM_FLAG_WRITEV_HOOK	(1 << 25)	/**< writev_fn hooked with write_fn */
 
 /* ú뼶ʱ */
 #define ACL_VSTREAM_SET_MS(x)	((x)->flag |= ACL_VSTREAM_FLAG_MS)
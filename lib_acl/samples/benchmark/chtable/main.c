@@ -0,0 +1,194 @@
+#include "lib_acl.h"
+#include "../stamp.h"
+
+/* Run the same mixed find/enter/delete load in multiple threads against
+ * acl_htable with ACL_HTABLE_FLAG_USE_LOCK, which has one lock for the whole
+ * table, and against acl_chtable, which has one lock for each shard.
+ */
+
+static int    __nthreads = 4;
+static int    __nkeys    = 100000;
+static int    __max      = 1000000;
+static int    __nshards  = 0;
+static int    __write_pct = 10;
+static char **__keys     = NULL;
+
+static ACL_HTABLE  *__htable  = NULL;
+static ACL_CHTABLE *__chtable = NULL;
+
+static void *htable_thread(void *ctx)
+{
+	unsigned seed = (unsigned) (long) ctx;
+	int i;
+
+	for (i = 0; i < __max; i++) {
+		int n = (int) (((seed = seed * 1103515245 + 12345) >> 8)
+				% (unsigned) __nkeys);
+		const char *key = __keys[n];
+
+		if ((int) (seed % 100) >= __write_pct) {
+			(void) acl_htable_find_r(__htable, key);
+		} else if (seed & 0x100) {
+			(void) acl_htable_enter_r(__htable, key, __keys[n]);
+		} else {
+			(void) acl_htable_delete_r(__htable, key, NULL);
+		}
+	}
+
+	return NULL;
+}
+
+static void *chtable_thread(void *ctx)
+{
+	unsigned seed = (unsigned) (long) ctx;
+	int i;
+
+	for (i = 0; i < __max; i++) {
+		int n = (int) (((seed = seed * 1103515245 + 12345) >> 8)
+				% (unsigned) __nkeys);
+		const char *key = __keys[n];
+
+		if ((int) (seed % 100) >= __write_pct) {
+			(void) acl_chtable_find(__chtable, key);
+		} else if (seed & 0x100) {
+			(void) acl_chtable_enter(__chtable, key, __keys[n], NULL);
+		} else {
+			(void) acl_chtable_delete(__chtable, key, NULL);
+		}
+	}
+
+	return NULL;
+}
+
+static void bench(const char *name, void *(*fn)(void *))
+{
+	acl_pthread_t *tids = (acl_pthread_t *)
+		acl_mycalloc(__nthreads, sizeof(acl_pthread_t));
+	struct timeval begin, end;
+	double spent;
+	int i;
+
+	gettimeofday(&begin, NULL);
+	for (i = 0; i < __nthreads; i++) {
+		acl_pthread_create(&tids[i], NULL, fn, (void *) (long) (i + 1));
+	}
+	for (i = 0; i < __nthreads; i++) {
+		acl_pthread_join(tids[i], NULL);
+	}
+	gettimeofday(&end, NULL);
+
+	spent = stamp_sub(&end, &begin);
+	printf("%-8s threads=%d, ops=%lld, spent=%.2f ms, speed=%.2f Mops\r\n",
+		name, __nthreads, (long long) __max * __nthreads, spent,
+		((double) __max * __nthreads) / (spent > 0.001 ? spent : 0.001)
+			/ 1000.0);
+
+	acl_myfree(tids);
+}
+
+static void check(void)
+{
+	int i;
+
+	/* the tables have got the same operations, but the order among the
+	 * threads differs, so only check what's in chtable is right.
+	 */
+	for (i = 0; i < __nkeys; i++) {
+		const char *value = (const char *)
+			acl_chtable_find(__chtable, __keys[i]);
+
+		if (value != NULL && value != __keys[i]) {
+			printf("invalid value of %s\r\n", __keys[i]);
+			exit (1);
+		}
+	}
+}
+
+static void usage(const char *procname)
+{
+	printf("usage: %s -h [help]\r\n"
+		" -c threads[default: 4]\r\n"
+		" -k keys[default: 100000]\r\n"
+		" -n ops_per_thread[default: 1000000]\r\n"
+		" -s shards[default: 16]\r\n"
+		" -w percent_of_writing[default: 10]\r\n"
+		" -S [show the distribution of chtable]\r\n", procname);
+}
+
+int main(int argc, char *argv[])
+{
+	int ch, i, show = 0;
+
+	while ((ch = getopt(argc, argv, "hc:k:n:s:w:S")) > 0) {
+		switch (ch) {
+		case 'h':
+			usage(argv[0]);
+			return 0;
+		case 'c':
+			__nthreads = atoi(optarg);
+			break;
+		case 'k':
+			__nkeys = atoi(optarg);
+			break;
+		case 'n':
+			__max = atoi(optarg);
+			break;
+		case 's':
+			__nshards = atoi(optarg);
+			break;
+		case 'w':
+			__write_pct = atoi(optarg);
+			break;
+		case 'S':
+			show = 1;
+			break;
+		default:
+			usage(argv[0]);
+			return 0;
+		}
+	}
+
+	if (__nthreads <= 0) {
+		__nthreads = 1;
+	}
+	if (__nkeys <= 0) {
+		__nkeys = 100000;
+	}
+
+	__keys = (char **) acl_mycalloc(__nkeys, sizeof(char *));
+	for (i = 0; i < __nkeys; i++) {
+		char buf[64];
+
+		snprintf(buf, sizeof(buf), "user:session:%d", i);
+		__keys[i] = acl_mystrdup(buf);
+	}
+
+	__htable  = acl_htable_create(1024, ACL_HTABLE_FLAG_USE_LOCK);
+	__chtable = acl_chtable_create(1024, __nshards, 0);
+
+	/* half of the keys are loaded before running */
+	for (i = 0; i < __nkeys; i += 2) {
+		acl_htable_enter(__htable, __keys[i], __keys[i]);
+		acl_chtable_enter(__chtable, __keys[i], __keys[i], NULL);
+	}
+
+	bench("htable", htable_thread);
+	bench("chtable", chtable_thread);
+	check();
+
+	if (show) {
+		acl_chtable_stat(__chtable);
+	}
+
+	printf("htable used=%d, chtable used=%d, shards=%d\r\n",
+		acl_htable_used(__htable), acl_chtable_used(__chtable),
+		acl_chtable_nshards(__chtable));
+
+	acl_htable_free(__htable, NULL);
+	acl_chtable_free(__chtable, NULL);
+	for (i = 0; i < __nkeys; i++) {
+		acl_myfree(__keys[i]);
+	}
+	acl_myfree(__keys);
+	return 0;
+}
@@ -0,0 +1,186 @@
+#include "lib_acl.h"
+#include "../stamp.h"
+
+/* the result of every codec running with the scalar loops, which is used
+ * to check the results of the SIMD kernels.
+ */
+typedef struct {
+	char  *b64;
+	size_t b64_len;
+	char  *hex;
+	char  *url;
+	size_t url_len;
+} REFERENCE;
+
+static int __max = 1000;
+
+static void report(const char *name, int level, size_t len, double spent)
+{
+	double bytes = (double) len * __max;
+	double gbps  = bytes / (spent >= 0.001 ? spent : 0.001) / 1000000.0;
+
+	printf("%-16s %-8s size=%ld, loop=%d, spent=%.2f ms, speed=%.3f GB/s\r\n",
+		name, acl_codec_simd_name(level), (long) len, __max, spent, gbps);
+}
+
+static void check(const char *name, const char *s1, const char *s2, size_t n)
+{
+	if (memcmp(s1, s2, n) != 0) {
+		printf("%s: result differs from the scalar one!\r\n", name);
+		exit (1);
+	}
+}
+
+static void bench(int level, const char *data, size_t len,
+	const char *text, size_t tlen, REFERENCE *ref)
+{
+	char *b64 = (char*) acl_mymalloc(ACL_BASE64_ENCODE_SIZE(len));
+	char *raw = (char*) acl_mymalloc(ACL_BASE64_DECODE_SIZE(
+			ACL_BASE64_ENCODE_SIZE(len)));
+	char *hex = (char*) acl_mymalloc(len * 2 + 1);
+	char *url = (char*) acl_mymalloc(tlen * 3 + 1);
+	char *dec = (char*) acl_mymalloc(tlen * 3 + 1);
+	struct timeval begin, end;
+	size_t n = 0, ulen = 0;
+	int i, ret = 0;
+
+	acl_codec_simd_limit(level);
+
+	gettimeofday(&begin, NULL);
+	for (i = 0; i < __max; i++) {
+		n = acl_base64_encode_buf(data, len, b64);
+	}
+	gettimeofday(&end, NULL);
+	report("base64_encode", level, len, stamp_sub(&end, &begin));
+
+	gettimeofday(&begin, NULL);
+	for (i = 0; i < __max; i++) {
+		ret = acl_base64_decode_buf(b64, n, raw);
+	}
+	gettimeofday(&end, NULL);
+	report("base64_decode", level, n, stamp_sub(&end, &begin));
+
+	if (ret != (int) len || memcmp(raw, data, len) != 0) {
+		printf("base64 decode error, ret=%d, len=%ld\r\n", ret, (long) len);
+		exit (1);
+	}
+
+	gettimeofday(&begin, NULL);
+	for (i = 0; i < __max; i++) {
+		(void) acl_hex_encode_buf(data, len, hex, 1);
+	}
+	gettimeofday(&end, NULL);
+	report("hex_encode", level, len, stamp_sub(&end, &begin));
+
+	gettimeofday(&begin, NULL);
+	for (i = 0; i < __max; i++) {
+		ulen = acl_url_encode_buf(text, tlen, url);
+	}
+	gettimeofday(&end, NULL);
+	report("url_encode", level, tlen, stamp_sub(&end, &begin));
+
+	gettimeofday(&begin, NULL);
+	for (i = 0; i < __max; i++) {
+		n = acl_url_decode_buf(url, ulen, dec);
+	}
+	gettimeofday(&end, NULL);
+	report("url_decode", level, ulen, stamp_sub(&end, &begin));
+
+	if (n != tlen || memcmp(dec, text, tlen) != 0) {
+		printf("url decode error, n=%ld, len=%ld\r\n", (long) n, (long) tlen);
+		exit (1);
+	}
+
+	if (ref->b64 == NULL) {
+		ref->b64     = acl_mystrdup(b64);
+		ref->b64_len = strlen(b64);
+		ref->hex     = acl_mystrdup(hex);
+		ref->url     = acl_mystrdup(url);
+		ref->url_len = ulen;
+	} else {
+		check("base64_encode", ref->b64, b64, ref->b64_len + 1);
+		check("hex_encode", ref->hex, hex, len * 2 + 1);
+		check("url_encode", ref->url, url, ref->url_len + 1);
+	}
+
+	printf("\r\n");
+
+	acl_myfree(b64);
+	acl_myfree(raw);
+	acl_myfree(hex);
+	acl_myfree(url);
+	acl_myfree(dec);
+}
+
+static void usage(const char *procname)
+{
+	printf("usage: %s -h [help]\r\n"
+		" -s data_size[default: 4096]\r\n"
+		" -n max_loop[default: 1000]\r\n"
+		" -p percent_of_chars_to_be_url_escaped[default: 10]\r\n"
+		, procname);
+}
+
+int main(int argc, char *argv[])
+{
+	static const char safe[] = "abcdefghijklmnopqrstuvwxyz"
+		"ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789-_.";
+	static const char escape[] = " /?&=+%:#\"";
+	REFERENCE ref;
+	size_t size = 4096, i;
+	int ch, level, best, percent = 10;
+	char *data, *text;
+
+	while ((ch = getopt(argc, argv, "hs:n:p:")) > 0) {
+		switch (ch) {
+		case 'h':
+			usage(argv[0]);
+			return 0;
+		case 's':
+			size = (size_t) atol(optarg);
+			break;
+		case 'n':
+			__max = atoi(optarg);
+			break;
+		case 'p':
+			percent = atoi(optarg);
+			break;
+		default:
+			usage(argv[0]);
+			return 0;
+		}
+	}
+
+	if (size == 0) {
+		size = 1;
+	}
+
+	/* random binary data for base64/hex, and text for url coder */
+	data = (char*) acl_mymalloc(size);
+	text = (char*) acl_mymalloc(size + 1);
+	srand((unsigned) time(NULL));
+	for (i = 0; i < size; i++) {
+		data[i] = (char) rand();
+		if (rand() % 100 < percent) {
+			text[i] = escape[rand() % (sizeof(escape) - 1)];
+		} else {
+			text[i] = safe[rand() % (sizeof(safe) - 1)];
+		}
+	}
+	text[size] = 0;
+
+	memset(&ref, 0, sizeof(ref));
+	best = acl_codec_simd_level();
+	printf("best simd level: %s\r\n\r\n", acl_codec_simd_name(best));
+
+	for (level = ACL_CODEC_SIMD_NONE; level <= best; level++) {
+		bench(level, data, size, text, size, &ref);
+	}
+
+	acl_myfree(ref.b64);
+	acl_myfree(ref.hex);
+	acl_myfree(ref.url);
+	acl_myfree(data);
+	acl_myfree(text);
+	return 0;
+}
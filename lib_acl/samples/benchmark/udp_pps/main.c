@@ -0,0 +1,266 @@
+#include "lib_acl.h"
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#ifdef ACL_LINUX
+# include <sys/syscall.h>
+# if defined(SYS_recvmmsg) && defined(SYS_sendmmsg)
+#  define HAS_MMSG
+# endif
+#endif
+
+/* Run acl_udp_server in alone mode, and flood it by the sender threads in
+ * the same process, to compare the packets per second of the one datagram
+ * per callback mode with the batch mode reading by recvmmsg.
+ */
+
+#define	SEND_BATCH	64
+
+static char  __addr[256];
+static int   __seconds   = 5;
+static int   __nsenders  = 1;
+static int   __pkt_len   = 64;
+static int   __echo      = 0;
+static int   __batch     = 0;
+static int   __stop      = 0;
+static int   __elapsed   = 0;
+
+static long long   __nread  = 0;
+static long long   __ncalls = 0;
+static long long   __nsent  = 0;
+static ACL_ATOMIC *__nread_atomic;
+static ACL_ATOMIC *__ncalls_atomic;
+static ACL_ATOMIC *__nsent_atomic;
+
+static void service_main(void *ctx acl_unused, ACL_VSTREAM *stream)
+{
+	char buf[4096];
+	int  ret = acl_vstream_read(stream, buf, sizeof(buf));
+
+	acl_atomic_int64_add_fetch(__ncalls_atomic, 1);
+	if (ret <= 0) {
+		return;
+	}
+
+	acl_atomic_int64_add_fetch(__nread_atomic, 1);
+	if (__echo) {
+		(void) acl_vstream_write(stream, buf, ret);
+	}
+}
+
+static void service_batch(void *ctx acl_unused, ACL_VSTREAM *stream,
+	ACL_UDP_PKT *pkts, int npkts)
+{
+	acl_atomic_int64_add_fetch(__ncalls_atomic, 1);
+	acl_atomic_int64_add_fetch(__nread_atomic, npkts);
+
+	if (__echo) {
+		(void) acl_udp_server_send_batch(stream, pkts, npkts);
+	}
+}
+
+static ACL_SOCKET sender_open(void)
+{
+	char buf[256], *port;
+	struct sockaddr_in sa;
+	ACL_SOCKET fd;
+
+	snprintf(buf, sizeof(buf), "%s", __addr);
+	if ((port = strrchr(buf, ':')) == NULL
+		&& (port = strrchr(buf, '|')) == NULL) {
+
+		printf("invalid addr: %s\r\n", __addr);
+		exit (1);
+	}
+	*port++ = 0;
+
+	memset(&sa, 0, sizeof(sa));
+	sa.sin_family      = AF_INET;
+	sa.sin_port        = htons((unsigned short) atoi(port));
+	sa.sin_addr.s_addr = inet_addr(buf);
+
+	fd = socket(AF_INET, SOCK_DGRAM, 0);
+	if (fd == ACL_SOCKET_INVALID) {
+		printf("create socket error %s\r\n", acl_last_serror());
+		exit (1);
+	}
+
+	if (connect(fd, (struct sockaddr *) &sa, sizeof(sa)) < 0) {
+		printf("connect %s error %s\r\n", __addr, acl_last_serror());
+		exit (1);
+	}
+
+	return fd;
+}
+
+static void *sender_thread(void *ctx acl_unused)
+{
+	ACL_SOCKET fd = sender_open();
+	char *data = (char *) acl_mycalloc(1, __pkt_len);
+	int   n;
+#ifdef HAS_MMSG
+	struct mmsghdr msgs[SEND_BATCH];
+	struct iovec   iov;
+	int i;
+
+	iov.iov_base = data;
+	iov.iov_len  = __pkt_len;
+	memset(msgs, 0, sizeof(msgs));
+	for (i = 0; i < SEND_BATCH; i++) {
+		msgs[i].msg_hdr.msg_iov    = &iov;
+		msgs[i].msg_hdr.msg_iovlen = 1;
+	}
+#endif
+
+	while (!__stop) {
+#ifdef HAS_MMSG
+		n = sendmmsg(fd, msgs, SEND_BATCH, 0);
+#else
+		n = send(fd, data, __pkt_len, 0) < 0 ? -1 : 1;
+#endif
+		if (n > 0) {
+			acl_atomic_int64_add_fetch(__nsent_atomic, n);
+		} else if (acl_last_error() != ACL_EAGAIN
+			&& acl_last_error() != ACL_ENOBUFS
+			&& acl_last_error() != ECONNREFUSED) {
+
+			printf("send error %s\r\n", acl_last_serror());
+			break;
+		}
+	}
+
+	acl_socket_close(fd);
+	acl_myfree(data);
+	return NULL;
+}
+
+static void report_timer(int type acl_unused, ACL_EVENT *event acl_unused,
+	void *ctx acl_unused)
+{
+	static long long last_read = 0, last_calls = 0;
+	long long nread  = acl_atomic_int64_fetch_add(__nread_atomic, 0);
+	long long ncalls = acl_atomic_int64_fetch_add(__ncalls_atomic, 0);
+	long long nsent  = acl_atomic_int64_fetch_add(__nsent_atomic, 0);
+
+	__elapsed++;
+	printf("%s: %d s, pps=%lld, pkts/call=%.2f, read=%lld, sent=%lld\r\n",
+		__batch ? "batch" : "single", __elapsed, nread - last_read,
+		ncalls > last_calls ? (double) (nread - last_read)
+			/ (ncalls - last_calls) : 0.0, nread, nsent);
+
+	last_read  = nread;
+	last_calls = ncalls;
+
+	if (__elapsed < __seconds) {
+		acl_udp_server_request_timer(report_timer, NULL, 1000000, 0);
+		return;
+	}
+
+	__stop = 1;
+	printf("%s: average pps=%lld, loss=%.2f%%\r\n",
+		__batch ? "batch" : "single", nread / __elapsed,
+		nsent > 0 ? (nsent - nread) * 100.0 / nsent : 0.0);
+	exit (0);
+}
+
+static void service_init(void *ctx acl_unused)
+{
+	acl_pthread_attr_t attr;
+	acl_pthread_t tid;
+	int i;
+
+	__nread_atomic  = acl_atomic_new();
+	__ncalls_atomic = acl_atomic_new();
+	__nsent_atomic  = acl_atomic_new();
+	acl_atomic_set(__nread_atomic, &__nread);
+	acl_atomic_set(__ncalls_atomic, &__ncalls);
+	acl_atomic_set(__nsent_atomic, &__nsent);
+
+	acl_pthread_attr_init(&attr);
+	acl_pthread_attr_setdetachstate(&attr, ACL_PTHREAD_CREATE_DETACHED);
+
+	for (i = 0; i < __nsenders; i++) {
+		acl_pthread_create(&tid, &attr, sender_thread, NULL);
+	}
+
+	acl_udp_server_request_timer(report_timer, NULL, 1000000, 0);
+}
+
+static void usage(const char *procname)
+{
+	printf("usage: %s -h [help]\r\n"
+		" -s server_addr[default: 127.0.0.1:8888]\r\n"
+		" -f configure_file[for udp_threads, udp_batch_count, etc.]\r\n"
+		" -b [use batch mode, default: one datagram per callback]\r\n"
+		" -e [echo every datagram back to the sender]\r\n"
+		" -c sender_threads[default: 1]\r\n"
+		" -l datagram_length[default: 64]\r\n"
+		" -t seconds[default: 5]\r\n", procname);
+}
+
+int main(int argc, char *argv[])
+{
+	char *args[7], conf[256];
+	int   ch, n = 0;
+
+	snprintf(__addr, sizeof(__addr), "127.0.0.1:8888");
+	conf[0] = 0;
+
+	while ((ch = getopt(argc, argv, "hs:f:bec:l:t:")) > 0) {
+		switch (ch) {
+		case 'h':
+			usage(argv[0]);
+			return 0;
+		case 's':
+			snprintf(__addr, sizeof(__addr), "%s", optarg);
+			break;
+		case 'f':
+			snprintf(conf, sizeof(conf), "%s", optarg);
+			break;
+		case 'b':
+			__batch = 1;
+			break;
+		case 'e':
+			__echo = 1;
+			break;
+		case 'c':
+			__nsenders = atoi(optarg);
+			break;
+		case 'l':
+			__pkt_len = atoi(optarg);
+			break;
+		case 't':
+			__seconds = atoi(optarg);
+			break;
+		default:
+			usage(argv[0]);
+			return 0;
+		}
+	}
+
+	if (__nsenders <= 0) {
+		__nsenders = 1;
+	}
+	if (__pkt_len <= 0 || __pkt_len > 4096) {
+		__pkt_len = 64;
+	}
+	if (__seconds <= 0) {
+		__seconds = 5;
+	}
+
+	args[n++] = argv[0];
+	args[n++] = "-n";
+	args[n++] = __addr;
+	if (conf[0]) {
+		args[n++] = "-f";
+		args[n++] = conf;
+	}
+	args[n++] = "-r";
+	args[n]   = NULL;
+
+	acl_udp_server_main(n, args, service_main,
+		ACL_MASTER_SERVER_ON_BATCH, __batch ? service_batch : NULL,
+		ACL_MASTER_SERVER_POST_INIT, service_init,
+		0);
+	return 0;
+}
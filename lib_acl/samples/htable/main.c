@@ -8,18 +8,80 @@ static void free_fn(void *arg)
 	acl_myfree(arg);
 }
 
+static double stamp_sub(const struct timeval *from, const struct timeval *sub)
+{
+	return (from->tv_sec - sub->tv_sec) * 1000.0
+		+ (from->tv_usec - sub->tv_usec) / 1000.0;
+}
+
+/* add n entries and show the slowest adding, which is where the entries
+ * array grows, then check all of them can be found and deleted.
+ */
+static void bench(int n, unsigned flag)
+{
+	ACL_HTABLE *htable = acl_htable_create(1, flag);
+	struct timeval begin, end, t1, t2;
+	double max = 0, spent;
+	char  key[128];
+	int   i;
+
+	gettimeofday(&begin, NULL);
+	for (i = 0; i < n; i++) {
+		snprintf(key, sizeof(key), "key:%d", i);
+		gettimeofday(&t1, NULL);
+		acl_htable_enter(htable, key, NULL);
+		gettimeofday(&t2, NULL);
+		spent = stamp_sub(&t2, &t1);
+		if (spent > max) {
+			max = spent;
+		}
+	}
+	gettimeofday(&end, NULL);
+
+	printf("%s: add %d, spent %.2f ms, the slowest adding %.3f ms\n",
+		(flag & ACL_HTABLE_FLAG_INCR_REHASH) ? "incr rehash" : "rehash",
+		n, stamp_sub(&end, &begin), max);
+
+	for (i = 0; i < n; i++) {
+		snprintf(key, sizeof(key), "key:%d", i);
+		if (acl_htable_locate(htable, key) == NULL) {
+			printf("%s not found\n", key);
+			exit (1);
+		}
+	}
+
+	for (i = 0; i < n; i += 2) {
+		snprintf(key, sizeof(key), "key:%d", i);
+		if (acl_htable_delete(htable, key, NULL) != 0) {
+			printf("delete %s error\n", key);
+			exit (1);
+		}
+	}
+
+	if (acl_htable_used(htable) != n / 2) {
+		printf("invalid used: %d, should be %d\n",
+			acl_htable_used(htable), n / 2);
+		exit (1);
+	}
+
+	acl_htable_free(htable, NULL);
+}
+
 static void usage(const char *procname)
 {
-	printf("usage: %s -h[help] -n count -m[use ACL_HTABLE_FLAG_MSLOOK]\n", procname);
+	printf("usage: %s -h[help] -n count -m[use ACL_HTABLE_FLAG_MSLOOK]"
+		" -r[use ACL_HTABLE_FLAG_INCR_REHASH]"
+		" -b[benchmark adding, run with and without -r to compare]\n",
+		procname);
 }
 
 int main(int argc, char *argv[])
 {
 	ACL_HTABLE *htable;
 	char  key[128], *value;
-	int   i, n = 50, ch, flag = 0;
+	int   i, n = 50, ch, flag = 0, benchmark = 0;
 
-	while ((ch = getopt(argc, argv, "hn:m")) > 0) {
+	while ((ch = getopt(argc, argv, "hn:mrb")) > 0) {
 		switch (ch) {
 		case 'h':
 			usage(argv[0]);
@@ -30,11 +92,22 @@ int main(int argc, char *argv[])
 		case 'm':
 			flag |= ACL_HTABLE_FLAG_MSLOOK;
 			break;
+		case 'r':
+			flag |= ACL_HTABLE_FLAG_INCR_REHASH;
+			break;
+		case 'b':
+			benchmark = 1;
+			break;
 		default:
 			break;
 		}
 	}
 
+	if (benchmark) {
+		bench(n, flag);
+		return (0);
+	}
+
 	htable = acl_htable_create(1, flag);
 
 	for (i = 0; i < n; i++) {
@@ -55,4 +128,3 @@ int main(int argc, char *argv[])
 	acl_htable_free(htable, free_fn);
 	return (0);
 }
-
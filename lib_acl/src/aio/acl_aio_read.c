@@ -80,6 +80,8 @@ static void main_read_callback(int event_type, ACL_EVENT *event acl_unused,
 static int read_complete_callback(ACL_ASTREAM *astream, char *data, int len)
 {
 	int   ret = 0;
+	/* the nested call mustn't clear the flag set by the outer one */
+	int   hooking = astream->flag & ACL_AIO_FLAG_READ_HOOKING;
 
 	/* 뽫λһζ¼(ݻ)ʱ
 	 * Ϊ if (astream->count <= n) {}  fatal
@@ -108,6 +110,11 @@ static int read_complete_callback(ACL_ASTREAM *astream, char *data, int len)
 			astream->reader_fifo.push_back(&astream->reader_fifo, handle);
 		}
 
+		/* acl_aio_clean_read_hooks() only disables the hooks
+		 * being walked through below instead of freeing them
+		 */
+		astream->flag |= ACL_AIO_FLAG_READ_HOOKING;
+
 		acl_foreach_reverse(iter, &astream->reader_fifo) {
 			handle = (AIO_READ_HOOK*) iter.data;
 			if (handle->disable) {
@@ -115,10 +122,13 @@ static int read_complete_callback(ACL_ASTREAM *astream, char *data, int len)
 			}
 			ret = handle->callback(astream, handle->ctx, data, len);
 			if (ret != 0) {
-				astream->nrefer--;
-				return ret;
+				break;
 			}
 		}
+
+		if (!hooking) {
+			astream->flag &= ~ACL_AIO_FLAG_READ_HOOKING;
+		}
 	}
 
 	astream->nrefer--;
@@ -832,6 +842,9 @@ static void can_read_callback(int event_type, ACL_EVENT *event acl_unused,
 	ACL_VSTREAM *stream acl_unused, void *context)
 {
 	ACL_ASTREAM *astream = (ACL_ASTREAM*) context;
+	/* READ_SAFE_DISABLE clears the callback, so it's saved first */
+	ACL_AIO_NOTIFY_FN can_read_fn = astream->can_read_fn;
+	void *can_read_ctx = astream->can_read_ctx;
 
 	if (astream->keep_read == 0) {
 		READ_SAFE_DISABLE(astream);
@@ -847,12 +860,14 @@ static void can_read_callback(int event_type, ACL_EVENT *event acl_unused,
 			READ_IOCP_CLOSE(astream);
 		} else {
 			READ_SAFE_ENABLE(astream, can_read_callback);
+			astream->can_read_fn = can_read_fn;
+			astream->can_read_ctx = can_read_ctx;
 		}
 		return;
 	}
 
 	astream->nrefer++;
-	if (astream->can_read_fn(astream, astream->can_read_ctx) < 0) {
+	if (can_read_fn(astream, can_read_ctx) < 0) {
 		astream->nrefer--;
 		READ_IOCP_CLOSE(astream);
 	} else if (astream->flag & ACL_AIO_FLAG_IOCP_CLOSE) {
@@ -129,6 +129,7 @@ ACL_VSTREAM *acl_aio_cancel(ACL_ASTREAM *astream)
 	stream = astream->stream;
 	stream->flag = 0;
 	acl_aio_clean_hooks(astream);
+	acl_vstring_free_buf(&astream->strbuf);
 	acl_myfree(astream);
 	return stream;
 }
@@ -199,6 +200,11 @@ static void close_astream(ACL_ASTREAM *astream)
 	acl_array_destroy(astream->timeo_handles, NULL);
 	acl_array_destroy(astream->connect_handles, NULL);
 
+	/* the read buffer isn't freed in acl_aio_clean_read_hooks(), for
+	 * the stream may still be read after its hooks were cleaned
+	 */
+	acl_vstring_free_buf(&astream->strbuf);
+
 	acl_myfree(astream);
 }
 
@@ -660,28 +666,58 @@ static void free_handle(void *handle)
 void acl_aio_clean_read_hooks(ACL_ASTREAM *astream)
 {
 	acl_array_clean(astream->read_handles, free_handle);
-	while (1) {
-		AIO_READ_HOOK *handle = astream->reader_fifo.pop_back(
-			&astream->reader_fifo);
-		if (handle == NULL) {
-			break;
+
+	if (astream->flag & ACL_AIO_FLAG_READ_HOOKING) {
+		ACL_ITER iter;
+
+		/* the hooks are being walked through by the read callback,
+		 * they'll be reused by acl_aio_add_read_hook() or freed
+		 * with the stream
+		 */
+		acl_foreach(iter, &astream->reader_fifo) {
+			AIO_READ_HOOK *handle = (AIO_READ_HOOK*) iter.data;
+			handle->disable = 1;
+			handle->ctx = NULL;
+		}
+	} else {
+		while (1) {
+			AIO_READ_HOOK *handle = astream->reader_fifo.pop_back(
+				&astream->reader_fifo);
+			if (handle == NULL) {
+				break;
+			}
+			free_handle(handle);
 		}
-		free_handle(handle);
 	}
-	acl_vstring_free_buf(&astream->strbuf);
 }
 
 void acl_aio_clean_write_hooks(ACL_ASTREAM *astream)
 {
 	acl_array_clean(astream->write_handles, free_handle);
-	while (1) {
-		AIO_WRITE_HOOK *handle = astream->writer_fifo.pop_back(
-			&astream->writer_fifo);
-		if (handle == NULL) {
-			break;
+
+	if (astream->flag & ACL_AIO_FLAG_WRITE_HOOKING) {
+		ACL_ITER iter;
+
+		/* the hooks are being walked through by the write callback,
+		 * they'll be reused by acl_aio_add_write_hook() or freed
+		 * with the stream
+		 */
+		acl_foreach(iter, &astream->writer_fifo) {
+			AIO_WRITE_HOOK *handle = (AIO_WRITE_HOOK*) iter.data;
+			handle->disable = 1;
+			handle->ctx = NULL;
+		}
+	} else {
+		while (1) {
+			AIO_WRITE_HOOK *handle = astream->writer_fifo.pop_back(
+				&astream->writer_fifo);
+			if (handle == NULL) {
+				break;
+			}
+			free_handle(handle);
 		}
-		free_handle(handle);
 	}
+
 	while (1) {
 		ACL_VSTRING *str = (ACL_VSTRING*) acl_fifo_pop(
 			&astream->write_fifo);
@@ -45,6 +45,8 @@
 static int write_complete_callback(ACL_ASTREAM *astream)
 {
 	int   ret = 0;
+	/* the nested call mustn't clear the flag set by the outer one */
+	int   hooking = astream->flag & ACL_AIO_FLAG_WRITE_HOOKING;
 
 	/* ü1Էֹ쳣ر */
 	astream->nrefer++;
@@ -68,6 +70,11 @@ static int write_complete_callback(ACL_ASTREAM *astream)
 					&astream->writer_fifo, handle);
 		}
 
+		/* acl_aio_clean_write_hooks() only disables the hooks
+		 * being walked through below instead of freeing them
+		 */
+		astream->flag |= ACL_AIO_FLAG_WRITE_HOOKING;
+
 		acl_foreach_reverse(iter, &astream->writer_fifo) {
 			handle = (AIO_WRITE_HOOK*) iter.data;
 			if (handle->disable) {
@@ -77,10 +84,13 @@ static int write_complete_callback(ACL_ASTREAM *astream)
 			/* صдɹעắ */
 			ret = handle->callback(astream, handle->ctx);
 			if (ret != 0) {
-				astream->nrefer--;
-				return ret;
+				break;
 			}
 		}
+
+		if (!hooking) {
+			astream->flag &= ~ACL_AIO_FLAG_WRITE_HOOKING;
+		}
 	}
 
 	astream->nrefer--;
@@ -574,6 +584,9 @@ static void can_write_callback(int event_type, ACL_EVENT *event acl_unused,
 {
 	const char *myname = "can_write_callback";
 	ACL_ASTREAM *astream = (ACL_ASTREAM*) context;
+	/* WRITE_SAFE_DIABLE clears the callback, so it's saved first */
+	ACL_AIO_NOTIFY_FN can_write_fn = astream->can_write_fn;
+	void *can_write_ctx = astream->can_write_ctx;
 
 	WRITE_SAFE_DIABLE(astream);
 
@@ -590,18 +603,22 @@ static void can_write_callback(int event_type, ACL_EVENT *event acl_unused,
 			WRITE_IOCP_CLOSE(astream);
 		} else {
 			WRITE_SAFE_ENABLE(astream, can_write_callback);
+			astream->can_write_fn = can_write_fn;
+			astream->can_write_ctx = can_write_ctx;
 		}
 
 		return;
 	}
 
-	if (astream->can_write_fn == NULL) {
+	if (can_write_fn == NULL) {
 		acl_msg_error("%s(%d): can_write_fn null for astream(%p)",
 			myname, __LINE__, astream);
+		WRITE_IOCP_CLOSE(astream);
+		return;
 	}
 
 	astream->nrefer++;
-	if (astream->can_write_fn(astream, astream->can_write_ctx) < 0) {
+	if (can_write_fn(astream, can_write_ctx) < 0) {
 		astream->nrefer--;
 		WRITE_IOCP_CLOSE(astream);
 	} else if (astream->flag & ACL_AIO_FLAG_IOCP_CLOSE) {
@@ -14,6 +14,8 @@
 
 #endif
 
+#include "codec_simd.h"
+
 static const unsigned char to_b64_tab[] =
 	"ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
 
@@ -36,22 +38,23 @@ static const unsigned char un_b64_tab[] = {
 	255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255
 };
 
-unsigned char *acl_base64_encode(const char *in, int len)
+size_t acl_base64_encode_buf(const void *in, size_t len, char *out)
 {
 	const unsigned char *clear = (const unsigned char*) in;
-	unsigned char *code = NULL;
-	unsigned char *p;
+	unsigned char *p = (unsigned char*) out;
+	size_t n = acl_simd_base64_encode(clear, len, p);
 
-	code = acl_mymalloc(4 * ((len + 2) / 3) + 1);
-	p = code;
+	clear += n;
+	p     += n / 3 * 4;
+	len   -= n;
 
-	while (len-- >0) {
+	while (len-- > 0) {
 		register int x, y;
 
 		x = *clear++;
 		*p++ = to_b64_tab[(x >> 2) & 63];
 
-		if (len-- <= 0) {
+		if (len-- == 0) {
 			*p++ = to_b64_tab[(x << 4) & 63];
 			*p++ = '=';
 			*p++ = '=';
@@ -61,7 +64,7 @@ unsigned char *acl_base64_encode(const char *in, int len)
 		y = *clear++;
 		*p++ = to_b64_tab[((x << 4) | ((y >> 4) & 15)) & 63];
 
-		if (len-- <= 0) {
+		if (len-- == 0) {
 			*p++ = to_b64_tab[(y << 2) & 63];
 			*p++ = '=';
 			break;
@@ -74,60 +77,80 @@ unsigned char *acl_base64_encode(const char *in, int len)
 	}
 
 	*p = 0;
+	return (size_t) (p - (unsigned char*) out);
+}
+
+unsigned char *acl_base64_encode(const char *in, int len)
+{
+	unsigned char *code;
 
+	if (len < 0) {
+		len = 0;
+	}
+	code = acl_mymalloc(ACL_BASE64_ENCODE_SIZE(len));
+	(void) acl_base64_encode_buf(in, (size_t) len, (char*) code);
 	return (code);
 }
 
-int acl_base64_decode(const char *in, char **pptr_in)
+int acl_base64_decode_buf(const char *in, size_t len, void *out)
 {
-	size_t in_len;
-	const unsigned char *in_end;
 	const unsigned char *code = (const unsigned char*) in;
-	unsigned char **pptr = (unsigned char**) pptr_in;
+	const unsigned char *in_end = code + len;
+	unsigned char *result = (unsigned char*) out;
 	register int x, y;
-	unsigned char *result, *result_saved = NULL;
-
-#undef	ERETURN
-#define	ERETURN(x) { \
-	if (result_saved != NULL) \
-		acl_myfree(result_saved); \
-	*pptr = NULL; \
-	return (x); \
-}
+	size_t n;
+
+	/* The SIMD kernel only stops before a quantum with padding or invalid
+	   chars in it, which are left to the scalar loop below. */
 
-	in_len = strlen((const char *) code);
-	in_end = code + in_len;
-	result_saved = result = acl_mymalloc(3 * (in_len / 4) + 1);
-	*pptr = result;
+	n       = acl_simd_base64_decode(code, len, result);
+	code   += n;
+	result += n / 4 * 3;
 
 	/* Each cycle of the loop handles a quantum of 4 input bytes. For the last
 	   quantum this may decode to 1, 2, or 3 output bytes. */
 
-	while (in_end - code >= 4 && (x = (*code++)) != 0) {
-		if (x > 127 || (x = un_b64_tab[x]) == 255)
-			ERETURN (-1);
-		if ((y = (*code++)) == 0 || (y = un_b64_tab[y]) == 255)
-			ERETURN (-1);
+	while (in_end - code >= 4) {
+		if ((x = (*code++)) > 127 || (x = un_b64_tab[x]) == 255)
+			return (-1);
+		if ((y = (*code++)) > 127 || (y = un_b64_tab[y]) == 255)
+			return (-1);
 		*result++ = (x << 2) | (y >> 4);
 
 		if ((x = (*code++)) == '=') {
-			if (*code++ != '=' || *code != 0)
-				ERETURN (-1);
+			if (*code++ != '=' || code != in_end)
+				return (-1);
 		} else {
 			if (x > 127 || (x = un_b64_tab[x]) == 255)
-				ERETURN (-1);
+				return (-1);
 			*result++ = (y << 4) | (x >> 2);
 			if ((y = (*code++)) == '=') {
-				if (*code != 0)
-					ERETURN (-1);
+				if (code != in_end)
+					return (-1);
 			} else {
 				if (y > 127 || (y = un_b64_tab[y]) == 255)
-					ERETURN (-1);
+					return (-1);
 				*result++ = (x << 6) | y;
 			}
 		}
 	}
 
 	*result = 0;
-	return (int) (result - *pptr);
+	return (int) (result - (unsigned char*) out);
+}
+
+int acl_base64_decode(const char *in, char **pptr_in)
+{
+	size_t in_len = strlen(in);
+	char *result = acl_mymalloc(ACL_BASE64_DECODE_SIZE(in_len));
+	int ret = acl_base64_decode_buf(in, in_len, result);
+
+	if (ret < 0) {
+		acl_myfree(result);
+		*pptr_in = NULL;
+		return (-1);
+	}
+
+	*pptr_in = result;
+	return (ret);
 }
@@ -0,0 +1,491 @@
+#include "StdAfx.h"
+#ifndef ACL_PREPARE_COMPILE
+
+#include "stdlib/acl_define.h"
+#include <ctype.h>
+#include <string.h>
+
+#ifdef ACL_BCB_COMPILER
+#pragma hdrstop
+#endif
+
+#include "code/acl_codec_simd.h"
+
+#endif
+
+#include "codec_simd.h"
+
+/*
+ * The x86 kernels are compiled with the target attribute so that the
+ * library needn't be built with -mavx2, and the best one is selected at
+ * runtime by checking the CPU features.
+ */
+#if	!defined(COSMOCC) && (defined(__x86_64__) || defined(__i386__)) \
+	&& (defined(__clang__) || (defined(__GNUC__) && (__GNUC__ > 4 \
+		|| (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))))
+# define CODEC_X86
+# include <immintrin.h>
+# define TARGET_SSSE3	__attribute__((target("ssse3")))
+# define TARGET_AVX2	__attribute__((target("avx2")))
+#endif
+
+static int __simd_limit = ACL_CODEC_SIMD_AVX2;
+static int __simd_level = -1;
+
+static int simd_detect(void)
+{
+#ifdef	CODEC_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2")) {
+		return ACL_CODEC_SIMD_AVX2;
+	}
+	if (__builtin_cpu_supports("ssse3")) {
+		return ACL_CODEC_SIMD_SSSE3;
+	}
+#endif
+	return ACL_CODEC_SIMD_NONE;
+}
+
+static int simd_init(void)
+{
+	int level = simd_detect();
+
+	if (level > __simd_limit) {
+		level = __simd_limit;
+	}
+	__simd_level = level;
+	return level;
+}
+
+#define SIMD_LEVEL()	(__simd_level >= 0 ? __simd_level : simd_init())
+
+int acl_codec_simd_level(void)
+{
+	return SIMD_LEVEL();
+}
+
+const char *acl_codec_simd_name(int level)
+{
+	switch (level) {
+	case ACL_CODEC_SIMD_AVX2:
+		return "avx2";
+	case ACL_CODEC_SIMD_SSSE3:
+		return "ssse3";
+	default:
+		return "scalar";
+	}
+}
+
+int acl_codec_simd_limit(int level)
+{
+	if (level < ACL_CODEC_SIMD_NONE) {
+		level = ACL_CODEC_SIMD_NONE;
+	}
+	__simd_limit = level;
+	return simd_init();
+}
+
+#ifdef	CODEC_X86
+
+/* base64 encode: 12 bytes -> 16 chars, see Wojciech Mula's
+ * "Base64 encoding with SIMD instructions" for the algorithm.
+ */
+
+TARGET_SSSE3
+static size_t base64_encode_ssse3(const unsigned char *in, size_t len,
+	unsigned char *out)
+{
+	const __m128i shuf = _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7,
+			4, 5, 3, 4, 1, 2, 0, 1);
+	const __m128i shift_lut = _mm_setr_epi8('a' - 26, '0' - 52,
+			'0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+			'0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62,
+			'/' - 63, 'A', 0, 0);
+	size_t i = 0;
+
+	/* each load reads 16 bytes but only consumes 12 of them */
+	for (; len - i >= 16; i += 12, out += 16) {
+		__m128i v = _mm_loadu_si128((const __m128i*) (in + i));
+		__m128i t0, t1, t2, t3, idx, res, less;
+
+		v   = _mm_shuffle_epi8(v, shuf);
+		t0  = _mm_and_si128(v, _mm_set1_epi32(0x0fc0fc00));
+		t1  = _mm_mulhi_epu16(t0, _mm_set1_epi32(0x04000040));
+		t2  = _mm_and_si128(v, _mm_set1_epi32(0x003f03f0));
+		t3  = _mm_mullo_epi16(t2, _mm_set1_epi32(0x01000010));
+		idx = _mm_or_si128(t1, t3);
+
+		res  = _mm_subs_epu8(idx, _mm_set1_epi8(51));
+		less = _mm_cmpgt_epi8(_mm_set1_epi8(26), idx);
+		res  = _mm_or_si128(res, _mm_and_si128(less, _mm_set1_epi8(13)));
+		res  = _mm_shuffle_epi8(shift_lut, res);
+		res  = _mm_add_epi8(res, idx);
+		_mm_storeu_si128((__m128i*) out, res);
+	}
+
+	return i;
+}
+
+TARGET_AVX2
+static size_t base64_encode_avx2(const unsigned char *in, size_t len,
+	unsigned char *out)
+{
+	const __m256i shuf = _mm256_set_epi8(10, 11, 9, 10, 7, 8, 6, 7,
+			4, 5, 3, 4, 1, 2, 0, 1, 10, 11, 9, 10, 7, 8, 6, 7,
+			4, 5, 3, 4, 1, 2, 0, 1);
+	const __m256i shift_lut = _mm256_setr_epi8('a' - 26, '0' - 52,
+			'0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+			'0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62,
+			'/' - 63, 'A', 0, 0, 'a' - 26, '0' - 52,
+			'0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+			'0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62,
+			'/' - 63, 'A', 0, 0);
+	size_t i = 0;
+
+	/* two 16 bytes loads at offset 0 and 12, 24 bytes consumed */
+	for (; len - i >= 28; i += 24, out += 32) {
+		__m128i lo = _mm_loadu_si128((const __m128i*) (in + i));
+		__m128i hi = _mm_loadu_si128((const __m128i*) (in + i + 12));
+		__m256i v  = _mm256_inserti128_si256(
+				_mm256_castsi128_si256(lo), hi, 1);
+		__m256i t0, t1, t2, t3, idx, res, less;
+
+		v   = _mm256_shuffle_epi8(v, shuf);
+		t0  = _mm256_and_si256(v, _mm256_set1_epi32(0x0fc0fc00));
+		t1  = _mm256_mulhi_epu16(t0, _mm256_set1_epi32(0x04000040));
+		t2  = _mm256_and_si256(v, _mm256_set1_epi32(0x003f03f0));
+		t3  = _mm256_mullo_epi16(t2, _mm256_set1_epi32(0x01000010));
+		idx = _mm256_or_si256(t1, t3);
+
+		res  = _mm256_subs_epu8(idx, _mm256_set1_epi8(51));
+		less = _mm256_cmpgt_epi8(_mm256_set1_epi8(26), idx);
+		res  = _mm256_or_si256(res,
+				_mm256_and_si256(less, _mm256_set1_epi8(13)));
+		res  = _mm256_shuffle_epi8(shift_lut, res);
+		res  = _mm256_add_epi8(res, idx);
+		_mm256_storeu_si256((__m256i*) out, res);
+	}
+
+	return i + base64_encode_ssse3(in + i, len - i, out);
+}
+
+/* base64 decode: 16 chars -> 12 bytes; the block is validated by looking
+ * up the bit of the char's high nibble in a mask selected by its low nibble.
+ */
+
+TARGET_SSSE3
+static size_t base64_decode_ssse3(const unsigned char *in, size_t len,
+	unsigned char *out)
+{
+	const __m128i shift_lut = _mm_setr_epi8(0, 0, 19, 4, -65, -65,
+			-71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+	const __m128i mask_lut = _mm_setr_epi8((char) 0xa8, (char) 0xf8,
+			(char) 0xf8, (char) 0xf8, (char) 0xf8, (char) 0xf8,
+			(char) 0xf8, (char) 0xf8, (char) 0xf8, (char) 0xf8,
+			(char) 0xf0, 0x54, 0x50, 0x50, 0x50, 0x54);
+	const __m128i bit_lut = _mm_setr_epi8(0x01, 0x02, 0x04, 0x08,
+			0x10, 0x20, 0x40, (char) 0x80, 0, 0, 0, 0, 0, 0, 0, 0);
+	const __m128i pack = _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8,
+			14, 13, 12, -1, -1, -1, -1);
+	size_t i = 0;
+
+	/* the 16 bytes store writes 4 more bytes than decoded, so keep
+	 * enough input left behind to be sure the output can hold them.
+	 */
+	for (; len - i >= 24; i += 16, out += 12) {
+		__m128i v = _mm_loadu_si128((const __m128i*) (in + i));
+		__m128i hi, lo, sh, bad, res;
+
+		hi  = _mm_and_si128(_mm_srli_epi32(v, 4), _mm_set1_epi8(0x0f));
+		lo  = _mm_and_si128(v, _mm_set1_epi8(0x0f));
+		bad = _mm_and_si128(_mm_shuffle_epi8(mask_lut, lo),
+				_mm_shuffle_epi8(bit_lut, hi));
+		bad = _mm_cmpeq_epi8(bad, _mm_setzero_si128());
+		if (_mm_movemask_epi8(bad) != 0) {
+			break;
+		}
+
+		/* '/' shares its high nibble with '+', so adjust it alone */
+		sh  = _mm_shuffle_epi8(shift_lut, hi);
+		sh  = _mm_add_epi8(sh, _mm_and_si128(_mm_cmpeq_epi8(v,
+				_mm_set1_epi8('/')), _mm_set1_epi8(-3)));
+		v   = _mm_add_epi8(v, sh);
+
+		res = _mm_maddubs_epi16(v, _mm_set1_epi32(0x01400140));
+		res = _mm_madd_epi16(res, _mm_set1_epi32(0x00011000));
+		res = _mm_shuffle_epi8(res, pack);
+		_mm_storeu_si128((__m128i*) out, res);
+	}
+
+	return i;
+}
+
+TARGET_AVX2
+static size_t base64_decode_avx2(const unsigned char *in, size_t len,
+	unsigned char *out)
+{
+	const __m256i shift_lut = _mm256_setr_epi8(0, 0, 19, 4, -65, -65,
+			-71, -71, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 19, 4,
+			-65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+	const __m256i mask_lut = _mm256_setr_epi8((char) 0xa8, (char) 0xf8,
+			(char) 0xf8, (char) 0xf8, (char) 0xf8, (char) 0xf8,
+			(char) 0xf8, (char) 0xf8, (char) 0xf8, (char) 0xf8,
+			(char) 0xf0, 0x54, 0x50, 0x50, 0x50, 0x54,
+			(char) 0xa8, (char) 0xf8,
+			(char) 0xf8, (char) 0xf8, (char) 0xf8, (char) 0xf8,
+			(char) 0xf8, (char) 0xf8, (char) 0xf8, (char) 0xf8,
+			(char) 0xf0, 0x54, 0x50, 0x50, 0x50, 0x54);
+	const __m256i bit_lut = _mm256_setr_epi8(0x01, 0x02, 0x04, 0x08,
+			0x10, 0x20, 0x40, (char) 0x80, 0, 0, 0, 0, 0, 0, 0, 0,
+			0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, (char) 0x80,
+			0, 0, 0, 0, 0, 0, 0, 0);
+	const __m256i pack = _mm256_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8,
+			14, 13, 12, -1, -1, -1, -1, 2, 1, 0, 6, 5, 4, 10, 9, 8,
+			14, 13, 12, -1, -1, -1, -1);
+	const __m256i perm = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7);
+	size_t i = 0;
+
+	/* 32 bytes are stored for 24 decoded ones, see the SSSE3 one */
+	for (; len - i >= 48; i += 32, out += 24) {
+		__m256i v = _mm256_loadu_si256((const __m256i*) (in + i));
+		__m256i hi, lo, sh, bad, res;
+
+		hi  = _mm256_and_si256(_mm256_srli_epi32(v, 4),
+				_mm256_set1_epi8(0x0f));
+		lo  = _mm256_and_si256(v, _mm256_set1_epi8(0x0f));
+		bad = _mm256_and_si256(_mm256_shuffle_epi8(mask_lut, lo),
+				_mm256_shuffle_epi8(bit_lut, hi));
+		bad = _mm256_cmpeq_epi8(bad, _mm256_setzero_si256());
+		if (_mm256_movemask_epi8(bad) != 0) {
+			return i;
+		}
+
+		sh  = _mm256_shuffle_epi8(shift_lut, hi);
+		sh  = _mm256_add_epi8(sh, _mm256_and_si256(_mm256_cmpeq_epi8(v,
+				_mm256_set1_epi8('/')), _mm256_set1_epi8(-3)));
+		v   = _mm256_add_epi8(v, sh);
+
+		res = _mm256_maddubs_epi16(v, _mm256_set1_epi32(0x01400140));
+		res = _mm256_madd_epi16(res, _mm256_set1_epi32(0x00011000));
+		res = _mm256_shuffle_epi8(res, pack);
+		res = _mm256_permutevar8x32_epi32(res, perm);
+		_mm256_storeu_si256((__m256i*) out, res);
+	}
+
+	return i + base64_decode_ssse3(in + i, len - i, out);
+}
+
+/* hex encode: the two nibbles of each byte are looked up by pshufb and
+ * then interleaved.
+ */
+
+TARGET_SSSE3
+static size_t hex_encode_ssse3(const unsigned char *in, size_t len,
+	unsigned char *out, int lowercase)
+{
+	const __m128i lut = lowercase
+		? _mm_setr_epi8('0', '1', '2', '3', '4', '5', '6', '7',
+			'8', '9', 'a', 'b', 'c', 'd', 'e', 'f')
+		: _mm_setr_epi8('0', '1', '2', '3', '4', '5', '6', '7',
+			'8', '9', 'A', 'B', 'C', 'D', 'E', 'F');
+	const __m128i mask = _mm_set1_epi8(0x0f);
+	size_t i = 0;
+
+	for (; len - i >= 16; i += 16, out += 32) {
+		__m128i v  = _mm_loadu_si128((const __m128i*) (in + i));
+		__m128i hi = _mm_shuffle_epi8(lut,
+				_mm_and_si128(_mm_srli_epi16(v, 4), mask));
+		__m128i lo = _mm_shuffle_epi8(lut, _mm_and_si128(v, mask));
+
+		_mm_storeu_si128((__m128i*) out, _mm_unpacklo_epi8(hi, lo));
+		_mm_storeu_si128((__m128i*) (out + 16),
+			_mm_unpackhi_epi8(hi, lo));
+	}
+
+	return i;
+}
+
+TARGET_AVX2
+static size_t hex_encode_avx2(const unsigned char *in, size_t len,
+	unsigned char *out, int lowercase)
+{
+	const __m256i lut = lowercase
+		? _mm256_setr_epi8('0', '1', '2', '3', '4', '5', '6', '7',
+			'8', '9', 'a', 'b', 'c', 'd', 'e', 'f',
+			'0', '1', '2', '3', '4', '5', '6', '7',
+			'8', '9', 'a', 'b', 'c', 'd', 'e', 'f')
+		: _mm256_setr_epi8('0', '1', '2', '3', '4', '5', '6', '7',
+			'8', '9', 'A', 'B', 'C', 'D', 'E', 'F',
+			'0', '1', '2', '3', '4', '5', '6', '7',
+			'8', '9', 'A', 'B', 'C', 'D', 'E', 'F');
+	const __m256i mask = _mm256_set1_epi8(0x0f);
+	size_t i = 0;
+
+	for (; len - i >= 32; i += 32, out += 64) {
+		__m256i v  = _mm256_loadu_si256((const __m256i*) (in + i));
+		__m256i hi = _mm256_shuffle_epi8(lut,
+				_mm256_and_si256(_mm256_srli_epi16(v, 4), mask));
+		__m256i lo = _mm256_shuffle_epi8(lut,
+				_mm256_and_si256(v, mask));
+		/* unpack works in each 128 bits lane, so put them back */
+		__m256i r0 = _mm256_unpacklo_epi8(hi, lo);
+		__m256i r1 = _mm256_unpackhi_epi8(hi, lo);
+
+		_mm256_storeu_si256((__m256i*) out,
+			_mm256_permute2x128_si256(r0, r1, 0x20));
+		_mm256_storeu_si256((__m256i*) (out + 32),
+			_mm256_permute2x128_si256(r0, r1, 0x31));
+	}
+
+	return i + hex_encode_ssse3(in + i, len - i, out, lowercase);
+}
+
+/* url span: the chars in [0-9A-Za-z_.-] are kept as they are; the chars
+ * >= 0x80 are negative in the signed compares, so they never match.
+ */
+
+TARGET_SSSE3
+static size_t url_span_ssse3(const unsigned char *in, size_t len)
+{
+	size_t i = 0;
+
+	for (; len - i >= 16; i += 16) {
+		__m128i v = _mm_loadu_si128((const __m128i*) (in + i));
+		__m128i a = _mm_or_si128(v, _mm_set1_epi8(0x20));
+		__m128i ok;
+		int mask;
+
+		ok = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8('0' - 1)),
+			_mm_cmpgt_epi8(_mm_set1_epi8('9' + 1), v));
+		ok = _mm_or_si128(ok, _mm_and_si128(
+			_mm_cmpgt_epi8(a, _mm_set1_epi8('a' - 1)),
+			_mm_cmpgt_epi8(_mm_set1_epi8('z' + 1), a)));
+		ok = _mm_or_si128(ok, _mm_cmpeq_epi8(v, _mm_set1_epi8('_')));
+		ok = _mm_or_si128(ok, _mm_cmpeq_epi8(v, _mm_set1_epi8('-')));
+		ok = _mm_or_si128(ok, _mm_cmpeq_epi8(v, _mm_set1_epi8('.')));
+
+		mask = _mm_movemask_epi8(ok);
+		if (mask != 0xffff) {
+			return i + __builtin_ctz(~mask);
+		}
+	}
+
+	return i;
+}
+
+TARGET_AVX2
+static size_t url_span_avx2(const unsigned char *in, size_t len)
+{
+	size_t i = 0;
+
+	for (; len - i >= 32; i += 32) {
+		__m256i v = _mm256_loadu_si256((const __m256i*) (in + i));
+		__m256i a = _mm256_or_si256(v, _mm256_set1_epi8(0x20));
+		__m256i ok;
+		unsigned mask;
+
+		ok = _mm256_and_si256(
+			_mm256_cmpgt_epi8(v, _mm256_set1_epi8('0' - 1)),
+			_mm256_cmpgt_epi8(_mm256_set1_epi8('9' + 1), v));
+		ok = _mm256_or_si256(ok, _mm256_and_si256(
+			_mm256_cmpgt_epi8(a, _mm256_set1_epi8('a' - 1)),
+			_mm256_cmpgt_epi8(_mm256_set1_epi8('z' + 1), a)));
+		ok = _mm256_or_si256(ok,
+			_mm256_cmpeq_epi8(v, _mm256_set1_epi8('_')));
+		ok = _mm256_or_si256(ok,
+			_mm256_cmpeq_epi8(v, _mm256_set1_epi8('-')));
+		ok = _mm256_or_si256(ok,
+			_mm256_cmpeq_epi8(v, _mm256_set1_epi8('.')));
+
+		mask = (unsigned) _mm256_movemask_epi8(ok);
+		if (mask != 0xffffffffU) {
+			return i + __builtin_ctz(~mask);
+		}
+	}
+
+	return i + url_span_ssse3(in + i, len - i);
+}
+
+#endif /* CODEC_X86 */
+
+size_t acl_simd_base64_encode(const unsigned char *in, size_t len,
+	unsigned char *out)
+{
+	switch (SIMD_LEVEL()) {
+#ifdef	CODEC_X86
+	case ACL_CODEC_SIMD_AVX2:
+		return base64_encode_avx2(in, len, out);
+	case ACL_CODEC_SIMD_SSSE3:
+		return base64_encode_ssse3(in, len, out);
+#endif
+	default:
+		(void) in;
+		(void) len;
+		(void) out;
+		return 0;
+	}
+}
+
+size_t acl_simd_base64_decode(const unsigned char *in, size_t len,
+	unsigned char *out)
+{
+	switch (SIMD_LEVEL()) {
+#ifdef	CODEC_X86
+	case ACL_CODEC_SIMD_AVX2:
+		return base64_decode_avx2(in, len, out);
+	case ACL_CODEC_SIMD_SSSE3:
+		return base64_decode_ssse3(in, len, out);
+#endif
+	default:
+		(void) in;
+		(void) len;
+		(void) out;
+		return 0;
+	}
+}
+
+size_t acl_simd_hex_encode(const unsigned char *in, size_t len,
+	unsigned char *out, int lowercase)
+{
+	switch (SIMD_LEVEL()) {
+#ifdef	CODEC_X86
+	case ACL_CODEC_SIMD_AVX2:
+		return hex_encode_avx2(in, len, out, lowercase);
+	case ACL_CODEC_SIMD_SSSE3:
+		return hex_encode_ssse3(in, len, out, lowercase);
+#endif
+	default:
+		(void) in;
+		(void) len;
+		(void) out;
+		(void) lowercase;
+		return 0;
+	}
+}
+
+size_t acl_simd_url_span(const unsigned char *in, size_t len)
+{
+	size_t i = 0;
+
+	switch (SIMD_LEVEL()) {
+#ifdef	CODEC_X86
+	case ACL_CODEC_SIMD_AVX2:
+		i = url_span_avx2(in, len);
+		break;
+	case ACL_CODEC_SIMD_SSSE3:
+		i = url_span_ssse3(in, len);
+		break;
+#endif
+	default:
+		break;
+	}
+
+	/* the tail shorter than one block, or all without SIMD */
+	for (; i < len; i++) {
+		int ch = in[i];
+		if (!ACL_ISALNUM(ch) && ch != '_' && ch != '-' && ch != '.') {
+			break;
+		}
+	}
+	return i;
+}
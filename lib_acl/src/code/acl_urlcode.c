@@ -12,45 +12,64 @@
 
 #endif
 
+#include "codec_simd.h"
+
 static unsigned char enc_tab[] = "0123456789ABCDEF";
 
-char *acl_url_encode(const char *str, ACL_DBUF_POOL *dbuf)
+size_t acl_url_encode_size(const char *str, size_t len)
 {
-	int i, j, len, tmp_len;
-	unsigned char *tmp;
-
-	len = (int) strlen(str);
-	tmp_len = len;
+	const unsigned char *ptr = (const unsigned char*) str;
+	size_t i = 0, n = len;
+
+	while (i < len) {
+		i += acl_simd_url_span(ptr + i, len - i);
+		if (i < len) {
+			n += 2;
+			i++;
+		}
+	}
+	return n;
+}
 
-	if (dbuf != NULL)
-		tmp = (unsigned char*) acl_dbuf_pool_alloc(dbuf, len + 1);
-	else
-		tmp = (unsigned char*) acl_mymalloc(len + 1);
-
-	for (i = 0, j = 0; i < len; i++, j++) {
-		tmp[j] = (unsigned char) str[i];
-		/* if (tmp[j] == ' ')
-			tmp[j] = '+';
-		else */
-		if (!isalnum(tmp[j]) && strchr("_-.", tmp[j]) == NULL) {
-			tmp_len += 3;
-			if (dbuf != NULL) {
-				unsigned char *t = (unsigned char*) 
-					acl_dbuf_pool_alloc(dbuf, tmp_len);
-				if (j > 0)
-					memcpy(t, tmp, j);
-				tmp = t;
-			} else
-				tmp = acl_myrealloc(tmp, tmp_len);
-
-			tmp[j++] = '%';
-			tmp[j++] = enc_tab[(unsigned char)str[i] >> 4];
-			tmp[j] = enc_tab[(unsigned char)str[i] & 0x0F];
+size_t acl_url_encode_buf(const char *str, size_t len, char *out)
+{
+	const unsigned char *ptr = (const unsigned char*) str;
+	unsigned char *tmp = (unsigned char*) out;
+	size_t i = 0, j = 0, n;
+
+	while (i < len) {
+		/* copy the run of chars which needn't be escaped at once */
+		n = acl_simd_url_span(ptr + i, len - i);
+		if (n > 0) {
+			memcpy(tmp + j, ptr + i, n);
+			i += n;
+			j += n;
+			if (i >= len)
+				break;
 		}
+
+		tmp[j++] = '%';
+		tmp[j++] = enc_tab[ptr[i] >> 4];
+		tmp[j++] = enc_tab[ptr[i] & 0x0F];
+		i++;
 	}
 
 	tmp[j] = '\0';
-	return (char*) tmp;
+	return j;
+}
+
+char *acl_url_encode(const char *str, ACL_DBUF_POOL *dbuf)
+{
+	size_t len = strlen(str), size = acl_url_encode_size(str, len);
+	char *tmp;
+
+	if (dbuf != NULL)
+		tmp = (char*) acl_dbuf_pool_alloc(dbuf, size + 1);
+	else
+		tmp = (char*) acl_mymalloc(size + 1);
+
+	(void) acl_url_encode_buf(str, len, tmp);
+	return tmp;
 }
 
 static unsigned char dec_tab[256] = {
@@ -72,31 +91,30 @@ static unsigned char dec_tab[256] = {
 	0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
 };
 
-char *acl_url_decode(const char *str, ACL_DBUF_POOL *dbuf)
+size_t acl_url_decode_buf(const char *str, size_t len, char *tmp)
 {
-	char *tmp;
-	int i, len, pos = 0;
-
-	len = (int) strlen(str);
-	if (dbuf != NULL)
-		tmp = (char*) acl_dbuf_pool_alloc(dbuf, len + 1);
-	else
-		tmp = (char*) acl_mymalloc(len + 1);
+	const char *ptr;
+	size_t i, n, pos = 0;
 
 	for (i = 0; i < len; i++) {
+		/* copy all the data before the next '%' at once */
+		ptr = (const char*) memchr(str + i, '%', len - i);
+		n   = ptr ? (size_t) (ptr - str) - i : len - i;
+		if (n > 0) {
+			memcpy(tmp + pos, str + i, n);
+			pos += n;
+			i   += n;
+			if (i >= len)
+				break;
+		}
+
 		/* If we found a '%' character, then the next two are
 		 * the character hexa code. Converting a hexadecimal
 		 * code to their decimal is easy: The first character
 		 * needs to be multiplied by 16 ( << 4 ), and the
 		 * another one we just get the value from hextable variable
 		 */
-		/*
-		if (str[i] == '+')
-			tmp[pos] = ' ';
-		else */
-		if (str[i] != '%')
-			tmp[pos] = str[i];
-		else if (i + 2 >= len) {  /* check boundary */
+		if (i + 2 >= len) {  /* check boundary */
 			tmp[pos++] = '%';  /* keep it */
 			if (++i >= len)
 				break;
@@ -113,5 +131,20 @@ char *acl_url_decode(const char *str, ACL_DBUF_POOL *dbuf)
 	}
 
 	tmp[pos] = '\0';
+	return pos;
+}
+
+char *acl_url_decode(const char *str, ACL_DBUF_POOL *dbuf)
+{
+	char *tmp;
+	size_t len;
+
+	len = strlen(str);
+	if (dbuf != NULL)
+		tmp = (char*) acl_dbuf_pool_alloc(dbuf, len + 1);
+	else
+		tmp = (char*) acl_mymalloc(len + 1);
+
+	(void) acl_url_decode_buf(str, len, tmp);
 	return tmp;
 }
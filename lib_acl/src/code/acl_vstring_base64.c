@@ -24,6 +24,9 @@
 
 #endif
 
+#include "code/acl_base64.h"
+#include "codec_simd.h"
+
 /* Application-specific. */
 
 static const unsigned char to_b64[] =
@@ -58,6 +61,20 @@ ACL_VSTRING *acl_vstring_base64_encode(ACL_VSTRING *result,
 	const unsigned char *cp;
 	int     count, size = len * 4 /3;
 
+	/*
+	 * Fast path: encode into the buffer directly if it can hold all.
+	 */
+	ACL_VSTRING_RESET(result);
+	if (len > 0 && ACL_VSTRING_SPACE(result,
+		(ssize_t) ACL_BASE64_ENCODE_SIZE(len)) == 0) {
+
+		size = (int) acl_base64_encode_buf(in, (size_t) len,
+				acl_vstring_str(result));
+		ACL_VSTRING_AT_OFFSET(result, size);
+		ACL_VSTRING_TERMINATE(result);
+		return (result);
+	}
+
 	ACL_VSTRING_SPACE(result, size);
 
 	/*
@@ -122,13 +139,25 @@ ACL_VSTRING *acl_vstring_base64_decode(ACL_VSTRING *result,
 	 * }
 	 */
 
-	ACL_VSTRING_SPACE(result, len);
+	ACL_VSTRING_RESET(result);
+	cp    = UNSIG_CHAR_PTR(in);
+	count = 0;
+
+	/*
+	 * The SIMD kernel decodes the leading quanta without '=' or invalid
+	 * chars, and the left are decoded one by one as below.
+	 */
+	if (ACL_VSTRING_SPACE(result, len) == 0) {
+		count = (int) acl_simd_base64_decode(cp, (size_t) len,
+				(unsigned char*) acl_vstring_str(result));
+		cp   += count;
+		ACL_VSTRING_AT_OFFSET(result, count / 4 * 3);
+	}
+
 	/*
 	 * Decode 4 -> 3.
 	 */
-	ACL_VSTRING_RESET(result);
-
-	for (cp = UNSIG_CHAR_PTR(in), count = 0; count < len; count += 4) {
+	for (; count < len; count += 4) {
 		if ((ch0 = un_b64[*cp++]) == INVALID
 		    || (ch1 = un_b64[*cp++]) == INVALID)
 			return (0);
@@ -0,0 +1,30 @@
+#ifndef __ACL_CODEC_SIMD_INCLUDE_H__
+#define __ACL_CODEC_SIMD_INCLUDE_H__
+#include "stdlib/acl_define.h"
+
+/*
+ * The bulk kernels below only process the part of the input which can be
+ * handled in whole SIMD blocks and return how many input bytes have been
+ * consumed; the caller finishes the tail with its own scalar loop, so the
+ * error and padding semantics of each codec are kept in one place.
+ */
+
+/* Encode whole 3-byte groups, writes (return / 3 * 4) bytes into out */
+size_t acl_simd_base64_encode(const unsigned char *in, size_t len,
+	unsigned char *out);
+
+/* Decode whole 4-char quanta with no padding or invalid chars in them,
+ * writes (return / 4 * 3) bytes into out, which must be able to hold
+ * at least (len / 4) * 3 + 1 bytes */
+size_t acl_simd_base64_decode(const unsigned char *in, size_t len,
+	unsigned char *out);
+
+/* Hex encode, writes (return * 2) bytes into out */
+size_t acl_simd_hex_encode(const unsigned char *in, size_t len,
+	unsigned char *out, int lowercase);
+
+/* Return the length of the leading run of chars which needn't be escaped
+ * by url encoding: [0-9A-Za-z_.-] */
+size_t acl_simd_url_span(const unsigned char *in, size_t len);
+
+#endif
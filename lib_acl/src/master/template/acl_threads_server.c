@@ -28,6 +28,10 @@
 #endif
 #include <time.h>
 #include <pthread.h>
+#ifdef ACL_LINUX
+#include <sched.h>
+#include <linux/filter.h>
+#endif
 
 /* Utility library. */
 
@@ -47,6 +51,7 @@
 #include "net/acl_tcp_ctl.h"
 #include "net/acl_sane_socket.h"
 #include "net/acl_vstream_net.h"
+#include "net/acl_valid_hostname.h"
 #include "event/acl_events.h"
 
 #endif /* ACL_UNIX */
@@ -88,6 +93,9 @@ int   acl_var_threads_check_inter;
 int   acl_var_threads_qlen_warn;
 int   acl_var_threads_schedule_warn;
 int   acl_var_threads_schedule_wait;
+int   acl_var_threads_reuseport_threads;
+int   acl_var_threads_reuseport_affinity;
+int   acl_var_threads_reuseport_cbpf;
 
 static ACL_CONFIG_INT_TABLE __conf_int_tab[] = {
 	{ "master_maxproc", 1, &acl_var_threads_master_maxproc, 0, 0},
@@ -117,6 +125,9 @@ static ACL_CONFIG_INT_TABLE __conf_int_tab[] = {
 	{ "ioctl_schedule_warn", 100, &acl_var_threads_schedule_warn, 0, 0 },
 	{ "ioctl_schedule_wait", 50, &acl_var_threads_schedule_wait, 0, 0 },
 	{ "ioctl_check_inter", 100, &acl_var_threads_check_inter, 0, 0 },
+	{ "ioctl_reuseport_threads", 0, &acl_var_threads_reuseport_threads, 0, 0 },
+	{ "ioctl_reuseport_affinity", 0, &acl_var_threads_reuseport_affinity, 0, 0 },
+	{ "ioctl_reuseport_cbpf", 0, &acl_var_threads_reuseport_cbpf, 0, 0 },
 
         { 0, 0, 0, 0, 0 },
 };
@@ -199,6 +210,17 @@ static ACL_MASTER_SERVER_SIGHUP_FN      __sighup_handler;
 static char *__deny_info = NULL;
 static char  __conf_file[1024];
 
+static ACL_MASTER_SERVER_THREAD_INIT_FN __thread_init_fn = NULL;
+static void *__thread_init_ctx = NULL;
+static ACL_MASTER_SERVER_THREAD_EXIT_FN __thread_exit_fn = NULL;
+static void *__thread_exit_ctx = NULL;
+
+#if defined(ACL_UNIX) && defined(SO_REUSEPORT)
+/* the reuseport threads, whose listeners are also in __sstreams */
+static int  __nshards = 0;
+static void shards_stop(void);
+#endif
+
 static void dispatch_close(ACL_EVENT *event);
 static void dispatch_open(ACL_EVENT *event, acl_pthread_pool_t *threads);
 
@@ -248,6 +270,7 @@ static void increase_client_counter(void)
 {
 	lock_counter();
 	__client_count++;
+	__use_count++;
 	unlock_counter();
 }
 
@@ -327,6 +350,17 @@ static void listen_cleanup(ACL_EVENT *event)
 		return;
 	}
 
+#if defined(ACL_UNIX) && defined(SO_REUSEPORT)
+	/* the reuseport threads close their own listeners when they find
+	 * __listen_disabled set.
+	 */
+	if (__nshards > 0) {
+		acl_myfree(__sstreams);
+		__sstreams = NULL;
+		return;
+	}
+#endif
+
 	for (i = 0; __sstreams[i] != NULL; i++) {
 		acl_event_disable_readwrite(event, __sstreams[i]);
 	}
@@ -372,6 +406,16 @@ static void server_exit(void)
 		acl_myfree(acl_var_threads_log_file);
 	}
 
+#if defined(ACL_UNIX) && defined(SO_REUSEPORT)
+	if (__nshards > 0) {
+		if (__sstreams) {
+			acl_myfree(__sstreams);
+			__sstreams = NULL;
+		}
+		shards_stop();
+	}
+#endif
+
 	if (__sstreams) {
 		server_close(__sstreams);
 		__sstreams = NULL;
@@ -614,6 +658,15 @@ static void read_callback2(int event_type, ACL_EVENT *event acl_unused,
 	acl_pthread_pool_add_job(ctx->threads, ctx->job);
 }
 
+/* used by the reuseport thread which handles its connections by itself */
+static void read_callback3(int event_type, ACL_EVENT *event acl_unused,
+	ACL_VSTREAM *stream acl_unused, void *context)
+{
+	READ_CTX *ctx = (READ_CTX*) context;
+	ctx->event_type = event_type;
+	thread_callback(ctx);
+}
+
 static void event_fire_begin(ACL_EVENT *event acl_unused, void *ctx)
 {
 	acl_pthread_pool_t *threads = (acl_pthread_pool_t*) ctx;
@@ -656,6 +709,18 @@ static READ_CTX *create_job(ACL_EVENT *event, acl_pthread_pool_t *threads,
 	ctx->serv_timeout   = __server_on_timeout;
 	ctx->serv_callback  = __service_main;
 	ctx->serv_arg       = __service_ctx;
+
+	/* the connection accepted by one reuseport thread will be handled
+	 * in the same thread and never be put into the threads pool.
+	 */
+	if (threads == NULL) {
+		ctx->job           = NULL;
+		ctx->read_callback = read_callback3;
+		stream->ioctl_read_ctx = ctx;
+		acl_vstream_add_close_handle(stream, free_ctx, ctx);
+		return ctx;
+	}
+
 	ctx->job = acl_pthread_pool_alloc_job(thread_callback, ctx, 1);
 
 	if (acl_var_threads_batadd) {
@@ -682,8 +747,6 @@ static void client_open(ACL_EVENT *event, acl_pthread_pool_t *threads,
 
 	increase_client_counter();
 
-	__use_count++;
-
 	stream = acl_vstream_fdopen(fd, O_RDWR, acl_var_threads_buf_size,
 			acl_var_threads_rw_timeout, ACL_VSTREAM_TYPE_SOCK);
 	if (remote) {
@@ -708,6 +771,9 @@ static void client_open(ACL_EVENT *event, acl_pthread_pool_t *threads,
 			ctx->serv_close(ctx->serv_arg, stream);
 		}
 		acl_vstream_close(stream);
+	} else if (ctx->threads == NULL) {
+		ctx->event_type = ACL_EVENT_ACCEPT;
+		thread_callback(ctx);
 	} else {
 		ctx->event_type = ACL_EVENT_ACCEPT;
 		acl_pthread_pool_add_job(ctx->threads, ctx->job);
@@ -721,6 +787,9 @@ void acl_threads_server_enable_read(ACL_EVENT *event,
 
 	if (ctx == NULL || ctx->read_callback == NULL) {
 		ctx = create_job(event, threads, stream);
+	} else if (ctx->threads == NULL) {
+		/* the stream belongs to the event of one reuseport thread */
+		event = ctx->event;
 	}
 
 	ctx->event_type = ACL_EVENT_READ;
@@ -730,6 +799,11 @@ void acl_threads_server_enable_read(ACL_EVENT *event,
 
 void acl_threads_server_disable_read(ACL_EVENT *event, ACL_VSTREAM *stream)
 {
+	READ_CTX *ctx = (READ_CTX *) stream->ioctl_read_ctx;
+
+	if (ctx != NULL && ctx->threads == NULL && ctx->read_callback) {
+		event = ctx->event;
+	}
 	acl_event_disable_readwrite(event, stream);
 }
 
@@ -743,7 +817,10 @@ static void restart_listen_timer(int type acl_unused,
 	acl_msg_info("restart listen now!");
 
 	acl_assert(__threads);
-	acl_event_enable_listen(event, stream, 0, __server_accept, __threads);
+
+	/* the listener of one reuseport thread isn't in the main event */
+	acl_event_enable_listen(event, stream, 0, __server_accept,
+		event == __event ? __threads : NULL);
 }
 
 /* server_accept_sock - accept client connection request */
@@ -757,12 +834,14 @@ static void server_accept_sock(int event_type, ACL_EVENT *event,
 	char  remote[64], local[64];
 	acl_pthread_pool_t *threads = (acl_pthread_pool_t*) ctx;
 
-	if (__sstreams == NULL) {
+	/* threads is NULL in the reuseport threads with their own listeners */
+	if ((threads != NULL && __sstreams == NULL) || __listen_disabled) {
 		acl_msg_info("Server stoping ...");
 		return;
 	}
 
-	if (event_type != ACL_EVENT_READ) {
+	/* the event of reuseport thread will set ACL_EVENT_ACCEPT also */
+	if ((event_type & ACL_EVENT_READ) == 0) {
 		acl_msg_fatal("%s, %s(%d): unknown event_type(%d)",
 			__FILE__, myname, __LINE__, event_type);
 	}
@@ -1323,6 +1402,296 @@ static ACL_VSTREAM **server_alone_open(ACL_EVENT *event,
 	return streams;
 }
 
+/*==========================================================================*/
+
+/* In the reuseport mode, each of ioctl_reuseport_threads threads owns its
+ * listeners bound with SO_REUSEPORT on the same addrs and its own event,
+ * the kernel spreads the connections among the listeners, and each one is
+ * accepted and handled in the same thread, so there is neither the single
+ * accepting loop nor the shared job queue of the threads pool.
+ */
+
+#if defined(ACL_UNIX) && defined(SO_REUSEPORT)
+
+typedef struct SHARD {
+	acl_pthread_t tid;
+	int           idx;
+	ACL_EVENT    *event;
+	ACL_VSTREAM **sstreams;
+} SHARD;
+
+static SHARD *__shards = NULL;
+static int    __shards_stopping = 0;
+static int    __shards_exited = 0;
+
+static void shard_open(SHARD *shard, int event_mode, ACL_ARGV *tokens)
+{
+	unsigned flag = ACL_INET_FLAG_REUSEPORT;
+	ACL_ITER iter;
+	int i = 0;
+
+	shard->event = acl_event_new(event_mode, 0, acl_var_threads_delay_sec,
+			acl_var_threads_delay_usec);
+	if (acl_var_threads_check_inter >= 0) {
+		acl_event_set_check_inter(shard->event,
+			acl_var_threads_check_inter);
+	}
+
+	shard->sstreams = (ACL_VSTREAM **)
+		acl_mycalloc(tokens->argc + 1, sizeof(ACL_VSTREAM *));
+
+	acl_foreach(iter, tokens) {
+		const char* addr = (const char*) iter.data;
+		ACL_VSTREAM* sstream;
+
+		/* the unix domain socket can't be shared by SO_REUSEPORT,
+		 * which will be listened only by the first thread.
+		 */
+		if (shard->idx > 0 && acl_valid_unix(addr)) {
+			continue;
+		}
+
+		sstream = acl_vstream_listen_ex(addr, 128, flag, 0, 0);
+		if (sstream == NULL) {
+			acl_msg_error("%s(%d): listen %s error(%s)", __FUNCTION__,
+				__LINE__, addr, acl_last_serror());
+			exit(2);
+		}
+
+		acl_non_blocking(ACL_VSTREAM_SOCK(sstream), ACL_NON_BLOCKING);
+		acl_close_on_exec(ACL_VSTREAM_SOCK(sstream), ACL_CLOSE_ON_EXEC);
+		acl_event_enable_listen(shard->event, sstream, 0,
+			__server_accept, NULL);
+
+		if (__server_on_listen) {
+			__server_on_listen(__service_ctx, sstream);
+		}
+		shard->sstreams[i++] = sstream;
+	}
+}
+
+#if defined(ACL_LINUX) && defined(SO_ATTACH_REUSEPORT_CBPF)
+
+/* Steer each connection to the listener whose index in the reuseport group
+ * is the CPU handling the packet modulo the number of threads, together
+ * with ioctl_reuseport_affinity, the connection will be handled on the CPU
+ * which its RX queue is on. The index in the group is the order of binding,
+ * so there should be no other process binding the same addrs, that is,
+ * master_maxproc should be 1.
+ */
+static void shards_attach_cbpf(void)
+{
+	struct sock_filter code[] = {
+		/* A = the current CPU id */
+		{ BPF_LD | BPF_W | BPF_ABS, 0, 0, SKF_AD_OFF + SKF_AD_CPU },
+		/* A = A % the number of threads */
+		{ BPF_ALU | BPF_MOD | BPF_K, 0, 0, 0 },
+		/* return A */
+		{ BPF_RET | BPF_A, 0, 0, 0 },
+	};
+	struct sock_fprog prog;
+	int i;
+
+	code[1].k  = (unsigned) __nshards;
+	prog.len    = sizeof(code) / sizeof(code[0]);
+	prog.filter = code;
+
+	/* attaching to any socket of the group works for the whole group */
+	for (i = 0; __shards[0].sstreams[i] != NULL; i++) {
+		ACL_SOCKET fd = ACL_VSTREAM_SOCK(__shards[0].sstreams[i]);
+
+		if (setsockopt(fd, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF,
+			&prog, sizeof(prog)) < 0) {
+
+			acl_msg_warn("%s(%d): SO_ATTACH_REUSEPORT_CBPF %s error %s",
+				__FUNCTION__, __LINE__,
+				ACL_VSTREAM_LOCAL(__shards[0].sstreams[i]),
+				acl_last_serror());
+		}
+	}
+}
+
+#endif /* ACL_LINUX && SO_ATTACH_REUSEPORT_CBPF */
+
+static void shard_set_affinity(SHARD *shard)
+{
+#ifdef ACL_LINUX
+	long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+	cpu_set_t mask;
+	int ret;
+
+	if (ncpu <= 0) {
+		return;
+	}
+
+	CPU_ZERO(&mask);
+	CPU_SET(shard->idx % ncpu, &mask);
+
+	ret = pthread_setaffinity_np(pthread_self(), sizeof(mask), &mask);
+	if (ret != 0) {
+		acl_msg_warn("%s(%d): bind thread-%d to cpu-%ld error %s",
+			__FUNCTION__, __LINE__, shard->idx,
+			shard->idx % ncpu, strerror(ret));
+	}
+#else
+	(void) shard;
+#endif
+}
+
+static void *shard_main(void *ctx)
+{
+	SHARD *shard = (SHARD *) ctx;
+	int i;
+
+	if (acl_var_threads_reuseport_affinity) {
+		shard_set_affinity(shard);
+	}
+
+	if (__thread_init_fn) {
+		__thread_init_fn(__thread_init_ctx);
+	}
+
+	acl_msg_info("%s(%d): reuseport thread-%d started",
+		__FUNCTION__, __LINE__, shard->idx);
+
+	while (!__listen_disabled && !__shards_stopping) {
+		acl_event_loop(shard->event);
+	}
+
+	/* stop accepting, and go on handling the existing connections
+	 * until the server exits.
+	 */
+	for (i = 0; shard->sstreams[i] != NULL; i++) {
+		acl_event_disable_readwrite(shard->event, shard->sstreams[i]);
+		acl_vstream_close(shard->sstreams[i]);
+		shard->sstreams[i] = NULL;
+	}
+
+	while (!__shards_stopping) {
+		acl_event_loop(shard->event);
+	}
+
+	if (__thread_exit_fn) {
+		__thread_exit_fn(__thread_exit_ctx);
+	}
+
+	acl_msg_info("%s(%d): reuseport thread-%d exit",
+		__FUNCTION__, __LINE__, shard->idx);
+
+	lock_counter();
+	__shards_exited++;
+	unlock_counter();
+	return NULL;
+}
+
+/* called in server_exit, which may be in one of the reuseport threads when
+ * it's idle timeout, wait for the others to run the thread exit callback,
+ * during at most two delays of their event loops.
+ */
+static void shards_stop(void)
+{
+	int i, n, self = 0, wait_ms = 0;
+	int max_ms = (acl_var_threads_delay_sec * 1000
+		+ acl_var_threads_delay_usec / 1000 + 1000) * 2;
+
+	__shards_stopping = 1;
+
+	for (i = 0; i < __nshards; i++) {
+		if (pthread_equal(__shards[i].tid, pthread_self())) {
+			if (__thread_exit_fn) {
+				__thread_exit_fn(__thread_exit_ctx);
+			}
+			self = 1;
+			break;
+		}
+	}
+
+	while (1) {
+		lock_counter();
+		n = __shards_exited;
+		unlock_counter();
+
+		if (n + self >= __nshards) {
+			break;
+		}
+		if (wait_ms >= max_ms) {
+			acl_msg_warn("%s(%d): %d reuseport threads still running",
+				__FUNCTION__, __LINE__, __nshards - n - self);
+			break;
+		}
+		acl_doze(10);
+		wait_ms += 10;
+	}
+}
+
+static void shards_open(int event_mode, const char *addrs)
+{
+	const char *pri = !strcmp(acl_var_threads_master_private, "y") ?
+		"private" : "public";
+	char *unix_path = acl_concatenate(acl_var_threads_queue_dir, "/",
+			pri, NULL);
+	ACL_ARGV *tokens = acl_search_addrs(addrs, unix_path);
+	int i, j, n;
+
+	acl_myfree(unix_path);
+
+	if (tokens == NULL) {
+		acl_msg_fatal("%s(%d), %s: can't find valid addrs from %s",
+			__FILE__, __LINE__, __FUNCTION__, addrs);
+	}
+
+	__nshards = acl_var_threads_reuseport_threads;
+	__shards  = (SHARD *) acl_mycalloc(__nshards, sizeof(SHARD));
+
+	for (i = 0; i < __nshards; i++) {
+		__shards[i].idx = i;
+		shard_open(&__shards[i], event_mode, tokens);
+	}
+
+	/* all the listeners are returned by acl_threads_server_streams() */
+	__sstreams = (ACL_VSTREAM **) acl_mycalloc(
+		__nshards * tokens->argc + 1, sizeof(ACL_VSTREAM *));
+	for (i = 0, n = 0; i < __nshards; i++) {
+		for (j = 0; __shards[i].sstreams[j] != NULL; j++) {
+			__sstreams[n++] = __shards[i].sstreams[j];
+		}
+	}
+
+	acl_argv_free(tokens);
+
+	if (acl_var_threads_reuseport_cbpf) {
+#if defined(ACL_LINUX) && defined(SO_ATTACH_REUSEPORT_CBPF)
+		shards_attach_cbpf();
+#else
+		acl_msg_warn("%s(%d): SO_ATTACH_REUSEPORT_CBPF not supported",
+			__FUNCTION__, __LINE__);
+#endif
+	}
+
+	acl_msg_info("%s(%d): %d reuseport threads listen on %s",
+		__FUNCTION__, __LINE__, __nshards, addrs);
+}
+
+static void shards_start(void)
+{
+	acl_pthread_attr_t attr;
+	int i;
+
+	acl_pthread_attr_init(&attr);
+	acl_pthread_attr_setdetachstate(&attr, ACL_PTHREAD_CREATE_DETACHED);
+	if (acl_var_threads_thread_stacksize > 0) {
+		acl_pthread_attr_setstacksize(&attr,
+			acl_var_threads_thread_stacksize);
+	}
+
+	for (i = 0; i < __nshards; i++) {
+		acl_pthread_create(&__shards[i].tid, &attr, shard_main,
+			&__shards[i]);
+	}
+}
+
+#endif /* ACL_UNIX && SO_REUSEPORT */
+
 static void usage(int argc, char * argv[])
 {
 	if (argc <= 0) {
@@ -1560,6 +1929,10 @@ void acl_threads_server_main(int argc, char * argv[],
 	/* Set up call-back info. */
 	__service_main = service;
 	__service_ctx  = service_ctx;
+	__thread_init_fn  = thread_init_fn;
+	__thread_init_ctx = thread_init_ctx;
+	__thread_exit_fn  = thread_exit_fn;
+	__thread_exit_ctx = thread_exit_ctx;
 	ACL_SAFE_STRNCPY(__service_name, service_name, sizeof(__service_name));
 
 	/*******************************************************************/
@@ -1585,6 +1958,11 @@ void acl_threads_server_main(int argc, char * argv[],
 		if (addrs == NULL || *addrs == 0) {
 			addrs = acl_var_threads_master_service;
 		}
+#if defined(ACL_UNIX) && defined(SO_REUSEPORT)
+		if (acl_var_threads_reuseport_threads > 0) {
+			shards_open(event_mode, addrs);
+		} else
+#endif
 		__sstreams = server_alone_open(__event, __threads, addrs);
 #ifdef ACL_UNIX
 	} else if (var_threads_master_reuseport) {
@@ -1592,9 +1970,19 @@ void acl_threads_server_main(int argc, char * argv[],
 		assert(*acl_var_threads_master_service);
 		addrs = acl_var_threads_master_service;
 
+# ifdef SO_REUSEPORT
+		if (acl_var_threads_reuseport_threads > 0) {
+			shards_open(event_mode, addrs);
+		} else
+# endif
 		__sstreams = server_alone_open(__event, __threads, addrs);
 		server_status_init(__event, __threads);
 	} else if (socket_count > 0) {
+		if (acl_var_threads_reuseport_threads > 0) {
+			acl_msg_warn("%s(%d): ioctl_reuseport_threads ignored"
+				" without master_reuseport", myname, __LINE__);
+		}
+
 		__sstreams = server_daemon_open(__event, __threads,
 			socket_count, fdtype);
 	} else {
@@ -1643,6 +2031,12 @@ void acl_threads_server_main(int argc, char * argv[],
 	}
 #endif
 
+#if defined(ACL_UNIX) && defined(SO_REUSEPORT)
+	if (__nshards > 0) {
+		shards_start();
+	}
+#endif
+
 	acl_server_sighup_setup();
 	acl_server_sigterm_setup();
 
@@ -28,6 +28,13 @@
 #endif
 #include <time.h>
 
+#ifdef ACL_LINUX
+# include <sys/syscall.h>
+# if defined(SYS_recvmmsg) && defined(SYS_sendmmsg) && !defined(ANDROID)
+#  define HAS_MMSG
+# endif
+#endif
+
 #endif /* ACL_UNIX */
 
 /* Utility library. */
@@ -75,6 +82,7 @@ int   acl_var_udp_enable_core;
 int   acl_var_udp_disable_core_onexit;
 int   acl_var_udp_max_debug;
 int   acl_var_udp_threads;
+int   acl_var_udp_batch_count;
 
 static ACL_CONFIG_INT_TABLE __conf_int_tab[] = {
 	{ "udp_bufsize", 4096, &acl_var_udp_buf_size, 0, 0 },
@@ -88,6 +96,7 @@ static ACL_CONFIG_INT_TABLE __conf_int_tab[] = {
 	{ "udp_disable_core_onexit", 1, &acl_var_udp_disable_core_onexit, 0, 0 },
 	{ "master_debug_max", 1000, &acl_var_udp_max_debug, 0, 0 },
 	{ "udp_threads", 1, &acl_var_udp_threads, 0, 0 },
+	{ "udp_batch_count", 32, &acl_var_udp_batch_count, 0, 0 },
 
         { 0, 0, 0, 0, 0 },
 };
@@ -126,6 +135,7 @@ char *acl_var_udp_log_debug;
 char *acl_var_udp_private;
 char *acl_var_udp_reuse_port;
 static int var_udp_reuse_port = 0;
+static int __thread_reuse_port = 0;
 char *acl_var_udp_multicast_addr;
 
 static ACL_CONFIG_STR_TABLE __conf_str_tab[] = {
@@ -147,12 +157,24 @@ typedef struct UDP_SERVER {
 	ACL_VSTREAM **streams;
 	int           count;
 	int           size;
+
+	/* the ring of datagram buffers used in batch mode, which is
+	 * allocated by the server thread itself.
+	 */
+	ACL_UDP_PKT  *pkts;
+	char         *pkts_buf;
+	int           npkts;
+#ifdef HAS_MMSG
+	struct mmsghdr *msgs;
+	struct iovec   *iovs;
+#endif
 } UDP_SERVER;
 
  /*
   * Global state.
   */
 static ACL_UDP_SERVER_FN                __service_main;
+static ACL_UDP_SERVER_BATCH_FN          __service_batch;
 static ACL_MASTER_SERVER_PRE_EXIT_FN    __service_pre_exit;
 static ACL_MASTER_SERVER_EXIT_FN        __service_exit;
 static ACL_MASTER_SERVER_THREAD_INIT_FN __thread_init;
@@ -184,6 +206,14 @@ static ACL_ATOMIC *__servers_count_atomic = NULL;
 #define SOCK		ACL_VSTREAM_SOCK
 #define MAX	1024
 
+/* the max rounds of reading one socket in batch mode in one event loop,
+ * to avoid other sockets in the same thread being starved.
+ */
+#define BATCH_ROUNDS	4
+
+/* the max datagrams sent by one sendmmsg() in acl_udp_server_send_batch */
+#define SEND_BATCH	64
+
 /* forward functions */
 
 static ACL_VSTREAM *server_bind_one(const char *addr);
@@ -547,8 +577,201 @@ static void udp_server_abort(int event_type acl_unused,
 	udp_server_exit();
 }
 
+static void server_batch_init(UDP_SERVER *server)
+{
+	size_t bufsize = acl_var_udp_buf_size > 0 ?
+		(size_t) acl_var_udp_buf_size : 4096;
+	int i;
+
+	server->npkts    = acl_var_udp_batch_count > 0 ?
+		acl_var_udp_batch_count : 1;
+	server->pkts     = (ACL_UDP_PKT *) acl_mycalloc(server->npkts,
+			sizeof(ACL_UDP_PKT));
+	server->pkts_buf = (char *) acl_mymalloc(bufsize * server->npkts);
+#ifdef HAS_MMSG
+	server->msgs     = (struct mmsghdr *) acl_mycalloc(server->npkts,
+			sizeof(struct mmsghdr));
+	server->iovs     = (struct iovec *) acl_mycalloc(server->npkts,
+			sizeof(struct iovec));
+#endif
+
+	for (i = 0; i < server->npkts; i++) {
+		server->pkts[i].buf  = server->pkts_buf + bufsize * i;
+		server->pkts[i].size = bufsize;
+#ifdef HAS_MMSG
+		server->iovs[i].iov_base = server->pkts[i].buf;
+		server->msgs[i].msg_hdr.msg_iov    = &server->iovs[i];
+		server->msgs[i].msg_hdr.msg_iovlen = 1;
+		server->msgs[i].msg_hdr.msg_name   = &server->pkts[i].peer;
+#endif
+	}
+}
+
+static void server_batch_free(UDP_SERVER *server)
+{
+	if (server->pkts == NULL) {
+		return;
+	}
+
+	acl_myfree(server->pkts);
+	acl_myfree(server->pkts_buf);
+	server->pkts  = NULL;
+	server->npkts = 0;
+#ifdef HAS_MMSG
+	acl_myfree(server->msgs);
+	acl_myfree(server->iovs);
+#endif
+}
+
+/* read at most server->npkts datagrams into the ring without blocking,
+ * return the count of datagrams read, or -1 if nothing was read.
+ */
+static int server_batch_recv(UDP_SERVER *server, ACL_VSTREAM *stream)
+{
+#ifdef HAS_MMSG
+	int i, n;
+
+	for (i = 0; i < server->npkts; i++) {
+		server->iovs[i].iov_len = server->pkts[i].size;
+		server->msgs[i].msg_hdr.msg_namelen = sizeof(ACL_SOCKADDR);
+		server->msgs[i].msg_hdr.msg_flags   = 0;
+	}
+
+	n = recvmmsg(SOCK(stream), server->msgs, (unsigned) server->npkts,
+		MSG_DONTWAIT, NULL);
+
+	for (i = 0; i < n; i++) {
+		server->pkts[i].len      = server->msgs[i].msg_len;
+		server->pkts[i].peer_len = server->msgs[i].msg_hdr.msg_namelen;
+
+		if (server->msgs[i].msg_hdr.msg_flags & MSG_TRUNC) {
+			acl_msg_warn("%s(%d): datagram truncated to %ld bytes,"
+				" udp_bufsize should be increased",
+				__FUNCTION__, __LINE__,
+				(long) server->pkts[i].len);
+		}
+	}
+
+	return n > 0 ? n : -1;
+#else
+	int i;
+
+	for (i = 0; i < server->npkts; i++) {
+		ACL_UDP_PKT *pkt = &server->pkts[i];
+		socklen_t len = sizeof(pkt->peer);
+		int flags = 0, ret;
+
+# ifdef MSG_DONTWAIT
+		flags |= MSG_DONTWAIT;
+# else
+		/* only the first reading won't be blocked */
+		if (i > 0) {
+			break;
+		}
+# endif
+		ret = (int) recvfrom(SOCK(stream), pkt->buf, (int) pkt->size,
+				flags, &pkt->peer.sa, &len);
+		if (ret < 0) {
+			break;
+		}
+
+		pkt->len      = (size_t) ret;
+		pkt->peer_len = (size_t) len;
+	}
+
+	return i > 0 ? i : -1;
+#endif
+}
+
+static void udp_server_read_batch(UDP_SERVER *server, ACL_VSTREAM *stream)
+{
+	int i, n;
+
+	if (server->pkts == NULL) {
+		server_batch_init(server);
+	}
+
+	/* the data is read by ourself but not by acl_vstream_read */
+	stream->read_ready = 0;
+
+	for (i = 0; i < BATCH_ROUNDS; i++) {
+		n = server_batch_recv(server, stream);
+		if (n <= 0) {
+			break;
+		}
+
+		__service_batch(__service_ctx, stream, server->pkts, n);
+		acl_atomic_clock_count_add(__clock, n);
+
+		/* the socket's receiving queue has been drained */
+		if (n < server->npkts) {
+			break;
+		}
+	}
+}
+
+int acl_udp_server_send_batch(ACL_VSTREAM *stream,
+	const ACL_UDP_PKT *pkts, int npkts)
+{
+#ifdef HAS_MMSG
+	struct mmsghdr msgs[SEND_BATCH];
+	struct iovec   iovs[SEND_BATCH];
+	int sent = 0;
+
+	while (sent < npkts) {
+		int i, ret, n = npkts - sent;
+
+		if (n > SEND_BATCH) {
+			n = SEND_BATCH;
+		}
+
+		memset(msgs, 0, sizeof(struct mmsghdr) * n);
+
+		for (i = 0; i < n; i++) {
+			const ACL_UDP_PKT *pkt = &pkts[sent + i];
+
+			iovs[i].iov_base = pkt->buf;
+			iovs[i].iov_len  = pkt->len;
+			msgs[i].msg_hdr.msg_iov     = &iovs[i];
+			msgs[i].msg_hdr.msg_iovlen  = 1;
+			msgs[i].msg_hdr.msg_name    = (void *) &pkt->peer;
+			msgs[i].msg_hdr.msg_namelen = (socklen_t) pkt->peer_len;
+		}
+
+		ret = sendmmsg(SOCK(stream), msgs, (unsigned) n, 0);
+		if (ret < 0) {
+			if (acl_last_error() == ACL_EINTR) {
+				continue;
+			}
+			return sent > 0 ? sent : -1;
+		}
+
+		sent += ret;
+		if (ret < n) {
+			break;
+		}
+	}
+
+	return sent;
+#else
+	int i;
+
+	for (i = 0; i < npkts; i++) {
+		const ACL_UDP_PKT *pkt = &pkts[i];
+
+		if (sendto(SOCK(stream), pkt->buf, (int) pkt->len, 0,
+			&pkt->peer.sa, (int) pkt->peer_len) < 0) {
+
+			return i > 0 ? i : -1;
+		}
+	}
+
+	return npkts;
+#endif
+}
+
 static void udp_server_read(int event_type, ACL_EVENT *event acl_unused,
-	ACL_VSTREAM *stream, void *context acl_unused)
+	ACL_VSTREAM *stream, void *context)
 {
 	const char *myname = "udp_server_read";
 
@@ -563,6 +786,12 @@ static void udp_server_read(int event_type, ACL_EVENT *event acl_unused,
 			__FILE__, myname, __LINE__, event_type);
 	}
 
+	if (__service_batch) {
+		udp_server_read_batch((UDP_SERVER *) context, stream);
+		stream->flag = 0;
+		return;
+	}
+
 	/* صûעĴ */
 	__service_main(__service_ctx, stream);
 
@@ -696,7 +925,7 @@ static ACL_VSTREAM *server_bind_one(const char *addr)
 		flag |= ACL_INET_FLAG_NBLOCK;
 	}
 
-	if (var_udp_reuse_port) {
+	if (var_udp_reuse_port || __thread_reuse_port) {
 		flag |= ACL_INET_FLAG_REUSEPORT;
 	}
 
@@ -808,6 +1037,16 @@ static UDP_SERVER *servers_binding(const char *service,
 	__socket_count = ifconf->length;
 	servers = servers_alloc(event_mode, nthreads, __socket_count);
 
+#ifdef SO_REUSEPORT
+	/* each thread binds its own sockets on the same addrs, which must
+	 * be set SO_REUSEPORT so the kernel can spread the datagrams among
+	 * the threads, even if master_reuseport is off in alone mode.
+	 */
+	if (nthreads > 1) {
+		__thread_reuse_port = 1;
+	}
+#endif
+
 	for (i = 0; i < nthreads; i++) {
 		server_binding(&servers[i], ifconf);
 	}
@@ -918,10 +1157,17 @@ static void *thread_main(void *ctx)
 	}
 #endif
 
+	/* allocate the ring in the thread to keep it local to the thread */
+	if (__service_batch) {
+		server_batch_init(server);
+	}
+
 	while (!__service_exiting) {
 		acl_event_loop(server->event);
 	}
 
+	server_batch_free(server);
+
 	acl_msg_info("%s(%d), %s: thread-%lu exit", __FILE__, __LINE__,
 		__FUNCTION__, (unsigned long) acl_pthread_self());
 
@@ -1202,6 +1448,10 @@ void acl_udp_server_main(int argc, char **argv, ACL_UDP_SERVER_FN service, ...)
 			__server_on_unbind =
 				va_arg(ap, ACL_MASTER_SERVER_ON_UNBIND_FN);
 			break;
+		case ACL_MASTER_SERVER_ON_BATCH:
+			__service_batch =
+				va_arg(ap, ACL_UDP_SERVER_BATCH_FN);
+			break;
 		default:
 			acl_msg_panic("%s: unknown type: %d", myname, key);
 		}
@@ -1219,6 +1469,9 @@ void acl_udp_server_main(int argc, char **argv, ACL_UDP_SERVER_FN service, ...)
 
 	/* ûػصز */
 	__service_main = service;
+	if (__service_main == NULL && __service_batch == NULL) {
+		acl_msg_fatal("%s: no service callback set", myname);
+	}
 	__service_name = service_name;
 	__service_argv = argv + optind;
 
@@ -1296,6 +1549,16 @@ void acl_udp_server_main(int argc, char **argv, ACL_UDP_SERVER_FN service, ...)
 
 	acl_msg_info("%s -- %s: daemon started", argv[0], myname);
 
+	if (__service_batch) {
+#ifdef HAS_MMSG
+		const char *how = "recvmmsg";
+#else
+		const char *how = "recvfrom";
+#endif
+		acl_msg_info("%s: batch mode by %s, udp_batch_count=%d",
+			myname, how, acl_var_udp_batch_count);
+	}
+
 	servers_start(__servers, acl_var_udp_threads);
 }
 
@@ -4,10 +4,9 @@
 #include <errno.h>
 #include <string.h>
 #include "stdlib/acl_define.h"
-#include "thread/acl_pthread.h"
 #include "stdlib/acl_msg.h"
 #include "stdlib/acl_mymalloc.h"
-#include "stdlib/acl_ypipe.h"
+#include "stdlib/acl_atomic.h"
 #include "stdlib/acl_vstream.h"
 #include "stdlib/acl_iostuff.h"
 #include "stdlib/acl_sys_patch.h"
@@ -32,13 +31,44 @@
 #  undef  HAS_EVENTFD
 #endif
 
+/*
+ * The messages are pushed by the producers onto a lock-free stack with CAS,
+ * and the consumer takes the whole stack with one exchange and reverses it
+ * into its own FIFO list, so the consumer reads the messages in batches and
+ * there is no ABA problem because only the consumer removes nodes. When the
+ * consumer is going to sleep, it puts MBOX_SLEEPING on the empty stack, and
+ * only the producer replacing it will write the eventfd to wake it up.
+ *
+ * The nodes read are kept by the consumer and returned to the cache of the
+ * mbox in batches, from which the producers take them instead of calling
+ * malloc for each message. The cache is given back only when it's empty,
+ * and one producer at most takes from it with the trylock, or else mallocs,
+ * so no node can be taken and returned while another producer is popping.
+ */
+
+typedef struct MBOX_NODE MBOX_NODE;
+struct MBOX_NODE {
+	void      *msg;
+	MBOX_NODE *next;
+};
+
+static char __sleeping_mark;
+#define MBOX_SLEEPING	((void*) &__sleeping_mark)
+
+/* the max nodes kept by the consumer, the others will be freed */
+#define MBOX_CACHE_MAX	1024
+
 struct ACL_MBOX {
 	ACL_SOCKET in;
 	ACL_SOCKET out;
 	size_t nsend;
 	size_t nread;
-	ACL_YPIPE *ypipe;
-	acl_pthread_mutex_t *lock;
+	ACL_ATOMIC *top;	/* the stack pushed by the producers */
+	MBOX_NODE  *head;	/* the FIFO list owned by the consumer */
+	ACL_ATOMIC *cache;	/* the free nodes taken by the producers */
+	ACL_ATOMIC *cache_lock;	/* held by the producer taking from cache */
+	MBOX_NODE  *free;	/* the free nodes kept by the consumer */
+	int         nfree;
 };
 
 ACL_MBOX *acl_mbox_create(void)
@@ -46,7 +76,7 @@ ACL_MBOX *acl_mbox_create(void)
 	return acl_mbox_create2(ACL_MBOX_T_MPSC);
 }
 
-ACL_MBOX *acl_mbox_create2(unsigned type)
+ACL_MBOX *acl_mbox_create2(unsigned type acl_unused)
 {
 	ACL_MBOX *mbox;
 	ACL_SOCKET fds[2];
@@ -69,39 +99,162 @@ ACL_MBOX *acl_mbox_create2(unsigned type)
 	}
 #endif
 
+	/* The same lock-free queue is used for ACL_MBOX_T_SPSC and
+	 * ACL_MBOX_T_MPSC, the type is kept for compatibility.
+	 */
 	mbox        = (ACL_MBOX *) acl_mymalloc(sizeof(ACL_MBOX));
 	mbox->in    = fds[0];
 	mbox->out   = fds[1];
 	mbox->nsend = 0;
 	mbox->nread = 0;
-	mbox->ypipe = acl_ypipe_new();
+	mbox->top   = acl_atomic_new();
+	mbox->head  = NULL;
+	mbox->cache = acl_atomic_new();
+	mbox->cache_lock = acl_atomic_new();
+	mbox->free  = NULL;
+	mbox->nfree = 0;
 
-	if (type == ACL_MBOX_T_MPSC) {
-		mbox->lock  = (acl_pthread_mutex_t *)
-			acl_mycalloc(1, sizeof(acl_pthread_mutex_t));
+	return mbox;
+}
+
+static long long mbox_now(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return (long long) tv.tv_sec * 1000 + tv.tv_usec / 1000;
+}
+
+/* called by the producers */
+static MBOX_NODE *mbox_node_get(ACL_MBOX *mbox)
+{
+	MBOX_NODE *node = NULL;
 
-		if (acl_pthread_mutex_init(mbox->lock, NULL) != 0) {
-			acl_msg_fatal("%s(%d), %s: pthread_mutex_init error",
-				__FILE__, __LINE__, __FUNCTION__);
+	/* don't wait if another producer is taking from the cache */
+	if (acl_atomic_cas(mbox->cache_lock, NULL, mbox) == NULL) {
+		/* the consumer can only change the cache from NULL */
+		node = (MBOX_NODE *) acl_atomic_cas(mbox->cache, NULL, NULL);
+		if (node != NULL) {
+			(void) acl_atomic_cas(mbox->cache, node, node->next);
 		}
-	} else {
-		mbox->lock = NULL;
+		(void) acl_atomic_cas(mbox->cache_lock, mbox, NULL);
 	}
 
-	return mbox;
+	if (node == NULL) {
+		node = (MBOX_NODE *) acl_mymalloc(sizeof(MBOX_NODE));
+	}
+	return node;
+}
+
+/* give the nodes kept back to the producers if they've used up the cache */
+static void mbox_recycle(ACL_MBOX *mbox)
+{
+	if (mbox->free != NULL
+		&& acl_atomic_cas(mbox->cache, NULL, mbox->free) == NULL) {
+
+		mbox->free  = NULL;
+		mbox->nfree = 0;
+	}
+}
+
+/* called by the consumer */
+static void mbox_node_put(ACL_MBOX *mbox, MBOX_NODE *node)
+{
+	if (mbox->nfree >= MBOX_CACHE_MAX) {
+		mbox_recycle(mbox);
+		if (mbox->nfree >= MBOX_CACHE_MAX) {
+			acl_myfree(node);
+			return;
+		}
+	}
+
+	node->next  = mbox->free;
+	mbox->free  = node;
+	mbox->nfree++;
+}
+
+static void mbox_nodes_free(MBOX_NODE *node)
+{
+	MBOX_NODE *next;
+
+	for (; node != NULL; node = next) {
+		next = node->next;
+		acl_myfree(node);
+	}
+}
+
+static MBOX_NODE *mbox_reverse(MBOX_NODE *node)
+{
+	MBOX_NODE *prev = NULL, *next;
+
+	while (node != NULL) {
+		next       = node->next;
+		node->next = prev;
+		prev       = node;
+		node       = next;
+	}
+	return prev;
+}
+
+/* move all the messages in the stack into the consumer's FIFO list */
+static void mbox_grab(ACL_MBOX *mbox)
+{
+	/* CAS with the same value is used to load the top */
+	void *top = acl_atomic_cas(mbox->top, NULL, NULL);
+
+	mbox_recycle(mbox);
+
+	/* don't take away the mark when the consumer is sleeping */
+	if (top == NULL || top == MBOX_SLEEPING) {
+		return;
+	}
+
+	/* only the consumer can set the top to NULL or MBOX_SLEEPING */
+	top = acl_atomic_xchg(mbox->top, NULL);
+	mbox->head = mbox_reverse((MBOX_NODE *) top);
+}
+
+static void *mbox_pop(ACL_MBOX *mbox)
+{
+	MBOX_NODE *node;
+	void *msg;
+
+	if (mbox->head == NULL) {
+		mbox_grab(mbox);
+		if (mbox->head == NULL) {
+			return NULL;
+		}
+	}
+
+	node       = mbox->head;
+	mbox->head = node->next;
+	msg        = node->msg;
+	mbox_node_put(mbox, node);
+	return msg;
 }
 
 void acl_mbox_free(ACL_MBOX *mbox, void (*free_fn)(void*))
 {
+	void *msg;
+
 	acl_socket_close(mbox->in);
 	if (mbox->out != mbox->in) {
 		acl_socket_close(mbox->out);
 	}
-	acl_ypipe_free(mbox->ypipe, free_fn);
-	if (mbox->lock != NULL) {
-		acl_pthread_mutex_destroy(mbox->lock);
-		acl_myfree(mbox->lock);
+
+	/* remove the mark if the consumer was sleeping */
+	(void) acl_atomic_cas(mbox->top, MBOX_SLEEPING, NULL);
+	while ((msg = mbox_pop(mbox)) != NULL) {
+		if (free_fn) {
+			free_fn(msg);
+		}
 	}
+
+	mbox_nodes_free(mbox->free);
+	mbox_nodes_free((MBOX_NODE *) acl_atomic_xchg(mbox->cache, NULL));
+	acl_atomic_free(mbox->top);
+	acl_atomic_free(mbox->cache);
+	acl_atomic_free(mbox->cache_lock);
 	acl_myfree(mbox);
 }
 
@@ -109,36 +262,29 @@ int acl_mbox_send(ACL_MBOX *mbox, void *msg)
 {
 	int ret;
 	long long n = 1;
-	acl_pthread_mutex_t *lock = mbox->lock;
+	MBOX_NODE *node = mbox_node_get(mbox);
+	void *top, *old;
 
-	if (lock) {
-		acl_pthread_mutex_lock(lock);
-	}
-	acl_ypipe_write(mbox->ypipe, msg);
-	ret = acl_ypipe_flush(mbox->ypipe);
-#if defined(HAS_EVENTFD)
-	if (lock) {
-		acl_pthread_mutex_unlock(lock);
-	}
-#endif
-	if (ret == 0) {
-#if !defined(HAS_EVENTFD)
-		if (lock) {
-			acl_pthread_mutex_unlock(lock);
+	node->msg = msg;
+	top = acl_atomic_cas(mbox->top, NULL, NULL);
+
+	while (1) {
+		node->next = top == MBOX_SLEEPING ? NULL : (MBOX_NODE *) top;
+		old = acl_atomic_cas(mbox->top, top, node);
+		if (old == top) {
+			break;
 		}
-#endif
+		top = old;
+	}
+
+	/* only the first message after the consumer sleeping wakes it up */
+	if (top != MBOX_SLEEPING) {
 		return 0;
 	}
 
 	mbox->nsend++;
 
 	ret = acl_socket_write(mbox->out, &n, sizeof(n), -1, NULL, NULL);
-#if !defined(HAS_EVENTFD)
-	if (lock) {
-		acl_pthread_mutex_unlock(lock);
-	}
-#endif
-
 	if (ret == -1) {
 		acl_msg_error("%s(%d), %s: mbox write %d error %s", __FILE__,
 			__LINE__, __FUNCTION__, mbox->out, acl_last_serror());
@@ -150,52 +296,115 @@ int acl_mbox_send(ACL_MBOX *mbox, void *msg)
 
 void *acl_mbox_read(ACL_MBOX *mbox, int timeout, int *success)
 {
-	int  ret;
-	long long n;
-	void *msg = acl_ypipe_read(mbox->ypipe);
+	int  ret, left = timeout;
+	long long n, expire = 0;
+	void *msg = mbox_pop(mbox);
 
-	if (msg != NULL) {
+	if (msg != NULL || timeout == 0) {
 		if (success) {
 			*success = 1;
 		}
 		return msg;
-	} else if (timeout == 0) {
+	}
+
+	/* tell the producers that we're going to sleep, if some message
+	 * has been pushed before it, just return it.
+	 */
+	if (acl_atomic_cas(mbox->top, NULL, MBOX_SLEEPING) != NULL) {
 		if (success) {
 			*success = 1;
 		}
-		return NULL;
+		return mbox_pop(mbox);
 	}
 
 	mbox->nread++;
 
+	if (timeout > 0) {
+		expire = mbox_now() + timeout;
+	}
+
+	while (1) {
+		/* wait for the time left only after a stale notification */
+		if (timeout > 0) {
+			left = (int) (expire - mbox_now());
+			if (left < 0) {
+				left = 0;
+			}
+		}
+
 #ifdef ACL_UNIX
-	if (timeout > 0 && acl_read_poll_wait(mbox->in, timeout) < 0) {
+		if (timeout > 0 && acl_read_poll_wait(mbox->in, left) < 0) {
 #else
-	if (timeout > 0 && acl_read_select_wait(mbox->in, timeout) < 0) {
+		if (timeout > 0 && acl_read_select_wait(mbox->in, left) < 0) {
 #endif
-		if (acl_last_error() == ACL_ETIMEDOUT) {
+			int timedout = acl_last_error() == ACL_ETIMEDOUT;
+
+			/* wakeup by ourselves if no message was sent, or
+			 * else the notification will be read next time.
+			 */
+			if (acl_atomic_cas(mbox->top, MBOX_SLEEPING, NULL)
+				!= MBOX_SLEEPING) {
+
+				if (success) {
+					*success = 1;
+				}
+				return mbox_pop(mbox);
+			}
+
+			if (success) {
+				*success = timedout ? 1 : 0;
+			}
+			return NULL;
+		}
+
+		ret = acl_socket_read(mbox->in, &n, sizeof(n), -1, NULL, NULL);
+		if (ret == -1) {
+			(void) acl_atomic_cas(mbox->top, MBOX_SLEEPING, NULL);
+			if (success) {
+				*success = 0;
+			}
+			return NULL;
+		}
+
+		msg = mbox_pop(mbox);
+		if (msg != NULL) {
 			if (success) {
 				*success = 1;
 			}
-		} else if (success) {
-			*success = 0;
+			return msg;
 		}
-		return NULL;
+
+		/* the notification left by the last timeout was read and
+		 * we're still sleeping, so wait again.
+		 */
 	}
+}
 
-	ret = acl_socket_read(mbox->in, &n, sizeof(n), -1, NULL, NULL);
-	if (ret == -1) {
+int acl_mbox_read_batch(ACL_MBOX *mbox, void *msgs[], int max,
+	int timeout, int *success)
+{
+	int n = 0;
+
+	if (max <= 0) {
 		if (success) {
-			*success = 0;
+			*success = 1;
 		}
-		return NULL;
+		return 0;
+	}
+
+	msgs[0] = acl_mbox_read(mbox, timeout, success);
+	if (msgs[0] == NULL) {
+		return 0;
 	}
 
-	if (success) {
-		*success = 1;
+	for (n = 1; n < max; n++) {
+		msgs[n] = mbox_pop(mbox);
+		if (msgs[n] == NULL) {
+			break;
+		}
 	}
 
-	return acl_ypipe_read(mbox->ypipe);
+	return n;
 }
 
 size_t acl_mbox_nsend(ACL_MBOX *mbox)
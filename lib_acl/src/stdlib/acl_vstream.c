@@ -1663,6 +1663,16 @@ TAG_AGAIN:
 			fp->rw_timeout, fp, fp->context);
 	}
 
+	/* the writev hooked together with the write, such as the one for
+	 * SSL, can handle all the vectors in one call; the writev_fn set
+	 * by acl_socket_writev_hook() alone is not used for the streams
+	 * with their own write_fn, which would skip their framing */
+	else if ((fp->flag & ACL_VSTREAM_FLAG_WRITEV_HOOK)
+		&& fp->writev_fn != NULL) {
+		n = fp->writev_fn(ACL_VSTREAM_SOCK(fp), vec, count,
+			fp->rw_timeout, fp, fp->context);
+	}
+
 	/* ģ writev ĵù */
 	else {
 		int i, ret;
@@ -0,0 +1,524 @@
+#include "StdAfx.h"
+#ifndef ACL_PREPARE_COMPILE
+
+#include "stdlib/acl_define.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#ifdef ACL_BCB_COMPILER
+#pragma hdrstop
+#endif
+
+#include "thread/acl_pthread.h"
+#include "stdlib/acl_mymalloc.h"
+#include "stdlib/acl_msg.h"
+#include "stdlib/acl_hash.h"
+#include "stdlib/acl_chtable.h"
+
+#endif
+
+typedef struct CHTABLE_NODE CHTABLE_NODE;
+
+struct CHTABLE_NODE {
+	CHTABLE_NODE *next;
+	acl_uint64    hash;
+	void         *value;
+	size_t        klen;
+	char          key[1];	/* the key is allocated with the node */
+};
+
+typedef struct CHTABLE_SHARD {
+	acl_pthread_mutex_t lock;
+	CHTABLE_NODE **buckets;
+	unsigned       mask;	/* the number of buckets - 1 */
+	unsigned       used;
+} CHTABLE_SHARD;
+
+/* each shard takes whole cache lines, so that the threads locking the
+ * adjacent shards won't write to the same cache line.
+ */
+#define	CACHE_LINE	64
+#define	SHARD_SIZE	((sizeof(CHTABLE_SHARD) + CACHE_LINE - 1) \
+				& ~((size_t) CACHE_LINE - 1))
+
+struct ACL_CHTABLE {
+	char    *shards_buf;	/* the shards, aligned with CACHE_LINE */
+	void    *shards_ptr;	/* the memory allocated for the shards */
+	unsigned nshards;
+	unsigned shift;		/* 64 - log2(nshards) */
+	unsigned flag;
+};
+
+#define	SHARD_AT(_table, _i) \
+	((CHTABLE_SHARD *) ((_table)->shards_buf + SHARD_SIZE * (_i)))
+
+/* the high bits select the shard and the low bits select the bucket, so
+ * the keys in one shard still spread over all of its buckets.
+ */
+#define	SHARD_OF(_table, _hash) \
+	SHARD_AT((_table), (_table)->shift >= 64 ? 0 : \
+		(unsigned) ((_hash) >> (_table)->shift))
+
+#define	LOCK_SHARD(_shard) do { \
+	int _ret = acl_pthread_mutex_lock(&(_shard)->lock); \
+	if (_ret) { \
+		acl_msg_fatal("%s(%d): lock error(%s)", \
+			__FILE__, __LINE__, strerror(_ret)); \
+	} \
+} while (0)
+
+#define	UNLOCK_SHARD(_shard) do { \
+	int _ret = acl_pthread_mutex_unlock(&(_shard)->lock); \
+	if (_ret) { \
+		acl_msg_fatal("%s(%d): unlock error(%s)", \
+			__FILE__, __LINE__, strerror(_ret)); \
+	} \
+} while (0)
+
+static unsigned round_pow2(unsigned n)
+{
+	unsigned r = 1;
+
+	while (r < n && r < (1U << 30)) {
+		r <<= 1;
+	}
+	return r;
+}
+
+static int shard_init(CHTABLE_SHARD *shard, unsigned size)
+{
+	int ret = acl_pthread_mutex_init(&shard->lock, NULL);
+
+	if (ret) {
+		acl_msg_error("%s(%d): init mutex error(%s)",
+			__FILE__, __LINE__, strerror(ret));
+		return -1;
+	}
+
+	shard->buckets = (CHTABLE_NODE **)
+		acl_mycalloc(size, sizeof(CHTABLE_NODE *));
+	shard->mask    = size - 1;
+	shard->used    = 0;
+	return 0;
+}
+
+/* double the buckets of one shard with the shard locked, the hash of each
+ * node has been saved, so the keys needn't be hashed again.
+ */
+static void shard_grow(CHTABLE_SHARD *shard)
+{
+	unsigned old_size = shard->mask + 1, size = old_size << 1, i;
+	CHTABLE_NODE **buckets, *node, *next;
+
+	if (size == 0 || size > (1U << 30)) {
+		return;
+	}
+
+	buckets = (CHTABLE_NODE **) acl_mycalloc(size, sizeof(CHTABLE_NODE *));
+
+	for (i = 0; i < old_size; i++) {
+		for (node = shard->buckets[i]; node != NULL; node = next) {
+			unsigned n = (unsigned) node->hash & (size - 1);
+
+			next       = node->next;
+			node->next = buckets[n];
+			buckets[n] = node;
+		}
+	}
+
+	acl_myfree(shard->buckets);
+	shard->buckets = buckets;
+	shard->mask    = size - 1;
+}
+
+static void shard_clear(CHTABLE_SHARD *shard, void (*free_fn) (void *))
+{
+	CHTABLE_NODE *node, *next;
+	unsigned i;
+
+	for (i = 0; i <= shard->mask; i++) {
+		for (node = shard->buckets[i]; node != NULL; node = next) {
+			next = node->next;
+			if (free_fn && node->value) {
+				free_fn(node->value);
+			}
+			acl_myfree(node);
+		}
+		shard->buckets[i] = NULL;
+	}
+
+	shard->used = 0;
+}
+
+/* find the node and the link pointing to it in the bucket */
+static CHTABLE_NODE **shard_link(CHTABLE_SHARD *shard, acl_uint64 hash,
+	const char *key, size_t klen)
+{
+	CHTABLE_NODE **link = &shard->buckets[(unsigned) hash & shard->mask];
+
+	for (; *link != NULL; link = &(*link)->next) {
+		if ((*link)->hash == hash && (*link)->klen == klen
+			&& memcmp((*link)->key, key, klen) == 0) {
+
+			break;
+		}
+	}
+
+	return link;
+}
+
+ACL_CHTABLE *acl_chtable_create(int size, int nshards, unsigned int flag)
+{
+	ACL_CHTABLE *table;
+	unsigned i, per_shard;
+
+	if (nshards <= 0) {
+		nshards = 16;
+	}
+	if (size <= 0) {
+		size = 1;
+	}
+
+	table = (ACL_CHTABLE *) acl_mycalloc(1, sizeof(ACL_CHTABLE));
+	table->flag    = flag;
+	table->nshards = round_pow2((unsigned) nshards);
+	table->shift   = 64;
+	for (i = table->nshards; i > 1; i >>= 1) {
+		table->shift--;
+	}
+
+	table->shards_ptr = acl_mycalloc(table->nshards + 1, SHARD_SIZE);
+	table->shards_buf = (char *) table->shards_ptr + CACHE_LINE
+		- ((size_t) table->shards_ptr & (CACHE_LINE - 1));
+
+	per_shard = round_pow2(((unsigned) size + table->nshards - 1)
+			/ table->nshards);
+	if (per_shard < 8) {
+		per_shard = 8;
+	}
+
+	for (i = 0; i < table->nshards; i++) {
+		if (shard_init(SHARD_AT(table, i), per_shard) == 0) {
+			continue;
+		}
+
+		while (i-- > 0) {
+			CHTABLE_SHARD *shard = SHARD_AT(table, i);
+
+			acl_myfree(shard->buckets);
+			acl_pthread_mutex_destroy(&shard->lock);
+		}
+		acl_myfree(table->shards_ptr);
+		acl_myfree(table);
+		return NULL;
+	}
+
+	return table;
+}
+
+/* the key is lowercased into buf if ACL_HTABLE_FLAG_KEY_LOWER was set, and
+ * buf will be allocated if it's too small, which should be freed by caller.
+ */
+#define	KEY_BUF_SIZE	256
+
+static const char *key_prepare(const ACL_CHTABLE *table, const char *key,
+	size_t *klen, char *buf, char **dynbuf)
+{
+	char *out;
+	size_t i;
+
+	*klen   = strlen(key);
+	*dynbuf = NULL;
+
+	if (!(table->flag & ACL_HTABLE_FLAG_KEY_LOWER)) {
+		return key;
+	}
+
+	if (*klen < KEY_BUF_SIZE) {
+		out = buf;
+	} else {
+		out = *dynbuf = (char *) acl_mymalloc(*klen + 1);
+	}
+
+	for (i = 0; i < *klen; i++) {
+		out[i] = (char) tolower((unsigned char) key[i]);
+	}
+	out[*klen] = 0;
+	return out;
+}
+
+int acl_chtable_enter(ACL_CHTABLE *table, const char *key_in,
+	void *value, void **old_holder)
+{
+	char buf[KEY_BUF_SIZE], *dynbuf;
+	CHTABLE_SHARD *shard;
+	CHTABLE_NODE **link, *node;
+	const char *key;
+	acl_uint64 hash;
+	size_t klen;
+	int status;
+
+	if (table == NULL || key_in == NULL) {
+		return ACL_HTABLE_STAT_INVAL;
+	}
+
+	key   = key_prepare(table, key_in, &klen, buf, &dynbuf);
+	hash  = acl_hash_wyhash(key, klen, 0);
+	shard = SHARD_OF(table, hash);
+
+	LOCK_SHARD(shard);
+
+	link = shard_link(shard, hash, key, klen);
+	if (*link != NULL) {
+		if (old_holder) {
+			*old_holder    = (*link)->value;
+			(*link)->value = value;
+		}
+		status = ACL_HTABLE_STAT_DUPLEX_KEY;
+	} else {
+		node = (CHTABLE_NODE *) acl_mymalloc(sizeof(CHTABLE_NODE) + klen);
+		node->hash  = hash;
+		node->value = value;
+		node->klen  = klen;
+		memcpy(node->key, key, klen + 1);
+
+		node->next = *link;
+		*link      = node;
+		status     = ACL_HTABLE_STAT_OK;
+
+		if (++shard->used > shard->mask + 1) {
+			shard_grow(shard);
+		}
+	}
+
+	UNLOCK_SHARD(shard);
+
+	if (dynbuf) {
+		acl_myfree(dynbuf);
+	}
+	return status;
+}
+
+void *acl_chtable_find(ACL_CHTABLE *table, const char *key_in)
+{
+	char buf[KEY_BUF_SIZE], *dynbuf;
+	CHTABLE_SHARD *shard;
+	CHTABLE_NODE *node;
+	const char *key;
+	acl_uint64 hash;
+	size_t klen;
+	void *value;
+
+	if (table == NULL || key_in == NULL) {
+		return NULL;
+	}
+
+	key   = key_prepare(table, key_in, &klen, buf, &dynbuf);
+	hash  = acl_hash_wyhash(key, klen, 0);
+	shard = SHARD_OF(table, hash);
+
+	LOCK_SHARD(shard);
+	node  = *shard_link(shard, hash, key, klen);
+	value = node ? node->value : NULL;
+	UNLOCK_SHARD(shard);
+
+	if (dynbuf) {
+		acl_myfree(dynbuf);
+	}
+	return value;
+}
+
+/* unlink the node of the key, and call free_fn or return the value */
+static int chtable_unlink(ACL_CHTABLE *table, const char *key_in,
+	void (*free_fn) (void *), void **value)
+{
+	char buf[KEY_BUF_SIZE], *dynbuf;
+	CHTABLE_SHARD *shard;
+	CHTABLE_NODE **link, *node;
+	const char *key;
+	acl_uint64 hash;
+	size_t klen;
+
+	if (table == NULL || key_in == NULL) {
+		return -1;
+	}
+
+	key   = key_prepare(table, key_in, &klen, buf, &dynbuf);
+	hash  = acl_hash_wyhash(key, klen, 0);
+	shard = SHARD_OF(table, hash);
+
+	LOCK_SHARD(shard);
+
+	link = shard_link(shard, hash, key, klen);
+	if ((node = *link) != NULL) {
+		*link = node->next;
+		shard->used--;
+		if (free_fn && node->value) {
+			free_fn(node->value);
+		}
+	}
+
+	UNLOCK_SHARD(shard);
+
+	if (dynbuf) {
+		acl_myfree(dynbuf);
+	}
+
+	if (node == NULL) {
+		return -1;
+	}
+
+	if (value) {
+		*value = node->value;
+	}
+	acl_myfree(node);
+	return 0;
+}
+
+int acl_chtable_delete(ACL_CHTABLE *table, const char *key,
+	void (*free_fn) (void *))
+{
+	return chtable_unlink(table, key, free_fn, NULL);
+}
+
+void *acl_chtable_remove(ACL_CHTABLE *table, const char *key)
+{
+	void *value = NULL;
+
+	(void) chtable_unlink(table, key, NULL, &value);
+	return value;
+}
+
+void acl_chtable_free(ACL_CHTABLE *table, void (*free_fn) (void *))
+{
+	unsigned i;
+
+	if (table == NULL) {
+		return;
+	}
+
+	for (i = 0; i < table->nshards; i++) {
+		CHTABLE_SHARD *shard = SHARD_AT(table, i);
+
+		shard_clear(shard, free_fn);
+		acl_myfree(shard->buckets);
+		acl_pthread_mutex_destroy(&shard->lock);
+	}
+
+	acl_myfree(table->shards_ptr);
+	acl_myfree(table);
+}
+
+int acl_chtable_reset(ACL_CHTABLE *table, void (*free_fn) (void *))
+{
+	unsigned i;
+
+	if (table == NULL) {
+		return -1;
+	}
+
+	for (i = 0; i < table->nshards; i++) {
+		CHTABLE_SHARD *shard = SHARD_AT(table, i);
+
+		LOCK_SHARD(shard);
+		shard_clear(shard, free_fn);
+		UNLOCK_SHARD(shard);
+	}
+
+	return 0;
+}
+
+void acl_chtable_walk(ACL_CHTABLE *table,
+	void (*walk_fn) (const char *, void *, void *), void *arg)
+{
+	CHTABLE_NODE *node;
+	unsigned i, j;
+
+	if (table == NULL || walk_fn == NULL) {
+		return;
+	}
+
+	for (i = 0; i < table->nshards; i++) {
+		CHTABLE_SHARD *shard = SHARD_AT(table, i);
+
+		LOCK_SHARD(shard);
+		for (j = 0; j <= shard->mask; j++) {
+			for (node = shard->buckets[j]; node; node = node->next) {
+				walk_fn(node->key, node->value, arg);
+			}
+		}
+		UNLOCK_SHARD(shard);
+	}
+}
+
+int acl_chtable_size(const ACL_CHTABLE *table)
+{
+	unsigned i;
+	int n = 0;
+
+	if (table == NULL) {
+		return 0;
+	}
+
+	for (i = 0; i < table->nshards; i++) {
+		n += (int) SHARD_AT(table, i)->mask + 1;
+	}
+	return n;
+}
+
+int acl_chtable_used(const ACL_CHTABLE *table)
+{
+	unsigned i;
+	int n = 0;
+
+	if (table == NULL) {
+		return 0;
+	}
+
+	for (i = 0; i < table->nshards; i++) {
+		n += (int) SHARD_AT(table, i)->used;
+	}
+	return n;
+}
+
+int acl_chtable_nshards(const ACL_CHTABLE *table)
+{
+	return table ? (int) table->nshards : 0;
+}
+
+void acl_chtable_stat(const ACL_CHTABLE *table)
+{
+	CHTABLE_NODE *node;
+	unsigned i, j;
+
+	if (table == NULL) {
+		return;
+	}
+
+	for (i = 0; i < table->nshards; i++) {
+		CHTABLE_SHARD *shard = SHARD_AT(table, i);
+		unsigned empty = 0, max_chain = 0;
+
+		LOCK_SHARD(shard);
+		for (j = 0; j <= shard->mask; j++) {
+			unsigned count = 0;
+
+			for (node = shard->buckets[j]; node; node = node->next) {
+				count++;
+			}
+			if (count == 0) {
+				empty++;
+			} else if (count > max_chain) {
+				max_chain = count;
+			}
+		}
+		printf("shard[%u]: size=%u, used=%u, empty=%u, max chain=%u\n",
+			i, shard->mask + 1, shard->used, empty, max_chain);
+		UNLOCK_SHARD(shard);
+	}
+
+	printf("chtable shards=%u, size=%d, used=%d\n", table->nshards,
+		acl_chtable_size(table), acl_chtable_used(table));
+}
@@ -3,6 +3,7 @@
 
 #include "stdlib/acl_define.h"
 #include <stdlib.h>
+#include <string.h>
 
 #ifdef ACL_BCB_COMPILER
 #pragma hdrstop
@@ -613,3 +614,134 @@ unsigned acl_hash_func6(const void *buf, size_t len)
 	i = n ^ (j * 271);
 	return i;
 }
+
+/*
+ * wyhash (final version 4) by Wang Yi, which is released into the public
+ * domain: https://github.com/wangyi-fudan/wyhash
+ */
+
+#if defined(_MSC_VER) && defined(_M_X64)
+# include <intrin.h>
+# pragma intrinsic(_umul128)
+#endif
+
+static const acl_uint64 __wyp[4] = {
+	0xa0761d6478bd642fULL, 0xe7037ed1a0b428dbULL,
+	0x8ebc6af09c88c6e3ULL, 0x589965cc75374cc3ULL,
+};
+
+/* multiply a and b to 128 bits, and store the low 64 bits into a and the
+ * high 64 bits into b.
+ */
+static void wymum(acl_uint64 *a, acl_uint64 *b)
+{
+#if defined(__SIZEOF_INT128__)
+	__uint128_t r = *a;
+
+	r *= *b;
+	*a = (acl_uint64) r;
+	*b = (acl_uint64) (r >> 64);
+#elif defined(_MSC_VER) && defined(_M_X64)
+	*a = _umul128(*a, *b, b);
+#else
+	acl_uint64 ha = *a >> 32, hb = *b >> 32;
+	acl_uint64 la = (unsigned) *a, lb = (unsigned) *b;
+	acl_uint64 rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+	acl_uint64 t = rl + (rm0 << 32), c = t < rl, lo;
+
+	lo = t + (rm1 << 32);
+	c += lo < t;
+	*a = lo;
+	*b = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+#endif
+}
+
+static acl_uint64 wymix(acl_uint64 a, acl_uint64 b)
+{
+	wymum(&a, &b);
+	return a ^ b;
+}
+
+/* the bytes are read in the native order, so the hash values on the big
+ * endian machines are different from those on the little endian ones.
+ */
+static acl_uint64 wyr8(const unsigned char *p)
+{
+	acl_uint64 v;
+
+	memcpy(&v, p, 8);
+	return v;
+}
+
+static acl_uint64 wyr4(const unsigned char *p)
+{
+	unsigned v;
+
+	memcpy(&v, p, 4);
+	return v;
+}
+
+static acl_uint64 wyr3(const unsigned char *p, size_t k)
+{
+	return (((acl_uint64) p[0]) << 16) | (((acl_uint64) p[k >> 1]) << 8)
+		| p[k - 1];
+}
+
+acl_uint64 acl_hash_wyhash(const void *buf, size_t len, acl_uint64 seed)
+{
+	const unsigned char *p = (const unsigned char *) buf;
+	acl_uint64 a, b;
+
+	seed ^= wymix(seed ^ __wyp[0], __wyp[1]);
+
+	if (len <= 16) {
+		if (len >= 4) {
+			a = (wyr4(p) << 32) | wyr4(p + ((len >> 3) << 2));
+			b = (wyr4(p + len - 4) << 32)
+				| wyr4(p + len - 4 - ((len >> 3) << 2));
+		} else if (len > 0) {
+			a = wyr3(p, len);
+			b = 0;
+		} else {
+			a = b = 0;
+		}
+	} else {
+		size_t i = len;
+
+		if (i > 48) {
+			acl_uint64 see1 = seed, see2 = seed;
+
+			do {
+				seed = wymix(wyr8(p) ^ __wyp[1],
+					wyr8(p + 8) ^ seed);
+				see1 = wymix(wyr8(p + 16) ^ __wyp[2],
+					wyr8(p + 24) ^ see1);
+				see2 = wymix(wyr8(p + 32) ^ __wyp[3],
+					wyr8(p + 40) ^ see2);
+				p += 48;
+				i -= 48;
+			} while (i > 48);
+
+			seed ^= see1 ^ see2;
+		}
+
+		while (i > 16) {
+			seed = wymix(wyr8(p) ^ __wyp[1], wyr8(p + 8) ^ seed);
+			i -= 16;
+			p += 16;
+		}
+
+		a = wyr8(p + i - 16);
+		b = wyr8(p + i - 8);
+	}
+
+	a ^= __wyp[1];
+	b ^= seed;
+	wymum(&a, &b);
+	return wymix(a ^ __wyp[0] ^ len, b ^ __wyp[1]);
+}
+
+unsigned acl_hash_wy(const void *buf, size_t len)
+{
+	return (unsigned) acl_hash_wyhash(buf, len, 0);
+}
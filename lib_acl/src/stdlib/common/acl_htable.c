@@ -20,12 +20,16 @@
 
 #endif
 
+static void htable_rehash_finish(ACL_HTABLE *table);
+
 /* htable_iter_head */
 
 static void *htable_iter_head(ACL_ITER *iter, ACL_HTABLE *table)
 {
 	ACL_HTABLE_INFO *ptr = NULL;
 
+	htable_rehash_finish(table);
+
 	iter->dlen = -1;
 	iter->klen = -1;
 	iter->i = 0;
@@ -88,6 +92,8 @@ static void *htable_iter_tail(ACL_ITER *iter, ACL_HTABLE *table)
 {
 	ACL_HTABLE_INFO *ptr = NULL;
 
+	htable_rehash_finish(table);
+
 	iter->dlen = -1;
 	iter->klen = -1;
 	iter->i = table->size - 1;
@@ -184,6 +190,70 @@ static unsigned __def_hash_fn(const void *buffer, size_t len)
 	_table->used++; \
 }
 
+/* htable_unlink - remove element from the bucket which it's in */
+
+#define htable_unlink(_h, _element) { \
+	if (_element->next) \
+		_element->next->prev = _element->prev; \
+	if (_element->prev) \
+		_element->prev->next = _element->next; \
+	else \
+		*(_h) = _element->next; \
+}
+
+/* htable_alloc/htable_free_ptr - use the slice pool if the table has one */
+
+static void *htable_alloc(ACL_HTABLE *table, size_t size)
+{
+	if (table->slice) {
+		return acl_slice_pool_alloc(__FILE__, __LINE__,
+				table->slice, size);
+	}
+	return acl_mymalloc(size);
+}
+
+static void htable_free_ptr(ACL_HTABLE *table, void *ptr)
+{
+	if (table->slice) {
+		acl_slice_pool_free(__FILE__, __LINE__, ptr);
+	} else {
+		acl_myfree(ptr);
+	}
+}
+
+/* htable_entry_new - the copied key is allocated together with the entry,
+ * so there's only one allocation for each entry.
+ */
+
+static ACL_HTABLE_INFO *htable_entry_new(ACL_HTABLE *table, const char *key,
+	unsigned hash, void *value)
+{
+	ACL_HTABLE_INFO *ht;
+
+	if ((table->flag & ACL_HTABLE_FLAG_KEY_REUSE)) {
+		ht = (ACL_HTABLE_INFO *) htable_alloc(table,
+				sizeof(ACL_HTABLE_INFO));
+		if (ht == NULL) {
+			return NULL;
+		}
+		ht->key.c_key = key;
+	} else {
+		size_t len = strlen(key) + 1;
+
+		ht = (ACL_HTABLE_INFO *) htable_alloc(table,
+				sizeof(ACL_HTABLE_INFO) + len);
+		if (ht == NULL) {
+			return NULL;
+		}
+		ht->key.key = (char *) (ht + 1);
+		memcpy(ht->key.key, key, len);
+	}
+
+	ht->hash  = hash;
+	ht->value = value;
+	return ht;
+}
+
 /* htable_size - allocate and initialize hash table */
 
 static int htable_size(ACL_HTABLE *table, unsigned size)
@@ -193,61 +263,203 @@ static int htable_size(ACL_HTABLE *table, unsigned size)
 	size |= 1;
 
 	if (table->slice) {
-		table->data = h = (ACL_HTABLE_INFO **)
-			acl_slice_pool_alloc(__FILE__, __LINE__, table->slice,
-					size * sizeof(ACL_HTABLE_INFO *));
+		table->data = h = (ACL_HTABLE_INFO **) acl_slice_pool_calloc(
+			__FILE__, __LINE__, table->slice, size,
+			sizeof(ACL_HTABLE_INFO *));
 	} else {
-		table->data = h = (ACL_HTABLE_INFO **)
-			acl_mymalloc(size * sizeof(ACL_HTABLE_INFO *));
+		table->data = h = (ACL_HTABLE_INFO **) acl_mycalloc(size,
+			sizeof(ACL_HTABLE_INFO *));
 	}
 
-	if(table->data == NULL) {
+	if(h == NULL) {
 		return -1;
 	}
 
 	table->size = size;
 	table->used = 0;
+	return 0;
+}
 
-	while (size-- > 0) {
-		*h++ = 0;
+/* htable_rehash_bucket - move all entries of one old bucket into the new
+ * entries array, the stored hash is used, so no key is hashed again.
+ */
+
+static void htable_rehash_bucket(ACL_HTABLE *table, ACL_HTABLE_INFO **h0)
+{
+	ACL_HTABLE_INFO *ht, *next;
+	unsigned n;
+
+	for (ht = *h0; ht; ht = next) {
+		next = ht->next;
+		n = ht->hash % table->size;
+		htable_link(table, ht, n);
+		table->used--;  /* the entry has been counted */
 	}
+	*h0 = NULL;
+}
 
-	return 0;
+/* htable_rehash_end - free the old entries array after all moved */
+
+static void htable_rehash_end(ACL_HTABLE *table)
+{
+	htable_free_ptr(table, table->rehash_data);
+	table->rehash_data = NULL;
+	table->rehash_size = 0;
+	table->rehash_idx  = 0;
+}
+
+/* the number of old buckets with entries to be moved in each step, and the
+ * max number of empty old buckets to be visited in each step.
+ */
+
+#define	REHASH_STEP		2
+#define	REHASH_EMPTY_VISITS	(REHASH_STEP * 10)
+
+/* htable_rehash_step - move a few buckets of the old entries array */
+
+static void htable_rehash_step(ACL_HTABLE *table)
+{
+	int n = REHASH_STEP, empty = REHASH_EMPTY_VISITS;
+
+	while (n > 0 && table->rehash_idx < table->rehash_size) {
+		ACL_HTABLE_INFO **h0 = table->rehash_data + table->rehash_idx;
+
+		table->rehash_idx++;
+		if (*h0 == NULL) {
+			if (--empty == 0) {
+				break;
+			}
+			continue;
+		}
+
+		htable_rehash_bucket(table, h0);
+		n--;
+	}
+
+	if (table->rehash_idx >= table->rehash_size) {
+		htable_rehash_end(table);
+	}
+}
+
+/* htable_rehash_finish - move all the rest of old buckets */
+
+static void htable_rehash_finish(ACL_HTABLE *table)
+{
+	if (table->rehash_data == NULL) {
+		return;
+	}
+
+	for (; table->rehash_idx < table->rehash_size; table->rehash_idx++) {
+		htable_rehash_bucket(table,
+			table->rehash_data + table->rehash_idx);
+	}
+
+	htable_rehash_end(table);
 }
 
 /* htable_grow - extend existing table */
 
 static int htable_grow(ACL_HTABLE *table)
 {
-	int ret;
-	ACL_HTABLE_INFO *ht;
-	ACL_HTABLE_INFO *next;
-	unsigned old_size = table->size;
-	ACL_HTABLE_INFO **h0 = table->data;
-	ACL_HTABLE_INFO **old_entries = h0;
-	unsigned n;
+	int ret, old_used;
+	unsigned old_size;
+	ACL_HTABLE_INFO **h0, **old_entries;
+
+	/* the table can't have three entries arrays */
+	htable_rehash_finish(table);
+
+	old_size = table->size;
+	old_used = table->used;
+	old_entries = h0 = table->data;
 
 	ret = htable_size(table, 2 * old_size);
 	if (ret < 0) {
 		return -1;
 	}
 
+	table->used = old_used;
+
+	if ((table->flag & ACL_HTABLE_FLAG_INCR_REHASH)) {
+		table->rehash_data = old_entries;
+		table->rehash_size = (int) old_size;
+		table->rehash_idx  = 0;
+		return 0;
+	}
+
 	while (old_size-- > 0) {
-		for (ht = *h0++; ht; ht = next) {
-			next = ht->next;
-			n = table->hash_fn(ht->key.c_key,
-				strlen(ht->key.c_key)) % table->size;
-			htable_link(table, ht, n);
+		htable_rehash_bucket(table, h0++);
+	}
+
+	htable_free_ptr(table, old_entries);
+	return 0;
+}
+
+/* htable_bucket - the bucket which the entry is in */
+
+static ACL_HTABLE_INFO **htable_bucket(ACL_HTABLE *table,
+	const ACL_HTABLE_INFO *ht)
+{
+	if (table->rehash_data) {
+		ACL_HTABLE_INFO **h = table->rehash_data
+			+ ht->hash % table->rehash_size;
+		const ACL_HTABLE_INFO *ptr;
+
+		for (ptr = *h; ptr; ptr = ptr->next) {
+			if (ptr == ht) {
+				return h;
+			}
 		}
 	}
 
-	if (table->slice) {
-		acl_slice_pool_free(__FILE__, __LINE__, old_entries);
-	} else {
-		acl_myfree(old_entries);
+	return table->data + ht->hash % table->size;
+}
+
+#define	STREQ(x,y) (x == y || (x[0] == y[0] && strcmp(x,y) == 0))
+
+/* htable_lookup - find the entry of the key with its hash, in the old
+ * entries array if it's being rehashed and the new one, and put the bucket
+ * of the entry found into *bucket.
+ */
+
+static ACL_HTABLE_INFO *htable_lookup(ACL_HTABLE *table, const char *key,
+	unsigned hash, ACL_HTABLE_INFO ***bucket)
+{
+	ACL_HTABLE_INFO **h, *ht;
+
+	if (table->rehash_data) {
+		h = table->rehash_data + hash % table->rehash_size;
+		for (ht = *h; ht; ht = ht->next) {
+			if (ht->hash == hash && STREQ(key, ht->key.c_key)) {
+				*bucket = h;
+				return ht;
+			}
+		}
 	}
 
-	return 0;
+	h = table->data + hash % table->size;
+	for (ht = *h; ht; ht = ht->next) {
+		if (ht->hash == hash && STREQ(key, ht->key.c_key)) {
+			*bucket = h;
+			return ht;
+		}
+	}
+
+	return NULL;
+}
+
+/* htable_move_front - move the entry found to the head of its bucket */
+
+static void htable_move_front(ACL_HTABLE_INFO **h, ACL_HTABLE_INFO *ht)
+{
+	if (ht == *h) {
+		return;
+	}
+
+	htable_unlink(h, ht);
+	(*h)->prev = ht;
+	ht->prev = NULL;
+	ht->next = *h;
+	*h = ht;
 }
 
 #define	_RWLOCK_TYPE	acl_pthread_mutex_t
@@ -281,20 +493,12 @@ static int __init_table_rwlock(ACL_HTABLE *table, int enable)
 		if (ret) {
 			acl_msg_error("%s(%d): init rwlock error(%s)", __FILE__,
 				__LINE__, acl_strerror(ret, tbuf, sizeof(tbuf)));
-			if (table->slice) {
-				acl_slice_pool_free(__FILE__, __LINE__, table->rwlock);
-			} else {
-				acl_myfree(table->rwlock);
-			}
+			htable_free_ptr(table, table->rwlock);
 			return -1;
 		}
 	} else if (!enable && table->rwlock) {
 		_RWLOCK_DESTROY(table->rwlock);
-		if (table->slice) {
-			acl_slice_pool_free(__FILE__, __LINE__, table->rwlock);
-		} else {
-			acl_myfree(table->rwlock);
-		}
+		htable_free_ptr(table, table->rwlock);
 		table->rwlock = NULL;
 	}
 
@@ -333,11 +537,7 @@ ACL_HTABLE *acl_htable_create3(int size, unsigned int flag, ACL_SLICE_POOL *slic
 
 	ret = htable_size(table, size < 13 ? 13 : size);
 	if(ret < 0) {
-		if (table->slice) {
-			acl_slice_pool_free(__FILE__, __LINE__, table);
-		} else {
-			acl_myfree(table);
-		}
+		htable_free_ptr(table, table);
 		return(NULL);
 	}
 
@@ -349,14 +549,15 @@ ACL_HTABLE *acl_htable_create3(int size, unsigned int flag, ACL_SLICE_POOL *slic
 	table->iter_prev = htable_iter_prev;
 	table->iter_info = htable_iter_info;
 
+	table->rehash_data = NULL;
+	table->rehash_size = 0;
+	table->rehash_idx  = 0;
+
 	if ((flag & ACL_HTABLE_FLAG_USE_LOCK)) {
 		ret = __init_table_rwlock(table, 1);
 		if (ret < 0) {
-			if (table->slice) {
-				acl_slice_pool_free(__FILE__, __LINE__, table);
-			} else {
-				acl_myfree(table);
-			}
+			htable_free_ptr(table, table->data);
+			htable_free_ptr(table, table);
 			return NULL;
 		}
 	} else {
@@ -475,47 +676,57 @@ void acl_htable_set_errno(ACL_HTABLE *table, int error)
 	}
 }
 
-#define	STREQ(x,y) (x == y || (x[0] == y[0] && strcmp(x,y) == 0))
+/* the lowercased key is copied into keybuf, which should be freed by RETURN */
+
+#define	KEY_PREPARE(_table, _key_in, _key, _keybuf) do { \
+	if ((_table->flag & ACL_HTABLE_FLAG_KEY_LOWER)) { \
+		if (_table->slice) { \
+			_keybuf = acl_slice_pool_strdup(__FILE__, __LINE__, \
+					_table->slice, _key_in); \
+		} else { \
+			_keybuf = acl_mystrdup(_key_in); \
+		} \
+		acl_lowercase(_keybuf); \
+		_key = _keybuf; \
+	} else { \
+		_key = _key_in; \
+	} \
+} while (0)
+
+#undef RETURN
+#define RETURN(x) do { \
+	if (keybuf) { \
+		htable_free_ptr(table, keybuf); \
+	} \
+	return (x); \
+} while (0)
 
 /* acl_htable_enter - enter (key, value) pair */
 
 ACL_HTABLE_INFO *acl_htable_enter(ACL_HTABLE *table, const char *key_in, void *value)
 {
 	const char *myname = "acl_htable_enter";
-	ACL_HTABLE_INFO *ht;
+	ACL_HTABLE_INFO *ht, **h;
 	int   ret;
-	unsigned hash, n;
+	unsigned hash;
 	char *keybuf = NULL;
 	const char *key;
 
-#undef RETURN
-#define RETURN(x) do { \
-	if (keybuf) { \
-		if (table->slice) { \
-			acl_slice_pool_free(__FILE__, __LINE__, keybuf); \
-		} else { \
-			acl_myfree(keybuf); \
-		} \
-	} \
-	return (x); \
-} while (0)
-
-	if ((table->flag & ACL_HTABLE_FLAG_KEY_LOWER)) {
-		if (table->slice) {
-			keybuf = acl_slice_pool_strdup(__FILE__, __LINE__,
-					table->slice, key_in);
-		} else {
-			keybuf = acl_mystrdup(key_in);
-		}
-		acl_lowercase(keybuf);
-		key = keybuf;
-	} else {
-		key = key_in;
-	}
+	KEY_PREPARE(table, key_in, key, keybuf);
 
 	table->status = ACL_HTABLE_STAT_OK;
 	hash = table->hash_fn(key, strlen(key));
 
+	if (table->rehash_data) {
+		htable_rehash_step(table);
+	}
+
+	ht = htable_lookup(table, key, hash, &h);
+	if (ht != NULL) {
+		table->status = ACL_HTABLE_STAT_DUPLEX_KEY;
+		RETURN (ht);
+	}
+
 	if (table->used >= table->size) {
 		ret = htable_grow(table);
 		if(ret < 0) {
@@ -523,50 +734,13 @@ ACL_HTABLE_INFO *acl_htable_enter(ACL_HTABLE *table, const char *key_in, void *v
 		}
 	}
 
-	n = hash % table->size;
-
-	for (ht = table->data[n]; ht; ht = ht->next) {
-		if (STREQ(key, ht->key.c_key)) {
-			table->status = ACL_HTABLE_STAT_DUPLEX_KEY;
-			RETURN (ht);
-		}
-	}
-
-	if (table->slice) {
-		ht = (ACL_HTABLE_INFO*) acl_slice_pool_alloc(__FILE__, __LINE__,
-				table->slice, sizeof(ACL_HTABLE_INFO));
-	} else {
-		ht = (ACL_HTABLE_INFO *) acl_mymalloc(sizeof(ACL_HTABLE_INFO));
-	}
-
+	ht = htable_entry_new(table, key, hash, value);
 	if (ht == NULL) {
 		acl_msg_error("%s(%d): alloc error", myname, __LINE__);
 		RETURN (NULL);
 	}
 
-	if ((table->flag & ACL_HTABLE_FLAG_KEY_REUSE)) {
-		ht->key.c_key = key;
-	} else {
-		if (table->slice) {
-			ht->key.key = acl_slice_pool_strdup(__FILE__, __LINE__,
-				table->slice, key);
-		} else {
-			ht->key.key = acl_mystrdup(key);
-		}
-		if (ht->key.key == NULL) {
-			acl_msg_error("%s(%d): alloc error", myname, __LINE__);
-			if (table->slice) {
-				acl_slice_pool_free(__FILE__, __LINE__, ht);
-			} else {
-				acl_myfree(ht);
-			}
-			RETURN (NULL);
-		}
-	}
-
-	ht->hash  = hash;
-	ht->value = value;
-	htable_link(table, ht, n);
+	htable_link(table, ht, hash % table->size);
 	RETURN (ht);
 }
 
@@ -579,42 +753,34 @@ ACL_HTABLE_INFO *acl_htable_enter_r(ACL_HTABLE *table,
 ACL_HTABLE_INFO *acl_htable_enter_r2(ACL_HTABLE *table,
 	const char *key_in, void *value, void **old_holder)
 {
-	ACL_HTABLE_INFO *ht;
+	ACL_HTABLE_INFO *ht, **h;
 	int   ret;
-	unsigned hash, n;
+	unsigned hash;
 	char *keybuf = NULL;
 	const char *key;
 
-#undef RETURN
-#define RETURN(x) do { \
-	if (keybuf) { \
-		if (table->slice) { \
-			acl_slice_pool_free(__FILE__, __LINE__, keybuf); \
-		} else { \
-			acl_myfree(keybuf); \
-		} \
-	} \
-	return (x); \
-} while (0)
-
-	if ((table->flag & ACL_HTABLE_FLAG_KEY_LOWER)) {
-		if (table->slice) {
-			keybuf = acl_slice_pool_strdup(__FILE__, __LINE__,
-					table->slice, key_in);
-		} else {
-			keybuf = acl_mystrdup(key_in);
-		}
-		acl_lowercase(keybuf);
-		key = keybuf;
-	} else {
-		key = key_in;
-	}
+	KEY_PREPARE(table, key_in, key, keybuf);
 
 	hash = table->hash_fn(key, strlen(key));
 
 	table->status = ACL_HTABLE_STAT_OK;
 	LOCK_TABLE_WRITE(table);
 
+	if (table->rehash_data) {
+		htable_rehash_step(table);
+	}
+
+	ht = htable_lookup(table, key, hash, &h);
+	if (ht != NULL) {
+		table->status = ACL_HTABLE_STAT_DUPLEX_KEY;
+		if (old_holder) {
+			*old_holder = ht->value;
+			ht->value = value;
+		}
+		UNLOCK_TABLE(table);
+		RETURN (ht);
+	}
+
 	if (table->used >= table->size) {
 		ret = htable_grow(table);
 		if(ret < 0) {
@@ -623,39 +789,14 @@ ACL_HTABLE_INFO *acl_htable_enter_r2(ACL_HTABLE *table,
 		}
 	}
 
-	n = hash % table->size;
-
-	for (ht = table->data[n]; ht; ht = ht->next) {
-		if (STREQ(key, ht->key.c_key)) {
-			table->status = ACL_HTABLE_STAT_DUPLEX_KEY;
-			if (old_holder) {
-				*old_holder = ht->value;
-				ht->value = value;
-			}
-			UNLOCK_TABLE(table);
-			RETURN (ht);
-		}
-	}
-
-	if (table->slice) {
-		ht = (ACL_HTABLE_INFO*) acl_slice_pool_alloc(__FILE__, __LINE__,
-				table->slice, sizeof(ACL_HTABLE_INFO));
-	} else {
-		ht = (ACL_HTABLE_INFO *) acl_mymalloc(sizeof(ACL_HTABLE_INFO));
-	}
-
-	if ((table->flag & ACL_HTABLE_FLAG_KEY_REUSE)) {
-		ht->key.c_key = key;
-	} else if (table->slice) {
-		ht->key.key = acl_slice_pool_strdup(__FILE__, __LINE__,
-					table->slice, key);
-	} else {
-		ht->key.key = acl_mystrdup(key);
+	ht = htable_entry_new(table, key, hash, value);
+	if (ht == NULL) {
+		acl_msg_error("%s(%d): alloc error", __FUNCTION__, __LINE__);
+		UNLOCK_TABLE(table);
+		RETURN (NULL);
 	}
 
-	ht->hash  = hash;
-	ht->value = value;
-	htable_link(table, ht, n);
+	htable_link(table, ht, hash % table->size);
 
 	UNLOCK_TABLE(table);
 
@@ -675,371 +816,176 @@ void *acl_htable_find(ACL_HTABLE *table, const char *key)
 
 void *acl_htable_find_r(ACL_HTABLE *table, const char *key_in)
 {
-	ACL_HTABLE_INFO *ht;
-	unsigned  n;
+	ACL_HTABLE_INFO *ht, **h;
+	unsigned  hash;
 	char *keybuf = NULL;
 	const char *key;
+	void *value;
 
-#undef RETURN
-#define RETURN(x) do { \
-	if (keybuf) { \
-		if (table->slice) { \
-			acl_slice_pool_free(__FILE__, __LINE__, keybuf); \
-		} else { \
-			acl_myfree(keybuf); \
-		} \
-	} \
-	return (x); \
-} while (0)
-
-	if ((table->flag & ACL_HTABLE_FLAG_KEY_LOWER)) {
-		if (table->slice) {
-			keybuf = acl_slice_pool_strdup(__FILE__, __LINE__,
-					table->slice, key_in);
-		} else {
-			keybuf = acl_mystrdup(key_in);
-		}
-		acl_lowercase(keybuf);
-		key = keybuf;
-	} else {
-		key = key_in;
-	}
+	KEY_PREPARE(table, key_in, key, keybuf);
 
-	n = table->hash_fn(key, strlen(key));
+	hash = table->hash_fn(key, strlen(key));
 
 	LOCK_TABLE_READ(table);
 
-	n = n % table->size;
-
-	for (ht = table->data[n]; ht; ht = ht->next) {
-		if (STREQ(key, ht->key.c_key)) {
-			void *value = ht->value;
-
-			if (!(table->flag & ACL_HTABLE_FLAG_MSLOOK)) {
-				UNLOCK_TABLE(table);
-				RETURN (value);
-			}
-			if (ht == table->data[n]) {
-				UNLOCK_TABLE(table);
-				RETURN (value);
-			}
-			if (ht->next) {
-				ht->prev->next = ht->next;
-				ht->next->prev = ht->prev;
-			} else {
-				ht->prev->next = NULL;
-			}
-			table->data[n]->prev = ht;
-			ht->prev = NULL;
-			ht->next = table->data[n];
-			table->data[n] = ht;
+	ht = htable_lookup(table, key, hash, &h);
+	if (ht == NULL) {
+		UNLOCK_TABLE(table);
+		RETURN (NULL);
+	}
 
-			UNLOCK_TABLE(table);
-			RETURN (value);
-		}
+	value = ht->value;
+	if ((table->flag & ACL_HTABLE_FLAG_MSLOOK)) {
+		htable_move_front(h, ht);
 	}
 
 	UNLOCK_TABLE(table);
-	RETURN (NULL);
+	RETURN (value);
 }
 
 /* acl_htable_locate - lookup entry */
 
 ACL_HTABLE_INFO *acl_htable_locate(ACL_HTABLE *table, const char *key_in)
 {
-	ACL_HTABLE_INFO *ht;
-	unsigned  n;
+	ACL_HTABLE_INFO *ht, **h;
+	unsigned  hash;
 	char *keybuf = NULL;
 	const char *key;
 
-#undef RETURN
-#define RETURN(x) do { \
-	if (keybuf) { \
-		if (table->slice) { \
-			acl_slice_pool_free(__FILE__, __LINE__, keybuf); \
-		} else { \
-			acl_myfree(keybuf); \
-		} \
-	} \
-	return (x); \
-} while (0)
-
-	if ((table->flag & ACL_HTABLE_FLAG_KEY_LOWER)) {
-		if (table->slice) {
-			keybuf = acl_slice_pool_strdup(__FILE__, __LINE__,
-					table->slice, key_in);
-		} else {
-			keybuf = acl_mystrdup(key_in);
-		}
-		acl_lowercase(keybuf);
-		key = keybuf;
-	} else {
-		key = key_in;
-	}
-
-	n = table->hash_fn(key, strlen(key));
+	KEY_PREPARE(table, key_in, key, keybuf);
 
-	n = n % table->size;
+	hash = table->hash_fn(key, strlen(key));
 
-	for (ht = table->data[n]; ht; ht = ht->next) {
-		if (STREQ(key, ht->key.c_key)) {
-			if (!(table->flag & ACL_HTABLE_FLAG_MSLOOK)) {
-				RETURN (ht);
-			}
-			if (ht == table->data[n]) {
-				RETURN (ht);
-			}
-			if (ht->next) {
-				ht->prev->next = ht->next;
-				ht->next->prev = ht->prev;
-			} else {
-				ht->prev->next = NULL;
-			}
-			table->data[n]->prev = ht;
-			ht->prev = NULL;
-			ht->next = table->data[n];
-			table->data[n] = ht;
-			RETURN (ht);
-		}
+	ht = htable_lookup(table, key, hash, &h);
+	if (ht != NULL && (table->flag & ACL_HTABLE_FLAG_MSLOOK)) {
+		htable_move_front(h, ht);
 	}
 
-	RETURN (NULL);
+	RETURN (ht);
 }
 
 ACL_HTABLE_INFO *acl_htable_locate_r(ACL_HTABLE *table, const char *key_in)
 {
-	ACL_HTABLE_INFO *ht;
-	unsigned  n;
+	ACL_HTABLE_INFO *ht, **h;
+	unsigned  hash;
 	char *keybuf = NULL;
 	const char *key;
 
-#undef RETURN
-#define RETURN(x) do { \
-	if (keybuf) { \
-		if (table->slice) \
-			acl_slice_pool_free(__FILE__, __LINE__, keybuf); \
-		else \
-			acl_myfree(keybuf); \
-	} \
-	return (x); \
-} while (0)
-
-	if ((table->flag & ACL_HTABLE_FLAG_KEY_LOWER)) {
-		if (table->slice) {
-			keybuf = acl_slice_pool_strdup(__FILE__, __LINE__,
-					table->slice, key_in);
-		} else {
-			keybuf = acl_mystrdup(key_in);
-		}
-		acl_lowercase(keybuf);
-		key = keybuf;
-	} else {
-		key = key_in;
-	}
+	KEY_PREPARE(table, key_in, key, keybuf);
 
-	n = table->hash_fn(key, strlen(key));
+	hash = table->hash_fn(key, strlen(key));
 
 	LOCK_TABLE_READ(table);
-
-	n = n % table->size;
-
-	for (ht = table->data[n]; ht; ht = ht->next) {
-		if (STREQ(key, ht->key.c_key)) {
-			UNLOCK_TABLE(table);
-			RETURN (ht);
-		}
-	}
-
+	ht = htable_lookup(table, key, hash, &h);
 	UNLOCK_TABLE(table);
 
-	RETURN (NULL);
+	RETURN (ht);
 }
 
-void acl_htable_delete_entry(ACL_HTABLE *table, ACL_HTABLE_INFO *ht,
-	void (*free_fn) (void *))
+static void htable_delete_entry(ACL_HTABLE *table, ACL_HTABLE_INFO **h,
+	ACL_HTABLE_INFO *ht, void (*free_fn) (void *))
 {
-	ACL_HTABLE_INFO **h = table->data + ht->hash % table->size;
-
-	if (ht->next) {
-		ht->next->prev = ht->prev;
-	}
-	if (ht->prev) {
-		ht->prev->next = ht->next;
-	} else {
-		*h = ht->next;
-	}
-
-	if (!(table->flag & ACL_HTABLE_FLAG_KEY_REUSE)) {
-		if (table->slice) {
-			acl_slice_pool_free(__FILE__, __LINE__, ht->key.key);
-		} else {
-			acl_myfree(ht->key.key);
-		}
-	}
+	htable_unlink(h, ht);
 
 	if (free_fn && ht->value) {
 		(*free_fn) (ht->value);
 	}
 
-	if (table->slice) {
-		acl_slice_pool_free(__FILE__, __LINE__, ht);
-	} else {
-		acl_myfree(ht);
-	}
+	htable_free_ptr(table, ht);
 	table->used--;
 }
 
+void acl_htable_delete_entry(ACL_HTABLE *table, ACL_HTABLE_INFO *ht,
+	void (*free_fn) (void *))
+{
+	htable_delete_entry(table, htable_bucket(table, ht), ht, free_fn);
+}
+
 /* acl_htable_delete - delete one entry */
 
 int acl_htable_delete(ACL_HTABLE *table, const char *key_in,
 	void (*free_fn) (void *))
 {
-	ACL_HTABLE_INFO *ht;
-	unsigned  n;
-	ACL_HTABLE_INFO **h;
+	ACL_HTABLE_INFO *ht, **h;
+	unsigned  hash;
 	char *keybuf = NULL;
 	const char *key;
 
-#undef RETURN
-#define RETURN(x) do { \
-	if (keybuf) { \
-		if (table->slice) { \
-			acl_slice_pool_free(__FILE__, __LINE__, keybuf); \
-		} else { \
-			acl_myfree(keybuf); \
-		} \
-	} \
-	return (x); \
-} while (0)
-
-	if ((table->flag & ACL_HTABLE_FLAG_KEY_LOWER)) {
-		if (table->slice) {
-			keybuf = acl_slice_pool_strdup(__FILE__, __LINE__,
-					table->slice, key_in);
-		} else {
-			keybuf = acl_mystrdup(key_in);
-		}
-		acl_lowercase(keybuf);
-		key = keybuf;
-	} else {
-		key = key_in;
-	}
+	KEY_PREPARE(table, key_in, key, keybuf);
 
-	n = table->hash_fn(key, strlen(key));
+	hash = table->hash_fn(key, strlen(key));
 
 	LOCK_TABLE_WRITE(table);
 
-	n = n % table->size;
+	if (table->rehash_data) {
+		htable_rehash_step(table);
+	}
 
-	h = table->data + n;
-	for (ht = *h; ht; ht = ht->next) {
-		if (STREQ(key, ht->key.c_key)) {
-			acl_htable_delete_entry(table, ht, free_fn);
-			UNLOCK_TABLE(table);
-			RETURN(0);
-		}
+	ht = htable_lookup(table, key, hash, &h);
+	if (ht != NULL) {
+		htable_delete_entry(table, h, ht, free_fn);
+		UNLOCK_TABLE(table);
+		RETURN(0);
 	}
 
 	UNLOCK_TABLE(table);
 	RETURN(-1);
 }
 
-/* acl_htable_free - destroy hash table */
+/* htable_free_entries - free all entries in one entries array */
 
-void acl_htable_free(ACL_HTABLE *table, void (*free_fn) (void *))
+static void htable_free_entries(ACL_HTABLE *table, ACL_HTABLE_INFO **h,
+	unsigned size, void (*free_fn) (void *))
 {
-	unsigned i = table->size;
 	ACL_HTABLE_INFO *ht;
 	ACL_HTABLE_INFO *next;
-	ACL_HTABLE_INFO **h = table->data;
 
-	while (i-- > 0) {
+	while (size-- > 0) {
 		for (ht = *h++; ht; ht = next) {
 			next = ht->next;
-			if (!(table->flag & ACL_HTABLE_FLAG_KEY_REUSE)) {
-				if (table->slice) {
-					acl_slice_pool_free(__FILE__, __LINE__,
-						ht->key.key);
-				} else {
-					acl_myfree(ht->key.key);
-				}
-			}
-
 			if (free_fn && ht->value) {
 				(*free_fn) (ht->value);
 			}
-
-			if (table->slice) {
-				acl_slice_pool_free(__FILE__, __LINE__, ht);
-			} else {
-				acl_myfree(ht);
-			}
+			htable_free_ptr(table, ht);
 		}
 	}
+}
 
-	if (table->slice) {
-		acl_slice_pool_free(__FILE__, __LINE__, table->data);
-	} else {
-		acl_myfree(table->data);
-	}
+/* acl_htable_free - destroy hash table */
 
+void acl_htable_free(ACL_HTABLE *table, void (*free_fn) (void *))
+{
+	htable_free_entries(table, table->data, table->size, free_fn);
+	htable_free_ptr(table, table->data);
 	table->data = 0;
+
+	if (table->rehash_data) {
+		htable_free_entries(table, table->rehash_data,
+			table->rehash_size, free_fn);
+		htable_rehash_end(table);
+	}
+
 	if (table->rwlock) {
 		_RWLOCK_DESTROY(table->rwlock);
-		if (table->slice) {
-			acl_slice_pool_free(__FILE__, __LINE__, table->rwlock);
-		} else {
-			acl_myfree(table->rwlock);
-		}
+		htable_free_ptr(table, table->rwlock);
 	}
 
-	if (table->slice) {
-		acl_slice_pool_free(__FILE__, __LINE__, table);
-	} else {
-		acl_myfree(table);
-	}
+	htable_free_ptr(table, table);
 }
 
 int acl_htable_reset(ACL_HTABLE *table, void (*free_fn) (void *))
 {
-	unsigned i = table->size;
-	ACL_HTABLE_INFO *ht;
-	ACL_HTABLE_INFO *next;
-	ACL_HTABLE_INFO **h;
 	int ret;
 
 	LOCK_TABLE_WRITE(table);
 
-	h = table->data;
-
-	while (i-- > 0) {
-		for (ht = *h++; ht; ht = next) {
-			next = ht->next;
-			if (!(table->flag & ACL_HTABLE_FLAG_KEY_REUSE)) {
-				if (table->slice) {
-					acl_slice_pool_free(__FILE__, __LINE__,
-						ht->key.key);
-				} else {
-					acl_myfree(ht->key.key);
-				}
-			}
-
-			if (free_fn && ht->value) {
-				(*free_fn) (ht->value);
-			}
-
-			if (table->slice) {
-				acl_slice_pool_free(__FILE__, __LINE__, ht);
-			} else {
-				acl_myfree(ht);
-			}
-		}
-	}
+	htable_free_entries(table, table->data, table->size, free_fn);
+	htable_free_ptr(table, table->data);
 
-	if (table->slice) {
-		acl_slice_pool_free(__FILE__, __LINE__, table->data);
-	} else {
-		acl_myfree(table->data);
+	if (table->rehash_data) {
+		htable_free_entries(table, table->rehash_data,
+			table->rehash_size, free_fn);
+		htable_rehash_end(table);
 	}
 
 	ret = htable_size(table, table->init_size < 13 ? 13 : table->init_size);
@@ -1050,6 +996,8 @@ int acl_htable_reset(ACL_HTABLE *table, void (*free_fn) (void *))
 
 const ACL_HTABLE_INFO *acl_htable_iter_head(ACL_HTABLE *table, ACL_HTABLE_ITER *iter)
 {
+	htable_rehash_finish(table);
+
 	iter->i = 0;
 	iter->size = table->size;
 	iter->h = table->data;
@@ -1086,6 +1034,8 @@ const ACL_HTABLE_INFO *acl_htable_iter_next(ACL_HTABLE_ITER *iter)
 
 const ACL_HTABLE_INFO *acl_htable_iter_tail(ACL_HTABLE *table, ACL_HTABLE_ITER *iter)
 {
+	htable_rehash_finish(table);
+
 	iter->i = table->size - 1;
 	iter->size = table->size;
 	iter->h = table->data;
@@ -1124,16 +1074,30 @@ const ACL_HTABLE_INFO *acl_htable_iter_prev(ACL_HTABLE_ITER *iter)
 
 void acl_htable_walk(ACL_HTABLE *table, void (*action)(ACL_HTABLE_INFO *, void *), void *arg)
 {
-	unsigned i = table->size;
-	ACL_HTABLE_INFO **h = table->data;
+	unsigned i;
+	ACL_HTABLE_INFO **h;
 	ACL_HTABLE_INFO *ht;
 
 	LOCK_TABLE_READ(table);
+
+	if (table->rehash_data) {
+		i = table->rehash_size;
+		h = table->rehash_data;
+		while (i-- > 0) {
+			for (ht = *h++; ht; ht = ht->next) {
+				(*action) (ht, arg);
+			}
+		}
+	}
+
+	i = table->size;
+	h = table->data;
 	while (i-- > 0) {
 		for (ht = *h++; ht; ht = ht->next) {
 			(*action) (ht, arg);
 		}
 	}
+
 	UNLOCK_TABLE(table);
 }
 
@@ -1157,6 +1121,7 @@ int acl_htable_used(const ACL_HTABLE *table)
 
 ACL_HTABLE_INFO **acl_htable_data(ACL_HTABLE *table)
 {
+	htable_rehash_finish(table);
 	return (ACL_HTABLE_INFO**) table->data;
 }
 
@@ -1171,6 +1136,11 @@ ACL_HTABLE_INFO **acl_htable_list(const ACL_HTABLE *table)
 
 	if (table != 0) {
 		list = (ACL_HTABLE_INFO **) acl_mymalloc(sizeof(*list) * (table->used + 1));
+		for (i = 0; table->rehash_data && i < table->rehash_size; i++) {
+			for (member = table->rehash_data[i]; member != 0; member = member->next) {
+				list[count++] = member;
+			}
+		}
 		for (i = 0; i < table->size; i++) {
 			for (member = table->data[i]; member != 0; member = member->next) {
 				list[count++] = member;
@@ -1184,35 +1154,50 @@ ACL_HTABLE_INFO **acl_htable_list(const ACL_HTABLE *table)
 	return list;
 }
 
-void acl_htable_stat(const ACL_HTABLE *table)
+static void htable_stat_entries(ACL_HTABLE_INFO **data, int size,
+	const char *name)
 {
 	ACL_HTABLE_INFO *member;
 	int	i, count;
 
-	LOCK_TABLE_READ(table);
 	printf("hash stat count for each key:\n");
-	for(i = 0; i < table->size; i++) {
+	for(i = 0; i < size; i++) {
 		count = 0;
-		member = table->data[i];
+		member = data[i];
 		for(; member != 0; member = member->next) {
 			count++;
 		}
 		if(count > 0) {
-			printf("chains[%d]: count[%d]\n", i, count);
+			printf("%s[%d]: count[%d]\n", name, i, count);
 		}
 	}
 
 	printf("hash stat all values for each key:\n");
-	for(i = 0; i < table->size; i++) {
-		member = table->data[i];
+	for(i = 0; i < size; i++) {
+		member = data[i];
 		if(member) {
-			printf("chains[%d]: ", i);
+			printf("%s[%d]: ", name, i);
 			for(; member != 0; member = member->next) {
 				printf("[%s]", member->key.c_key);
 			}
 			printf("\n");
 		}
 	}
-	printf("hash table size=%d, used=%d\n", table->size, table->used);
+}
+
+void acl_htable_stat(const ACL_HTABLE *table)
+{
+	LOCK_TABLE_READ(table);
+	if (table->rehash_data) {
+		htable_stat_entries(table->rehash_data, table->rehash_size,
+			"rehashing chains");
+	}
+	htable_stat_entries(table->data, table->size, "chains");
+	printf("hash table size=%d, used=%d", table->size, table->used);
+	if (table->rehash_data) {
+		printf(", rehashing %d/%d", table->rehash_idx,
+			table->rehash_size);
+	}
+	printf("\n");
 	UNLOCK_TABLE(table);
 }
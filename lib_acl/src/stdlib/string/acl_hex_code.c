@@ -18,12 +18,34 @@
 
 #endif
 
+#include "../../code/codec_simd.h"
+
 /* Application-specific. */
 
 static const unsigned char acl_hex_chars[] = "0123456789ABCDEF";
+static const unsigned char acl_hex_lchars[] = "0123456789abcdef";
 
 #define UCHAR_PTR(x) ((const unsigned char *)(x))
 
+/* acl_hex_encode_buf - raw data to encoded into the given buffer */
+
+size_t acl_hex_encode_buf(const void *in, size_t len, char *out, int lowercase)
+{
+	const unsigned char *cp = UCHAR_PTR(in);
+	const unsigned char *tab = lowercase ? acl_hex_lchars : acl_hex_chars;
+	unsigned char *ptr = (unsigned char *) out;
+	size_t  n = acl_simd_hex_encode(cp, len, ptr, lowercase);
+	int     ch;
+
+	for (cp += n, ptr += n * 2; n < len; n++, cp++) {
+		ch = *cp;
+		*ptr++ = tab[(ch >> 4) & 0xf];
+		*ptr++ = tab[ch & 0xf];
+	}
+	*ptr = 0;
+	return len * 2;
+}
+
 /* acl_hex_encode - raw data to encoded */
 
 ACL_VSTRING *acl_hex_encode(ACL_VSTRING *result, const char *in, int len)
@@ -33,6 +55,14 @@ ACL_VSTRING *acl_hex_encode(ACL_VSTRING *result, const char *in, int len)
 	int     count;
 
 	ACL_VSTRING_RESET(result);
+	if (len > 0 && ACL_VSTRING_SPACE(result, (ssize_t) len * 2 + 1) == 0) {
+		count = (int) acl_hex_encode_buf(in, (size_t) len,
+				acl_vstring_str(result), 0);
+		ACL_VSTRING_AT_OFFSET(result, count);
+		ACL_VSTRING_TERMINATE(result);
+		return (result);
+	}
+
 	for (cp = UCHAR_PTR(in), count = len; count > 0; count--, cp++) {
 		ch = *cp;
 		ACL_VSTRING_ADDCH(result, acl_hex_chars[(ch >> 4) & 0xf]);
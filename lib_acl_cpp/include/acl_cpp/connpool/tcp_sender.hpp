@@ -2,12 +2,11 @@
 #include "../acl_cpp_define.hpp"
 #include "../stdlib/noncopyable.hpp"
 
-struct iovec;
-
 namespace acl
 {
 
 class socket_stream;
+class gather_buf;
 
 /**
  * tcp ipc ͨŷ࣬ڲԶ
@@ -37,7 +36,7 @@ public:
 
 private:
 	acl::socket_stream* conn_;
-	struct iovec* v2_;
+	gather_buf* buf_;
 };
 
 } // namespace acl
@@ -11,6 +11,7 @@ class session;
 class socket_stream;
 class HttpServletRequest;
 class HttpServletResponse;
+class http_request_parser;
 
 /**
  *  HTTP ͻĻ࣬Ҫ̳и
@@ -86,6 +87,32 @@ public:
 	 * @return {HttpServlet&}
 	 */
 	HttpServlet& setParseBodyLimit(int length);
+
+	/**
+	 * Read the request headers with http_request_parser kept by the
+	 * servlet, instead of http_client created for each request, so the
+	 * buffers are reused by the keep-alive requests and the query and the
+	 * cookies are parsed only when being accessed, and getClient() of the
+	 * request returns NULL, so the body should be read by readBody() or
+	 * getBody() of the request; it should be called before doRun.
+	 * @param yes {bool}
+	 * @param max {size_t} the max length of the request header
+	 * @return {HttpServlet&}
+	 */
+	HttpServlet& setFastParser(bool yes, size_t max = 65536);
+
+	/**
+	 * When the next pipelined request has been read into the buffer with
+	 * the current one, keep the response in the write buffer of the
+	 * stream, so the responses of the requests handled back to back are
+	 * sent in order by one write with the last one; it should be called
+	 * before doRun.
+	 * @param yes {bool}
+	 * @param max {size_t} the size of the write buffer, the responses
+	 *  are sent when it's full
+	 * @return {HttpServlet&}
+	 */
+	HttpServlet& setPipelineBatch(bool yes, size_t max = 65536);
 	
 	/**
 	 * HttpServlet ʼУ HTTP 󣬲ص doXXX 麯
@@ -216,6 +243,9 @@ private:
 	int   rw_timeout_;
 	int   parse_body_limit_;
 	bool  try_old_ws_;
+	http_request_parser* parser_;
+	bool  batch_;
+	size_t batch_max_;
 
 	void init();
 };
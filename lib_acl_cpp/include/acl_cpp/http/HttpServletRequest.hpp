@@ -23,6 +23,7 @@ class session;
 class HttpSession;
 class HttpCookie;
 class HttpServletResponse;
+class http_request_parser;
 
 /**
  *  HTTP ͻص࣬಻Ӧ̳УûҲҪ
@@ -240,6 +241,25 @@ public:
 	const char* getParameter(const char* name,
 		bool case_sensitive = false) const;
 
+	/**
+	 * Set the parameters parsed from the path by the router, such as "id"
+	 * of the route "/users/:id"; the names and the values are referred
+	 * without being copied, so they should be valid while handling the
+	 * request.
+	 * @param names {const char* const*}
+	 * @param values {const char* const*}
+	 * @param n {size_t} the number of the parameters
+	 */
+	void setPathParams(const char* const* names,
+		const char* const* values, size_t n);
+
+	/**
+	 * Get the parameter parsed from the path by the router.
+	 * @param name {const char*}
+	 * @return {const char*} NULL if not found
+	 */
+	const char* getPathParam(const char* name) const;
+
 	/**
 	 *  HTTP ͷе Content-Type Ϊ
 	 * multipart/form-data; boundary=xxx ʽʱ˵Ϊļϴͣ
@@ -389,6 +409,34 @@ public:
 	 */
 	http_client* getClient(void) const;
 
+	/**
+	 * Read the body of the request, which works with http_client or the
+	 * parser set by setParser(), the body of Content-Length is limited by
+	 * it, and the chunked body is decoded.
+	 * @param buf {char*}
+	 * @param size {size_t} the size of buf
+	 * @return {int} the length of the data read, 0 if the body has been
+	 *  read completely or there is no body, -1 if error
+	 */
+	int readBody(char* buf, size_t size);
+
+	/**
+	 * Set the parser kept by the connection to read the request header,
+	 * instead of http_client, which should be called before getMethod(),
+	 * and getClient() returns NULL then; it's called by HttpServlet when
+	 * setFastParser(true) was called.
+	 * @param parser {http_request_parser*}
+	 */
+	void setParser(http_request_parser* parser);
+
+	/**
+	 * Get the parser set by setParser().
+	 * @return {http_request_parser*}
+	 */
+	http_request_parser* getParser(void) const {
+		return parser_;
+	}
+
 	/**
 	 *  HTTP ͷУļ
 	 * @param out {ostream&}
@@ -418,6 +466,7 @@ private:
 	std::vector<HttpCookie*> cookies_;
 	bool cookies_inited_;
 	http_client* client_;
+	http_request_parser* parser_;
 	http_method_t method_;
 	bool cgi_mode_;
 	http_ctype content_type_;
@@ -426,6 +475,9 @@ private:
 	char* localCharset_;
 	int  rw_timeout_;
 	std::vector<HTTP_PARAM*> params_;
+	const char* const* path_names_;
+	const char* const* path_values_;
+	size_t path_nparams_;
 	http_request_t request_type_;
 	bool parse_body_;
 	http_mime* mime_;
@@ -435,6 +487,10 @@ private:
 
 	bool readHeaderCalled_;
 	bool readHeader(string* method_s);
+	bool lazyParams(void) const;
+	void sprintHeader(string& out, const char* prompt) const;
+	bool isChunked(void) const;
+	bool getChunkedBody(string& out, size_t body_limit);
 
 	void add_cookie(char* data);
 	void parseParameters(const char* str);
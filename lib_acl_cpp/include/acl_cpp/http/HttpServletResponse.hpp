@@ -16,6 +16,9 @@ class http_header;
 class http_client;
 class HttpCookie;
 class HttpServletRequest;
+class http_file_cache;
+class compress_cache;
+class fstream;
 
 /**
  *  HTTP ͻӦص࣬಻Ӧ̳УûҲҪ
@@ -66,11 +69,22 @@ public:
 
 	/**
 	 *  HTTP Ӧ gzip ѹʽ
+	 * The codec is chosen by Accept-Encoding of the request from the ones
+	 * set by setContentCodecs(), gzip is used if no request is set.
 	 * @param gzip {bool} Ƿ gzip ѹʽ
 	 * @return {HttpServletResponse&}
 	 */
 	HttpServletResponse& setContentEncoding(bool gzip);
 
+	/**
+	 * Set the codecs which can be used to compress the body, in the order
+	 * of the preference, and enable the compression if not empty; the
+	 * default is "zstd, br, gzip", see compress_codec::negotiate.
+	 * @param codecs {const char*} the codecs separated by comma
+	 * @return {HttpServletResponse&}
+	 */
+	HttpServletResponse& setContentCodecs(const char* codecs);
+
 	/**
 	 *  HTTP ӦַѾ setContentType 
 	 * ַͲٵñַ
@@ -228,6 +242,46 @@ public:
 	 */
 	int vformat(const char* fmt, va_list ap);
 
+	/**
+	 * Send the static file as the HTTP response body, the ETag,
+	 * Last-Modified and Accept-Ranges headers are added, 304 is replied
+	 * if the ETag matches If-None-Match of the request, and 206 or 416
+	 * if the request has the Range header. On Linux the body is sent by
+	 * sendfile or splice without being copied into the user space, see
+	 * socket_stream::send_file. The Content-Type should be set before.
+	 * @param path {const char*} the file path, 404 is replied if the
+	 *  file doesn't exist or isn't a regular file
+	 * @param range {bool} if handling the Range header of the request
+	 * @return {bool} false if the connection was broken
+	 */
+	bool sendFile(const char* path, bool range = true);
+
+	/**
+	 * Send the static file got from the cache, so the hot files needn't
+	 * be opened and checked for each request, see http_file_cache.
+	 * @param cache {http_file_cache&} shared by all the servlets
+	 * @param path {const char*} the file path
+	 * @param range {bool} if handling the Range header of the request
+	 * @return {bool} false if the connection was broken
+	 */
+	bool sendFile(http_file_cache& cache, const char* path,
+		bool range = true);
+
+	/**
+	 * Send the hot response compressed once and cached, instead of being
+	 * compressed for each request. The codec is chosen by Accept-Encoding
+	 * of the request from the ones set by setContentCodecs(), and the
+	 * data is sent as it is if none of them is accepted.
+	 * @param cache {compress_cache&} shared by all the servlets
+	 * @param key {const char*} identifies the data, which should be
+	 *  changed when the data is changed, such as the path with the ETag
+	 * @param data {const void*} the original data
+	 * @param len {size_t}
+	 * @return {bool} false if the connection was broken
+	 */
+	bool sendCompressed(compress_cache& cache, const char* key,
+		const void* data, size_t len);
+
 	///////////////////////////////////////////////////////////////////
 
 	/**
@@ -268,6 +322,24 @@ public:
 	 */
 	void setHttpServletRequest(HttpServletRequest* request);
 
+	/**
+	 * Keep the response in the write buffer of the stream, which is sent
+	 * with the responses of the next pipelined requests; it's called by
+	 * HttpServlet when setPipelineBatch(true) was called and the next
+	 * request has been read into the buffer.
+	 * @param yes {bool}
+	 */
+	void setBatched(bool yes);
+
+	/**
+	 * If the response is kept in the write buffer.
+	 * @return {bool}
+	 */
+	bool isBatched(void) const
+	{
+		return batched_;
+	}
+
 private:
 	dbuf_guard* dbuf_internal_;
 	dbuf_guard* dbuf_;
@@ -277,7 +349,13 @@ private:
 	http_header* header_;		// http Ӧͷ
 	char  charset_[32];		// ַ
 	char  content_type_[32];	// content-type 
+	char  codecs_[32];		// the codecs used to compress the body
 	bool  head_sent_;		// ǷѾ HTTP Ӧͷ
+	bool  batched_;			// keep the response in the write buffer
+
+	bool sendFile(fstream& in, long long size, const char* etag,
+		const char* mtime, bool range);
+	bool flush(void);
 };
 
 }  // namespace acl
@@ -12,6 +12,8 @@ namespace acl {
 
 class string;
 class zlib_stream;
+class compress_codec;
+class gather_buf;
 class socket_stream;
 class ostream;
 class istream;
@@ -87,6 +89,16 @@ public:
 	 */
 	bool write_body(const void* data, size_t len);
 
+	/**
+	 * Keep the head and the body not compressed nor chunked in the write
+	 * buffer of the stream, instead of sending them, so the responses of
+	 * the pipelined requests can be sent together; the buffer is sent
+	 * when being full, or by the next write without buffering, or by
+	 * fflush() of the stream.
+	 * @param yes {bool}
+	 */
+	void set_buffed(bool yes);
+
 	/**
 	 *  http_client(socket_stream*, bool) 캯
 	 *  http_client(void) ͬʱ open ʱ
@@ -419,9 +431,10 @@ private:
 	bool body_finish_;          // ǷѾ HTTP Ӧ
 	bool disconnected_;         // ǷѾر
 	bool chunked_transfer_;     // ǷΪ chunked ģʽ
-	unsigned gzip_crc32_;       // gzip ѹʱļֵ
-	unsigned gzip_total_in_;    // gzip ѹǰݳ      
+	bool buffed_;               // keep the data in the write buffer
+	compress_codec* codec_;     // the codec compressing the body written
 	string* buf_;               // ڲڰжȲ
+	gather_buf* gbuf_;          // the slices of the body written by writev
 
 	bool read_request_head(void);
 	bool read_response_head(void);
@@ -435,9 +448,9 @@ private:
 public:
 	bool write_chunk(ostream& out, const void* data, size_t len);
 	bool write_chunk_trailer(ostream& out);
+	gather_buf& get_gather(void);
 
-	bool write_gzip(ostream& out, const void* data, size_t len);
-	bool write_gzip_trailer(ostream& out);
+	bool write_compress(ostream& out, const void* data, size_t len);
 };
 
 }  // namespace acl
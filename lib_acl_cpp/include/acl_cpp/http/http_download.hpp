@@ -7,6 +7,7 @@ namespace acl {
 class http_client;
 class http_request;
 class http_header;
+class http_segment;
 
 class ACL_CPP_API http_download : public noncopyable
 {
@@ -54,6 +55,29 @@ public:
 		const char* req_body = NULL, size_t len = 0);
 #endif
 
+	/**
+	 * Download the file in segments concurrently: the length of the file
+	 * and if the server supports range are probed first, then the file is
+	 * split into at most nsegs ranges, each of which is fetched by one
+	 * thread over its own connection and written at its own offset of the
+	 * local file, so the segments share no buffer. One segment failed is
+	 * requested again from the offset it has written to. If the server
+	 * doesn't support range, the file is downloaded over one connection.
+	 * on_response/on_length/on_save aren't called in this mode.
+	 * @param filepath {const char*} the local file, created or truncated
+	 * @param nsegs {int} the max number of the segments
+	 * @param min_seg {acl_int64} the min size of each segment
+	 * @param max_retry {int} the max retries of each segment
+	 * @return {bool} if the whole file has been downloaded
+	 */
+#if defined(_WIN32) || defined(_WIN64)
+	bool get_segments(const char* filepath, int nsegs = 4,
+		__int64 min_seg = 1024 * 1024, int max_retry = 3);
+#else
+	bool get_segments(const char* filepath, int nsegs = 4,
+		long long int min_seg = 1024 * 1024, int max_retry = 3);
+#endif
+
 	/**
 	 * ڲ״̬
 	 * @param url {const char*} ǿʱô URL 캯 URL,
@@ -104,7 +128,17 @@ protected:
 	 */
 	virtual bool on_save(const void* data, size_t len) = 0;
 
+	/**
+	 * Called in get_segments() before sending each request, the subclass
+	 * can add its own header fields such as the cookies; it's called in
+	 * the segments' threads, so it should be thread safe.
+	 * @param hdr {http_header&}
+	 */
+	virtual void on_segment(http_header& hdr);
+
 private:
+	friend class http_segment;
+
 	char* url_;
 	char  addr_[128];
 	http_request* req_;
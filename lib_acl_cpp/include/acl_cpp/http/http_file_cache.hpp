@@ -0,0 +1,177 @@
+#pragma once
+#include "../acl_cpp_define.hpp"
+#include <time.h>
+#include <map>
+#include <list>
+#include "../stdlib/string.hpp"
+#include "../stdlib/noncopyable.hpp"
+#include "../stdlib/thread_mutex.hpp"
+#include "../stdlib/atomic.hpp"
+#include "../stream/fstream.hpp"
+#include "../stream/gather_buf.hpp"
+
+#ifndef ACL_CLIENT_ONLY
+
+namespace acl {
+
+class http_file_cache;
+
+/**
+ * The static file opened and cached by http_file_cache, with the stat data
+ * and the ETag and Last-Modified strings built when opened. The object is
+ * refcounted, one reference is held by the cache and one by each user got
+ * it from http_file_cache::open(), so the file won't be closed while being
+ * sent even if it has been removed from the cache. The file is shared by
+ * all the users, so it should be read by offset such as in sendfile.
+ */
+class ACL_CPP_API http_file : public gather_ref {
+public:
+	/**
+	 * Get the opened file.
+	 * @return {fstream&}
+	 */
+	fstream& get_fstream(void) {
+		return fp_;
+	}
+
+	const char* get_path(void) const {
+		return path_.c_str();
+	}
+
+	long long get_size(void) const {
+		return size_;
+	}
+
+	time_t get_mtime(void) const {
+		return mtime_;
+	}
+
+	/**
+	 * Get the ETag built from the mtime and size, with the quotes.
+	 * @return {const char*}
+	 */
+	const char* get_etag(void) const {
+		return etag_;
+	}
+
+	/**
+	 * Get the mtime in the format of RFC 1123, used as Last-Modified.
+	 * @return {const char*}
+	 */
+	const char* get_last_modified(void) const {
+		return last_modified_;
+	}
+
+private:
+	friend class http_file_cache;
+
+	http_file(const char* path);
+	~http_file(void);
+
+	fstream   fp_;
+	string    path_;
+	long long size_;
+	time_t    mtime_;
+	long long ino_;
+	char      etag_[64];
+	char      last_modified_[64];
+
+	time_t    checked_;
+	int       wd_;
+	std::list<http_file*>::iterator lru_;
+};
+
+/**
+ * The bounded cache of the opened static files, so the requests for the
+ * hot files needn't open, stat and close them each time. One cached file
+ * is checked by stat after it's been cached for ttl seconds, and it will
+ * be reopened if it has been changed; if inotify is used on Linux, the
+ * changed files are removed from the cache by the events, so the ttl
+ * may be longer. The least recently used files are closed when the cache
+ * is full. The lock isn't held when calling the system APIs which may be
+ * hooked, so the cache can be shared by the threads and the fibers.
+ */
+class ACL_CPP_API http_file_cache : public noncopyable {
+public:
+	/**
+	 * Constructor
+	 * @param max {size_t} the max number of the files opened
+	 * @param ttl {int} the seconds before checking the file again,
+	 *  0 means checking each time, which saves open and close only
+	 */
+	http_file_cache(size_t max = 1024, int ttl = 5);
+	~http_file_cache(void);
+
+	/**
+	 * Use inotify to remove the changed files, Linux only.
+	 * @param on {bool}
+	 * @return {bool} false if inotify isn't supported
+	 */
+	bool use_inotify(bool on);
+
+	/**
+	 * Get the regular file from the cache, or open and cache it, the
+	 * caller should call http_file::release() after using it.
+	 * @param path {const char*}
+	 * @return {http_file*} NULL if the file doesn't exist or isn't a
+	 *  regular file
+	 */
+	http_file* open(const char* path);
+
+	/**
+	 * Remove the file from the cache, the file will be closed after
+	 * all the users released it.
+	 * @param path {const char*}
+	 */
+	void invalidate(const char* path);
+
+	/**
+	 * Remove all the files from the cache.
+	 */
+	void clear(void);
+
+	/**
+	 * Get the number of the files in the cache.
+	 * @return {size_t}
+	 */
+	size_t size(void);
+
+	/**
+	 * Get the number of the requests served by the cached files without
+	 * opening them again.
+	 * @return {long long}
+	 */
+	long long hits(void) const {
+		return hits_.value();
+	}
+
+	/**
+	 * Get the number of the requests which opened the files.
+	 * @return {long long}
+	 */
+	long long misses(void) const {
+		return misses_.value();
+	}
+
+private:
+	size_t max_;
+	int    ttl_;
+	int    inotify_fd_;
+	time_t drained_;
+	atomic_long draining_;
+	atomic_long hits_;
+	atomic_long misses_;
+
+	thread_mutex lock_;
+	std::map<string, http_file*> files_;
+	std::multimap<int, http_file*> watches_;
+	std::list<http_file*> lru_;
+
+	http_file* hit(http_file* file);
+	void unlink(http_file* file);
+	void drain(time_t now);
+};
+
+} // namespace acl
+
+#endif // ACL_CLIENT_ONLY
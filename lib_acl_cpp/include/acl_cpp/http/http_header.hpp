@@ -490,6 +490,27 @@ public:
 		return transfer_gzip_;
 	}
 
+	/**
+	 * Set the codec used to compress the body, such as "gzip", "zstd" or
+	 * "br", see compress_codec; set_transfer_gzip(true) is the same as
+	 * setting "gzip".
+	 * @param codec {const char*} NULL or "" to disable the compression
+	 * @return {http_header&}
+	 */
+	http_header& set_content_codec(const char* codec);
+
+	/**
+	 * Get the codec used to compress the body.
+	 * @return {const char*} NULL if the body isn't compressed
+	 */
+	const char* get_content_codec() const
+	{
+		if (transfer_gzip_) {
+			return "gzip";
+		}
+		return content_codec_[0] ? content_codec_ : NULL;
+	}
+
 private:
 	dbuf_guard* dbuf_internal_;
 	dbuf_guard* dbuf_;
@@ -524,6 +545,7 @@ private:
 #endif
 	bool chunked_transfer_;               // ǷΪ chunked ģʽ
 	bool transfer_gzip_;                  // Ƿ gzip ѹ
+	char content_codec_[8];               // the codec other than gzip
 
 	char* upgrade_;
 	// just for websocket
@@ -0,0 +1,220 @@
+#pragma once
+#include "../acl_cpp_define.hpp"
+#include <vector>
+#include "../stdlib/noncopyable.hpp"
+
+#ifndef ACL_CLIENT_ONLY
+
+namespace acl {
+
+class socket_stream;
+
+/**
+ * The single pass parser of the HTTP request header used by the server,
+ * which is kept by one connection and reused by the keep-alive requests.
+ * The header is copied from the read buffer of the stream into the buffer
+ * of the parser, without reading any byte of the body or the next request,
+ * and split there in place, so the names and values are the slices of the
+ * buffer; the query parameters and the cookies are parsed only when being
+ * accessed. The buffers only grow for the larger requests, so nothing is
+ * allocated for the requests after the first ones.
+ */
+class ACL_CPP_API http_request_parser : public noncopyable {
+public:
+	/**
+	 * Constructor
+	 * @param max {size_t} the max length of the request header
+	 */
+	http_request_parser(size_t max = 65536);
+	~http_request_parser(void);
+
+	struct field {
+		const char* name;
+		const char* value;
+	};
+
+	/**
+	 * Read and parse one request header from the stream, the previous one
+	 * is reset first.
+	 * @param in {socket_stream&}
+	 * @return {bool} false if the stream was closed, or the header was
+	 *  invalid or too long
+	 */
+	bool read(socket_stream& in);
+
+	/**
+	 * Parse the request header in the data, used for testing.
+	 * @param data {const char*} ends with the empty line
+	 * @param len {size_t}
+	 * @return {bool}
+	 */
+	bool parse(const char* data, size_t len);
+
+	/**
+	 * Clear the request parsed, the buffers are kept.
+	 */
+	void reset(void);
+
+	/**
+	 * Read the body of the request read, limited by the Content-Length,
+	 * and the chunked body is decoded, with the trailers skipped.
+	 * @param in {socket_stream&} the stream the header was read from
+	 * @param buf {char*}
+	 * @param size {size_t} the size of buf
+	 * @return {int} the length of the data read, 0 if the body has been
+	 *  read completely or there is no body, -1 if error
+	 */
+	int read_body(socket_stream& in, char* buf, size_t size);
+
+	const char* get_method(void) const {
+		return method_;
+	}
+
+	/**
+	 * The URI with the query, without the scheme and the host.
+	 * @return {const char*}
+	 */
+	const char* get_url(void) const {
+		return url_;
+	}
+
+	/**
+	 * The path of the URI with "." and ".." and the empty segments
+	 * removed, not decoded.
+	 * @return {const char*}
+	 */
+	const char* get_path(void) const {
+		return path_;
+	}
+
+	/**
+	 * The query of the URI after '?', not decoded.
+	 * @return {const char*} "" if none
+	 */
+	const char* get_query(void) const {
+		return query_;
+	}
+
+	/**
+	 * The host from the Host header or the URL.
+	 * @return {const char*} "" if none
+	 */
+	const char* get_host(void) const {
+		return host_;
+	}
+
+	int get_port(void) const {
+		return port_;
+	}
+
+	void get_version(unsigned& major, unsigned& minor) const {
+		major = major_;
+		minor = minor_;
+	}
+
+	/**
+	 * @return {long long} -1 if there is no Content-Length
+	 */
+	long long get_content_length(void) const {
+		return content_length_;
+	}
+
+	bool is_chunked(void) const {
+		return chunked_;
+	}
+
+	/**
+	 * The value of the Connection header.
+	 * @return {int} 1 for keep-alive, 0 for close, -1 if not set
+	 */
+	int get_connection(void) const {
+		return connection_;
+	}
+
+	/**
+	 * If the connection should be kept alive by the header and the
+	 * version of HTTP.
+	 * @return {bool}
+	 */
+	bool keep_alive(void) const;
+
+	/**
+	 * Get the value of the header, case insensitive.
+	 * @param name {const char*}
+	 * @return {const char*} NULL if not found
+	 */
+	const char* header_value(const char* name) const;
+
+	const std::vector<field>& get_headers(void) const {
+		return headers_;
+	}
+
+	/**
+	 * Get the range of the Range header, such as "bytes=0-1023".
+	 * @param from {long long&}
+	 * @param to {long long&} -1 if not set
+	 * @return {bool} false if there is no valid Range
+	 */
+	bool get_range(long long& from, long long& to) const;
+
+	/**
+	 * Get the query parameter decoded, which are parsed when called first
+	 * time for one request; the empty ones are ignored.
+	 * @param name {const char*}
+	 * @param case_sensitive {bool}
+	 * @return {const char*} NULL if not found
+	 */
+	const char* get_param(const char* name, bool case_sensitive = false);
+	const std::vector<field>& get_params(void);
+
+	/**
+	 * Get the cookie value, which are parsed when called first time for
+	 * one request.
+	 * @param name {const char*}
+	 * @return {const char*} NULL if not found
+	 */
+	const char* get_cookie(const char* name);
+	const std::vector<field>& get_cookies(void);
+
+private:
+	size_t max_;
+	char*  buf_;		// the request header
+	size_t size_;
+	size_t len_;
+	char*  aux_;		// the path, the params and the cookies
+	size_t aux_size_;
+	size_t aux_len_;
+
+	const char* method_;
+	const char* url_;
+	const char* path_;
+	const char* query_;
+	const char* host_;
+	int  port_;
+	unsigned major_;
+	unsigned minor_;
+	long long content_length_;
+	bool chunked_;
+	int  connection_;
+	int  body_state_;	// BODY_XXX in the .cpp
+	long long body_left_;	// of the body or the current chunk
+
+	bool params_parsed_;
+	bool cookies_parsed_;
+	std::vector<field> headers_;
+	std::vector<field> params_;
+	std::vector<field> cookies_;
+
+	void reserve(size_t n);
+	char* aux_dup(const char* s, size_t n);
+	bool parse_request(void);
+	bool parse_request_line(char* line);
+	void parse_header(char* line);
+	void parse_url(char* url);
+	void strip_path(const char* path, size_t n);
+	bool read_chunk_head(socket_stream& in);
+};
+
+} // namespace acl
+
+#endif // ACL_CLIENT_ONLY
@@ -0,0 +1,264 @@
+#pragma once
+#include "../acl_cpp_define.hpp"
+#include <time.h>
+#include <map>
+#include <set>
+#include <list>
+#include <vector>
+#include "../stdlib/string.hpp"
+#include "../stdlib/noncopyable.hpp"
+#include "../stdlib/thread_mutex.hpp"
+#include "../stdlib/thread_cond.hpp"
+#include "../stdlib/atomic.hpp"
+#include "../stream/gather_buf.hpp"
+
+#ifndef ACL_CLIENT_ONLY
+
+namespace acl {
+
+class http_response_cache;
+class HttpServletRequest;
+class HttpServletResponse;
+
+/**
+ * One response cached by http_response_cache, holding the header fields and
+ * the body serialized once, for the plain body and for each codec used by
+ * the clients. The object is refcounted, one reference is held by the cache
+ * and one by each request sending it, so the data can be sent after it has
+ * been replaced or removed from the cache.
+ */
+class ACL_CPP_API http_cached_response : public gather_ref {
+public:
+	/**
+	 * Get the ETag built from the body, with the quotes.
+	 * @return {const char*}
+	 */
+	const char* get_etag(void) const {
+		return etag_;
+	}
+
+	/**
+	 * Get the plain body.
+	 * @return {const string&}
+	 */
+	const string& get_body(void) const {
+		return variants_.front().body;
+	}
+
+	/**
+	 * The time when the response expires.
+	 * @return {time_t}
+	 */
+	time_t get_expire(void) const {
+		return expire_;
+	}
+
+private:
+	friend class http_response_cache;
+
+	http_cached_response(const char* key);
+	~http_cached_response(void);
+
+	// the header fields serialized after the dynamic ones, and the body
+	struct variant {
+		char   codec[8];	// empty for the plain body
+		string head;
+		string body;
+	};
+
+	string  key_;
+	string  type_;
+	char    etag_[64];
+	time_t  expire_;
+	size_t  size_;
+	bool    cached_;
+	std::list<variant> variants_;	// the plain one is the first, and
+					// they're never removed, so can be
+					// read without the lock after found
+	std::list<http_cached_response*>::iterator lru_;
+};
+
+/**
+ * The generator of the response body called by http_response_cache::serve()
+ * on a miss, usually implemented by the servlet itself.
+ */
+class ACL_CPP_API http_response_generator {
+public:
+	http_response_generator(void) {}
+	virtual ~http_response_generator(void) {}
+
+	/**
+	 * Build the body of the response for the request.
+	 * @param req {HttpServletRequest&}
+	 * @param body {string&} store the body
+	 * @param content_type {string&} store the Content-Type, such as
+	 *  "application/json; charset=utf-8"
+	 * @return {bool} false if the response can't be built, nothing will be
+	 *  cached or sent, and the caller may reply the error itself
+	 */
+	virtual bool generate(HttpServletRequest& req, string& body,
+		string& content_type) = 0;
+};
+
+/**
+ * The cache of the whole responses of the dynamic pages, such as the JSON
+ * built for the same URL again and again. The responses of GET and HEAD are
+ * cached by the URL and the values of the headers set by add_key_header(),
+ * for ttl seconds. The header fields and the body are serialized only once,
+ * and the compressed variant for each codec is built when the codec is used
+ * first time, so a hit is sent by one writev without copying, and the
+ * request with the matched If-None-Match gets 304. When one response
+ * expires, only one request regenerates it, the others get the stale one,
+ * or wait for it if there is none and set_wait_timeout() was set.
+ *
+ * Usage in HttpServlet::doGet:
+ *  return cache.serve(req, res, *this);
+ */
+class ACL_CPP_API http_response_cache : public noncopyable {
+public:
+	/**
+	 * Constructor
+	 * @param ttl {int} the seconds the responses are cached
+	 * @param max {size_t} the max size of all the responses cached
+	 */
+	http_response_cache(int ttl = 10, size_t max = 64 * 1024 * 1024);
+	~http_response_cache(void);
+
+	/**
+	 * Add the request header whose value is a part of the key, such as
+	 * Accept-Language, which should be called before serving.
+	 * @param name {const char*}
+	 * @return {http_response_cache&}
+	 */
+	http_response_cache& add_key_header(const char* name);
+
+	/**
+	 * Set the codecs used to compress the body, in the order of the
+	 * preference, the default is "zstd, br, gzip", empty for none.
+	 * @param codecs {const char*}
+	 * @return {http_response_cache&}
+	 */
+	http_response_cache& set_codecs(const char* codecs);
+
+	/**
+	 * The body shorter than it isn't compressed, the default is 256.
+	 * @param len {size_t}
+	 * @return {http_response_cache&}
+	 */
+	http_response_cache& set_compress_min(size_t len);
+
+	/**
+	 * Set the max milliseconds a request waits for the other one which is
+	 * generating the same response when there is no stale one, after which
+	 * it generates the response itself. The default 0 means never waiting,
+	 * because the waiting blocks the thread with thread_cond, which holds
+	 * all the fibers of it in the fiber mode; so it should be set only in
+	 * the servers of threads.
+	 * @param ms {int}
+	 * @return {http_response_cache&}
+	 */
+	http_response_cache& set_wait_timeout(int ms);
+
+	/**
+	 * Reply the request with the cached response, or generate, cache and
+	 * send it; the requests with other methods than GET and HEAD aren't
+	 * cached and are replied by res as usual. The cached response is sent
+	 * directly to the socket, so res shouldn't be used to send anything
+	 * else.
+	 * @param req {HttpServletRequest&}
+	 * @param res {HttpServletResponse&}
+	 * @param generator {http_response_generator&}
+	 * @return {bool} false if the generator failed or sending failed
+	 */
+	bool serve(HttpServletRequest& req, HttpServletResponse& res,
+		http_response_generator& generator);
+
+	/**
+	 * Remove the responses of the URL with all the key header values.
+	 * @param url {const char*} the request URI with the query string
+	 */
+	void invalidate(const char* url);
+
+	/**
+	 * Remove all the responses from the cache.
+	 */
+	void clear(void);
+
+	/**
+	 * Get the total size of the responses cached.
+	 * @return {size_t}
+	 */
+	size_t size(void);
+
+	/**
+	 * The number of the requests replied by the fresh cached responses.
+	 * @return {long long}
+	 */
+	long long hits(void) const {
+		return hits_.value();
+	}
+
+	/**
+	 * The number of the requests which generated the responses.
+	 * @return {long long}
+	 */
+	long long misses(void) const {
+		return misses_.value();
+	}
+
+	/**
+	 * The number of the requests replied by the expired responses while
+	 * the other request was generating them.
+	 * @return {long long}
+	 */
+	long long stales(void) const {
+		return stales_.value();
+	}
+
+	/**
+	 * The number of the requests replied with 304.
+	 * @return {long long}
+	 */
+	long long not_modified(void) const {
+		return not_modified_.value();
+	}
+
+private:
+	int    ttl_;
+	size_t max_;
+	size_t size_;
+	size_t compress_min_;
+	int    wait_ms_;
+	string codecs_;
+	string vary_;
+	std::vector<string> key_headers_;
+	atomic_long hits_;
+	atomic_long misses_;
+	atomic_long stales_;
+	atomic_long not_modified_;
+
+	thread_mutex lock_;
+	thread_cond  cond_;
+	std::map<string, http_cached_response*> responses_;
+	std::list<http_cached_response*> lru_;
+	std::set<string> generating_;
+
+	void build_vary(void);
+	void build_key(HttpServletRequest& req, string& key) const;
+	http_cached_response* find(const string& key, bool& fresh,
+		bool& generator);
+	http_cached_response* create(const string& key, const string& body,
+		const string& type);
+	void store(http_cached_response* resp,
+		std::vector<http_cached_response*>& olds);
+	void evict(std::vector<http_cached_response*>& olds);
+	void unlink(http_cached_response* resp);
+	const http_cached_response::variant* get_variant(
+		http_cached_response* resp, const char* codec);
+	bool send(HttpServletRequest& req, HttpServletResponse& res,
+		http_cached_response* resp);
+};
+
+} // namespace acl
+
+#endif // ACL_CLIENT_ONLY
@@ -19,6 +19,7 @@ namespace acl
 
 class socket_stream;
 class aio_socket_stream;
+class gather_buf;
 
 enum
 {
@@ -376,8 +377,10 @@ private:
 
 	unsigned status_;
 	string*  peek_buf_;
+	gather_buf* gbuf_;
 
 	void make_frame_header(void);
+	gather_buf& get_gather(void);
 
 	void update_head_2bytes(unsigned char ch1, unsigned ch2);
 	bool peek_head_2bytes(void);
@@ -19,6 +19,7 @@
 #include "stdlib/xml1.hpp"
 #include "stdlib/xml2.hpp"
 #include "stdlib/zlib_stream.hpp"
+#include "stdlib/compress_codec.hpp"
 #include "stdlib/md5.hpp"
 #include "stdlib/sha1.hpp"
 #include "stdlib/charset_conv.hpp"
@@ -42,6 +43,7 @@
 #include "stdlib/diff_string.hpp"
 #include "stdlib/diff_manager.hpp"
 #include "stdlib/token_tree.hpp"
+#include "stdlib/chtable.hpp"
 
 #include "serialize/gsoner.hpp"
 #include "serialize/gson_helper.ipp"
@@ -59,6 +61,8 @@
 #include "stream/stream.hpp"
 #include "stream/istream.hpp"
 #include "stream/ostream.hpp"
+#include "stream/gather_buf.hpp"
+#include "stdlib/compress_cache.hpp"
 #include "stream/fstream.hpp"
 #include "stream/ifstream.hpp"
 #include "stream/ofstream.hpp"
@@ -103,6 +107,9 @@
 #include "http/HttpSession.hpp"
 #include "http/HttpServletRequest.hpp"
 #include "http/HttpServletResponse.hpp"
+#include "http/http_file_cache.hpp"
+#include "http/http_response_cache.hpp"
+#include "http/http_request_parser.hpp"
 #include "http/http_download.hpp"
 #include "http/http_utils.hpp"
 #include "http/http_request_pool.hpp"
@@ -173,6 +180,7 @@
 
 #include "queue/queue_manager.hpp"
 #include "queue/queue_file.hpp"
+#include "queue/queue_log.hpp"
 
 #include "connpool/connect_client.hpp"
 #include "connpool/connect_pool.hpp"
@@ -237,3 +245,4 @@
 #include "mqtt/mqtt_unsuback.hpp"
 #include "mqtt/mqtt_client.hpp"
 #include "mqtt/mqtt_aclient.hpp"
+#include "mqtt/mqtt_broker.hpp"
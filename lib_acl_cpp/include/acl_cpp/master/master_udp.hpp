@@ -6,6 +6,7 @@
 #ifndef ACL_CLIENT_ONLY
 
 struct ACL_VSTRING;
+struct ACL_UDP_PKT;
 
 namespace acl {
 
@@ -41,6 +42,38 @@ protected:
 	 */
 	virtual void on_read(socket_stream* stream) = 0;
 
+	/**
+	 * Called in the batch mode with all the datagrams read by one
+	 * recvmmsg() on the stream, instead of on_read(); the packets'
+	 * buffers are reused after returning, and the replies can be written
+	 * into them and sent by send_batch() in this method. It is called in
+	 * the current server thread.
+	 * @param stream {socket_stream*}
+	 * @param pkts {ACL_UDP_PKT*} the datagrams read
+	 * @param npkts {int} the count of datagrams in pkts, always > 0
+	 */
+	virtual void on_read_batch(socket_stream* stream, ACL_UDP_PKT* pkts,
+		int npkts);
+
+	/**
+	 * Enable the batch mode, which must be called before run_daemon()
+	 * or run_alone(); the max datagrams read once is set by the config
+	 * entry udp_batch_count, and on_read_batch() must be implemented.
+	 * @param yes {bool}
+	 */
+	void set_batch_mode(bool yes);
+
+	/**
+	 * Send the datagrams to their own peer addresses with sendmmsg(),
+	 * usually the packets passed to on_read_batch() are used as replies.
+	 * @param stream {socket_stream&}
+	 * @param pkts {const ACL_UDP_PKT*}
+	 * @param npkts {int}
+	 * @return {int} the count of datagrams sent, -1 if error
+	 */
+	int send_batch(socket_stream& stream, const ACL_UDP_PKT* pkts,
+		int npkts);
+
 	/**
 	 *  UDP ַɹص鷽÷߳б
 	 */
@@ -78,6 +111,7 @@ public:
 private:
 	std::vector<socket_stream*> sstreams_;
 	thread_mutex lock_;
+	bool batch_mode_;
 
 	void run(int argc, char** argv);
 	void push_back(socket_stream* ss);
@@ -87,6 +121,9 @@ private:
 	// յһͻʱص˺
 	static void service_main(void*, ACL_VSTREAM*);
 
+	// batch mode callback with the datagrams read by recvmmsg
+	static void service_on_batch(void*, ACL_VSTREAM*, ACL_UDP_PKT*, int);
+
 	// 󶨵ַɹĻص
 	static void service_on_bind(void*, ACL_VSTREAM*);
 
@@ -1,6 +1,8 @@
 #pragma once
 #include "../acl_cpp_define.hpp"
 #include <time.h>
+#include <string.h>
+#include <vector>
 #include "../connpool/connect_client.hpp"
 #include "../stdlib/string.hpp"
 #include "../mime/rfc2047.hpp"
@@ -10,6 +12,30 @@
 namespace acl {
 
 class socket_stream;
+class dbuf_pool;
+class memcache_manager;
+
+/**
+ * One key for memcache::get_multi, the key and the buffer are set by the
+ * caller, and the value is read from the connection into the buffer
+ * directly, so no string is allocated for each value.
+ */
+struct memcache_item {
+	const char* key;	// the key, set by the caller
+	size_t klen;		// the length of the key
+	char*  buf;		// the buffer for the value set by the caller,
+				// if NULL the value is allocated from the
+				// dbuf_pool given to get_multi
+	size_t size;		// the size of buf
+	size_t len;		// the length of the value, which was truncated
+				// when len > size
+	unsigned short flags;	// the flags stored with the value
+	bool   found;		// if the key was found
+
+	memcache_item(const char* k = NULL, char* b = NULL, size_t n = 0)
+	: key(k), klen(k ? strlen(k) : 0), buf(b), size(n), len(0)
+	, flags(0), found(false) {}
+};
 
 typedef class memcache mem_cache;
 
@@ -194,6 +220,30 @@ public:
 	*/
 	bool del(const char* key);
 
+	/**
+	 * Use the binary protocol or the text protocol in get_multi, the
+	 * default is the text protocol.
+	 * @param on {bool} if true, the keys are sent as a pipeline of the
+	 *  quiet GETKQ requests ended with a NOOP, the server only replies
+	 *  the keys found, else one "get k1 k2 ..." is sent for each batch
+	 *  of the keys
+	 * @return {memcache&}
+	 */
+	memcache& set_binary(bool on);
+
+	/**
+	 * Get the values of multiple keys in one round trip, the values are
+	 * read into the buffers of the items without being copied.
+	 * @param items {memcache_item*} the keys and the buffers, the len,
+	 *  flags and found of each item will be set
+	 * @param n {size_t} the number of the items
+	 * @param dbuf {dbuf_pool*} if not NULL, the values of the items
+	 *  whose buf is NULL are allocated from it, else only the lengths
+	 *  of the values are set for them
+	 * @return {int} the number of the keys found, -1 if error
+	 */
+	int get_multi(memcache_item* items, size_t n, dbuf_pool* dbuf = NULL);
+
 	/**
 	* ϴβ memcached Ϣ
 	* @return {const char*} ϢΪ
@@ -249,6 +299,20 @@ private:
 	string req_line_;        // 洢
 	string res_line_;        // 洢Ӧ
 	bool error_happen(const char* line);
+
+	friend class memcache_manager;
+
+	bool binary_;            // use the binary protocol in get_multi
+	std::vector<size_t> koffs_;  // the offsets of the keys in req_line_
+
+	int  get_multi(std::vector<memcache_item*>& items, dbuf_pool* dbuf);
+	void build_multi(memcache_item** items, size_t n);
+	bool send_multi(bool& has_tried);
+	int  recv_multi(memcache_item** items, size_t n, dbuf_pool* dbuf);
+	int  recv_text(memcache_item** items, size_t n, dbuf_pool* dbuf);
+	int  recv_binary(memcache_item** items, size_t n, dbuf_pool* dbuf);
+	bool read_value(memcache_item* item, size_t len, dbuf_pool* dbuf);
+	bool skip(size_t len);
 };
 
 } // namespace acl
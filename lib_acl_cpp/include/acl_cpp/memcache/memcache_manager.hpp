@@ -1,5 +1,8 @@
 #pragma once
 #include "../acl_cpp_define.hpp"
+#include <vector>
+#include "../stdlib/string.hpp"
+#include "../stdlib/thread_mutex.hpp"
 #include "../connpool/connect_manager.hpp"
 
 #ifndef ACL_CLIENT_ONLY
@@ -7,6 +10,9 @@
 namespace acl
 {
 
+class dbuf_pool;
+struct memcache_item;
+
 /**
  * memcache ͻӳع
  */
@@ -16,6 +22,47 @@ public:
 	memcache_manager();
 	virtual ~memcache_manager();
 
+	/**
+	 * Get the values of the keys stored in the memcached nodes, the keys
+	 * are grouped by the nodes which peek(key) returns, the requests are
+	 * sent to all the nodes before reading any reply, so the nodes handle
+	 * them in parallel, and then the replies are read node by node.
+	 * @param items {memcache_item*} see memcache::get_multi
+	 * @param n {size_t} the number of the items
+	 * @param dbuf {dbuf_pool*} see memcache::get_multi
+	 * @return {int} the number of the keys found, -1 if any node failed,
+	 *  but the items of the other nodes are still filled
+	 */
+	int get_multi(memcache_item* items, size_t n, dbuf_pool* dbuf = NULL);
+
+	/**
+	 * Use the binary protocol in get_multi, see memcache::set_binary.
+	 * @param on {bool}
+	 * @return {memcache_manager&}
+	 */
+	memcache_manager& set_binary(bool on);
+
+	/**
+	 * Peek the pools of the keys with the consistent hash (one ring of
+	 * the virtual nodes of all the servers) instead of the hash modulo of
+	 * connect_manager, so only the keys of one server are moved to the
+	 * others when it is added or removed, and the keys of the server dead
+	 * are moved to the next one on the ring. As the keys are placed on the
+	 * other servers than before, it must be set for all the clients of
+	 * the same servers, before any key is stored.
+	 * @param on {bool} the default is false
+	 * @return {memcache_manager&}
+	 */
+	memcache_manager& set_consistent_hash(bool on);
+
+	/**
+	 * @override
+	 * Peek the pool with the consistent hash if set_consistent_hash(true)
+	 * was called, or else the same as connect_manager::peek.
+	 */
+	connect_pool* peek(const char* key, bool exclusive = true);
+	using connect_manager::peek;
+
 protected:
 	/**
 	 * ി麯ӳض
@@ -24,6 +71,26 @@ protected:
 	 * @param idx {size_t} ӳضڼе±λ( 0 ʼ)
 	 */
 	connect_pool* create_pool(const char* addr, size_t count, size_t idx);
+
+private:
+	struct ring_node {
+		unsigned hash;
+		string addr;
+
+		bool operator<(const ring_node& other) const {
+			return hash < other.hash;
+		}
+	};
+
+	bool binary_;
+	bool consistent_hash_;
+	thread_mutex ring_lock_;
+	std::vector<ring_node> ring_;
+	size_t ring_pools_;
+
+	connect_pool* ring_peek(const char* key, size_t len, bool exclusive);
+	connect_pool* key_peek(const char* key, size_t len);
+	void build_ring(const std::vector<connect_pool*>& pools);
 };
 
 } // namespace acl
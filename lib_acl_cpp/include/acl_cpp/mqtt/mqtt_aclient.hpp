@@ -151,6 +151,10 @@ protected:
 	// should be implemented by subclass.
 	virtual bool on_body(const mqtt_message&) = 0;
 
+	// called after all the mqtt messages in the data read one time have
+	// been handled, the subclass can send the replies in batch here.
+	virtual bool on_read_done() { return true; }
+
 private:
 	aio_handle& handle_;
 	sslbase_conf* ssl_conf_;
@@ -0,0 +1,286 @@
+#pragma once
+
+#include "../acl_cpp_define.hpp"
+#include <string>
+#include <vector>
+#include <deque>
+#include <set>
+#include "../stdlib/noncopyable.hpp"
+#include "../stdlib/string.hpp"
+#include "mqtt_header.hpp"
+
+struct iovec;
+
+namespace acl {
+
+class mqtt_message;
+class mqtt_broker;
+struct mqtt_frame;
+struct mqtt_sub_list;
+struct mqtt_topic_node;
+
+/**
+ * One client connection attached to the mqtt_broker. The session doesn't
+ * do any IO by itself, the messages read from the connection are passed
+ * to handle(), and the messages to the client are queued in the session
+ * and written by flush() with the write_iov() implemented by the subclass,
+ * so the broker can be used in aio, fiber or blocking mode.
+ *
+ * The PUBLISH routed to many sessions is serialized only once, the sessions
+ * only refer to the same buffer, and all the messages queued in a session
+ * will be written to the peer in one writev.
+ */
+class ACL_CPP_API mqtt_session : public noncopyable {
+public:
+	/**
+	 * constructor
+	 * @param broker {mqtt_broker&} the broker the session attached to.
+	 */
+	explicit mqtt_session(mqtt_broker& broker);
+
+	/**
+	 * the subscriptions of the session will be removed from the broker.
+	 */
+	virtual ~mqtt_session();
+
+	/**
+	 * handle one mqtt message read from the client.
+	 * @param msg {mqtt_message&}
+	 * @return {bool} return false if the connection should be closed.
+	 */
+	bool handle(const mqtt_message& msg);
+
+	/**
+	 * write all the messages queued in the session by write_iov(). Only
+	 * one flushing is running at the same time, the messages queued when
+	 * flushing will be written in the same running.
+	 * @return {bool} return false if write_iov() failed.
+	 */
+	bool flush();
+
+	/**
+	 * send one mqtt message to the client, the message is only queued in
+	 * the session until flush() is called.
+	 * @param msg {mqtt_message&}
+	 * @return {bool} return false if serializing the message failed.
+	 */
+	bool send(mqtt_message& msg);
+
+	/**
+	 * get the count of the iovec items waiting to be flushed.
+	 * @return {size_t}
+	 */
+	size_t pending() const {
+		return out_.size();
+	}
+
+	/**
+	 * get the count of the QoS1 messages sent but not acked yet.
+	 * @return {size_t}
+	 */
+	size_t inflight() const {
+		return inflight_.size();
+	}
+
+	/**
+	 * get the count of the QoS1 messages discarded because both the
+	 * inflight window and the waiting queue of the session were full.
+	 * @return {size_t}
+	 */
+	size_t dropped() const {
+		return dropped_;
+	}
+
+	/**
+	 * get the client id of the session from the CONNECT message.
+	 * @return {const char*}
+	 */
+	const char* get_cid() const {
+		return cid_.c_str();
+	}
+
+	/**
+	 * if the CONNECT message has been handled.
+	 * @return {bool}
+	 */
+	bool is_connected() const {
+		return connected_;
+	}
+
+protected:
+	/**
+	 * write all the data in the iovec array to the client, implemented by
+	 * the subclass, the data needn't be copied if the writing is done
+	 * before returning.
+	 * @param iov {const struct iovec*}
+	 * @param count {int} the count of the iovec array.
+	 * @return {bool} return false if writing failed.
+	 */
+	virtual bool write_iov(const struct iovec* iov, int count) = 0;
+
+	/**
+	 * called when some message was queued in the empty session, the
+	 * subclass can wakeup the writer to call flush() in the context of
+	 * the connection, which is needed in fiber mode because writing may
+	 * be suspended.
+	 */
+	virtual void on_pending() {}
+
+private:
+	friend class mqtt_broker;
+
+	struct out_item {
+		mqtt_frame*   frame;	// NULL when id is used
+		unsigned      off;
+		unsigned      len;
+		unsigned char id[2];	// the QoS1 packet id of the session
+	};
+
+	struct sub_ref {
+		mqtt_sub_list* list;
+		size_t         idx;	// the index in list->subs
+	};
+
+	mqtt_broker& broker_;
+	string cid_;
+	bool   connected_;
+	bool   dirty_;
+	size_t dirty_idx_;	// the index in broker_.dirty_
+	bool   flushing_;
+
+	std::vector<out_item> out_;
+	std::vector<out_item> sending_;
+	std::vector<sub_ref>  subs_;
+
+	// the QoS1 packet ids sent but not acked yet.
+	std::set<unsigned short> inflight_;
+	// the QoS1 messages waiting for the room of the inflight window.
+	std::deque<mqtt_frame*> waiting_;
+	unsigned short next_id_;
+	size_t dropped_;
+
+	// used when matching the topic to deliver only once to the session.
+	unsigned long long mark_;
+	unsigned char mark_qos_;
+
+	void enqueue(mqtt_frame* frame, unsigned off, unsigned len);
+	void enqueue_id(unsigned short id);
+	void send_qos1(mqtt_frame* frame);
+	void release(std::vector<out_item>& items);
+};
+
+/**
+ * The mqtt broker engine: the topic filters of the sessions are stored in
+ * a trie with one node for each level, the wildcards '+' and '#' are nodes
+ * too, so matching one topic only walks the levels of it. The shared
+ * subscription like "$share/{group}/{filter}" is stored as one group in
+ * the node, one message is delivered to one session of the group in
+ * round robin. QoS 0 and 1 are supported, QoS 2 is granted as QoS 1, and
+ * every session sends at most inflight_max QoS1 messages without ack.
+ * There are neither retained messages nor persistent sessions.
+ *
+ * The broker isn't thread safe, all the sessions of it should be running
+ * in the same thread, such as one aio_handle, or the fibers of the same
+ * thread of master_fiber.
+ */
+class ACL_CPP_API mqtt_broker : public noncopyable {
+public:
+	/**
+	 * constructor
+	 * @param inflight_max {size_t} the max QoS1 messages of one session
+	 *  which have been sent without PUBACK, not more than 65535 which is
+	 *  the count of the packet ids.
+	 * @param queue_max {size_t} the max QoS1 messages waiting for the
+	 *  inflight window of one session, the others will be discarded.
+	 */
+	explicit mqtt_broker(size_t inflight_max = 32, size_t queue_max = 10000);
+	~mqtt_broker();
+
+	/**
+	 * handle one mqtt message read from the session's client.
+	 * @param sess {mqtt_session&}
+	 * @param msg {mqtt_message&}
+	 * @return {bool} return false if the connection should be closed
+	 *  for the protocol error or DISCONNECT.
+	 */
+	bool handle(mqtt_session& sess, const mqtt_message& msg);
+
+	/**
+	 * publish one message to all the sessions subscribing the topic,
+	 * which can be used to publish messages inside the process.
+	 * @param topic {const char*} the topic without wildcards.
+	 * @param data {const void*} the payload.
+	 * @param len {size_t} the length of the payload.
+	 * @param qos {mqtt_qos_t}
+	 * @return {size_t} the count of the sessions the message was
+	 *  delivered to.
+	 */
+	size_t publish(const char* topic, const void* data, size_t len,
+		mqtt_qos_t qos = MQTT_QOS0);
+
+	/**
+	 * call flush() of all the sessions having messages queued, it should
+	 * be called after handling all the messages read one time in aio or
+	 * blocking mode; in fiber mode, the on_pending() of the session should
+	 * be used to wakeup the writer of each session instead.
+	 */
+	void flush();
+
+	/**
+	 * subscribe one topic filter for the session.
+	 * @param sess {mqtt_session&}
+	 * @param filter {const char*} the topic filter, "$share/{group}/"
+	 *  can be used as the prefix for the shared subscription.
+	 * @param qos {mqtt_qos_t} the max qos requested.
+	 * @return {int} the qos granted, or -1 if the filter is invalid.
+	 */
+	int subscribe(mqtt_session& sess, const char* filter, mqtt_qos_t qos);
+
+	/**
+	 * unsubscribe one topic filter of the session.
+	 * @param sess {mqtt_session&}
+	 * @param filter {const char*}
+	 * @return {bool} return false if the filter wasn't subscribed.
+	 */
+	bool unsubscribe(mqtt_session& sess, const char* filter);
+
+	/**
+	 * get the count of the subscriptions of all the sessions.
+	 * @return {size_t}
+	 */
+	size_t subscriptions() const {
+		return nsubs_;
+	}
+
+private:
+	friend class mqtt_session;
+
+	size_t inflight_max_;
+	size_t queue_max_;
+	size_t nsubs_;
+	mqtt_topic_node* root_;
+	unsigned long long seq_;
+
+	std::vector<std::string>   levels_;
+	std::vector<mqtt_session*> targets_;
+	std::vector<mqtt_session*> dirty_;
+
+	void match(mqtt_topic_node* node, size_t i);
+	void collect(mqtt_topic_node* node);
+	void collect(mqtt_sub_list* list);
+	void mark(mqtt_session* sess, unsigned char qos);
+
+	mqtt_sub_list* find_list(const char* filter, bool create);
+	void remove(mqtt_session& sess, size_t idx);
+	void prune(mqtt_topic_node* node);
+	void detach(mqtt_session& sess);
+	void set_dirty(mqtt_session& sess);
+
+	bool on_connect(mqtt_session& sess, const mqtt_message& msg);
+	bool on_publish(mqtt_session& sess, const mqtt_message& msg);
+	bool on_puback(mqtt_session& sess, unsigned short id);
+	bool on_subscribe(mqtt_session& sess, const mqtt_message& msg);
+	bool on_unsubscribe(mqtt_session& sess, const mqtt_message& msg);
+};
+
+} // namespace acl
@@ -37,6 +37,14 @@ public:
 	 */
 	mqtt_unsubscribe& add_topic(const char* topic);
 
+	/**
+	 * get the message id.
+	 * @return {unsigned short} return 0 if not set.
+	 */
+	unsigned short get_pkt_id() const {
+		return pkt_id_;
+	}
+
 	/**
 	 * get all the topics.
 	 * @return {const std::vector<std::string>&}
@@ -12,6 +12,7 @@
 namespace acl {
 
 class fstream;
+class queue_log;
 
 class ACL_CPP_API queue_file : public noncopyable
 {
@@ -114,6 +115,17 @@ public:
 		return nwriten_;
 	}
 
+	/**
+	 * If the queue file is one record in the queue_log, the data written
+	 * is buffered and appended into the log when it's being closed or
+	 * moved, and get_fstream() returns NULL.
+	 * @return {bool}
+	 */
+	bool in_log(void) const
+	{
+		return log_ != NULL;
+	}
+
 private:
 	friend class queue_manager;
 
@@ -142,6 +154,39 @@ private:
 	bool open(const char* home, const char* queueName, const char* queueSub,
 		const char* partName, const char* extName);
 
+	/**
+	 * Create or open the record in the queue_log, the file path is only
+	 * used as the name, which is home/queueName/.log/partName.extName
+	 */
+	bool create(queue_log* log, const char* home, const char* queueName,
+		const char* extName, unsigned width);
+	bool open(queue_log* log, long long id, const char* home,
+		const char* queueName);
+
+	/**
+	 * Append the data buffered into the log and wait for it committed.
+	 * @return {bool}
+	 */
+	bool log_commit(void);
+
+	/**
+	 * Move the record in log to the queue directory as one queue file.
+	 * @return {bool}
+	 */
+	bool log_export(const char* queueName, const char* extName,
+		unsigned width);
+
+	/**
+	 * Move the queue file on disk or the record in another log into the
+	 * log as one record.
+	 * @return {bool}
+	 */
+	bool log_move(queue_log* log, const char* queueName,
+		const char* extName);
+
+	void make_partName(unsigned width);
+	void make_filePath(void);
+
 	/**
 	 * رյǰļ
 	 */
@@ -217,6 +262,13 @@ private:
 
 	// ѾдļߴС
 	size_t nwriten_;
+
+	// the log holding the record, the id is -1 before appended
+	queue_log* log_;
+	long long  log_id_;
+	string*    log_buf_;
+	size_t     log_off_;
+	time_t     log_stamp_;
 };
 
 } // namespace acl
@@ -0,0 +1,186 @@
+#pragma once
+#include <time.h>
+#include <map>
+#include <deque>
+#include <vector>
+#include "../stdlib/string.hpp"
+#include "../stdlib/noncopyable.hpp"
+#include "../stdlib/thread_mutex.hpp"
+#include "../stdlib/thread_cond.hpp"
+
+namespace acl {
+
+class fstream;
+struct queue_log_seg;
+
+/**
+ * The append log used as the backend of queue_manager, the records are
+ * appended to the big segment files preallocated and mapped into memory,
+ * so no file will be created, renamed or deleted for each queue item.
+ * The appenders waiting for the records being durable are committed in
+ * group, that is the first one calls msync for all of the records appended
+ * before and the others just wait for it. The position of the oldest live
+ * record is saved in a small mapped index file, and the segments before it
+ * are recycled as the spare ones for the new segments.
+ *
+ * The deleted flag and the extension name are updated in place and are
+ * flushed with the next group commit, so one record may be seen again
+ * after the system crashed, that is the queue is at least once.
+ */
+class ACL_CPP_API queue_log : public noncopyable {
+public:
+	/**
+	 * Constructor
+	 * @param path {const char*} the directory holding the segment files
+	 * @param seg_size {size_t} the size of each segment file, which also
+	 *  limits the max size of one record
+	 */
+	queue_log(const char* path, size_t seg_size = 64 * 1024 * 1024);
+	~queue_log(void);
+
+	/**
+	 * Open the log, the records left in the segments will be recovered.
+	 * @return {bool}
+	 */
+	bool open(void);
+
+	/**
+	 * Flush and close the log, called in the destructor, too.
+	 */
+	void close(void);
+
+	/**
+	 * If calling msync in commit(), the default is true.
+	 * @param on {bool}
+	 */
+	void set_sync(bool on);
+
+	/**
+	 * The max number of the spare segments kept for recycling.
+	 * @param n {size_t}
+	 */
+	void set_spare(size_t n);
+
+	/**
+	 * Append one record into the log, the record can't be read before
+	 * commit() called.
+	 * @param key {const char*} the unique key of the record
+	 * @param ext {const char*} the extension name, at most 31 bytes
+	 * @param data {const void*}
+	 * @param len {size_t}
+	 * @return {long long} the id of the record, -1 if error
+	 */
+	long long append(const char* key, const char* ext,
+		const void* data, size_t len);
+
+	/**
+	 * Wait for the record and all the ones before it being committed.
+	 * @param id {long long} the id returned by append()
+	 * @return {bool}
+	 */
+	bool commit(long long id);
+
+	/**
+	 * Mark the record deleted, and the segments whose records have
+	 * all been deleted will be recycled.
+	 * @param id {long long}
+	 * @return {bool}
+	 */
+	bool remove(long long id);
+
+	/**
+	 * Change the extension name of the record in place.
+	 * @param id {long long}
+	 * @param ext {const char*}
+	 * @return {bool}
+	 */
+	bool set_ext(long long id, const char* ext);
+
+	/**
+	 * Read one record committed and not deleted.
+	 * @param id {long long}
+	 * @param key {string*} if not NULL, store the key
+	 * @param ext {string*} if not NULL, store the extension name
+	 * @param data {string*} if not NULL, store the data
+	 * @param stamp {time_t*} if not NULL, store the time appended
+	 * @return {bool}
+	 */
+	bool read(long long id, string* key, string* ext, string* data,
+		time_t* stamp = NULL);
+
+	/**
+	 * Get the id of the next live record committed.
+	 * @param from {long long} the id got before, -1 for the oldest one
+	 * @return {long long} -1 if no more record
+	 */
+	long long next(long long from);
+
+	/**
+	 * Find the live record by the key.
+	 * @param key {const char*}
+	 * @return {long long} -1 if not found
+	 */
+	long long find(const char* key);
+
+	/**
+	 * Get the number of the live records.
+	 * @return {size_t}
+	 */
+	size_t size(void);
+
+	/**
+	 * Get the number of the segments in use.
+	 * @return {size_t}
+	 */
+	size_t segments(void);
+
+	/**
+	 * Get the number of the group commits which have called msync.
+	 * @return {unsigned long long}
+	 */
+	unsigned long long syncs(void) const {
+		return nsync_;
+	}
+
+	const char* get_path(void) const {
+		return path_.c_str();
+	}
+
+private:
+	string path_;
+	size_t seg_size_;
+	bool   sync_;
+	size_t max_spare_;
+	bool   opened_;
+
+	thread_mutex lock_;
+	thread_cond  cond_;
+	bool syncing_;
+	long long committed_;
+	unsigned long long nsync_;
+
+	std::deque<queue_log_seg*> segs_;
+	std::vector<string> spares_;
+	std::map<string, long long> keys_;
+
+	fstream* index_;
+	char* index_base_;
+	void* index_map_;
+	bool index_dirty_;
+	long long head_;
+
+	bool open_index(void);
+	bool load_segments(void);
+	size_t recover(queue_log_seg* seg);
+	queue_log_seg* open_seg(unsigned seq, const char* from);
+	queue_log_seg* new_seg(unsigned seq);
+	void free_seg(queue_log_seg* seg, bool recycle);
+	queue_log_seg* find_seg(long long id) const;
+	char* find_record(long long id) const;
+	long long tail(void) const;
+	long long skip(long long id) const;
+	void advance(void);
+	void seg_path(unsigned seq, string& out) const;
+};
+
+} // namespace acl
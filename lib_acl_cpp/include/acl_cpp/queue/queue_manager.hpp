@@ -10,6 +10,7 @@ typedef struct ACL_SCAN_DIR ACL_SCAN_DIR;
 namespace acl {
 
 class queue_file;
+class queue_log;
 
 class ACL_CPP_API queue_manager : public noncopyable
 {
@@ -35,6 +36,28 @@ public:
 	 */
 	const char* get_home() const;
 
+	/**
+	 * Use the append log under home/queueName/.log instead of one file for
+	 * each queue item, the queue files created, opened or scanned are the
+	 * records in the log, and the data written is appended into the log
+	 * when the queue file is being closed, renamed or moved. The records
+	 * moved to another queue not using log will be written as the queue
+	 * files of that queue.
+	 * @param seg_size {size_t} the size of each segment file in the log
+	 * @param sync {bool} if calling msync when committing the records
+	 * @return {bool}
+	 */
+	bool open_log(size_t seg_size = 64 * 1024 * 1024, bool sync = true);
+
+	/**
+	 * Get the log opened by open_log().
+	 * @return {queue_log*} NULL if the log isn't used
+	 */
+	queue_log* get_log(void) const
+	{
+		return log_;
+	}
+
 	/**
 	 * ļ
 	 * @param extName {const char*} ļչ
@@ -202,6 +225,12 @@ private:
 
 	std::map<string, queue_file*> m_queueList;
 	locker m_queueLocker;
+
+	queue_log* log_;
+	long long  scan_id_;
+
+	bool log_rename(queue_file* fp, const char* extName);
+	queue_file* scan_log(void);
 };
 
 } // namespace acl
@@ -197,6 +197,17 @@ public:
 	redis_result* get_string(socket_stream& conn, dbuf_pool* pool);
 	redis_result* get_array(socket_stream& conn, dbuf_pool* pool);
 
+	/**
+	 * Read one reply without parsing it into redis_result, only the
+	 * boundary of the reply is found and all its RESP data including
+	 * the nested elements are appended to out, used in the passthrough
+	 * mode of redis_client_pipeline.
+	 * @param conn {socket_stream&}
+	 * @param out {string&}
+	 * @return {bool}
+	 */
+	bool get_raw(socket_stream& conn, string& out);
+
 private:
 	void put_data(dbuf_pool* pool, redis_result* rr,
 		const char* data, size_t len);
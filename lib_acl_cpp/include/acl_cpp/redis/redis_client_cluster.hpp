@@ -11,6 +11,7 @@ namespace acl
 {
 
 class sslbase_conf;
+class dbuf_pool;
 
 class redis_client_pool;
 
@@ -228,6 +229,23 @@ private:
 public:
 	const redis_result* run(redis_command& cmd, size_t nchild,
 			int* timeout = NULL);
+
+	/**
+	 * run the requests of different slots: the requests to the same
+	 * redis node are written in one batch, and the replies are read
+	 * after all the nodes having been written, so the nodes handle
+	 * them concurrently. The request whose slot isn't cached, or whose
+	 * node failed, or whose reply is a redirection or CLUSTERDOWN will
+	 * get NULL, and should be run again by run() one by one.
+	 * @param dbuf {dbuf_pool*} the results are allocated from it.
+	 * @param slots {const std::vector<int>&} the slot of each request.
+	 * @param reqs {const std::vector<const string*>&} the requests.
+	 * @param out {std::vector<const redis_result*>&} the result of each
+	 *  request in the same order as the requests.
+	 */
+	void run_batch(dbuf_pool* dbuf, const std::vector<int>& slots,
+			const std::vector<const string*>& reqs,
+			std::vector<const redis_result*>& out);
 };
 
 } // namespace acl
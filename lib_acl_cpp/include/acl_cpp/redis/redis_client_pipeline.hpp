@@ -4,10 +4,13 @@
 #include "../stdlib/string.hpp"
 #include "../stdlib/box.hpp"
 #include "../stdlib/atomic.hpp"
+#include "../stdlib/thread_mutex.hpp"
 #include "redis_command.hpp"
 
 #if !defined(ACL_CLIENT_ONLY) && !defined(ACL_REDIS_DISABLE)
 
+struct iovec;
+
 namespace acl {
 
 class token_tree;
@@ -43,6 +46,9 @@ public:
 	, addr_(NULL)
 	, redirect_count_(0)
 	, channel_(NULL)
+	, stamp_(0)
+	, reply_(NULL)
+	, raw_ok_(false)
 	{
 	}
 
@@ -80,6 +86,8 @@ public:
 		result_  = NULL;
 		addr_    = NULL;
 		redirect_count_ = 0;
+		stamp_   = 0;
+		reply_   = NULL;
 	}
 
 	// Called in redis_command::build_request().
@@ -92,6 +100,32 @@ public:
 		slot_ = slot;
 	}
 
+	/**
+	 * Set the message in the raw mode for the passthrough proxy, the
+	 * request holds the RESP data of one command got from the client,
+	 * and the reply from redis will be framed but not be parsed, so it
+	 * can be written back to the client directly, see wait_raw().
+	 * @param req {const string*} The RESP data of one command.
+	 * @param slot {int} The hash slot computed from the key, see
+	 *  redis_client_pipeline::hash_slot().
+	 * @param reply {string*} Store the RESP data of the reply.
+	 */
+	void set_raw(const string* req, int slot, string* reply) {
+		req_     = req;
+		slot_    = slot;
+		reply_   = reply;
+		raw_ok_  = false;
+		timeout_ = -1;
+		result_  = NULL;
+		addr_    = NULL;
+		redirect_count_ = 0;
+		stamp_   = 0;
+	}
+
+	bool is_raw(void) const {
+		return reply_ != NULL;
+	}
+
 public:
 	// Called in redis_pipeline_channel::flush_all().
 	const string* get_request(void) const {
@@ -108,6 +142,18 @@ public:
 		return slot_;
 	}
 
+	// Called in redis_pipeline_channel::wait_raw().
+	string* get_reply(void) const {
+		return reply_;
+	}
+
+	// Called in redis_pipeline_channel::wait_raw(), the address will
+	// be copied because the reply buffer will be reused.
+	void set_raw_addr(const char* addr, size_t len) {
+		raw_addr_.copy(addr, len);
+		set_addr(raw_addr_.c_str());
+	}
+
 	// Called in redis_pipeline_channel::wait_one().
 	void set_addr(const char* addr) {
 		addr_ = addr;
@@ -135,6 +181,16 @@ public:
 		return channel_;
 	}
 
+	// Called in redis_client_pipeline::push() when the message is put
+	// into the pipeline, and used to compute the time of queue waiting.
+	void set_stamp(long long stamp) {
+		stamp_ = stamp;
+	}
+
+	long long get_stamp(void) const {
+		return stamp_;
+	}
+
 public:
 	void push(const redis_result* result) {
 		result_ = result;
@@ -146,6 +202,19 @@ public:
 		return result_;
 	}
 
+	// Called in redis_pipeline_channel::wait_raw() when the reply has
+	// been read into the buffer set in set_raw().
+	void push_raw(void) {
+		raw_ok_ = true;
+		box_->push(this, false);
+	}
+
+	// Wait for the reply in the raw mode, push(NULL) means failed.
+	bool wait_raw(void) {
+		box_->pop();
+		return raw_ok_;
+	}
+
 	const char* get_addr(void) const {
 		return addr_;
 	}
@@ -174,13 +243,58 @@ private:
 	atomic_long refers_;
 
 	redis_pipeline_channel* channel_;
+	long long stamp_;	// In microseconds
+
+	string* reply_;		// Not NULL in the raw mode
+	bool    raw_ok_;
+	string  raw_addr_;	// The redirect address in the raw mode
 };
 
 class redis_client_pipeline;
 
+// The count of the slots in the batch size histogram.
+#define REDIS_PIPELINE_HIST	12
+
+/**
+ * The statistics of one pipeline channel, all the times are microseconds.
+ */
+struct redis_pipeline_stat {
+	redis_pipeline_stat(void) {
+		reset();
+	}
+
+	void reset(void) {
+		batches = messages = 0;
+		for (int i = 0; i < REDIS_PIPELINE_HIST; i++) {
+			batch_sizes[i] = 0;
+		}
+		queue_wait = queue_wait_max = 0;
+		rtt = rtt_max = 0;
+	}
+
+	long long batches;	// The count of the batches written
+	long long messages;	// The count of the messages in all batches
+
+	// batch_sizes[0] is the count of the batches with one message, and
+	// batch_sizes[i] is the count with (2^(i-1), 2^i] messages, the last
+	// one counts all the bigger batches.
+	long long batch_sizes[REDIS_PIPELINE_HIST];
+
+	// The time from the message put into the pipeline to being written.
+	long long queue_wait;	// The total of all messages
+	long long queue_wait_max;
+
+	// The time from one batch being written to all its replies read.
+	long long rtt;		// The total of all batches
+	long long rtt_max;
+};
+
 /**
  * One pipeline channel thread for one redis node, which waits for message
  * from pipline thread and try to combine more messages and sends to redis.
+ * When the messages come faster than the replies, the channel will wait
+ * a little more time for more messages to be sent in one batch, see
+ * redis_client_pipeline::set_coalesce().
  */
 class redis_pipeline_channel : public thread {
 public:
@@ -188,6 +302,13 @@ public:
 		const char* addr, int conn_timeout, int rw_timeout, bool retry);
 	~redis_pipeline_channel(void);
 
+	// Set the max time waiting for more messages and the batch size
+	// target, see redis_client_pipeline::set_coalesce().
+	void set_coalesce(int max_delay, size_t max_batch);
+
+	// Copy the statistics of the channel, which is thread safe.
+	void get_stat(redis_pipeline_stat& out);
+
 	bool start_thread(void);
 	void stop_thread(void);
 
@@ -204,18 +325,33 @@ protected:
 private:
 	redis_client_pipeline& pipeline_;
 	string addr_;
-	string buf_;
 	redis_client* client_;
 	box<redis_pipeline_message>* box_;
 	std::vector<redis_pipeline_message*> msgs_;
+
+	struct iovec* iov_;	// Refer to the requests of msgs_
+	size_t iov_size_;
+
+	int    max_delay_;	// Max time in us waiting for more messages
+	size_t max_batch_;	// Send at once when so many messages got
+	double avg_batch_;	// Moving average of the batch sizes
+	long long first_stamp_;	// When the first message of msgs_ got
+
+	thread_mutex lock_;	// Protect stat_
+	redis_pipeline_stat stat_;
+
 public:
 	void push(redis_pipeline_message* msg);
 
 private:
+	bool coalescing(int& timeout);
+	void update_stat(size_t n, long long wait, long long wait_max,
+		long long rtt);
 	bool handle_messages(void);
 	bool flush_all(void);
 	bool wait_results(void);
 	bool wait_one(socket_stream& conn, redis_pipeline_message& msg);
+	bool wait_raw(socket_stream& conn, redis_pipeline_message& msg);
 	void all_failed(void);
 };
 
@@ -223,7 +359,8 @@ private:
  * Redis pipline communication, be set and used in redis_command to
  * improve the performance of redis commands, but not all redis commands
  * in acl can be used in pipeline mode, such as below:
- * 1. multiple keys operation
+ * 1. multiple keys operation except MGET, MSET and DEL, which are split
+ *    by the hash slots of the keys
  * 2. blocked operation such as SUBSCRIBE in pubsub, BLPOP in list
  */
 class ACL_CPP_API redis_client_pipeline : public thread {
@@ -264,11 +401,38 @@ public:
 	// Set if connecting all the redis nodes after starting
 	redis_client_pipeline& set_preconnect(bool yes);
 
+	/**
+	 * Set the coalescing window of the channels, which should be called
+	 * before start_thread(). When the channel has sent the batches with
+	 * more than one message on average, it'll wait at most max_delay
+	 * microseconds for more messages until max_batch messages got, or
+	 * else the messages are sent at once, so the low load gets the low
+	 * latency and the high load gets the big batches.
+	 * @param max_delay {int} The max time in microseconds one message
+	 *  waiting for the others, 0 for no waiting which is the default;
+	 *  the channel waits in milliseconds, so the messages are sent when
+	 *  less than one millisecond is left.
+	 * @param max_batch {size_t} The messages will be sent at once when
+	 *  so many messages are waiting, the default is 256.
+	 */
+	redis_client_pipeline& set_coalesce(int max_delay, size_t max_batch);
+
+	/**
+	 * Get the statistics of all the channels, which is thread safe.
+	 * @param out {std::map<string, redis_pipeline_stat>&} The key is
+	 *  the address of the redis node of each channel.
+	 */
+	void get_stats(std::map<string, redis_pipeline_stat>& out);
+
 	// Get the max hash slot of redis
 	int get_max_slot(void) const {
 		return max_slot_;
 	}
 
+	// Compute the hash slot of the key for redis_pipeline_message::
+	// set_raw(), the hash tag in the key is used as redis cluster does.
+	int hash_slot(const char* key, size_t len) const;
+
 protected:
 	// @override from acl::thread
 	void* run(void);
@@ -282,9 +446,17 @@ private:
 	int    rw_timeout_;	// IO timeout with redis
 	bool   retry_;		// If try again when disconnect from redis
 	bool   preconn_;	// If connecting all redis nodes when starting
+	int    max_delay_;	// Max time in us waiting for more messages
+	size_t max_batch_;	// Max messages in one batch of waiting
 
 	token_tree* channels_;	// holds and manage all pipeline channels
 
+	// All the running channels for getting statistics in other threads.
+	thread_mutex lock_;
+	std::vector<redis_pipeline_channel*> running_;
+	void add_running(redis_pipeline_channel* channel);
+	void del_running(redis_pipeline_channel* channel);
+
 	// The message queue for receiving redis message from other threads
 	box<redis_pipeline_message>* box_;
 
@@ -343,6 +515,23 @@ private:
  *		key.format("test-key-%d", (int) i);
  *		cmd.del(key);
  *	}
+ *
+ * // The passthrough proxy forwards the RESP data of the client without
+ * // parsing the commands and the replies.
+ * void forward(acl::redis_client_pipeline& pipeline, const acl::string& req,
+ *	const char* key, size_t len, acl::socket_stream& client) {
+ *	acl::box<acl::redis_pipeline_message>* box = pipeline.create_box();
+ *	acl::redis_pipeline_message* msg = new acl::redis_pipeline_message(
+ *		acl::redis_pipeline_t_cmd, box);
+ *	msg->refer();
+ *	acl::string reply;
+ *	msg->set_raw(&req, pipeline.hash_slot(key, len), &reply);
+ *	pipeline.push(msg);
+ *	if (msg->wait_raw()) {
+ *		client.write(reply);
+ *	}
+ *	msg->unrefer();
+ * }
  */
 } // namespace acl
 
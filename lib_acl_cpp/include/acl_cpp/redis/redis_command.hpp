@@ -461,6 +461,10 @@ public:
 	void hash_slot(const char* key);
 	void hash_slot(const char* key, size_t len);
 
+	// compute the hash slot of the key, only the hash tag between '{'
+	// and '}' is hashed if it isn't empty, the same as redis cluster.
+	static int key_slot(const char* key, size_t len, int max_slot);
+
 	// get the current hash slot stored internal
 	int get_slot(void) const {
 		return slot_;
@@ -515,6 +519,14 @@ protected:
 	// reserve the argv space with the specified value at least
 	void argv_space(size_t n);
 
+	// mark the multi-key command built just now to be split by the hash
+	// slots of its keys when running in cluster or pipeline mode, step
+	// is 1 if all the args after the command name are keys, or 2 if they
+	// are key-value pairs, such as MSET.
+	void set_multi_keys(size_t step) {
+		multi_step_ = step;
+	}
+
 	// build request in one request buffer
 	void build_request1(size_t argc, const char* argv[], const size_t lens[]);
 
@@ -529,6 +541,19 @@ protected:
 
 	// save the error info into log
 	void logger_result(const redis_result* result);
+
+private:
+	size_t multi_step_;
+
+	// run the sub-commands of the different slots concurrently and
+	// merge their results in the order of the keys into result_.
+	bool run_multi(size_t step, int* timeout);
+	void run_slots(const std::vector<int>& slots,
+		const std::vector<const string*>& reqs,
+		std::vector<const redis_result*>& out, int* timeout);
+	const redis_result* merge_results(size_t nkeys,
+		const std::vector<std::pair<size_t, size_t> >& pos,
+		const std::vector<const redis_result*>& results);
 };
 
 } // namespace acl
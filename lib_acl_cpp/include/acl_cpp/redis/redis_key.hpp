@@ -104,6 +104,16 @@ public:
 	bool exists(const char* key, size_t len);
 	bool exists(const char* key);
 
+	/**
+	 * count how many of the keys exist, the keys of the different hash
+	 * slots are checked by slot and the counts are summed in the cluster
+	 * or pipeline mode; the key given more than once is counted each time
+	 * @param keys {const std::vector<string>&} the keys
+	 * @return {int} the number of the keys existing, -1 if error
+	 */
+	int exists(const std::vector<string>& keys);
+	int exists(const std::vector<const char*>& keys);
+
 	/**
 	 *  KEY ڣλ룩
 	 * set a key's time to live in seconds
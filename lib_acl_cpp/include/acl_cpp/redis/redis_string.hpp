@@ -363,7 +363,9 @@ public:
 
 	/**
 	 * ͬʱһ key-value 
-	 * set multiple key-value pair
+	 * set multiple key-value pair; in cluster or pipeline mode, the
+	 * pairs are split by the slots of the keys and set concurrently on
+	 * the redis nodes, so it isn't atomic when the slots are different.
 	 * @param objs key-value Լ
 	 *  the collection of multiple key-value pair
 	 * @return {bool} Ƿɹ
@@ -404,7 +406,9 @@ public:
 	/**
 	 * (һ) key ֵ key 棬ĳ key ڣ
 	 * ô key ؿմӽ
-	 * get the values of the given keys
+	 * get the values of the given keys; in cluster or pipeline mode,
+	 * the keys in different slots are got from the redis nodes
+	 * concurrently and the values are in the same order as the keys.
 	 * @param keys {const std::vector<string>&} ַ key 
 	 *  the given keys
 	 * @param out {std::vector<acl::string>*} ǿʱ洢ֵַ飬
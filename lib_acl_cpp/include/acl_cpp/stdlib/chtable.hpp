@@ -0,0 +1,90 @@
+#pragma once
+#include "../acl_cpp_define.hpp"
+#include "noncopyable.hpp"
+
+struct ACL_CHTABLE;
+
+namespace acl {
+
+/**
+ * The wrapper of ACL_CHTABLE, the sharded concurrent hash table, which can
+ * be operated by multiple threads without any lock outside; the keys are
+ * copied, and the values are only stored as pointers.
+ */
+class ACL_CPP_API chtable : public noncopyable
+{
+public:
+	/**
+	 * @param size {int} the initial capacity of the whole table
+	 * @param nshards {int} the number of shards, which will be rounded
+	 *  up to a power of 2, the default 16 will be used if it's <= 0
+	 * @param key_lower {bool} if the keys are case insensitive
+	 */
+	chtable(int size = 1024, int nshards = 0, bool key_lower = false);
+	~chtable(void);
+
+	/**
+	 * Add a new item, which will fail if the key exists
+	 * @param key {const char*}
+	 * @param value {void*}
+	 * @return {bool} false if the key exists
+	 */
+	bool insert(const char* key, void* value);
+
+	/**
+	 * Add the item, or replace the value if the key exists
+	 * @param key {const char*}
+	 * @param value {void*}
+	 * @return {void*} the old value if the key existed, or NULL
+	 */
+	void* set(const char* key, void* value);
+
+	/**
+	 * Find the value of the key
+	 * @param key {const char*}
+	 * @return {void*} NULL if not found
+	 */
+	void* find(const char* key) const;
+
+	/**
+	 * Remove the item of the key
+	 * @param key {const char*}
+	 * @return {void*} the value of the removed item, NULL if not found
+	 */
+	void* remove(const char* key);
+
+	/**
+	 * Remove all the items
+	 * @param free_fn {void (*)(void*)} if not NULL, it'll be called with
+	 *  the value of each item
+	 */
+	void clear(void (*free_fn)(void*) = NULL);
+
+	/**
+	 * Call walk_fn with the key, the value of each item and arg, one
+	 * shard is locked at a time, so walk_fn can't operate on the table
+	 * @param walk_fn {void (*)(const char*, void*, void*)}
+	 * @param arg {void*}
+	 */
+	void walk(void (*walk_fn)(const char*, void*, void*), void* arg);
+
+	/**
+	 * The number of the items in the table
+	 * @return {size_t}
+	 */
+	size_t size(void) const;
+
+	/**
+	 * Get the C object
+	 * @return {ACL_CHTABLE*}
+	 */
+	ACL_CHTABLE* get_table(void) const
+	{
+		return table_;
+	}
+
+private:
+	ACL_CHTABLE* table_;
+};
+
+} // namespace acl
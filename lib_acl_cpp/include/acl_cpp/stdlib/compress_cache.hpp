@@ -0,0 +1,118 @@
+#pragma once
+#include "../acl_cpp_define.hpp"
+#include <map>
+#include <list>
+#include "string.hpp"
+#include "noncopyable.hpp"
+#include "thread_mutex.hpp"
+#include "atomic.hpp"
+#include "../stream/gather_buf.hpp"
+
+namespace acl {
+
+class compress_cache;
+
+/**
+ * The compressed variant of one response cached by compress_cache. The
+ * object is refcounted, one reference is held by the cache and one by each
+ * user got it from compress_cache::get(), so the data can be sent after it
+ * has been removed from the cache.
+ */
+class ACL_CPP_API compress_variant : public gather_ref {
+public:
+	/**
+	 * The codec used, such as "gzip", "zstd" or "br".
+	 * @return {const char*}
+	 */
+	const char* get_codec(void) const {
+		return codec_;
+	}
+
+	/**
+	 * The compressed data.
+	 * @return {const string&}
+	 */
+	const string& get_data(void) const {
+		return data_;
+	}
+
+private:
+	friend class compress_cache;
+
+	compress_variant(const char* key, const char* codec);
+	~compress_variant(void);
+
+	string key_;
+	char   codec_[8];
+	string data_;
+	std::list<compress_variant*>::iterator lru_;
+};
+
+/**
+ * The bounded cache of the compressed variants of the static files and the
+ * hot responses, each of which is compressed only once with the best level
+ * of its codec, so the responses needn't be compressed for each request.
+ * The least recently used variants are removed when the total size of the
+ * data exceeds the limit. The data is compressed without holding the lock.
+ */
+class ACL_CPP_API compress_cache : public noncopyable {
+public:
+	/**
+	 * Constructor
+	 * @param max {size_t} the max size of all the data cached
+	 */
+	compress_cache(size_t max = 64 * 1024 * 1024);
+	~compress_cache(void);
+
+	/**
+	 * Get the variant from the cache, or compress the data and cache it,
+	 * the caller should call compress_variant::release() after using it.
+	 * @param key {const char*} identifies the data, which should be
+	 *  changed when the data is changed, such as the path with the ETag
+	 * @param codec {const char*} "gzip", "zstd" or "br"
+	 * @param data {const void*} the original data
+	 * @param len {size_t}
+	 * @return {compress_variant*} NULL if the codec isn't supported
+	 */
+	compress_variant* get(const char* key, const char* codec,
+		const void* data, size_t len);
+
+	/**
+	 * Remove all the variants of the key from the cache.
+	 * @param key {const char*}
+	 */
+	void invalidate(const char* key);
+
+	/**
+	 * Remove all the variants from the cache.
+	 */
+	void clear(void);
+
+	/**
+	 * Get the total size of the data cached.
+	 * @return {size_t}
+	 */
+	size_t size(void);
+
+	long long hits(void) const {
+		return hits_.value();
+	}
+
+	long long misses(void) const {
+		return misses_.value();
+	}
+
+private:
+	size_t max_;
+	size_t size_;
+	atomic_long hits_;
+	atomic_long misses_;
+
+	thread_mutex lock_;
+	std::map<string, compress_variant*> variants_;
+	std::list<compress_variant*> lru_;
+
+	void unlink(compress_variant* variant);
+};
+
+} // namespace acl
@@ -0,0 +1,118 @@
+#pragma once
+#include "../acl_cpp_define.hpp"
+#include "noncopyable.hpp"
+
+namespace acl {
+
+class string;
+
+/**
+ * The common interface of the compressors used as the HTTP Content-Encoding,
+ * such as gzip, zstd and br. The codec is reusable: begin() resets the
+ * context created before instead of creating a new one, so the codecs should
+ * be got from and put back into the per-thread pool by get() and put(). The
+ * zstd and brotli libraries are loaded dynamically when used first time, so
+ * they needn't be installed when building.
+ */
+class ACL_CPP_API compress_codec : public noncopyable {
+public:
+	virtual ~compress_codec(void) {}
+
+	/**
+	 * The name used in Content-Encoding, "gzip", "zstd" or "br".
+	 * @return {const char*}
+	 */
+	virtual const char* name(void) const = 0;
+
+	/**
+	 * Begin compressing one stream, the calling order must be:
+	 * begin->update->finish.
+	 * @param level {int} the level of the codec itself, -1 for the default
+	 *  one for the dynamic content
+	 * @return {bool}
+	 */
+	virtual bool begin(int level = -1) = 0;
+
+	/**
+	 * Compress the data and append the result into out, which may be
+	 * empty because the data may be buffered by the codec.
+	 * @param in {const void*}
+	 * @param len {size_t}
+	 * @param out {string*}
+	 * @return {bool}
+	 */
+	virtual bool update(const void* in, size_t len, string* out) = 0;
+
+	/**
+	 * Finish the stream and append all the data left into out.
+	 * @param out {string*}
+	 * @return {bool}
+	 */
+	virtual bool finish(string* out) = 0;
+
+	/**
+	 * The level with the best compression ratio, used for the variants
+	 * compressed once and cached.
+	 * @return {int}
+	 */
+	virtual int best_level(void) const = 0;
+
+	/**
+	 * Compress the whole data as one stream.
+	 * @param in {const void*}
+	 * @param len {size_t}
+	 * @param out {string*} the result is appended
+	 * @param level {int}
+	 * @return {bool}
+	 */
+	bool compress(const void* in, size_t len, string* out, int level = -1);
+
+	/**
+	 * Check if the codec is supported, the library will be loaded.
+	 * @param name {const char*} "gzip", "zstd" or "br"
+	 * @return {bool}
+	 */
+	static bool supported(const char* name);
+
+	/**
+	 * Choose the codec accepted by the client by the Accept-Encoding, in
+	 * the order of the server's preference.
+	 * @param accept {const char*} the value of Accept-Encoding
+	 * @param prefer {const char*} the codecs separated by comma
+	 * @return {const char*} NULL if none of them can be used
+	 */
+	static const char* negotiate(const char* accept,
+		const char* prefer = "zstd, br, gzip");
+
+	/**
+	 * Get one idle codec from the pool of the current thread, or create
+	 * one if the pool is empty.
+	 * @param name {const char*}
+	 * @return {compress_codec*} NULL if the codec isn't supported
+	 */
+	static compress_codec* get(const char* name);
+
+	/**
+	 * Put the codec back into the pool of the current thread, the codec
+	 * will be freed if the pool is full.
+	 * @param codec {compress_codec*}
+	 */
+	static void put(compress_codec* codec);
+
+	/**
+	 * Set the max number of the idle codecs of each type kept in the pool
+	 * of one thread, the default is 64.
+	 * @param max {size_t}
+	 */
+	static void set_pool_max(size_t max);
+
+	/**
+	 * Set the path of the dynamic library of zstd or brotli, which
+	 * should be called before using them.
+	 * @param name {const char*} "zstd" or "br"
+	 * @param path {const char*}
+	 */
+	static void set_loadpath(const char* name, const char* path);
+};
+
+} // namespace acl
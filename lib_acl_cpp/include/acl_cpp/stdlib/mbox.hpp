@@ -1,6 +1,7 @@
 #pragma once
 #include "../acl_cpp_define.hpp"
 #include <assert.h>
+#include <vector>
 #include "box.hpp"
 
 namespace acl {
@@ -10,6 +11,7 @@ void*  mbox_create(bool mpsc);
 void   mbox_free(void*, void (*free_fn)(void*));
 bool   mbox_send(void*, void*);
 void*  mbox_read(void*, int, bool*);
+int    mbox_read_batch(void*, void**, int, int, bool*);
 size_t mbox_nsend(void*);
 size_t mbox_nread(void*);
 
@@ -94,6 +96,34 @@ public:
 		return (T*) mbox_read(mbox_, timeout, success);
 	}
 
+	/**
+	 * Pop the messages in batch, wait only when the mbox is empty, and
+	 * then take the messages pending without waiting again.
+	 * @param out {std::vector<T*>&} the messages popped are appended
+	 * @param max {size_t} the max number of the messages to pop
+	 * @param timeout {int} same as in pop()
+	 * @param success {bool*} same as in pop()
+	 * @return {size_t} the number of the messages popped
+	 */
+	size_t pop(std::vector<T*>& out, size_t max, int timeout = -1,
+		bool* success = NULL)
+	{
+		T* msgs[64];
+		size_t n = 0;
+
+		while (n < max) {
+			int cnt = (int) (max - n > 64 ? 64 : max - n);
+			cnt = mbox_read_batch(mbox_, (void**) msgs, cnt,
+				n == 0 ? timeout : 0, success);
+			if (cnt <= 0) {
+				break;
+			}
+			out.insert(out.end(), msgs, msgs + cnt);
+			n += (size_t) cnt;
+		}
+		return n;
+	}
+
 	/**
 	 * mbox ûпϢ
 	 * @return {bool}
@@ -123,6 +123,9 @@ public:
 	 * ʼѹ̣ʽѹʽ˳ǣ
 	 * zip_begin->zip_update->zip_finishмκһ
 	 * ʧܣӦõ zip_reset
+	 * The deflate state is kept after zip_finish(), so the next zip_begin()
+	 * with the same arguments only resets it instead of allocating it again,
+	 * and zip_reset() or the destructor frees it.
 	 * @param level {zlib_level_t} ѹ𣬼Խߣѹ
 	 *  ԽߣѹٶԽ
 	 * @param wbits {zlib_wbits_t} ѹеĻڼֵԽ
@@ -196,6 +199,7 @@ public:
 	 * ʼѹ̣ʽѹʽ˳ǣ
 	 * unzip_begin->unzip_update->unzip_finishмκһ
 	 * ʧܣӦõ unzip_reset
+	 * The inflate state is kept after unzip_finish() as the deflate one.
 	 * @param have_zlib_header {bool} Ƿ zlib_header ͷ
 	 *  HTTP ЭӦýֵΪ false
 	 * @param wsize {int} ѹеĻڴС
@@ -300,6 +304,14 @@ private:
 	unsigned zlib_flags_;
 	zlib_flush_t flush_;
 
+	// the deflate or inflate state kept for reusing, with its arguments
+	int  ready_;
+	int  ready_level_;
+	int  ready_wbits_;
+	int  ready_mlevel_;
+
+	void end_ready(void);
+
 	bool update(int (*func)(z_stream*, int), zlib_flush_t flag,
 		const char* in, int len, string* out);
 	bool flush_out(int (*func)(z_stream*, int),
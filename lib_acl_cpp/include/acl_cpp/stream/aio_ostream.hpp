@@ -11,6 +11,7 @@ struct iovec;
 namespace acl {
 
 class aio_ostream;
+class gather_buf;
 
 /**
  * ӳ첽д࣬Ϊ aio_timer_callback (see aio_handle.hpp)
@@ -169,6 +170,23 @@ public:
 		writev_await(iov, count);
 	}
 
+	/**
+	 * Write the slices queued in gather way with one writev, the data
+	 * not written at once is copied into the write queue of the stream,
+	 * so buf is cleared when returning and the callbacks are triggered
+	 * the same as writev_await.
+	 * @param buf {gather_buf&}
+	 */
+	void sendv_await(gather_buf& buf);
+
+	/**
+	 * same as sendv_await()
+	 */
+	void sendv(gather_buf& buf)
+	{
+		sendv_await(buf);
+	}
+
 	/**
 	 * ʽʽ첽дݣȫдɹʱʱ
 	 * ûעĻص
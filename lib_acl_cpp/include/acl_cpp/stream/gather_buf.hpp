@@ -0,0 +1,164 @@
+#pragma once
+#include "../acl_cpp_define.hpp"
+#include <stdarg.h>
+#include <vector>
+#include "../stdlib/noncopyable.hpp"
+#include "../stdlib/atomic.hpp"
+#include "../stdlib/string.hpp"
+
+struct iovec;
+
+namespace acl {
+
+/**
+ * The refcounted owner of the buffers referenced by gather_buf, one
+ * reference is held for each slice added and released after the slice
+ * has been sent or the gather_buf is cleared, the creator holds the first
+ * reference and should call release() when it needn't the object any more.
+ */
+class ACL_CPP_API gather_ref : public noncopyable {
+public:
+	gather_ref(void);
+
+	/**
+	 * Add one reference.
+	 */
+	void hold(void);
+
+	/**
+	 * Drop one reference, destroy() is called when no one refers it.
+	 */
+	void release(void);
+
+protected:
+	virtual ~gather_ref(void);
+
+	/**
+	 * Called when the last reference is released, the subclass not
+	 * allocated on heap should override it.
+	 */
+	virtual void destroy(void)
+	{
+		delete this;
+	}
+
+private:
+	atomic_long refers_;
+};
+
+/**
+ * The queue of the slices to be written by ostream::sendv in gather way,
+ * the slices added only refer the caller's buffers which must be kept
+ * until being sent, and the small ones such as the protocol headers may be
+ * copied into the internal buffer, the adjacent copied slices are merged
+ * into one. The progress of the partial writes is kept in the object, so
+ * the left slices can be sent again.
+ */
+class ACL_CPP_API gather_buf : public noncopyable {
+public:
+	/**
+	 * @param nslice {size_t} the initial capacity of the slices
+	 */
+	gather_buf(size_t nslice = 16);
+	~gather_buf(void);
+
+	/**
+	 * Refer the caller's buffer without copying it.
+	 * @param data {const void*}
+	 * @param len {size_t} the empty slice is ignored
+	 * @return {gather_buf&}
+	 */
+	gather_buf& add(const void* data, size_t len);
+
+	/**
+	 * Refer the data of the string, which mustn't be changed before sent.
+	 * @param s {const string&}
+	 * @return {gather_buf&}
+	 */
+	gather_buf& add(const string& s);
+
+	/**
+	 * Refer the buffer owned by the refcounted object, one reference is
+	 * held until the slice is sent or cleared.
+	 * @param data {const void*}
+	 * @param len {size_t}
+	 * @param ref {gather_ref*}
+	 * @return {gather_buf&}
+	 */
+	gather_buf& add(const void* data, size_t len, gather_ref* ref);
+
+	/**
+	 * Copy the small data into the internal buffer.
+	 * @param data {const void*}
+	 * @param len {size_t}
+	 * @return {gather_buf&}
+	 */
+	gather_buf& copy(const void* data, size_t len);
+
+	/**
+	 * Copy the formatted string into the internal buffer.
+	 * @param fmt {const char*}
+	 * @return {gather_buf&}
+	 */
+	gather_buf& format(const char* fmt, ...) ACL_CPP_PRINTF(2, 3);
+	gather_buf& vformat(const char* fmt, va_list ap);
+
+	/**
+	 * Fill the slices left into the iovec array.
+	 * @param iov {struct iovec*}
+	 * @param max {int} the max number of iov
+	 * @return {int} the number of the iovec filled
+	 */
+	int peek(struct iovec* iov, int max) const;
+
+	/**
+	 * Mark the data written, the references of the slices sent are
+	 * released.
+	 * @param n {size_t} the length written
+	 */
+	void consume(size_t n);
+
+	/**
+	 * Drop all the slices and release the references.
+	 */
+	void clear(void);
+
+	/**
+	 * The length of the data left.
+	 * @return {size_t}
+	 */
+	size_t size(void) const
+	{
+		return size_;
+	}
+
+	/**
+	 * The number of the slices left.
+	 * @return {size_t}
+	 */
+	size_t count(void) const
+	{
+		return slices_.size() - pos_;
+	}
+
+	bool empty(void) const
+	{
+		return size_ == 0;
+	}
+
+private:
+	struct slice {
+		const char* ptr;	// NULL for the data copied
+		size_t off;		// the offset of the data copied in cbuf_
+		size_t len;
+		gather_ref* ref;
+	};
+
+	std::vector<slice> slices_;
+	string cbuf_;
+	size_t pos_;	// the first slice not sent
+	size_t off_;	// the length sent of the first slice
+	size_t size_;
+};
+
+} // namespace acl
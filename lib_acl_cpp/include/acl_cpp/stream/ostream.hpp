@@ -8,6 +8,7 @@ struct iovec;
 namespace acl {
 
 class string;
+class gather_buf;
 
 /**
  * ࣬ȷ֪ǷǷرգ
@@ -72,6 +73,19 @@ public:
 	 */
 	int writev(const struct iovec *v, int count, bool loop = true);
 
+	/**
+	 * Write the slices queued in gather way with writev, the data left in
+	 * the write buffer of the stream (see write() with buffed) is sent in
+	 * the same call before them. The slices sent are removed from buf, so
+	 * the ones left can be sent again after the partial write. When the
+	 * stream was hooked such as for SSL, the small slices are merged.
+	 * @param buf {gather_buf&}
+	 * @param loop {bool} if true, return after all the data has been
+	 *  written, else after written once
+	 * @return {int} the length written, -1 if error
+	 */
+	int sendv(gather_buf& buf, bool loop = true);
+
 	/**
 	 * ʽʽдݣ vfprintf֤ȫд
 	 * @param fmt {const char*} ʽַ
@@ -168,6 +182,13 @@ public:
 	 * @param n {size_t}
 	 */
 	static void set_wbuf_size(size_t n);
+
+	/**
+	 * Grow the write buffer of this stream used by write() with buffed,
+	 * which isn't shrunk.
+	 * @param n {size_t}
+	 */
+	void set_wbuf(size_t n);
 };
 
 } // namespace acl
@@ -11,6 +11,8 @@ struct ACL_VSTREAM;
 
 namespace acl {
 
+class fstream;
+
 class ACL_CPP_API socket_stream
 	: public istream
 	, public ostream
@@ -123,6 +125,26 @@ public:
 	 */
 	bool shutdown_readwrite(void);
 
+	/**
+	 * Send the data of the file to the peer. On Linux the data is sent by
+	 * sendfile, or by splice through a pipe if sendfile can't be used for
+	 * the file, so it isn't copied into the user space, and in fiber mode
+	 * both of them are hooked by lib_fiber which uses io_uring if enabled.
+	 * For the stream with a hook such as SSL, or on the other platforms,
+	 * the data is read into a buffer and written as usual.
+	 * @param in {fstream&} the file opened for reading
+	 * @param offset {acl_int64} the offset of the file to begin with
+	 * @param count {acl_int64} the length to be sent, -1 means sending
+	 *  to the end of the file
+	 * @return {acl_int64} the length sent, which may be less than count
+	 *  if the file was truncated, -1 if error
+	 */
+#if defined(_WIN32) || defined(_WIN64)
+	__int64 send_file(fstream& in, __int64 offset, __int64 count = -1);
+#else
+	long long send_file(fstream& in, long long offset, long long count = -1);
+#endif
+
 	/**
 	 * ׽Ӿ
 	 * @return {ACL_SOCKET} 򷵻 - 1(UNIX ƽ̨)
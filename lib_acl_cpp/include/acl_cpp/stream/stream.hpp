@@ -5,6 +5,7 @@
 #include <map>
 
 struct ACL_VSTREAM;
+struct iovec;
 
 namespace acl {
 
@@ -175,6 +176,8 @@ private:
 		int timeout, ACL_VSTREAM* stream, void *ctx);
 	static int send_hook(SOCKET fd, const void *buf, size_t len,
 		int timeout, ACL_VSTREAM* stream, void *ctx);
+	static int sendv_hook(SOCKET fd, const struct iovec *vec, int count,
+		int timeout, ACL_VSTREAM* stream, void *ctx);
 
 	static int fread_hook(HANDLE fd, void *buf, size_t len,
 		int timeout, ACL_VSTREAM* stream, void *ctx);
@@ -185,6 +188,8 @@ private:
 		int timeout, ACL_VSTREAM* stream, void *ctx);
 	static int send_hook(int fd, const void *buf, size_t len,
 		int timeout, ACL_VSTREAM* stream, void *ctx);
+	static int sendv_hook(int fd, const struct iovec *vec, int count,
+		int timeout, ACL_VSTREAM* stream, void *ctx);
 
 	static int fread_hook(int fd, void *buf, size_t len,
 		int timeout, ACL_VSTREAM* stream, void *ctx);
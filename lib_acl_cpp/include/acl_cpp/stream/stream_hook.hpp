@@ -2,6 +2,8 @@
 #include "../acl_cpp_define.hpp"
 #include "../stdlib/noncopyable.hpp"
 
+struct iovec;
+
 namespace acl {
 
 /**
@@ -31,6 +33,18 @@ public:
 	 */
 	virtual int send(const void* buf, size_t len) = 0;
 
+	/**
+	 * Send the data in gather way, the default one copies the small
+	 * vectors into one buffer and sends it with one send(), so that one
+	 * TLS record holds all of them, and the large vector is sent alone
+	 * without being copied.
+	 * @param vec {const struct iovec*}
+	 * @param count {int} the number of vec, must > 0
+	 * @return {int} the length written, which may be less than the total
+	 *  length of vec, < 0 if error
+	 */
+	virtual int sendv(const struct iovec* vec, int count);
+
 	/**
 	 *  stream/aio_stream  setup_hook ڲ stream_hook::open
 	 * ̣ԱʼһЩݼỰ
@@ -0,0 +1,142 @@
+#include "stdafx.h"
+#include <getopt.h>
+#include <sys/time.h>
+
+// The cost of compressing the responses of different sizes with each codec,
+// with the codecs reused from the per-thread pool or created for each
+// response, and the cost of getting the variants from compress_cache.
+
+static double stamp_sub(const struct timeval& from, const struct timeval& to)
+{
+	return (to.tv_sec - from.tv_sec) * 1000.0
+		+ (to.tv_usec - from.tv_usec) / 1000.0;
+}
+
+// the text like the json responses, which can be compressed
+static void make_body(size_t len, acl::string& out)
+{
+	out.clear();
+	for (int i = 0; out.size() < len; i++) {
+		out.format_append("{\"id\": %d, \"name\": \"user_%d\", "
+			"\"score\": %d, \"tags\": [\"t%d\", \"t%d\"]},\n",
+			i, rand() % 100000, rand() % 1000, rand() % 50,
+			rand() % 50);
+	}
+	out.truncate(len);
+}
+
+static void bench(const char* codec, const acl::string& body, int count,
+	bool pooled)
+{
+	acl::compress_codec::set_pool_max(pooled ? 64 : 0);
+
+	acl::string out;
+	struct timeval begin, end;
+	gettimeofday(&begin, NULL);
+
+	int i = 0;
+	for (; i < count; i++) {
+		acl::compress_codec* zip = acl::compress_codec::get(codec);
+		if (zip == NULL) {
+			break;
+		}
+		out.clear();
+		bool ok = zip->compress(body.c_str(), body.size(), &out);
+		acl::compress_codec::put(zip);
+		if (!ok) {
+			printf("compress error\r\n");
+			break;
+		}
+	}
+
+	gettimeofday(&end, NULL);
+	double spent = stamp_sub(begin, end);
+
+	printf("%-5s %-7s size=%-8d ratio=%5.2f%%  us/op=%9.2f  MB/s=%8.2f\r\n",
+		codec, pooled ? "pooled" : "new", (int) body.size(),
+		out.size() * 100.0 / body.size(), spent * 1000 / (i > 0 ? i : 1),
+		(double) body.size() * i / 1024 / 1024 * 1000
+		/ (spent > 0 ? spent : 1));
+}
+
+static void bench_cache(const char* codec, const acl::string& body, int count)
+{
+	acl::compress_cache cache;
+	struct timeval begin, end;
+	gettimeofday(&begin, NULL);
+
+	size_t len = 0;
+	for (int i = 0; i < count; i++) {
+		acl::compress_variant* variant = cache.get("body", codec,
+			body.c_str(), body.size());
+		if (variant == NULL) {
+			printf("%s not supported\r\n", codec);
+			return;
+		}
+		len = variant->get_data().size();
+		variant->release();
+	}
+
+	gettimeofday(&end, NULL);
+	double spent = stamp_sub(begin, end);
+
+	printf("%-5s %-7s size=%-8d ratio=%5.2f%%  us/op=%9.2f  hits=%lld\r\n",
+		codec, "cached", (int) body.size(), len * 100.0 / body.size(),
+		spent * 1000 / count, cache.hits());
+}
+
+static void usage(const char* procname)
+{
+	printf("usage: %s -h [help]\r\n"
+		" -c codecs[default: gzip,zstd,br]\r\n"
+		" -n loop_count[default: 1000]\r\n"
+		" -s sizes[default: 256,1024,4096,16384,65536,262144]\r\n",
+		procname);
+}
+
+int main(int argc, char* argv[])
+{
+	int  ch, count = 1000;
+	acl::string codecs("gzip,zstd,br");
+	acl::string sizes("256,1024,4096,16384,65536,262144");
+
+	while ((ch = getopt(argc, argv, "hc:n:s:")) > 0) {
+		switch (ch) {
+		case 'h':
+			usage(argv[0]);
+			return 0;
+		case 'c':
+			codecs = optarg;
+			break;
+		case 'n':
+			count = atoi(optarg);
+			break;
+		case 's':
+			sizes = optarg;
+			break;
+		default:
+			break;
+		}
+	}
+
+	acl::log::stdout_open(true);
+
+	std::vector<acl::string>& names = codecs.split2(",");
+	std::vector<acl::string>& lens = sizes.split2(",");
+	acl::string body;
+
+	for (size_t i = 0; i < names.size(); i++) {
+		if (!acl::compress_codec::supported(names[i])) {
+			printf("%s not supported\r\n", names[i].c_str());
+			continue;
+		}
+
+		for (size_t j = 0; j < lens.size(); j++) {
+			make_body((size_t) atoi(lens[j]), body);
+			bench(names[i], body, count, false);
+			bench(names[i], body, count, true);
+			bench_cache(names[i], body, count);
+		}
+	}
+	return 0;
+}
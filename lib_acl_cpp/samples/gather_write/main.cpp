@@ -0,0 +1,258 @@
+#include "stdafx.h"
+#include <getopt.h>
+#include <sys/time.h>
+
+// Send the messages each of which has a small header, a large body and a
+// small trailer, with three writes or with one gather write by sendv(),
+// over plain TCP or over SSL, the receiver checks all the data received.
+
+static size_t __len = 200000;
+static bool   __use_ssl = false;
+static acl::sslbase_conf* __server_conf = NULL;
+static acl::sslbase_conf* __client_conf = NULL;
+
+// The body shared by all the messages, freed after the last one sent.
+class shared_body : public acl::gather_ref
+{
+public:
+	shared_body(size_t len) : buf_(len)
+	{
+		for (size_t i = 0; i < len; i++) {
+			buf_[i] = 'a' + i % 26;
+		}
+	}
+
+	const char* data(void) const
+	{
+		return &buf_[0];
+	}
+
+protected:
+	~shared_body(void)
+	{
+		printf("shared body destroyed\r\n");
+	}
+
+private:
+	std::vector<char> buf_;
+};
+
+static unsigned long long checksum(unsigned long long sum,
+	const char* data, size_t len)
+{
+	for (size_t i = 0; i < len; i++) {
+		sum = sum * 31 + (unsigned char) data[i];
+	}
+	return sum;
+}
+
+static bool setup_ssl(acl::socket_stream& conn, acl::sslbase_conf* conf)
+{
+	acl::sslbase_io* ssl = conf->create(false);
+	if (conn.setup_hook(ssl) == ssl) {
+		printf("setup ssl error\r\n");
+		ssl->destroy();
+		return false;
+	}
+	return true;
+}
+
+class receiver : public acl::thread
+{
+public:
+	receiver(acl::server_socket& server)
+	: server_(server), total_(0), sum_(0) {}
+	~receiver(void) {}
+
+	long long total(void) const
+	{
+		return total_;
+	}
+
+	unsigned long long sum(void) const
+	{
+		return sum_;
+	}
+
+protected:
+	// @override
+	void* run(void)
+	{
+		acl::socket_stream* conn = server_.accept();
+		if (conn == NULL) {
+			printf("accept error\r\n");
+			return NULL;
+		}
+
+		if (__use_ssl && !setup_ssl(*conn, __server_conf)) {
+			delete conn;
+			return NULL;
+		}
+
+		char buf[65536];
+		int  ret;
+		while ((ret = conn->read(buf, sizeof(buf), false)) > 0) {
+			sum_ = checksum(sum_, buf, ret);
+			total_ += ret;
+		}
+
+		delete conn;
+		return NULL;
+	}
+
+private:
+	acl::server_socket& server_;
+	long long total_;
+	unsigned long long sum_;
+};
+
+static void usage(const char* procname)
+{
+	printf("usage: %s -h [help]\r\n"
+		" -n messages[default: 1000]\r\n"
+		" -l body_length[default: 200000]\r\n"
+		" -W [write the parts one by one instead of sendv]\r\n"
+		" -S [use SSL]\r\n"
+		" -L ssl_libs_path[default: /usr/local/lib64/libcrypto.so;"
+		"/usr/local/lib64/libssl.so]\r\n"
+		" -c ssl_crt[default: ./ssl_crt.pem]\r\n"
+		" -k ssl_key[default: ./ssl_key.pem]\r\n",
+		procname);
+}
+
+int main(int argc, char* argv[])
+{
+	int  ch, count = 1000;
+	bool use_write = false;
+	acl::string libs("/usr/local/lib64/libcrypto.so;/usr/local/lib64/libssl.so");
+	acl::string crt("./ssl_crt.pem"), key("./ssl_key.pem");
+
+	while ((ch = getopt(argc, argv, "hn:l:WSL:c:k:")) > 0) {
+		switch (ch) {
+		case 'h':
+			usage(argv[0]);
+			return 0;
+		case 'n':
+			count = atoi(optarg);
+			break;
+		case 'l':
+			__len = (size_t) atoi(optarg);
+			break;
+		case 'W':
+			use_write = true;
+			break;
+		case 'S':
+			__use_ssl = true;
+			break;
+		case 'L':
+			libs = optarg;
+			break;
+		case 'c':
+			crt = optarg;
+			break;
+		case 'k':
+			key = optarg;
+			break;
+		default:
+			break;
+		}
+	}
+
+	if (__len < 1000) {
+		__len = 1000;
+	}
+
+	acl::log::stdout_open(true);
+
+	if (__use_ssl) {
+		std::vector<acl::string>& tokens = libs.split2(";, \t");
+		if (tokens.size() < 2) {
+			printf("invalid ssl libs: %s\r\n", libs.c_str());
+			return 1;
+		}
+
+		acl::openssl_conf::set_libpath(tokens[0], tokens[1]);
+		if (!acl::openssl_conf::load()) {
+			printf("load %s error\r\n", libs.c_str());
+			return 1;
+		}
+
+		__server_conf = new acl::openssl_conf(true);
+		__client_conf = new acl::openssl_conf(false);
+		if (!__server_conf->add_cert(crt, key)) {
+			printf("add cert %s error\r\n", crt.c_str());
+			return 1;
+		}
+	}
+
+	acl::server_socket server;
+	if (!server.open("127.0.0.1:0")) {
+		printf("listen error %s\r\n", acl::last_serror());
+		return 1;
+	}
+
+	receiver thr(server);
+	thr.set_detachable(false);
+	thr.start();
+
+	acl::socket_stream conn;
+	if (!conn.open(server.get_addr(), 10, 10)) {
+		printf("connect %s error\r\n", server.get_addr());
+		return 1;
+	}
+
+	if (__use_ssl && !setup_ssl(conn, __client_conf)) {
+		return 1;
+	}
+
+	shared_body* body = new shared_body(__len);
+	acl::gather_buf buf;
+	acl::string hdr;
+	unsigned long long sum = 0;
+	long long total = 0;
+	bool ok = true;
+
+	struct timeval begin, end;
+	gettimeofday(&begin, NULL);
+
+	for (int i = 0; i < count && ok; i++) {
+		size_t len = __len - i % 1000;
+		hdr.format("MSG %d %d\r\n", i, (int) len);
+
+		if (use_write) {
+			ok = conn.write(hdr) != -1
+				&& conn.write(body->data(), len) != -1
+				&& conn.write("\r\n", 2) != -1;
+		} else {
+			buf.copy(hdr.c_str(), hdr.size());
+			buf.add(body->data(), len, body);
+			buf.copy("\r\n", 2);
+			ok = conn.sendv(buf) != -1;
+		}
+
+		sum = checksum(sum, hdr.c_str(), hdr.size());
+		sum = checksum(sum, body->data(), len);
+		sum = checksum(sum, "\r\n", 2);
+		total += hdr.size() + len + 2;
+	}
+
+	gettimeofday(&end, NULL);
+	body->release();
+
+	// close after all received, or the data not read by the client,
+	// such as the SSL session ticket, may cause RST
+	conn.shutdown_write();
+	thr.wait();
+	conn.close();
+
+	double spent = (end.tv_sec - begin.tv_sec) * 1000.0
+		+ (end.tv_usec - begin.tv_usec) / 1000.0;
+	ok = ok && thr.total() == total && thr.sum() == sum;
+	printf("%s %s: %s, sent=%lld, received=%lld, spent=%.2f ms\r\n",
+		__use_ssl ? "ssl" : "tcp", use_write ? "write" : "sendv",
+		ok ? "ok" : "error", total, thr.total(), spent);
+
+	delete __server_conf;
+	delete __client_conf;
+	return ok ? 0 : 1;
+}
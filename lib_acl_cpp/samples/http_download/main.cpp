@@ -0,0 +1,313 @@
+#include "stdafx.h"
+#include <getopt.h>
+#include <sys/time.h>
+
+// Compare downloading one file over one connection with get() and in the
+// segments fetched concurrently with get_segments(), the segments write
+// the data at their offsets of the local file and each of them retries
+// from the offset it has written to after an error.
+//
+// With -L, the file is served by the local stand-in server in the threads
+// of the process, which supports Range, or not with -N, and cuts off the
+// first responses in the middle with -D, and the file downloaded is
+// compared with the data served.
+
+static double stamp_sub(const struct timeval& from, const struct timeval& to)
+{
+	return (to.tv_sec - from.tv_sec) * 1000.0
+		+ (to.tv_usec - from.tv_usec) / 1000.0;
+}
+
+// the data served by the stand-in, which isn't repeated in short cycles
+static acl::string __data;
+static bool __no_range = false;
+static acl::atomic_long __drops;	// the responses to be cut off
+static acl::atomic_long __requests;
+static acl::atomic_long __ranges;
+static acl::atomic_long __dropped;
+
+static void data_init(size_t size)
+{
+	unsigned int seed = 1;
+	__data.space(size + 1);
+	for (size_t i = 0; i < size; i++) {
+		seed = seed * 1103515245 + 12345;
+		char ch = (char) (seed >> 16);
+		__data.append(&ch, 1);
+	}
+}
+
+class stand_in_servlet : public acl::HttpServlet
+{
+public:
+	stand_in_servlet(acl::socket_stream* conn) : HttpServlet(conn) {}
+	~stand_in_servlet(void) {}
+
+protected:
+	// @override
+	bool doGet(acl::HttpServletRequest& req, acl::HttpServletResponse& res)
+	{
+		++__requests;
+
+		long long size = (long long) __data.size();
+		long long from = 0, to = size - 1;
+		bool range = req.getRange(from, to);
+
+		// the probe of get_segments() is never cut off
+		bool probe = range && from == 0 && to == 0;
+
+		if (!range || __no_range) {
+			range = false;
+			from  = 0;
+			to    = size - 1;
+		} else if (range) {
+			if (to >= size) {
+				to = size - 1;
+			}
+			if (from > to) {
+				res.setStatus(416).setContentLength(0);
+				return res.write(NULL, 0);
+			}
+			++__ranges;
+		}
+
+		long long len = to - from + 1;
+		res.setKeepAlive(true).setContentLength(len)
+			.setContentType("application/octet-stream");
+		if (range) {
+			res.setStatus(206).setRange(from, to, size);
+		}
+
+		long long limit = len;
+		if (!probe && --__drops >= 0) {
+			limit = len / 2;
+		}
+
+		const char* ptr = __data.c_str() + from;
+		for (long long n = 0; n < limit; ) {
+			long long i = limit - n > 8192 ? 8192 : limit - n;
+			if (!res.write(ptr + n, (size_t) i)) {
+				return false;
+			}
+			n += i;
+		}
+
+		if (limit < len) {
+			++__dropped;
+			return false;	// close the connection
+		}
+		return true;
+	}
+};
+
+class stand_in_conn : public acl::thread
+{
+public:
+	stand_in_conn(acl::socket_stream* conn) : conn_(conn) {}
+
+protected:
+	// @override
+	void* run(void)
+	{
+		stand_in_servlet servlet(conn_);
+		servlet.setRwTimeout(10);
+		while (servlet.doRun()) {}
+		delete conn_;
+		delete this;
+		return NULL;
+	}
+
+private:
+	acl::socket_stream* conn_;
+
+	~stand_in_conn(void) {}
+};
+
+class stand_in_server : public acl::thread
+{
+public:
+	stand_in_server(acl::server_socket& ss) : ss_(ss) {}
+	~stand_in_server(void) {}
+
+protected:
+	// @override
+	void* run(void)
+	{
+		while (true) {
+			acl::socket_stream* conn = ss_.accept();
+			if (conn == NULL) {
+				break;
+			}
+			stand_in_conn* thr = new stand_in_conn(conn);
+			thr->set_detachable(true);
+			thr->start();
+		}
+		return NULL;
+	}
+
+private:
+	acl::server_socket& ss_;
+};
+
+// compare the file downloaded with the data of the stand-in
+static bool check_file(const char* filepath)
+{
+	acl::string buf;
+	if (acl::ifstream::load(filepath, buf) == false) {
+		printf("load %s error %s\r\n", filepath, acl::last_serror());
+		return false;
+	}
+	if (buf.size() != __data.size()) {
+		printf("size %d != %d\r\n", (int) buf.size(),
+			(int) __data.size());
+		return false;
+	}
+	if (memcmp(buf.c_str(), __data.c_str(), buf.size()) != 0) {
+		printf("the content is different\r\n");
+		return false;
+	}
+	return true;
+}
+
+class file_download : public acl::http_download
+{
+public:
+	file_download(const char* url, const char* addr, acl::fstream& fp)
+	: http_download(url, addr), fp_(fp) {}
+	~file_download(void) {}
+
+protected:
+	// @override
+	bool on_save(const void* data, size_t len)
+	{
+		return fp_.write(data, len) == (int) len;
+	}
+
+private:
+	acl::fstream& fp_;
+};
+
+static void usage(const char* procname)
+{
+	printf("usage: %s -h [help]\r\n"
+		" -u url[default: http://127.0.0.1:8080/test.dat]\r\n"
+		" -s server_addr[default: got from url]\r\n"
+		" -o local_file[default: ./test.dat]\r\n"
+		" -n segments[default: 4]\r\n"
+		" -m min_segment_size_in_KB[default: 1024]\r\n"
+		" -r max_retry_per_segment[default: 3]\r\n"
+		" -S [download over one connection with get()]\r\n"
+		" -L [download from the local stand-in server]\r\n"
+		" -z stand_in_file_size_in_KB[default: 8192]\r\n"
+		" -D stand_in_responses_cut_off[default: 0]\r\n"
+		" -N [the stand-in doesn't support Range]\r\n",
+		procname);
+}
+
+int main(int argc, char* argv[])
+{
+	int  ch, nsegs = 4, min_seg = 1024, max_retry = 3, size = 8192;
+	bool single = false, local = false;
+	acl::string url("http://127.0.0.1:8080/test.dat"), addr;
+	acl::string filepath("./test.dat");
+
+	while ((ch = getopt(argc, argv, "hu:s:o:n:m:r:SLz:D:N")) > 0) {
+		switch (ch) {
+		case 'h':
+			usage(argv[0]);
+			return 0;
+		case 'u':
+			url = optarg;
+			break;
+		case 's':
+			addr = optarg;
+			break;
+		case 'o':
+			filepath = optarg;
+			break;
+		case 'n':
+			nsegs = atoi(optarg);
+			break;
+		case 'm':
+			min_seg = atoi(optarg);
+			break;
+		case 'r':
+			max_retry = atoi(optarg);
+			break;
+		case 'S':
+			single = true;
+			break;
+		case 'L':
+			local = true;
+			break;
+		case 'z':
+			size = atoi(optarg);
+			break;
+		case 'D':
+			__drops = atoi(optarg);
+			break;
+		case 'N':
+			__no_range = true;
+			break;
+		default:
+			break;
+		}
+	}
+
+	acl::acl_cpp_init();
+	acl::log::stdout_open(true);
+
+	acl::server_socket ss;
+	if (local) {
+		if (!ss.open("127.0.0.1:0")) {
+			printf("listen error %s\r\n", acl::last_serror());
+			return 1;
+		}
+
+		data_init((size_t) (size > 0 ? size : 1) * 1024);
+		url.format("http://%s/test.dat", ss.get_addr());
+		addr.clear();
+
+		stand_in_server* server = new stand_in_server(ss);
+		server->set_detachable(true);
+		server->start();
+	}
+
+	acl::fstream fp;
+	if (single && !fp.open_trunc(filepath)) {
+		printf("open %s error %s\r\n", filepath.c_str(),
+			acl::last_serror());
+		return 1;
+	}
+
+	file_download dl(url, addr.empty() ? NULL : addr.c_str(), fp);
+	if (dl.get_addr() == NULL) {
+		printf("invalid url: %s\r\n", url.c_str());
+		return 1;
+	}
+
+	struct timeval begin, end;
+	gettimeofday(&begin, NULL);
+
+	bool ok = single ? dl.get() : dl.get_segments(filepath, nsegs,
+			(long long) min_seg * 1024, max_retry);
+
+	gettimeofday(&end, NULL);
+	fp.close();
+
+	long long fsize = acl::fstream::fsize(filepath);
+	double spent = stamp_sub(begin, end);
+	printf("%s: %s, size=%lld, spent=%.2f ms, MB/s=%.2f\r\n",
+		ok ? "ok" : "error", single ? "single" : "segments", fsize,
+		spent, fsize / 1024.0 / 1024.0 * 1000 / (spent > 0 ? spent : 1));
+
+	if (local) {
+		bool same = check_file(filepath);
+		printf("stand-in: requests=%lld, ranges=%lld, dropped=%lld, "
+			"content %s\r\n", (long long) __requests,
+			(long long) __ranges, (long long) __dropped,
+			same ? "ok" : "error");
+		ok = ok && same;
+	}
+	return ok ? 0 : 1;
+}
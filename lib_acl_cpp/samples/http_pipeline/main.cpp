@@ -0,0 +1,202 @@
+#include "stdafx.h"
+#include <getopt.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include <sys/uio.h>
+#include <dlfcn.h>
+
+// The client sends the pipelined requests in groups, each group by one write,
+// and reads the responses in order, checking the sequence in each of them;
+// the server thread replies them with HttpServlet, with or without
+// setPipelineBatch(), and the writes called by the server are counted.
+
+typedef ssize_t (*write_fn)(int, const void*, size_t);
+typedef ssize_t (*writev_fn)(int, const struct iovec*, int);
+
+static __thread bool __counting = false;
+static acl::atomic_long __writes;
+
+extern "C" ssize_t write(int fd, const void* buf, size_t n)
+{
+	static write_fn __sys_write = NULL;
+	if (__sys_write == NULL) {
+		__sys_write = (write_fn) dlsym(RTLD_NEXT, "write");
+	}
+	if (__counting) {
+		++__writes;
+	}
+	return __sys_write(fd, buf, n);
+}
+
+extern "C" ssize_t writev(int fd, const struct iovec* iov, int count)
+{
+	static writev_fn __sys_writev = NULL;
+	if (__sys_writev == NULL) {
+		__sys_writev = (writev_fn) dlsym(RTLD_NEXT, "writev");
+	}
+	if (__counting) {
+		++__writes;
+	}
+	return __sys_writev(fd, iov, count);
+}
+
+static double stamp_sub(const struct timeval& from, const struct timeval& to)
+{
+	return (to.tv_sec - from.tv_sec) * 1000.0
+		+ (to.tv_usec - from.tv_usec) / 1000.0;
+}
+
+class plaintext_servlet : public acl::HttpServlet
+{
+public:
+	plaintext_servlet(acl::socket_stream* conn) : HttpServlet(conn) {}
+	~plaintext_servlet(void) {}
+
+protected:
+	// @override
+	bool doGet(acl::HttpServletRequest& req, acl::HttpServletResponse& res)
+	{
+		acl::string buf;
+		buf.format("Hello, World! %s", req.getParameter("seq"));
+		res.setContentType("text/plain").setKeepAlive(true)
+			.setContentLength(buf.size());
+		return res.write(buf);
+	}
+};
+
+class server_thread : public acl::thread
+{
+public:
+	server_thread(acl::server_socket& ss, bool batch)
+	: ss_(ss), batch_(batch) {}
+	~server_thread(void) {}
+
+protected:
+	// @override
+	void* run(void)
+	{
+		acl::socket_stream* conn = ss_.accept();
+		if (conn == NULL) {
+			printf("accept error\r\n");
+			return NULL;
+		}
+
+		__counting = true;
+		plaintext_servlet servlet(conn);
+		servlet.setFastParser(true).setPipelineBatch(batch_);
+		servlet.setRwTimeout(10);
+		while (servlet.doRun()) {}
+		__counting = false;
+
+		delete conn;
+		return NULL;
+	}
+
+private:
+	acl::server_socket& ss_;
+	bool batch_;
+};
+
+static bool run(const char* addr, int count, int depth)
+{
+	acl::socket_stream conn;
+	if (!conn.open(addr, 10, 10)) {
+		printf("connect %s error\r\n", addr);
+		return false;
+	}
+
+	acl::http_client client(&conn, true);
+	acl::string reqs, body, expect;
+
+	for (int i = 0; i < count; i += depth) {
+		int n = count - i < depth ? count - i : depth;
+		reqs.clear();
+		for (int j = 0; j < n; j++) {
+			reqs.format_append("GET /plaintext?seq=%d HTTP/1.1\r\n"
+				"Host: 127.0.0.1\r\n\r\n", i + j);
+		}
+		if (conn.write(reqs) == -1) {
+			printf("write error\r\n");
+			return false;
+		}
+
+		for (int j = 0; j < n; j++) {
+			body.clear();
+			if (!client.read_head() || client.read_body(body) < 0) {
+				printf("read response error\r\n");
+				return false;
+			}
+			expect.format("Hello, World! %d", i + j);
+			if (body != expect) {
+				printf("out of order: %s, expect: %s\r\n",
+					body.c_str(), expect.c_str());
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+static void usage(const char* procname)
+{
+	printf("usage: %s -h [help]\r\n"
+		" -n requests[default: 100000]\r\n"
+		" -d pipeline_depth[default: 16]\r\n"
+		" -B [use setPipelineBatch]\r\n", procname);
+}
+
+int main(int argc, char* argv[])
+{
+	int  ch, count = 100000, depth = 16;
+	bool batch = false;
+
+	while ((ch = getopt(argc, argv, "hn:d:B")) > 0) {
+		switch (ch) {
+		case 'h':
+			usage(argv[0]);
+			return 0;
+		case 'n':
+			count = atoi(optarg);
+			break;
+		case 'd':
+			depth = atoi(optarg);
+			break;
+		case 'B':
+			batch = true;
+			break;
+		default:
+			break;
+		}
+	}
+
+	if (depth <= 0) {
+		depth = 1;
+	}
+
+	acl::log::stdout_open(true);
+
+	acl::server_socket ss;
+	if (!ss.open("127.0.0.1:0")) {
+		printf("listen error\r\n");
+		return 1;
+	}
+
+	server_thread server(ss, batch);
+	server.set_detachable(false);
+	server.start();
+
+	struct timeval begin, end;
+	gettimeofday(&begin, NULL);
+
+	bool ok = run(ss.get_addr(), count, depth);
+
+	gettimeofday(&end, NULL);
+	server.wait();
+
+	double spent = stamp_sub(begin, end);
+	printf("%s: requests=%d, depth=%d, %s, server writes=%lld, "
+		"spent=%.2f ms, qps=%.2f\r\n", batch ? "batched" : "unbatched",
+		count, depth, ok ? "ok" : "error", __writes.value(), spent,
+		count * 1000 / (spent > 0 ? spent : 1));
+	return ok ? 0 : 1;
+}
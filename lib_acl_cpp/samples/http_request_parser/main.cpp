@@ -0,0 +1,383 @@
+#include "stdafx.h"
+#include <getopt.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include <sys/socket.h>
+
+// The request headers are parsed by http_request_parser and compared with the
+// ones parsed by http_client, then the keep-alive requests are written into
+// one end of the socket pair and read from the other one, by http_client or
+// the parser, and by HttpServlet with or without the parser, counting the
+// mallocs and the time spent of each request.
+
+extern "C" void* __libc_malloc(size_t);
+extern "C" void* __libc_calloc(size_t, size_t);
+extern "C" void* __libc_realloc(void*, size_t);
+
+static __thread long long __mallocs = 0;
+
+extern "C" void* malloc(size_t n)
+{
+	__mallocs++;
+	return __libc_malloc(n);
+}
+
+extern "C" void* calloc(size_t n, size_t size)
+{
+	__mallocs++;
+	return __libc_calloc(n, size);
+}
+
+extern "C" void* realloc(void* ptr, size_t n)
+{
+	__mallocs++;
+	return __libc_realloc(ptr, n);
+}
+
+static double stamp_sub(const struct timeval& from, const struct timeval& to)
+{
+	return (to.tv_sec - from.tv_sec) * 1000.0
+		+ (to.tv_usec - from.tv_usec) / 1000.0;
+}
+
+static const char* __requests[] = {
+	"GET /index.html HTTP/1.1\r\n"
+	"Host: www.test.com\r\n"
+	"\r\n",
+
+	"GET /a//b/./c/../d/?name=%E4%BD%A0%E5%A5%BD&age=20&empty=&x"
+	" HTTP/1.1\r\n"
+	"Host: www.test.com:8080\r\n"
+	"Connection: close\r\n"
+	"Cookie: sid=abcdef; user = zsx ;empty=\r\n"
+	"User-Agent: acl\r\n"
+	"\r\n",
+
+	"GET http://www.test.com:81/proxy/path?q=1 HTTP/1.0\r\n"
+	"Proxy-Connection: keep-alive\r\n"
+	"\r\n",
+
+	"POST /upload HTTP/1.1\r\n"
+	"Host: localhost\r\n"
+	"Content-Type: application/json\r\n"
+	"Content-Length: 1024\r\n"
+	"X-Folded: first\r\n"
+	"  second\r\n"
+	"\r\n",
+
+	"GET / HTTP/1.0\r\n"
+	"Range: bytes=100-\r\n"
+	"\r\n",
+
+	NULL,
+};
+
+#define STR(x) ((x) ? (x) : "(null)")
+
+static bool check(acl::socket_stream& in, int out, const char* data)
+{
+	acl::http_request_parser parser;
+	if (!parser.parse(data, strlen(data))) {
+		printf("parse error: %s\r\n", data);
+		return false;
+	}
+
+	// the same request parsed by http_client
+	size_t len = strlen(data);
+	if (write(out, data, len) != (ssize_t) len) {
+		printf("write error\r\n");
+		return false;
+	}
+	acl::http_client client(&in, false, true);
+
+	bool ok = client.read_head();
+	if (ok) {
+		unsigned major, minor, rmajor, rminor;
+		parser.get_version(major, minor);
+		client.get_version(rmajor, rminor);
+		const char* path = STR(client.request_path());
+		const char* query = STR(client.request_params());
+		const char* url = STR(client.request_url());
+		const char* host = STR(client.request_host());
+		long long from, to;
+		long long rfrom, rto;
+		bool range = parser.get_range(from, to);
+		bool rrange = client.request_range(rfrom, rto);
+
+		ok = strcmp(parser.get_method(), client.request_method()) == 0
+			&& strcmp(parser.get_url(), url) == 0
+			&& strcmp(parser.get_path(), path) == 0
+			&& strcmp(parser.get_query(), query) == 0
+			&& strcmp(parser.get_host(), host) == 0
+			&& parser.get_port() == client.request_port()
+			&& major == rmajor && minor == rminor
+			&& parser.get_content_length() == client.body_length()
+			&& parser.keep_alive() == client.keep_alive()
+			&& range == rrange
+			&& (!range || (from == rfrom && to == rto));
+
+		printf("%s %s, path=%s, query=%s, host=%s, port=%d, "
+			"keep_alive=%s, length=%lld: %s\r\n",
+			parser.get_method(), parser.get_url(),
+			parser.get_path(), parser.get_query(),
+			parser.get_host(), parser.get_port(),
+			parser.keep_alive() ? "yes" : "no",
+			parser.get_content_length(), ok ? "ok" : "error");
+		if (!ok) {
+			printf("http_client: %s %s, path=%s, query=%s, host=%s,"
+				" port=%d, keep_alive=%s\r\n",
+				client.request_method(), url, path, query, host,
+				client.request_port(),
+				client.keep_alive() ? "yes" : "no");
+		}
+	}
+
+	const std::vector<acl::http_request_parser::field>& params =
+		parser.get_params();
+	for (size_t i = 0; i < params.size(); i++) {
+		printf("  param %s=%s\r\n", params[i].name, params[i].value);
+	}
+	const std::vector<acl::http_request_parser::field>& cookies =
+		parser.get_cookies();
+	for (size_t i = 0; i < cookies.size(); i++) {
+		printf("  cookie %s=%s\r\n", cookies[i].name,
+			cookies[i].value);
+	}
+	const char* folded = parser.header_value("X-Folded");
+	if (folded) {
+		printf("  folded: %s\r\n", folded);
+	}
+
+	return ok;
+}
+
+// the chunked body with the extension and the trailer, and the body of
+// Content-Length, each followed by the next request in the same stream
+static const char* __bodies[] = {
+	"POST /chunked HTTP/1.1\r\n"
+	"Host: localhost\r\n"
+	"Transfer-Encoding: chunked\r\n"
+	"\r\n"
+	"5\r\nhello\r\n"
+	"7;ext=1\r\n, world\r\n"
+	"0\r\n"
+	"X-Trailer: 1\r\n"
+	"\r\n"
+	"GET /next HTTP/1.1\r\n"
+	"\r\n",
+
+	"POST /length HTTP/1.1\r\n"
+	"Host: localhost\r\n"
+	"Content-Length: 12\r\n"
+	"\r\n"
+	"hello, world"
+	"GET /next HTTP/1.1\r\n"
+	"\r\n",
+
+	NULL,
+};
+
+static bool check_body(acl::socket_stream& in, int out, const char* data)
+{
+	size_t len = strlen(data);
+	if (write(out, data, len) != (ssize_t) len) {
+		printf("write error\r\n");
+		return false;
+	}
+
+	acl::http_request_parser parser;
+	if (!parser.read(in)) {
+		printf("read header error\r\n");
+		return false;
+	}
+
+	// read it in the small pieces across the chunks
+	acl::string body;
+	char buf[4];
+	int ret;
+	while ((ret = parser.read_body(in, buf, sizeof(buf))) > 0) {
+		body.append(buf, ret);
+	}
+
+	bool chunked = parser.is_chunked();
+	bool ok = ret == 0 && body == "hello, world" && parser.read(in)
+		&& strcmp(parser.get_path(), "/next") == 0;
+	printf("body of %s: %s, %s\r\n", chunked ? "chunked" : "length",
+		body.c_str(), ok ? "ok" : "error");
+	return ok;
+}
+
+static const char* __request =
+	"GET /api/users/profile?id=1234&name=acl&lang=zh HTTP/1.1\r\n"
+	"Host: 127.0.0.1:8088\r\n"
+	"Connection: keep-alive\r\n"
+	"User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36\r\n"
+	"Accept: text/html,application/xhtml+xml,application/xml;q=0.9\r\n"
+	"Accept-Encoding: gzip, deflate\r\n"
+	"Accept-Language: zh-CN,zh;q=0.9,en;q=0.8\r\n"
+	"Cookie: sid=0123456789abcdef; theme=dark\r\n"
+	"\r\n";
+
+// the fields accessed by the usual handler
+static bool handle(const char* method, const char* path, const char* name,
+	const char* sid)
+{
+	return method && path && name && sid && strcmp(name, "acl") == 0;
+}
+
+static void bench_read(acl::socket_stream& in, int out, int count,
+	bool use_parser)
+{
+	acl::http_request_parser parser;
+	size_t len = strlen(__request);
+
+	struct timeval begin, end;
+	gettimeofday(&begin, NULL);
+	long long mallocs = __mallocs;
+
+	int i;
+	for (i = 0; i < count; i++) {
+		if (write(out, __request, len) != (ssize_t) len) {
+			printf("write error\r\n");
+			break;
+		}
+
+		bool ok;
+		if (use_parser) {
+			ok = parser.read(in) && handle(parser.get_method(),
+				parser.get_path(), parser.get_param("name"),
+				parser.get_cookie("sid"));
+		} else {
+			acl::http_client client(&in, false, true);
+			ok = client.read_head() && handle(
+				client.request_method(), client.request_path(),
+				client.request_param("name"),
+				client.request_cookie("sid"));
+		}
+		if (!ok) {
+			printf("read error\r\n");
+			break;
+		}
+	}
+
+	gettimeofday(&end, NULL);
+	double spent = stamp_sub(begin, end);
+	printf("%s: requests=%d, mallocs=%.2f/request, spent=%.2f ms, "
+		"%.2f ns/request\r\n", use_parser ? "parser" : "http_client",
+		i, (double) (__mallocs - mallocs) / (i > 0 ? i : 1), spent,
+		spent * 1000000 / (i > 0 ? i : 1));
+}
+
+class bench_servlet : public acl::HttpServlet
+{
+public:
+	bench_servlet(acl::socket_stream* conn) : HttpServlet(conn) {}
+	~bench_servlet(void) {}
+
+protected:
+	// @override
+	bool doGet(acl::HttpServletRequest& req, acl::HttpServletResponse& res)
+	{
+		if (!handle(req.getRequestUri(), req.getPathInfo(),
+			req.getParameter("name"), req.getCookieValue("sid"))) {
+			return false;
+		}
+
+		res.setKeepAlive(true).setContentLength(2);
+		return res.write("ok", 2);
+	}
+};
+
+static void bench_servlet_run(acl::socket_stream& in, int out, int count,
+	bool use_parser)
+{
+	bench_servlet servlet(&in);
+	servlet.setFastParser(use_parser);
+
+	size_t len = strlen(__request);
+	char buf[4096];
+
+	struct timeval begin, end;
+	gettimeofday(&begin, NULL);
+	long long mallocs = __mallocs;
+
+	int i;
+	for (i = 0; i < count; i++) {
+		if (write(out, __request, len) != (ssize_t) len) {
+			printf("write error\r\n");
+			break;
+		}
+		if (!servlet.doRun()) {
+			printf("doRun error\r\n");
+			break;
+		}
+		if (read(out, buf, sizeof(buf)) <= 0) {
+			printf("read response error\r\n");
+			break;
+		}
+	}
+
+	gettimeofday(&end, NULL);
+	double spent = stamp_sub(begin, end);
+	printf("HttpServlet %s: requests=%d, mallocs=%.2f/request, "
+		"spent=%.2f ms, %.2f ns/request\r\n", use_parser ?
+		"with parser" : "with http_client", i,
+		(double) (__mallocs - mallocs) / (i > 0 ? i : 1), spent,
+		spent * 1000000 / (i > 0 ? i : 1));
+}
+
+static void usage(const char* procname)
+{
+	printf("usage: %s -h [help]\r\n"
+		" -n requests[default: 100000]\r\n", procname);
+}
+
+int main(int argc, char* argv[])
+{
+	int ch, count = 100000;
+
+	while ((ch = getopt(argc, argv, "hn:")) > 0) {
+		switch (ch) {
+		case 'h':
+			usage(argv[0]);
+			return 0;
+		case 'n':
+			count = atoi(optarg);
+			break;
+		default:
+			break;
+		}
+	}
+
+	acl::log::stdout_open(true);
+
+	int fds[2];
+	if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0) {
+		printf("socketpair error %s\r\n", acl::last_serror());
+		return 1;
+	}
+
+	acl::socket_stream in;
+	in.open(fds[0]);
+
+	int errors = 0;
+	for (int i = 0; __requests[i]; i++) {
+		if (!check(in, fds[1], __requests[i])) {
+			errors++;
+		}
+	}
+	for (int i = 0; __bodies[i]; i++) {
+		if (!check_body(in, fds[1], __bodies[i])) {
+			errors++;
+		}
+	}
+	printf("check: %s\r\n", errors == 0 ? "all ok" : "error");
+
+	bench_read(in, fds[1], count, false);
+	bench_read(in, fds[1], count, true);
+	bench_servlet_run(in, fds[1], count, false);
+	bench_servlet_run(in, fds[1], count, true);
+
+	close(fds[1]);
+	return 0;
+}
@@ -0,0 +1,320 @@
+#include "stdafx.h"
+#include <getopt.h>
+#include <unistd.h>
+#include <sys/time.h>
+
+// The HTTP server threads reply the JSON built slowly for the same URL, with
+// or without http_response_cache, and the client threads request it in the
+// keep-alive connections; the number of the JSON built shows only one
+// request regenerates the expired response, and If-None-Match and
+// Accept-Encoding are checked, too.
+
+static acl::http_response_cache* __cache = NULL;
+static acl::atomic_long __generated;
+static int __items = 100;
+static int __cost = 1;
+
+static double stamp_sub(const struct timeval& from, const struct timeval& to)
+{
+	return (to.tv_sec - from.tv_sec) * 1000.0
+		+ (to.tv_usec - from.tv_usec) / 1000.0;
+}
+
+class json_servlet : public acl::HttpServlet
+	, public acl::http_response_generator
+{
+public:
+	json_servlet(acl::socket_stream* conn) : HttpServlet(conn) {}
+	~json_servlet(void) {}
+
+	// @override
+	bool generate(acl::HttpServletRequest& req, acl::string& body,
+		acl::string& content_type)
+	{
+		++__generated;
+		if (__cost > 0) {
+			usleep(__cost * 1000);
+		}
+
+		acl::json json;
+		acl::json_node& root = json.get_root();
+		acl::json_node& items = json.create_array();
+		root.add_text("url", req.getRequestUri()).add_child("items", items);
+		for (int i = 0; i < __items; i++) {
+			acl::json_node& item = json.create_node();
+			item.add_number("id", i).add_text("name", "acl http server");
+			items.add_child(item);
+		}
+
+		json.build_json(body);
+		content_type = "application/json; charset=utf-8";
+		return true;
+	}
+
+protected:
+	// @override
+	bool doGet(acl::HttpServletRequest& req, acl::HttpServletResponse& res)
+	{
+		res.setKeepAlive(true);
+		if (__cache) {
+			return __cache->serve(req, res, *this);
+		}
+
+		acl::string body, type;
+		generate(req, body, type);
+		res.setContentType(type).setContentLength(body.size());
+		return res.write(body);
+	}
+
+	// @override
+	bool doHead(acl::HttpServletRequest& req, acl::HttpServletResponse& res)
+	{
+		return doGet(req, res);
+	}
+
+	// @override
+	bool doPost(acl::HttpServletRequest& req, acl::HttpServletResponse& res)
+	{
+		return doGet(req, res);
+	}
+};
+
+class server_thread : public acl::thread
+{
+public:
+	server_thread(acl::server_socket& ss) : ss_(ss) {}
+	~server_thread(void) {}
+
+protected:
+	// @override
+	void* run(void)
+	{
+		acl::socket_stream* conn = ss_.accept();
+		if (conn == NULL) {
+			printf("accept error\r\n");
+			return NULL;
+		}
+
+		json_servlet servlet(conn);
+		servlet.setRwTimeout(10);
+		while (servlet.doRun()) {}
+		delete conn;
+		return NULL;
+	}
+
+private:
+	acl::server_socket& ss_;
+};
+
+static int get(acl::http_request& req, acl::string& body,
+	const char* etag = NULL, const char* accept = NULL)
+{
+	acl::http_header& hdr = req.request_header();
+	hdr.reset();
+	hdr.set_url("/items").set_keep_alive(true);
+	if (etag) {
+		hdr.add_entry("If-None-Match", etag);
+	}
+	if (accept) {
+		hdr.add_entry("Accept-Encoding", accept);
+	}
+
+	body.clear();
+	if (!req.request(NULL, 0) || !req.get_body(body)) {
+		return -1;
+	}
+	return req.http_status();
+}
+
+// the POST isn't cached, so it's replied without Cache-Control and ETag,
+// and If-None-Match is ignored
+static int post(acl::http_request& req, acl::string& body, const char* etag)
+{
+	acl::http_header& hdr = req.request_header();
+	hdr.reset();
+	hdr.set_url("/items").set_keep_alive(true)
+		.set_method(acl::HTTP_METHOD_POST);
+	hdr.add_entry("If-None-Match", etag);
+
+	body.clear();
+	if (!req.request(NULL, 0) || !req.get_body(body)) {
+		return -1;
+	}
+	return req.http_status();
+}
+
+class client_thread : public acl::thread
+{
+public:
+	client_thread(const char* addr, int count)
+	: addr_(addr), count_(count), ok_(0) {}
+	~client_thread(void) {}
+
+	int get_ok(void) const {
+		return ok_;
+	}
+
+protected:
+	// @override
+	void* run(void)
+	{
+		acl::http_request req(addr_);
+		acl::string body;
+		for (int i = 0; i < count_; i++) {
+			if (get(req, body) != 200 || body.empty()) {
+				printf("get error\r\n");
+				break;
+			}
+			ok_++;
+		}
+		req.get_client()->get_stream().close();
+		return NULL;
+	}
+
+private:
+	acl::string addr_;
+	int count_;
+	int ok_;
+};
+
+static void usage(const char* procname)
+{
+	printf("usage: %s -h [help]\r\n"
+		" -c threads[default: 10]\r\n"
+		" -n requests_per_thread[default: 1000]\r\n"
+		" -i json_items[default: 100]\r\n"
+		" -s ms_to_build_json[default: 1]\r\n"
+		" -t cache_ttl[default: 1]\r\n"
+		" -C [use http_response_cache]\r\n",
+		procname);
+}
+
+int main(int argc, char* argv[])
+{
+	int  ch, nthreads = 10, count = 1000, ttl = 1;
+	bool use_cache = false;
+
+	while ((ch = getopt(argc, argv, "hc:n:i:s:t:C")) > 0) {
+		switch (ch) {
+		case 'h':
+			usage(argv[0]);
+			return 0;
+		case 'c':
+			nthreads = atoi(optarg);
+			break;
+		case 'n':
+			count = atoi(optarg);
+			break;
+		case 'i':
+			__items = atoi(optarg);
+			break;
+		case 's':
+			__cost = atoi(optarg);
+			break;
+		case 't':
+			ttl = atoi(optarg);
+			break;
+		case 'C':
+			use_cache = true;
+			break;
+		default:
+			break;
+		}
+	}
+
+	if (nthreads <= 0) {
+		nthreads = 1;
+	}
+
+	acl::log::stdout_open(true);
+
+	// the server threads wait for the one generating the missing response
+	acl::http_response_cache cache(ttl);
+	cache.set_wait_timeout(5000);
+	if (use_cache) {
+		__cache = &cache;
+	}
+
+	acl::server_socket ss;
+	if (!ss.open("127.0.0.1:0")) {
+		printf("listen error\r\n");
+		return 1;
+	}
+
+	// one more connection for checking the headers at last
+	std::vector<server_thread*> servers;
+	for (int i = 0; i <= nthreads; i++) {
+		server_thread* thr = new server_thread(ss);
+		thr->set_detachable(false);
+		thr->start();
+		servers.push_back(thr);
+	}
+
+	struct timeval begin, end;
+	gettimeofday(&begin, NULL);
+
+	std::vector<client_thread*> clients;
+	for (int i = 0; i < nthreads; i++) {
+		client_thread* thr = new client_thread(ss.get_addr(), count);
+		thr->set_detachable(false);
+		thr->start();
+		clients.push_back(thr);
+	}
+
+	int total = 0;
+	for (std::vector<client_thread*>::iterator it = clients.begin();
+		it != clients.end(); ++it) {
+		(*it)->wait();
+		total += (*it)->get_ok();
+		delete *it;
+	}
+
+	gettimeofday(&end, NULL);
+	double spent = stamp_sub(begin, end);
+	printf("%s: threads=%d, requests=%d, built=%lld, spent=%.2f ms, "
+		"qps=%.2f\r\n", __cache ? "cached" : "uncached", nthreads,
+		total, __generated.value(), spent,
+		total * 1000 / (spent > 0 ? spent : 1));
+
+	acl::http_request req(ss.get_addr());
+	acl::string body;
+	int status = get(req, body);
+	const char* etag = req.get_client()->header_value("ETag");
+	acl::string tag(etag ? etag : "");
+	size_t plain = body.size();
+
+	if (__cache) {
+		status = get(req, body, tag);
+		printf("if-none-match %s: status=%d, %s\r\n", tag.c_str(),
+			status, status == 304 && body.empty() ? "ok" : "error");
+
+		status = get(req, body, NULL, "gzip");
+		const char* codec =
+			req.get_client()->header_value("Content-Encoding");
+		printf("gzip: status=%d, encoding=%s, len=%d/%d, %s\r\n",
+			status, codec ? codec : "none", (int) body.size(),
+			(int) plain, codec && body.size() == plain
+			? "ok" : "error");
+
+		status = post(req, body, tag);
+		const char* cc = req.get_client()->header_value("Cache-Control");
+		etag = req.get_client()->header_value("ETag");
+		printf("post if-none-match: status=%d, cache-control=%s, "
+			"etag=%s, %s\r\n", status, cc ? cc : "none",
+			etag ? etag : "none", status == 200 && !body.empty()
+			&& cc == NULL && etag == NULL ? "ok" : "error");
+
+		printf("cache: size=%d, hits=%lld, misses=%lld, stales=%lld, "
+			"not_modified=%lld\r\n", (int) cache.size(),
+			cache.hits(), cache.misses(), cache.stales(),
+			cache.not_modified());
+	}
+
+	req.get_client()->get_stream().close();
+	for (std::vector<server_thread*>::iterator it = servers.begin();
+		it != servers.end(); ++it) {
+		(*it)->wait();
+		delete *it;
+	}
+	return 0;
+}
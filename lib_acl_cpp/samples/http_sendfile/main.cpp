@@ -0,0 +1,266 @@
+#include "stdafx.h"
+#include <getopt.h>
+#include <sys/time.h>
+
+// One HTTP server thread serves a static file with HttpServletResponse::
+// sendFile, or by reading and writing it in the user space for comparing,
+// and the client downloads it in one keep-alive connection, and the Range
+// and If-None-Match requests are checked, too.
+
+static acl::string __path;
+static bool __buffered = false;
+static acl::http_file_cache* __cache = NULL;
+
+static double stamp_sub(const struct timeval& from, const struct timeval& to)
+{
+	return (to.tv_sec - from.tv_sec) * 1000.0
+		+ (to.tv_usec - from.tv_usec) / 1000.0;
+}
+
+class file_servlet : public acl::HttpServlet
+{
+public:
+	file_servlet(acl::socket_stream* conn) : HttpServlet(conn) {}
+	~file_servlet(void) {}
+
+protected:
+	// @override
+	bool doGet(acl::HttpServletRequest&, acl::HttpServletResponse& res)
+	{
+		res.setContentType("application/octet-stream").setKeepAlive(true);
+		if (__cache) {
+			return res.sendFile(*__cache, __path);
+		} else if (!__buffered) {
+			return res.sendFile(__path);
+		}
+
+		acl::ifstream in;
+		if (!in.open_read(__path)) {
+			return false;
+		}
+
+		res.setContentLength(in.fsize());
+		char buf[8192];
+		int ret;
+		while ((ret = in.read(buf, sizeof(buf), false)) > 0) {
+			if (!res.write(buf, ret)) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// @override
+	bool doHead(acl::HttpServletRequest& req, acl::HttpServletResponse& res)
+	{
+		return doGet(req, res);
+	}
+};
+
+class server_thread : public acl::thread
+{
+public:
+	server_thread(acl::server_socket& ss) : ss_(ss) {}
+	~server_thread(void) {}
+
+protected:
+	// @override
+	void* run(void)
+	{
+		acl::socket_stream* conn = ss_.accept();
+		if (conn == NULL) {
+			printf("accept error\r\n");
+			return NULL;
+		}
+
+		file_servlet servlet(conn);
+		servlet.setRwTimeout(10);
+		while (servlet.doRun()) {}
+		delete conn;
+		return NULL;
+	}
+
+private:
+	acl::server_socket& ss_;
+};
+
+static long long get(acl::http_request& req, int& status,
+	const char* range = NULL, const char* etag = NULL)
+{
+	req.reset();
+	acl::http_header& hdr = req.request_header();
+	hdr.set_url("/file").set_keep_alive(true);
+	if (range) {
+		hdr.add_entry("Range", range);
+	}
+	if (etag) {
+		hdr.add_entry("If-None-Match", etag);
+	}
+
+	if (!req.request(NULL, 0)) {
+		printf("request error\r\n");
+		return -1;
+	}
+
+	status = req.http_status();
+
+	char buf[65536];
+	long long n = 0;
+	int ret;
+	while ((ret = req.read_body(buf, sizeof(buf))) > 0) {
+		n += ret;
+	}
+	return n;
+}
+
+static void usage(const char* procname)
+{
+	printf("usage: %s -h [help]\r\n"
+		" -f file_path\r\n"
+		" -n download_count[default: 100]\r\n"
+		" -B [read and write the file in the user space]\r\n"
+		" -C [use http_file_cache]\r\n"
+		" -I [use inotify with http_file_cache]\r\n",
+		procname);
+}
+
+int main(int argc, char* argv[])
+{
+	int  ch, count = 100;
+	bool use_cache = false, use_inotify = false;
+
+	while ((ch = getopt(argc, argv, "hf:n:BCI")) > 0) {
+		switch (ch) {
+		case 'h':
+			usage(argv[0]);
+			return 0;
+		case 'f':
+			__path = optarg;
+			break;
+		case 'n':
+			count = atoi(optarg);
+			break;
+		case 'B':
+			__buffered = true;
+			break;
+		case 'C':
+			use_cache = true;
+			break;
+		case 'I':
+			use_cache = true;
+			use_inotify = true;
+			break;
+		default:
+			break;
+		}
+	}
+
+	if (__path.empty()) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	long long size = acl::fstream::fsize(__path);
+	if (size <= 0) {
+		printf("invalid file %s\r\n", __path.c_str());
+		return 1;
+	}
+
+	acl::log::stdout_open(true);
+
+	acl::http_file_cache cache(100, use_inotify ? 60 : 1);
+	if (use_cache) {
+		if (use_inotify) {
+			cache.use_inotify(true);
+		}
+		__cache = &cache;
+	}
+
+	acl::server_socket ss;
+	if (!ss.open("127.0.0.1:0")) {
+		printf("listen error\r\n");
+		return 1;
+	}
+
+	server_thread thr(ss);
+	thr.set_detachable(false);
+	thr.start();
+
+	acl::http_request req(ss.get_addr());
+	int status = 0, i;
+	long long total = 0;
+
+	struct timeval begin, end;
+	gettimeofday(&begin, NULL);
+
+	for (i = 0; i < count; i++) {
+		long long n = get(req, status);
+		if (n != size || status != 200) {
+			printf("get error, status=%d, len=%lld\r\n", status, n);
+			break;
+		}
+		total += n;
+	}
+
+	gettimeofday(&end, NULL);
+	double spent = stamp_sub(begin, end);
+	printf("%s: %s, count=%d, total=%lld, spent=%.2f ms, MB/s=%.2f\r\n",
+		__buffered ? "buffered" : (__cache ? "cached" : "sendfile"),
+		i == count ? "ok" : "error",
+		i, total, spent, total / 1048576.0 * 1000 / (spent > 0 ? spent : 1));
+
+	if (!__buffered) {
+		acl::string range;
+		range.format("bytes=1-%lld", size / 2);
+		long long n = get(req, status, range);
+		printf("%s: status=%d, len=%lld, %s\r\n", range.c_str(),
+			status, n, status == 206 && n == size / 2 ? "ok" : "error");
+
+		range.format("bytes=%lld-", size);
+		n = get(req, status, range);
+		printf("%s: status=%d, %s\r\n", range.c_str(), status,
+			status == 416 ? "ok" : "error");
+
+		// the end before the start can't be satisfied
+		range.format("bytes=%lld-%lld", size / 2, size / 4);
+		n = get(req, status, range);
+		printf("%s: status=%d, %s\r\n", range.c_str(), status,
+			status == 416 ? "ok" : "error");
+
+		// the explicit 0 end is the first byte only
+		n = get(req, status, "bytes=0-0");
+		printf("bytes=0-0: status=%d, len=%lld, %s\r\n", status, n,
+			status == 206 && n == 1 ? "ok" : "error");
+
+		// the suffix range is the last bytes, or the whole if longer
+		long long suffix = size > 10 ? 10 : size;
+		range.format("bytes=-%lld", suffix);
+		n = get(req, status, range);
+		printf("%s: status=%d, len=%lld, %s\r\n", range.c_str(),
+			status, n, status == 206 && n == suffix ? "ok" : "error");
+
+		range.format("bytes=-%lld", size + 10);
+		n = get(req, status, range);
+		printf("%s: status=%d, len=%lld, %s\r\n", range.c_str(),
+			status, n, status == 206 && n == size ? "ok" : "error");
+
+		n = get(req, status, "bytes=-0");
+		printf("bytes=-0: status=%d, %s\r\n", status,
+			status == 416 ? "ok" : "error");
+
+		const char* etag = req.get_client()->header_value("ETag");
+		acl::string tag(etag ? etag : "");
+		n = get(req, status, NULL, tag);
+		printf("if-none-match %s: status=%d, %s\r\n", tag.c_str(),
+			status, status == 304 && n == 0 ? "ok" : "error");
+	}
+
+	if (__cache) {
+		printf("cache: files=%d, hits=%lld, misses=%lld\r\n",
+			(int) cache.size(), cache.hits(), cache.misses());
+	}
+
+	req.get_client()->get_stream().close();
+	thr.wait();
+	return 0;
+}
@@ -0,0 +1,184 @@
+#include "stdafx.h"
+#include <getopt.h>
+#include <sys/time.h>
+
+// Compare getting the keys one by one with get_multi, which gets all the
+// keys in one round trip with the text or the binary protocol, and the
+// values are read into the buffers of the caller directly. With more than
+// one server, the keys are spread over them by memcache_manager.
+
+static double stamp_sub(const struct timeval& from, const struct timeval& to)
+{
+	return (to.tv_sec - from.tv_sec) * 1000.0
+		+ (to.tv_usec - from.tv_usec) / 1000.0;
+}
+
+static bool check(const std::vector<acl::memcache_item>& items,
+	const std::vector<acl::string>& values)
+{
+	for (size_t i = 0; i < items.size(); i++) {
+		const acl::memcache_item& item = items[i];
+		if (i % 10 == 9) {
+			// the missing keys
+			if (item.found) {
+				printf("key %s shouldn't be found\r\n", item.key);
+				return false;
+			}
+			continue;
+		}
+
+		if (!item.found || item.len != values[i].size()
+			|| item.flags != (unsigned short) i
+			|| memcmp(item.buf, values[i].c_str(), item.len) != 0) {
+
+			printf("invalid key %s, found=%d, len=%d\r\n", item.key,
+				item.found ? 1 : 0, (int) item.len);
+			return false;
+		}
+	}
+	return true;
+}
+
+static void usage(const char* procname)
+{
+	printf("usage: %s -h [help]\r\n"
+		" -s memcached_addrs[default: 127.0.0.1:11211, separated by ',']\r\n"
+		" -n keys_per_get[default: 100]\r\n"
+		" -c loop_count[default: 1000]\r\n"
+		" -l value_length[default: 64]\r\n"
+		" -B [use the binary protocol in get_multi]\r\n"
+		" -H [place the keys with the consistent hash]\r\n",
+		procname);
+}
+
+int main(int argc, char* argv[])
+{
+	int  ch, nkeys = 100, count = 1000, len = 64;
+	bool binary = false, consistent = false;
+	acl::string addrs("127.0.0.1:11211");
+
+	while ((ch = getopt(argc, argv, "hs:n:c:l:BH")) > 0) {
+		switch (ch) {
+		case 'h':
+			usage(argv[0]);
+			return 0;
+		case 's':
+			addrs = optarg;
+			break;
+		case 'n':
+			nkeys = atoi(optarg);
+			break;
+		case 'c':
+			count = atoi(optarg);
+			break;
+		case 'l':
+			len = atoi(optarg);
+			break;
+		case 'B':
+			binary = true;
+			break;
+		case 'H':
+			consistent = true;
+			break;
+		default:
+			break;
+		}
+	}
+
+	acl::acl_cpp_init();
+	acl::log::stdout_open(true);
+
+	acl::memcache_manager manager;
+	manager.set_consistent_hash(consistent);
+	manager.init(NULL, addrs, 10, 10, 10);
+
+	std::vector<acl::string> keys, values;
+	std::string pad(len, 'x');
+	for (int i = 0; i < nkeys; i++) {
+		acl::string key, value;
+		key.format("multi_%d", i);
+		value.format("%d:", i);
+		value.append(pad.c_str(), pad.size());
+		keys.push_back(key);
+		values.push_back(value);
+	}
+
+	// set the keys except the missing ones on the servers they belong to
+	for (int i = 0; i < nkeys; i++) {
+		acl::connect_pool* pool = manager.peek(keys[i]);
+		acl::memcache* conn = (acl::memcache*) pool->peek();
+		if (i % 10 == 9) {
+			conn->del(keys[i].c_str());
+		} else if (!conn->set(keys[i].c_str(), values[i].c_str(),
+			values[i].size(), 0, (unsigned short) i)) {
+			printf("set %s error: %s\r\n", keys[i].c_str(),
+				conn->last_serror());
+			return 1;
+		}
+		pool->put(conn);
+	}
+
+	struct timeval begin, end;
+	gettimeofday(&begin, NULL);
+
+	int i;
+	acl::string buf;
+	for (i = 0; i < count; i++) {
+		for (int j = 0; j < nkeys; j++) {
+			acl::connect_pool* pool = manager.peek(keys[j]);
+			acl::memcache* conn = (acl::memcache*) pool->peek();
+			bool ok = conn->get(keys[j].c_str(), buf);
+			pool->put(conn);
+			if (ok != (j % 10 != 9)) {
+				printf("get %s error\r\n", keys[j].c_str());
+				return 1;
+			}
+		}
+	}
+
+	gettimeofday(&end, NULL);
+	double spent = stamp_sub(begin, end);
+	printf("get: loop=%d, keys=%d, spent=%.2f ms, keys/s=%.2f\r\n",
+		i, nkeys, spent, (double) i * nkeys * 1000 / (spent > 0 ? spent : 1));
+
+	// the values are read into one buffer owned by the caller
+	std::vector<char> arena(nkeys * (len + 32));
+	std::vector<acl::memcache_item> items;
+	for (int j = 0; j < nkeys; j++) {
+		items.push_back(acl::memcache_item(keys[j],
+			&arena[j * (len + 32)], len + 32));
+	}
+
+	manager.set_binary(binary);
+
+	gettimeofday(&begin, NULL);
+
+	for (i = 0; i < count; i++) {
+		int ret = manager.get_multi(&items[0], items.size());
+		if (ret != nkeys - nkeys / 10 || !check(items, values)) {
+			printf("get_multi error, ret=%d\r\n", ret);
+			break;
+		}
+	}
+
+	gettimeofday(&end, NULL);
+	spent = stamp_sub(begin, end);
+	printf("get_multi(%s): %s, loop=%d, keys=%d, spent=%.2f ms, "
+		"keys/s=%.2f\r\n", binary ? "binary" : "text",
+		i == count ? "ok" : "error", i, nkeys, spent,
+		(double) i * nkeys * 1000 / (spent > 0 ? spent : 1));
+
+	// the values allocated from the dbuf_pool
+	acl::dbuf_pool* dbuf = new acl::dbuf_pool;
+	for (int j = 0; j < nkeys; j++) {
+		items[j].buf  = NULL;
+		items[j].size = 0;
+	}
+
+	int ret = manager.get_multi(&items[0], items.size(), dbuf);
+	bool ok = ret == nkeys - nkeys / 10 && check(items, values);
+	printf("get_multi with dbuf: %s, ret=%d\r\n", ok ? "ok" : "error", ret);
+	dbuf->destroy();
+
+	return i == count && ok ? 0 : 1;
+}
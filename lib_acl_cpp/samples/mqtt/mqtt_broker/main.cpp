@@ -0,0 +1,368 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+#include <getopt.h>
+#include <sys/time.h>
+#include "acl_cpp/lib_acl.hpp"
+
+//////////////////////////////////////////////////////////////////////////////
+
+// one mqtt client connection attached to the broker in aio mode.
+class broker_client : public acl::mqtt_aclient, public acl::mqtt_session {
+public:
+	broker_client(acl::aio_handle& handle, acl::mqtt_broker& broker)
+	: mqtt_aclient(handle), mqtt_session(broker), broker_(broker) {}
+
+protected:
+	~broker_client(void) {}
+
+	// @override
+	void destroy(void) { delete this; }
+
+	// @override
+	bool on_open(void) { return true; }
+
+	// @override
+	bool on_body(const acl::mqtt_message& body) {
+		return this->handle(body);
+	}
+
+	// @override
+	bool on_read_done(void) {
+		// write the messages queued by all the messages read
+		broker_.flush();
+		return true;
+	}
+
+	// @override
+	bool write_iov(const struct iovec* iov, int count) {
+		// the data left will be copied and sent by aio
+		this->get_conn()->writev(iov, count);
+		return true;
+	}
+
+private:
+	acl::mqtt_broker& broker_;
+};
+
+class server_callback : public acl::aio_accept_callback {
+public:
+	server_callback(acl::aio_handle& handle, acl::mqtt_broker& broker)
+	: handle_(handle), broker_(broker) {}
+	~server_callback(void) {}
+
+protected:
+	// @override
+	bool accept_callback(acl::aio_socket_stream* conn) {
+		acl::mqtt_aclient* client = new broker_client(handle_, broker_);
+		if (client->open(conn)) {
+			return true;
+		}
+
+		printf("open one mqtt client failed\r\n");
+		client->destroy();
+		conn->close();
+		return true;
+	}
+
+private:
+	acl::aio_handle& handle_;
+	acl::mqtt_broker& broker_;
+};
+
+//////////////////////////////////////////////////////////////////////////////
+
+// the subscriber counting the data written, used in bench mode, and the
+// data will be parsed as the mqtt client does if parse is true.
+class null_session : public acl::mqtt_session {
+public:
+	null_session(acl::mqtt_broker& broker, bool parse)
+	: mqtt_session(broker)
+	, nwritev_(0)
+	, nbytes_(0)
+	, nmsgs_(0)
+	, parse_(parse)
+	, header_(acl::MQTT_RESERVED_MIN)
+	, body_(NULL) {}
+
+	~null_session(void) { delete body_; }
+
+	long long nwritev_;
+	long long nbytes_;
+	long long nmsgs_;
+
+	// the packet ids of the QoS1 PUBLISH received.
+	std::vector<unsigned short> ids_;
+
+protected:
+	// @override
+	bool write_iov(const struct iovec* iov, int count) {
+		nwritev_++;
+		for (int i = 0; i < count; i++) {
+			nbytes_ += (long long) iov[i].iov_len;
+			if (parse_ && !update((const char*) iov[i].iov_base,
+				(int) iov[i].iov_len)) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+private:
+	bool parse_;
+	acl::mqtt_header header_;
+	acl::mqtt_message* body_;
+
+	bool update(const char* data, int len) {
+		while (len > 0) {
+			int left = len;
+			if (!header_.finished()) {
+				left = header_.update(data, len);
+				if (left < 0) {
+					printf("invalid mqtt header\r\n");
+					return false;
+				}
+				if (!header_.finished()) {
+					return true;
+				}
+				data += len - left;
+				len   = left;
+			}
+
+			if (body_ == NULL) {
+				body_ = acl::mqtt_message::create_message(header_);
+				if (body_ == NULL) {
+					printf("invalid mqtt type\r\n");
+					return false;
+				}
+			}
+
+			if (len > 0) {
+				left = body_->update(data, len);
+				if (left < 0) {
+					printf("invalid mqtt body\r\n");
+					return false;
+				}
+				data += len - left;
+				len   = left;
+			}
+
+			if (!body_->finished()) {
+				continue;
+			}
+
+			if (header_.get_type() == acl::MQTT_PUBLISH) {
+				nmsgs_++;
+				if (header_.get_qos() != acl::MQTT_QOS0) {
+					acl::mqtt_publish* pub =
+						(acl::mqtt_publish*) body_;
+					ids_.push_back(pub->get_pkt_id());
+				}
+			}
+			header_.reset();
+			delete body_;
+			body_ = NULL;
+		}
+		return true;
+	}
+};
+
+static double stamp_sub(const struct timeval& from, const struct timeval& to) {
+	return (to.tv_sec - from.tv_sec) * 1000.0
+		+ (to.tv_usec - from.tv_usec) / 1000.0;
+}
+
+static void bench(int nsubs, int ntopics, int ngroups, int max, int batch,
+	int len, acl::mqtt_qos_t qos, bool parse) {
+
+	acl::mqtt_broker broker(32, 1000);
+	std::vector<null_session*> sessions;
+	struct timeval begin, end;
+	acl::string filter;
+
+	gettimeofday(&begin, NULL);
+	for (int i = 0; i < nsubs; i++) {
+		null_session* sess = new null_session(broker, parse);
+		acl::mqtt_connect conn;
+		conn.set_cid(acl::string::parse_int(i));
+		sess->handle(conn);
+
+		// mix the filters with the exact topics and the wildcards
+		int n = i % ntopics;
+		if (ngroups > 0) {
+			filter.format("$share/g%d/bench/%d/data", i % ngroups, n);
+		} else if (i % 3 == 0) {
+			filter.format("bench/%d/data", n);
+		} else if (i % 3 == 1) {
+			filter.format("bench/%d/+", n);
+		} else {
+			filter.format("bench/%d/#", n);
+		}
+		broker.subscribe(*sess, filter, qos);
+		sessions.push_back(sess);
+	}
+	gettimeofday(&end, NULL);
+	printf("subscribe: sessions=%d, topics=%d, subscriptions=%ld, "
+		"spent=%.2f ms\r\n", nsubs, ntopics, (long) broker.subscriptions(),
+		stamp_sub(begin, end));
+
+	// the CONNACK and SUBACK
+	broker.flush();
+	for (std::vector<null_session*>::iterator it = sessions.begin();
+		it != sessions.end(); ++it) {
+		(*it)->nwritev_ = (*it)->nbytes_ = 0;
+	}
+
+	std::string payload(len, 'x');
+	acl::string topic;
+	long long ndelivered = 0;
+
+	gettimeofday(&begin, NULL);
+	for (int i = 0; i < max; i++) {
+		topic.format("bench/%d/data", i % ntopics);
+		ndelivered += broker.publish(topic, payload.data(),
+			payload.size(), qos);
+
+		if ((i + 1) % batch != 0 && i + 1 != max) {
+			continue;
+		}
+
+		broker.flush();
+
+		if (qos == acl::MQTT_QOS0) {
+			continue;
+		}
+
+		// ack all the QoS1 messages as the clients do
+		for (std::vector<null_session*>::iterator it = sessions.begin();
+			it != sessions.end(); ++it) {
+			null_session* sess = *it;
+			for (size_t j = 0; j < sess->ids_.size(); j++) {
+				acl::mqtt_puback ack;
+				ack.set_pkt_id(sess->ids_[j]);
+				sess->handle(ack);
+			}
+			sess->ids_.clear();
+		}
+	}
+	gettimeofday(&end, NULL);
+
+	long long nwritev = 0, nbytes = 0, ndropped = 0, nmsgs = 0;
+	for (std::vector<null_session*>::iterator it = sessions.begin();
+		it != sessions.end(); ++it) {
+		nwritev  += (*it)->nwritev_;
+		nbytes   += (*it)->nbytes_;
+		nmsgs    += (*it)->nmsgs_;
+		ndropped += (long long) (*it)->dropped();
+		delete *it;
+	}
+
+	double spent = stamp_sub(begin, end);
+	printf("publish: qos=%d, msgs=%d, spent=%.2f ms, msgs/s=%.2f\r\n",
+		(int) qos, max, spent, max * 1000.0 / (spent > 0 ? spent : 1));
+	printf("fanout: delivered=%lld, delivered/s=%.2f, writev=%lld, "
+		"msgs/writev=%.2f, bytes=%lld, dropped=%lld\r\n", ndelivered,
+		ndelivered * 1000.0 / (spent > 0 ? spent : 1), nwritev,
+		nwritev > 0 ? (double) ndelivered / nwritev : 0.0,
+		nbytes, ndropped);
+
+	if (parse) {
+		printf("parsed: publish=%lld, %s\r\n", nmsgs,
+			nmsgs + ndropped == ndelivered ? "ok" : "error");
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void usage(const char* procname) {
+	printf("usage: %s -h [help]\r\n"
+		" -s listen_addr[default: 0.0.0.0|1883]\r\n"
+		" -b [run the benchmark in process instead of the server]\r\n"
+		" -c subscribers[default: 100000]\r\n"
+		" -t topics[default: 100]\r\n"
+		" -g shared_groups[default: 0, no shared subscription]\r\n"
+		" -n messages[default: 10000]\r\n"
+		" -B messages_per_flush[default: 10]\r\n"
+		" -l payload_length[default: 64]\r\n"
+		" -q qos[0|1, default: 0]\r\n"
+		" -v [parse the data written as the clients, always for qos 1]\r\n",
+		procname);
+}
+
+int main(int argc, char* argv[]) {
+	int  ch, nsubs = 100000, ntopics = 100, ngroups = 0, max = 10000;
+	int  batch = 10, len = 64, qos = 0;
+	bool benchmark = false, parse = false;
+	acl::string addr("0.0.0.0|1883");
+
+	while ((ch = getopt(argc, argv, "hs:bc:t:g:n:B:l:q:v")) > 0) {
+		switch (ch) {
+		case 'h':
+			usage(argv[0]);
+			return 0;
+		case 's':
+			addr = optarg;
+			break;
+		case 'b':
+			benchmark = true;
+			break;
+		case 'c':
+			nsubs = atoi(optarg);
+			break;
+		case 't':
+			ntopics = atoi(optarg);
+			break;
+		case 'g':
+			ngroups = atoi(optarg);
+			break;
+		case 'n':
+			max = atoi(optarg);
+			break;
+		case 'B':
+			batch = atoi(optarg);
+			break;
+		case 'l':
+			len = atoi(optarg);
+			break;
+		case 'q':
+			qos = atoi(optarg);
+			break;
+		case 'v':
+			parse = true;
+			break;
+		default:
+			break;
+		}
+	}
+
+	acl::log::stdout_open(true);
+
+	if (benchmark) {
+		bench(nsubs, ntopics > 0 ? ntopics : 1, ngroups,
+			max, batch > 0 ? batch : 1, len >= 0 ? len : 0,
+			qos > 0 ? acl::MQTT_QOS1 : acl::MQTT_QOS0,
+			parse || qos > 0);
+		return 0;
+	}
+
+	acl::aio_handle handle(acl::ENGINE_KERNEL);
+
+	acl::aio_listen_stream* listener = new acl::aio_listen_stream(&handle);
+	if (!listener->open(addr)) {
+		printf("listen %s error %s\r\n", addr.c_str(), acl::last_serror());
+		return 1;
+	}
+	printf("listen %s ok\r\n", addr.c_str());
+
+	acl::mqtt_broker broker;
+	server_callback callback(handle, broker);
+	listener->add_accept_callback(&callback);
+
+	while (handle.check()) {}
+
+	handle.check();
+	listener->destroy();
+
+	return 0;
+}
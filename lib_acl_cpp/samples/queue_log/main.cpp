@@ -0,0 +1,240 @@
+#include "stdafx.h"
+#include <getopt.h>
+#include <sys/time.h>
+
+// Compare the queue files with the append log as the backend of queue_manager:
+// the producer threads create, write and rename the queue files, and then
+// all of them are scanned, checked and deleted.
+
+static acl::string __home("./var");
+static acl::string __queue("queue_log");
+static size_t __len = 256;
+static size_t __seg_size = 64;
+static bool   __use_log = false;
+static bool   __sync = true;
+
+static double stamp_sub(const struct timeval& from, const struct timeval& to)
+{
+	return (to.tv_sec - from.tv_sec) * 1000.0
+		+ (to.tv_usec - from.tv_usec) / 1000.0;
+}
+
+static bool open_queue(acl::queue_manager& manager)
+{
+	if (__use_log && !manager.open_log(__seg_size * 1024 * 1024, __sync)) {
+		printf("open log error\r\n");
+		return false;
+	}
+	return true;
+}
+
+class producer : public acl::thread
+{
+public:
+	producer(acl::queue_manager& manager, int id, int count)
+	: manager_(manager), id_(id), count_(count), nok_(0) {}
+	~producer(void) {}
+
+	int nok(void) const
+	{
+		return nok_;
+	}
+
+protected:
+	// @override
+	void* run(void)
+	{
+		acl::string body;
+		std::string pad(__len, 'x');
+
+		for (int i = 0; i < count_; i++) {
+			acl::queue_file* fp = manager_.create_file("tmp");
+			if (fp == NULL) {
+				printf("create file error\r\n");
+				break;
+			}
+
+			body.format("%d:%d:", id_, i);
+			body.append(pad.c_str(), __len - body.size());
+
+			// the item can be scanned after renamed
+			if (!fp->write(body.c_str(), body.size())
+				|| !manager_.rename_extname(fp, "ok")) {
+				printf("write %s error\r\n", fp->key());
+				manager_.delete_file(fp);
+				break;
+			}
+
+			manager_.close_file(fp);
+			nok_++;
+		}
+		return NULL;
+	}
+
+private:
+	acl::queue_manager& manager_;
+	int id_;
+	int count_;
+	int nok_;
+};
+
+static int produce(acl::queue_manager& manager, int nthreads, int count)
+{
+	std::vector<producer*> threads;
+	for (int i = 0; i < nthreads; i++) {
+		producer* thr = new producer(manager, i, count);
+		thr->set_detachable(false);
+		threads.push_back(thr);
+		thr->start();
+	}
+
+	int n = 0;
+	for (std::vector<producer*>::iterator it = threads.begin();
+		it != threads.end(); ++it) {
+
+		(*it)->wait();
+		n += (*it)->nok();
+		delete *it;
+	}
+	return n;
+}
+
+static int consume(acl::queue_manager& manager)
+{
+	if (!manager.scan_open()) {
+		printf("scan_open error\r\n");
+		return -1;
+	}
+
+	char buf[8192];
+	int  n = 0, nerr = 0;
+	acl::queue_file* fp;
+
+	while ((fp = manager.scan_next()) != NULL) {
+		if (strcmp(fp->get_extName(), "ok") != 0) {
+			manager.close_file(fp);
+			continue;
+		}
+
+		acl::string body;
+		int ret;
+		while ((ret = fp->read(buf, sizeof(buf))) > 0) {
+			body.append(buf, ret);
+		}
+
+		if (body.size() != __len || strchr(body.c_str(), ':') == NULL) {
+			printf("invalid %s, len=%d\r\n", fp->get_filePath(),
+				(int) body.size());
+			nerr++;
+		}
+
+		manager.delete_file(fp);
+		n++;
+	}
+
+	manager.scan_close();
+	return nerr > 0 ? -1 : n;
+}
+
+static void usage(const char* procname)
+{
+	printf("usage: %s -h [help]\r\n"
+		" -d home_dir[default: ./var]\r\n"
+		" -t producer_threads[default: 4]\r\n"
+		" -n items_per_thread[default: 10000]\r\n"
+		" -l item_length[default: 256]\r\n"
+		" -L [use the append log as the backend]\r\n"
+		" -s segment_size_in_MB[default: 64]\r\n"
+		" -S [don't sync when committing the log]\r\n",
+		procname);
+}
+
+int main(int argc, char* argv[])
+{
+	int  ch, nthreads = 4, count = 10000;
+
+	while ((ch = getopt(argc, argv, "hd:t:n:l:Ls:S")) > 0) {
+		switch (ch) {
+		case 'h':
+			usage(argv[0]);
+			return 0;
+		case 'd':
+			__home = optarg;
+			break;
+		case 't':
+			nthreads = atoi(optarg);
+			break;
+		case 'n':
+			count = atoi(optarg);
+			break;
+		case 'l':
+			__len = (size_t) atoi(optarg);
+			break;
+		case 'L':
+			__use_log = true;
+			break;
+		case 's':
+			__seg_size = (size_t) atoi(optarg);
+			break;
+		case 'S':
+			__sync = false;
+			break;
+		default:
+			break;
+		}
+	}
+
+	if (__len < 16) {
+		__len = 16;
+	}
+
+	acl::log::stdout_open(true);
+
+	struct timeval begin, end;
+	int n;
+
+	{
+		acl::queue_manager manager(__home, __queue);
+		if (!open_queue(manager)) {
+			return 1;
+		}
+
+		gettimeofday(&begin, NULL);
+		n = produce(manager, nthreads, count);
+		gettimeofday(&end, NULL);
+
+		double spent = stamp_sub(begin, end);
+		printf("produce: %s, items=%d, spent=%.2f ms, items/s=%.2f\r\n",
+			__use_log ? "log" : "file", n, spent,
+			n * 1000.0 / (spent > 0 ? spent : 1));
+
+		if (manager.get_log()) {
+			printf("log: records=%d, segments=%d, syncs=%llu\r\n",
+				(int) manager.get_log()->size(),
+				(int) manager.get_log()->segments(),
+				manager.get_log()->syncs());
+		}
+	}
+
+	// reopen the queue to recover the items from the disk
+	acl::queue_manager manager(__home, __queue);
+	if (!open_queue(manager)) {
+		return 1;
+	}
+
+	gettimeofday(&begin, NULL);
+	int m = consume(manager);
+	gettimeofday(&end, NULL);
+
+	double spent = stamp_sub(begin, end);
+	printf("consume: %s, items=%d, spent=%.2f ms, items/s=%.2f\r\n",
+		m == n ? "ok" : "error", m, spent,
+		m * 1000.0 / (spent > 0 ? spent : 1));
+
+	if (manager.get_log()) {
+		printf("log: records=%d, segments=%d\r\n",
+			(int) manager.get_log()->size(),
+			(int) manager.get_log()->segments());
+	}
+	return m == n ? 0 : 1;
+}
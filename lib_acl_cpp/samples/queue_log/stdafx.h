@@ -0,0 +1,18 @@
+// stdafx.h : ׼ϵͳļİļ
+// ǳõĵĿضİļ
+//
+
+#pragma once
+
+
+//#include <iostream>
+//#include <tchar.h>
+
+// TODO: ڴ˴óҪĸͷļ
+
+#include "acl_cpp/lib_acl.hpp"
+
+#ifdef	WIN32
+#define	snprintf _snprintf
+#endif
+
@@ -0,0 +1,172 @@
+#include "stdafx.h"
+#include <getopt.h>
+#include <sys/time.h>
+#include "util.h"
+
+// The multi-key commands such as MSET, MGET, EXISTS and DEL with the keys in
+// the different slots are split by the slots, the sub-commands are run on
+// the redis nodes concurrently and the results are merged in the order of
+// the keys, so the keys needn't have the same hash tag.
+
+static bool test_mset(acl::redis& cmd, const std::vector<acl::string>& keys,
+	const std::vector<acl::string>& values)
+{
+	cmd.clear();
+	if (!cmd.mset(keys, values)) {
+		printf("mset error: %s\r\n", cmd.result_error());
+		return false;
+	}
+	return true;
+}
+
+static bool test_mget(acl::redis& cmd, const std::vector<acl::string>& keys,
+	const std::vector<acl::string>& values)
+{
+	std::vector<acl::string> out;
+
+	cmd.clear();
+	if (!cmd.mget(keys, &out)) {
+		printf("mget error: %s\r\n", cmd.result_error());
+		return false;
+	}
+
+	if (out.size() != values.size()) {
+		printf("mget size: %d != %d\r\n", (int) out.size(),
+			(int) values.size());
+		return false;
+	}
+
+	for (size_t i = 0; i < out.size(); i++) {
+		if (out[i] != values[i]) {
+			printf("mget key: %s, value: %s != %s\r\n",
+				keys[i].c_str(), out[i].c_str(),
+				values[i].c_str());
+			return false;
+		}
+	}
+	return true;
+}
+
+static bool test_del(acl::redis& cmd, const std::vector<acl::string>& keys)
+{
+	cmd.clear();
+	int ret = cmd.del(keys);
+	if (ret != (int) keys.size()) {
+		printf("del ret: %d != %d, error: %s\r\n", ret,
+			(int) keys.size(), cmd.result_error());
+		return false;
+	}
+	return true;
+}
+
+static bool test_exists(acl::redis& cmd, const std::vector<acl::string>& keys,
+	int expected)
+{
+	cmd.clear();
+	int ret = cmd.exists(keys);
+	if (ret != expected) {
+		printf("exists ret: %d != %d, error: %s\r\n", ret, expected,
+			cmd.result_error());
+		return false;
+	}
+	return true;
+}
+
+static void usage(const char* procname)
+{
+	printf("usage: %s -h [help]\r\n"
+		" -s redis_addr[default: 127.0.0.1:6379]\r\n"
+		" -p password[default: \"\"]\r\n"
+		" -n keys_per_command[default: 100]\r\n"
+		" -c loop_count[default: 1000]\r\n"
+		" -P [use redis_client_pipeline instead of redis_client_cluster]\r\n",
+		procname);
+}
+
+int main(int argc, char* argv[])
+{
+	int  ch, nkeys = 100, count = 1000;
+	bool use_pipeline = false;
+	acl::string addr("127.0.0.1:6379"), passwd;
+
+	while ((ch = getopt(argc, argv, "hs:p:n:c:P")) > 0) {
+		switch (ch) {
+		case 'h':
+			usage(argv[0]);
+			return 0;
+		case 's':
+			addr = optarg;
+			break;
+		case 'p':
+			passwd = optarg;
+			break;
+		case 'n':
+			nkeys = atoi(optarg);
+			break;
+		case 'c':
+			count = atoi(optarg);
+			break;
+		case 'P':
+			use_pipeline = true;
+			break;
+		default:
+			break;
+		}
+	}
+
+	acl::acl_cpp_init();
+	acl::log::stdout_open(true);
+
+	acl::redis_client_cluster cluster;
+	acl::redis_client_pipeline pipeline(addr);
+	acl::redis cmd;
+
+	if (use_pipeline) {
+		if (!passwd.empty()) {
+			pipeline.set_password(passwd);
+		}
+		pipeline.start_thread();
+		cmd.set_pipeline(&pipeline);
+	} else {
+		cluster.set(addr, 0, 10, 10);
+		if (!passwd.empty()) {
+			cluster.set_password("default", passwd);
+		}
+		cmd.set_cluster(&cluster);
+	}
+
+	std::vector<acl::string> keys, values;
+	for (int i = 0; i < nkeys; i++) {
+		acl::string key, value;
+		key.format("mkeys_%d", i);
+		value.format("value_%d", i);
+		keys.push_back(key);
+		values.push_back(value);
+	}
+
+	struct timeval begin, end;
+	gettimeofday(&begin, NULL);
+
+	int i = 0;
+	for (; i < count; i++) {
+		if (!test_mset(cmd, keys, values)
+			|| !test_exists(cmd, keys, (int) keys.size())
+			|| !test_mget(cmd, keys, values)
+			|| !test_del(cmd, keys)
+			|| !test_exists(cmd, keys, 0)) {
+			break;
+		}
+	}
+
+	gettimeofday(&end, NULL);
+	double spent = util::stamp_sub(&end, &begin);
+
+	printf("%s: loop=%d, keys=%d, spent=%.2f ms, keys/s=%.2f\r\n",
+		i == count ? "ok" : "error", i, nkeys, spent,
+		(double) i * nkeys * 5 * 1000 / (spent > 0 ? spent : 1));
+
+	if (use_pipeline) {
+		pipeline.stop_thread();
+	}
+	return 0;
+}
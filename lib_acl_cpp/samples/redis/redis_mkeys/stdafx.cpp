@@ -0,0 +1,8 @@
+// stdafx.cpp : ֻ׼ļԴļ
+// xml.pch ΪԤͷ
+// stdafx.obj ԤϢ
+
+#include "stdafx.h"
+
+// TODO:  STDAFX.H 
+//κĸͷļڴļ
@@ -240,18 +240,47 @@ static void usage(const char* procname)
 		"-p password [set the password of redis cluster]\r\n"
 		"-m [if use mbox in pipeline mode, default: false]\r\n"
 		"-b meter_base[default: 10000]\r\n"
+		"-D max_delay_us[coalescing window, default: 0]\r\n"
+		"-B max_batch[coalescing batch target, default: 256]\r\n"
 		"-a cmd[set|get|expire|ttl|exists|type|del]\r\n",
 		procname);
 }
 
+static void show_stats(acl::redis_client_pipeline& pipeline)
+{
+	std::map<acl::string, acl::redis_pipeline_stat> stats;
+	pipeline.get_stats(stats);
+
+	for (std::map<acl::string, acl::redis_pipeline_stat>::const_iterator
+		cit = stats.begin(); cit != stats.end(); ++cit) {
+		const acl::redis_pipeline_stat& stat = cit->second;
+		long long batches = stat.batches > 0 ? stat.batches : 1;
+		long long msgs = stat.messages > 0 ? stat.messages : 1;
+
+		printf("%s: batches=%lld, messages=%lld, avg batch=%.2f, "
+			"queue wait avg=%lld us, max=%lld us, "
+			"rtt avg=%lld us, max=%lld us\r\n", cit->first.c_str(),
+			stat.batches, stat.messages,
+			(double) stat.messages / batches,
+			stat.queue_wait / msgs, stat.queue_wait_max,
+			stat.rtt / batches, stat.rtt_max);
+
+		printf("batch sizes:");
+		for (int i = 0; i < REDIS_PIPELINE_HIST; i++) {
+			printf(" <=%d:%lld", 1 << i, stat.batch_sizes[i]);
+		}
+		printf("\r\n");
+	}
+}
+
 int main(int argc, char* argv[])
 {
 	int  ch, n = 1;
-	int  max_threads = 10;
+	int  max_threads = 10, max_delay = 0, max_batch = 256;
 	acl::box_type_t btype = acl::BOX_TYPE_TBOX;
 	acl::string addr("127.0.0.1:6379"), cmd("del"), passwd;
 
-	while ((ch = getopt(argc, argv, "hs:n:b:t:a:p:m")) > 0) {
+	while ((ch = getopt(argc, argv, "hs:n:b:t:a:p:mD:B:")) > 0) {
 		switch (ch) {
 		case 'h':
 			usage(argv[0]);
@@ -277,6 +306,12 @@ int main(int argc, char* argv[])
 		case 'm':
 			btype = acl::BOX_TYPE_MBOX;
 			break;
+		case 'D':
+			max_delay = atoi(optarg);
+			break;
+		case 'B':
+			max_batch = atoi(optarg);
+			break;
 		default:
 			break;
 		}
@@ -289,6 +324,7 @@ int main(int argc, char* argv[])
 	if (!passwd.empty()) {
 		pipeline.set_password(passwd);
 	}
+	pipeline.set_coalesce(max_delay, (size_t) max_batch);
 	pipeline.start_thread();
 
 	struct timeval begin;
@@ -333,6 +369,7 @@ int main(int argc, char* argv[])
 	printf("total %s: %lld, spent: %0.2f ms, speed: %0.2f\r\n", cmd.c_str(),
 		total, inter, (total * 1000) /(inter > 0 ? inter : 1));
 
+	show_stats(pipeline);
 	pipeline.stop_thread();
 
 #ifdef WIN32
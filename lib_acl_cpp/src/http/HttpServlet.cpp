@@ -8,6 +8,7 @@
 #include "acl_cpp/http/HttpSession.hpp"
 #include "acl_cpp/http/HttpServletRequest.hpp"
 #include "acl_cpp/http/HttpServletResponse.hpp"
+#include "acl_cpp/http/http_request_parser.hpp"
 #include "acl_cpp/http/HttpServlet.hpp"
 #endif
 
@@ -21,6 +22,9 @@ void HttpServlet::init(void)
 	local_charset_    = NULL;
 	rw_timeout_       = 60;
 	parse_body_limit_ = 0;
+	parser_           = NULL;
+	batch_            = false;
+	batch_max_        = 65536;
 }
 
 HttpServlet::HttpServlet(void)
@@ -68,6 +72,7 @@ HttpServlet::~HttpServlet(void)
 	}
 	delete req_;
 	delete res_;
+	delete parser_;
 }
 
 #define COPY(x, y) ACL_SAFE_STRNCPY((x), (y), sizeof((x)))
@@ -106,6 +111,50 @@ HttpServlet& HttpServlet::setParseBodyLimit(int length)
 	return *this;
 }
 
+HttpServlet& HttpServlet::setFastParser(bool yes, size_t max /* = 65536 */)
+{
+	delete parser_;
+	parser_ = yes ? NEW http_request_parser(max) : NULL;
+	return *this;
+}
+
+HttpServlet& HttpServlet::setPipelineBatch(bool yes, size_t max /* = 65536 */)
+{
+	batch_ = yes;
+	if (max > 0) {
+		batch_max_ = max;
+	}
+	return *this;
+}
+
+// if the whole header of the next request has been read into the buffer of
+// the stream, which can't be the body of the current request
+static bool nextRequestBuffered(HttpServletRequest& req, socket_stream& in)
+{
+	if (req.getContentLength() > 0 || req.getHeader("Transfer-Encoding")
+		|| req.getHeader("Upgrade")) {
+
+		return false;
+	}
+
+	ACL_VSTREAM* fp = in.get_vstream();
+	if (fp == NULL || fp->read_cnt <= 0) {
+		return false;
+	}
+
+	const char* ptr = (const char*) fp->read_ptr;
+	const char* end = ptr + fp->read_cnt;
+	while ((ptr = (const char*) memchr(ptr, '\n', end - ptr)) != NULL) {
+		if (++ptr < end && *ptr == '\r') {
+			ptr++;
+		}
+		if (ptr < end && *ptr == '\n') {
+			return true;
+		}
+	}
+	return false;
+}
+
 static bool upgradeWebsocket(HttpServletRequest& req, HttpServletResponse& res)
 {
 	const char* ptr = req.getHeader("Connection");
@@ -167,6 +216,9 @@ bool HttpServlet::start(void)
 	req_ = NEW HttpServletRequest(*res_, session_, *in, local_charset_,
 			parse_body_limit_);
 	req_->setParseBody(parse_body_);
+	if (parser_ && !cgi_mode) {
+		req_->setParser(parser_);
+	}
 
 	//  HttpServletRequest 
 	res_->setHttpServletRequest(req_);
@@ -185,6 +237,14 @@ bool HttpServlet::start(void)
 		res_->setKeepAlive(req_->isKeepAlive());
 	}
 
+	// the response is sent with the ones of the next pipelined requests
+	bool batched = batch_ && !cgi_mode && method != HTTP_METHOD_UNKNOWN
+		&& nextRequestBuffered(*req_, *in);
+	if (batched) {
+		out->set_wbuf(batch_max_);
+		res_->setBatched(true);
+	}
+
 	bool  ret;
 
 	switch (method) {
@@ -273,6 +333,15 @@ bool HttpServlet::start(void)
 		break;
 	}
 
+	// send the responses kept unless the next request will be handled
+	if (batch_ && !cgi_mode && (!batched || !ret || !req_->isKeepAlive()
+		|| !res_->getHttpHeader().get_keep_alive())) {
+
+		if (!out->fflush()) {
+			ret = false;
+		}
+	}
+
 	if (in != out) {
 		// Ǳ׼ҪȽ׼
 		// ȻͷڲԶжϷ
@@ -14,6 +14,7 @@
 #include "acl_cpp/http/http_header.hpp"
 #include "acl_cpp/http/HttpCookie.hpp"
 #include "acl_cpp/http/http_client.hpp"
+#include "acl_cpp/http/http_request_parser.hpp"
 #include "acl_cpp/http/http_mime.hpp"
 #include "acl_cpp/http/HttpSession.hpp"
 #include "acl_cpp/http/HttpServletResponse.hpp"
@@ -41,9 +42,13 @@ HttpServletRequest::HttpServletRequest(HttpServletResponse& res,
 , body_parsed_(false)
 , cookies_inited_(false)
 , client_(NULL)
+, parser_(NULL)
 , method_(HTTP_METHOD_UNKNOWN)
 , localAddr_(NULL)
 , remoteAddr_(NULL)
+, path_names_(NULL)
+, path_values_(NULL)
+, path_nparams_(0)
 , request_type_(HTTP_REQUEST_NORMAL)
 , parse_body_(true)
 , mime_(NULL)
@@ -156,6 +161,21 @@ const std::vector<HttpCookie*>& HttpServletRequest::getCookies(void) const
 		return cookies_;
 	}
 
+	if (parser_) {
+		const std::vector<http_request_parser::field>& cookies =
+			parser_->get_cookies();
+		for (std::vector<http_request_parser::field>::const_iterator
+			cit = cookies.begin(); cit != cookies.end(); ++cit) {
+
+			HttpCookie* cookie = dbuf_->create<HttpCookie,
+				const char*, const char*, dbuf_guard*>
+				((*cit).name, (*cit).value, dbuf_);
+			const_cast<HttpServletRequest*>
+				(this)->cookies_.push_back(cookie);
+		}
+		return cookies_;
+	}
+
 	if (client_ == NULL) {
 		return cookies_;
 	}
@@ -190,7 +210,16 @@ const std::vector<HttpCookie*>& HttpServletRequest::getCookies(void) const
 
 const char* HttpServletRequest::getCookieValue(const char* name) const
 {
-	(void) getCookies();
+	// no HttpCookie is created for the cookies of the parser, and the
+	// ones set by setCookie() are searched then
+	if (parser_ && !cookies_inited_) {
+		const char* value = parser_->get_cookie(name);
+		if (value) {
+			return value;
+		}
+	} else {
+		(void) getCookies();
+	}
 
 	std::vector<HttpCookie*>::const_iterator cit = cookies_.begin();
 	for (; cit != cookies_.end(); ++cit) {
@@ -208,6 +237,9 @@ const char* HttpServletRequest::getHeader(const char* name) const
 		return acl_getenv(name);
 	}
 
+	if (parser_) {
+		return parser_->header_value(name);
+	}
 	if (client_ == NULL) {
 		return NULL;
 	}
@@ -219,6 +251,9 @@ const char* HttpServletRequest::getQueryString(void) const
 	if (cgi_mode_) {
 		return acl_getenv("QUERY_STRING");
 	}
+	if (parser_) {
+		return parser_->get_query();
+	}
 	if (client_ == NULL) {
 		return "";
 	}
@@ -236,6 +271,9 @@ const char* HttpServletRequest::getPathInfo(void) const
 		ptr = acl_getenv("PATH_INFO");
 		return ptr ? ptr : "";
 	}
+	if (parser_) {
+		return parser_->get_path();
+	}
 	if (client_ == NULL) {
 		return "";
 	}
@@ -248,6 +286,9 @@ const char* HttpServletRequest::getRequestUri(void) const
 	if (cgi_mode_) {
 		return acl_getenv("REQUEST_URI");
 	}
+	if (parser_) {
+		return parser_->get_url();
+	}
 	if (client_ == NULL) {
 		return "";
 	} else {
@@ -301,6 +342,9 @@ acl_int64 HttpServletRequest::getContentLength(void) const
 		}
 		return acl_atoui64(ptr);
 	}
+	if (parser_) {
+		return parser_->get_content_length();
+	}
 	if (client_ == NULL) {
 		return -1;
 	}
@@ -313,6 +357,15 @@ bool HttpServletRequest::getRange(http_off_t& range_from, http_off_t& range_to)
 		logger_error("cant' support CGI mode");
 		return false;
 	}
+	if (parser_) {
+		long long from, to;
+		if (!parser_->get_range(from, to)) {
+			return false;
+		}
+		range_from = from;
+		range_to   = to;
+		return true;
+	}
 	if (client_ == NULL) {
 		logger_error("client_ null");
 		return false;
@@ -332,6 +385,9 @@ const char* HttpServletRequest::getContentType(
 	if (cgi_mode_) {
 		return acl_getenv("CONTENT_TYPE");
 	}
+	if (parser_) {
+		return parser_->header_value("Content-Type");
+	}
 	if (client_ == NULL) {
 		logger_error("client_ null");
 		return "";
@@ -355,10 +411,10 @@ const char* HttpServletRequest::getLocalAddr(void) const
 		return NULL;
 	}
 
-	if (client_ == NULL) {
+	if (client_ == NULL && parser_ == NULL) {
 		return NULL;
 	}
-	const char* ptr = client_->get_stream().get_local();
+	const char* ptr = stream_.get_local();
 	if (*ptr == 0) {
 		return NULL;
 	}
@@ -383,11 +439,11 @@ unsigned short HttpServletRequest::getLocalPort(void) const
 		return 0;
 	}
 
-	if (client_ == NULL) {
+	if (client_ == NULL && parser_ == NULL) {
 		return 0;
 	}
 
-	const char* ptr = client_->get_stream().get_local(true);
+	const char* ptr = stream_.get_local(true);
 	if (*ptr == 0) {
 		return 0;
 	}
@@ -410,10 +466,10 @@ const char* HttpServletRequest::getRemoteAddr(void) const
 		logger_warn("no REMOTE_ADDR from acl_getenv");
 		return NULL;
 	}
-	if (client_ == NULL) {
+	if (client_ == NULL && parser_ == NULL) {
 		return NULL;
 	}
-	const char* ptr = client_->get_stream().get_peer();
+	const char* ptr = stream_.get_peer();
 	if (*ptr == 0) {
 		logger_warn("get_peer return empty string");
 		return NULL;
@@ -443,10 +499,10 @@ unsigned short HttpServletRequest::getRemotePort(void) const
 		logger_warn("no REMOTE_PORT from acl_getenv");
 		return 0;
 	}
-	if (client_ == NULL) {
+	if (client_ == NULL && parser_ == NULL) {
 		return 0;
 	}
-	const char* ptr = client_->get_stream().get_peer(true);
+	const char* ptr = stream_.get_peer(true);
 	if (*ptr == 0) {
 		logger_warn("get_peer return empty string");
 		return 0;
@@ -463,6 +519,14 @@ unsigned short HttpServletRequest::getRemotePort(void) const
 const char* HttpServletRequest::getParameter(const char* name,
 	bool case_sensitive /* = false */) const
 {
+	// the query is parsed by the parser when being accessed first time
+	if (lazyParams()) {
+		const char* value = parser_->get_param(name, case_sensitive);
+		if (value) {
+			return value;
+		}
+	}
+
 	std::vector<HTTP_PARAM*>::const_iterator cit = params_.begin();
 	if (case_sensitive) {
 		for (; cit != params_.end(); ++cit) {
@@ -489,6 +553,24 @@ const char* HttpServletRequest::getParameter(const char* name,
 	return node->get_value();
 }
 
+void HttpServletRequest::setPathParams(const char* const* names,
+	const char* const* values, size_t n)
+{
+	path_names_   = names;
+	path_values_  = values;
+	path_nparams_ = n;
+}
+
+const char* HttpServletRequest::getPathParam(const char* name) const
+{
+	for (size_t i = 0; i < path_nparams_; i++) {
+		if (strcmp(path_names_[i], name) == 0) {
+			return path_values_[i];
+		}
+	}
+	return NULL;
+}
+
 http_mime* HttpServletRequest::getHttpMime(void)
 {
 	return mime_;
@@ -604,9 +686,53 @@ xml* HttpServletRequest::getXml(size_t body_limit /* 1024000 */)
 	}
 }
 
+bool HttpServletRequest::isChunked(void) const
+{
+	if (parser_) {
+		return parser_->is_chunked();
+	}
+	if (client_ == NULL) {
+		return false;
+	}
+	const char* ptr = client_->header_value("Transfer-Encoding");
+	return ptr && acl_strcasestr(ptr, "chunked") != NULL;
+}
+
+int HttpServletRequest::readBody(char* buf, size_t size)
+{
+	if (parser_) {
+		return parser_->read_body(stream_, buf, size);
+	}
+	if (client_) {
+		return client_->read_body(buf, size);
+	}
+	logger_error("client_ NULL in CGI mode");
+	return -1;
+}
+
+bool HttpServletRequest::getChunkedBody(string& out, size_t body_limit)
+{
+	body_parsed_ = true;
+
+	char buf[8192];
+	int  ret;
+	while ((ret = readBody(buf, sizeof(buf))) > 0) {
+		if (body_limit > 0 && out.size() + ret > body_limit) {
+			logger_error("request body too large, limit=%d",
+				(int) body_limit);
+			return false;
+		}
+		out.append(buf, (size_t) ret);
+	}
+	return ret == 0 && !out.empty();
+}
+
 bool HttpServletRequest::getBody(string& out, size_t body_limit /* 1024000 */)
 {
 	acl_int64 dlen = (acl_int64) getContentLength();
+	if (dlen < 0 && isChunked()) {
+		return getChunkedBody(out, body_limit);
+	}
 	if (dlen <= 0 || dlen > (acl_int64) body_limit) {
 		return false;
 	}
@@ -641,12 +767,15 @@ string* HttpServletRequest::getBody(size_t body_limit /* 1024000*/)
 	}
 
 	acl_int64 dlen = (acl_int64) getContentLength();
-	if (dlen <= 0 || dlen > (acl_int64) body_limit) {
+	if (dlen < 0 && isChunked()) {
+		body_ = NEW string;
+	} else if (dlen <= 0 || dlen > (acl_int64) body_limit) {
 		return NULL;
+	} else {
+		body_ = NEW string((size_t) dlen + 1);
 	}
 
-	body_ = NEW string((size_t) dlen + 1);
-	if (getBody(*body_)) {
+	if (getBody(*body_, body_limit)) {
 		return body_;
 	} else {
 		delete body_;
@@ -670,6 +799,18 @@ socket_stream& HttpServletRequest::getSocketStream(void) const
 	return stream_;
 }
 
+bool HttpServletRequest::lazyParams(void) const
+{
+	if (parser_ == NULL) {
+		return false;
+	}
+
+	// the charset conversion needs the params copied by parseParameters
+	const char* requestCharset = getCharacterEncoding();
+	return localCharset_ == NULL || requestCharset == NULL
+		|| strcasecmp(requestCharset, localCharset_) == 0;
+}
+
 void HttpServletRequest::parseParameters(const char* str)
 {
 	const char* requestCharset = getCharacterEncoding();
@@ -786,6 +927,17 @@ bool HttpServletRequest::readHeader(string* method_s)
 		//  method Ա֤ method Ĺȷ
 		// 󷽷
 		method = acl_getenv("REQUEST_METHOD");
+	} else if (parser_) {
+		if (!parser_->read(stream_)) {
+			req_error_ = HTTP_REQ_ERR_IO;
+			return false;
+		}
+
+		method = parser_->get_method();
+		const char* ptr = parser_->header_value("Content-Type");
+		if (ptr && *ptr) {
+			content_type_.parse(ptr);
+		}
 	} else {
 		client_ = new (dbuf_->dbuf_alloc(sizeof(http_client)))
 			http_client(&stream_, false, true);
@@ -835,7 +987,7 @@ bool HttpServletRequest::readHeader(string* method_s)
 	}
 
 	const char* ptr = getQueryString();
-	if (ptr && *ptr) {
+	if (ptr && *ptr && !lazyParams()) {
 		parseParameters(ptr);
 	}
 
@@ -927,6 +1079,9 @@ const char* HttpServletRequest::getRequestReferer(void) const
 	if (cgi_mode_) {
 		return acl_getenv("HTTP_REFERER");
 	}
+	if (parser_) {
+		return parser_->header_value("Referer");
+	}
 	if (client_ == NULL) {
 		return NULL;
 	}
@@ -943,6 +1098,9 @@ const char* HttpServletRequest::getRemoteHost(void) const
 	if (cgi_mode_) {
 		return acl_getenv("HTTP_HOST");
 	}
+	if (parser_) {
+		return parser_->get_host();
+	}
 	if (client_ == NULL) {
 		return NULL;
 	}
@@ -954,6 +1112,9 @@ const char* HttpServletRequest::getUserAgent(void) const
 	if (cgi_mode_) {
 		return acl_getenv("HTTP_USER_AGENT");
 	}
+	if (parser_) {
+		return parser_->header_value("User-Agent");
+	}
 	if (client_ == NULL) {
 		return NULL;
 	}
@@ -970,6 +1131,9 @@ bool HttpServletRequest::isKeepAlive(void) const
 			return true;
 		}
 	}
+	if (parser_) {
+		return parser_->keep_alive();
+	}
 	if (client_ == NULL) {
 		return false;
 	}
@@ -982,10 +1146,14 @@ int HttpServletRequest::getKeepAlive(void) const
 		return -1;
 	}
 
-	if (client_ == NULL) {
+	const char* ptr;
+	if (parser_) {
+		ptr = parser_->header_value("Keep-Alive");
+	} else if (client_) {
+		ptr = client_->header_value("Keep-Alive");
+	} else {
 		return -1;
 	}
-	const char* ptr = client_->header_value("Keep-Alive");
 	if (ptr == NULL || *ptr == 0) {
 		return -1;
 	}
@@ -999,6 +1167,8 @@ void HttpServletRequest::getAcceptEncoding(std::vector<string>& out) const
 
 	if (cgi_mode_) {
 		ptr = acl_getenv("HTTP_ACCEPT_ENCODING");
+	} else if (parser_) {
+		ptr = parser_->header_value("Accept-Encoding");
 	} else if (client_) {
 		ptr = client_->header_value("Accept-Encoding");
 	} else {
@@ -1031,16 +1201,25 @@ http_request_error_t HttpServletRequest::getLastError(void) const
 http_client* HttpServletRequest::getClient(void) const
 {
 	if (client_ == NULL) {
-		logger_error("client_ NULL in CGI mode");
+		logger_error("client_ NULL in CGI mode or with the parser");
 	}
 	return client_;
 }
 
+void HttpServletRequest::setParser(http_request_parser* parser)
+{
+	parser_ = parser;
+}
+
 bool HttpServletRequest::getVersion(unsigned& major, unsigned& minor) const
 {
 	major = 0;
 	minor = 0;
 
+	if (parser_) {
+		parser_->get_version(major, minor);
+		return true;
+	}
 	if (client_ == NULL) {
 		return false;
 	}
@@ -1048,9 +1227,38 @@ bool HttpServletRequest::getVersion(unsigned& major, unsigned& minor) const
 	return client_->get_version(major, minor);
 }
 
+void HttpServletRequest::sprintHeader(string& out, const char* prompt) const
+{
+	if (prompt && *prompt) {
+		out.format_append("----------- in %s - (%s)-------\r\n",
+			__FUNCTION__, prompt);
+	}
+
+	unsigned major, minor;
+	parser_->get_version(major, minor);
+	out.format_append("%s %s HTTP/%u.%u\r\n", parser_->get_method(),
+		parser_->get_url(), major, minor);
+
+	const std::vector<http_request_parser::field>& headers =
+		parser_->get_headers();
+	for (std::vector<http_request_parser::field>::const_iterator
+		cit = headers.begin(); cit != headers.end(); ++cit) {
+
+		out.format_append("%s: %s\r\n", (*cit).name, (*cit).value);
+	}
+
+	if (prompt && *prompt) {
+		out.append("------------- end -------------\r\n");
+	}
+}
+
 void HttpServletRequest::fprint_header(ostream& out, const char* prompt)
 {
-	if (client_) {
+	if (parser_) {
+		string buf;
+		sprintHeader(buf, prompt);
+		out.write(buf);
+	} else if (client_) {
 		client_->fprint_header(out, prompt);
 	} else {
 		const char* ptr = acl_getenv_list();
@@ -1062,7 +1270,9 @@ void HttpServletRequest::fprint_header(ostream& out, const char* prompt)
 
 void HttpServletRequest::sprint_header(string& out, const char* prompt)
 {
-	if (client_) {
+	if (parser_) {
+		sprintHeader(out, prompt);
+	} else if (client_) {
 		client_->sprint_header(out, prompt);
 	} else {
 		const char* ptr = acl_getenv_list();
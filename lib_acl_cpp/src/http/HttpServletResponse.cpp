@@ -5,10 +5,14 @@
 #include "acl_cpp/stdlib/string.hpp"
 #include "acl_cpp/stdlib/xml.hpp"
 #include "acl_cpp/stdlib/json.hpp"
+#include "acl_cpp/stdlib/compress_codec.hpp"
+#include "acl_cpp/stdlib/compress_cache.hpp"
 #include "acl_cpp/stream/ostream.hpp"
+#include "acl_cpp/stream/fstream.hpp"
 #include "acl_cpp/stream/socket_stream.hpp"
 #include "acl_cpp/http/http_header.hpp"
 #include "acl_cpp/http/http_client.hpp"
+#include "acl_cpp/http/http_file_cache.hpp"
 #include "acl_cpp/http/HttpServletRequest.hpp"
 #include "acl_cpp/http/HttpServletResponse.hpp"
 #endif
@@ -31,7 +35,9 @@ HttpServletResponse::HttpServletResponse(socket_stream& stream)
 	header_->set_request_mode(false);
 	charset_[0] = 0;
 	safe_snprintf(content_type_, sizeof(content_type_), "text/html");
+	safe_snprintf(codecs_, sizeof(codecs_), "zstd, br, gzip");
 	head_sent_ = false;
+	batched_   = false;
 }
 
 HttpServletResponse::~HttpServletResponse(void)
@@ -85,6 +91,13 @@ HttpServletResponse& HttpServletResponse::setContentEncoding(bool gzip)
 	return *this;
 }
 
+HttpServletResponse& HttpServletResponse::setContentCodecs(const char* codecs)
+{
+	safe_snprintf(codecs_, sizeof(codecs_), "%s", codecs ? codecs : "");
+	header_->set_transfer_gzip(codecs_[0] != 0);
+	return *this;
+}
+
 HttpServletResponse& HttpServletResponse::setDateHeader(
 	const char* name, time_t value)
 {
@@ -169,23 +182,13 @@ bool HttpServletResponse::sendHeader(void)
 
 	header_->set_content_type(buf);
 
-	// ȻӦͷ gzip ѹʽ˲
-	// gzip ѹݣҪӦͷнֹ
+	// choose the codec accepted by the client, or send the body as it is
 	if (header_->is_transfer_gzip() && request_) {
-		bool accept_gzip = false;
-		std::vector<string> tokens;
-		request_->getAcceptEncoding(tokens);
-		std::vector<string>::const_iterator it;
-
-		for (it = tokens.begin(); it != tokens.end(); ++it) {
-			if ((*it).compare("gzip", false) == 0) {
-				accept_gzip = true;
-				break;
-			}
-		}
-
-		if (!accept_gzip) {
-			header_->set_transfer_gzip(false);
+		const char* codec = compress_codec::negotiate(
+			request_->getHeader("Accept-Encoding"), codecs_);
+		header_->set_content_codec(codec);
+		if (codec) {
+			header_->add_entry("Vary", "Accept-Encoding");
 		}
 	}
 
@@ -257,6 +260,195 @@ bool HttpServletResponse::write(const json& body, const char* charset /* utf-8 *
 	return write(buf.c_str(), buf.size()) && write(NULL, 0);
 }
 
+bool HttpServletResponse::sendFile(const char* path, bool range /* = true */)
+{
+	struct acl_stat sbuf;
+	fstream in;
+
+	if (acl_stat(path, &sbuf) == -1 || (sbuf.st_mode & S_IFMT) != S_IFREG
+		|| !in.open(path, O_RDONLY, 0600)) {
+
+		setStatus(404).setContentLength(0);
+		return sendHeader() && flush();
+	}
+
+	acl_int64 size = (acl_int64) sbuf.st_size;
+	char etag[64], mtime[64];
+#if defined(_WIN32) || defined(_WIN64)
+	safe_snprintf(etag, sizeof(etag), "\"%I64x-%I64x\"",
+		(acl_int64) sbuf.st_mtime, size);
+#else
+	safe_snprintf(etag, sizeof(etag), "\"%llx-%llx\"",
+		(acl_int64) sbuf.st_mtime, size);
+#endif
+	header_->date_format(mtime, sizeof(mtime), sbuf.st_mtime);
+
+	return sendFile(in, size, etag, mtime, range);
+}
+
+bool HttpServletResponse::sendFile(http_file_cache& cache, const char* path,
+	bool range /* = true */)
+{
+	http_file* file = cache.open(path);
+	if (file == NULL) {
+		setStatus(404).setContentLength(0);
+		return sendHeader() && flush();
+	}
+
+	bool ret = sendFile(file->get_fstream(), file->get_size(),
+		file->get_etag(), file->get_last_modified(), range);
+	file->release();
+	return ret;
+}
+
+// Parse the single range of "bytes=from-to", "bytes=from-" or "bytes=-suffix"
+// for the file of the size, returns 1 if the range is satisfiable, -1 if not
+// and 416 should be replied, 0 if it should be ignored, such as the multiple
+// ranges, and the whole file is sent.
+static int parse_range(const char* value, acl_int64 size,
+	acl_int64& from, acl_int64& to)
+{
+	if (value == NULL) {
+		return 0;
+	}
+	while (*value == ' ' || *value == '\t') {
+		value++;
+	}
+	if (strncasecmp(value, "bytes=", sizeof("bytes=") - 1) != 0) {
+		return 0;
+	}
+	value += sizeof("bytes=") - 1;
+	if (strchr(value, ',') != NULL) {
+		return 0;
+	}
+
+	const char* sep = strchr(value, '-');
+	if (sep == NULL) {
+		return 0;
+	}
+
+	const char* ptr;
+	for (ptr = value; ptr < sep; ptr++) {
+		if (*ptr < '0' || *ptr > '9') {
+			return 0;
+		}
+	}
+	for (ptr = sep + 1; *ptr && *ptr != ' ' && *ptr != '\t'; ptr++) {
+		if (*ptr < '0' || *ptr > '9') {
+			return 0;
+		}
+	}
+
+	// the last bytes of the suffix length
+	if (sep == value) {
+		if (sep[1] == 0) {
+			return 0;
+		}
+		acl_int64 suffix = acl_atoi64(sep + 1);
+		if (suffix <= 0 || size <= 0) {
+			return -1;
+		}
+		from = suffix < size ? size - suffix : 0;
+		to   = size - 1;
+		return 1;
+	}
+
+	from = acl_atoi64(value);
+	to   = sep[1] ? acl_atoi64(sep + 1) : size - 1;
+	if (from >= size || to < from) {
+		return -1;
+	}
+	if (to >= size) {
+		to = size - 1;
+	}
+	return 1;
+}
+
+bool HttpServletResponse::sendFile(fstream& in, acl_int64 size,
+	const char* etag, const char* mtime, bool range)
+{
+	header_->add_entry("ETag", etag);
+	header_->add_entry("Last-Modified", mtime);
+	header_->add_entry("Accept-Ranges", "bytes");
+
+	// the body is sent as it is, so gzip and chunked are both disabled
+	header_->set_transfer_gzip(false);
+	header_->set_chunked(false);
+
+	const char* tags = request_ ? request_->getHeader("If-None-Match") : NULL;
+	if (tags && (strcmp(tags, "*") == 0 || strstr(tags, etag) != NULL)) {
+		setStatus(304).setContentLength(0);
+		return sendHeader() && flush();
+	}
+
+	char buf[64];
+	acl_int64 from = 0, to = size - 1;
+	int ret = range && request_ ? parse_range(
+		request_->getHeader("Range"), size, from, to) : 0;
+	if (ret < 0) {
+#if defined(_WIN32) || defined(_WIN64)
+		safe_snprintf(buf, sizeof(buf), "bytes */%I64d", size);
+#else
+		safe_snprintf(buf, sizeof(buf), "bytes */%lld", size);
+#endif
+		header_->add_entry("Content-Range", buf);
+		setStatus(416).setContentLength(0);
+		return sendHeader() && flush();
+	} else if (ret > 0) {
+		setStatus(206).setRange(from, to, size);
+	} else {
+		from = 0;
+		to   = size - 1;
+	}
+
+	setContentLength(to - from + 1);
+	if (!sendHeader()) {
+		return false;
+	}
+
+	if (request_ && request_->getMethod() == HTTP_METHOD_HEAD) {
+		return flush();
+	}
+	if (to < from) {
+		return flush();
+	}
+	return stream_.send_file(in, from, to - from + 1) == to - from + 1;
+}
+
+bool HttpServletResponse::sendCompressed(compress_cache& cache,
+	const char* key, const void* data, size_t len)
+{
+	const char* codec = request_ ? compress_codec::negotiate(
+		request_->getHeader("Accept-Encoding"), codecs_) : NULL;
+
+	// the body is sent as it is, so gzip and chunked are both disabled
+	header_->set_transfer_gzip(false);
+	header_->set_chunked(false);
+	header_->add_entry("Vary", "Accept-Encoding");
+
+	compress_variant* variant = codec
+		? cache.get(key, codec, data, len) : NULL;
+	if (variant) {
+		header_->add_entry("Content-Encoding", variant->get_codec());
+		data = variant->get_data().c_str();
+		len  = variant->get_data().size();
+	}
+
+	setContentLength(len);
+
+	bool ret;
+	if (request_ && request_->getMethod() == HTTP_METHOD_HEAD) {
+		ret = sendHeader() && flush();
+	} else {
+		ret = write(data, len);
+	}
+
+	if (variant) {
+		variant->release();
+	}
+	return ret;
+}
+
 void HttpServletResponse::encodeUrl(string& out, const char* url)
 {
 	out.clear();
@@ -278,6 +470,18 @@ void HttpServletResponse::setHttpServletRequest(HttpServletRequest* request)
 	request_ = request;
 }
 
+void HttpServletResponse::setBatched(bool yes)
+{
+	batched_ = yes;
+	client_->set_buffed(yes);
+}
+
+bool HttpServletResponse::flush(void)
+{
+	// the batched response is sent with the next ones
+	return batched_ ? true : stream_.fflush();
+}
+
 } // namespace acl
 
 #endif // ACL_CLIENT_ONLY
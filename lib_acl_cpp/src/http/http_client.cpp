@@ -1,18 +1,12 @@
 #include "acl_stdafx.hpp"
 
-#ifndef COSMOCC
-# if defined(_WIN32) || defined(_WIN64)
-#  include "zlib-1.2.11/zlib.h"
-# else
-#  include <zlib.h>
-# endif
-#endif
-
 #ifndef ACL_PREPARE_COMPILE
 #include "acl_cpp/stdlib/log.hpp"
 #include "acl_cpp/stdlib/snprintf.hpp"
 #include "acl_cpp/stdlib/zlib_stream.hpp"
+#include "acl_cpp/stdlib/compress_codec.hpp"
 #include "acl_cpp/stream/ostream.hpp"
+#include "acl_cpp/stream/gather_buf.hpp"
 #include "acl_cpp/stream/socket_stream.hpp"
 #include "acl_cpp/http/http_header.hpp"
 #include "acl_cpp/http/http_client.hpp"
@@ -36,9 +30,10 @@ http_client::http_client(void)
 , body_finish_(false)
 , disconnected_(true)
 , chunked_transfer_(false)
-, gzip_crc32_(0)
-, gzip_total_in_(0)
+, buffed_(false)
+, codec_(NULL)
 , buf_(NULL)
+, gbuf_(NULL)
 {
 }
 
@@ -57,9 +52,10 @@ http_client::http_client(socket_stream* client, bool is_request /* = false */,
 , body_finish_(false)
 , disconnected_(false)
 , chunked_transfer_(false)
-, gzip_crc32_(0)
-, gzip_total_in_(0)
+, buffed_(false)
+, codec_(NULL)
 , buf_(NULL)
+, gbuf_(NULL)
 {
 }
 
@@ -70,6 +66,7 @@ http_client::~http_client(void)
 		delete stream_;
 	}
 	delete buf_;
+	delete gbuf_;
 }
 
 void http_client::reset(void)
@@ -77,6 +74,9 @@ void http_client::reset(void)
 	if (buf_) {
 		buf_->clear();
 	}
+	if (gbuf_) {
+		gbuf_->clear();
+	}
 
 	if (res_) {
 		// ˵ǳӵĵڶҪϴ
@@ -107,12 +107,14 @@ void http_client::reset(void)
 	delete zstream_;
 	zstream_ = NULL;
 
+	// the codec is reset when it's used again
+	compress_codec::put(codec_);
+	codec_ = NULL;
+
 	last_ret_         = -1;
 	head_sent_        = false;
 	body_finish_      = false;
 	chunked_transfer_ = false;
-	gzip_crc32_       = 0;
-	gzip_total_in_    = 0;
 }
 
 bool http_client::open(const char* addr, int conn_timeout /* = 60 */,
@@ -142,56 +144,30 @@ bool http_client::open(const char* addr, int conn_timeout /* = 60 */,
 
 //////////////////////////////////////////////////////////////////////////////
 
-bool http_client::write_chunk(ostream& out, const void* data, size_t len)
+gather_buf& http_client::get_gather(void)
 {
-#ifndef HAS_IOV
-# define HAS_IOV
-#endif
-
-#ifdef HAS_IOV
-	struct iovec iov[3];
-
-	char hdr[32];
-	safe_snprintf(hdr, sizeof(hdr), "%x\r\n", (int) len);
-
-#ifdef MINGW
-	iov[0].iov_base = hdr;
-#else
-	iov[0].iov_base = (void*) hdr;
-#endif
-	iov[0].iov_len  = strlen(hdr);
-
-#ifdef MINGW
-	iov[1].iov_base = (char*) data;
-#else
-	iov[1].iov_base = (void*) data;
-#endif
-	iov[1].iov_len  = (int) len;
-
-#ifdef MINGW
-	iov[2].iov_base = (char*) "\r\n";
-#else
-	iov[2].iov_base = (void*) "\r\n";
-#endif
-	iov[2].iov_len  = 2;
-
-	if (out.writev(iov, 3) == -1) {
-		disconnected_ = true;
-		return false;
-	} else {
-		return true;
+	if (gbuf_ == NULL) {
+		gbuf_ = NEW gather_buf(4);
 	}
-#else
-	if (out.format("%x\r\n", (int) len) == -1
-		|| out.write(data, len) == -1
-		|| out.write("\r\n", 2) == -1) {
+	return *gbuf_;
+}
 
+bool http_client::write_chunk(ostream& out, const void* data, size_t len)
+{
+	// the chunk is sent in one writev together with the HTTP header
+	// buffered if any, and the data isn't copied
+	gather_buf& buf = get_gather();
+	buf.format("%x\r\n", (unsigned) len);
+	buf.add(data, len);
+	buf.copy("\r\n", 2);
+
+	if (out.sendv(buf) == -1) {
+		buf.clear();
 		disconnected_ = true;
 		return false;
 	} else {
 		return true;
 	}
-#endif
 }
 
 bool http_client::write_chunk_trailer(ostream& out)
@@ -206,9 +182,9 @@ bool http_client::write_chunk_trailer(ostream& out)
 	}
 }
 
-bool http_client::write_gzip(ostream& out, const void* data, size_t len)
+bool http_client::write_compress(ostream& out, const void* data, size_t len)
 {
-	acl_assert(zstream_);
+	acl_assert(codec_);
 
 	if (buf_ == NULL) {
 		buf_ = NEW string(4096);
@@ -216,120 +192,37 @@ bool http_client::write_gzip(ostream& out, const void* data, size_t len)
 		buf_->clear();
 	}
 
-	// ѹ
+	bool ok;
 	if (data && len > 0) {
-		// ӷѹܳ
-		gzip_total_in_ += (unsigned int) len;
-
-		//  crc32 У
-		gzip_crc32_ = zstream_->crc32_update(gzip_crc32_, data, len);
-
-		// Ըöݽѹ
-		if (!zstream_->zip_update((const char*) data, (int) len, buf_)) {
-			logger_error("zip_update error!");
-			return false;
-		}
-
-		// Ϊգֱӷأȴ´εд
-		if (buf_->empty()) {
-			return true;
-		}
-
-		data = buf_->c_str();
-		len  = buf_->size();
-	}
-
-	// д zstream ܻݣͬʱѹ
-	else {
-		// ݳЧ
-		unsigned total_in = (unsigned) zstream_->get_zstream()->total_in;
-		if (total_in != gzip_total_in_) {
-			logger_warn("total_in: %d != gzip_total_in_: %d",
-				total_in, gzip_total_in_);
-		}
-
-		if (!zstream_->zip_finish(buf_)) {
-			logger_error("zip_finish error!");
-			return false;
-		}
-
-		if (buf_->empty()) {
-			return true;
-		}
+		ok = codec_->update(data, len, buf_);
+	} else {
+		ok = codec_->finish(buf_);
 
-		data = buf_->c_str();
-		len  = buf_->size();
+		// the codec can be used by the other connections now
+		compress_codec::put(codec_);
+		codec_ = NULL;
 	}
 
-	// 鴫䷽ʽѹ
-	if (chunked_transfer_) {
-		if (write_chunk(out, data, len)) {
-			return true;
-		}
-		// дҪǿƽzipѹ
-		if (!zstream_->zip_finished()) {
-			(void) zstream_->zip_finish(buf_);
-		}
+	if (!ok) {
+		logger_error("compress error!");
 		return false;
 	}
 
-	// ͨʽʽѹ
-	if (out.write(data, len, true, true) < 0 || !out.fflush()) {
-		if (!zstream_->zip_finished()) {
-			(void) zstream_->zip_finish(buf_);
-		}
-		disconnected_ = true;
-		return false;
+	// the data may be buffered by the codec
+	if (buf_->empty()) {
+		return true;
 	}
 
-	return true;
-}
-
-//  gzip β
-
-bool http_client::write_gzip_trailer(ostream& out)
-{
-#ifdef HAVE_BIG_ENDIAN
-	struct gztrailer {
-		unsigned char crc32_[4];
-		unsigned char zlen_[4];
-	};
-	struct gztrailer trailer;
-
-	trailer.crc32_[0] = (u_char) (gzip_crc32_ & 0xff);
-	trailer.crc32_[1] = (u_char) ((gzip_crc32_ >> 8) & 0xff);
-	trailer.crc32_[2] = (u_char) ((gzip_crc32_ >> 16) & 0xff);
-	trailer.crc32_[3] = (u_char) ((gzip_crc32_ >> 24) & 0xff);
-
-	trailer.zlen_[0]  = (u_char) (gzip_total_in_ & 0xff);
-	trailer.zlen_[1]  = (u_char) ((gzip_total_in_ >> 8) & 0xff);
-	trailer.zlen_[2]  = (u_char) ((gzip_total_in_ >> 16) & 0xff);
-	trailer.zlen_[3]  = (u_char) ((gzip_total_in_ >> 24) & 0xff);
-#else
-	struct gztrailer {
-		unsigned int crc32_;
-		unsigned int zlen_;
-	};
-
-	struct gztrailer trailer;
-	trailer.crc32_ = gzip_crc32_;
-	trailer.zlen_  = gzip_total_in_;
-
-#endif // HAVE_BIG_ENDIAN
-
-	// 鴫䷽ʽ gzip β
 	if (chunked_transfer_) {
-		return write_chunk(out, &trailer, sizeof(trailer))
-			&& write_chunk_trailer(out);
+		return write_chunk(out, buf_->c_str(), buf_->size());
 	}
 
-	// ͨʽ gzip β
-	if (out.write(&trailer, sizeof(trailer)) < 0) {
+	if (out.write(buf_->c_str(), buf_->size(), true, true) < 0
+		|| !out.fflush()) {
 		disconnected_ = true;
 		return false;
-	} else {
-		return true;
 	}
+	return true;
 }
 
 bool http_client::write_head(const http_header& header)
@@ -343,25 +236,21 @@ bool http_client::write_head(const http_header& header)
 	chunked_transfer_ = header.chunked_transfer();
 
 	// Ӧʱ gzip ䷽ʽҪȳʼ zlib 
-	if (header.is_transfer_gzip()) {
-		delete zstream_;
-		zstream_ = NEW zlib_stream;
-		if (zstream_->zip_begin(zlib_default, -zlib_wbits_15,
-			zlib_mlevel_9)) {
-			// ʼ crc32 У
-			gzip_crc32_ = zstream_->crc32_update(0, Z_NULL, 0);
-		} else {
-			logger_error("zip_begin error!");
-			delete zstream_;
-			zstream_ = NULL;
-
-			// ʼ zip ʧܣǿתɷ zip ģʽ
+	const char* codec = header.get_content_codec();
+	if (codec) {
+		// the codec got from the pool of the thread is reused, so the
+		// big compression context needn't be allocated each time
+		compress_codec::put(codec_);
+		codec_ = compress_codec::get(codec);
+		if (codec_ == NULL || !codec_->begin()) {
+			logger_error("begin compressing with %s error!", codec);
+			compress_codec::put(codec_);
+			codec_ = NULL;
+
+			// send the body without compressing
 			const_cast<http_header*>
-				(&header)->set_transfer_gzip(false);
+				(&header)->set_content_codec(NULL);
 		}
-
-		// ʼѹܳ
-		gzip_total_in_ = 0;
 	}
 
 	//  HTTP /Ӧͷ
@@ -376,42 +265,12 @@ bool http_client::write_head(const http_header& header)
 
 	// д HTTP ͷ
 	if (out.write(buf.c_str(), buf.length(), true,
-		header.get_content_length() > 0) < 0) {
+		buffed_ || header.get_content_length() > 0) < 0) {
 
 		disconnected_ = true;
 		return false;
-	} else if (zstream_ == NULL) {
-		return true;
-	}
-
-	// ǲ gzip ѹʽҪ gzip ͷ
-
-	/**
-	 * RFC 1952 Section 2.3 defines the gzip header:
-	 * +---+---+---+---+---+---+---+---+---+---+
-	 * |ID1|ID2|CM |FLG|     MTIME     |XFL|OS |
-	 * +---+---+---+---+---+---+---+---+---+---+
-	 * Unix OS_CODE: 3
-	 */
-	static const unsigned char gzheader[10] =
-		{ 0x1f, 0x8b, Z_DEFLATED, 0, 0, 0, 0, 0, 0, 3 };
-
-	if (chunked_transfer_) {
-		// 鴫䷽ʽд
-		if (!write_chunk(out, gzheader, sizeof(gzheader))) {
-			return false;
-		} else {
-			return true;
-		}
-	}
-
-	// ͨʽд
-	else if (out.write(gzheader, sizeof(gzheader), true, true) < 0) {
-		disconnected_ = true;
-		return false;
-	} else {
-		return true;
 	}
+	return true;
 }
 
 bool http_client::write_body(const void* data, size_t len)
@@ -419,18 +278,16 @@ bool http_client::write_body(const void* data, size_t len)
 	ostream& out = get_ostream();
 
 	//  gzip 䣬ѹд
-	if (zstream_ != NULL) {
-		// ѹ
-		if (!write_gzip(out, data, len)) {
+	if (codec_ != NULL) {
+		if (!write_compress(out, data, len)) {
 			return false;
 		}
 
-		// ϣ gzip βֶ
-		if (data == NULL || len == 0) {
-			return write_gzip_trailer(out);
-		} else {
-			return true;
+		// the compressed data left has been written as the last chunk
+		if ((data == NULL || len == 0) && chunked_transfer_) {
+			return write_chunk_trailer(out);
 		}
+		return true;
 	}
 
 	// ѹʽ
@@ -450,7 +307,20 @@ bool http_client::write_body(const void* data, size_t len)
 	}
 
 	// ͨʽд
-	else if (out.write(data, len, true, true) == -1 || !out.fflush()) {
+	if (buffed_) {
+		if (out.write(data, len, true, true) < 0) {
+			disconnected_ = true;
+			return false;
+		}
+		return true;
+	}
+
+	// the HTTP header buffered and the body are sent in one writev
+	gather_buf& buf = get_gather();
+	buf.add(data, len);
+
+	if (out.sendv(buf) == -1) {
+		buf.clear();
 		disconnected_ = true;
 		return false;
 	} else {
@@ -458,6 +328,11 @@ bool http_client::write_body(const void* data, size_t len)
 	}
 }
 
+void http_client::set_buffed(bool yes)
+{
+	buffed_ = yes;
+}
+
 //////////////////////////////////////////////////////////////////////////////
 
 ostream& http_client::get_ostream(void) const
@@ -1,10 +1,14 @@
 #include "acl_stdafx.hpp"
 #ifndef ACL_PREPARE_COMPILE
 #include "acl_cpp/stdlib/log.hpp"
+#include "acl_cpp/stdlib/util.hpp"
 #include "acl_cpp/http/http_utils.hpp"
 #include "acl_cpp/http/http_request.hpp"
 #include "acl_cpp/http/http_client.hpp"
+#include "acl_cpp/http/http_header.hpp"
 #include "acl_cpp/http/http_download.hpp"
+#include "acl_cpp/stdlib/thread.hpp"
+#include "acl_cpp/stream/fstream.hpp"
 #endif
 
 namespace acl
@@ -103,6 +107,10 @@ bool http_download::on_length(long long int)
 	return true;
 }
 
+void http_download::on_segment(http_header&)
+{
+}
+
 bool http_download::get(acl_int64 from /* = -1 */, acl_int64 to /* = -1 */,
 	const char* body /* = NULL */, size_t len /* = 0 */)
 {
@@ -229,4 +237,240 @@ bool http_download::save(http_request* req)
 	return true;
 }
 
+//////////////////////////////////////////////////////////////////////////
+
+// One range of the file downloaded by get_segments(), which has its own
+// connection and file handle, and writes the data at the offset of the
+// range directly; to_ < 0 means the whole file without range.
+
+class http_segment : public thread
+{
+public:
+	http_segment(http_download& dl, const char* filepath,
+		acl_int64 from, acl_int64 to, int max_retry)
+	: dl_(dl)
+	, filepath_(filepath)
+	, from_(from)
+	, to_(to)
+	, max_retry_(max_retry)
+	, ok_(false)
+	{
+	}
+
+	~http_segment(void) {}
+
+	bool download(void)
+	{
+		if (!fp_.open(filepath_, O_RDWR, 0600)) {
+			logger_error("open %s error %s", filepath_, last_serror());
+			return false;
+		}
+
+		acl_int64 off = from_;
+		for (int i = 0; i <= max_retry_; i++) {
+			// the whole file can't be resumed without range
+			if (to_ < 0) {
+				off = 0;
+			}
+			if (i > 0) {
+				logger_warn("retry %d, url: %s, range: %lld-%lld",
+					i, dl_.url_, off, to_);
+			}
+			if (fetch(off)) {
+				ok_ = true;
+				break;
+			}
+		}
+		fp_.close();
+		return ok_;
+	}
+
+	bool ok(void) const
+	{
+		return ok_;
+	}
+
+protected:
+	// @override
+	void* run(void)
+	{
+		download();
+		return NULL;
+	}
+
+private:
+	http_download& dl_;
+	const char* filepath_;
+	acl_int64 from_;
+	acl_int64 to_;
+	int  max_retry_;
+	bool ok_;
+	fstream fp_;
+
+	// off is updated with the data written, so the next retry can go on
+	bool fetch(acl_int64& off)
+	{
+		// the data is saved as it is, so don't unzip it
+		http_request req(dl_.addr_, 60, 60, false);
+		http_header& hdr = req.request_header();
+		hdr.set_url(dl_.url_).set_host(dl_.addr_).accept_gzip(false);
+		if (to_ >= 0) {
+			hdr.set_range(off, to_);
+		}
+		dl_.on_segment(hdr);
+
+		if (!req.request(NULL, 0)) {
+			logger_error("send request error, url: %s", dl_.url_);
+			return false;
+		}
+
+		if (to_ >= 0 && (!req.support_range()
+			|| req.get_range_from() != off)) {
+
+			logger_error("range %lld-%lld not supported, url: %s",
+				off, to_, dl_.url_);
+			return false;
+		}
+
+		char buf[8192];
+		int  ret = 0;
+		while (to_ < 0 || off <= to_) {
+			ret = req.read_body(buf, sizeof(buf));
+			if (ret <= 0) {
+				break;
+			}
+			if (to_ >= 0 && off + ret > to_ + 1) {
+				ret = (int) (to_ + 1 - off);
+			}
+			if (!write_at(buf, (size_t) ret, off)) {
+				return false;
+			}
+			off += ret;
+		}
+
+		if (to_ >= 0) {
+			return off > to_;
+		}
+		// body_finish() is also set by the error, and 0 is returned only
+		// when the whole body has been read
+		return ret == 0;
+	}
+
+	bool write_at(const char* data, size_t len, acl_int64 off)
+	{
+#ifdef ACL_UNIX
+		while (len > 0) {
+			ssize_t ret = pwrite(fp_.file_handle(), data, len, off);
+			if (ret < 0) {
+				if (errno == EINTR) {
+					continue;
+				}
+				logger_error("pwrite %s error %s",
+					filepath_, last_serror());
+				return false;
+			}
+			data += ret;
+			len  -= ret;
+			off  += ret;
+		}
+		return true;
+#else
+		if (fp_.fseek(off, SEEK_SET) != off
+			|| fp_.write(data, len) != (int) len) {
+
+			logger_error("write %s error %s", filepath_, last_serror());
+			return false;
+		}
+		return true;
+#endif
+	}
+};
+
+bool http_download::get_segments(const char* filepath, int nsegs /* = 4 */,
+	acl_int64 min_seg /* = 1024 * 1024 */, int max_retry /* = 3 */)
+{
+	if (url_ == NULL) {
+		logger_error("no valid url");
+		return false;
+	}
+	if (nsegs <= 0) {
+		nsegs = 1;
+	}
+	if (min_seg <= 0) {
+		min_seg = 1;
+	}
+
+	// probe the length and the range support with the first byte
+	acl_int64 length = -1;
+	{
+		http_request req(addr_, 60, 60, false);
+		http_header& hdr = req.request_header();
+		hdr.set_url(url_).set_host(addr_).accept_gzip(false)
+			.set_range(0, 0);
+		on_segment(hdr);
+
+		if (!req.request(NULL, 0)) {
+			logger_error("send request error, url: %s", url_);
+			return false;
+		}
+		if (req.support_range()) {
+			length = req.get_range_max();
+		}
+	}
+
+	fstream fp;
+	if (!fp.open_trunc(filepath)) {
+		logger_error("open %s error %s", filepath, last_serror());
+		return false;
+	}
+
+	if (length <= 0) {
+		fp.close();
+		http_segment seg(*this, filepath, 0, -1, max_retry);
+		return seg.download();
+	}
+
+	// let the segments write at any offset of the file
+	if (!fp.ftruncate(length)) {
+		logger_error("ftruncate %s error %s", filepath, last_serror());
+		return false;
+	}
+	fp.close();
+
+	acl_int64 size = (length + nsegs - 1) / nsegs;
+	if (size < min_seg) {
+		size = min_seg;
+	}
+
+	std::vector<http_segment*> segs;
+	for (acl_int64 from = 0; from < length; from += size) {
+		acl_int64 to = from + size - 1;
+		if (to >= length) {
+			to = length - 1;
+		}
+		http_segment* seg = NEW http_segment(*this, filepath,
+			from, to, max_retry);
+		segs.push_back(seg);
+	}
+
+	// the first segment is downloaded in the current thread
+	for (size_t i = 1; i < segs.size(); i++) {
+		segs[i]->set_detachable(false);
+		segs[i]->start();
+	}
+	segs[0]->download();
+
+	bool ok = true;
+	for (size_t i = 0; i < segs.size(); i++) {
+		if (i > 0) {
+			segs[i]->wait();
+		}
+		if (!segs[i]->ok()) {
+			ok = false;
+		}
+		delete segs[i];
+	}
+	return ok;
+}
+
 } // namespace acl
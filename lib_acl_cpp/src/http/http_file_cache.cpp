@@ -0,0 +1,319 @@
+#include "acl_stdafx.hpp"
+#ifndef ACL_PREPARE_COMPILE
+#include "acl_cpp/stdlib/log.hpp"
+#include "acl_cpp/stdlib/snprintf.hpp"
+#include "acl_cpp/http/http_file_cache.hpp"
+#endif
+
+#ifdef ACL_LINUX
+#include <sys/inotify.h>
+#include <sys/ioctl.h>
+#endif
+
+#ifndef ACL_CLIENT_ONLY
+
+#ifdef ACL_LINUX
+#define WATCH_MASK	(IN_MODIFY | IN_ATTRIB | IN_MOVE_SELF | IN_DELETE_SELF)
+#endif
+
+namespace acl {
+
+http_file::http_file(const char* path)
+: path_(path)
+, size_(0)
+, mtime_(0)
+, ino_(0)
+, checked_(0)
+, wd_(-1)
+{
+	etag_[0] = 0;
+	last_modified_[0] = 0;
+}
+
+http_file::~http_file(void)
+{
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+http_file_cache::http_file_cache(size_t max /* = 1024 */, int ttl /* = 5 */)
+: max_(max > 0 ? max : 1)
+, ttl_(ttl)
+, inotify_fd_(-1)
+, drained_(0)
+{
+}
+
+http_file_cache::~http_file_cache(void)
+{
+	clear();
+#ifdef ACL_LINUX
+	if (inotify_fd_ >= 0) {
+		::close(inotify_fd_);
+	}
+#endif
+}
+
+bool http_file_cache::use_inotify(bool on)
+{
+#ifdef ACL_LINUX
+	if (on && inotify_fd_ < 0) {
+		inotify_fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+		if (inotify_fd_ < 0) {
+			logger_error("inotify_init1 error %s", last_serror());
+			return false;
+		}
+	} else if (!on && inotify_fd_ >= 0) {
+		// the watches are removed when the inotify fd is closed
+		clear();
+		::close(inotify_fd_);
+		inotify_fd_ = -1;
+	}
+	return true;
+#else
+	(void) on;
+	logger_error("inotify not supported");
+	return false;
+#endif
+}
+
+http_file* http_file_cache::hit(http_file* file)
+{
+	lru_.splice(lru_.begin(), lru_, file->lru_);
+	file->hold();
+	++hits_;
+	return file;
+}
+
+void http_file_cache::unlink(http_file* file)
+{
+	files_.erase(file->path_);
+	lru_.erase(file->lru_);
+
+	if (file->wd_ < 0) {
+		return;
+	}
+
+	// the hard links of one file share the same watch descriptor
+	typedef std::multimap<int, http_file*>::iterator iter_t;
+	std::pair<iter_t, iter_t> range = watches_.equal_range(file->wd_);
+	for (iter_t it = range.first; it != range.second; ++it) {
+		if (it->second == file) {
+			watches_.erase(it);
+			break;
+		}
+	}
+
+#ifdef ACL_LINUX
+	if (inotify_fd_ >= 0 && watches_.find(file->wd_) == watches_.end()) {
+		inotify_rm_watch(inotify_fd_, file->wd_);
+	}
+#endif
+}
+
+void http_file_cache::drain(time_t now)
+{
+#ifdef ACL_LINUX
+	// drain the events at most once a second by only one caller, and the
+	// read is called only when there're events, so it won't be blocked
+	// even if hooked by lib_fiber
+	if (inotify_fd_ < 0 || now == drained_ || draining_.cas(0, 1) != 0) {
+		return;
+	}
+	drained_ = now;
+
+	std::vector<int> wds;
+	char buf[4096];
+	int  n;
+
+	while (ioctl(inotify_fd_, FIONREAD, &n) == 0 && n > 0) {
+		ssize_t ret = ::read(inotify_fd_, buf, sizeof(buf));
+		if (ret <= 0) {
+			break;
+		}
+
+		for (char* ptr = buf; ptr < buf + ret;) {
+			struct inotify_event* ev = (struct inotify_event*) ptr;
+			wds.push_back(ev->wd);
+			ptr += sizeof(struct inotify_event) + ev->len;
+		}
+	}
+
+	draining_ = 0;
+
+	if (wds.empty()) {
+		return;
+	}
+
+	std::vector<http_file*> olds;
+
+	lock_.lock();
+	for (std::vector<int>::const_iterator cit = wds.begin();
+		cit != wds.end(); ++cit) {
+
+		std::multimap<int, http_file*>::iterator it;
+		while ((it = watches_.find(*cit)) != watches_.end()) {
+			olds.push_back(it->second);
+			unlink(it->second);
+		}
+	}
+	lock_.unlock();
+
+	for (std::vector<http_file*>::iterator it = olds.begin();
+		it != olds.end(); ++it) {
+		(*it)->release();
+	}
+#else
+	(void) now;
+#endif
+}
+
+http_file* http_file_cache::open(const char* path)
+{
+	time_t now = time(NULL);
+	drain(now);
+
+	lock_.lock();
+	std::map<string, http_file*>::iterator it = files_.find(path);
+	if (it != files_.end() && now - it->second->checked_ < ttl_) {
+		http_file* file = hit(it->second);
+		lock_.unlock();
+		return file;
+	}
+	lock_.unlock();
+
+	// the system APIs may be hooked in fiber mode, so the lock mustn't
+	// be held when calling them
+	struct acl_stat sbuf;
+	if (acl_stat(path, &sbuf) == -1 || (sbuf.st_mode & S_IFMT) != S_IFREG) {
+		invalidate(path);
+		return NULL;
+	}
+
+	lock_.lock();
+	it = files_.find(path);
+	if (it != files_.end() && it->second->size_ == (long long) sbuf.st_size
+		&& it->second->mtime_ == sbuf.st_mtime
+		&& it->second->ino_ == (long long) sbuf.st_ino) {
+
+		it->second->checked_ = now;
+		http_file* file = hit(it->second);
+		lock_.unlock();
+		return file;
+	}
+	lock_.unlock();
+
+	++misses_;
+
+	http_file* file = NEW http_file(path);
+	if (!file->fp_.open(path, O_RDONLY, 0600)
+		|| acl_fstat(file->fp_.file_handle(), &sbuf) == -1) {
+
+		logger_error("open %s error %s", path, last_serror());
+		file->release();
+		return NULL;
+	}
+
+	file->size_    = (long long) sbuf.st_size;
+	file->mtime_   = sbuf.st_mtime;
+	file->ino_     = (long long) sbuf.st_ino;
+	file->checked_ = now;
+
+#if defined(_WIN32) || defined(_WIN64)
+	safe_snprintf(file->etag_, sizeof(file->etag_), "\"%I64x-%I64x\"",
+		(long long) file->mtime_, file->size_);
+#else
+	safe_snprintf(file->etag_, sizeof(file->etag_), "\"%llx-%llx\"",
+		(long long) file->mtime_, file->size_);
+#endif
+	http_mkrfc1123(file->last_modified_, sizeof(file->last_modified_),
+		file->mtime_);
+
+#ifdef ACL_LINUX
+	if (inotify_fd_ >= 0) {
+		file->wd_ = inotify_add_watch(inotify_fd_, path, WATCH_MASK);
+	}
+#endif
+
+	std::vector<http_file*> olds;
+
+	lock_.lock();
+	it = files_.find(path);
+	if (it != files_.end()) {
+		olds.push_back(it->second);
+		unlink(it->second);
+	}
+
+	files_[path] = file;
+	lru_.push_front(file);
+	file->lru_ = lru_.begin();
+	if (file->wd_ >= 0) {
+		watches_.insert(std::make_pair(file->wd_, file));
+	}
+
+	while (files_.size() > max_) {
+		http_file* last = lru_.back();
+		olds.push_back(last);
+		unlink(last);
+	}
+
+	// one for the cache and one for the caller
+	file->hold();
+	lock_.unlock();
+
+	for (std::vector<http_file*>::iterator cit = olds.begin();
+		cit != olds.end(); ++cit) {
+		(*cit)->release();
+	}
+	return file;
+}
+
+void http_file_cache::invalidate(const char* path)
+{
+	http_file* file = NULL;
+
+	lock_.lock();
+	std::map<string, http_file*>::iterator it = files_.find(path);
+	if (it != files_.end()) {
+		file = it->second;
+		unlink(file);
+	}
+	lock_.unlock();
+
+	if (file) {
+		file->release();
+	}
+}
+
+void http_file_cache::clear(void)
+{
+	std::list<http_file*> olds;
+
+	lock_.lock();
+	olds.swap(lru_);
+	files_.clear();
+	watches_.clear();
+	lock_.unlock();
+
+	for (std::list<http_file*>::iterator it = olds.begin();
+		it != olds.end(); ++it) {
+#ifdef ACL_LINUX
+		if (inotify_fd_ >= 0 && (*it)->wd_ >= 0) {
+			inotify_rm_watch(inotify_fd_, (*it)->wd_);
+		}
+#endif
+		(*it)->release();
+	}
+}
+
+size_t http_file_cache::size(void)
+{
+	lock_.lock();
+	size_t n = files_.size();
+	lock_.unlock();
+	return n;
+}
+
+} // namespace acl
+
+#endif // ACL_CLIENT_ONLY
@@ -87,6 +87,7 @@ http_header::http_header(const HTTP_HDR_RES& hdr_res, dbuf_guard* dbuf /* = NULL
 	content_length_   = hdr_res.hdr.content_length;
 	chunked_transfer_ = hdr_res.hdr.chunked ? true : false;
 	transfer_gzip_    = false;
+	content_codec_[0] = 0;
 
 	if (http_hdr_res_range(&hdr_res, &range_from_,
 		&range_to_, &range_total_) == -1) {
@@ -151,6 +152,7 @@ http_header::http_header(const HTTP_HDR_REQ& hdr_req, dbuf_guard* dbuf /* = NULL
 	content_length_   = hdr_req.hdr.content_length;
 	chunked_transfer_ = hdr_req.hdr.chunked ? true : false;
 	transfer_gzip_    = false;
+	content_codec_[0] = 0;
 
 	if (http_hdr_req_range(&hdr_req, &range_from_, &range_to_) == -1) {
 		range_from_ = -1;
@@ -230,6 +232,7 @@ void http_header::init(void)
 	content_length_   = -1;
 	chunked_transfer_ = false;
 	transfer_gzip_    = false;
+	content_codec_[0] = 0;
 
 	upgrade_          = NULL;
 	ws_origin_        = NULL;
@@ -1257,14 +1260,15 @@ bool http_header::build_response(string& out) const
 	if (range_from_ >= 0
 			&& range_to_ >= range_from_ && range_total_ > 0) {
 
-		out << "Content-Range: bytes=" << range_from_ << '-'
+		out << "Content-Range: bytes " << range_from_ << '-'
 			<< range_to_ << '/' << range_total_ << "\r\n";
 	}
 
 	//  gzip ѹݣ chunked ʱȡ Content-Length
 	// ֶΣͬʱֳֹӣ Connection: close
-	if (transfer_gzip_) {
-		out << "Content-Encoding: gzip\r\n";
+	const char* codec = get_content_codec();
+	if (codec) {
+		out << "Content-Encoding: " << codec << "\r\n";
 
 		if (!chunked_transfer_ && keep_alive_) {
 			const_cast<http_header*>(this)->keep_alive_ = false;
@@ -1308,8 +1312,24 @@ http_header& http_header::set_transfer_gzip(bool on)
 		}
 	} else {
 		transfer_gzip_ = on;
+		content_codec_[0] = 0;
 	}
 	return *this;
 }
 
+http_header& http_header::set_content_codec(const char* codec)
+{
+	if (codec == NULL || *codec == 0) {
+		return set_transfer_gzip(false);
+	} else if (strcasecmp(codec, "gzip") == 0) {
+		content_codec_[0] = 0;
+		return set_transfer_gzip(true);
+	}
+
+	is_request_    = false;
+	transfer_gzip_ = false;
+	ACL_SAFE_STRNCPY(content_codec_, codec, sizeof(content_codec_));
+	return *this;
+}
+
 }  // namespace acl end
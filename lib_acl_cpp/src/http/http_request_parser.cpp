@@ -0,0 +1,721 @@
+#include "acl_stdafx.hpp"
+#ifndef ACL_PREPARE_COMPILE
+#include "acl_cpp/stdlib/log.hpp"
+#include "acl_cpp/stream/socket_stream.hpp"
+#include "acl_cpp/http/http_request_parser.hpp"
+#endif
+
+#ifndef ACL_CLIENT_ONLY
+
+#define SKIP_SPACE(x) { while (*x == ' ' || *x == '\t') x++; }
+#define EQ !strcasecmp
+
+// the states of reading the body
+enum {
+	BODY_BEGIN,		// nothing read yet
+	BODY_DATA,		// in the data of the body or the chunk
+	BODY_CHUNK_HEAD,	// before the size line of the next chunk
+	BODY_END,		// all read
+};
+
+namespace acl {
+
+http_request_parser::http_request_parser(size_t max /* = 65536 */)
+: max_(max < 256 ? 256 : max)
+, buf_(NULL)
+, size_(0)
+, len_(0)
+, aux_(NULL)
+, aux_size_(0)
+, aux_len_(0)
+{
+	reset();
+}
+
+http_request_parser::~http_request_parser(void)
+{
+	if (buf_) {
+		acl_myfree(buf_);
+	}
+	if (aux_) {
+		acl_myfree(aux_);
+	}
+}
+
+void http_request_parser::reset(void)
+{
+	len_            = 0;
+	aux_len_        = 0;
+	method_         = "";
+	url_            = "";
+	path_           = "";
+	query_          = "";
+	host_           = "";
+	port_           = 80;
+	major_          = 0;
+	minor_          = 0;
+	content_length_ = -1;
+	chunked_        = false;
+	connection_     = -1;
+	body_state_     = BODY_BEGIN;
+	body_left_      = 0;
+	params_parsed_  = false;
+	cookies_parsed_ = false;
+
+	// clear() keeps the capacity, so the vectors are allocated only for
+	// the first requests of the connection
+	headers_.clear();
+	params_.clear();
+	cookies_.clear();
+}
+
+void http_request_parser::reserve(size_t n)
+{
+	if (n > size_) {
+		size_t size = size_ > 0 ? size_ : 1024;
+		while (size < n) {
+			size *= 2;
+		}
+		buf_  = (char*) acl_myrealloc(buf_, size);
+		size_ = size;
+	}
+
+	// the path, the host, the params and the cookies are the parts of
+	// the header, so 3 times of it is enough for them, and aux_ isn't
+	// moved while the slices in it are used
+	n = len_ * 3 + 64;
+	if (n > aux_size_) {
+		size_t size = aux_size_ > 0 ? aux_size_ : 1024;
+		while (size < n) {
+			size *= 2;
+		}
+		if (aux_) {
+			acl_myfree(aux_);
+		}
+		aux_      = (char*) acl_mymalloc(size);
+		aux_size_ = size;
+	}
+}
+
+char* http_request_parser::aux_dup(const char* s, size_t n)
+{
+	acl_assert(aux_len_ + n + 1 <= aux_size_);
+	char* ptr = aux_ + aux_len_;
+	memcpy(ptr, s, n);
+	ptr[n] = 0;
+	aux_len_ += n + 1;
+	return ptr;
+}
+
+// the state of searching the empty line: 0 in the line, 1 after "\n",
+// 2 after "\n\r", and 3 after the empty line
+static inline int next_state(int state, int ch)
+{
+	if (ch == '\n') {
+		return state == 0 ? 1 : 3;
+	}
+	if (ch == '\r') {
+		return state == 1 ? 2 : 0;
+	}
+	return 0;
+}
+
+// the chunk size line: {hex size}[;extension]\r\n, and the last one of
+// size 0 is followed by the trailers ended with the empty line
+bool http_request_parser::read_chunk_head(socket_stream& in)
+{
+	char line[256];
+	size_t n = sizeof(line) - 1;
+	if (!in.gets(line, &n)) {
+		logger_error("read chunk size error");
+		return false;
+	}
+	line[n] = 0;
+
+	char* end;
+	long long len = (long long) strtoull(line, &end, 16);
+	if (end == line || len < 0) {
+		logger_error("invalid chunk size: %s", line);
+		return false;
+	}
+
+	if (len > 0) {
+		body_left_  = len;
+		body_state_ = BODY_DATA;
+		return true;
+	}
+
+	while (true) {
+		n = sizeof(line) - 1;
+		if (!in.gets(line, &n)) {
+			logger_error("read chunk trailer error");
+			return false;
+		}
+		if (n == 0) {
+			break;
+		}
+	}
+	body_state_ = BODY_END;
+	return true;
+}
+
+int http_request_parser::read_body(socket_stream& in, char* buf, size_t size)
+{
+	if (body_state_ == BODY_BEGIN) {
+		if (chunked_) {
+			body_state_ = BODY_CHUNK_HEAD;
+		} else if (content_length_ > 0) {
+			body_left_  = content_length_;
+			body_state_ = BODY_DATA;
+		} else {
+			body_state_ = BODY_END;
+		}
+	}
+
+	if (body_state_ == BODY_CHUNK_HEAD && !read_chunk_head(in)) {
+		return -1;
+	}
+	if (body_state_ == BODY_END || size == 0) {
+		return 0;
+	}
+
+	if ((long long) size > body_left_) {
+		size = (size_t) body_left_;
+	}
+	int ret = in.read(buf, size, false);
+	if (ret == -1) {
+		return -1;
+	}
+
+	body_left_ -= ret;
+	if (body_left_ > 0) {
+		return ret;
+	}
+
+	if (!chunked_) {
+		body_state_ = BODY_END;
+		return ret;
+	}
+
+	// the CRLF after the data of the chunk
+	char crlf[8];
+	size_t n = sizeof(crlf) - 1;
+	if (!in.gets(crlf, &n) || n != 0) {
+		logger_error("no CRLF after the chunk data");
+		return -1;
+	}
+	body_state_ = BODY_CHUNK_HEAD;
+	return ret;
+}
+
+bool http_request_parser::read(socket_stream& in)
+{
+	reset();
+
+	ACL_VSTREAM* fp = in.get_vstream();
+	if (fp == NULL) {
+		logger_error("stream not opened");
+		return false;
+	}
+
+	// the empty line before the request line is skipped by the parser
+	int state = 0;
+
+	while (true) {
+		if (fp->read_cnt <= 0) {
+			// read into the buffer of the stream, and got the
+			// first byte of it
+			int ch = acl_vstream_getc(fp);
+			if (ch == ACL_VSTREAM_EOF) {
+				return false;
+			}
+			if (len_ + 2 > max_) {
+				logger_error("request header too long, max=%d",
+					(int) max_);
+				return false;
+			}
+			reserve(len_ + 2);
+			buf_[len_++] = (char) ch;
+			if ((state = next_state(state, ch)) == 3) {
+				break;
+			}
+			continue;
+		}
+
+		// only copy the bytes of the header, the body and the next
+		// requests are left in the buffer of the stream
+		const unsigned char* ptr = fp->read_ptr;
+		size_t n = (size_t) fp->read_cnt, i = 0;
+		while (i < n && (state = next_state(state, ptr[i])) != 3) {
+			i++;
+		}
+		if (i < n) {
+			i++;
+		}
+
+		if (len_ + i + 1 > max_) {
+			logger_error("request header too long, max=%d",
+				(int) max_);
+			return false;
+		}
+		reserve(len_ + i + 1);
+		acl_vstream_bfcp_some(fp, buf_ + len_, i);
+		len_ += i;
+
+		if (state == 3) {
+			break;
+		}
+	}
+
+	buf_[len_] = 0;
+	return parse_request();
+}
+
+bool http_request_parser::parse(const char* data, size_t len)
+{
+	reset();
+
+	if (len + 1 > max_) {
+		logger_error("request header too long, len=%d, max=%d",
+			(int) len, (int) max_);
+		return false;
+	}
+
+	len_ = len;
+	reserve(len + 1);
+	memcpy(buf_, data, len);
+	buf_[len] = 0;
+	return parse_request();
+}
+
+bool http_request_parser::parse_request(void)
+{
+	reserve(len_ + 1);
+
+	char* end = buf_ + len_;
+
+	// join the obsolete folded lines
+	for (char* ptr = buf_; ptr + 1 < end;) {
+		ptr = (char*) memchr(ptr, '\n', end - ptr - 1);
+		if (ptr == NULL) {
+			break;
+		}
+		if (ptr[1] == ' ' || ptr[1] == '\t') {
+			*ptr = ' ';
+			if (ptr > buf_ && ptr[-1] == '\r') {
+				ptr[-1] = ' ';
+			}
+		}
+		ptr++;
+	}
+
+	bool first = true;
+	char* ptr = buf_;
+
+	while (ptr < end) {
+		char* line = ptr;
+		char* eol = (char*) memchr(ptr, '\n', end - ptr);
+		if (eol == NULL) {
+			eol = end;
+			ptr = end;
+		} else {
+			ptr = eol + 1;
+		}
+		*eol = 0;
+		if (eol > line && eol[-1] == '\r') {
+			*--eol = 0;
+		}
+
+		if (*line == 0) {
+			if (first) {
+				continue;
+			}
+			break;
+		}
+
+		if (first) {
+			if (!parse_request_line(line)) {
+				return false;
+			}
+			first = false;
+		} else {
+			parse_header(line);
+		}
+	}
+
+	if (first) {
+		logger_error("no request line");
+		return false;
+	}
+
+	parse_url((char*) url_);
+	return true;
+}
+
+bool http_request_parser::parse_request_line(char* line)
+{
+	// METHOD URL HTTP/1.1
+	char* ptr = line;
+	while (*ptr && *ptr != ' ' && *ptr != '\t') {
+		ptr++;
+	}
+	if (*ptr == 0 || ptr == line) {
+		logger_error("invalid request line: %s", line);
+		return false;
+	}
+	*ptr++ = 0;
+	method_ = line;
+
+	SKIP_SPACE(ptr);
+	char* url = ptr;
+	while (*ptr && *ptr != ' ' && *ptr != '\t') {
+		ptr++;
+	}
+	if (*ptr == 0 || ptr == url) {
+		logger_error("invalid request line, method=%s", method_);
+		return false;
+	}
+	*ptr++ = 0;
+	url_ = url;
+
+	SKIP_SPACE(ptr);
+	if (strncasecmp(ptr, "HTTP/", 5) != 0) {
+		logger_error("invalid version: %s", ptr);
+		return false;
+	}
+	ptr += 5;
+	major_ = (unsigned) atoi(ptr);
+	ptr = strchr(ptr, '.');
+	minor_ = ptr ? (unsigned) atoi(ptr + 1) : 0;
+	return true;
+}
+
+void http_request_parser::parse_header(char* line)
+{
+	char* value = strchr(line, ':');
+	if (value == NULL || value == line) {
+		return;
+	}
+
+	char* end = value;
+	*value++ = 0;
+	while (end > line && (end[-1] == ' ' || end[-1] == '\t')) {
+		*--end = 0;
+	}
+
+	SKIP_SPACE(value);
+	end = value + strlen(value);
+	while (end > value && (end[-1] == ' ' || end[-1] == '\t')) {
+		*--end = 0;
+	}
+
+	field f;
+	f.name  = line;
+	f.value = value;
+	headers_.push_back(f);
+
+	switch (*line) {
+	case 'c':
+	case 'C':
+		if (EQ(line, "Connection")) {
+			connection_ = EQ(value, "keep-alive") ? 1 : 0;
+		} else if (EQ(line, "Content-Length")) {
+			content_length_ = acl_atoi64(value);
+			if (content_length_ < 0) {
+				content_length_ = -1;
+			}
+		}
+		break;
+	case 'h':
+	case 'H':
+		if (EQ(line, "Host")) {
+			host_ = value;
+		}
+		break;
+	case 'p':
+	case 'P':
+		if (EQ(line, "Proxy-Connection")) {
+			connection_ = EQ(value, "keep-alive") ? 1 : 0;
+		}
+		break;
+	case 't':
+	case 'T':
+		if (EQ(line, "Transfer-Encoding")) {
+			chunked_ = acl_strcasestr(value, "chunked") != NULL;
+		}
+		break;
+	default:
+		break;
+	}
+}
+
+void http_request_parser::parse_url(char* url)
+{
+	// the port from the Host header
+	if (*host_) {
+		const char* ptr = strrchr(host_, ':');
+		if (ptr && strchr(ptr, ']') == NULL) {
+			port_ = atoi(ptr + 1);
+		}
+	}
+
+	char* ptr = url;
+	if (strncasecmp(ptr, "http://", 7) == 0) {
+		ptr += 7;
+	} else if (strncasecmp(ptr, "https://", 8) == 0) {
+		ptr += 8;
+		if (*host_ == 0) {
+			port_ = 443;
+		}
+	}
+
+	if (ptr != url || EQ(method_, "CONNECT")) {
+		// the host in the URL, such as the proxy request
+		size_t n = strcspn(ptr, "/?");
+		if (*host_ == 0) {
+			host_ = aux_dup(ptr, n);
+			const char* port = strrchr(host_, ':');
+			if (port && strchr(port, ']') == NULL) {
+				port_ = atoi(port + 1);
+			}
+		}
+		ptr += n;
+	}
+
+	if (port_ <= 0) {
+		port_ = 80;
+	}
+
+	if (*ptr != '/') {
+		url_   = "/";
+		path_  = "/";
+		query_ = *ptr == '?' ? ptr + 1 : "";
+		return;
+	}
+	url_ = ptr;
+
+	// the query begins with '?', or "%3F" escaped by the clients
+	char* q = ptr;
+	while (*q && *q != '?' && !(q[0] == '%' && q[1] == '3'
+		&& (q[2] == 'F' || q[2] == 'f'))) {
+
+		q++;
+	}
+	if (*q == '?') {
+		query_ = q + 1;
+	} else if (*q == '%') {
+		query_ = q + 3;
+	}
+
+	strip_path(ptr, q - ptr);
+}
+
+void http_request_parser::strip_path(const char* path, size_t n)
+{
+	acl_assert(aux_len_ + n + 2 <= aux_size_);
+
+	char* out = aux_ + aux_len_;
+	size_t len = 0;
+	const char* end = path + n;
+
+	while (path < end) {
+		while (path < end && *path == '/') {
+			path++;
+		}
+		const char* seg = path;
+		while (path < end && *path != '/') {
+			path++;
+		}
+
+		size_t slen = path - seg;
+		if (slen == 0 || (slen == 1 && seg[0] == '.')
+			|| (slen == 2 && seg[0] == '.' && seg[1] == '.')) {
+
+			continue;
+		}
+
+		out[len++] = '/';
+		memcpy(out + len, seg, slen);
+		len += slen;
+	}
+
+	if (n > 0 && end[-1] == '/' && (len == 0 || out[len - 1] != '/')) {
+		out[len++] = '/';
+	}
+	if (len == 0) {
+		out[len++] = '/';
+	}
+
+	out[len] = 0;
+	aux_len_ += len + 1;
+	path_ = out;
+}
+
+bool http_request_parser::keep_alive(void) const
+{
+	if (connection_ >= 0) {
+		return connection_ == 1;
+	}
+	return major_ > 1 || (major_ == 1 && minor_ >= 1);
+}
+
+const char* http_request_parser::header_value(const char* name) const
+{
+	for (std::vector<field>::const_iterator cit = headers_.begin();
+		cit != headers_.end(); ++cit) {
+
+		if (EQ((*cit).name, name)) {
+			return (*cit).value;
+		}
+	}
+	return NULL;
+}
+
+bool http_request_parser::get_range(long long& from, long long& to) const
+{
+	// Range: bytes={from}-{to}, or bytes={from}-
+	const char* ptr = header_value("Range");
+	if (ptr == NULL || (ptr = strstr(ptr, "bytes=")) == NULL) {
+		return false;
+	}
+	ptr += sizeof("bytes=") - 1;
+
+	const char* sep = ptr;
+	while (*sep && *sep != '-' && *sep != ' ') {
+		sep++;
+	}
+	// the suffix range "bytes=-{length}" can't be held by from and to
+	if (*sep == 0 || sep == ptr) {
+		return false;
+	}
+
+	from = acl_atoi64(ptr);
+	if (from < 0) {
+		return false;
+	}
+	// "bytes=0-0" is the first byte, so the explicit 0 is kept
+	to = *++sep ? acl_atoi64(sep) : -1;
+	if (to < 0) {
+		to = -1;
+	}
+	return true;
+}
+
+const std::vector<http_request_parser::field>&
+http_request_parser::get_params(void)
+{
+	if (params_parsed_) {
+		return params_;
+	}
+	params_parsed_ = true;
+
+	// name1=value1&name2=value2, decoded from buf_ into aux_ which is
+	// large enough for them
+	const char* ptr = query_;
+	while (*ptr) {
+		const char* end = strchr(ptr, '&');
+		if (end == NULL) {
+			end = ptr + strlen(ptr);
+		}
+
+		const char* eq = (const char*) memchr(ptr, '=', end - ptr);
+		if (eq && eq + 1 < end) {
+			field f;
+			char* name = aux_ + aux_len_;
+			aux_len_ += acl_url_decode_buf(ptr, eq - ptr, name) + 1;
+			char* value = aux_ + aux_len_;
+			aux_len_ += acl_url_decode_buf(eq + 1, end - eq - 1,
+					value) + 1;
+			acl_assert(aux_len_ <= aux_size_);
+
+			f.name  = name;
+			f.value = value;
+			params_.push_back(f);
+		}
+
+		ptr = *end ? end + 1 : end;
+	}
+
+	return params_;
+}
+
+const char* http_request_parser::get_param(const char* name,
+	bool case_sensitive /* = false */)
+{
+	const std::vector<field>& params = get_params();
+	for (std::vector<field>::const_iterator cit = params.begin();
+		cit != params.end(); ++cit) {
+
+		if (case_sensitive ? !strcmp((*cit).name, name)
+			: EQ((*cit).name, name)) {
+
+			return (*cit).value;
+		}
+	}
+	return NULL;
+}
+
+const std::vector<http_request_parser::field>&
+http_request_parser::get_cookies(void)
+{
+	if (cookies_parsed_) {
+		return cookies_;
+	}
+	cookies_parsed_ = true;
+
+	// Cookie: name1=value1; name2=value2
+	const char* ptr = header_value("Cookie");
+	if (ptr == NULL) {
+		return cookies_;
+	}
+
+	while (*ptr) {
+		const char* end = strchr(ptr, ';');
+		if (end == NULL) {
+			end = ptr + strlen(ptr);
+		}
+
+		SKIP_SPACE(ptr);
+		const char* eq = (const char*) memchr(ptr, '=', end - ptr);
+		if (eq && eq > ptr) {
+			const char* ne = eq;
+			while (ne > ptr && (ne[-1] == ' ' || ne[-1] == '\t')) {
+				ne--;
+			}
+			const char* value = eq + 1;
+			SKIP_SPACE(value);
+			const char* ve = end;
+			while (ve > value && (ve[-1] == ' ' || ve[-1] == '\t')) {
+				ve--;
+			}
+
+			if (value < ve) {
+				field f;
+				f.name  = aux_dup(ptr, ne - ptr);
+				f.value = aux_dup(value, ve - value);
+				cookies_.push_back(f);
+			}
+		}
+
+		ptr = *end ? end + 1 : end;
+	}
+
+	return cookies_;
+}
+
+const char* http_request_parser::get_cookie(const char* name)
+{
+	const std::vector<field>& cookies = get_cookies();
+	for (std::vector<field>::const_iterator cit = cookies.begin();
+		cit != cookies.end(); ++cit) {
+
+		if (!strcmp((*cit).name, name)) {
+			return (*cit).value;
+		}
+	}
+	return NULL;
+}
+
+} // namespace acl
+
+#endif // ACL_CLIENT_ONLY
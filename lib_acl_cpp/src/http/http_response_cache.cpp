@@ -0,0 +1,520 @@
+#include "acl_stdafx.hpp"
+#ifndef ACL_PREPARE_COMPILE
+#include "acl_cpp/stdlib/log.hpp"
+#include "acl_cpp/stdlib/snprintf.hpp"
+#include "acl_cpp/stdlib/compress_codec.hpp"
+#include "acl_cpp/stream/socket_stream.hpp"
+#include "acl_cpp/http/http_header.hpp"
+#include "acl_cpp/http/HttpServletRequest.hpp"
+#include "acl_cpp/http/HttpServletResponse.hpp"
+#include "acl_cpp/http/http_response_cache.hpp"
+#endif
+
+#ifndef ACL_CLIENT_ONLY
+
+namespace acl {
+
+http_cached_response::http_cached_response(const char* key)
+: key_(key)
+, expire_(0)
+, size_(0)
+, cached_(false)
+{
+	etag_[0] = 0;
+}
+
+http_cached_response::~http_cached_response(void)
+{
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+http_response_cache::http_response_cache(int ttl /* = 10 */,
+	size_t max /* = 64 * 1024 * 1024 */)
+: ttl_(ttl > 0 ? ttl : 1)
+, max_(max > 0 ? max : 1)
+, size_(0)
+, compress_min_(256)
+, wait_ms_(0)
+, codecs_("zstd, br, gzip")
+, cond_(&lock_)
+{
+	build_vary();
+}
+
+http_response_cache::~http_response_cache(void)
+{
+	clear();
+}
+
+http_response_cache& http_response_cache::add_key_header(const char* name)
+{
+	key_headers_.push_back(name);
+	build_vary();
+	return *this;
+}
+
+http_response_cache& http_response_cache::set_codecs(const char* codecs)
+{
+	codecs_ = codecs ? codecs : "";
+	build_vary();
+	return *this;
+}
+
+http_response_cache& http_response_cache::set_compress_min(size_t len)
+{
+	compress_min_ = len;
+	return *this;
+}
+
+http_response_cache& http_response_cache::set_wait_timeout(int ms)
+{
+	wait_ms_ = ms > 0 ? ms : 0;
+	return *this;
+}
+
+void http_response_cache::build_vary(void)
+{
+	vary_.clear();
+	if (!codecs_.empty()) {
+		vary_ = "Accept-Encoding";
+	}
+	for (std::vector<string>::const_iterator it = key_headers_.begin();
+		it != key_headers_.end(); ++it) {
+		if (!vary_.empty()) {
+			vary_ << ", ";
+		}
+		vary_ << *it;
+	}
+}
+
+// HEAD shares the response of GET, and the values of the key headers are
+// appended after the URL each in one line, so all the responses of one URL
+// are adjacent in the map.
+void http_response_cache::build_key(HttpServletRequest& req,
+	string& key) const
+{
+	key.format("GET %s", req.getRequestUri());
+	for (std::vector<string>::const_iterator it = key_headers_.begin();
+		it != key_headers_.end(); ++it) {
+		const char* value = req.getHeader((*it).c_str());
+		key << "\n" << (value ? value : "");
+	}
+}
+
+void http_response_cache::unlink(http_cached_response* resp)
+{
+	responses_.erase(resp->key_);
+	lru_.erase(resp->lru_);
+	size_ -= resp->size_;
+	resp->cached_ = false;
+}
+
+void http_response_cache::evict(std::vector<http_cached_response*>& olds)
+{
+	while (size_ > max_ && !lru_.empty()) {
+		http_cached_response* last = lru_.back();
+		olds.push_back(last);
+		unlink(last);
+	}
+}
+
+void http_response_cache::store(http_cached_response* resp,
+	std::vector<http_cached_response*>& olds)
+{
+	// the one too big isn't cached
+	if (resp->size_ > max_) {
+		return;
+	}
+
+	std::map<string, http_cached_response*>::iterator it =
+		responses_.find(resp->key_);
+	if (it != responses_.end()) {
+		olds.push_back(it->second);
+		unlink(it->second);
+	}
+
+	responses_[resp->key_] = resp;
+	lru_.push_front(resp);
+	resp->lru_    = lru_.begin();
+	resp->cached_ = true;
+	size_ += resp->size_;
+	resp->hold();
+
+	evict(olds);
+}
+
+http_cached_response* http_response_cache::find(const string& key,
+	bool& fresh, bool& generator)
+{
+	fresh     = false;
+	generator = false;
+
+	struct timeval begin;
+	gettimeofday(&begin, NULL);
+	long long left = (long long) wait_ms_ * 1000;
+
+	lock_.lock();
+
+	while (true) {
+		std::map<string, http_cached_response*>::iterator it =
+			responses_.find(key);
+		http_cached_response* resp =
+			it != responses_.end() ? it->second : NULL;
+
+		if (resp && resp->expire_ > time(NULL)) {
+			lru_.splice(lru_.begin(), lru_, resp->lru_);
+			resp->hold();
+			lock_.unlock();
+			fresh = true;
+			return resp;
+		}
+
+		// the first request finding it expired or missing regenerates it
+		if (generating_.find(key) == generating_.end()) {
+			generating_.insert(key);
+			lock_.unlock();
+			generator = true;
+			return NULL;
+		}
+
+		// the others get the stale one while it's being regenerated
+		if (resp) {
+			resp->hold();
+			lock_.unlock();
+			return resp;
+		}
+
+		if (left <= 0) {
+			lock_.unlock();
+			return NULL;
+		}
+
+		(void) cond_.wait(left, true);
+
+		struct timeval now;
+		gettimeofday(&now, NULL);
+		left = (long long) wait_ms_ * 1000
+			- (long long) (now.tv_sec - begin.tv_sec) * 1000000
+			- (long long) (now.tv_usec - begin.tv_usec);
+	}
+}
+
+static void build_head(string& out, const char* type, size_t len,
+	const char* codec, const char* etag, const string& vary)
+{
+	out.format("Content-Type: %s\r\nContent-Length: %lu\r\n",
+		type, (unsigned long) len);
+	if (codec && *codec) {
+		out.format_append("Content-Encoding: %s\r\n", codec);
+	}
+	out.format_append("ETag: %s\r\n", etag);
+	if (!vary.empty()) {
+		out.format_append("Vary: %s\r\n", vary.c_str());
+	}
+	out << "\r\n";
+}
+
+http_cached_response* http_response_cache::create(const string& key,
+	const string& body, const string& type)
+{
+	http_cached_response* resp = NEW http_cached_response(key);
+	resp->type_   = type.empty() ? "text/html" : type.c_str();
+	resp->expire_ = time(NULL) + ttl_;
+
+	acl_uint64 crc = acl_hash_crc64(body.c_str(), body.size());
+#if defined(_WIN32) || defined(_WIN64)
+	safe_snprintf(resp->etag_, sizeof(resp->etag_), "\"%I64x-%lx\"",
+		crc, (unsigned long) body.size());
+#else
+	safe_snprintf(resp->etag_, sizeof(resp->etag_), "\"%llx-%lx\"",
+		(unsigned long long) crc, (unsigned long) body.size());
+#endif
+
+	resp->variants_.push_back(http_cached_response::variant());
+	http_cached_response::variant& plain = resp->variants_.back();
+	plain.codec[0] = 0;
+	build_head(plain.head, resp->type_, body.size(), NULL,
+		resp->etag_, vary_);
+	plain.body = body;
+
+	resp->size_ = plain.head.size() + plain.body.size();
+	return resp;
+}
+
+const http_cached_response::variant* http_response_cache::get_variant(
+	http_cached_response* resp, const char* codec)
+{
+	const http_cached_response::variant* plain = &resp->variants_.front();
+	if (codec == NULL || plain->body.size() < compress_min_) {
+		return plain;
+	}
+
+	lock_.lock();
+	for (std::list<http_cached_response::variant>::const_iterator it =
+		resp->variants_.begin(); it != resp->variants_.end(); ++it) {
+		if (strcmp((*it).codec, codec) == 0) {
+			lock_.unlock();
+			return &(*it);
+		}
+	}
+	lock_.unlock();
+
+	// compressed only once for each codec, so it's done without the lock
+	compress_codec* zip = compress_codec::get(codec);
+	if (zip == NULL) {
+		return plain;
+	}
+
+	http_cached_response::variant var;
+	safe_snprintf(var.codec, sizeof(var.codec), "%s", zip->name());
+	bool ok = zip->compress(plain->body.c_str(), plain->body.size(),
+		&var.body);
+	compress_codec::put(zip);
+
+	if (!ok) {
+		logger_error("compress %s with %s error",
+			resp->key_.c_str(), codec);
+		return plain;
+	}
+
+	build_head(var.head, resp->type_, var.body.size(), var.codec,
+		resp->etag_, vary_);
+
+	std::vector<http_cached_response*> olds;
+	const http_cached_response::variant* result = NULL;
+
+	lock_.lock();
+	// maybe added by the other request at the same time
+	for (std::list<http_cached_response::variant>::const_iterator it =
+		resp->variants_.begin(); it != resp->variants_.end(); ++it) {
+		if (strcmp((*it).codec, var.codec) == 0) {
+			result = &(*it);
+			break;
+		}
+	}
+	if (result == NULL) {
+		resp->variants_.push_back(http_cached_response::variant());
+		http_cached_response::variant& added = resp->variants_.back();
+		memcpy(added.codec, var.codec, sizeof(added.codec));
+		added.head = var.head;
+		added.body = var.body;
+
+		size_t n = added.head.size() + added.body.size();
+		resp->size_ += n;
+		if (resp->cached_) {
+			size_ += n;
+			evict(olds);
+		}
+		result = &added;
+	}
+	lock_.unlock();
+
+	// the one being sent is held by the caller, so won't be freed here
+	for (std::vector<http_cached_response*>::iterator it = olds.begin();
+		it != olds.end(); ++it) {
+		(*it)->release();
+	}
+	return result;
+}
+
+// the response of the pipelined request is copied into the write buffer
+// of the stream, and sent with the next ones
+static bool send_buf(HttpServletResponse& res, gather_buf& buf)
+{
+	socket_stream& out = res.getSocketStream();
+	if (!res.isBatched()) {
+		return out.sendv(buf) != -1;
+	}
+
+	struct iovec iov[16];
+	while (!buf.empty()) {
+		int n = buf.peek(iov, 16);
+		for (int i = 0; i < n; i++) {
+			if (out.write(iov[i].iov_base, iov[i].iov_len,
+				true, true) == -1) {
+
+				buf.clear();
+				return false;
+			}
+			buf.consume(iov[i].iov_len);
+		}
+	}
+	return true;
+}
+
+bool http_response_cache::send(HttpServletRequest& req,
+	HttpServletResponse& res, http_cached_response* resp)
+{
+	char date[64];
+	http_header::date_format(date, sizeof(date), time(NULL));
+
+	long long max_age = (long long) (resp->expire_ - time(NULL));
+	if (max_age < 0) {
+		max_age = 0;
+	}
+
+	const char* conn = res.getHttpHeader().get_keep_alive()
+		? "keep-alive" : "close";
+
+	gather_buf buf(4);
+
+	const char* tags = req.getHeader("If-None-Match");
+	if (tags && (strcmp(tags, "*") == 0 || strstr(tags, resp->etag_))) {
+		++not_modified_;
+		buf.format("HTTP/1.1 304 Not Modified\r\nDate: %s\r\n"
+			"Server: acl\r\nConnection: %s\r\n"
+			"Cache-Control: max-age=%lld\r\nETag: %s\r\n"
+			"Content-Length: 0\r\n",
+			date, conn, max_age, resp->etag_);
+		if (!vary_.empty()) {
+			buf.format("Vary: %s\r\n", vary_.c_str());
+		}
+		buf.copy("\r\n", 2);
+		return send_buf(res, buf);
+	}
+
+	const char* codec = codecs_.empty() ? NULL : compress_codec::negotiate(
+		req.getHeader("Accept-Encoding"), codecs_.c_str());
+	const http_cached_response::variant* var = get_variant(resp, codec);
+
+	buf.format("HTTP/1.1 200 OK\r\nDate: %s\r\nServer: acl\r\n"
+		"Connection: %s\r\nCache-Control: max-age=%lld\r\n",
+		date, conn, max_age);
+	buf.add(var->head.c_str(), var->head.size(), resp);
+	if (req.getMethod() != HTTP_METHOD_HEAD) {
+		buf.add(var->body.c_str(), var->body.size(), resp);
+	}
+
+	return send_buf(res, buf);
+}
+
+bool http_response_cache::serve(HttpServletRequest& req,
+	HttpServletResponse& res, http_response_generator& generator)
+{
+	string body, type;
+	http_method_t method = req.getMethod();
+
+	// the other methods are replied by res as usual, without the
+	// Cache-Control and ETag of the cached ones, and If-None-Match is
+	// ignored for them
+	if (method != HTTP_METHOD_GET && method != HTTP_METHOD_HEAD) {
+		if (!generator.generate(req, body, type)) {
+			return false;
+		}
+		if (!type.empty()) {
+			res.setContentType(type.c_str());
+		}
+		res.setContentLength((long long) body.size());
+		return res.write(body);
+	}
+
+	string key;
+	build_key(req, key);
+
+	bool fresh, generating;
+	http_cached_response* resp = find(key, fresh, generating);
+	if (resp) {
+		if (fresh) {
+			++hits_;
+		} else {
+			++stales_;
+		}
+		bool ret = send(req, res, resp);
+		resp->release();
+		return ret;
+	}
+
+	++misses_;
+
+	bool ok = generator.generate(req, body, type);
+	resp = ok ? create(key, body, type) : NULL;
+
+	std::vector<http_cached_response*> olds;
+
+	lock_.lock();
+	if (generating) {
+		generating_.erase(key);
+	}
+	if (resp) {
+		store(resp, olds);
+	}
+	// wake up the requests waiting for it, even if it failed
+	cond_.notify_all();
+	lock_.unlock();
+
+	for (std::vector<http_cached_response*>::iterator it = olds.begin();
+		it != olds.end(); ++it) {
+		(*it)->release();
+	}
+
+	if (resp == NULL) {
+		return false;
+	}
+
+	bool ret = send(req, res, resp);
+	resp->release();
+	return ret;
+}
+
+void http_response_cache::invalidate(const char* url)
+{
+	std::vector<http_cached_response*> olds;
+	string prefix;
+	prefix.format("GET %s", url);
+
+	lock_.lock();
+	std::map<string, http_cached_response*>::iterator it =
+		responses_.lower_bound(prefix);
+	while (it != responses_.end()) {
+		const char* key = it->first.c_str();
+		if (strncmp(key, prefix.c_str(), prefix.size()) != 0) {
+			break;
+		}
+		char ch = key[prefix.size()];
+		http_cached_response* resp = it->second;
+		++it;
+		if (ch == 0 || ch == '\n') {
+			olds.push_back(resp);
+			unlink(resp);
+		}
+	}
+	lock_.unlock();
+
+	for (std::vector<http_cached_response*>::iterator cit = olds.begin();
+		cit != olds.end(); ++cit) {
+		(*cit)->release();
+	}
+}
+
+void http_response_cache::clear(void)
+{
+	std::list<http_cached_response*> olds;
+
+	lock_.lock();
+	olds.swap(lru_);
+	responses_.clear();
+	size_ = 0;
+	for (std::list<http_cached_response*>::iterator it = olds.begin();
+		it != olds.end(); ++it) {
+		(*it)->cached_ = false;
+	}
+	lock_.unlock();
+
+	for (std::list<http_cached_response*>::iterator it = olds.begin();
+		it != olds.end(); ++it) {
+		(*it)->release();
+	}
+}
+
+size_t http_response_cache::size(void)
+{
+	lock_.lock();
+	size_t n = size_;
+	lock_.unlock();
+	return n;
+}
+
+} // namespace acl
+
+#endif // ACL_CLIENT_ONLY
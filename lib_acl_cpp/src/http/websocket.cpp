@@ -3,6 +3,7 @@
 #include "acl_cpp/stdlib/log.hpp"
 #include "acl_cpp/stream/socket_stream.hpp"
 #include "acl_cpp/stream/aio_socket_stream.hpp"
+#include "acl_cpp/stream/gather_buf.hpp"
 #include "acl_cpp/http/websocket.hpp"
 #endif
 
@@ -31,6 +32,7 @@ websocket::websocket(socket_stream& client)
 , header_sent_(false)
 , status_(WS_HEAD_2BYTES)
 , peek_buf_(NULL)
+, gbuf_(NULL)
 {
 	reset();
 }
@@ -41,6 +43,7 @@ websocket::~websocket(void)
 		acl_myfree(header_buf_);
 	}
 	delete peek_buf_;
+	delete gbuf_;
 }
 
 websocket& websocket::reset(void)
@@ -177,39 +180,52 @@ void websocket::make_frame_header(void)
 
 //////////////////////////////////////////////////////////////////////////////
 
+gather_buf& websocket::get_gather(void)
+{
+	if (gbuf_ == NULL) {
+		gbuf_ = NEW gather_buf(2);
+	}
+	return *gbuf_;
+}
+
 bool websocket::send_frame_data(void* data, size_t len)
 {
+	// the frame header and the first data are sent in one writev
+	gather_buf& buf = get_gather();
+	buf.clear();
+
 	if (!header_sent_) {
 		header_sent_ = true;
 		make_frame_header();
-		if (client_.write(header_buf_, header_len_) == -1) {
-			logger_error("write header error %s, len: %d",
-				last_serror(), (int) header_len_);
-			return false;
-		}
-	}
-
-	if (data == NULL || len == 0) {
-		return true;
+		buf.add(header_buf_, header_len_);
 	}
 
-	// senity check
-	if (payload_nsent_ + len > header_.payload_len) {
-		logger_error("data len overflow=%llu > %llu, %llu, %lu",
-			payload_nsent_ + len, header_.payload_len,
-			payload_nsent_, (unsigned long) len);
-		return false;
-	}
+	if (data != NULL && len > 0) {
+		// senity check
+		if (payload_nsent_ + len > header_.payload_len) {
+			logger_error("data len overflow=%llu > %llu, %llu, %lu",
+				payload_nsent_ + len, header_.payload_len,
+				payload_nsent_, (unsigned long) len);
+			buf.clear();
+			return false;
+		}
 
-	if (header_.mask) {
-		unsigned char* mask = (unsigned char*) &header_.masking_key;
-		for (size_t i = 0; i < len; i++) {
-			((char*) data)[i] ^= mask[(payload_nsent_ + i) % 4];
+		if (header_.mask) {
+			unsigned char* mask = (unsigned char*)
+				&header_.masking_key;
+			for (size_t i = 0; i < len; i++) {
+				((char*) data)[i] ^=
+					mask[(payload_nsent_ + i) % 4];
+			}
 		}
+
+		buf.add(data, len);
 	}
 
-	if (client_.write(data, len) == -1) {
-		logger_error("write frame data error %s", last_serror());
+	if (!buf.empty() && client_.sendv(buf) == -1) {
+		logger_error("write frame error %s, len: %d",
+			last_serror(), (int) buf.size());
+		buf.clear();
 		return false;
 	}
 
@@ -224,7 +240,8 @@ bool websocket::send_frame_data(const char* str)
 
 bool websocket::send_frame_data(const void* data, size_t len)
 {
-	if (data == NULL || len == 0) {
+	// the data is changed only when being masked
+	if (data == NULL || len == 0 || !header_.mask) {
 		return send_frame_data((void*) data, len);
 	}
 
@@ -248,6 +265,8 @@ bool websocket::send_frame_pong(const void* data, size_t len)
 {
 	if (data == NULL || len == 0) {
 		return send_frame_pong((void*) NULL, 0);
+	} else if (!header_.mask) {
+		return send_frame_pong((void*) data, len);
 	}
 
 	void* buf = acl_mymemdup(data, len);
@@ -280,6 +299,8 @@ bool websocket::send_frame_ping(const void* data, size_t len)
 {
 	if (data == NULL || len == 0) {
 		return send_frame_ping((void*) NULL, 0);
+	} else if (!header_.mask) {
+		return send_frame_ping((void*) data, len);
 	}
 
 	void* buf = acl_mymemdup(data, len);
@@ -318,32 +339,39 @@ static bool is_big_endian(void)
 
 bool websocket::send_frame_data(aio_socket_stream& conn, void* data, size_t len)
 {
+	gather_buf& buf = get_gather();
+	buf.clear();
+
 	if (!header_sent_) {
 		header_sent_ = true;
 		make_frame_header();
-		conn.write(header_buf_, (int) header_len_);
+		buf.add(header_buf_, header_len_);
 	}
 
-	if (data == NULL || len == 0) {
-		return true;
-	}
-
-	// senity check
-	if (payload_nsent_ + len > header_.payload_len) {
-		logger_error("data len overflow=%llu > %llu, %llu, %lu",
-			payload_nsent_ + len, header_.payload_len,
-			payload_nsent_, (unsigned long) len);
-		return false;
-	}
+	if (data != NULL && len > 0) {
+		// senity check
+		if (payload_nsent_ + len > header_.payload_len) {
+			logger_error("data len overflow=%llu > %llu, %llu, %lu",
+				payload_nsent_ + len, header_.payload_len,
+				payload_nsent_, (unsigned long) len);
+			buf.clear();
+			return false;
+		}
 
-	if (header_.mask) {
-		unsigned char* mask = (unsigned char*) &header_.masking_key;
-		for (size_t i = 0; i < len; i++) {
-			((char*) data)[i] ^= mask[(payload_nsent_ + i) % 4];
+		if (header_.mask) {
+			unsigned char* mask = (unsigned char*)
+				&header_.masking_key;
+			for (size_t i = 0; i < len; i++) {
+				((char*) data)[i] ^=
+					mask[(payload_nsent_ + i) % 4];
+			}
 		}
+
+		buf.add(data, len);
 	}
 
-	conn.write(data, (int) len);
+	// the data not written at once is copied by the stream
+	conn.sendv(buf);
 	payload_nsent_ += len;
 	return true;
 }
@@ -117,7 +117,7 @@ void master_threads::thread_disable_read(socket_stream* stream)
 	if (event == NULL) {
 		logger_error("event NULL");
 	} else {
-		acl_event_disable_readwrite(event, stream->get_vstream());
+		acl_threads_server_disable_read(event, stream->get_vstream());
 	}
 }
 
@@ -12,7 +12,7 @@
 namespace acl
 {
 
-master_udp::master_udp(void) {}
+master_udp::master_udp(void) : batch_mode_(false) {}
 
 master_udp::~master_udp(void)
 {
@@ -30,6 +30,8 @@ void master_udp::run(int argc, char** argv)
 {
 	//  acl  UDP ģӿ
 	acl_udp_server_main(argc, argv, service_main,
+		ACL_MASTER_SERVER_ON_BATCH,
+			batch_mode_ ? service_on_batch : NULL,
 		ACL_MASTER_SERVER_CTX, this,
 		ACL_APP_CTL_THREAD_INIT_CTX, this,
 		ACL_MASTER_SERVER_ON_BIND, service_on_bind,
@@ -104,6 +106,27 @@ bool master_udp::run_alone(const char* addrs, const char* path /* = NULL */,
 	return true;
 }
 
+void master_udp::set_batch_mode(bool yes)
+{
+	batch_mode_ = yes;
+}
+
+void master_udp::on_read_batch(socket_stream*, ACL_UDP_PKT*, int)
+{
+	logger_error("on_read_batch should be implemented in batch mode!");
+}
+
+int master_udp::send_batch(socket_stream& stream, const ACL_UDP_PKT* pkts,
+	int npkts)
+{
+	ACL_VSTREAM* vs = stream.get_vstream();
+	if (vs == NULL) {
+		logger_error("stream not opened");
+		return -1;
+	}
+	return acl_udp_server_send_batch(vs, pkts, npkts);
+}
+
 void master_udp::push_back(socket_stream* ss)
 {
 	thread_mutex_guard guard(lock_);
@@ -155,6 +178,18 @@ void master_udp::service_main(void* ctx, ACL_VSTREAM *stream)
 	mu->on_read(ss);
 }
 
+void master_udp::service_on_batch(void* ctx, ACL_VSTREAM *stream,
+	ACL_UDP_PKT* pkts, int npkts)
+{
+	master_udp* mu = (master_udp *) ctx;
+	acl_assert(mu != NULL);
+
+	socket_stream* ss = (socket_stream*) stream->context;
+	acl_assert(ss);
+
+	mu->on_read_batch(ss, pkts, npkts);
+}
+
 void master_udp::service_pre_jail(void* ctx)
 {
 	master_udp* mu = (master_udp *) ctx;
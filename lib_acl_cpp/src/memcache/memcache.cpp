@@ -4,11 +4,22 @@
 #include "acl_cpp/mime/rfc2047.hpp"
 #include "acl_cpp/memcache/memcache.hpp"
 #include "acl_cpp/stdlib/util.hpp"
+#include "acl_cpp/stdlib/dbuf_pool.hpp"
 #include "acl_cpp/stream/socket_stream.hpp"
 #endif
 
 #define	SPECIAL_CHAR(x)	((x) == ' ' || (x) == '\t' || (x) == '\r' || (x) == '\n')
 
+// the max number of the keys in one text "get" of get_multi
+#define	MULTI_BATCH	100
+
+// the binary protocol used by get_multi
+#define	BIN_REQ		0x80
+#define	BIN_RES		0x81
+#define	BIN_GETKQ	0x0d
+#define	BIN_NOOP	0x0a
+#define	BIN_HDR_LEN	24
+
 #ifndef ACL_CLIENT_ONLY
 
 namespace acl
@@ -24,6 +35,7 @@ memcache::memcache(const char* addr /* = "127.0.0.1:11211" */,
 , content_length_(0)
 , length_(0)
 , conn_(NULL)
+, binary_(false)
 {
 	acl_assert(addr && *addr);
 	addr_ = acl_mystrdup(addr);
@@ -491,6 +503,353 @@ bool memcache::del(const char* key)
 	return del(key, strlen(key));
 }
 
+memcache& memcache::set_binary(bool on)
+{
+	binary_ = on;
+	return *this;
+}
+
+static void put32(unsigned char* ptr, unsigned n)
+{
+	ptr[0] = (unsigned char) ((n >> 24) & 0xff);
+	ptr[1] = (unsigned char) ((n >> 16) & 0xff);
+	ptr[2] = (unsigned char) ((n >> 8) & 0xff);
+	ptr[3] = (unsigned char) (n & 0xff);
+}
+
+static unsigned get32(const unsigned char* ptr)
+{
+	return ((unsigned) ptr[0] << 24) | ((unsigned) ptr[1] << 16)
+		| ((unsigned) ptr[2] << 8) | (unsigned) ptr[3];
+}
+
+void memcache::build_multi(memcache_item** items, size_t n)
+{
+	req_line_.clear();
+	koffs_.clear();
+
+	if (binary_) {
+		unsigned char hdr[BIN_HDR_LEN];
+
+		for (size_t i = 0; i < n; i++) {
+			const string& kbuf = build_key(items[i]->key,
+				items[i]->klen);
+			unsigned klen = (unsigned) kbuf.size();
+
+			memset(hdr, 0, sizeof(hdr));
+			hdr[0] = BIN_REQ;
+			hdr[1] = BIN_GETKQ;
+			hdr[2] = (unsigned char) ((klen >> 8) & 0xff);
+			hdr[3] = (unsigned char) (klen & 0xff);
+			put32(hdr + 8, klen);
+			put32(hdr + 12, (unsigned) i);  // the opaque
+			req_line_.append(hdr, sizeof(hdr));
+			req_line_.append(kbuf.c_str(), kbuf.size());
+		}
+
+		// the NOOP is replied after all the GETKQ before it
+		memset(hdr, 0, sizeof(hdr));
+		hdr[0] = BIN_REQ;
+		hdr[1] = BIN_NOOP;
+		put32(hdr + 12, (unsigned) n);
+		req_line_.append(hdr, sizeof(hdr));
+	} else {
+		for (size_t i = 0; i < n; i++) {
+			if (i % MULTI_BATCH == 0) {
+				if (i > 0) {
+					req_line_ += "\r\n";
+				}
+				req_line_ += "get";
+			}
+
+			const string& kbuf = build_key(items[i]->key,
+				items[i]->klen);
+			req_line_ += ' ';
+			koffs_.push_back(req_line_.size());
+			koffs_.push_back(kbuf.size());
+			req_line_.append(kbuf.c_str(), kbuf.size());
+		}
+		req_line_ += "\r\n";
+	}
+
+	for (size_t i = 0; i < n; i++) {
+		items[i]->len   = 0;
+		items[i]->flags = 0;
+		items[i]->found = false;
+	}
+}
+
+bool memcache::send_multi(bool& has_tried)
+{
+AGAIN:
+	if (!open()) {
+		return false;
+	}
+
+	if (conn_->write(req_line_) < 0) {
+		close();
+		if (retry_ && !has_tried) {
+			has_tried = true;
+			goto AGAIN;
+		}
+		ebuf_.format("write get_multi error");
+		return false;
+	}
+	return true;
+}
+
+int memcache::recv_multi(memcache_item** items, size_t n, dbuf_pool* dbuf)
+{
+	int ret = binary_ ? recv_binary(items, n, dbuf)
+		: recv_text(items, n, dbuf);
+	if (ret < 0) {
+		close();
+	}
+	return ret;
+}
+
+bool memcache::skip(size_t len)
+{
+	char buf[4096];
+
+	while (len > 0) {
+		size_t n = len > sizeof(buf) ? sizeof(buf) : len;
+		if (conn_->read(buf, n) < 0) {
+			ebuf_.format("read data error");
+			return false;
+		}
+		len -= n;
+	}
+	return true;
+}
+
+bool memcache::read_value(memcache_item* item, size_t len, dbuf_pool* dbuf)
+{
+	item->found = true;
+	item->len   = len;
+
+	if (item->buf == NULL && dbuf != NULL) {
+		item->buf  = (char*) dbuf->dbuf_alloc(len + 1);
+		item->size = len + 1;
+	}
+
+	size_t n = len < item->size ? len : item->size;
+	if (n > 0 && conn_->read(item->buf, n) < 0) {
+		ebuf_.format("read data error");
+		return false;
+	}
+
+	if (len < item->size) {
+		item->buf[len] = 0;
+	}
+
+	// the part beyond the caller's buffer is discarded
+	return skip(len - n);
+}
+
+// The reply of each "get" is some "VALUE {key} {flags} {bytes}\r\n{data}\r\n"
+// ended with "END\r\n", the keys found are replied in the order requested,
+// so the key is matched forward from the last one in the same batch.
+// Return -2 if the connection was broken before any reply.
+int memcache::recv_text(memcache_item** items, size_t n, dbuf_pool* dbuf)
+{
+	size_t batches = (n + MULTI_BATCH - 1) / MULTI_BATCH;
+	size_t batch = 0, cur = 0;
+	int nfound = 0;
+	bool replied = false;
+
+	while (batch < batches) {
+		if (!conn_->gets(res_line_)) {
+			ebuf_.format("reply for get_multi error");
+			return replied ? -1 : -2;
+		}
+		replied = true;
+
+		if (res_line_.compare("END", false) == 0) {
+			batch++;
+			cur = batch * MULTI_BATCH;
+			continue;
+		}
+
+		const char* line = res_line_.c_str();
+		if (strncasecmp(line, "VALUE ", 6) != 0) {
+			if (!error_happen(line)) {
+				ebuf_.format("invalid reply(%s)", line);
+			}
+			return -1;
+		}
+
+		const char* key = line + 6;
+		const char* kend = strchr(key, ' ');
+		const char* ptr = kend;
+		char* end = NULL;
+		unsigned long flags = 0, len = 0;
+
+		if (ptr != NULL) {
+			flags = strtoul(ptr + 1, &end, 10);
+		}
+		if (end == NULL || end == ptr + 1 || *end != ' ') {
+			ebuf_.format("invalid reply(%s)", line);
+			return -1;
+		}
+		ptr = end + 1;
+		len = strtoul(ptr, &end, 10);
+		if (end == ptr) {
+			ebuf_.format("invalid reply(%s)", line);
+			return -1;
+		}
+
+		size_t klen = (size_t) (kend - key);
+		size_t last = (batch + 1) * MULTI_BATCH;
+		if (last > n) {
+			last = n;
+		}
+
+		memcache_item* item = NULL;
+		while (cur < last) {
+			size_t i = cur++;
+			if (koffs_[i * 2 + 1] == klen && memcmp(key,
+				req_line_.c_str() + koffs_[i * 2], klen) == 0) {
+
+				item = items[i];
+				break;
+			}
+		}
+
+		if (item == NULL) {
+			ebuf_.format("unexpected reply(%s)", line);
+			return -1;
+		}
+
+		item->flags = (unsigned short) flags;
+		if (!read_value(item, (size_t) len, dbuf)) {
+			return -1;
+		}
+
+		char crlf[2];
+		if (conn_->read(crlf, 2) < 0 || crlf[0] != '\r'
+			|| crlf[1] != '\n') {
+
+			ebuf_.format("read data CRLF error");
+			return -1;
+		}
+		nfound++;
+	}
+	return nfound;
+}
+
+// Only the keys found are replied for the GETKQ requests, and the item is
+// located by the opaque which is the index of it, the last reply is for
+// the NOOP. Return -2 if the connection was broken before any reply.
+int memcache::recv_binary(memcache_item** items, size_t n, dbuf_pool* dbuf)
+{
+	unsigned char hdr[BIN_HDR_LEN];
+	int nfound = 0;
+	bool replied = false;
+
+	while (true) {
+		if (conn_->read(hdr, sizeof(hdr)) < 0) {
+			ebuf_.format("reply for get_multi error");
+			return replied ? -1 : -2;
+		}
+		replied = true;
+
+		unsigned klen   = ((unsigned) hdr[2] << 8) | hdr[3];
+		unsigned elen   = hdr[4];
+		unsigned status = ((unsigned) hdr[6] << 8) | hdr[7];
+		unsigned body   = get32(hdr + 8);
+		unsigned opaque = get32(hdr + 12);
+
+		if (hdr[0] != BIN_RES || klen + elen > body) {
+			ebuf_.format("invalid binary reply, magic=%u, "
+				"body=%u", hdr[0], body);
+			return -1;
+		}
+
+		if (hdr[1] == BIN_NOOP) {
+			return skip(body) ? nfound : -1;
+		}
+
+		if (hdr[1] != BIN_GETKQ || opaque >= n) {
+			ebuf_.format("unexpected binary reply, opcode=%u, "
+				"opaque=%u", hdr[1], opaque);
+			return -1;
+		}
+
+		// the error of one key needn't break the others
+		if (status != 0) {
+			ebuf_.format("get_multi status=%u", status);
+			if (!skip(body)) {
+				return -1;
+			}
+			continue;
+		}
+
+		unsigned char ext[4];
+		unsigned flags = 0;
+
+		if (elen >= 4) {
+			if (conn_->read(ext, 4) < 0 || !skip(elen - 4)) {
+				return -1;
+			}
+			flags = get32(ext);
+		} else if (!skip(elen)) {
+			return -1;
+		}
+
+		if (!skip(klen)) {
+			return -1;
+		}
+
+		memcache_item* item = items[opaque];
+		item->flags = (unsigned short) flags;
+		if (!read_value(item, body - elen - klen, dbuf)) {
+			return -1;
+		}
+		nfound++;
+	}
+}
+
+int memcache::get_multi(memcache_item* items, size_t n,
+	dbuf_pool* dbuf /* = NULL */)
+{
+	if (items == NULL || n == 0) {
+		return 0;
+	}
+
+	std::vector<memcache_item*> ptrs(n);
+	for (size_t i = 0; i < n; i++) {
+		ptrs[i] = &items[i];
+	}
+	return get_multi(ptrs, dbuf);
+}
+
+int memcache::get_multi(std::vector<memcache_item*>& items, dbuf_pool* dbuf)
+{
+	if (items.empty()) {
+		return 0;
+	}
+
+	build_multi(&items[0], items.size());
+	bool has_tried = false;
+
+AGAIN:
+	if (!send_multi(has_tried)) {
+		return -1;
+	}
+
+	int ret = recv_multi(&items[0], items.size(), dbuf);
+	if (ret == -2) {
+		// the connection kept may have been closed by the server
+		if (retry_ && !has_tried) {
+			has_tried = true;
+			goto AGAIN;
+		}
+		ret = -1;
+	}
+	return ret;
+}
+
 const char* memcache::last_serror(void) const
 {
 	static const char* dummy = "ok";
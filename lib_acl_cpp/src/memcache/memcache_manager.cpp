@@ -1,15 +1,25 @@
 #include "acl_stdafx.hpp"
 #ifndef ACL_PREPARE_COMPILE
+#include "acl_cpp/stdlib/log.hpp"
+#include "acl_cpp/memcache/memcache.hpp"
 #include "acl_cpp/memcache/memcache_pool.hpp"
 #include "acl_cpp/memcache/memcache_manager.hpp"
 #endif
 
+#include <algorithm>
+
 #ifndef ACL_CLIENT_ONLY
 
+// the number of the virtual nodes of each server on the hash ring
+#define	RING_VNODES	160
+
 namespace acl
 {
 
 memcache_manager::memcache_manager(void)
+: binary_(false)
+, consistent_hash_(false)
+, ring_pools_(0)
 {
 }
 
@@ -25,6 +35,219 @@ connect_pool* memcache_manager::create_pool(const char* addr,
 	return conns;
 }
 
+memcache_manager& memcache_manager::set_binary(bool on)
+{
+	binary_ = on;
+	return *this;
+}
+
+memcache_manager& memcache_manager::set_consistent_hash(bool on)
+{
+	consistent_hash_ = on;
+	return *this;
+}
+
+void memcache_manager::build_ring(const std::vector<connect_pool*>& pools)
+{
+	ring_.clear();
+
+	char buf[256];
+	for (std::vector<connect_pool*>::const_iterator cit = pools.begin();
+		cit != pools.end(); ++cit) {
+
+		const char* addr = (*cit)->get_addr();
+		for (int i = 0; i < RING_VNODES; i++) {
+			int n = safe_snprintf(buf, sizeof(buf), "%s-%d", addr, i);
+			ring_node node;
+			node.hash = acl_hash_crc32(buf, n);
+			node.addr = addr;
+			ring_.push_back(node);
+		}
+	}
+
+	std::sort(ring_.begin(), ring_.end());
+	ring_pools_ = pools.size();
+}
+
+connect_pool* memcache_manager::peek(const char* key,
+	bool exclusive /* = true */)
+{
+	if (key == NULL || *key == 0) {
+		return connect_manager::peek();
+	}
+	if (!consistent_hash_) {
+		return connect_manager::peek(key, exclusive);
+	}
+	return ring_peek(key, strlen(key), exclusive);
+}
+
+connect_pool* memcache_manager::key_peek(const char* key, size_t len)
+{
+	if (consistent_hash_) {
+		return ring_peek(key, len, true);
+	}
+
+	// the key of the item may be not ended with '\0'
+	string buf(len + 1);
+	buf.copy(key, len);
+	return connect_manager::peek(buf.c_str(), true);
+}
+
+connect_pool* memcache_manager::ring_peek(const char* key, size_t len,
+	bool exclusive)
+{
+	// the pools of the current thread are created by the first peek
+	std::vector<connect_pool*>& pools = get_pools();
+	if (pools.empty() && connect_manager::peek() == NULL) {
+		return NULL;
+	}
+
+	if (exclusive) {
+		lock();
+	}
+
+	ring_lock_.lock();
+	if (ring_pools_ != pools.size()) {
+		build_ring(pools);
+	}
+
+	ring_node node;
+	node.hash = acl_hash_crc32(key, len);
+
+	std::vector<ring_node>::const_iterator cit =
+		std::lower_bound(ring_.begin(), ring_.end(), node);
+	connect_pool* pool = NULL, *first = NULL;
+
+	// find the first pool alive clockwise from the hash of the key
+	for (size_t i = 0; i < ring_.size() && pool == NULL; i++, ++cit) {
+		if (cit == ring_.end()) {
+			cit = ring_.begin();
+		}
+
+		for (std::vector<connect_pool*>::iterator it = pools.begin();
+			it != pools.end(); ++it) {
+
+			if (cit->addr != (*it)->get_addr()) {
+				continue;
+			}
+			if (first == NULL) {
+				first = *it;
+			}
+			if ((*it)->aliving()) {
+				pool = *it;
+			}
+			break;
+		}
+	}
+	ring_lock_.unlock();
+
+	if (exclusive) {
+		unlock();
+	}
+
+	return pool ? pool : first;
+}
+
+struct memcache_group {
+	connect_pool* pool;
+	memcache* conn;
+	std::vector<memcache_item*> items;
+	bool sent;
+};
+
+int memcache_manager::get_multi(memcache_item* items, size_t n,
+	dbuf_pool* dbuf /* = NULL */)
+{
+	std::vector<memcache_group> groups;
+
+	for (size_t i = 0; i < n; i++) {
+		items[i].len   = 0;
+		items[i].flags = 0;
+		items[i].found = false;
+
+		connect_pool* pool = key_peek(items[i].key, items[i].klen);
+		if (pool == NULL) {
+			logger_error("no pool for key: %s", items[i].key);
+			return -1;
+		}
+
+		std::vector<memcache_group>::iterator it = groups.begin();
+		for (; it != groups.end(); ++it) {
+			if (it->pool == pool) {
+				break;
+			}
+		}
+
+		if (it == groups.end()) {
+			memcache_group group;
+			group.pool = pool;
+			group.conn = NULL;
+			group.sent = false;
+			groups.push_back(group);
+			it = groups.end() - 1;
+		}
+		it->items.push_back(&items[i]);
+	}
+
+	// send the requests to all the nodes first
+	for (std::vector<memcache_group>::iterator it = groups.begin();
+		it != groups.end(); ++it) {
+
+		it->conn = (memcache*) it->pool->peek();
+		if (it->conn == NULL) {
+			logger_error("peek connection from %s error",
+				it->pool->get_addr());
+			continue;
+		}
+
+		bool has_tried = false;
+		it->conn->set_binary(binary_);
+		it->conn->build_multi(&it->items[0], it->items.size());
+		it->sent = it->conn->send_multi(has_tried);
+		if (!it->sent) {
+			logger_error("send to %s error: %s",
+				it->pool->get_addr(), it->conn->last_serror());
+		}
+	}
+
+	// and then read the replies of them one by one
+	int nfound = 0;
+	bool failed = false;
+
+	for (std::vector<memcache_group>::iterator it = groups.begin();
+		it != groups.end(); ++it) {
+
+		if (it->conn == NULL) {
+			failed = true;
+			continue;
+		}
+
+		int ret = -1;
+		if (it->sent) {
+			ret = it->conn->recv_multi(&it->items[0],
+				it->items.size(), dbuf);
+		}
+
+		if (ret == -2) {
+			// the connection kept may have been closed, retry it
+			// on a new connection alone
+			ret = it->conn->get_multi(it->items, dbuf);
+		}
+
+		if (ret < 0) {
+			logger_error("get_multi from %s error: %s",
+				it->pool->get_addr(), it->conn->last_serror());
+			failed = true;
+			it->pool->put(it->conn, false);
+		} else {
+			nfound += ret;
+			it->pool->put(it->conn, true);
+		}
+	}
+
+	return failed ? -1 : nfound;
+}
+
 } // namespace acl
 
 #endif // ACL_CLIENT_ONLY
@@ -41,13 +41,42 @@ mime_base64::~mime_base64(void)
 
 void mime_base64::encode(const char* in, int n, string* out)
 {
-	mime_base64 coder(false, false);
-	coder.encode_update(in, n, out);
-	coder.encode_finish(out);
+	if (n <= 0) {
+		return;
+	}
+
+	// Encode into the tail of out directly, which is the same as what
+	// encode_update() + encode_finish() do without CRLF.
+	ACL_VSTRING* vs = out->vstring();
+	size_t len = ACL_VSTRING_LEN(vs);
+
+	ACL_VSTRING_SPACE(vs, (ssize_t) ACL_BASE64_ENCODE_SIZE(n));
+	len += acl_base64_encode_buf(in, (size_t) n, acl_vstring_end(vs));
+	ACL_VSTRING_AT_OFFSET(vs, (int) len);
+	ACL_VSTRING_TERMINATE(vs);
 }
 
 void mime_base64::decode(const char* in, int n, string* out)
 {
+	if (n <= 0) {
+		return;
+	}
+
+	// Try the strict and fast decoder first, and fallback to the loose
+	// one which skips CRLF and the invalid chars if the data isn't clean.
+	ACL_VSTRING* vs = out->vstring();
+	size_t len = ACL_VSTRING_LEN(vs);
+
+	ACL_VSTRING_SPACE(vs, (ssize_t) ACL_BASE64_DECODE_SIZE(n));
+	int ret = acl_base64_decode_buf(in, (size_t) n, acl_vstring_end(vs));
+	if (ret >= 0) {
+		ACL_VSTRING_AT_OFFSET(vs, (int) (len + ret));
+		ACL_VSTRING_TERMINATE(vs);
+		return;
+	}
+
+	ACL_VSTRING_TERMINATE(vs);
+
 	mime_base64 decoder(false, false);
 	decoder.decode_update(in, n, out);
 	decoder.decode_finish(out);
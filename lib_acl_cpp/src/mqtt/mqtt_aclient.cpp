@@ -285,7 +285,7 @@ bool mqtt_aclient::read_callback(char* data, int len) {
 			data += len - left;
 			len   = left;
 		} else {
-			return true;
+			return this->on_read_done();
 		}
 	}
 }
@@ -0,0 +1,741 @@
+#include "acl_stdafx.hpp"
+#ifndef ACL_PREPARE_COMPILE
+#include "acl_cpp/stdlib/log.hpp"
+#include "acl_cpp/mqtt/mqtt_message.hpp"
+#include "acl_cpp/mqtt/mqtt_connect.hpp"
+#include "acl_cpp/mqtt/mqtt_connack.hpp"
+#include "acl_cpp/mqtt/mqtt_publish.hpp"
+#include "acl_cpp/mqtt/mqtt_puback.hpp"
+#include "acl_cpp/mqtt/mqtt_pubrec.hpp"
+#include "acl_cpp/mqtt/mqtt_pubrel.hpp"
+#include "acl_cpp/mqtt/mqtt_pubcomp.hpp"
+#include "acl_cpp/mqtt/mqtt_subscribe.hpp"
+#include "acl_cpp/mqtt/mqtt_suback.hpp"
+#include "acl_cpp/mqtt/mqtt_unsubscribe.hpp"
+#include "acl_cpp/mqtt/mqtt_unsuback.hpp"
+#include "acl_cpp/mqtt/mqtt_pingresp.hpp"
+#include "acl_cpp/mqtt/mqtt_broker.hpp"
+#endif
+
+#include <map>
+
+namespace acl {
+
+#define	SHARE_PREFIX	"$share/"
+#define	SUBACK_FAILURE	0x80
+#define	IOV_BATCH	256
+
+// the serialized message shared by the sessions.
+struct mqtt_frame {
+	string   data;
+	unsigned id_off;	// the offset of the packet id for QoS1
+	int      refer;
+
+	mqtt_frame() : id_off(0), refer(1) {}
+};
+
+static void frame_release(mqtt_frame* frame) {
+	if (--frame->refer == 0) {
+		delete frame;
+	}
+}
+
+struct mqtt_sub_entry {
+	mqtt_session* sess;
+	unsigned char qos;
+	size_t        sidx;	// the index in sess->subs_
+};
+
+// the sessions subscribing the same filter, or the same shared group.
+struct mqtt_sub_list {
+	mqtt_topic_node* node;
+	std::string      group;	// empty if not shared
+	std::vector<mqtt_sub_entry> subs;
+	size_t           next;	// for round robin in the shared group
+
+	mqtt_sub_list(mqtt_topic_node* n, const std::string& g)
+	: node(n), group(g), next(0) {}
+};
+
+struct mqtt_topic_node {
+	mqtt_topic_node* parent;
+	std::string      level;
+	std::map<std::string, mqtt_topic_node*> children;
+	mqtt_sub_list*   subs;
+	std::map<std::string, mqtt_sub_list*> shared;
+
+	mqtt_topic_node(mqtt_topic_node* p, const std::string& l)
+	: parent(p), level(l), subs(NULL) {}
+
+	~mqtt_topic_node() {
+		for (std::map<std::string, mqtt_topic_node*>::iterator
+			it = children.begin(); it != children.end(); ++it) {
+			delete it->second;
+		}
+		delete subs;
+		for (std::map<std::string, mqtt_sub_list*>::iterator
+			it = shared.begin(); it != shared.end(); ++it) {
+			delete it->second;
+		}
+	}
+
+	bool empty() const {
+		return subs == NULL && shared.empty() && children.empty();
+	}
+};
+
+// split the topic or filter into levels, "a//b" has an empty level.
+static void split_levels(const char* topic, std::vector<std::string>& out) {
+	out.clear();
+	const char* ptr = topic;
+	while (true) {
+		const char* end = strchr(ptr, '/');
+		if (end == NULL) {
+			out.push_back(ptr);
+			break;
+		}
+		out.push_back(std::string(ptr, end - ptr));
+		ptr = end + 1;
+	}
+}
+
+static bool topic_valid(const char* topic) {
+	return *topic != 0 && strpbrk(topic, "+#") == NULL;
+}
+
+static bool filter_valid(const std::vector<std::string>& levels) {
+	for (size_t i = 0; i < levels.size(); i++) {
+		const std::string& level = levels[i];
+		if (level.find_first_of("+#") == std::string::npos) {
+			continue;
+		}
+		if (level.size() > 1) {
+			return false;
+		}
+		if (level[0] == '#' && i != levels.size() - 1) {
+			return false;
+		}
+	}
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+mqtt_session::mqtt_session(mqtt_broker& broker)
+: broker_(broker)
+, connected_(false)
+, dirty_(false)
+, dirty_idx_(0)
+, flushing_(false)
+, next_id_(0)
+, dropped_(0)
+, mark_(0)
+, mark_qos_(0)
+{
+}
+
+mqtt_session::~mqtt_session() {
+	broker_.detach(*this);
+	release(out_);
+	release(sending_);
+	for (std::deque<mqtt_frame*>::iterator it = waiting_.begin();
+		it != waiting_.end(); ++it) {
+		frame_release(*it);
+	}
+}
+
+bool mqtt_session::handle(const mqtt_message& msg) {
+	return broker_.handle(*this, msg);
+}
+
+void mqtt_session::enqueue(mqtt_frame* frame, unsigned off, unsigned len) {
+	out_item item;
+	item.frame = frame;
+	item.off   = off;
+	item.len   = len;
+
+	frame->refer++;
+	out_.push_back(item);
+	if (out_.size() == 1) {
+		broker_.set_dirty(*this);
+		this->on_pending();
+	}
+}
+
+void mqtt_session::enqueue_id(unsigned short id) {
+	out_item item;
+	item.frame = NULL;
+	item.off   = 0;
+	item.len   = 2;
+	item.id[0] = (unsigned char) (id >> 8);
+	item.id[1] = (unsigned char) (id & 0xff);
+
+	// only follows the fixed header of the frame, never be the first
+	out_.push_back(item);
+}
+
+void mqtt_session::send_qos1(mqtt_frame* frame) {
+	if (inflight_.size() >= broker_.inflight_max_) {
+		if (waiting_.size() >= broker_.queue_max_) {
+			dropped_++;
+			return;
+		}
+		frame->refer++;
+		waiting_.push_back(frame);
+		return;
+	}
+
+	// inflight_max_ is less than 65536, so there is always a free id
+	unsigned short id;
+	do {
+		id = ++next_id_;
+	} while (id == 0 || inflight_.find(id) != inflight_.end());
+
+	inflight_.insert(id);
+
+	// share the frame except the packet id of the session
+	unsigned size = (unsigned) frame->data.size();
+	enqueue(frame, 0, frame->id_off);
+	enqueue_id(id);
+	if (size > frame->id_off + 2) {
+		enqueue(frame, frame->id_off + 2, size - frame->id_off - 2);
+	}
+}
+
+bool mqtt_session::send(mqtt_message& msg) {
+	mqtt_frame* frame = NEW mqtt_frame;
+	if (!msg.to_string(frame->data) || frame->data.empty()) {
+		logger_error("build mqtt message error, type=%s",
+			mqtt_type_desc(msg.get_header().get_type()));
+		frame_release(frame);
+		return false;
+	}
+
+	enqueue(frame, 0, (unsigned) frame->data.size());
+	frame_release(frame);
+	return true;
+}
+
+void mqtt_session::release(std::vector<out_item>& items) {
+	for (std::vector<out_item>::iterator it = items.begin();
+		it != items.end(); ++it) {
+		if (it->frame) {
+			frame_release(it->frame);
+		}
+	}
+	items.clear();
+}
+
+bool mqtt_session::flush() {
+	if (flushing_) {
+		return true;
+	}
+
+	flushing_ = true;
+
+	struct iovec iov[IOV_BATCH];
+	bool ret = true;
+
+	// the messages queued when writing will be written in next round,
+	// the items being written mustn't be moved by the queueing.
+	while (ret && !out_.empty()) {
+		sending_.swap(out_);
+
+		size_t i = 0;
+		while (i < sending_.size()) {
+			int n = 0;
+			for (; i < sending_.size() && n < IOV_BATCH; i++, n++) {
+				out_item& item = sending_[i];
+				if (item.frame) {
+					iov[n].iov_base = (char*)
+						item.frame->data.c_str() + item.off;
+				} else {
+					iov[n].iov_base = (char*) item.id;
+				}
+				iov[n].iov_len = item.len;
+			}
+
+			if (!this->write_iov(iov, n)) {
+				ret = false;
+				break;
+			}
+		}
+
+		release(sending_);
+	}
+
+	flushing_ = false;
+	return ret;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+mqtt_broker::mqtt_broker(size_t inflight_max, size_t queue_max)
+: inflight_max_(inflight_max > 0 ? inflight_max : 1)
+, queue_max_(queue_max)
+, nsubs_(0)
+, seq_(0)
+{
+	// the packet id of QoS1 is from 1 to 65535
+	if (inflight_max_ > 65535) {
+		inflight_max_ = 65535;
+	}
+
+	root_ = NEW mqtt_topic_node(NULL, "");
+}
+
+mqtt_broker::~mqtt_broker() {
+	delete root_;
+}
+
+void mqtt_broker::set_dirty(mqtt_session& sess) {
+	if (!sess.dirty_) {
+		sess.dirty_     = true;
+		sess.dirty_idx_ = dirty_.size();
+		dirty_.push_back(&sess);
+	}
+}
+
+void mqtt_broker::flush() {
+	while (!dirty_.empty()) {
+		mqtt_session* sess = dirty_.back();
+		dirty_.pop_back();
+		sess->dirty_ = false;
+
+		// the failure will be found when reading the connection
+		(void) sess->flush();
+	}
+}
+
+void mqtt_broker::detach(mqtt_session& sess) {
+	while (!sess.subs_.empty()) {
+		remove(sess, sess.subs_.size() - 1);
+	}
+
+	if (sess.dirty_) {
+		mqtt_session* last = dirty_.back();
+		dirty_[sess.dirty_idx_] = last;
+		last->dirty_idx_ = sess.dirty_idx_;
+		dirty_.pop_back();
+		sess.dirty_ = false;
+	}
+}
+
+mqtt_sub_list* mqtt_broker::find_list(const char* filter, bool create) {
+	std::string group;
+	if (strncmp(filter, SHARE_PREFIX, sizeof(SHARE_PREFIX) - 1) == 0) {
+		const char* name = filter + sizeof(SHARE_PREFIX) - 1;
+		const char* end  = strchr(name, '/');
+		if (end == NULL || end == name) {
+			return NULL;
+		}
+		group.assign(name, end - name);
+		if (group.find_first_of("+#") != std::string::npos) {
+			return NULL;
+		}
+		filter = end + 1;
+	}
+
+	if (*filter == 0) {
+		return NULL;
+	}
+
+	split_levels(filter, levels_);
+	if (!filter_valid(levels_)) {
+		return NULL;
+	}
+
+	mqtt_topic_node* node = root_;
+	for (std::vector<std::string>::const_iterator cit = levels_.begin();
+		cit != levels_.end(); ++cit) {
+		std::map<std::string, mqtt_topic_node*>::iterator it =
+			node->children.find(*cit);
+		if (it != node->children.end()) {
+			node = it->second;
+		} else if (create) {
+			mqtt_topic_node* child = NEW mqtt_topic_node(node, *cit);
+			node->children[*cit] = child;
+			node = child;
+		} else {
+			return NULL;
+		}
+	}
+
+	if (group.empty()) {
+		if (node->subs == NULL && create) {
+			node->subs = NEW mqtt_sub_list(node, group);
+		}
+		return node->subs;
+	}
+
+	std::map<std::string, mqtt_sub_list*>::iterator it =
+		node->shared.find(group);
+	if (it != node->shared.end()) {
+		return it->second;
+	}
+	if (!create) {
+		return NULL;
+	}
+	mqtt_sub_list* list = NEW mqtt_sub_list(node, group);
+	node->shared[group] = list;
+	return list;
+}
+
+int mqtt_broker::subscribe(mqtt_session& sess, const char* filter,
+	mqtt_qos_t qos) {
+
+	mqtt_sub_list* list = find_list(filter, true);
+	if (list == NULL) {
+		logger_warn("invalid topic filter=%s, cid=%s",
+			filter, sess.get_cid());
+		return -1;
+	}
+
+	unsigned char granted = (unsigned char)
+		(qos > MQTT_QOS1 ? MQTT_QOS1 : qos);
+
+	// subscribing the same filter again replaces the qos.
+	for (std::vector<mqtt_session::sub_ref>::const_iterator cit =
+		sess.subs_.begin(); cit != sess.subs_.end(); ++cit) {
+		if (cit->list == list) {
+			list->subs[cit->idx].qos = granted;
+			return granted;
+		}
+	}
+
+	mqtt_sub_entry entry;
+	entry.sess = &sess;
+	entry.qos  = granted;
+	entry.sidx = sess.subs_.size();
+
+	mqtt_session::sub_ref ref;
+	ref.list = list;
+	ref.idx  = list->subs.size();
+
+	list->subs.push_back(entry);
+	sess.subs_.push_back(ref);
+	nsubs_++;
+	return granted;
+}
+
+bool mqtt_broker::unsubscribe(mqtt_session& sess, const char* filter) {
+	mqtt_sub_list* list = find_list(filter, false);
+	if (list == NULL) {
+		return false;
+	}
+
+	for (size_t i = 0; i < sess.subs_.size(); i++) {
+		if (sess.subs_[i].list == list) {
+			remove(sess, i);
+			return true;
+		}
+	}
+	return false;
+}
+
+void mqtt_broker::remove(mqtt_session& sess, size_t idx) {
+	mqtt_session::sub_ref ref = sess.subs_[idx];
+	mqtt_sub_list* list = ref.list;
+
+	// move the last one into the hole, and update its back reference.
+	size_t last = list->subs.size() - 1;
+	if (ref.idx != last) {
+		mqtt_sub_entry& moved = list->subs[ref.idx];
+		moved = list->subs[last];
+		moved.sess->subs_[moved.sidx].idx = ref.idx;
+	}
+	list->subs.pop_back();
+
+	last = sess.subs_.size() - 1;
+	if (idx != last) {
+		mqtt_session::sub_ref& moved = sess.subs_[idx];
+		moved = sess.subs_[last];
+		moved.list->subs[moved.idx].sidx = idx;
+	}
+	sess.subs_.pop_back();
+	nsubs_--;
+
+	if (!list->subs.empty()) {
+		return;
+	}
+
+	mqtt_topic_node* node = list->node;
+	if (list->group.empty()) {
+		node->subs = NULL;
+	} else {
+		node->shared.erase(list->group);
+	}
+	delete list;
+	prune(node);
+}
+
+void mqtt_broker::prune(mqtt_topic_node* node) {
+	while (node != root_ && node->empty()) {
+		mqtt_topic_node* parent = node->parent;
+		parent->children.erase(node->level);
+		delete node;
+		node = parent;
+	}
+}
+
+void mqtt_broker::mark(mqtt_session* sess, unsigned char qos) {
+	if (sess->mark_ != seq_) {
+		sess->mark_     = seq_;
+		sess->mark_qos_ = qos;
+		targets_.push_back(sess);
+	} else if (qos > sess->mark_qos_) {
+		sess->mark_qos_ = qos;
+	}
+}
+
+void mqtt_broker::collect(mqtt_sub_list* list) {
+	if (list->subs.empty()) {
+		return;
+	}
+
+	if (list->group.empty()) {
+		for (std::vector<mqtt_sub_entry>::const_iterator cit =
+			list->subs.begin(); cit != list->subs.end(); ++cit) {
+			mark(cit->sess, cit->qos);
+		}
+	} else {
+		const mqtt_sub_entry& entry =
+			list->subs[list->next++ % list->subs.size()];
+		mark(entry.sess, entry.qos);
+	}
+}
+
+void mqtt_broker::collect(mqtt_topic_node* node) {
+	if (node->subs) {
+		collect(node->subs);
+	}
+	for (std::map<std::string, mqtt_sub_list*>::iterator it =
+		node->shared.begin(); it != node->shared.end(); ++it) {
+		collect(it->second);
+	}
+}
+
+void mqtt_broker::match(mqtt_topic_node* node, size_t i) {
+	std::map<std::string, mqtt_topic_node*>::iterator it;
+
+	if (i == levels_.size()) {
+		collect(node);
+		// "a/#" matches "a" too
+		it = node->children.find("#");
+		if (it != node->children.end()) {
+			collect(it->second);
+		}
+		return;
+	}
+
+	// the wildcards don't match the first level beginning with '$'
+	if (i > 0 || levels_[0].empty() || levels_[0][0] != '$') {
+		it = node->children.find("#");
+		if (it != node->children.end()) {
+			collect(it->second);
+		}
+		it = node->children.find("+");
+		if (it != node->children.end()) {
+			match(it->second, i + 1);
+		}
+	}
+
+	it = node->children.find(levels_[i]);
+	if (it != node->children.end()) {
+		match(it->second, i + 1);
+	}
+}
+
+size_t mqtt_broker::publish(const char* topic, const void* data, size_t len,
+	mqtt_qos_t qos) {
+
+	if (!topic_valid(topic)) {
+		logger_error("invalid topic=%s", topic);
+		return 0;
+	}
+
+	split_levels(topic, levels_);
+	seq_++;
+	targets_.clear();
+	match(root_, 0);
+
+	if (targets_.empty()) {
+		return 0;
+	}
+
+	// serialize the message only once for each qos, and share it.
+	mqtt_frame* frames[2] = { NULL, NULL };
+	size_t n = 0;
+
+	for (std::vector<mqtt_session*>::iterator it = targets_.begin();
+		it != targets_.end(); ++it) {
+		mqtt_session* sess = *it;
+		int q = qos > MQTT_QOS1 ? MQTT_QOS1 : qos;
+		if (q > sess->mark_qos_) {
+			q = sess->mark_qos_;
+		}
+
+		if (frames[q] == NULL) {
+			mqtt_publish pub;
+			pub.set_topic(topic);
+			pub.set_payload((unsigned) len, (const char*) data);
+			pub.get_header().set_qos((mqtt_qos_t) q);
+			if (q != MQTT_QOS0) {
+				pub.set_pkt_id(1);  // replaced by each session
+			}
+
+			mqtt_frame* frame = NEW mqtt_frame;
+			mqtt_message& msg = pub;
+			if (!msg.to_string(frame->data)) {
+				logger_error("build publish error, topic=%s", topic);
+				frame_release(frame);
+				break;
+			}
+			frame->id_off = (unsigned) (frame->data.size() - len - 2);
+			frames[q] = frame;
+		}
+
+		if (q == MQTT_QOS0) {
+			sess->enqueue(frames[0], 0,
+				(unsigned) frames[0]->data.size());
+		} else {
+			sess->send_qos1(frames[1]);
+		}
+		n++;
+	}
+
+	for (size_t i = 0; i < 2; i++) {
+		if (frames[i]) {
+			frame_release(frames[i]);
+		}
+	}
+	return n;
+}
+
+bool mqtt_broker::on_connect(mqtt_session& sess, const mqtt_message& msg) {
+	if (sess.connected_) {
+		logger_error("duplicate CONNECT, cid=%s", sess.get_cid());
+		return false;
+	}
+
+	const mqtt_connect& conn = (const mqtt_connect&) msg;
+	const char* cid = conn.get_cid();
+	sess.cid_ = cid ? cid : "";
+	sess.connected_ = true;
+
+	mqtt_connack ack;
+	ack.set_connack_code(MQTT_CONNACK_OK);
+	return sess.send(ack);
+}
+
+bool mqtt_broker::on_publish(mqtt_session& sess, const mqtt_message& msg) {
+	const mqtt_publish& pub = (const mqtt_publish&) msg;
+	mqtt_qos_t qos = pub.get_header().get_qos();
+	const char* topic = pub.get_topic();
+
+	if (!topic_valid(topic)) {
+		logger_error("invalid topic=%s, cid=%s", topic, sess.get_cid());
+		return false;
+	}
+
+	const string& payload = pub.get_payload();
+	publish(topic, payload.c_str(), payload.size(), qos);
+
+	// QoS2 is handled as QoS1: routed when received, and PUBREL is
+	// answered with PUBCOMP directly.
+	if (qos == MQTT_QOS1) {
+		mqtt_puback ack;
+		ack.set_pkt_id(pub.get_pkt_id());
+		return sess.send(ack);
+	} else if (qos == MQTT_QOS2) {
+		mqtt_pubrec rec;
+		rec.set_pkt_id(pub.get_pkt_id());
+		return sess.send(rec);
+	}
+	return true;
+}
+
+bool mqtt_broker::on_puback(mqtt_session& sess, unsigned short id) {
+	if (sess.inflight_.erase(id) == 0) {
+		return true;
+	}
+
+	while (sess.inflight_.size() < inflight_max_ && !sess.waiting_.empty()) {
+		mqtt_frame* frame = sess.waiting_.front();
+		sess.waiting_.pop_front();
+		sess.send_qos1(frame);
+		frame_release(frame);
+	}
+	return true;
+}
+
+bool mqtt_broker::on_subscribe(mqtt_session& sess, const mqtt_message& msg) {
+	const mqtt_subscribe& sub = (const mqtt_subscribe&) msg;
+	const std::vector<std::string>& topics = sub.get_topics();
+	const std::vector<mqtt_qos_t>& qoses   = sub.get_qoses();
+
+	mqtt_suback ack;
+	ack.set_pkt_id(sub.get_pkt_id());
+
+	for (size_t i = 0; i < topics.size(); i++) {
+		mqtt_qos_t qos = i < qoses.size() ? qoses[i] : MQTT_QOS0;
+		int granted = subscribe(sess, topics[i].c_str(), qos);
+		ack.add_topic_qos(granted < 0 ?
+			(mqtt_qos_t) SUBACK_FAILURE : (mqtt_qos_t) granted);
+	}
+
+	return sess.send(ack);
+}
+
+bool mqtt_broker::on_unsubscribe(mqtt_session& sess, const mqtt_message& msg) {
+	const mqtt_unsubscribe& unsub = (const mqtt_unsubscribe&) msg;
+	const std::vector<std::string>& topics = unsub.get_topics();
+
+	for (std::vector<std::string>::const_iterator cit = topics.begin();
+		cit != topics.end(); ++cit) {
+		(void) unsubscribe(sess, cit->c_str());
+	}
+
+	mqtt_unsuback ack;
+	ack.set_pkt_id(unsub.get_pkt_id());
+	return sess.send(ack);
+}
+
+bool mqtt_broker::handle(mqtt_session& sess, const mqtt_message& msg) {
+	mqtt_type_t type = msg.get_header().get_type();
+
+	if (!sess.connected_ && type != MQTT_CONNECT) {
+		logger_error("CONNECT expected, type=%s", mqtt_type_desc(type));
+		return false;
+	}
+
+	switch (type) {
+	case MQTT_CONNECT:
+		return on_connect(sess, msg);
+	case MQTT_PUBLISH:
+		return on_publish(sess, msg);
+	case MQTT_PUBACK:
+		return on_puback(sess, ((const mqtt_puback&) msg).get_pkt_id());
+	case MQTT_PUBREL: {
+		mqtt_pubcomp comp;
+		comp.set_pkt_id(((const mqtt_pubrel&) msg).get_pkt_id());
+		return sess.send(comp);
+	}
+	case MQTT_SUBSCRIBE:
+		return on_subscribe(sess, msg);
+	case MQTT_UNSUBSCRIBE:
+		return on_unsubscribe(sess, msg);
+	case MQTT_PINGREQ: {
+		mqtt_pingresp pong;
+		return sess.send(pong);
+	}
+	case MQTT_DISCONNECT:
+		return false;
+	default:
+		logger_error("unexpected type=%s, cid=%s",
+			mqtt_type_desc(type), sess.get_cid());
+		return false;
+	}
+}
+
+} // namespace acl
@@ -8,6 +8,7 @@
 #include "acl_cpp/stream/fstream.hpp"
 #include "acl_cpp/queue/queue_manager.hpp"
 #include "acl_cpp/queue/queue_file.hpp"
+#include "acl_cpp/queue/queue_log.hpp"
 #endif
 
 #ifdef ACL_WINDOWS
@@ -33,6 +34,11 @@ queue_file::queue_file(void)
 , m_bLocked(false)
 , m_bLockerOpened(false)
 , nwriten_(0)
+, log_(NULL)
+, log_id_(-1)
+, log_buf_(NULL)
+, log_off_(0)
+, log_stamp_(0)
 {
 
 }
@@ -47,7 +53,6 @@ bool queue_file::create(const char* home, const char* queueName,
 {
 	acl_assert(width > 0);
 
-	struct timeval tv;
 	acl::string buf;
 	acl::fstream* fp = NULL;
 	int   i = 0;
@@ -57,26 +62,8 @@ bool queue_file::create(const char* home, const char* queueName,
 	ACL_SAFE_STRNCPY(m_queueName, queueName, sizeof(m_queueName));
 	ACL_SAFE_STRNCPY(m_extName, extName, sizeof(m_extName));
 
-	unsigned int n;
-
 	while (true) {
-		// ļ
-		memset(&tv, 0, sizeof(tv));
-		gettimeofday(&tv, NULL);
-		safe_snprintf(m_partName, sizeof(m_partName),
-			"%u_%lu_%08x_%08x_%u",
-			(unsigned int) getpid(),
-			(unsigned long) acl::thread::thread_self(),
-			(unsigned int) tv.tv_sec,
-			(unsigned int) tv.tv_usec,
-			(unsigned int) __counter);
-		if (__counter++ >= 1024000) {
-			__counter = 0;
-		}
-
-		// Ŀ¼
-		n = queue_manager::hash_queueSub(m_partName, width);
-		safe_snprintf(m_queueSub, sizeof(m_queueSub), "%u", n);
+		make_partName(width);
 
 		buf.clear();
 		buf << m_home << PATH_SEP << m_queueName << PATH_SEP << m_queueSub
@@ -141,6 +128,233 @@ END:
 	return true;
 }
 
+void queue_file::make_partName(unsigned width)
+{
+	struct timeval tv;
+
+	// ļ
+	memset(&tv, 0, sizeof(tv));
+	gettimeofday(&tv, NULL);
+	safe_snprintf(m_partName, sizeof(m_partName),
+		"%u_%lu_%08x_%08x_%u",
+		(unsigned int) getpid(),
+		(unsigned long) acl::thread::thread_self(),
+		(unsigned int) tv.tv_sec,
+		(unsigned int) tv.tv_usec,
+		(unsigned int) __counter);
+	if (__counter++ >= 1024000) {
+		__counter = 0;
+	}
+
+	// Ŀ¼
+	unsigned int n = queue_manager::hash_queueSub(m_partName, width);
+	safe_snprintf(m_queueSub, sizeof(m_queueSub), "%u", n);
+}
+
+void queue_file::make_filePath(void)
+{
+	m_filePath.clear();
+	m_filePath << m_home << PATH_SEP << m_queueName << PATH_SEP
+		<< (log_ ? ".log" : m_queueSub) << PATH_SEP
+		<< m_partName << "." << m_extName;
+}
+
+bool queue_file::create(queue_log* log, const char* home,
+	const char* queueName, const char* extName, unsigned width)
+{
+	acl_assert(width > 0);
+
+	ACL_SAFE_STRNCPY(m_home, home, sizeof(m_home));
+	ACL_SAFE_STRNCPY(m_queueName, queueName, sizeof(m_queueName));
+	ACL_SAFE_STRNCPY(m_extName, extName, sizeof(m_extName));
+
+	// the name is unique for the key of the record, and no file created
+	make_partName(width);
+
+	log_       = log;
+	log_id_    = -1;
+	log_buf_   = NEW string;
+	log_off_   = 0;
+	log_stamp_ = time(NULL);
+	make_filePath();
+	return true;
+}
+
+bool queue_file::open(queue_log* log, long long id, const char* home,
+	const char* queueName)
+{
+	if (m_fp || log_buf_) {
+		logger_fatal("old file(%s) exist", m_filePath.c_str());
+	}
+
+	string key, ext;
+	log_buf_ = NEW string;
+	if (!log->read(id, &key, &ext, log_buf_, &log_stamp_)) {
+		delete log_buf_;
+		log_buf_ = NULL;
+		return false;
+	}
+
+	ACL_SAFE_STRNCPY(m_home, home, sizeof(m_home));
+	ACL_SAFE_STRNCPY(m_queueName, queueName, sizeof(m_queueName));
+	ACL_SAFE_STRNCPY(m_partName, key.c_str(), sizeof(m_partName));
+	ACL_SAFE_STRNCPY(m_extName, ext.c_str(), sizeof(m_extName));
+
+	log_     = log;
+	log_id_  = id;
+	log_off_ = 0;
+	nwriten_ = log_buf_->size();
+	make_filePath();
+	return true;
+}
+
+bool queue_file::log_commit(void)
+{
+	if (log_ == NULL) {
+		logger_error("not in log");
+		return false;
+	}
+	if (log_id_ >= 0) {
+		return true;
+	}
+
+	log_id_ = log_->append(m_partName, m_extName, log_buf_->c_str(),
+		log_buf_->size());
+	if (log_id_ < 0) {
+		logger_error("append %s to log error", m_partName);
+		return false;
+	}
+
+	// the appenders are committed in group with one msync
+	if (!log_->commit(log_id_)) {
+		logger_error("commit %s to log error", m_partName);
+		return false;
+	}
+	return true;
+}
+
+bool queue_file::log_export(const char* queueName, const char* extName,
+	unsigned width)
+{
+	if (log_ == NULL) {
+		logger_error("not in log");
+		return false;
+	}
+
+	unsigned int n = queue_manager::hash_queueSub(m_partName, width);
+	safe_snprintf(m_queueSub, sizeof(m_queueSub), "%u", n);
+
+	string buf;
+	buf << m_home << PATH_SEP << queueName << PATH_SEP << m_queueSub;
+
+	string path(buf);
+	path << PATH_SEP << m_partName << "." << extName;
+
+	fstream* fp = NEW fstream;
+	if (!fp->open(path, O_RDWR | O_CREAT | O_EXCL, 0600)) {
+		if (last_error() != ENOENT || acl_make_dirs(buf.c_str(), 0700) == -1
+			|| !fp->open(path, O_RDWR | O_CREAT | O_EXCL, 0600)) {
+
+			logger_error("create %s error(%s)", path.c_str(),
+				last_serror());
+			delete fp;
+			return false;
+		}
+	}
+
+	if (!log_buf_->empty() && fp->write(log_buf_->c_str(),
+		log_buf_->size()) != (int) log_buf_->size()) {
+
+		logger_error("write %s error(%s)", path.c_str(), last_serror());
+		fp->close();
+		::remove(path.c_str());
+		delete fp;
+		return false;
+	}
+
+	queue_log* log = log_;
+	long long id   = log_id_;
+
+	delete log_buf_;
+	log_buf_ = NULL;
+	log_     = NULL;
+	log_id_  = -1;
+	m_fp     = fp;
+
+	ACL_SAFE_STRNCPY(m_queueName, queueName, sizeof(m_queueName));
+	ACL_SAFE_STRNCPY(m_extName, extName, sizeof(m_extName));
+	make_filePath();
+
+	m_bLockerOpened = m_locker.open(m_fp->file_handle());
+
+	if (id >= 0) {
+		log->remove(id);
+	}
+	return true;
+}
+
+bool queue_file::log_move(queue_log* log, const char* queueName,
+	const char* extName)
+{
+	if (log_ == NULL && m_fp == NULL) {
+		logger_error("file not opened");
+		return false;
+	}
+
+	string* buf = NEW string;
+
+	if (log_) {
+		*buf = *log_buf_;
+	} else {
+		char tmp[8192];
+		int  ret;
+
+		m_fp->fseek(0, SEEK_SET);
+		while ((ret = m_fp->read(tmp, sizeof(tmp), false)) > 0) {
+			buf->append(tmp, ret);
+		}
+	}
+
+	long long id = log->append(m_partName, extName, buf->c_str(),
+		buf->size());
+	if (id < 0 || !log->commit(id)) {
+		logger_error("append %s to log error", m_filePath.c_str());
+		if (id >= 0) {
+			log->remove(id);
+		}
+		delete buf;
+		return false;
+	}
+
+	// remove the old one after the new one committed
+	if (log_) {
+		if (log_id_ >= 0) {
+			log_->remove(log_id_);
+		}
+		this->close();
+	} else {
+		string path(m_filePath);
+		this->close();
+		m_bLockerOpened = false;
+		if (::remove(path.c_str()) != 0) {
+			logger_error("remove %s error(%s)", path.c_str(),
+				last_serror());
+		}
+	}
+
+	log_       = log;
+	log_id_    = id;
+	log_buf_   = buf;
+	log_off_   = 0;
+	log_stamp_ = time(NULL);
+	nwriten_   = buf->size();
+
+	ACL_SAFE_STRNCPY(m_queueName, queueName, sizeof(m_queueName));
+	ACL_SAFE_STRNCPY(m_extName, extName, sizeof(m_extName));
+	make_filePath();
+	return true;
+}
+
 bool queue_file::open(const char* filePath)
 {
 	string home, queueName, queueSub, partName, extName;
@@ -207,6 +421,11 @@ bool queue_file::open(const char* home, const char* queueName,
 
 void queue_file::close(void)
 {
+	if (log_buf_) {
+		delete log_buf_;
+		log_buf_ = NULL;
+		nwriten_ = 0;
+	}
 	if (m_fp) {
 		delete m_fp;
 		m_fp = NULL;
@@ -221,6 +440,9 @@ acl::fstream* queue_file::get_fstream(void) const
 
 time_t queue_file::get_ctime(void) const
 {
+	if (log_) {
+		return log_stamp_;
+	}
 	if (m_fp == NULL) {
 		logger_error("m_fp null");
 		return (time_t) -1;
@@ -244,6 +466,16 @@ bool queue_file::write(const void* data, size_t len)
 		logger_error("input invalid");
 		return false;
 	}
+	if (log_) {
+		// the record appended can't be modified
+		if (log_id_ >= 0 || log_buf_ == NULL) {
+			logger_error("record %s committed", m_partName);
+			return false;
+		}
+		log_buf_->append(data, len);
+		nwriten_ += len;
+		return true;
+	}
 	if (m_fp == NULL) {
 		logger_error("m_fp null");
 		return false;
@@ -268,6 +500,17 @@ int queue_file::format(const char* fmt, ...)
 
 int queue_file::vformat(const char* fmt, va_list ap)
 {
+	if (log_) {
+		if (log_id_ >= 0 || log_buf_ == NULL) {
+			logger_error("record %s committed", m_partName);
+			return -1;
+		}
+		size_t n = log_buf_->size();
+		log_buf_->vformat_append(fmt, ap);
+		nwriten_ += log_buf_->size() - n;
+		return (int) (log_buf_->size() - n);
+	}
+
 	int ret = m_fp->vformat(fmt, ap);
 	if (ret == -1) {
 		logger_error("write to file error(%s)", last_serror());
@@ -283,6 +526,18 @@ int queue_file::read(void* buf, size_t len)
 		logger_error("input invalid");
 		return -1;
 	}
+	if (log_) {
+		if (log_buf_ == NULL || log_off_ >= log_buf_->size()) {
+			return -1;
+		}
+		size_t n = log_buf_->size() - log_off_;
+		if (n > len) {
+			n = len;
+		}
+		memcpy(buf, log_buf_->c_str() + log_off_, n);
+		log_off_ += n;
+		return (int) n;
+	}
 	if (m_fp == NULL) {
 		logger_error("m_fp null");
 		return -1;
@@ -296,6 +551,13 @@ int queue_file::read(void* buf, size_t len)
 
 bool queue_file::remove(void)
 {
+	if (log_) {
+		bool ret = log_id_ < 0 || log_->remove(log_id_);
+		this->close();
+		log_id_ = -1;
+		return ret;
+	}
+
 	this->close();
 #ifdef ACL_WINDOWS
 	if (_unlink(m_filePath.c_str()) != 0) {
@@ -372,17 +634,13 @@ bool queue_file::move_file(const char* queueName, const char* extName)
 void queue_file::set_queueName(const char* queueName)
 {
 	ACL_SAFE_STRNCPY(m_queueName, queueName, sizeof(m_queueName));
-	m_filePath.clear();
-	m_filePath << m_home << PATH_SEP << m_queueName << PATH_SEP
-		<< m_queueSub << PATH_SEP << m_partName << "." << m_extName;
+	make_filePath();
 }
 
 void queue_file::set_extName(const char* extName)
 {
 	ACL_SAFE_STRNCPY(m_extName, extName, sizeof(m_extName));
-	m_filePath.clear();
-	m_filePath << m_home << PATH_SEP << m_queueName << PATH_SEP
-		<< m_queueSub << PATH_SEP << m_partName << "." << m_extName;
+	make_filePath();
 }
 
 bool queue_file::lock(void)
@@ -0,0 +1,814 @@
+#include "acl_stdafx.hpp"
+#ifndef ACL_PREPARE_COMPILE
+#include "acl_cpp/stdlib/snprintf.hpp"
+#include "acl_cpp/stdlib/log.hpp"
+#include "acl_cpp/stdlib/util.hpp"
+#include "acl_cpp/stream/fstream.hpp"
+#include "acl_cpp/queue/queue_log.hpp"
+#endif
+
+#include <algorithm>
+#ifndef ACL_WINDOWS
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#ifdef ACL_WINDOWS
+#define PATH_SEP	'\\'
+#else
+#define PATH_SEP	'/'
+#endif
+
+namespace acl
+{
+
+/*
+ * The segment file: the header of SEG_HDR bytes followed by the records,
+ * each record is aligned to 8 bytes as below:
+ *   log_rec + key + data
+ * The record holds the sequence of its segment, so the stale records left
+ * in the recycled segment will be ignored when recovering.
+ */
+
+#define SEG_MAGIC	"ACLQLOG1"
+#define IDX_MAGIC	"ACLQIDX1"
+#define SEG_HDR		64
+#define IDX_SIZE	4096
+#define REC_DELETED	0x01
+
+#define MAKE_ID(seq, off)	(((long long) (seq) << 32) | (long long) (off))
+#define ID_SEQ(id)		((unsigned) ((id) >> 32))
+#define ID_OFF(id)		((size_t) ((id) & 0xffffffff))
+
+struct log_rec {
+	unsigned len;		// the length of data
+	unsigned crc;		// the crc32 of key and data
+	unsigned stamp;		// the time appended
+	unsigned seq;		// the sequence of the segment
+	unsigned char flags;
+	unsigned char klen;	// the length of key
+	unsigned short pad;
+	unsigned reserved;
+	char ext[32];
+};
+
+struct queue_log_seg {
+	unsigned seq;
+	fstream  fp;
+	char*    base;
+	void*    hmap;
+	size_t   size;
+	size_t   used;
+	size_t   synced;	// the data before it has been synced
+	size_t   dirty;		// the lowest offset updated in place
+};
+
+static size_t rec_size(size_t klen, size_t len)
+{
+	return (sizeof(log_rec) + klen + len + 7) & ~((size_t) 7);
+}
+
+static char* map_file(fstream& fp, size_t size, void** hmap)
+{
+#ifdef ACL_WINDOWS
+	HANDLE h = CreateFileMapping(fp.file_handle(), NULL, PAGE_READWRITE,
+		0, (DWORD) size, NULL);
+	if (h == NULL) {
+		return NULL;
+	}
+	char* base = (char*) MapViewOfFile(h, FILE_MAP_WRITE, 0, 0, size);
+	if (base == NULL) {
+		CloseHandle(h);
+		return NULL;
+	}
+	*hmap = h;
+	return base;
+#else
+	void* base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED,
+		fp.file_handle(), 0);
+	*hmap = NULL;
+	return base == MAP_FAILED ? NULL : (char*) base;
+#endif
+}
+
+static void unmap_file(char* base, size_t size, void* hmap)
+{
+#ifdef ACL_WINDOWS
+	(void) size;
+	UnmapViewOfFile(base);
+	CloseHandle((HANDLE) hmap);
+#else
+	(void) hmap;
+	munmap(base, size);
+#endif
+}
+
+static bool sync_mem(char* addr, size_t len)
+{
+#ifdef ACL_WINDOWS
+	return FlushViewOfFile(addr, len) ? true : false;
+#else
+	static size_t page = (size_t) sysconf(_SC_PAGESIZE);
+	size_t n = ((size_t) addr) % page;
+	return msync(addr - n, len + n, MS_SYNC) == 0;
+#endif
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+queue_log::queue_log(const char* path, size_t seg_size /* = 64M */)
+: path_(path)
+, seg_size_(seg_size)
+, sync_(true)
+, max_spare_(4)
+, opened_(false)
+, cond_(&lock_)
+, syncing_(false)
+, committed_(0)
+, nsync_(0)
+, index_(NULL)
+, index_base_(NULL)
+, index_map_(NULL)
+, index_dirty_(false)
+, head_(MAKE_ID(1, SEG_HDR))
+{
+	if (seg_size_ < 64 * 1024) {
+		seg_size_ = 64 * 1024;
+	} else if (seg_size_ > 0x7fffffff) {
+		seg_size_ = 0x7fffffff;
+	}
+}
+
+queue_log::~queue_log(void)
+{
+	close();
+}
+
+void queue_log::set_sync(bool on)
+{
+	sync_ = on;
+}
+
+void queue_log::set_spare(size_t n)
+{
+	max_spare_ = n;
+}
+
+void queue_log::seg_path(unsigned seq, string& out) const
+{
+	out.format("%s%c%08x.seg", path_.c_str(), PATH_SEP, seq);
+}
+
+bool queue_log::open(void)
+{
+	if (opened_) {
+		return true;
+	}
+
+	if (acl_make_dirs(path_.c_str(), 0700) == -1) {
+		logger_error("create dir: %s error %s", path_.c_str(),
+			last_serror());
+		return false;
+	}
+
+	if (!open_index() || !load_segments()) {
+		close();
+		return false;
+	}
+
+	opened_ = true;
+	return true;
+}
+
+bool queue_log::open_index(void)
+{
+	string path;
+	path.format("%s%cindex", path_.c_str(), PATH_SEP);
+
+	index_ = NEW fstream;
+	if (!index_->open(path, O_RDWR | O_CREAT, 0600)) {
+		logger_error("open %s error %s", path.c_str(), last_serror());
+		return false;
+	}
+
+	if (index_->fsize() < IDX_SIZE && !index_->ftruncate(IDX_SIZE)) {
+		logger_error("ftruncate %s error %s", path.c_str(),
+			last_serror());
+		return false;
+	}
+
+	index_base_ = map_file(*index_, IDX_SIZE, &index_map_);
+	if (index_base_ == NULL) {
+		logger_error("mmap %s error %s", path.c_str(), last_serror());
+		return false;
+	}
+
+	if (memcmp(index_base_, IDX_MAGIC, 8) == 0) {
+		memcpy(&head_, index_base_ + 8, sizeof(head_));
+	} else {
+		memcpy(index_base_, IDX_MAGIC, 8);
+		memcpy(index_base_ + 8, &head_, sizeof(head_));
+		index_dirty_ = true;
+	}
+	return true;
+}
+
+bool queue_log::load_segments(void)
+{
+	ACL_SCAN_DIR* scan = acl_scan_dir_open(path_.c_str(), 0);
+	if (scan == NULL) {
+		logger_error("open %s error %s", path_.c_str(), last_serror());
+		return false;
+	}
+
+	std::vector<unsigned> seqs;
+	string path;
+	const char* name;
+
+	while ((name = acl_scan_dir_next_file(scan)) != NULL) {
+		const char* ext = strrchr(name, '.');
+		if (ext == NULL) {
+			continue;
+		}
+		if (strcmp(ext, ".spare") == 0) {
+			path.format("%s%c%s", path_.c_str(), PATH_SEP, name);
+			spares_.push_back(path);
+		} else if (strcmp(ext, ".seg") == 0) {
+			unsigned seq = (unsigned) strtoul(name, NULL, 16);
+			if (seq > 0) {
+				seqs.push_back(seq);
+			}
+		}
+	}
+	acl_scan_dir_close(scan);
+
+	std::sort(seqs.begin(), seqs.end());
+
+	for (std::vector<unsigned>::const_iterator cit = seqs.begin();
+		cit != seqs.end(); ++cit) {
+
+		seg_path(*cit, path);
+
+		// the segments before the head have been consumed
+		if (*cit < ID_SEQ(head_)) {
+			string spare(path);
+			spare += ".spare";
+			if (spares_.size() < max_spare_
+				&& ::rename(path.c_str(), spare.c_str()) == 0) {
+				spares_.push_back(spare);
+			} else {
+				::remove(path.c_str());
+			}
+			continue;
+		}
+
+		queue_log_seg* seg = open_seg(*cit, NULL);
+		if (seg == NULL) {
+			return false;
+		}
+
+		if (memcmp(seg->base, SEG_MAGIC, 8) != 0
+			|| memcmp(seg->base + 8, &seg->seq, sizeof(unsigned))) {
+			logger_warn("invalid segment %s", path.c_str());
+			free_seg(seg, true);
+			continue;
+		}
+
+		seg->used   = recover(seg);
+		seg->synced = seg->used;
+		segs_.push_back(seg);
+	}
+
+	if (segs_.empty()) {
+		queue_log_seg* seg = new_seg(ID_SEQ(head_));
+		if (seg == NULL) {
+			return false;
+		}
+		segs_.push_back(seg);
+	}
+
+	if (head_ < MAKE_ID(segs_.front()->seq, SEG_HDR)) {
+		head_ = MAKE_ID(segs_.front()->seq, SEG_HDR);
+	}
+
+	committed_ = tail();
+	advance();
+
+	logger("queue log %s opened, segments=%d, records=%d, spares=%d",
+		path_.c_str(), (int) segs_.size(), (int) keys_.size(),
+		(int) spares_.size());
+	return true;
+}
+
+size_t queue_log::recover(queue_log_seg* seg)
+{
+	size_t off = SEG_HDR;
+
+	while (off + sizeof(log_rec) <= seg->size) {
+		const log_rec* rec = (const log_rec*) (seg->base + off);
+		if (rec->seq != seg->seq || rec->klen == 0) {
+			break;
+		}
+
+		size_t n = rec_size(rec->klen, rec->len);
+		if (rec->len > seg->size || off + n > seg->size) {
+			break;
+		}
+
+		const char* key = (const char*) (rec + 1);
+		if (rec->crc != acl_hash_crc32(key, rec->klen + rec->len)) {
+			logger_warn("crc error in segment %08x, offset=%lu",
+				seg->seq, (unsigned long) off);
+			break;
+		}
+
+		if (!(rec->flags & REC_DELETED)) {
+			string k;
+			k.copy(key, rec->klen);
+			keys_[k] = MAKE_ID(seg->seq, off);
+		}
+		off += n;
+	}
+
+	return off;
+}
+
+queue_log_seg* queue_log::open_seg(unsigned seq, const char* from)
+{
+	string path;
+	seg_path(seq, path);
+
+	if (from && ::rename(from, path.c_str()) != 0) {
+		logger_error("rename %s to %s error %s", from, path.c_str(),
+			last_serror());
+		return NULL;
+	}
+
+	queue_log_seg* seg = NEW queue_log_seg;
+	seg->seq    = seq;
+	seg->base   = NULL;
+	seg->hmap   = NULL;
+	seg->size   = seg_size_;
+	seg->used   = SEG_HDR;
+	seg->synced = 0;
+	seg->dirty  = (size_t) -1;
+
+	if (!seg->fp.open(path, O_RDWR | O_CREAT, 0600)) {
+		logger_error("open %s error %s", path.c_str(), last_serror());
+		delete seg;
+		return NULL;
+	}
+
+	// preallocate the segment file
+	if (seg->fp.fsize() != (long long) seg->size
+		&& !seg->fp.ftruncate((long long) seg->size)) {
+		logger_error("ftruncate %s error %s", path.c_str(),
+			last_serror());
+		delete seg;
+		return NULL;
+	}
+
+	seg->base = map_file(seg->fp, seg->size, &seg->hmap);
+	if (seg->base == NULL) {
+		logger_error("mmap %s error %s", path.c_str(), last_serror());
+		delete seg;
+		return NULL;
+	}
+	return seg;
+}
+
+queue_log_seg* queue_log::new_seg(unsigned seq)
+{
+	queue_log_seg* seg;
+
+	if (!spares_.empty()) {
+		string spare = spares_.back();
+		spares_.pop_back();
+		seg = open_seg(seq, spare);
+	} else {
+		seg = open_seg(seq, NULL);
+	}
+
+	if (seg == NULL) {
+		return NULL;
+	}
+
+	memcpy(seg->base, SEG_MAGIC, 8);
+	memcpy(seg->base + 8, &seq, sizeof(seq));
+	return seg;
+}
+
+void queue_log::free_seg(queue_log_seg* seg, bool recycle)
+{
+	if (seg->base) {
+		unmap_file(seg->base, seg->size, seg->hmap);
+	}
+
+	string path(seg->fp.file_path());
+	seg->fp.close();
+	delete seg;
+
+	if (!recycle) {
+		return;
+	}
+
+	if (spares_.size() < max_spare_) {
+		string spare(path);
+		spare += ".spare";
+		if (::rename(path.c_str(), spare.c_str()) == 0) {
+			spares_.push_back(spare);
+			return;
+		}
+	}
+
+	if (::remove(path.c_str()) != 0) {
+		logger_error("remove %s error %s", path.c_str(), last_serror());
+	}
+}
+
+void queue_log::close(void)
+{
+	if (opened_) {
+		std::deque<queue_log_seg*>::iterator it;
+		for (it = segs_.begin(); it != segs_.end(); ++it) {
+			sync_mem((*it)->base, (*it)->used);
+		}
+		sync_mem(index_base_, IDX_SIZE);
+		opened_ = false;
+	}
+
+	for (std::deque<queue_log_seg*>::iterator it = segs_.begin();
+		it != segs_.end(); ++it) {
+		free_seg(*it, false);
+	}
+	segs_.clear();
+	spares_.clear();
+	keys_.clear();
+
+	if (index_base_) {
+		unmap_file(index_base_, IDX_SIZE, index_map_);
+		index_base_ = NULL;
+	}
+	delete index_;
+	index_ = NULL;
+}
+
+queue_log_seg* queue_log::find_seg(long long id) const
+{
+	if (segs_.empty()) {
+		return NULL;
+	}
+
+	unsigned seq = ID_SEQ(id);
+	unsigned first = segs_.front()->seq;
+	if (seq < first) {
+		return NULL;
+	}
+
+	// the segments are continuous except some ones lost in recovering
+	size_t i = seq - first;
+	if (i < segs_.size() && segs_[i]->seq == seq) {
+		return segs_[i];
+	}
+
+	for (i = 0; i < segs_.size(); i++) {
+		if (segs_[i]->seq == seq) {
+			return segs_[i];
+		}
+	}
+	return NULL;
+}
+
+char* queue_log::find_record(long long id) const
+{
+	queue_log_seg* seg = find_seg(id);
+	if (seg == NULL) {
+		return NULL;
+	}
+
+	size_t off = ID_OFF(id);
+	if (off < SEG_HDR || off + sizeof(log_rec) > seg->used) {
+		return NULL;
+	}
+	return seg->base + off;
+}
+
+long long queue_log::tail(void) const
+{
+	const queue_log_seg* seg = segs_.back();
+	return MAKE_ID(seg->seq, seg->used);
+}
+
+long long queue_log::skip(long long id) const
+{
+	// move to the next segment if at the end of the current one
+	for (size_t i = 0; i < segs_.size(); i++) {
+		const queue_log_seg* seg = segs_[i];
+		if (seg->seq < ID_SEQ(id)) {
+			continue;
+		}
+		if (seg->seq > ID_SEQ(id)) {
+			return MAKE_ID(seg->seq, SEG_HDR);
+		}
+		if (ID_OFF(id) < seg->used) {
+			return id;
+		}
+		id = MAKE_ID(seg->seq + 1, SEG_HDR);
+	}
+	return -1;
+}
+
+void queue_log::advance(void)
+{
+	long long id = head_;
+
+	while (true) {
+		long long next = skip(id);
+		if (next < 0 || next >= committed_) {
+			if (next > id) {
+				id = next;
+			}
+			break;
+		}
+
+		id = next;
+		const log_rec* rec = (const log_rec*) find_record(id);
+		if (rec == NULL || !(rec->flags & REC_DELETED)) {
+			break;
+		}
+		id += rec_size(rec->klen, rec->len);
+	}
+
+	// keep the head in the last segment
+	if (id > tail()) {
+		id = tail();
+	}
+
+	if (id != head_) {
+		head_ = id;
+		memcpy(index_base_ + 8, &head_, sizeof(head_));
+		index_dirty_ = true;
+	}
+
+	// the segment being synced can't be recycled
+	if (syncing_) {
+		return;
+	}
+
+	while (segs_.size() > 1 && segs_.front()->seq < ID_SEQ(head_)) {
+		queue_log_seg* seg = segs_.front();
+		segs_.pop_front();
+		free_seg(seg, true);
+	}
+}
+
+long long queue_log::append(const char* key, const char* ext,
+	const void* data, size_t len)
+{
+	size_t klen = key ? strlen(key) : 0;
+	if (klen == 0 || klen > 255) {
+		logger_error("invalid key");
+		return -1;
+	}
+
+	size_t n = rec_size(klen, len);
+	if (n > seg_size_ - SEG_HDR) {
+		logger_error("record too large: %lu", (unsigned long) len);
+		return -1;
+	}
+
+	thread_mutex_guard guard(lock_);
+
+	if (!opened_) {
+		logger_error("queue log not opened");
+		return -1;
+	}
+
+	queue_log_seg* seg = segs_.back();
+	if (seg->used + n > seg->size) {
+		seg = new_seg(seg->seq + 1);
+		if (seg == NULL) {
+			return -1;
+		}
+		segs_.push_back(seg);
+	}
+
+	log_rec* rec = (log_rec*) (seg->base + seg->used);
+	char* ptr    = (char*) (rec + 1);
+
+	memcpy(ptr, key, klen);
+	if (len > 0) {
+		memcpy(ptr + klen, data, len);
+	}
+
+	rec->len      = (unsigned) len;
+	rec->crc      = acl_hash_crc32(ptr, klen + len);
+	rec->stamp    = (unsigned) time(NULL);
+	rec->flags    = 0;
+	rec->klen     = (unsigned char) klen;
+	rec->pad      = 0;
+	rec->reserved = 0;
+	ACL_SAFE_STRNCPY(rec->ext, ext ? ext : "", sizeof(rec->ext));
+	rec->seq      = seg->seq;
+
+	long long id = MAKE_ID(seg->seq, seg->used);
+	seg->used += n;
+	keys_[key] = id;
+	return id;
+}
+
+bool queue_log::commit(long long id)
+{
+	std::vector<std::pair<char*, size_t> > ranges;
+	bool ok = true;
+
+	lock_.lock();
+
+	while (ok && committed_ <= id) {
+		if (syncing_) {
+			// wait for the leader syncing the records before
+			cond_.wait(-1, true);
+			continue;
+		}
+
+		// be the leader and sync all the records appended before
+		syncing_ = true;
+		long long target = tail();
+
+		ranges.clear();
+		for (size_t i = 0; i < segs_.size(); i++) {
+			queue_log_seg* seg = segs_[i];
+			size_t from = std::min(seg->synced, seg->dirty);
+			if (from < seg->used) {
+				ranges.push_back(std::make_pair(seg->base + from,
+					seg->used - from));
+			}
+			seg->synced = seg->used;
+			seg->dirty  = (size_t) -1;
+		}
+
+		bool index_dirty = index_dirty_;
+		index_dirty_ = false;
+
+		lock_.unlock();
+
+		if (sync_) {
+			for (size_t i = 0; i < ranges.size(); i++) {
+				if (!sync_mem(ranges[i].first, ranges[i].second)) {
+					logger_error("msync error %s", last_serror());
+					ok = false;
+				}
+			}
+			if (index_dirty) {
+				sync_mem(index_base_, IDX_SIZE);
+			}
+			nsync_++;
+		}
+
+		lock_.lock();
+
+		if (target > committed_) {
+			committed_ = target;
+		}
+		syncing_ = false;
+		cond_.notify_all();
+
+		// recycle the segments skipped when syncing
+		advance();
+	}
+
+	lock_.unlock();
+	return ok;
+}
+
+bool queue_log::remove(long long id)
+{
+	thread_mutex_guard guard(lock_);
+
+	log_rec* rec = (log_rec*) find_record(id);
+	if (rec == NULL || (rec->flags & REC_DELETED)) {
+		return false;
+	}
+
+	rec->flags |= REC_DELETED;
+
+	queue_log_seg* seg = find_seg(id);
+	if (ID_OFF(id) < seg->dirty) {
+		seg->dirty = ID_OFF(id);
+	}
+
+	string key;
+	key.copy((const char*) (rec + 1), rec->klen);
+	std::map<string, long long>::iterator it = keys_.find(key);
+	if (it != keys_.end() && it->second == id) {
+		keys_.erase(it);
+	}
+
+	if (id == head_) {
+		advance();
+	}
+	return true;
+}
+
+bool queue_log::set_ext(long long id, const char* ext)
+{
+	thread_mutex_guard guard(lock_);
+
+	log_rec* rec = (log_rec*) find_record(id);
+	if (rec == NULL || (rec->flags & REC_DELETED)) {
+		return false;
+	}
+
+	ACL_SAFE_STRNCPY(rec->ext, ext, sizeof(rec->ext));
+
+	queue_log_seg* seg = find_seg(id);
+	if (ID_OFF(id) < seg->dirty) {
+		seg->dirty = ID_OFF(id);
+	}
+	return true;
+}
+
+bool queue_log::read(long long id, string* key, string* ext, string* data,
+	time_t* stamp /* = NULL */)
+{
+	thread_mutex_guard guard(lock_);
+
+	if (id >= committed_) {
+		return false;
+	}
+
+	const log_rec* rec = (const log_rec*) find_record(id);
+	if (rec == NULL || (rec->flags & REC_DELETED)) {
+		return false;
+	}
+
+	const char* ptr = (const char*) (rec + 1);
+	if (key) {
+		key->copy(ptr, rec->klen);
+	}
+	if (ext) {
+		*ext = rec->ext;
+	}
+	if (data) {
+		data->copy(ptr + rec->klen, rec->len);
+	}
+	if (stamp) {
+		*stamp = (time_t) rec->stamp;
+	}
+	return true;
+}
+
+long long queue_log::next(long long from)
+{
+	thread_mutex_guard guard(lock_);
+
+	long long id;
+
+	if (from < head_) {
+		id = head_;
+	} else {
+		const log_rec* rec = (const log_rec*) find_record(from);
+		if (rec == NULL) {
+			return -1;
+		}
+		id = from + rec_size(rec->klen, rec->len);
+	}
+
+	while (true) {
+		id = skip(id);
+		if (id < 0 || id >= committed_) {
+			return -1;
+		}
+
+		const log_rec* rec = (const log_rec*) find_record(id);
+		if (rec == NULL) {
+			return -1;
+		}
+		if (!(rec->flags & REC_DELETED)) {
+			return id;
+		}
+		id += rec_size(rec->klen, rec->len);
+	}
+}
+
+long long queue_log::find(const char* key)
+{
+	thread_mutex_guard guard(lock_);
+
+	std::map<string, long long>::const_iterator cit = keys_.find(key);
+	return cit == keys_.end() ? -1 : cit->second;
+}
+
+size_t queue_log::size(void)
+{
+	thread_mutex_guard guard(lock_);
+	return keys_.size();
+}
+
+size_t queue_log::segments(void)
+{
+	thread_mutex_guard guard(lock_);
+	return segs_.size();
+}
+
+} // namespace acl
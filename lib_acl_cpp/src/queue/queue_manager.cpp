@@ -4,6 +4,7 @@
 #include "acl_cpp/stdlib/util.hpp"
 #include "acl_cpp/stdlib/log.hpp"
 #include "acl_cpp/queue/queue_manager.hpp"
+#include "acl_cpp/queue/queue_log.hpp"
 #endif
 
 #ifdef ACL_WINDOWS
@@ -20,6 +21,8 @@ queue_manager::queue_manager(const char* home, const char* queueName,
 : m_scanDir(NULL)
 , m_home(home)
 , m_queueName(queueName)
+, log_(NULL)
+, scan_id_(-1)
 {
 	if (sub_width == 0) {
 		sub_width_ = 2;
@@ -59,6 +62,27 @@ queue_manager::~queue_manager(void)
 	if (m_scanDir) {
 		acl_scan_dir_close(m_scanDir);
 	}
+	delete log_;
+}
+
+bool queue_manager::open_log(size_t seg_size /* = 64M */,
+	bool sync /* = true */)
+{
+	if (log_) {
+		return true;
+	}
+
+	string path(m_home);
+	path << PATH_SEP << m_queueName << PATH_SEP << ".log";
+
+	log_ = NEW queue_log(path, seg_size);
+	log_->set_sync(sync);
+	if (!log_->open()) {
+		delete log_;
+		log_ = NULL;
+		return false;
+	}
+	return true;
 }
 
 const char* queue_manager::get_home(void) const
@@ -74,9 +98,17 @@ const char* queue_manager::get_queueName(void) const
 queue_file* queue_manager::create_file(const char* extName)
 {
 	queue_file* fp = NEW queue_file;
+	bool ret;
+
+	if (log_) {
+		ret = fp->create(log_, m_home.c_str(), m_queueName.c_str(),
+			extName, sub_width_);
+	} else {
+		ret = fp->create(m_home.c_str(), m_queueName.c_str(),
+			extName, sub_width_);
+	}
 
-	if (!fp->create(m_home.c_str(), m_queueName.c_str(),
-		extName, sub_width_)) {
+	if (!ret) {
 
 		delete fp;
 		return NULL;
@@ -112,7 +144,17 @@ queue_file* queue_manager::open_file(const char* filePath, bool no_cache /* = tr
 
 	// Ӵ̴ѾڵĶļ
 	fp = NEW queue_file;
-	if (!fp->open(home.c_str(), queueName.c_str(), queueSub.c_str(),
+
+	if (log_) {
+		long long id = log_->find(partName);
+		if (id < 0 || !fp->open(log_, id, home.c_str(),
+			queueName.c_str())) {
+
+			logger_error("%s not in log", filePath);
+			delete fp;
+			return NULL;
+		}
+	} else if (!fp->open(home.c_str(), queueName.c_str(), queueSub.c_str(),
 		partName.c_str(), extName.c_str())) {
 
 		delete fp;
@@ -125,9 +167,12 @@ queue_file* queue_manager::open_file(const char* filePath, bool no_cache /* = tr
 bool queue_manager::close_file(queue_file* fp)
 {
 	string key(fp->key());
+
+	// the record created is appended into the log when closing
+	bool ret = fp->in_log() ? fp->log_commit() : true;
 	delete fp;
 	cache_del(key.c_str());
-	return true;
+	return ret;
 }
 
 bool queue_manager::delete_file(queue_file* fp)
@@ -146,20 +191,61 @@ bool queue_manager::rename_extname(queue_file* fp, const char* extName)
 			fp->get_filePath(), fp->key());
 		return false;
 	}
+	if (fp->in_log()) {
+		return log_rename(fp, extName);
+	}
 	return fp->move_file(fp->get_queueName(), extName);
 }
 
+bool queue_manager::log_rename(queue_file* fp, const char* extName)
+{
+	// the record is visible to the scanner after being committed
+	if (fp->log_id_ < 0) {
+		fp->set_extName(extName);
+		return fp->log_commit();
+	}
+
+	if (!fp->log_->set_ext(fp->log_id_, extName)) {
+		logger_error("set ext of %s error", fp->key());
+		return false;
+	}
+	fp->set_extName(extName);
+	return true;
+}
+
 bool queue_manager::move_file(queue_file* fp, const char* queueName, const char* extName)
 {
 	string key(fp->key());
-	bool ret = fp->move_file(queueName, extName);
+	bool ret;
+
+	if (!fp->in_log()) {
+		ret = fp->move_file(queueName, extName);
+	} else if (strcmp(fp->get_queueName(), queueName) == 0) {
+		ret = log_rename(fp, extName);
+	} else {
+		// write the record as one queue file of the target queue
+		ret = fp->log_export(queueName, extName, sub_width_);
+	}
+
 	cache_del(key.c_str());
 	return ret;
 }
 
 bool queue_manager::move_file(queue_file* fp, queue_manager* toQueue, const char* extName)
 {
-	bool ret = move_file(fp, toQueue->get_queueName(), extName);
+	bool ret;
+
+	if (toQueue->log_ == NULL) {
+		ret = move_file(fp, toQueue->get_queueName(), extName);
+	} else if (fp->log_ == toQueue->log_) {
+		ret = move_file(fp, fp->get_queueName(), extName);
+	} else {
+		string key(fp->key());
+		ret = fp->log_move(toQueue->log_, toQueue->get_queueName(),
+			extName);
+		cache_del(key.c_str());
+	}
+
 	if (ret == false) {
 		return false;
 	}
@@ -357,6 +443,11 @@ bool queue_manager::remove(queue_file* fp)
 
 bool queue_manager::scan_open(bool scanSub /* = true */)
 {
+	if (log_) {
+		scan_id_ = -1;
+		return true;
+	}
+
 	string path(m_home.c_str());
 	path << PATH_SEP << m_queueName.c_str();
 	m_scanDir = acl_scan_dir_open(path.c_str(), scanSub ? 1 : 0);
@@ -370,6 +461,7 @@ bool queue_manager::scan_open(bool scanSub /* = true */)
 
 void queue_manager::scan_close(void)
 {
+	scan_id_ = -1;
 	if (m_scanDir) {
 		acl_scan_dir_close(m_scanDir);
 		m_scanDir = NULL;
@@ -378,6 +470,10 @@ void queue_manager::scan_close(void)
 
 queue_file* queue_manager::scan_next(void)
 {
+	if (log_) {
+		return scan_log();
+	}
+
 	if (m_scanDir == NULL) {
 		logger_fatal("call scan_open first!");
 	}
@@ -409,6 +505,12 @@ queue_file* queue_manager::scan_next(void)
 			continue;
 		}
 
+		// skip the segments of the log
+		const char* sub = strrchr(path, PATH_SEP);
+		if (sub && strcmp(sub + 1, ".log") == 0) {
+			continue;
+		}
+
 		filePath.clear();
 		filePath << path << PATH_SEP << fileName;
 		fp = NEW queue_file;
@@ -433,4 +535,29 @@ queue_file* queue_manager::scan_next(void)
 	return fp;
 }
 
+queue_file* queue_manager::scan_log(void)
+{
+	while (true) {
+		scan_id_ = log_->next(scan_id_);
+		if (scan_id_ < 0) {
+			return NULL;
+		}
+
+		queue_file* fp = NEW queue_file;
+		if (!fp->open(log_, scan_id_, m_home.c_str(),
+			m_queueName.c_str())) {
+
+			delete fp;
+			continue;
+		}
+
+		// skip the record being used
+		if (!cache_add(fp)) {
+			delete fp;
+			continue;
+		}
+		return fp;
+	}
+}
+
 } // namespace acl
@@ -359,6 +359,77 @@ redis_result* redis_client::get_object(socket_stream& conn, dbuf_pool* dbuf)
 	}
 }
 
+// Append one line with the "\r\n" to out.
+static bool append_line(socket_stream& conn, string& out)
+{
+	while (true) {
+		size_t size = 128;
+		out.space(size);
+		char* ptr = out.c_str() + out.size();
+		bool ok = conn.gets(ptr, &size, false);
+		out.set_offset(out.size() + size);
+		if (ok) {
+			return true;
+		}
+		// The line is longer than the buffer, go on reading.
+		if (size == 0) {
+			return false;
+		}
+	}
+}
+
+bool redis_client::get_raw(socket_stream& conn, string& out)
+{
+	// The count of the elements not read yet, the ones of one array are
+	// added after the array's header read, so the nested arrays needn't
+	// recursion.
+	long long left = 1;
+
+	while (left-- > 0) {
+		size_t off = out.size();
+		if (!append_line(conn, out)) {
+			logger_error("gets error, server: %s",
+				conn.get_peer(true));
+			return false;
+		}
+
+		const char* line = out.c_str() + off;
+		long long n;
+
+		switch (*line) {
+		case '-':	// ERROR
+		case '+':	// STATUS
+		case ':':	// INTEGER
+			break;
+		case '$':	// STRING
+			n = atoll(line + 1);
+			if (n < 0) {
+				break;
+			}
+			// Read the data with the tail "\r\n" at once.
+			n += 2;
+			out.space((size_t) n);
+			if (conn.read(out.c_str() + out.size(), (size_t) n) == -1) {
+				logger_error("read error, server: %s",
+					conn.get_peer(true));
+				return false;
+			}
+			out.set_offset(out.size() + (size_t) n);
+			break;
+		case '*':	// ARRAY
+			n = atoll(line + 1);
+			if (n > 0) {
+				left += n;
+			}
+			break;
+		default:	// INVALID
+			logger_error("invalid first char: %c, %d", *line, *line);
+			return false;
+		}
+	}
+	return true;
+}
+
 redis_result* redis_client::get_objects(socket_stream& conn,
 	dbuf_pool* dbuf, size_t nobjs)
 {
@@ -2,6 +2,8 @@
 #ifndef ACL_PREPARE_COMPILE
 #include <vector>
 #include "acl_cpp/stdlib/snprintf.hpp"
+#include "acl_cpp/stream/socket_stream.hpp"
+#include "acl_cpp/redis/redis_result.hpp"
 #include "acl_cpp/redis/redis_cluster.hpp"
 #include "acl_cpp/redis/redis_slot.hpp"
 #include "acl_cpp/redis/redis_client.hpp"
@@ -597,6 +599,121 @@ const redis_result* redis_client_cluster::run(redis_command& cmd,
 	return NULL;
 }
 
+// the requests in the batch to the same redis node
+struct redis_batch_node {
+	redis_client_pool* pool;
+	redis_client* conn;
+	std::vector<size_t> reqs;
+};
+
+#define	BATCH_IOV_MAX	256
+
+static bool batch_write(socket_stream& out,
+	const std::vector<const string*>& reqs, const redis_batch_node& node)
+{
+	struct iovec iov[BATCH_IOV_MAX];
+	int n = 0;
+
+	for (size_t i = 0; i < node.reqs.size(); i++) {
+		const string* req = reqs[node.reqs[i]];
+		iov[n].iov_base = (void*) req->c_str();
+		iov[n].iov_len  = req->size();
+		if (++n == BATCH_IOV_MAX) {
+			if (out.writev(iov, n) == -1) {
+				return false;
+			}
+			n = 0;
+		}
+	}
+
+	return n == 0 || out.writev(iov, n) != -1;
+}
+
+void redis_client_cluster::run_batch(dbuf_pool* dbuf,
+	const std::vector<int>& slots, const std::vector<const string*>& reqs,
+	std::vector<const redis_result*>& out)
+{
+	out.assign(reqs.size(), NULL);
+
+	// group the requests by the redis nodes of their slots, the request
+	// whose slot isn't cached yet is left to run() for redirection.
+	std::vector<redis_batch_node> nodes;
+	for (size_t i = 0; i < reqs.size(); i++) {
+		redis_client_pool* pool = peek_slot(slots[i]);
+		if (pool == NULL) {
+			continue;
+		}
+
+		size_t j = 0;
+		for (; j < nodes.size(); j++) {
+			if (nodes[j].pool == pool) {
+				break;
+			}
+		}
+		if (j == nodes.size()) {
+			redis_batch_node node;
+			node.pool = pool;
+			node.conn = NULL;
+			nodes.push_back(node);
+		}
+		nodes[j].reqs.push_back(i);
+	}
+
+	// write all the requests to all the nodes before reading any reply.
+	for (std::vector<redis_batch_node>::iterator it = nodes.begin();
+		it != nodes.end(); ++it) {
+
+		redis_client* conn = (redis_client*) it->pool->peek();
+		if (conn == NULL) {
+			continue;
+		}
+
+		socket_stream* stream = conn->get_stream();
+		if (stream == NULL || !batch_write(*stream, reqs, *it)) {
+			logger_error("write to redis(%s) error: %s",
+				it->pool->get_addr(), last_serror());
+			it->pool->put(conn, false);
+			continue;
+		}
+		it->conn = conn;
+	}
+
+	for (std::vector<redis_batch_node>::iterator it = nodes.begin();
+		it != nodes.end(); ++it) {
+
+		redis_client* conn = it->conn;
+		if (conn == NULL) {
+			continue;
+		}
+
+		socket_stream* stream = conn->get_stream(false);
+		bool ok = true;
+
+		// all the replies must be read to keep the connection usable.
+		for (size_t i = 0; i < it->reqs.size(); i++) {
+			redis_result* rr = conn->get_object(*stream, dbuf);
+			if (rr == NULL) {
+				logger_error("read from redis(%s) error: %s",
+					it->pool->get_addr(), last_serror());
+				ok = false;
+				break;
+			}
+
+			if (rr->get_type() == REDIS_RESULT_ERROR) {
+				const char* ptr = rr->get_error();
+				if (ptr && (EQ(ptr, "MOVED") || EQ(ptr, "ASK")
+					|| EQ(ptr, "TRYAGAIN")
+					|| EQ(ptr, "CLUSTERDOWN"))) {
+					continue;
+				}
+			}
+			out[it->reqs[i]] = rr;
+		}
+
+		it->pool->put(conn, ok);
+	}
+}
+
 } // namespace acl
 
 #endif // ACL_CLIENT_ONLY
@@ -11,11 +11,23 @@
 
 namespace acl {
 
+static long long now_us(void)
+{
+	struct timeval now;
+	gettimeofday(&now, NULL);
+	return (long long) now.tv_sec * 1000000 + (long long) now.tv_usec;
+}
+
 redis_pipeline_channel::redis_pipeline_channel(redis_client_pipeline& pipeline,
 	const char* addr, int conn_timeout, int rw_timeout, bool retry)
 : pipeline_(pipeline)
 , addr_(addr)
-, buf_(81920)
+, iov_(NULL)
+, iov_size_(0)
+, max_delay_(0)
+, max_batch_(256)
+, avg_batch_(1.0)
+, first_stamp_(0)
 {
 	client_ = NEW redis_client(addr, conn_timeout, rw_timeout, retry);
 	box_ = new mbox<redis_pipeline_message>;
@@ -25,6 +37,22 @@ redis_pipeline_channel::~redis_pipeline_channel(void)
 {
 	delete client_;
 	delete box_;
+	if (iov_) {
+		acl_myfree(iov_);
+	}
+}
+
+void redis_pipeline_channel::set_coalesce(int max_delay, size_t max_batch)
+{
+	max_delay_ = max_delay > 0 ? max_delay : 0;
+	max_batch_ = max_batch > 0 ? max_batch : 1;
+}
+
+void redis_pipeline_channel::get_stat(redis_pipeline_stat& out)
+{
+	lock_.lock();
+	out = stat_;
+	lock_.unlock();
 }
 
 redis_pipeline_channel& redis_pipeline_channel::set_passwd(const char *passwd)
@@ -58,6 +86,23 @@ void redis_pipeline_channel::push(redis_pipeline_message* msg)
 	box_->push(msg, false);
 }
 
+// The max count of iovec written in one writev.
+#define IOV_BATCH	512
+
+static bool write_all(socket_stream& conn, const struct iovec* iov,
+	size_t count)
+{
+	while (count > 0) {
+		size_t n = count > IOV_BATCH ? IOV_BATCH : count;
+		if (conn.writev(iov, (int) n) == -1) {
+			return false;
+		}
+		iov   += n;
+		count -= n;
+	}
+	return true;
+}
+
 bool redis_pipeline_channel::flush_all(void)
 {
 	if (msgs_.empty()) {
@@ -65,30 +110,35 @@ bool redis_pipeline_channel::flush_all(void)
 		return true;
 	}
 
-	buf_.clear();
+	if (iov_size_ < msgs_.size()) {
+		if (iov_) {
+			acl_myfree(iov_);
+		}
+		iov_size_ = msgs_.size() * 2;
+		iov_ = (struct iovec*) acl_mymalloc(
+			sizeof(struct iovec) * iov_size_);
+	}
 
+	// The requests are written directly without being copied.
+	size_t n = 0;
 	for (std::vector<redis_pipeline_message*>::iterator it = msgs_.begin();
 		it != msgs_.end(); ++it) {
-		buf_.append((*it)->get_request());
+		const string* req = (*it)->get_request();
+		iov_[n].iov_base = (void*) req->c_str();
+		iov_[n].iov_len  = req->size();
+		n++;
 	}
 
-#if 0
-	if (msgs_.size() > 10) {
-		logger(">>>messages size is %zd, buf size=%zd<<<<",
-			msgs_.size(), buf_.size());
-	}
-#endif
-
 	bool retried = false;
 	while (true) {
 		socket_stream* conn = client_->get_stream(false);
 		if (conn) {
-			if (conn->write(buf_) == (int) buf_.size()) {
+			if (write_all(*conn, iov_, n)) {
 				return true;
 			}
 
-			logger_error("Write error=%s, addr=%s, buf=%s",
-				last_serror(), addr_.c_str(), buf_.c_str());
+			logger_error("Write error=%s, addr=%s, messages=%d",
+				last_serror(), addr_.c_str(), (int) n);
 		}
 
 		// Return false if we have retried
@@ -120,6 +170,10 @@ void redis_pipeline_channel::all_failed()
 bool redis_pipeline_channel::wait_one(socket_stream& conn,
 	redis_pipeline_message& msg)
 {
+	if (msg.is_raw()) {
+		return wait_raw(conn, msg);
+	}
+
 	dbuf_pool* dbuf = msg.get_dbuf();
 	assert(dbuf);
 
@@ -191,6 +245,56 @@ bool redis_pipeline_channel::wait_one(socket_stream& conn,
 	return true;
 }
 
+// The reply is only framed and is passed to the waiter as it is, only the
+// error of MOVED, ASK and CLUSTERDOWN is looked into as wait_one() does.
+bool redis_pipeline_channel::wait_raw(socket_stream& conn,
+	redis_pipeline_message& msg)
+{
+	string* reply = msg.get_reply();
+	reply->clear();
+
+	if (!client_->get_raw(conn, *reply)) {
+		logger_error("Can't get raw result");
+		return false;
+	}
+
+	const char* ptr = reply->c_str();
+	if (*ptr++ != '-') {
+		msg.push_raw();
+		return true;
+	}
+
+	if (EQ(ptr, "MOVED") || EQ(ptr, "ASK")) {
+		// Such as: -MOVED 3999 127.0.0.1:6381\r\n
+		const char* addr = strchr(ptr, ' ');
+		addr = addr ? strchr(addr + 1, ' ') : NULL;
+		size_t len = addr ? strcspn(++addr, "\r\n") : 0;
+		if (len == 0) {
+			logger_error("No redirect addr got");
+			msg.push_raw();
+		} else if (msg.get_redirect_count() >= 5) {
+			logger_error("Redirect count(%d) exceed limit(5)",
+				(int) msg.get_redirect_count());
+			msg.push_raw();
+		} else {
+			msg.set_raw_addr(addr, len);
+			msg.set_type(redis_pipeline_t_redirect);
+			pipeline_.push(&msg);
+		}
+	} else if (EQ(ptr, "CLUSTERDOWN")) {
+		msg.push_raw();
+
+		redis_pipeline_message* m = new redis_pipeline_message(
+				redis_pipeline_t_clusterdonw, NULL);
+		m->set_addr(this->get_addr());
+		pipeline_.push(m);
+		return false;
+	} else {
+		msg.push_raw();
+	}
+	return true;
+}
+
 bool redis_pipeline_channel::wait_results(void)
 {
 	if (msgs_.empty()) {
@@ -240,8 +344,55 @@ bool redis_pipeline_channel::wait_results(void)
 	return true;
 }
 
+void redis_pipeline_channel::update_stat(size_t n, long long wait,
+	long long wait_max, long long rtt)
+{
+	// The moving average of the batch sizes tells if the messages come
+	// faster than the replies, so more messages will come soon.
+	avg_batch_ = avg_batch_ * 0.875 + (double) n * 0.125;
+
+	size_t i = 0, size = 1;
+	while (size < n && i < REDIS_PIPELINE_HIST - 1) {
+		size <<= 1;
+		i++;
+	}
+
+	lock_.lock();
+	stat_.batches++;
+	stat_.messages += (long long) n;
+	stat_.batch_sizes[i]++;
+	stat_.queue_wait += wait;
+	if (wait_max > stat_.queue_wait_max) {
+		stat_.queue_wait_max = wait_max;
+	}
+	stat_.rtt += rtt;
+	if (rtt > stat_.rtt_max) {
+		stat_.rtt_max = rtt;
+	}
+	lock_.unlock();
+}
+
 bool redis_pipeline_channel::handle_messages(void)
 {
+	if (msgs_.empty()) {
+		return true;
+	}
+
+	// The queue waiting must be computed before the results being
+	// returned, because the messages may be freed by the waiters.
+	size_t n = msgs_.size();
+	long long start = now_us(), wait = 0, wait_max = 0;
+	for (std::vector<redis_pipeline_message*>::const_iterator it =
+		msgs_.begin(); it != msgs_.end(); ++it) {
+		long long stamp = (*it)->get_stamp();
+		if (stamp > 0 && start > stamp) {
+			wait += start - stamp;
+			if (start - stamp > wait_max) {
+				wait_max = start - stamp;
+			}
+		}
+	}
+
 	bool retried = false;
 
 	while (true) {
@@ -252,6 +403,7 @@ bool redis_pipeline_channel::handle_messages(void)
 
 		if (wait_results()) {
 			msgs_.clear();
+			update_stat(n, wait, wait_max, now_us() - start);
 			return true;
 		}
 
@@ -276,6 +428,26 @@ bool redis_pipeline_channel::handle_messages(void)
 	return false;
 }
 
+bool redis_pipeline_channel::coalescing(int& timeout)
+{
+	// Send at once when the load is low or the batch is big enough.
+	if (max_delay_ <= 0 || msgs_.empty() || msgs_.size() >= max_batch_
+		|| avg_batch_ < 2.0) {
+		return false;
+	}
+
+	// The box can only wait in milliseconds, and waiting 0 ms only polls
+	// it, which would spin until the deadline, so the batch is sent at
+	// once when less than one millisecond is left.
+	long long left = first_stamp_ + max_delay_ - now_us();
+	if (left < 1000) {
+		return false;
+	}
+
+	timeout = (int) (left / 1000);
+	return true;
+}
+
 void* redis_pipeline_channel::run(void)
 {
 	bool success;
@@ -291,7 +463,14 @@ void* redis_pipeline_channel::run(void)
 
 			// Handle normal message for handling redis command.
 			case redis_pipeline_t_cmd:
+				if (msgs_.empty()) {
+					first_stamp_ = now_us();
+				}
 				msgs_.push_back(msg);
+
+				if (max_delay_ > 0 && msgs_.size() >= max_batch_) {
+					handle_messages();
+				}
 				break;
 
 			// Handle stop message from redis_client_pipeline
@@ -305,7 +484,7 @@ void* redis_pipeline_channel::run(void)
 			}
 		} else if (!success) {
 			break;
-		} else {
+		} else if (!coalescing(timeout)) {
 			timeout = -1;
 			handle_messages();
 		}
@@ -331,6 +510,8 @@ redis_client_pipeline::redis_client_pipeline(const char* addr, box_type_t type)
 , rw_timeout_(10)
 , retry_(true)
 , preconn_(true)
+, max_delay_(0)
+, max_batch_(256)
 {
 	slot_addrs_ = (const char**) acl_mycalloc(max_slot_, sizeof(char*));
 	channels_   = NEW token_tree;
@@ -382,6 +563,44 @@ redis_client_pipeline & redis_client_pipeline::set_preconnect(bool yes)
 	return *this;
 }
 
+redis_client_pipeline& redis_client_pipeline::set_coalesce(int max_delay,
+	size_t max_batch)
+{
+	max_delay_ = max_delay;
+	max_batch_ = max_batch;
+	return *this;
+}
+
+void redis_client_pipeline::get_stats(std::map<string, redis_pipeline_stat>& out)
+{
+	lock_.lock();
+	for (std::vector<redis_pipeline_channel*>::iterator it =
+		running_.begin(); it != running_.end(); ++it) {
+		(*it)->get_stat(out[(*it)->get_addr()]);
+	}
+	lock_.unlock();
+}
+
+void redis_client_pipeline::add_running(redis_pipeline_channel* channel)
+{
+	lock_.lock();
+	running_.push_back(channel);
+	lock_.unlock();
+}
+
+void redis_client_pipeline::del_running(redis_pipeline_channel* channel)
+{
+	lock_.lock();
+	for (std::vector<redis_pipeline_channel*>::iterator it =
+		running_.begin(); it != running_.end(); ++it) {
+		if (*it == channel) {
+			running_.erase(it);
+			break;
+		}
+	}
+	lock_.unlock();
+}
+
 void redis_client_pipeline::start_thread(void)
 {
 	this->start();
@@ -397,12 +616,17 @@ void redis_client_pipeline::stop_thread(void)
 
 const redis_result* redis_client_pipeline::run(redis_pipeline_message& msg)
 {
+	msg.set_stamp(now_us());
 	box_->push(&msg, false);
 	return msg.wait();
 }
 
 void redis_client_pipeline::push(redis_pipeline_message *msg)
 {
+	// The redirected message keeps the stamp when it was put first.
+	if (msg->get_stamp() == 0) {
+		msg->set_stamp(now_us());
+	}
 	box_->push(msg, false);
 }
 
@@ -496,6 +720,11 @@ void* redis_client_pipeline::run(void)
 	return NULL;
 }
 
+int redis_client_pipeline::hash_slot(const char* key, size_t len) const
+{
+	return redis_command::key_slot(key, len, max_slot_);
+}
+
 void redis_client_pipeline::redirect(const redis_pipeline_message &msg, int slot)
 {
 	const char* addr = msg.get_addr();
@@ -618,6 +847,7 @@ void redis_client_pipeline::stop_channels(void)
 	for (std::vector<redis_pipeline_channel*>::iterator
 		     it = channels.begin(); it != channels.end(); ++it) {
 		channels_->remove(((*it)->get_addr()));
+		del_running(*it);
 		delete *it;
 	}
 
@@ -645,8 +875,10 @@ redis_pipeline_channel* redis_client_pipeline::start_channel(const char *addr)
 	if (!passwd_.empty()) {
 		channel->set_passwd(passwd_);
 	}
+	channel->set_coalesce(max_delay_, max_batch_);
 	if (channel->start_thread()) {
 		channels_->insert(addr, channel);
+		add_running(channel);
 		return channel;
 	} else {
 		delete channel;
@@ -662,6 +894,7 @@ void redis_client_pipeline::stop_channel(const char *addr)
 			node->get_ctx();
 		channels_->remove(addr);
 		channel->stop_thread();
+		del_running(channel);
 		delete channel;
 	}
 }
@@ -701,6 +934,7 @@ void redis_client_pipeline::channel_closed(redis_pipeline_channel* channel)
 
 	if (node == NULL) {
 		channel->wait(); // Wait the thread to exit.
+		del_running(channel);
 		delete channel;
 		return;
 	}
@@ -713,6 +947,7 @@ void redis_client_pipeline::channel_closed(redis_pipeline_channel* channel)
 	logger("The channel closed, addr=%s", addr);
 	channels_->remove(addr);
 	channel->wait();
+	del_running(channel);
 	delete channel;
 }
 
@@ -35,6 +35,7 @@ void redis_command::init(void)
 	argv_size_      = 0;
 	argv_           = NULL;
 	argv_lens_      = NULL;
+	multi_step_     = 0;
 	slice_res_      = false;
 	result_         = NULL;
 	pipe_msg_       = NULL;
@@ -272,6 +273,26 @@ void redis_command::argv_space(size_t n)
 	}
 }
 
+// the same as redis cluster: only the part between the first '{' and the
+// first '}' after it is hashed if it isn't empty, so the keys with the same
+// hash tag are in the same slot.
+int redis_command::key_slot(const char* key, size_t len, int max_slot)
+{
+	const char* end = key + len;
+	const char* ptr = (const char*) memchr(key, '{', len);
+	if (ptr != NULL) {
+		const char* tag = ptr + 1;
+		ptr = (const char*) memchr(tag, '}', end - tag);
+		if (ptr != NULL && ptr > tag) {
+			key = tag;
+			len = ptr - tag;
+		}
+	}
+
+	unsigned short n = acl_hash_crc16(key, len);
+	return (int) (n % max_slot);
+}
+
 void redis_command::hash_slot(const char* key)
 {
 	hash_slot(key, strlen(key));
@@ -299,8 +320,7 @@ void redis_command::hash_slot(const char* key, size_t len)
 		return;
 	}
 
-	unsigned short n = acl_hash_crc16(key, len);
-	slot_ = (int) (n % max_slot);
+	slot_ = key_slot(key, len, max_slot);
 }
 
 const char* redis_command::get_client_addr(void) const
@@ -390,6 +410,20 @@ const redis_result* redis_command::get_result(void) const
 const redis_result* redis_command::run(size_t nchild /* = 0 */,
 	int* timeout /* = NULL */)
 {
+	if (multi_step_ > 0) {
+		size_t step = multi_step_;
+		multi_step_ = 0;
+
+		if ((pipeline_ != NULL || cluster_ != NULL) && !slice_req_
+			&& nchild == 0) {
+			// return false if all the keys are in the same slot,
+			// which should be run as usual.
+			if (run_multi(step, timeout)) {
+				return result_;
+			}
+		}
+	}
+
 	if (pipeline_ != NULL) {
 		redis_pipeline_message& msg = get_pipeline_message();
 		msg.set_option(dbuf_, nchild, timeout);
@@ -420,6 +454,269 @@ const redis_result* redis_command::run(size_t nchild /* = 0 */,
 	return result_;
 }
 
+static dbuf_pool* create_dbuf(void)
+{
+#ifdef ACL_DBUF_HOOK_NEW
+	return new (REDIS_DBUF_NBLOCK) dbuf_pool();
+#else
+	return new dbuf_pool(REDIS_DBUF_NBLOCK);
+#endif
+}
+
+// copy the result allocated from another dbuf into the given dbuf
+static const redis_result* copy_result(dbuf_pool* dbuf,
+	const redis_result* rr)
+{
+	redis_result* out = new(dbuf) redis_result(dbuf);
+	out->set_type(rr->get_type());
+
+	size_t size = rr->get_size();
+	if (size == 0) {
+		return out;
+	}
+
+	out->set_size(size);
+
+	if (rr->get_type() == REDIS_RESULT_ARRAY) {
+		for (size_t i = 0; i < size; i++) {
+			const redis_result* child = rr->get_child(i);
+			if (child != NULL) {
+				out->put(copy_result(dbuf, child), i);
+			}
+		}
+		return out;
+	}
+
+	const char** argv = rr->get_argv();
+	const size_t* lens = rr->get_lens();
+	for (size_t i = 0; i < size && argv[i] != NULL; i++) {
+		char* buf = (char*) dbuf->dbuf_alloc(lens[i] + 1);
+		memcpy(buf, argv[i], lens[i]);
+		buf[lens[i]] = 0;
+		out->put(buf, lens[i]);
+	}
+	return out;
+}
+
+bool redis_command::run_multi(size_t step, int* timeout)
+{
+	int max_slot = cluster_ != NULL ? cluster_->get_max_slot()
+		: pipeline_->get_max_slot();
+	if (max_slot <= 0 || argc_ < 1 + step || (argc_ - 1) % step != 0) {
+		return false;
+	}
+
+	size_t nkeys = (argc_ - 1) / step;
+
+	// the slot of each group, the args of the keys in each group, and
+	// the group index and the index in the group of each key.
+	std::vector<int> slots;
+	std::vector<std::vector<size_t> > groups;
+	std::vector<std::pair<size_t, size_t> > pos(nkeys);
+	std::map<int, size_t> slot2group;
+
+	for (size_t i = 0; i < nkeys; i++) {
+		size_t n = 1 + i * step;
+		int slot = key_slot(argv_[n], argv_lens_[n], max_slot);
+
+		size_t g;
+		std::map<int, size_t>::const_iterator it = slot2group.find(slot);
+		if (it == slot2group.end()) {
+			g = slots.size();
+			slot2group[slot] = g;
+			slots.push_back(slot);
+			groups.push_back(std::vector<size_t>());
+		} else {
+			g = it->second;
+		}
+
+		pos[i] = std::make_pair(g, groups[g].size());
+		groups[g].push_back(n);
+	}
+
+	if (slots.size() == 1) {
+		slot_ = slots[0];
+		if (pipeline_ != NULL) {
+			get_pipeline_message().set_slot(slot_);
+		}
+		return false;
+	}
+
+	// build one sub-command with the same name for each slot
+	std::vector<const string*> reqs;
+	std::vector<const char*> argv;
+	std::vector<size_t> lens;
+
+	for (size_t g = 0; g < groups.size(); g++) {
+		argv.clear();
+		lens.clear();
+		argv.push_back(argv_[0]);
+		lens.push_back(argv_lens_[0]);
+
+		const std::vector<size_t>& args = groups[g];
+		for (size_t i = 0; i < args.size(); i++) {
+			for (size_t j = 0; j < step; j++) {
+				argv.push_back(argv_[args[i] + j]);
+				lens.push_back(argv_lens_[args[i] + j]);
+			}
+		}
+
+		string* req = NEW string(256);
+		build_request(argv.size(), &argv[0], &lens[0], *req);
+		reqs.push_back(req);
+	}
+
+	std::vector<const redis_result*> results;
+	run_slots(slots, reqs, results, timeout);
+	result_ = merge_results(nkeys, pos, results);
+
+	for (std::vector<const string*>::iterator it = reqs.begin();
+		it != reqs.end(); ++it) {
+		delete *it;
+	}
+	return true;
+}
+
+void redis_command::run_slots(const std::vector<int>& slots,
+	const std::vector<const string*>& reqs,
+	std::vector<const redis_result*>& out, int* timeout)
+{
+	if (pipeline_ != NULL) {
+		// the replies of the different nodes are allocated by their
+		// own pipeline channels concurrently, so each sub-command has
+		// its own dbuf and the result is copied into dbuf_.
+		std::vector<redis_pipeline_message*> msgs;
+		std::vector<dbuf_pool*> dbufs;
+
+		for (size_t i = 0; i < reqs.size(); i++) {
+			dbuf_pool* dbuf = create_dbuf();
+			redis_pipeline_message* msg = NEW redis_pipeline_message(
+				redis_pipeline_t_cmd, pipeline_->create_box());
+			msg->refer();
+			msg->set_option(dbuf, 0, timeout);
+			msg->set_request(reqs[i]);
+			msg->set_slot(slots[i]);
+			msgs.push_back(msg);
+			dbufs.push_back(dbuf);
+
+			pipeline_->push(msg);
+		}
+
+		out.clear();
+		for (size_t i = 0; i < msgs.size(); i++) {
+			const redis_result* rr = msgs[i]->wait();
+			out.push_back(rr ? copy_result(dbuf_, rr) : NULL);
+			msgs[i]->unrefer();
+			dbufs[i]->destroy();
+		}
+		return;
+	}
+
+	cluster_->run_batch(dbuf_, slots, reqs, out);
+
+	// run the sub-commands failed or redirected one by one, which will
+	// update the slots cached in the cluster; dbuf_ may be reset when
+	// redirecting, so another dbuf is used and the result is copied.
+	string*    buf  = request_buf_;
+	int        slot = slot_;
+	dbuf_pool* dbuf = dbuf_;
+	dbuf_pool* tmp  = NULL;
+
+	for (size_t i = 0; i < out.size(); i++) {
+		if (out[i] != NULL) {
+			continue;
+		}
+
+		if (tmp == NULL) {
+			tmp = create_dbuf();
+		} else {
+			tmp->dbuf_reset();
+		}
+
+		dbuf_        = tmp;
+		request_buf_ = (string*) reqs[i];
+		slot_        = slots[i];
+
+		const redis_result* rr = cluster_->run(*this, 0, timeout);
+
+		dbuf_  = dbuf;
+		out[i] = rr ? copy_result(dbuf_, rr) : NULL;
+	}
+
+	request_buf_ = buf;
+	slot_        = slot;
+
+	if (tmp != NULL) {
+		tmp->destroy();
+	}
+}
+
+const redis_result* redis_command::merge_results(size_t nkeys,
+	const std::vector<std::pair<size_t, size_t> >& pos,
+	const std::vector<const redis_result*>& results)
+{
+	// the failure or error of any sub-command is the result
+	redis_result_t type = REDIS_RESULT_NIL;
+	for (size_t i = 0; i < results.size(); i++) {
+		if (results[i] == NULL) {
+			return NULL;
+		}
+		if (results[i]->get_type() == REDIS_RESULT_ERROR) {
+			return results[i];
+		}
+		if (i == 0) {
+			type = results[i]->get_type();
+		} else if (results[i]->get_type() != type) {
+			logger_error("result type %d != %d", (int)
+				results[i]->get_type(), (int) type);
+			return NULL;
+		}
+	}
+
+	if (type == REDIS_RESULT_ARRAY) {
+		// such as MGET, the values are put in the order of the keys
+		redis_result* rr = new(dbuf_) redis_result(dbuf_);
+		rr->set_type(REDIS_RESULT_ARRAY);
+		rr->set_size(nkeys);
+
+		for (size_t i = 0; i < nkeys; i++) {
+			const redis_result* child =
+				results[pos[i].first]->get_child(pos[i].second);
+			if (child == NULL) {
+				logger_error("no child for key %d", (int) i);
+				return NULL;
+			}
+			rr->put(child, i);
+		}
+		return rr;
+	} else if (type == REDIS_RESULT_INTEGER) {
+		// such as DEL, the count is the sum of the sub-commands
+		long long int n = 0;
+		for (size_t i = 0; i < results.size(); i++) {
+			n += results[i]->get_integer64();
+		}
+
+		char* buf = (char*) dbuf_->dbuf_alloc(LONG_LEN);
+		int len = safe_snprintf(buf, LONG_LEN, "%lld", n);
+
+		redis_result* rr = new(dbuf_) redis_result(dbuf_);
+		rr->set_type(REDIS_RESULT_INTEGER);
+		rr->set_size(1);
+		rr->put(buf, (size_t) len);
+		return rr;
+	}
+
+	// such as MSET, return the first status different from the others
+	const char* status = results[0]->get(0);
+	for (size_t i = 1; i < results.size(); i++) {
+		const char* ptr = results[i]->get(0);
+		if (status == NULL || ptr == NULL || strcmp(status, ptr) != 0) {
+			return results[i];
+		}
+	}
+	return results[0];
+}
+
 /////////////////////////////////////////////////////////////////////////////
 
 void redis_command::logger_result(const redis_result* result)
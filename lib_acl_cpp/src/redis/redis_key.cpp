@@ -110,6 +110,7 @@ int redis_key::del_keys(const std::vector<string>& keys)
 	if (keys.size() == 1)
 		hash_slot(keys[0].c_str());
 	build("DEL", NULL, keys);
+	set_multi_keys(1);
 	return get_number();
 }
 
@@ -118,6 +119,7 @@ int redis_key::del_keys(const std::vector<const char*>& keys)
 	if (keys.size() == 1)
 		hash_slot(keys[0]);
 	build("DEL", NULL, keys);
+	set_multi_keys(1);
 	return get_number();
 }
 
@@ -126,6 +128,7 @@ int redis_key::del_keys(const char* keys[], size_t argc)
 	if (argc == 1)
 		hash_slot(keys[0]);
 	build("DEL", NULL, keys, argc);
+	set_multi_keys(1);
 	return get_number();
 }
 
@@ -134,6 +137,7 @@ int redis_key::del_keys(const char* keys[], const size_t lens[], size_t argc)
 	if (argc == 1)
 		hash_slot(keys[0], lens[0]);
 	build("DEL", NULL, keys, lens, argc);
+	set_multi_keys(1);
 	return get_number();
 }
 
@@ -179,6 +183,24 @@ bool redis_key::exists(const char* key, size_t len)
 	return get_number() > 0 ? true : false;
 }
 
+int redis_key::exists(const std::vector<string>& keys)
+{
+	if (keys.size() == 1)
+		hash_slot(keys[0].c_str());
+	build("EXISTS", NULL, keys);
+	set_multi_keys(1);
+	return get_number();
+}
+
+int redis_key::exists(const std::vector<const char*>& keys)
+{
+	if (keys.size() == 1)
+		hash_slot(keys[0]);
+	build("EXISTS", NULL, keys);
+	set_multi_keys(1);
+	return get_number();
+}
+
 int redis_key::expire(const char* key, int n)
 {
 	return expire(key, strlen(key), n);
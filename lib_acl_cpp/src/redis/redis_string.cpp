@@ -677,6 +677,7 @@ int redis_string::bitop(const char* op, const char* destkey,
 bool redis_string::mset(const std::map<string, string>& objs)
 {
 	build("MSET", NULL, objs);
+	set_multi_keys(2);
 	return check_status();
 }
 
@@ -684,12 +685,14 @@ bool redis_string::mset(const std::vector<string>& keys,
 	const std::vector<string>& values)
 {
 	build("MSET", NULL, keys, values);
+	set_multi_keys(2);
 	return check_status();
 }
 
 bool redis_string::mset(const char* keys[], const char* values[], size_t argc)
 {
 	build("MSET", NULL, keys, values, argc);
+	set_multi_keys(2);
 	return check_status();
 }
 
@@ -697,6 +700,7 @@ bool redis_string::mset(const char* keys[], const size_t keys_len[],
 	const char* values[], const size_t values_len[], size_t argc)
 {
 	build("MSET", NULL, keys, keys_len, values, values_len, argc);
+	set_multi_keys(2);
 	return check_status();
 }
 
@@ -734,6 +738,7 @@ bool redis_string::mget(const std::vector<string>& keys,
 	std::vector<string>* out /* = NULL */)
 {
 	build("MGET", NULL, keys);
+	set_multi_keys(1);
 	return get_strings(out) >= 0 ? true : false;
 }
 
@@ -741,6 +746,7 @@ bool redis_string::mget(const std::vector<const char*>& keys,
 	std::vector<string>* out /* = NULL */)
 {
 	build("MGET", NULL, keys);
+	set_multi_keys(1);
 	return get_strings(out) >= 0 ? true : false;
 }
 
@@ -757,6 +763,7 @@ bool redis_string::mget(std::vector<string>* out, const char* first_key, ...)
 	va_end(ap);
 
 	build("MGET", NULL, keys);
+	set_multi_keys(1);
 	return get_strings(out) >= 0 ? true : false;
 }
 
@@ -764,6 +771,7 @@ bool redis_string::mget(const char* keys[], size_t argc,
 	std::vector<string>* out /* = NULL */)
 {
 	build("MGET", NULL, keys, argc);
+	set_multi_keys(1);
 	return get_strings(out) >= 0 ? true : false;
 }
 
@@ -771,6 +779,7 @@ bool redis_string::mget(const char* keys[], const size_t keys_len[],
 	size_t argc, std::vector<string>* out /* = NULL */)
 {
 	build("MGET", NULL, keys, keys_len, argc);
+	set_multi_keys(1);
 	return get_strings(out) >= 0 ? true : false;
 }
 
@@ -0,0 +1,59 @@
+#include "acl_stdafx.hpp"
+#ifndef ACL_PREPARE_COMPILE
+#include "acl_cpp/stdlib/chtable.hpp"
+#endif
+
+namespace acl
+{
+
+chtable::chtable(int size, int nshards, bool key_lower)
+{
+	table_ = acl_chtable_create(size, nshards,
+		key_lower ? ACL_HTABLE_FLAG_KEY_LOWER : 0);
+}
+
+chtable::~chtable(void)
+{
+	acl_chtable_free(table_, NULL);
+}
+
+bool chtable::insert(const char* key, void* value)
+{
+	return acl_chtable_enter(table_, key, value, NULL)
+		== ACL_HTABLE_STAT_OK;
+}
+
+void* chtable::set(const char* key, void* value)
+{
+	void* old = NULL;
+
+	(void) acl_chtable_enter(table_, key, value, &old);
+	return old;
+}
+
+void* chtable::find(const char* key) const
+{
+	return acl_chtable_find(table_, key);
+}
+
+void* chtable::remove(const char* key)
+{
+	return acl_chtable_remove(table_, key);
+}
+
+void chtable::clear(void (*free_fn)(void*))
+{
+	(void) acl_chtable_reset(table_, free_fn);
+}
+
+void chtable::walk(void (*walk_fn)(const char*, void*, void*), void* arg)
+{
+	acl_chtable_walk(table_, walk_fn, arg);
+}
+
+size_t chtable::size(void) const
+{
+	return (size_t) acl_chtable_used(table_);
+}
+
+} // namespace acl
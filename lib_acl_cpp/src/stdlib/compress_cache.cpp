@@ -0,0 +1,168 @@
+#include "acl_stdafx.hpp"
+#ifndef ACL_PREPARE_COMPILE
+#include "acl_cpp/stdlib/log.hpp"
+#include "acl_cpp/stdlib/snprintf.hpp"
+#include "acl_cpp/stdlib/compress_codec.hpp"
+#include "acl_cpp/stdlib/compress_cache.hpp"
+#endif
+
+namespace acl {
+
+compress_variant::compress_variant(const char* key, const char* codec)
+: key_(key)
+{
+	safe_snprintf(codec_, sizeof(codec_), "%s", codec);
+}
+
+compress_variant::~compress_variant(void)
+{
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static const char* __codecs[] = { "gzip", "zstd", "br", NULL };
+
+// the variants of one key are cached with the codec as the prefix
+static void variant_key(const char* key, const char* codec, string& out)
+{
+	out.format("%s:%s", codec, key);
+}
+
+compress_cache::compress_cache(size_t max /* = 64 * 1024 * 1024 */)
+: max_(max > 0 ? max : 1)
+, size_(0)
+{
+}
+
+compress_cache::~compress_cache(void)
+{
+	clear();
+}
+
+void compress_cache::unlink(compress_variant* variant)
+{
+	variants_.erase(variant->key_);
+	lru_.erase(variant->lru_);
+	size_ -= variant->data_.size();
+}
+
+compress_variant* compress_cache::get(const char* key, const char* codec,
+	const void* data, size_t len)
+{
+	string name;
+	variant_key(key, codec, name);
+
+	lock_.lock();
+	std::map<string, compress_variant*>::iterator it = variants_.find(name);
+	if (it != variants_.end()) {
+		compress_variant* variant = it->second;
+		lru_.splice(lru_.begin(), lru_, variant->lru_);
+		variant->hold();
+		lock_.unlock();
+		++hits_;
+		return variant;
+	}
+	lock_.unlock();
+
+	++misses_;
+
+	// compressed once with the best level, so it's done without the lock
+	compress_codec* zip = compress_codec::get(codec);
+	if (zip == NULL) {
+		return NULL;
+	}
+
+	compress_variant* variant = NEW compress_variant(name, zip->name());
+	bool ok = zip->compress(data, len, &variant->data_, zip->best_level());
+	compress_codec::put(zip);
+
+	if (!ok) {
+		logger_error("compress %s with %s error", key, codec);
+		variant->release();
+		return NULL;
+	}
+
+	// the one too big isn't cached
+	if (variant->data_.size() > max_) {
+		return variant;
+	}
+
+	std::vector<compress_variant*> olds;
+
+	lock_.lock();
+	it = variants_.find(name);
+	if (it != variants_.end()) {
+		olds.push_back(it->second);
+		unlink(it->second);
+	}
+
+	variants_[name] = variant;
+	lru_.push_front(variant);
+	variant->lru_ = lru_.begin();
+	size_ += variant->data_.size();
+
+	while (size_ > max_) {
+		compress_variant* last = lru_.back();
+		olds.push_back(last);
+		unlink(last);
+	}
+
+	// one for the cache and one for the caller
+	variant->hold();
+	lock_.unlock();
+
+	for (std::vector<compress_variant*>::iterator cit = olds.begin();
+		cit != olds.end(); ++cit) {
+		(*cit)->release();
+	}
+	return variant;
+}
+
+void compress_cache::invalidate(const char* key)
+{
+	std::vector<compress_variant*> olds;
+	string name;
+
+	lock_.lock();
+	for (int i = 0; __codecs[i] != NULL; i++) {
+		variant_key(key, __codecs[i], name);
+		std::map<string, compress_variant*>::iterator it =
+			variants_.find(name);
+		if (it != variants_.end()) {
+			olds.push_back(it->second);
+			unlink(it->second);
+		}
+	}
+	lock_.unlock();
+
+	for (std::vector<compress_variant*>::iterator it = olds.begin();
+		it != olds.end(); ++it) {
+		(*it)->release();
+	}
+}
+
+void compress_cache::clear(void)
+{
+	std::list<compress_variant*> olds;
+
+	lock_.lock();
+	olds.swap(lru_);
+	variants_.clear();
+	size_ = 0;
+	lock_.unlock();
+
+	for (std::list<compress_variant*>::iterator it = olds.begin();
+		it != olds.end(); ++it) {
+		(*it)->release();
+	}
+}
+
+size_t compress_cache::size(void)
+{
+	lock_.lock();
+	size_t n = size_;
+	lock_.unlock();
+	return n;
+}
+
+} // namespace acl
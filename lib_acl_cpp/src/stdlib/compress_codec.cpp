@@ -0,0 +1,680 @@
+#include "acl_stdafx.hpp"
+#ifndef ACL_PREPARE_COMPILE
+#include "acl_cpp/stdlib/log.hpp"
+#include "acl_cpp/stdlib/string.hpp"
+#include "acl_cpp/stdlib/zlib_stream.hpp"
+#include "acl_cpp/stdlib/compress_codec.hpp"
+#endif
+
+// The zstd and brotli APIs used below, which are declared here because the
+// libraries are loaded dynamically and their headers may not be installed.
+
+typedef struct {
+	const void* src;
+	size_t size;
+	size_t pos;
+} zstd_in_t;
+
+typedef struct {
+	void*  dst;
+	size_t size;
+	size_t pos;
+} zstd_out_t;
+
+#define ZSTD_RESET_SESSION_ONLY		1
+#define ZSTD_C_COMPRESSION_LEVEL	100
+#define ZSTD_E_CONTINUE			0
+#define ZSTD_E_END			2
+
+typedef void* (*ZSTD_createCCtx_fn)(void);
+typedef size_t (*ZSTD_freeCCtx_fn)(void*);
+typedef size_t (*ZSTD_CCtx_reset_fn)(void*, int);
+typedef size_t (*ZSTD_CCtx_setParameter_fn)(void*, int, int);
+typedef size_t (*ZSTD_compressStream2_fn)(void*, zstd_out_t*, zstd_in_t*, int);
+typedef unsigned (*ZSTD_isError_fn)(size_t);
+typedef const char* (*ZSTD_getErrorName_fn)(size_t);
+
+static ZSTD_createCCtx_fn __ZSTD_createCCtx = NULL;
+static ZSTD_freeCCtx_fn __ZSTD_freeCCtx = NULL;
+static ZSTD_CCtx_reset_fn __ZSTD_CCtx_reset = NULL;
+static ZSTD_CCtx_setParameter_fn __ZSTD_CCtx_setParameter = NULL;
+static ZSTD_compressStream2_fn __ZSTD_compressStream2 = NULL;
+static ZSTD_isError_fn __ZSTD_isError = NULL;
+static ZSTD_getErrorName_fn __ZSTD_getErrorName = NULL;
+
+#define BROTLI_PARAM_QUALITY		1
+#define BROTLI_OP_PROCESS		0
+#define BROTLI_OP_FINISH		2
+
+typedef void* (*BrotliEncoderCreateInstance_fn)(void*, void*, void*);
+typedef int (*BrotliEncoderSetParameter_fn)(void*, int, unsigned);
+typedef int (*BrotliEncoderCompressStream_fn)(void*, int, size_t*,
+	const unsigned char**, size_t*, unsigned char**, size_t*);
+typedef int (*BrotliEncoderIsFinished_fn)(void*);
+typedef void (*BrotliEncoderDestroyInstance_fn)(void*);
+
+static BrotliEncoderCreateInstance_fn __BrotliEncoderCreateInstance = NULL;
+static BrotliEncoderSetParameter_fn __BrotliEncoderSetParameter = NULL;
+static BrotliEncoderCompressStream_fn __BrotliEncoderCompressStream = NULL;
+static BrotliEncoderIsFinished_fn __BrotliEncoderIsFinished = NULL;
+static BrotliEncoderDestroyInstance_fn __BrotliEncoderDestroyInstance = NULL;
+
+static acl_pthread_once_t __zstd_once = ACL_PTHREAD_ONCE_INIT;
+static ACL_DLL_HANDLE __zstd_dll = NULL;
+static acl::string __zstd_path;
+
+static acl_pthread_once_t __brotli_once = ACL_PTHREAD_ONCE_INIT;
+static ACL_DLL_HANDLE __brotli_dll = NULL;
+static acl::string __brotli_path;
+
+#if defined(_WIN32) || defined(_WIN64)
+# define ZSTD_LIB	"libzstd.dll"
+# define BROTLI_LIB	"brotlienc.dll"
+#elif defined(__APPLE__)
+# define ZSTD_LIB	"libzstd.dylib"
+# define BROTLI_LIB	"libbrotlienc.dylib"
+#else
+# define ZSTD_LIB	"libzstd.so.1"
+# define BROTLI_LIB	"libbrotlienc.so.1"
+#endif
+
+#define LOAD_SYM(dll, path, fn) do {                                    \
+	__##fn = (fn##_fn) acl_dlsym(dll, #fn);                         \
+	if (__##fn == NULL) {                                           \
+		logger_error("load %s from %s error: %s",               \
+			#fn, path, acl_dlerror());                      \
+		acl_dlclose(dll);                                       \
+		dll = NULL;                                             \
+		return;                                                 \
+	}                                                               \
+} while (0)
+
+// The libraries aren't unloaded when the process exits, because the codecs
+// pooled in the threads may be freed after that.
+
+static void __zstd_dll_load(void)
+{
+	const char* path = __zstd_path.empty() ? ZSTD_LIB : __zstd_path.c_str();
+
+	__zstd_dll = acl_dlopen(path);
+	if (__zstd_dll == NULL) {
+		logger_warn("load %s error: %s", path, acl_dlerror());
+		return;
+	}
+
+	LOAD_SYM(__zstd_dll, path, ZSTD_createCCtx);
+	LOAD_SYM(__zstd_dll, path, ZSTD_freeCCtx);
+	LOAD_SYM(__zstd_dll, path, ZSTD_CCtx_reset);
+	LOAD_SYM(__zstd_dll, path, ZSTD_CCtx_setParameter);
+	LOAD_SYM(__zstd_dll, path, ZSTD_compressStream2);
+	LOAD_SYM(__zstd_dll, path, ZSTD_isError);
+	LOAD_SYM(__zstd_dll, path, ZSTD_getErrorName);
+
+	logger("%s loaded", path);
+}
+
+static void __brotli_dll_load(void)
+{
+	const char* path = __brotli_path.empty()
+		? BROTLI_LIB : __brotli_path.c_str();
+
+	__brotli_dll = acl_dlopen(path);
+	if (__brotli_dll == NULL) {
+		logger_warn("load %s error: %s", path, acl_dlerror());
+		return;
+	}
+
+	LOAD_SYM(__brotli_dll, path, BrotliEncoderCreateInstance);
+	LOAD_SYM(__brotli_dll, path, BrotliEncoderSetParameter);
+	LOAD_SYM(__brotli_dll, path, BrotliEncoderCompressStream);
+	LOAD_SYM(__brotli_dll, path, BrotliEncoderIsFinished);
+	LOAD_SYM(__brotli_dll, path, BrotliEncoderDestroyInstance);
+
+	logger("%s loaded", path);
+}
+
+static bool zstd_load_once(void)
+{
+	acl_pthread_once(&__zstd_once, __zstd_dll_load);
+	return __zstd_dll != NULL;
+}
+
+static bool brotli_load_once(void)
+{
+	acl_pthread_once(&__brotli_once, __brotli_dll_load);
+	return __brotli_dll != NULL;
+}
+
+namespace acl {
+
+#define BUF_MIN	4096
+
+// make sure there's enough space at the end of the buffer
+static unsigned char* out_space(string* out, size_t& n)
+{
+	if (out->capacity() - out->length() < BUF_MIN) {
+		out->space(out->length() + BUF_MIN);
+	}
+	n = out->capacity() - out->length();
+	return (unsigned char*) out->c_str() + out->length();
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+// The gzip format of RFC 1952: the header, the raw deflate data and the
+// trailer with crc32 and the length of the data.
+
+class gzip_codec : public compress_codec {
+public:
+	gzip_codec(void) : crc32_(0), total_in_(0), head_sent_(false) {}
+	~gzip_codec(void) {}
+
+	// @override
+	const char* name(void) const
+	{
+		return "gzip";
+	}
+
+	// @override
+	int best_level(void) const
+	{
+		return zlib_best_compress;
+	}
+
+	// @override
+	bool begin(int level)
+	{
+		if (level < zlib_default || level > zlib_best_compress) {
+			level = zlib_default;
+		}
+		if (!zstream_.zip_begin((zlib_level_t) level, -zlib_wbits_15,
+			zlib_mlevel_9)) {
+			return false;
+		}
+		crc32_     = zstream_.crc32_update(0, NULL, 0);
+		total_in_  = 0;
+		head_sent_ = false;
+		return true;
+	}
+
+	// @override
+	bool update(const void* in, size_t len, string* out)
+	{
+		head(out);
+		crc32_     = zstream_.crc32_update(crc32_, in, len);
+		total_in_ += (unsigned) len;
+		return zstream_.zip_update((const char*) in, (int) len, out);
+	}
+
+	// @override
+	bool finish(string* out)
+	{
+		head(out);
+		if (!zstream_.zip_finish(out)) {
+			return false;
+		}
+
+		unsigned char trailer[8];
+		for (int i = 0; i < 4; i++) {
+			trailer[i]     = (unsigned char) (crc32_ >> (i * 8));
+			trailer[i + 4] = (unsigned char) (total_in_ >> (i * 8));
+		}
+		out->append(trailer, sizeof(trailer));
+		return true;
+	}
+
+private:
+	zlib_stream zstream_;
+	unsigned crc32_;
+	unsigned total_in_;
+	bool head_sent_;
+
+	void head(string* out)
+	{
+		// Unix OS_CODE: 3
+		static const unsigned char gzheader[10] =
+			{ 0x1f, 0x8b, 8, 0, 0, 0, 0, 0, 0, 3 };
+
+		if (!head_sent_) {
+			out->append(gzheader, sizeof(gzheader));
+			head_sent_ = true;
+		}
+	}
+};
+
+//////////////////////////////////////////////////////////////////////////////
+
+class zstd_codec : public compress_codec {
+public:
+	zstd_codec(void) : cctx_(__ZSTD_createCCtx()) {}
+
+	~zstd_codec(void)
+	{
+		if (cctx_) {
+			__ZSTD_freeCCtx(cctx_);
+		}
+	}
+
+	// @override
+	const char* name(void) const
+	{
+		return "zstd";
+	}
+
+	// @override
+	int best_level(void) const
+	{
+		return 19;
+	}
+
+	// @override
+	bool begin(int level)
+	{
+		if (cctx_ == NULL) {
+			logger_error("ZSTD_createCCtx error");
+			return false;
+		}
+		if (level < 0) {
+			level = 3;
+		}
+		// only the session is reset, the context's memory is reused
+		__ZSTD_CCtx_reset(cctx_, ZSTD_RESET_SESSION_ONLY);
+		size_t ret = __ZSTD_CCtx_setParameter(cctx_,
+			ZSTD_C_COMPRESSION_LEVEL, level);
+		if (__ZSTD_isError(ret)) {
+			logger_error("set zstd level %d error: %s", level,
+				__ZSTD_getErrorName(ret));
+			return false;
+		}
+		return true;
+	}
+
+	// @override
+	bool update(const void* in, size_t len, string* out)
+	{
+		zstd_in_t input = { in, len, 0 };
+		while (input.pos < input.size) {
+			if (!compress(&input, out, ZSTD_E_CONTINUE)) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// @override
+	bool finish(string* out)
+	{
+		zstd_in_t input = { NULL, 0, 0 };
+		while (true) {
+			size_t left;
+			if (!compress(&input, out, ZSTD_E_END, &left)) {
+				return false;
+			}
+			if (left == 0) {
+				return true;
+			}
+		}
+	}
+
+private:
+	void* cctx_;
+
+	bool compress(zstd_in_t* input, string* out, int mode,
+		size_t* left = NULL)
+	{
+		zstd_out_t output;
+		output.dst  = out_space(out, output.size);
+		output.pos  = 0;
+
+		size_t ret = __ZSTD_compressStream2(cctx_, &output, input, mode);
+		if (__ZSTD_isError(ret)) {
+			logger_error("zstd compress error: %s",
+				__ZSTD_getErrorName(ret));
+			return false;
+		}
+		out->set_offset(out->length() + output.pos);
+		if (left) {
+			*left = ret;
+		}
+		return true;
+	}
+};
+
+//////////////////////////////////////////////////////////////////////////////
+
+// Brotli has no API to reset the encoder, so one encoder is created for
+// each stream, and only the codec object is reused.
+
+class brotli_codec : public compress_codec {
+public:
+	brotli_codec(void) : state_(NULL) {}
+
+	~brotli_codec(void)
+	{
+		if (state_) {
+			__BrotliEncoderDestroyInstance(state_);
+		}
+	}
+
+	// @override
+	const char* name(void) const
+	{
+		return "br";
+	}
+
+	// @override
+	int best_level(void) const
+	{
+		return 11;
+	}
+
+	// @override
+	bool begin(int level)
+	{
+		if (state_) {
+			__BrotliEncoderDestroyInstance(state_);
+		}
+		state_ = __BrotliEncoderCreateInstance(NULL, NULL, NULL);
+		if (state_ == NULL) {
+			logger_error("BrotliEncoderCreateInstance error");
+			return false;
+		}
+		// the quality 11 is too slow for the dynamic content
+		if (level < 0 || level > 11) {
+			level = 4;
+		}
+		__BrotliEncoderSetParameter(state_, BROTLI_PARAM_QUALITY,
+			(unsigned) level);
+		return true;
+	}
+
+	// @override
+	bool update(const void* in, size_t len, string* out)
+	{
+		const unsigned char* next_in = (const unsigned char*) in;
+		size_t avail_in = len;
+
+		while (avail_in > 0) {
+			if (!compress(BROTLI_OP_PROCESS, &avail_in, &next_in, out)) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// @override
+	bool finish(string* out)
+	{
+		if (state_ == NULL) {
+			return false;
+		}
+
+		const unsigned char* next_in = NULL;
+		size_t avail_in = 0;
+
+		while (!__BrotliEncoderIsFinished(state_)) {
+			if (!compress(BROTLI_OP_FINISH, &avail_in, &next_in, out)) {
+				return false;
+			}
+		}
+
+		__BrotliEncoderDestroyInstance(state_);
+		state_ = NULL;
+		return true;
+	}
+
+private:
+	void* state_;
+
+	bool compress(int op, size_t* avail_in, const unsigned char** next_in,
+		string* out)
+	{
+		if (state_ == NULL) {
+			return false;
+		}
+
+		size_t n;
+		unsigned char* next_out = out_space(out, n);
+		size_t avail_out = n;
+
+		if (!__BrotliEncoderCompressStream(state_, op, avail_in,
+			next_in, &avail_out, &next_out, NULL)) {
+
+			logger_error("brotli compress error");
+			return false;
+		}
+		out->set_offset(out->length() + n - avail_out);
+		return true;
+	}
+};
+
+//////////////////////////////////////////////////////////////////////////////
+
+enum {
+	CODEC_GZIP,
+	CODEC_ZSTD,
+	CODEC_BR,
+	CODEC_MAX,
+};
+
+static const char* __codec_names[CODEC_MAX] = { "gzip", "zstd", "br" };
+
+static int codec_type(const char* name)
+{
+	for (int i = 0; i < CODEC_MAX; i++) {
+		if (strcasecmp(name, __codec_names[i]) == 0) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+bool compress_codec::compress(const void* in, size_t len, string* out,
+	int level /* = -1 */)
+{
+	return begin(level) && update(in, len, out) && finish(out);
+}
+
+bool compress_codec::supported(const char* name)
+{
+	switch (codec_type(name)) {
+	case CODEC_GZIP:
+		return zlib_stream::zlib_load_once();
+	case CODEC_ZSTD:
+		return zstd_load_once();
+	case CODEC_BR:
+		return brotli_load_once();
+	default:
+		return false;
+	}
+}
+
+void compress_codec::set_loadpath(const char* name, const char* path)
+{
+	if (path == NULL || *path == 0) {
+		return;
+	}
+
+	switch (codec_type(name)) {
+	case CODEC_GZIP:
+		zlib_stream::set_loadpath(path);
+		break;
+	case CODEC_ZSTD:
+		__zstd_path = path;
+		break;
+	case CODEC_BR:
+		__brotli_path = path;
+		break;
+	default:
+		break;
+	}
+}
+
+// Get the q value of the codec in Accept-Encoding, the one of "*" is used
+// if the codec isn't listed, and -1 means it isn't accepted at all.
+static double accept_q(const char* accept, const char* name)
+{
+	double star = -1;
+	string buf(accept);
+	std::vector<string>& tokens = buf.split2(",");
+
+	for (std::vector<string>::iterator it = tokens.begin();
+		it != tokens.end(); ++it) {
+
+		string& token = (*it).trim_space();
+		double q = 1;
+		char* ptr = strchr(token.c_str(), ';');
+		if (ptr) {
+			*ptr++ = 0;
+			if ((ptr = strstr(ptr, "q=")) != NULL) {
+				q = atof(ptr + 2);
+			}
+		}
+
+		if (strcasecmp(token.c_str(), name) == 0) {
+			return q;
+		} else if (strcmp(token.c_str(), "*") == 0) {
+			star = q;
+		}
+	}
+	return star;
+}
+
+const char* compress_codec::negotiate(const char* accept,
+	const char* prefer /* = "zstd, br, gzip" */)
+{
+	if (accept == NULL || *accept == 0 || prefer == NULL) {
+		return NULL;
+	}
+
+	string buf(prefer);
+	std::vector<string>& tokens = buf.split2(", \t");
+
+	for (std::vector<string>::const_iterator it = tokens.begin();
+		it != tokens.end(); ++it) {
+
+		int type = codec_type((*it).c_str());
+		if (type >= 0 && accept_q(accept, __codec_names[type]) > 0
+			&& supported(__codec_names[type])) {
+			return __codec_names[type];
+		}
+	}
+	return NULL;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+// the idle codecs of one thread
+
+struct codec_pool {
+	std::vector<compress_codec*> idle[CODEC_MAX];
+
+	~codec_pool(void)
+	{
+		for (int i = 0; i < CODEC_MAX; i++) {
+			for (size_t j = 0; j < idle[i].size(); j++) {
+				delete idle[i][j];
+			}
+		}
+	}
+};
+
+static size_t __pool_max = 64;
+static acl_pthread_key_t __pool_key;
+static codec_pool* __main_pool = NULL;
+
+static void pool_free(void* arg)
+{
+	codec_pool* pool = (codec_pool*) arg;
+	delete pool;
+}
+
+#ifndef HAVE_NO_ATEXIT
+static void main_pool_free(void)
+{
+	delete __main_pool;
+	__main_pool = NULL;
+}
+#endif
+
+static void pool_once(void)
+{
+	// the pools of the other threads are freed when they exit, whichever
+	// thread calls it first
+	acl_pthread_key_create(&__pool_key, pool_free);
+}
+
+static acl_pthread_once_t __pool_once = ACL_PTHREAD_ONCE_INIT;
+
+static codec_pool& get_pool(void)
+{
+	// the pool of the main thread isn't kept by the key, because the
+	// destructor of the key isn't called when the process exits, so it's
+	// freed by atexit
+	if ((unsigned long) acl_pthread_self() == acl_main_thread_self()) {
+		if (__main_pool == NULL) {
+			__main_pool = NEW codec_pool;
+#ifndef HAVE_NO_ATEXIT
+			atexit(main_pool_free);
+#endif
+		}
+		return *__main_pool;
+	}
+
+	acl_pthread_once(&__pool_once, pool_once);
+
+	codec_pool* pool = (codec_pool*) acl_pthread_getspecific(__pool_key);
+	if (pool != NULL) {
+		return *pool;
+	}
+
+	pool = NEW codec_pool;
+	acl_pthread_setspecific(__pool_key, pool);
+	return *pool;
+}
+
+void compress_codec::set_pool_max(size_t max)
+{
+	__pool_max = max;
+}
+
+compress_codec* compress_codec::get(const char* name)
+{
+	int type = codec_type(name);
+	if (type < 0 || !supported(name)) {
+		return NULL;
+	}
+
+	std::vector<compress_codec*>& idle = get_pool().idle[type];
+	if (!idle.empty()) {
+		compress_codec* codec = idle.back();
+		idle.pop_back();
+		return codec;
+	}
+
+	switch (type) {
+	case CODEC_GZIP:
+		return NEW gzip_codec;
+	case CODEC_ZSTD:
+		return NEW zstd_codec;
+	default:
+		return NEW brotli_codec;
+	}
+}
+
+void compress_codec::put(compress_codec* codec)
+{
+	if (codec == NULL) {
+		return;
+	}
+
+	std::vector<compress_codec*>& idle =
+		get_pool().idle[codec_type(codec->name())];
+	if (idle.size() < __pool_max) {
+		idle.push_back(codec);
+	} else {
+		delete codec;
+	}
+}
+
+} // namespace acl
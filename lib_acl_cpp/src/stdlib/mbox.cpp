@@ -33,6 +33,17 @@ void* mbox_read(void* mbox, int timeout, bool* success)
 	return o;
 }
 
+int mbox_read_batch(void* mbox, void** msgs, int max, int timeout,
+	bool* success)
+{
+	int ok;
+	int n = acl_mbox_read_batch((ACL_MBOX*) mbox, msgs, max, timeout, &ok);
+	if (success) {
+		*success = ok ? true : false;
+	}
+	return n;
+}
+
 size_t mbox_nsend(void* mbox)
 {
 	return acl_mbox_nsend((ACL_MBOX*) mbox);
@@ -331,10 +331,6 @@ acl_int64 md5::md5_file(istream& in, const void *key, size_t klen,
 	return n;
 }
 
-static const unsigned char hex_chars[] = "0123456789abcdef";
-
-#define UCHAR_PTR(x) ((const unsigned char *)(x))
-
 const char* md5::hex_encode(const void* in, size_t len, char* out, size_t size)
 {
 	// size ӦΪ: len * 2 + 1
@@ -342,17 +338,7 @@ const char* md5::hex_encode(const void* in, size_t len, char* out, size_t size)
 		abort();
 	}
 
-	const unsigned char *cp;
-	int     ch;
-	size_t  count, i = 0;
-
-	for (cp = UCHAR_PTR(in), count = len; count > 0; count--, cp++) {
-		ch = *cp;
-		out[i++] = hex_chars[(ch >> 4) & 0xf];
-		out[i++] = hex_chars[ch & 0xf];
-	}
-
-	out[i] = 0;
+	(void) acl_hex_encode_buf(in, len, out, 1);
 	return out;
 }
 
@@ -1804,12 +1804,20 @@ string& string::url_encode(const char* s, dbuf_pool* dbuf /* = NULL */)
 		return *this;
 	}
 
-	char *ptr = acl_url_encode(s, dbuf ? dbuf->get_dbuf() : NULL);
-
-	(*this) = ptr;
-	if (dbuf == NULL) {
-		acl_myfree(ptr);
+	// The temporary memory is allocated on dbuf as before if it's given.
+	if (dbuf != NULL) {
+		(*this) = acl_url_encode(s, dbuf->get_dbuf());
+		return *this;
 	}
+
+	// Encode into the internal buffer directly without temporary memory.
+	size_t len = strlen(s), n = acl_url_encode_size(s, len);
+
+	RSET(vbf_);
+	ACL_VSTRING_SPACE(vbf_, (ssize_t) n + 1);
+	n = acl_url_encode_buf(s, len, STR(vbf_));
+	ACL_VSTRING_AT_OFFSET(vbf_, (int) n);
+	TERM(vbf_);
 	return *this;
 }
 
@@ -1819,12 +1827,19 @@ string& string::url_decode(const char* s, dbuf_pool* dbuf /* = NULL */)
 		return *this;
 	}
 
-	char *ptr = acl_url_decode(s, dbuf ? dbuf->get_dbuf() : NULL);
-
-	(*this) = ptr;
-	if (dbuf == NULL) {
-		acl_myfree(ptr);
+	if (dbuf != NULL) {
+		(*this) = acl_url_decode(s, dbuf->get_dbuf());
+		return *this;
 	}
+
+	// Decode into the internal buffer directly without temporary memory.
+	size_t len = strlen(s), n;
+
+	RSET(vbf_);
+	ACL_VSTRING_SPACE(vbf_, (ssize_t) len + 1);
+	n = acl_url_decode_buf(s, len, STR(vbf_));
+	ACL_VSTRING_AT_OFFSET(vbf_, (int) n);
+	TERM(vbf_);
 	return *this;
 }
 
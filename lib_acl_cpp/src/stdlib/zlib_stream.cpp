@@ -260,6 +260,10 @@ zlib_stream::zlib_stream(void)
 	zstream_->zfree  = __zlib_free;
 	zstream_->opaque = (void*) this;
 
+	ready_           = 0;
+	ready_level_     = 0;
+	ready_wbits_     = 0;
+	ready_mlevel_    = 0;
 	is_compress_     = true;  // ĬΪѹ״̬
 	flush_           = zlib_flush_off;
 
@@ -284,9 +288,34 @@ zlib_stream::~zlib_stream(void)
 		(void) unzip_finish(&dummy);
 	}
 
+	end_ready();
 	acl_myfree(zstream_);
 }
 
+enum {
+	zlib_ready_none,
+	zlib_ready_zip,
+	zlib_ready_unzip,
+};
+
+void zlib_stream::end_ready(void)
+{
+#ifdef  HAS_ZLIB
+# if defined(ACL_CPP_DLL) || defined(HAS_ZLIB_DLL)
+	if (__deflateEnd == NULL || __inflateEnd == NULL) {
+		ready_ = zlib_ready_none;
+		return;
+	}
+# endif
+#endif
+	if (ready_ == zlib_ready_zip) {
+		__deflateEnd(zstream_);
+	} else if (ready_ == zlib_ready_unzip) {
+		__inflateEnd(zstream_);
+	}
+	ready_ = zlib_ready_none;
+}
+
 bool zlib_stream::zlib_compress(const char* in, int len, string* out,
 	zlib_level_t level /* = zlib_default */)
 {
@@ -556,6 +585,16 @@ bool zlib_stream::zip_begin(zlib_level_t level /* = zlib_default */,
 	zlib_flags_  = zlib_flags_zip_begin;
 	finished_    = false;
 	is_compress_ = true;
+
+	// reuse the deflate state allocated before
+	if (ready_ == zlib_ready_zip && ready_level_ == (int) level
+		&& ready_wbits_ == wbits && ready_mlevel_ == (int) mlevel
+		&& __deflateReset(zstream_) == Z_OK) {
+
+		return true;
+	}
+	end_ready();
+
 //	int ret = __deflateInit(zstream_, level, ZLIB_VERSION, sizeof(z_stream));
 
 #ifdef COSMOCC
@@ -570,6 +609,11 @@ bool zlib_stream::zip_begin(zlib_level_t level /* = zlib_default */,
 		logger_error("deflateInit error");
 		return false;
 	}
+
+	ready_        = zlib_ready_zip;
+	ready_level_  = (int) level;
+	ready_wbits_  = wbits;
+	ready_mlevel_ = (int) mlevel;
 	return true;
 }
 
@@ -604,10 +648,8 @@ bool zlib_stream::zip_finish(string* out)
 	}
 # endif
 #endif
-	bool ret = flush_out(__deflate, zlib_flush_finish, out);
-	//(void) __deflateReset(zstream_);
-	__deflateEnd(zstream_);
-	return ret;
+	// the deflate state is kept for the next zip_begin()
+	return flush_out(__deflate, zlib_flush_finish, out);
 }
 
 bool zlib_stream::zip_reset(void)
@@ -620,6 +662,10 @@ bool zlib_stream::zip_reset(void)
 	}
 # endif
 #endif
+	if (ready_ != zlib_ready_zip) {
+		return true;
+	}
+	ready_ = zlib_ready_none;
 	return __deflateEnd(zstream_) == Z_OK ? true : false;
 }
 
@@ -651,16 +697,27 @@ bool zlib_stream::unzip_begin(bool have_zlib_header /* = true */,
 	finished_    = false;
 	is_compress_ = false;
 
+	int wbits = have_zlib_header ? wsize : -wsize;
+	if (ready_ == zlib_ready_unzip && ready_wbits_ == wbits
+		&& __inflateReset(zstream_) == Z_OK) {
+
+		return true;
+	}
+	end_ready();
+
 #ifdef COSMOCC
-	int   ret = __inflateInit2(zstream_, have_zlib_header ?  wsize : -wsize);
+	int   ret = __inflateInit2(zstream_, wbits);
 #else
-	int   ret = __inflateInit2(zstream_, have_zlib_header ?
-		wsize : -wsize, ZLIB_VERSION, sizeof(z_stream));
+	int   ret = __inflateInit2(zstream_, wbits, ZLIB_VERSION,
+		sizeof(z_stream));
 #endif
 	if (ret != Z_OK) {
 		logger_error("inflateInit error");
 		return (false);
 	}
+
+	ready_       = zlib_ready_unzip;
+	ready_wbits_ = wbits;
 	return true;
 }
 
@@ -695,10 +752,8 @@ bool zlib_stream::unzip_finish(string* out)
 	}
 # endif
 #endif
-	bool ret = flush_out(__inflate, zlib_flush_finish, out);
-	//(void) __inflateReset(zstream_);
-	__inflateEnd(zstream_);
-	return ret;
+	// the inflate state is kept for the next unzip_begin()
+	return flush_out(__inflate, zlib_flush_finish, out);
 }
 
 bool zlib_stream::unzip_reset()
@@ -711,6 +766,10 @@ bool zlib_stream::unzip_reset()
 	}
 # endif
 #endif
+	if (ready_ != zlib_ready_unzip) {
+		return true;
+	}
+	ready_ = zlib_ready_none;
 	return __inflateEnd(zstream_) == Z_OK ? true : false;
 }
 
@@ -1,6 +1,7 @@
 #include "acl_stdafx.hpp"
 #ifndef ACL_PREPARE_COMPILE
 #include "acl_cpp/stdlib/log.hpp"
+#include "acl_cpp/stream/gather_buf.hpp"
 #include "acl_cpp/stream/aio_ostream.hpp"
 #endif
 
@@ -290,6 +291,29 @@ void aio_ostream::writev_await(const struct iovec *iov, int count)
 	acl_aio_writev(stream_, iov, count);
 }
 
+void aio_ostream::sendv_await(gather_buf& buf)
+{
+	acl_assert(stream_);
+
+	if (buf.empty()) {
+		return;
+	}
+
+	struct iovec iov[64];
+	std::vector<struct iovec> vec;
+	struct iovec* ptr = iov;
+	int n = (int) buf.count();
+
+	if (n > (int) (sizeof(iov) / sizeof(iov[0]))) {
+		vec.resize(n);
+		ptr = &vec[0];
+	}
+
+	n = buf.peek(ptr, n);
+	acl_aio_writev(stream_, ptr, n);
+	buf.clear();
+}
+
 void aio_ostream::format_await(const char* fmt, ...)
 {
 	va_list ap;
@@ -0,0 +1,193 @@
+#include "acl_stdafx.hpp"
+#ifndef ACL_PREPARE_COMPILE
+#include "acl_cpp/stream/gather_buf.hpp"
+#endif
+
+namespace acl {
+
+gather_ref::gather_ref(void)
+: refers_(1)
+{
+}
+
+gather_ref::~gather_ref(void)
+{
+}
+
+void gather_ref::hold(void)
+{
+	++refers_;
+}
+
+void gather_ref::release(void)
+{
+	if (--refers_ == 0) {
+		destroy();
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+gather_buf::gather_buf(size_t nslice /* = 16 */)
+: pos_(0)
+, off_(0)
+, size_(0)
+{
+	slices_.reserve(nslice);
+}
+
+gather_buf::~gather_buf(void)
+{
+	clear();
+}
+
+gather_buf& gather_buf::add(const void* data, size_t len)
+{
+	return add(data, len, NULL);
+}
+
+gather_buf& gather_buf::add(const string& s)
+{
+	return add(s.c_str(), s.size(), NULL);
+}
+
+gather_buf& gather_buf::add(const void* data, size_t len, gather_ref* ref)
+{
+	if (data == NULL || len == 0) {
+		return *this;
+	}
+
+	slice s;
+	s.ptr = (const char*) data;
+	s.off = 0;
+	s.len = len;
+	s.ref = ref;
+	if (ref) {
+		ref->hold();
+	}
+
+	slices_.push_back(s);
+	size_ += len;
+	return *this;
+}
+
+gather_buf& gather_buf::copy(const void* data, size_t len)
+{
+	if (data == NULL || len == 0) {
+		return *this;
+	}
+
+	// merge into the last slice if it was copied, too
+	if (slices_.size() > pos_ && slices_.back().ptr == NULL) {
+		slices_.back().len += len;
+	} else {
+		slice s;
+		s.ptr = NULL;
+		s.off = cbuf_.size();
+		s.len = len;
+		s.ref = NULL;
+		slices_.push_back(s);
+	}
+
+	cbuf_.append(data, len);
+	size_ += len;
+	return *this;
+}
+
+gather_buf& gather_buf::format(const char* fmt, ...)
+{
+	va_list ap;
+	va_start(ap, fmt);
+	vformat(fmt, ap);
+	va_end(ap);
+	return *this;
+}
+
+gather_buf& gather_buf::vformat(const char* fmt, va_list ap)
+{
+	size_t n = cbuf_.size();
+	cbuf_.vformat_append(fmt, ap);
+	n = cbuf_.size() - n;
+	if (n == 0) {
+		return *this;
+	}
+
+	if (slices_.size() > pos_ && slices_.back().ptr == NULL) {
+		slices_.back().len += n;
+	} else {
+		slice s;
+		s.ptr = NULL;
+		s.off = cbuf_.size() - n;
+		s.len = n;
+		s.ref = NULL;
+		slices_.push_back(s);
+	}
+
+	size_ += n;
+	return *this;
+}
+
+int gather_buf::peek(struct iovec* iov, int max) const
+{
+	int n = 0;
+	size_t off = off_;
+
+	for (size_t i = pos_; i < slices_.size() && n < max; i++) {
+		const slice& s = slices_[i];
+		const char* ptr = s.ptr ? s.ptr : cbuf_.c_str() + s.off;
+
+		iov[n].iov_base = (char*) ptr + off;
+		iov[n].iov_len  = s.len - off;
+		off = 0;
+		n++;
+	}
+	return n;
+}
+
+void gather_buf::consume(size_t n)
+{
+	if (n > size_) {
+		n = size_;
+	}
+	size_ -= n;
+
+	while (n > 0 && pos_ < slices_.size()) {
+		slice& s = slices_[pos_];
+		size_t left = s.len - off_;
+
+		if (n < left) {
+			off_ += n;
+			break;
+		}
+
+		n -= left;
+		off_ = 0;
+		pos_++;
+		if (s.ref) {
+			s.ref->release();
+			s.ref = NULL;
+		}
+	}
+
+	// all sent, reuse the space
+	if (size_ == 0) {
+		clear();
+	}
+}
+
+void gather_buf::clear(void)
+{
+	for (size_t i = pos_; i < slices_.size(); i++) {
+		if (slices_[i].ref) {
+			slices_[i].ref->release();
+		}
+	}
+
+	slices_.clear();
+	cbuf_.clear();
+	pos_  = 0;
+	off_  = 0;
+	size_ = 0;
+}
+
+} // namespace acl
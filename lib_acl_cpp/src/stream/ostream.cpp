@@ -1,8 +1,12 @@
 #include "acl_stdafx.hpp"
 #ifndef ACL_PREPARE_COMPILE
+#include "acl_cpp/stream/gather_buf.hpp"
 #include "acl_cpp/stream/ostream.hpp"
 #endif
 
+// The max number of the slices in one writev.
+#define	SENDV_MAX	64
+
 namespace acl {
 
 int ostream::write(const void* data, size_t size, bool loop /* = true */,
@@ -74,6 +78,47 @@ int ostream::writev(const struct iovec *v, int count, bool loop /* = true */)
 	return ret;
 }
 
+int ostream::sendv(gather_buf& buf, bool loop /* = true */)
+{
+	struct iovec iov[SENDV_MAX + 1];
+	int total = 0;
+
+	while (!buf.empty() || stream_->wbuf_dlen > 0) {
+		size_t wlen = (size_t) stream_->wbuf_dlen;
+		int n = 0;
+
+		// send the data buffered before the slices in one call
+		if (wlen > 0) {
+			iov[0].iov_base = (char*) stream_->wbuf;
+			iov[0].iov_len  = wlen;
+			stream_->wbuf_dlen = 0;
+			n++;
+		}
+
+		n += buf.peek(iov + n, SENDV_MAX);
+
+		int ret = acl_vstream_writev(stream_, iov, n);
+		if (ret == ACL_VSTREAM_EOF) {
+			eof_ = true;
+			return -1;
+		}
+
+		if ((size_t) ret < wlen) {
+			memmove(stream_->wbuf, stream_->wbuf + ret, wlen - ret);
+			stream_->wbuf_dlen = (int) (wlen - ret);
+		} else {
+			buf.consume(ret - wlen);
+		}
+
+		total += ret;
+		if (!loop) {
+			break;
+		}
+	}
+
+	return total;
+}
+
 int ostream::vformat(const char* fmt, va_list ap)
 {
 	int   ret = acl_vstream_vfprintf(stream_, fmt, ap);
@@ -182,4 +227,19 @@ void ostream::set_wbuf_size(size_t n) {
 	acl_vstream_set_wbuf_size((unsigned) n);
 }
 
+void ostream::set_wbuf(size_t n)
+{
+	if (stream_ == NULL || n <= (size_t) stream_->wbuf_size) {
+		return;
+	}
+
+	// the data buffered are kept
+	if (stream_->wbuf == NULL) {
+		stream_->wbuf = (unsigned char*) acl_mymalloc(n);
+	} else {
+		stream_->wbuf = (unsigned char*) acl_myrealloc(stream_->wbuf, n);
+	}
+	stream_->wbuf_size = (unsigned) n;
+}
+
 } // namespace acl
@@ -2,8 +2,14 @@
 #ifndef ACL_PREPARE_COMPILE
 #include "acl_cpp/stdlib/snprintf.hpp"
 #include "acl_cpp/stdlib/log.hpp"
+#include "acl_cpp/stream/fstream.hpp"
+#include "acl_cpp/stream/gather_buf.hpp"
 #include "acl_cpp/stream/socket_stream.hpp"
-#include "acl_cpp/stream/socket_stream.hpp"
+#endif
+
+#ifdef ACL_LINUX
+#include <fcntl.h>
+#include <sys/sendfile.h>
 #endif
 
 namespace acl {
@@ -182,6 +188,160 @@ bool socket_stream::shutdown_readwrite(void)
 	return acl_socket_shutdown(ACL_VSTREAM_SOCK(stream_), SHUT_RDWR) == 0;
 }
 
+#define SMALL_FILE	16384
+
+#ifdef ACL_LINUX
+
+// Wait for the socket being writable when sendfile or splice returns EAGAIN,
+// the fiber hooked ones have waited for it in the fiber scheduler.
+static bool wait_writable(ACL_VSTREAM* fp)
+{
+	int err = acl_last_error();
+	if (err == ACL_EINTR) {
+		return true;
+	}
+	if (err != ACL_EAGAIN && err != ACL_EWOULDBLOCK) {
+		return false;
+	}
+	if (fp->rw_timeout <= 0) {
+		return acl_write_wait(ACL_VSTREAM_SOCK(fp), -1) == 0;
+	}
+	if (ACL_VSTREAM_IS_MS(fp)) {
+		return acl_write_wait_ms(ACL_VSTREAM_SOCK(fp),
+			fp->rw_timeout) == 0;
+	}
+	return acl_write_wait(ACL_VSTREAM_SOCK(fp), fp->rw_timeout) == 0;
+}
+
+// Move the data from the file to the socket through the pipe.
+static ssize_t splice_file(ACL_VSTREAM* fp, int pipefd[2], int fd,
+	loff_t* off, size_t len)
+{
+	unsigned flags = SPLICE_F_MOVE | SPLICE_F_MORE;
+	ssize_t n = splice(fd, off, pipefd[1], NULL, len, flags);
+	if (n <= 0) {
+		return n;
+	}
+
+	for (ssize_t left = n; left > 0;) {
+		ssize_t ret = splice(pipefd[0], NULL, ACL_VSTREAM_SOCK(fp),
+			NULL, (size_t) left, flags);
+		if (ret > 0) {
+			left -= ret;
+		} else if (ret == 0 || !wait_writable(fp)) {
+			return -1;
+		}
+	}
+	return n;
+}
+
+#endif // ACL_LINUX
+
+acl_int64 socket_stream::send_file(fstream& in, acl_int64 offset,
+	acl_int64 count /* = -1 */)
+{
+	if (stream_ == NULL) {
+		logger_error("stream_ null");
+		return -1;
+	}
+
+	if (offset < 0) {
+		offset = 0;
+	}
+	if (count < 0) {
+		count = in.fsize() - offset;
+	}
+	if (count <= 0) {
+		return 0;
+	}
+
+	acl_int64 total = 0;
+
+#ifdef ACL_LINUX
+	// the small file is read and sent in one writev together with the
+	// data buffered before, which is cheaper than one more write
+	if (get_hook() == NULL && count > SMALL_FILE) {
+		// send the data buffered before, such as the HTTP header
+		if (!fflush()) {
+			return -1;
+		}
+
+		int fd = in.file_handle();
+		loff_t off = (loff_t) offset;
+		int pipefd[2] = { -1, -1 };
+
+		while (total < count) {
+			// the max length of sendfile each time is about 2GB
+			size_t len = (size_t) (count - total > 0x40000000
+				? 0x40000000 : count - total);
+			ssize_t ret;
+
+			if (pipefd[0] >= 0) {
+				ret = splice_file(stream_, pipefd, fd, &off, len);
+			} else {
+				ret = sendfile64(ACL_VSTREAM_SOCK(stream_),
+					fd, &off, len);
+			}
+
+			if (ret > 0) {
+				total += ret;
+			} else if (ret == 0) {
+				break;  // the file has been truncated
+			} else if (pipefd[0] < 0 && (errno == EINVAL
+					|| errno == ENOSYS)) {
+				// the file doesn't support mmap, try splice
+				if (pipe(pipefd) == -1) {
+					logger_error("pipe error %s", last_serror());
+					eof_ = true;
+					return -1;
+				}
+			} else if (!wait_writable(stream_)) {
+				eof_ = true;
+				total = -1;
+				break;
+			}
+		}
+
+		if (pipefd[0] >= 0) {
+			::close(pipefd[0]);
+			::close(pipefd[1]);
+		}
+		return total;
+	}
+#endif
+
+#ifndef ACL_UNIX
+	if (in.fseek(offset, SEEK_SET) < 0) {
+		logger_error("fseek %s error %s", in.file_path(), last_serror());
+		return -1;
+	}
+#endif
+
+	char buf[SMALL_FILE];
+	gather_buf gbuf(1);
+
+	while (total < count) {
+		size_t len = (size_t) (count - total > (acl_int64) sizeof(buf)
+			? sizeof(buf) : count - total);
+#ifdef ACL_UNIX
+		// read by offset, the file may be shared, see http_file_cache
+		ssize_t ret = pread(in.file_handle(), buf, len,
+			(off_t) (offset + total));
+#else
+		int ret = in.read(buf, len, false);
+#endif
+		if (ret <= 0) {
+			break;
+		}
+		gbuf.add(buf, (size_t) ret);
+		if (sendv(gbuf) < 0) {
+			return -1;
+		}
+		total += ret;
+	}
+	return total;
+}
+
 ACL_SOCKET socket_stream::sock_handle(void) const
 {
 	if (stream_ == NULL) {
@@ -246,6 +246,7 @@ stream_hook* stream::remove_hook(void)
 		stream_->write_fn   = acl_socket_write;
 		stream_->writev_fn  = acl_socket_writev;
 		stream_->close_fn   = acl_socket_close;
+		stream_->flag      &= ~ACL_VSTREAM_FLAG_WRITEV_HOOK;
 	}
 
 	return hook;
@@ -279,11 +280,14 @@ stream_hook* stream::setup_hook(stream_hook* hook)
 			return hook;
 		}
 	} else {
-		ACL_VSTREAM_RD_FN read_fn  = stream_->read_fn;
-		ACL_VSTREAM_WR_FN write_fn = stream_->write_fn;
-
-		stream_->read_fn  = read_hook;
-		stream_->write_fn = send_hook;
+		ACL_VSTREAM_RD_FN read_fn    = stream_->read_fn;
+		ACL_VSTREAM_WR_FN write_fn   = stream_->write_fn;
+		ACL_VSTREAM_WV_FN writev_fn  = stream_->writev_fn;
+
+		stream_->read_fn   = read_hook;
+		stream_->write_fn  = send_hook;
+		stream_->writev_fn = sendv_hook;
+		stream_->flag     |= ACL_VSTREAM_FLAG_WRITEV_HOOK;
 		acl_vstream_add_object(stream_, HOOK_KEY, this);
 
 		acl_tcp_set_nodelay(ACL_VSTREAM_SOCK(stream_));
@@ -291,8 +295,10 @@ stream_hook* stream::setup_hook(stream_hook* hook)
 		if (!hook->open(stream_)) {
 			// ʧܣָ
 
-			stream_->read_fn  = read_fn;
-			stream_->write_fn = write_fn;
+			stream_->read_fn   = read_fn;
+			stream_->write_fn  = write_fn;
+			stream_->writev_fn = writev_fn;
+			stream_->flag     &= ~ACL_VSTREAM_FLAG_WRITEV_HOOK;
 			acl_vstream_del_object(stream_, HOOK_KEY);
 			return hook;
 		}
@@ -341,6 +347,19 @@ int stream::fread_hook(ACL_FILE_HANDLE, void *buf, size_t len, int,
 	return s->hook_->read(buf, len);
 }
 
+int stream::sendv_hook(ACL_SOCKET, const struct iovec *vec, int count, int,
+	ACL_VSTREAM* vs, void *)
+{
+	stream* s = (stream*) acl_vstream_get_object(vs, HOOK_KEY);
+	acl_assert(s);
+
+	if (s->hook_ == NULL) {
+		logger_error("hook_ null");
+		return -1;
+	}
+	return s->hook_->sendv(vec, count);
+}
+
 int stream::fsend_hook(ACL_FILE_HANDLE, const void *buf, size_t len, int,
 	ACL_VSTREAM* vs, void *)
 {
@@ -0,0 +1,32 @@
+#include "acl_stdafx.hpp"
+#ifndef ACL_PREPARE_COMPILE
+#include "acl_cpp/stream/stream_hook.hpp"
+#endif
+
+namespace acl {
+
+// Not larger than the stack of one fiber may hold.
+#define	SENDV_BUF	8192
+
+int stream_hook::sendv(const struct iovec* vec, int count)
+{
+	char   buf[SENDV_BUF];
+	size_t n = 0;
+
+	for (int i = 0; i < count; i++) {
+		if (vec[i].iov_len > sizeof(buf) - n) {
+			break;
+		}
+		memcpy(buf + n, vec[i].iov_base, vec[i].iov_len);
+		n += vec[i].iov_len;
+	}
+
+	if (n > 0) {
+		return send(buf, n);
+	}
+
+	// the first vector is too large to be copied
+	return send(vec[0].iov_base, vec[0].iov_len);
+}
+
+} // namespace acl
@@ -245,6 +245,11 @@ FIBER_API void acl_fiber_schedule(void);
  * event type is FIBER_EVENT_KERNEL. acl_fiber_schedule using the default
  * event type. FIBER_EVENT_KERNEL is diffrent for diffrent OS platform:
  * Linux: epoll; BSD: kqueue; Windows: iocp.
+ * FIBER_EVENT_EPOLL_ET uses epoll in edge-triggered mode, in which each socket
+ * is added into epoll only once and kept in it until being closed, and the
+ * fiber reading one socket will be suspended only when EAGAIN returned, so
+ * most of the epoll_ctl and epoll_wait calls can be saved; it's the same as
+ * FIBER_EVENT_KERNEL on the other platforms except Linux.
  * @param event_mode {int} the event type, defined as FIBER_EVENT_XXX
  */
 #define FIBER_EVENT_KERNEL	0	/* epoll/kqueue/iocp	*/
@@ -252,6 +257,7 @@ FIBER_API void acl_fiber_schedule(void);
 #define FIBER_EVENT_SELECT	2	/* select		*/
 #define FIBER_EVENT_WMSG	3	/* win message		*/
 #define	FIBER_EVENT_IO_URING	4	/* io_uring of Linux5.x */
+#define	FIBER_EVENT_EPOLL_ET	5	/* epoll in edge-triggered mode */
 FIBER_API void acl_fiber_schedule_with(int event_mode);
 
 /**
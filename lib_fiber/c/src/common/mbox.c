@@ -2,9 +2,9 @@
 #include "fiber/libfiber.h"
 
 #include "msg.h"
-#include "pthread_patch.h"
-#include "ypipe.h"
+#include "atomic.h"
 #include "iostuff.h"
+#include "gettimeofday.h"
 #include "mbox.h"
 
 #if defined(__linux__) && !defined(MINGW)
@@ -26,13 +26,41 @@
 
 //#  undef  HAS_EVENTFD
 
+/*
+ * The producers push the messages onto a lock-free stack with CAS, and the
+ * consumer takes all of them with one exchange and reverses them into its
+ * own FIFO list. Before sleeping the consumer puts MBOX_SLEEPING on the empty
+ * stack, and only the producer replacing it writes the notification.
+ *
+ * The nodes read are kept by the consumer and given back to the cache of
+ * the mbox when it's empty, from which one producer at most takes a node
+ * with the trylock, the others just malloc, so no node can be taken and
+ * returned while another producer is popping it.
+ */
+
+typedef struct MBOX_NODE MBOX_NODE;
+struct MBOX_NODE {
+	void      *msg;
+	MBOX_NODE *next;
+};
+
+static char __sleeping_mark;
+#define MBOX_SLEEPING	((void*) &__sleeping_mark)
+
+// The max nodes kept by the consumer, the others will be freed.
+#define MBOX_CACHE_MAX	1024
+
 struct MBOX {
 	socket_t in;
 	socket_t out;
 	size_t nsend;
 	size_t nread;
-	YPIPE *ypipe;
-	pthread_mutex_t *lock;
+	ATOMIC *top;		/* the stack pushed by the producers */
+	MBOX_NODE *head;	/* the FIFO list owned by the consumer */
+	ATOMIC *cache;		/* the free nodes taken by the producers */
+	ATOMIC *cache_lock;	/* held by the producer taking from cache */
+	MBOX_NODE *free;	/* the free nodes kept by the consumer */
+	int nfree;
 };
 
 socket_t mbox_in(MBOX *mbox)
@@ -45,7 +73,7 @@ socket_t mbox_out(MBOX *mbox)
 	return mbox->out;
 }
 
-MBOX *mbox_create(unsigned type)
+MBOX *mbox_create(unsigned type fiber_unused)
 {
 	MBOX *mbox;
 	socket_t fds[2];
@@ -68,39 +96,161 @@ MBOX *mbox_create(unsigned type)
 	}
 #endif
 
+	// The same lock-free queue is used for both MBOX_T_SPSC and
+	// MBOX_T_MPSC, the type is kept for compatibility.
 	mbox        = (MBOX *) malloc(sizeof(MBOX));
 	mbox->in    = fds[0];
 	mbox->out   = fds[1];
 	mbox->nsend = 0;
 	mbox->nread = 0;
-	mbox->ypipe = ypipe_new();
+	mbox->top   = atomic_new();
+	mbox->head  = NULL;
+	mbox->cache = atomic_new();
+	mbox->cache_lock = atomic_new();
+	mbox->free  = NULL;
+	mbox->nfree = 0;
 
-	if (type == MBOX_T_MPSC) {
-		mbox->lock  = (pthread_mutex_t *)
-			calloc(1, sizeof(pthread_mutex_t));
+	return mbox;
+}
 
-		if (pthread_mutex_init(mbox->lock, NULL) != 0) {
-			msg_fatal("%s(%d), %s: pthread_mutex_init error",
-				__FILE__, __LINE__, __FUNCTION__);
+static long long mbox_now(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return (long long) tv.tv_sec * 1000 + tv.tv_usec / 1000;
+}
+
+// Called by the producers.
+static MBOX_NODE *mbox_node_get(MBOX *mbox)
+{
+	MBOX_NODE *node = NULL;
+
+	// Don't wait if another producer is taking from the cache.
+	if (atomic_cas(mbox->cache_lock, NULL, mbox) == NULL) {
+		// The consumer can only change the cache from NULL.
+		node = (MBOX_NODE *) atomic_cas(mbox->cache, NULL, NULL);
+		if (node != NULL) {
+			(void) atomic_cas(mbox->cache, node, node->next);
 		}
-	} else {
-		mbox->lock = NULL;
+		(void) atomic_cas(mbox->cache_lock, mbox, NULL);
 	}
 
-	return mbox;
+	if (node == NULL) {
+		node = (MBOX_NODE *) malloc(sizeof(MBOX_NODE));
+	}
+	return node;
+}
+
+// Give the nodes kept back to the producers if they've used up the cache.
+static void mbox_recycle(MBOX *mbox)
+{
+	if (mbox->free != NULL
+		&& atomic_cas(mbox->cache, NULL, mbox->free) == NULL) {
+
+		mbox->free  = NULL;
+		mbox->nfree = 0;
+	}
+}
+
+// Called by the consumer.
+static void mbox_node_put(MBOX *mbox, MBOX_NODE *node)
+{
+	if (mbox->nfree >= MBOX_CACHE_MAX) {
+		mbox_recycle(mbox);
+		if (mbox->nfree >= MBOX_CACHE_MAX) {
+			free(node);
+			return;
+		}
+	}
+
+	node->next  = mbox->free;
+	mbox->free  = node;
+	mbox->nfree++;
+}
+
+static void mbox_nodes_free(MBOX_NODE *node)
+{
+	MBOX_NODE *next;
+
+	for (; node != NULL; node = next) {
+		next = node->next;
+		free(node);
+	}
+}
+
+static MBOX_NODE *mbox_reverse(MBOX_NODE *node)
+{
+	MBOX_NODE *prev = NULL, *next;
+
+	while (node != NULL) {
+		next       = node->next;
+		node->next = prev;
+		prev       = node;
+		node       = next;
+	}
+	return prev;
+}
+
+// Move all the messages in the stack into the consumer's FIFO list.
+static void mbox_grab(MBOX *mbox)
+{
+	// CAS with the same value is used to load the top.
+	void *top = atomic_cas(mbox->top, NULL, NULL);
+
+	mbox_recycle(mbox);
+
+	// Don't take away the mark when the consumer is sleeping.
+	if (top == NULL || top == MBOX_SLEEPING) {
+		return;
+	}
+
+	// Only the consumer can set the top to NULL or MBOX_SLEEPING.
+	top = atomic_xchg(mbox->top, NULL);
+	mbox->head = mbox_reverse((MBOX_NODE *) top);
+}
+
+static void *mbox_pop(MBOX *mbox)
+{
+	MBOX_NODE *node;
+	void *msg;
+
+	if (mbox->head == NULL) {
+		mbox_grab(mbox);
+		if (mbox->head == NULL) {
+			return NULL;
+		}
+	}
+
+	node       = mbox->head;
+	mbox->head = node->next;
+	msg        = node->msg;
+	mbox_node_put(mbox, node);
+	return msg;
 }
 
 void mbox_free(MBOX *mbox, void (*free_fn)(void*))
 {
+	void *msg;
+
 	CLOSE_SOCKET(mbox->in);
 	if (mbox->out != mbox->in) {
 		CLOSE_SOCKET(mbox->out);
 	}
-	ypipe_free(mbox->ypipe, free_fn);
-	if (mbox->lock != NULL) {
-		pthread_mutex_destroy(mbox->lock);
-		free(mbox->lock);
+
+	// Remove the mark if the consumer was sleeping.
+	(void) atomic_cas(mbox->top, MBOX_SLEEPING, NULL);
+	while ((msg = mbox_pop(mbox)) != NULL) {
+		if (free_fn) {
+			free_fn(msg);
+		}
 	}
+
+	mbox_nodes_free(mbox->free);
+	mbox_nodes_free((MBOX_NODE *) atomic_xchg(mbox->cache, NULL));
+	atomic_free(mbox->top);
+	atomic_free(mbox->cache);
+	atomic_free(mbox->cache_lock);
 	free(mbox);
 }
 
@@ -108,26 +258,23 @@ int mbox_send(MBOX *mbox, void *msg)
 {
 	int ret;
 	long long n = 1;
-	pthread_mutex_t *lock = mbox->lock;
-
-	if (lock) {
-		pthread_mutex_lock(lock);
-	}
+	MBOX_NODE *node = mbox_node_get(mbox);
+	void *top, *old;
 
-	ypipe_write(mbox->ypipe, msg);
-	ret = ypipe_flush(mbox->ypipe);
+	node->msg = msg;
+	top = atomic_cas(mbox->top, NULL, NULL);
 
-#if defined(HAS_EVENTFD)
-	if (lock) {
-		pthread_mutex_unlock(lock);
-	}
-#endif
-	if (ret == 0) {
-#if !defined(HAS_EVENTFD)
-		if (lock) {
-			pthread_mutex_unlock(lock);
+	while (1) {
+		node->next = top == MBOX_SLEEPING ? NULL : (MBOX_NODE *) top;
+		old = atomic_cas(mbox->top, top, node);
+		if (old == top) {
+			break;
 		}
-#endif
+		top = old;
+	}
+
+	// Only the first message after the consumer sleeping wakes it up.
+	if (top != MBOX_SLEEPING) {
 		return 0;
 	}
 
@@ -139,12 +286,6 @@ int mbox_send(MBOX *mbox, void *msg)
 	ret = (int) acl_fiber_write(mbox->out, &n, sizeof(n));
 #endif
 
-#if !defined(HAS_EVENTFD)
-	if (lock) {
-		pthread_mutex_unlock(lock);
-	}
-#endif
-
 	if (ret == -1) {
 		msg_error("%s(%d), %s: mbox write %d error %s", __FILE__,
 			__LINE__, __FUNCTION__, mbox->out, last_serror());
@@ -156,53 +297,113 @@ int mbox_send(MBOX *mbox, void *msg)
 
 void *mbox_read(MBOX *mbox, int timeout, int *success)
 {
-	int  ret;
-	long long n;
-	void *msg = ypipe_read(mbox->ypipe);
+	int  ret, left = timeout;
+	long long n, expire = 0;
+	void *msg = mbox_pop(mbox);
 
-	if (msg != NULL) {
+	if (msg != NULL || timeout == 0) {
 		if (success) {
 			*success = 1;
 		}
 		return msg;
-	} else if (timeout == 0) {
+	}
+
+	// Tell the producers that we're going to sleep, if some message
+	// has been pushed before it, just return it.
+	if (atomic_cas(mbox->top, NULL, MBOX_SLEEPING) != NULL) {
 		if (success) {
 			*success = 1;
 		}
-		return NULL;
+		return mbox_pop(mbox);
 	}
 
 	mbox->nread++;
 
-	if (timeout > 0 && read_wait(mbox->in, timeout) < 0) {
-		if (acl_fiber_last_error() == FIBER_ETIME) {
+	if (timeout > 0) {
+		expire = mbox_now() + timeout;
+	}
+
+	while (1) {
+		// Wait for the time left only after a stale notification.
+		if (timeout > 0) {
+			left = (int) (expire - mbox_now());
+			if (left < 0) {
+				left = 0;
+			}
+		}
+
+		if (timeout > 0 && read_wait(mbox->in, left) < 0) {
+			int timedout = acl_fiber_last_error() == FIBER_ETIME;
+
+			// Wakeup by ourselves if no message was sent, or else
+			// the notification will be read next time.
+			if (atomic_cas(mbox->top, MBOX_SLEEPING, NULL)
+				!= MBOX_SLEEPING) {
+
+				if (success) {
+					*success = 1;
+				}
+				return mbox_pop(mbox);
+			}
+
 			if (success) {
-				*success = 1;
+				*success = timedout ? 1 : 0;
 			}
-		} else if (success) {
-			*success = 0;
+			return NULL;
 		}
-		return NULL;
-	}
 
 #if defined(_WIN32) || defined(_WIN64)
-	ret = (int) acl_fiber_recv(mbox->in, (char*) &n, (int) sizeof(n), 0);
+		ret = (int) acl_fiber_recv(mbox->in, (char*) &n, (int) sizeof(n), 0);
 #else
-	ret = (int) acl_fiber_read(mbox->in, &n, sizeof(n));
+		ret = (int) acl_fiber_read(mbox->in, &n, sizeof(n));
 #endif
 
-	if (ret == -1) {
+		if (ret == -1) {
+			(void) atomic_cas(mbox->top, MBOX_SLEEPING, NULL);
+			if (success) {
+				*success = 0;
+			}
+			return NULL;
+		}
+
+		msg = mbox_pop(mbox);
+		if (msg != NULL) {
+			if (success) {
+				*success = 1;
+			}
+			return msg;
+		}
+
+		// The notification left by the last timeout was read and
+		// we're still sleeping, so wait again.
+	}
+}
+
+int mbox_read_batch(MBOX *mbox, void *msgs[], int max, int timeout,
+	int *success)
+{
+	int n;
+
+	if (max <= 0) {
 		if (success) {
-			*success = 0;
+			*success = 1;
 		}
-		return NULL;
+		return 0;
+	}
+
+	msgs[0] = mbox_read(mbox, timeout, success);
+	if (msgs[0] == NULL) {
+		return 0;
 	}
 
-	if (success) {
-		*success = 1;
+	for (n = 1; n < max; n++) {
+		msgs[n] = mbox_pop(mbox);
+		if (msgs[n] == NULL) {
+			break;
+		}
 	}
 
-	return ypipe_read(mbox->ypipe);
+	return n;
 }
 
 size_t mbox_nsend(MBOX *mbox)
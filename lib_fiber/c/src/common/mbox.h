@@ -38,6 +38,19 @@ int mbox_send(MBOX *mbox, void *msg);
  */
 void *mbox_read(MBOX *mbox, int timeout, int *success);
 
+/**
+ * Read the messages in batch, wait as mbox_read() only when the mbox is
+ * empty, and then take the messages pending without waiting again.
+ * @param mbox {MBOX*}
+ * @param msgs {void**} hold the messages read
+ * @param max {int} the max number of msgs
+ * @param timeout {int} same as in mbox_read()
+ * @param success {int*} same as in mbox_read()
+ * @return {int} the number of the messages read, 0 if timeout or error
+ */
+int mbox_read_batch(MBOX *mbox, void *msgs[], int max, int timeout,
+	int *success);
+
 /**
  * õǰϢѾɹ͵Ϣ
  * @param mbox {MBOX*} Ϣж
@@ -23,6 +23,7 @@ void event_set(int event_mode)
 	case FIBER_EVENT_SELECT:
 	case FIBER_EVENT_WMSG:
 	case FIBER_EVENT_IO_URING:
+	case FIBER_EVENT_EPOLL_ET:
 		__event_mode = event_mode;
 		break;
 	default:
@@ -62,6 +63,12 @@ EVENT *event_create(int size)
 		assert(0);
 #endif
 		break;
+	case FIBER_EVENT_EPOLL_ET:
+#ifdef	HAS_EPOLL
+		ev = event_epoll_et_create(size);
+		break;
+#endif
+		// Fall through - use the default event of the current OS.
 	default:
 #if	defined(HAS_EPOLL)
 		ev = event_epoll_create(size);
@@ -396,6 +403,12 @@ void event_close(EVENT *ev, FILE_EVENT *fe)
 		ev->del_write(ev, fe);
 	}
 
+#ifdef	HAS_EPOLL
+	if (fe->mask & EVENT_ETADDED) {
+		event_epoll_et_close(ev, fe);
+	}
+#endif
+
 	/* when one fiber add read/write and del read/write by another fiber
 	 * in one loop, the fe->mask maybe be 0 and the fiber's fe maybe been
 	 * added into events task list
@@ -116,6 +116,7 @@ struct FILE_EVENT {
 #define	STATUS_WRITEWAIT	(unsigned) (1 << 6)	// Wait for Writable
 #define	STATUS_CLOSING		(unsigned) (1 << 7)	// In closing status
 #define	STATUS_CLOSED		(unsigned) (1 << 8)	// In closed status
+#define	STATUS_ETSTREAM		(unsigned) (1 << 9)	// Stream socket in ET mode
 
 #define	SET_CONNECTING(x)	((x)->status |= STATUS_CONNECTING)
 #define	SET_READABLE(x)		((x)->status |= STATUS_READABLE)
@@ -126,6 +127,7 @@ struct FILE_EVENT {
 #define	SET_WRITEWAIT(x)	((x)->status |= STATUS_WRITEWAIT)
 #define	SET_CLOSING(x)		((x)->status |= STATUS_CLOSING)
 #define	SET_CLOSED(x)		((x)->status |= STATUS_CLOSED)
+#define	SET_ETSTREAM(x)		((x)->status |= STATUS_ETSTREAM)
 
 #define	CLR_CONNECTING(x)	((x)->status &= ~STATUS_CONNECTING)
 #define	CLR_READABLE(x)		((x)->status &= ~STATUS_READABLE)
@@ -136,6 +138,7 @@ struct FILE_EVENT {
 #define	CLR_WRITEWAIT(x)	((x)->status &= ~STATUS_WRITEWAIT)
 #define	CLR_CLOSING(x)		((x)->status &= ~STATUS_CLOSING)
 #define	CLR_CLOSED(x)		((x)->status &= ~STATUS_CLOSED)
+#define	CLR_ETSTREAM(x)		((x)->status &= ~STATUS_ETSTREAM)
 
 #define	IS_CONNECTING(x)	((x)->status & STATUS_CONNECTING)
 #define	IS_READABLE(x)		((x)->status & STATUS_READABLE)
@@ -146,6 +149,7 @@ struct FILE_EVENT {
 #define	IS_WRITEWAIT(x)		((x)->status & STATUS_WRITEWAIT)
 #define	IS_CLOSING(x)		((x)->status & STATUS_CLOSING)
 #define	IS_CLOSED(x)		((x)->status & STATUS_CLOSED)
+#define	IS_ETSTREAM(x)		((x)->status & STATUS_ETSTREAM)
 
 	unsigned type;
 #define	TYPE_NONE		(unsigned) (0)
@@ -202,6 +206,11 @@ struct FILE_EVENT {
 #define	EVENT_SO_RCVTIMEO	(unsigned) (1 << 29)
 #define	EVENT_SO_SNDTIMEO	(unsigned) (1 << 30)
 
+// The fd has been added into epoll with EPOLLIN | EPOLLOUT | EPOLLET once
+// and will be kept in it until being closed, the STATUS_READABLE and
+// STATUS_WRITABLE flags hold the readiness of it in user space.
+#define	EVENT_ETADDED		(unsigned) (1U << 31)
+
 	event_proc   *r_proc;
 	event_proc   *w_proc;
 #ifdef HAS_POLL
@@ -377,8 +386,10 @@ struct EVENT {
 	unsigned flag;
 #define EVENT_F_IOCP		(1 << 0)
 #define	EVENT_F_IO_URING	(1 << 1)
+#define	EVENT_F_EPOLL_ET	(1 << 2)
 #define EVENT_IS_IOCP(x)	((x)->flag & EVENT_F_IOCP)
 #define	EVENT_IS_IO_URING(x)	((x)->flag & EVENT_F_IO_URING)
+#define	EVENT_IS_EPOLL_ET(x)	((x)->flag & EVENT_F_EPOLL_ET)
 
 #ifdef HAS_POLL
 	TIMER_CACHE *poll_list;
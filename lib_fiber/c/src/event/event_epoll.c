@@ -207,6 +207,126 @@ static int epoll_del_write(EVENT_EPOLL *ep, FILE_EVENT *fe)
 	return -1;
 }
 
+/* In the edge-triggered mode, the fd is added into epoll with EPOLLIN,
+ * EPOLLOUT and EPOLLET only once when it's monitored for the first time, and
+ * kept in epoll until it's closed; the later adding and deleting just change
+ * the mask in user space without calling epoll_ctl. Because no more event
+ * will be reported for the fd which is still in ready status, the fd should
+ * be re-armed with EPOLL_CTL_MOD when one fiber waits for it but it may be
+ * ready now, that is, STATUS_READABLE or STATUS_WRITABLE has been set.
+ * The fd in blocking status, which can't be read or written until EAGAIN,
+ * will be monitored in the level-triggered mode as before.
+ */
+static int epoll_et_ctl(EVENT_EPOLL *ep, FILE_EVENT *fe, int op)
+{
+	struct epoll_event ee;
+
+	ee.events   = EPOLLIN | EPOLLOUT | EPOLLET;
+	ee.data.u64 = 0;
+	ee.data.ptr = fe;
+
+	if (__sys_epoll_ctl(ep->epfd, op, fe->fd, &ee) == 0) {
+		return 0;
+	}
+
+	if (errno != EPERM) {
+		msg_error("%s(%d): epoll_ctl error %s, epfd=%d, fd=%d, op=%d",
+			__FUNCTION__, __LINE__, last_serror(), ep->epfd,
+			fe->fd, op);
+	}
+	return -1;
+}
+
+static int epoll_et_add(EVENT_EPOLL *ep, FILE_EVENT *fe, unsigned mask,
+	int ready)
+{
+	if (fe->mask & EVENT_ETADDED) {
+		if (ready && epoll_et_ctl(ep, fe, EPOLL_CTL_MOD) == -1) {
+			return -1;
+		}
+		fe->mask |= mask;
+		return 0;
+	}
+
+	if (epoll_et_ctl(ep, fe, EPOLL_CTL_ADD) == -1) {
+		return -1;
+	}
+
+	// Less data than requested being read from a stream socket means
+	// that it has been drained, which is used in hook/fiber_read.c.
+	if (getsocktype(fe->fd) == SOCK_STREAM) {
+		SET_ETSTREAM(fe);
+	}
+
+	fe->mask |= EVENT_ETADDED | mask;
+	ep->event.fdcount++;
+	return 0;
+}
+
+// Check if the fd should be monitored in the level-triggered mode.
+static int epoll_et_level(FILE_EVENT *fe)
+{
+	if (fe->mask & EVENT_ETADDED) {
+		return 0;
+	}
+	if (fe->mask & (EVENT_READ | EVENT_WRITE)) {
+		return 1;
+	}
+	return is_non_blocking(fe->fd) ? 0 : 1;
+}
+
+static int epoll_et_add_read(EVENT_EPOLL *ep, FILE_EVENT *fe)
+{
+	if (epoll_et_level(fe)) {
+		return epoll_add_read(ep, fe);
+	}
+	return epoll_et_add(ep, fe, EVENT_READ, IS_READABLE(fe) ? 1 : 0);
+}
+
+static int epoll_et_add_write(EVENT_EPOLL *ep, FILE_EVENT *fe)
+{
+	if (epoll_et_level(fe)) {
+		return epoll_add_write(ep, fe);
+	}
+	return epoll_et_add(ep, fe, EVENT_WRITE, IS_WRITABLE(fe) ? 1 : 0);
+}
+
+static int epoll_et_del_read(EVENT_EPOLL *ep, FILE_EVENT *fe)
+{
+	if (!(fe->mask & EVENT_ETADDED)) {
+		return epoll_del_read(ep, fe);
+	}
+
+	fe->mask &= ~EVENT_READ;
+	return 0;
+}
+
+static int epoll_et_del_write(EVENT_EPOLL *ep, FILE_EVENT *fe)
+{
+	if (!(fe->mask & EVENT_ETADDED)) {
+		return epoll_del_write(ep, fe);
+	}
+
+	fe->mask &= ~EVENT_WRITE;
+	return 0;
+}
+
+void event_epoll_et_close(EVENT *ev, FILE_EVENT *fe)
+{
+	EVENT_EPOLL *ep = (EVENT_EPOLL *) ev;
+
+	if (!(fe->mask & EVENT_ETADDED)) {
+		return;
+	}
+
+	// Remove the fd from epoll explicitly, because the fd maybe has been
+	// duplicated and the epoll item wouldn't be removed by closing it.
+	if (epoll_et_ctl(ep, fe, EPOLL_CTL_DEL) == 0) {
+		ep->event.fdcount--;
+	}
+	fe->mask &= ~(EVENT_ETADDED | EVENT_READ | EVENT_WRITE);
+}
+
 static int epoll_event_wait(EVENT *ev, int timeout)
 {
 	EVENT_EPOLL *ep = (EVENT_EPOLL *) ev;
@@ -238,6 +358,18 @@ static int epoll_event_wait(EVENT *ev, int timeout)
 
 #define ERR	(EPOLLERR | EPOLLHUP)
 
+		// The readiness of the fd in edge-triggered mode will be
+		// reported only once, so it must be saved even if no fiber
+		// is waiting for it now.
+		if (fe && (fe->mask & EVENT_ETADDED)) {
+			if (ee->events & (EPOLLIN | ERR)) {
+				SET_READABLE(fe);
+			}
+			if (ee->events & (EPOLLOUT | ERR)) {
+				SET_WRITABLE(fe);
+			}
+		}
+
 		if (ee->events & (EPOLLIN | ERR) && fe && fe->r_proc) {
 			if (ee->events & EPOLLERR) {
 				fe->mask |= EVENT_ERR;
@@ -314,6 +446,18 @@ static const char *epoll_name(void)
 	return "epoll";
 }
 
+EVENT *event_epoll_et_create(int size)
+{
+	EVENT *ev = event_epoll_create(size);
+
+	ev->flag     |= EVENT_F_EPOLL_ET;
+	ev->add_read  = (event_oper *) epoll_et_add_read;
+	ev->add_write = (event_oper *) epoll_et_add_write;
+	ev->del_read  = (event_oper *) epoll_et_del_read;
+	ev->del_write = (event_oper *) epoll_et_del_write;
+	return ev;
+}
+
 EVENT *event_epoll_create(int size)
 {
 	EVENT_EPOLL *ep = (EVENT_EPOLL *) mem_calloc(1, sizeof(EVENT_EPOLL));
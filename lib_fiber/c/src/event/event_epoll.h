@@ -6,6 +6,8 @@
 #ifdef HAS_EPOLL
 
 EVENT *event_epoll_create(int setsize);
+EVENT *event_epoll_et_create(int setsize);
+void event_epoll_et_close(EVENT *ev, FILE_EVENT *fe);
 
 #endif
 
@@ -147,8 +147,27 @@ int fiber_iocp_read(FILE_EVENT *fe, char *buf, int len)
 // fd, not including file fd, the event_add_read will
 // not monitor the file fd in fiber_wait_read.
 
+// In the edge-triggered mode of epoll, the fd is assumed to be readable
+// after being read successfully, so the fiber will read it directly next
+// time without waiting, and will be suspended only when EAGAIN returned;
+// but if less data than requested was read from a stream socket, which
+// has been drained, the fiber will wait for the next event directly.
+// The _size 0 means that the requested size is unknown.
+
+#define ET_READ_DONE(_fe, _ret, _size) do {                                  \
+    size_t _n = (size_t) (_size);                                            \
+    if (!((_fe)->mask & EVENT_ETADDED)) {                                    \
+        break;                                                               \
+    }                                                                        \
+    if ((_ret) == 0 || !IS_ETSTREAM((_fe)) || (size_t) (_ret) >= _n) {       \
+        SET_READABLE((_fe));                                                 \
+    } else {                                                                 \
+        CLR_READABLE((_fe));                                                 \
+    }                                                                        \
+} while (0)
+
 #if defined(_WIN32) || defined(_WIN64)
-#define FIBER_READ(_fn, _fe, ...) do {                                       \
+#define FIBER_READ(_fn, _fe, _size, ...) do {                                \
     ssize_t ret;                                                             \
     int err;                                                                 \
     if (IS_READABLE((_fe))) {                                                \
@@ -173,7 +192,7 @@ int fiber_iocp_read(FILE_EVENT *fe, char *buf, int len)
     }                                                                        \
 } while (1)
 #else
-#define FIBER_READ(_fn, _fe, _args...) do {                                  \
+#define FIBER_READ(_fn, _fe, _size, _args...) do {                           \
     ssize_t ret;                                                             \
     int err;                                                                 \
     if (IS_READABLE((_fe))) {                                                \
@@ -186,6 +205,7 @@ int fiber_iocp_read(FILE_EVENT *fe, char *buf, int len)
     }                                                                        \
     ret = (*_fn)((_fe)->fd, ##_args);                                        \
     if (ret >= 0) {                                                          \
+        ET_READ_DONE((_fe), ret, (_size));                                   \
         return ret;                                                          \
     }                                                                        \
     err = acl_fiber_last_error();                                            \
@@ -196,6 +216,7 @@ int fiber_iocp_read(FILE_EVENT *fe, char *buf, int len)
         }                                                                    \
         return -1;                                                           \
     }                                                                        \
+    CLR_READABLE((_fe));                                                     \
 } while (1)
 #endif
 
@@ -243,7 +264,7 @@ ssize_t fiber_read(FILE_EVENT *fe,  void *buf, size_t count)
 	}
 #endif
 
-	FIBER_READ(sys_read, fe, buf, count);
+	FIBER_READ(sys_read, fe, count, buf, count);
 }
 
 ssize_t fiber_readv(FILE_EVENT *fe, const struct iovec *iov, int iovcnt)
@@ -279,7 +300,7 @@ ssize_t fiber_readv(FILE_EVENT *fe, const struct iovec *iov, int iovcnt)
 	}
 #endif
 
-	FIBER_READ(sys_readv, fe, iov, iovcnt);
+	FIBER_READ(sys_readv, fe, 0, iov, iovcnt);
 }
 
 ssize_t fiber_recvmsg(FILE_EVENT *fe, struct msghdr *msg, int flags)
@@ -314,7 +335,7 @@ ssize_t fiber_recvmsg(FILE_EVENT *fe, struct msghdr *msg, int flags)
 	}
 #endif
 
-	FIBER_READ(sys_recvmsg, fe, msg, flags);
+	FIBER_READ(sys_recvmsg, fe, 0, msg, flags);
 }
 
 # ifdef HAS_MMSG
@@ -334,7 +355,7 @@ ssize_t fiber_recvmmsg(FILE_EVENT *fe, struct mmsghdr *msgvec,
 		}
 	}
 
-	FIBER_READ(sys_recvmmsg, fe, msgvec, vlen, flags, NULL);
+	FIBER_READ(sys_recvmmsg, fe, 0, msgvec, vlen, flags, NULL);
 }
 # endif // HAS_MMSG
 
@@ -382,9 +403,10 @@ ssize_t fiber_recv(FILE_EVENT *fe, void *buf, size_t len, int flags)
 #endif
 
 #ifdef SYS_WIN
-	FIBER_READ(sys_recv, fe, buf, (int) len, flags);
+	FIBER_READ(sys_recv, fe, 0, buf, (int) len, flags);
 #else
-	FIBER_READ(sys_recv, fe, buf, len, flags);
+	FIBER_READ(sys_recv, fe, (flags & MSG_PEEK) ? 0 : len,
+		buf, len, flags);
 #endif
 }
 
@@ -429,8 +451,10 @@ ssize_t fiber_recvfrom(FILE_EVENT *fe, void *buf, size_t len,
 #endif
 
 #ifdef SYS_WIN
-	FIBER_READ(sys_recvfrom, fe, buf, (int) len, flags, src_addr, addrlen);
+	FIBER_READ(sys_recvfrom, fe, 0, buf, (int) len, flags,
+		src_addr, addrlen);
 #else
-	FIBER_READ(sys_recvfrom, fe, buf, len, flags, src_addr, addrlen);
+	FIBER_READ(sys_recvfrom, fe, (flags & MSG_PEEK) ? 0 : len,
+		buf, len, flags, src_addr, addrlen);
 #endif
 }
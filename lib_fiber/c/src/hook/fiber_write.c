@@ -35,6 +35,10 @@ static int wait_write(FILE_EVENT *fe)
 {
 	CLR_POLLING(fe);
 
+	// The fd isn't writable now, which is known by EAGAIN returned, so
+	// the epoll in edge-triggered mode needn't re-arm it.
+	CLR_WRITABLE(fe);
+
 	if (fiber_wait_write(fe) < 0) {
 		fiber_file_free(fe);
 		return -1;
@@ -415,6 +419,7 @@ ssize_t fiber_sendfile64(socket_t out_fd, int in_fd, off64_t *offset, size_t cou
 
 		fe = fiber_file_open(out_fd);
 		CLR_POLLING(fe);
+		CLR_WRITABLE(fe);
 
 		if (fiber_wait_write(fe) < 0) {
 			msg_error("%s(%d): fiber_wait_write error=%s, fd=%d",
@@ -9,6 +9,7 @@
 #include "common.h"
 
 #include "fiber.h"
+#include "event/event_epoll.h"
 #include "hook.h"
 #include "io.h"
 
@@ -112,6 +113,17 @@ int WINAPI acl_fiber_close(socket_t fd)
 	}
 
 	ev = fiber_io_event();
+
+#ifdef	HAS_EPOLL
+	// event_close() is skipped when the fe is being closed by another
+	// fiber, so the edge-triggered registration is removed here before
+	// the fd is closed, or else the duplicated fd would keep reporting
+	// the events of the fe to be freed.
+	if (ev && (fe->mask & EVENT_ETADDED)) {
+		event_epoll_et_close(ev, fe);
+	}
+#endif
+
 	if (ev && ev->close_sock) {
 		ret = ev->close_sock(ev, fe);
 		if (ret == 0) {
@@ -172,6 +172,10 @@ socket_t WINAPI acl_fiber_accept(socket_t sockfd, struct sockaddr *addr,
 
 	fe = fiber_file_open(sockfd);
 
+	// No connection can be accepted now, so the readiness saved by the
+	// epoll in edge-triggered mode should be cleared before waiting.
+	CLR_READABLE(fe);
+
 	while (1) {
 		if (fiber_wait_read(fe) < 0) {
 			msg_error("%s(%d): fiber_wait_read error=%s, fd=%d",
@@ -225,6 +229,8 @@ socket_t WINAPI acl_fiber_accept(socket_t sockfd, struct sockaddr *addr,
 		if (!error_again(err)) {
 			return INVALID_SOCKET;
 		}
+
+		CLR_READABLE(fe);
 	}
 #else /* !FAST_ACCEPT */
 	fe = fiber_file_open(sockfd);
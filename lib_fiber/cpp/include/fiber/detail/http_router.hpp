@@ -0,0 +1,272 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstring>
+#include <algorithm>
+
+namespace acl {
+
+/**
+ * The parameters matched by http_router, the names refer to the routes and
+ * the values are kept as the offsets in the path, so nothing is allocated
+ * when matching; bind() terminates the values in the path and sets them.
+ */
+struct http_route_params {
+	enum { max = 16 };
+
+	const char* names[max];
+	const char* values[max];
+	size_t      offs[max];
+	size_t      ends[max];
+	size_t      count = 0;
+
+	void bind(char* path) {
+		for (size_t i = 0; i < count; i++) {
+			path[ends[i]] = 0;
+			values[i] = path + offs[i];
+		}
+	}
+};
+
+/**
+ * The radix tree router of one HTTP method. In the route such as
+ * "/users/:id/posts", the segment beginning with ':' matches one segment
+ * of the path, and the last segment beginning with '*', such as "*file",
+ * matches all the rest. The static parts are case insensitive, and the
+ * trailing '/' is optional. When matching, the static child is tried first,
+ * then the parameter, then the wildcard.
+ */
+template<typename Handler>
+class http_router {
+public:
+	http_router(void) : root_(new node) {}
+	~http_router(void) { delete root_; }
+
+	http_router(const http_router&) = delete;
+	http_router& operator=(const http_router&) = delete;
+
+	/**
+	 * Add the route, the handler of the same route will be replaced.
+	 * @param path {const char*}
+	 * @param handler {Handler}
+	 * @return {bool} false if the route is invalid, or the name of the
+	 *  parameter conflicts with the one of the other route
+	 */
+	bool add(const char* path, Handler handler) {
+		if (path == nullptr || *path == 0) {
+			return false;
+		}
+
+		std::string buf(path);
+		size_t slash = buf.rfind('/');
+		bool wild = slash != std::string::npos
+			&& buf[slash + 1] == '*';
+		if (!wild && buf[buf.size() - 1] != '/') {
+			buf += '/';
+		}
+
+		node* n = root_;
+		size_t nparams = 0;
+		const char* s = buf.c_str();
+
+		while (*s) {
+			if ((*s == ':' || *s == '*')
+				&& (s == buf.c_str() || s[-1] == '/')) {
+
+				bool is_wild = *s == '*';
+				const char* e = is_wild ? nullptr : strchr(s, '/');
+				if (e == nullptr) {
+					e = s + strlen(s);
+				}
+
+				std::string name(s + 1, e);
+				if (name.empty()
+					|| ++nparams > http_route_params::max) {
+					return false;
+				}
+
+				node*& child = is_wild ? n->wildcard : n->param;
+				if (child == nullptr) {
+					child = new node;
+					child->name = name;
+				} else if (child->name != name) {
+					return false;
+				}
+
+				n = child;
+				s = e;
+				continue;
+			}
+
+			// the static part till the next parameter
+			const char* e = s;
+			while (*e && !(*e == '/' && (e[1] == ':' || e[1] == '*'))) {
+				e++;
+			}
+			if (*e) {
+				e++;
+			}
+
+			n = add_static(n, s, e - s);
+			s = e;
+		}
+
+		if (!n->has_handler) {
+			n->has_handler = true;
+			count_++;
+		}
+		n->handler = std::move(handler);
+		return true;
+	}
+
+	/**
+	 * Match the path with the routes.
+	 * @param path {const char*} the path ending with '/'
+	 * @param params {http_route_params&} store the parameters
+	 * @return {const Handler*} nullptr if not found
+	 */
+	const Handler* match(const char* path, http_route_params& params) const {
+		params.count = 0;
+		const Handler* handler = nullptr;
+		if (match(root_, path, 0, params, handler)) {
+			return handler;
+		}
+		params.count = 0;
+		return nullptr;
+	}
+
+	/**
+	 * The number of the routes added.
+	 * @return {size_t}
+	 */
+	size_t size(void) const {
+		return count_;
+	}
+
+private:
+	struct node {
+		std::string prefix;		// the static part in lower case
+		std::string indices;		// the first chars of the children
+		std::vector<node*> children;
+		node*       param    = nullptr;
+		node*       wildcard = nullptr;
+		std::string name;		// the name of the parameter
+		bool        has_handler = false;
+		Handler     handler;
+
+		~node(void) {
+			for (node* child : children) {
+				delete child;
+			}
+			delete param;
+			delete wildcard;
+		}
+	};
+
+	node*  root_;
+	size_t count_ = 0;
+
+	static char lower(char ch) {
+		return ch >= 'A' && ch <= 'Z' ? ch + 'a' - 'A' : ch;
+	}
+
+	static node* add_static(node* n, const char* s, size_t len) {
+		while (len > 0) {
+			size_t pos = n->indices.find(lower(*s));
+			if (pos == std::string::npos) {
+				node* child = new node;
+				for (size_t i = 0; i < len; i++) {
+					child->prefix += lower(s[i]);
+				}
+				n->indices += child->prefix[0];
+				n->children.push_back(child);
+				return child;
+			}
+
+			node* child = n->children[pos];
+			size_t i = 0, max = std::min(len, child->prefix.size());
+			while (i < max && lower(s[i]) == child->prefix[i]) {
+				i++;
+			}
+
+			// split the child at the end of the common prefix
+			if (i < child->prefix.size()) {
+				node* mid = new node;
+				mid->prefix = child->prefix.substr(0, i);
+				child->prefix.erase(0, i);
+				mid->indices += child->prefix[0];
+				mid->children.push_back(child);
+				n->children[pos] = mid;
+				child = mid;
+			}
+
+			n = child;
+			s += i;
+			len -= i;
+		}
+		return n;
+	}
+
+	static bool match(const node* n, const char* path, size_t off,
+		http_route_params& params, const Handler*& handler) {
+
+		if (path[off] == 0 && n->has_handler) {
+			handler = &n->handler;
+			return true;
+		}
+
+		if (path[off] != 0) {
+			size_t pos = n->indices.find(lower(path[off]));
+			if (pos != std::string::npos) {
+				const node* child = n->children[pos];
+				const std::string& prefix = child->prefix;
+				size_t i = 0;
+				while (i < prefix.size()
+					&& lower(path[off + i]) == prefix[i]) {
+					i++;
+				}
+				if (i == prefix.size() && match(child, path,
+						off + i, params, handler)) {
+					return true;
+				}
+			}
+
+			if (n->param && path[off] != '/'
+				&& params.count < http_route_params::max) {
+
+				size_t end = off;
+				while (path[end] && path[end] != '/') {
+					end++;
+				}
+
+				size_t k = params.count++;
+				params.names[k] = n->param->name.c_str();
+				params.offs[k]  = off;
+				params.ends[k]  = end;
+				if (match(n->param, path, end, params, handler)) {
+					return true;
+				}
+				params.count--;
+			}
+		}
+
+		if (n->wildcard && params.count < http_route_params::max) {
+			size_t end = off + strlen(path + off);
+			if (end > off && path[end - 1] == '/') {
+				end--;
+			}
+
+			size_t k = params.count++;
+			params.names[k] = n->wildcard->name.c_str();
+			params.offs[k]  = off;
+			params.ends[k]  = end;
+			handler = &n->wildcard->handler;
+			return true;
+		}
+
+		return false;
+	}
+};
+
+} // namespace acl
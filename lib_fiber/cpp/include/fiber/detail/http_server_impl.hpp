@@ -30,15 +30,12 @@ protected:
 		if (type >= http_handler_get && type < http_handler_max
 				&& path && *path) {
 
-			// The path should lookup like as "/xxx/" with
-			// lower charactors.
+			// The path may have the parameters like "/users/:id",
+			// see http_router.
 
-			acl::string buf(path);
-			if (buf[buf.size() - 1] != '/') {
-				buf += '/';
+			if (!handlers_[type].add(path, std::move(fn))) {
+				logger_error("invalid route: %s", path);
 			}
-			buf.lower();
-			handlers_[type][buf] = std::move(fn);
 		}
 	}
 
@@ -50,6 +47,7 @@ protected:
 	proc_sighup_t   proc_sighup_   = nullptr;
 	thread_init_t   thread_init_   = nullptr;
 	thread_accept_t thread_accept_ = nullptr;
+	bool            fast_parser_   = false;
 	http_handlers_t handlers_[http_handler_max];
 
 	// @override
@@ -67,6 +65,9 @@ protected:
 
 		http_servlet servlet(handlers_, &conn, session);
 		servlet.setLocalCharset("utf-8");
+		if (fast_parser_) {
+			servlet.setFastParser(true);
+		}
 
 		while (servlet.doRun()) {}
 
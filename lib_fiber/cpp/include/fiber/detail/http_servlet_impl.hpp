@@ -4,6 +4,7 @@
 #include <string>
 #include <sstream>
 #include <functional>
+#include "http_router.hpp"
 
 namespace acl {
 
@@ -14,7 +15,7 @@ typedef HttpServletRequest  HttpRequest;
 typedef HttpServletResponse HttpResponse;
 
 typedef std::function<bool(HttpRequest&, HttpResponse&)> http_handler_t;
-typedef std::map<acl::string, http_handler_t> http_handlers_t;
+typedef http_router<http_handler_t> http_handlers_t;
 
 enum {
 	http_handler_get = 0,
@@ -37,7 +38,10 @@ class http_servlet_impl : public HttpServlet {
 public:
 	http_servlet_impl(http_handlers_t* handlers,
 		socket_stream* stream, session* session)
-	: HttpServlet(stream, session), handlers_(handlers) {}
+	: HttpServlet(stream, session), handlers_(handlers) {
+		// send the responses of the pipelined requests together
+		setPipelineBatch(true);
+	}
 
 	virtual ~http_servlet_impl(void) {}
 
@@ -124,22 +128,29 @@ private:
 			return res.write(buf.c_str(), buf.size()) && keep;
 		}
 
-		size_t len = strlen(path);
-		acl::string buf(path);
-		if (path[len - 1] != '/') {
-			buf += '/';
-		}
-		buf.lower();
+		// The path is copied into the buffer reused by the requests of
+		// the connection, in which the parameters are terminated.
 
-		std::map<acl::string, http_handler_t>::iterator it
-			= handlers_[type].find(buf);
+		path_ = path;
+		if (path_[path_.size() - 1] != '/') {
+			path_ += '/';
+		}
 
-		if (it != handlers_[type].end()) {
-			return it->second(req, res) && keep;
+		http_route_params params;
+		const http_handler_t* fn = handlers_[type].match(
+			path_.c_str(), params);
+
+		if (fn) {
+			params.bind(&path_[0]);
+			req.setPathParams(params.names, params.values,
+				params.count);
+			bool ret = (*fn)(req, res) && keep;
+			req.setPathParams(NULL, NULL, 0);
+			return ret;
 		}
 
 		res.setStatus(404);
-		buf = "404 ";
+		acl::string buf("404 ");
 		buf += path;
 		buf += " not found\r\n";
 		res.setContentLength(buf.size());
@@ -148,6 +159,7 @@ private:
 
 private:
 	http_handlers_t* handlers_;
+	std::string path_;
 };
 
 } // namespace acl
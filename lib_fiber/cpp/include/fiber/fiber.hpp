@@ -14,6 +14,7 @@ typedef enum {
 	FIBER_EVENT_T_SELECT,	// Linux, FreeBSD, MacOS, Windows
 	FIBER_EVENT_T_WMSG,	// Windows
 	FIBER_EVENT_T_IO_URING,	// Linux
+	FIBER_EVENT_T_EPOLL_ET,	// Linux: epoll in edge-triggered mode
 } fiber_event_t;
 
 struct FIBER_CPP_API fiber_frame {
@@ -107,6 +107,19 @@ public:
 		this->thread_accept_ = fn;
 		return *this;
 	}
+
+	/**
+	 * Read the request headers with http_request_parser, which reuses
+	 * the buffers in the keep-alive connection, instead of http_client;
+	 * then HttpRequest::getClient() returns NULL in the handlers, which
+	 * should read the body with HttpRequest::readBody() or getBody().
+	 * @param yes {bool} the default is false
+	 * @return {http_server&}
+	 */
+	http_server& use_fast_parser(bool yes) {
+		this->fast_parser_ = yes;
+		return *this;
+	}
 };
 
 } // namespace acl
@@ -252,6 +252,9 @@ void fiber::init(fiber_event_t type, bool schedule_auto /* = false */)
 	case FIBER_EVENT_T_IO_URING:
 		etype = FIBER_EVENT_IO_URING;
 		break;
+	case FIBER_EVENT_T_EPOLL_ET:
+		etype = FIBER_EVENT_EPOLL_ET;
+		break;
 	case FIBER_EVENT_T_KERNEL:
 	default:
 		etype = FIBER_EVENT_KERNEL;
@@ -284,6 +287,9 @@ void fiber::schedule_with(fiber_event_t type)
 	case FIBER_EVENT_T_IO_URING:
 		etype = FIBER_EVENT_IO_URING;
 		break;
+	case FIBER_EVENT_T_EPOLL_ET:
+		etype = FIBER_EVENT_EPOLL_ET;
+		break;
 	case FIBER_EVENT_T_KERNEL:
 	default:
 		etype = FIBER_EVENT_KERNEL;
@@ -0,0 +1,123 @@
+#include "stdafx.h"
+#include <math.h>
+#include "histogram.h"
+
+#define	SUB_COUNT	128	// the values counted exactly
+#define	HALF_COUNT	64	// the linear buckets of each power of 2
+#define	MAX_BITS	40	// about 12 days in microseconds
+
+histogram::histogram(void)
+: counts_(SUB_COUNT + (MAX_BITS - 7) * HALF_COUNT, 0)
+, count_(0)
+, sum_(0)
+, min_(0)
+, max_(0)
+{
+}
+
+size_t histogram::index_of(long long us)
+{
+	if (us < SUB_COUNT) {
+		return us < 0 ? 0 : (size_t) us;
+	}
+
+	int msb = 63 - __builtin_clzll((unsigned long long) us);
+	if (msb >= MAX_BITS) {
+		return SUB_COUNT + (MAX_BITS - 7) * HALF_COUNT - 1;
+	}
+
+	// the top 7 bits of the value, in [64, 128)
+	int shift = msb - 6;
+	size_t top = (size_t) (us >> shift);
+	return SUB_COUNT + (shift - 1) * HALF_COUNT + (top - HALF_COUNT);
+}
+
+long long histogram::highest_of(size_t idx)
+{
+	if (idx < SUB_COUNT) {
+		return (long long) idx;
+	}
+
+	int shift = (int) ((idx - SUB_COUNT) / HALF_COUNT) + 1;
+	long long top = (long long) ((idx - SUB_COUNT) % HALF_COUNT)
+		+ HALF_COUNT;
+	return ((top + 1) << shift) - 1;
+}
+
+void histogram::record(long long us)
+{
+	if (us < 0) {
+		us = 0;
+	}
+
+	counts_[index_of(us)]++;
+	if (count_ == 0 || us < min_) {
+		min_ = us;
+	}
+	if (us > max_) {
+		max_ = us;
+	}
+	count_++;
+	sum_ += us;
+}
+
+void histogram::merge(const histogram& other)
+{
+	if (other.count_ == 0) {
+		return;
+	}
+
+	for (size_t i = 0; i < counts_.size(); i++) {
+		counts_[i] += other.counts_[i];
+	}
+	if (count_ == 0 || other.min_ < min_) {
+		min_ = other.min_;
+	}
+	if (other.max_ > max_) {
+		max_ = other.max_;
+	}
+	count_ += other.count_;
+	sum_   += other.sum_;
+}
+
+void histogram::reset(void)
+{
+	for (size_t i = 0; i < counts_.size(); i++) {
+		counts_[i] = 0;
+	}
+	count_ = 0;
+	sum_   = 0;
+	min_   = 0;
+	max_   = 0;
+}
+
+long long histogram::value_at(double percentile) const
+{
+	if (count_ == 0) {
+		return 0;
+	}
+
+	long long target = (long long) ceil(percentile / 100.0 * count_);
+	if (target < 1) {
+		target = 1;
+	} else if (target > count_) {
+		target = count_;
+	}
+
+	long long n = 0;
+	for (size_t i = 0; i < counts_.size(); i++) {
+		n += counts_[i];
+		if (n >= target) {
+			long long value = highest_of(i);
+			return value < max_ ? value : max_;
+		}
+	}
+	return max_;
+}
+
+long long histogram::bucket(size_t i, long long& value) const
+{
+	long long highest = highest_of(i);
+	value = highest < max_ ? highest : max_;
+	return counts_[i];
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <vector>
+
+/**
+ * The log-linear latency histogram in the way of HdrHistogram: the values
+ * below 128 us are counted exactly, and each power of 2 above is split into
+ * 64 linear buckets, so the value reported for a bucket is within 1/64 of
+ * the values recorded in it, and the buckets take the fixed 18 KB memory.
+ */
+class histogram {
+public:
+	histogram(void);
+	~histogram(void) {}
+
+	/**
+	 * Record one latency.
+	 * @param us {long long} in microseconds
+	 */
+	void record(long long us);
+
+	/**
+	 * Add the counts of the other one, such as the one of another fiber.
+	 * @param other {const histogram&}
+	 */
+	void merge(const histogram& other);
+
+	void reset(void);
+
+	/**
+	 * The value at the percentile, which is the highest value equivalent
+	 * to the bucket, not more than the max value recorded.
+	 * @param percentile {double} such as 99.9
+	 * @return {long long} 0 if nothing recorded
+	 */
+	long long value_at(double percentile) const;
+
+	long long count(void) const {
+		return count_;
+	}
+
+	long long min(void) const {
+		return count_ > 0 ? min_ : 0;
+	}
+
+	long long max(void) const {
+		return max_;
+	}
+
+	double mean(void) const {
+		return count_ > 0 ? (double) sum_ / count_ : 0.0;
+	}
+
+	/**
+	 * The count and the highest equivalent value of the bucket.
+	 * @param i {size_t} less than buckets()
+	 * @param value {long long&}
+	 * @return {long long}
+	 */
+	long long bucket(size_t i, long long& value) const;
+
+	size_t buckets(void) const {
+		return counts_.size();
+	}
+
+private:
+	std::vector<long long> counts_;
+	long long count_;
+	long long sum_;
+	long long min_;
+	long long max_;
+
+	static size_t index_of(long long us);
+	static long long highest_of(size_t idx);
+};
@@ -0,0 +1,233 @@
+#include "stdafx.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <getopt.h>
+#include "stand_in.h"
+#include "workload.h"
+
+// Drive the HTTP, redis, TCP echo and WebSocket workloads with the fibers,
+// against the local stand-in servers in the thread, aio and fiber modes, or
+// against the server given, then print the latency percentiles of each run,
+// and write all the results with the histograms as JSON if wanted.
+
+static const char* __protos[] = { "http", "redis", "echo", "websocket", NULL };
+static const char* __modes[]  = { "thread", "aio", "fiber", NULL };
+
+static double __percentiles[] = { 50, 90, 99, 99.9 };
+
+// split the names such as "http,echo", or "all" for all the known ones
+static bool parse_names(const char* in, const char* known[],
+	std::vector<int>& out)
+{
+	out.clear();
+	if (strcasecmp(in, "all") == 0) {
+		for (int i = 0; known[i]; i++) {
+			out.push_back(i);
+		}
+		return true;
+	}
+
+	acl::string buf(in);
+	const std::vector<acl::string>& tokens = buf.split2(",; ");
+	for (size_t i = 0; i < tokens.size(); i++) {
+		int j;
+		for (j = 0; known[j]; j++) {
+			if (strcasecmp(tokens[i].c_str(), known[j]) == 0) {
+				break;
+			}
+		}
+		if (known[j] == NULL) {
+			printf("unknown name: %s\r\n", tokens[i].c_str());
+			return false;
+		}
+		out.push_back(j);
+	}
+	return !out.empty();
+}
+
+static void print_result(const char* proto, const char* mode,
+	const bench_config& cfg, const bench_result& res)
+{
+	const histogram& h = res.latency;
+	printf("%-9s %-6s conns=%d rate=%d requests=%lld errors=%lld "
+		"qps=%.1f latency(us): min=%lld mean=%.1f p50=%lld p99=%lld "
+		"p999=%lld max=%lld\r\n", proto, mode, cfg.conns, cfg.rate,
+		res.requests, res.errors, res.seconds > 0 ?
+		res.requests / res.seconds : 0.0, h.min(), h.mean(),
+		h.value_at(50), h.value_at(99), h.value_at(99.9), h.max());
+}
+
+static void json_result(const char* proto, const char* mode,
+	const bench_config& cfg, const bench_result& res, acl::string& out)
+{
+	const histogram& h = res.latency;
+
+	out.format_append("%s{\"workload\": \"%s\", \"server\": \"%s\", "
+		"\"addr\": \"%s\", \"connections\": %d, \"rate\": %d, "
+		"\"warmup\": %d, \"duration\": %d, \"bytes\": %d, "
+		"\"requests\": %lld, \"errors\": %lld, \"seconds\": %.3f, "
+		"\"qps\": %.1f, \"latency_us\": {\"min\": %lld, "
+		"\"mean\": %.1f, \"max\": %lld", out.empty() ? "[\n  " : ",\n  ",
+		proto, mode, cfg.addr.c_str(), cfg.conns, cfg.rate, cfg.warmup,
+		cfg.duration, cfg.bytes, res.requests, res.errors, res.seconds,
+		res.seconds > 0 ? res.requests / res.seconds : 0.0,
+		h.min(), h.mean(), h.max());
+
+	for (size_t i = 0; i < sizeof(__percentiles) / sizeof(double); i++) {
+		out.format_append(", \"p%g\": %lld", __percentiles[i],
+			h.value_at(__percentiles[i]));
+	}
+
+	// the buckets counted, as [highest equivalent value, count]
+	out += "}, \"histogram\": [";
+	bool first = true;
+	for (size_t i = 0; i < h.buckets(); i++) {
+		long long value, count = h.bucket(i, value);
+		if (count > 0) {
+			out.format_append("%s[%lld, %lld]", first ? "" : ", ",
+				value, count);
+			first = false;
+		}
+	}
+	out += "]}";
+}
+
+static void usage(const char* procname)
+{
+	printf("usage: %s -h [help]\r\n"
+		" -p workloads[http,redis,echo,websocket, default: all]\r\n"
+		" -m server_modes[thread,aio,fiber, default: all]\r\n"
+		" -s server_addr[the server instead of the stand-ins]\r\n"
+		" -c connections[default: 16]\r\n"
+		" -r requests_per_second[0 for closed loop, default: 10000]\r\n"
+		" -w warmup_seconds[default: 1]\r\n"
+		" -d duration_seconds[default: 5]\r\n"
+		" -b payload_bytes[default: 64]\r\n"
+		" -o json_file[\"-\" for stdout]\r\n", procname);
+}
+
+int main(int argc, char *argv[])
+{
+	int  ch;
+	acl::string protos("all"), modes("all"), addr, json_file;
+	bench_config cfg;
+
+	cfg.conns    = 16;
+	cfg.rate     = 10000;
+	cfg.warmup   = 1;
+	cfg.duration = 5;
+	cfg.bytes    = 64;
+
+	while ((ch = getopt(argc, argv, "hp:m:s:c:r:w:d:b:o:")) > 0) {
+		switch (ch) {
+		case 'h':
+			usage(argv[0]);
+			return 0;
+		case 'p':
+			protos = optarg;
+			break;
+		case 'm':
+			modes = optarg;
+			break;
+		case 's':
+			addr = optarg;
+			break;
+		case 'c':
+			cfg.conns = atoi(optarg);
+			break;
+		case 'r':
+			cfg.rate = atoi(optarg);
+			break;
+		case 'w':
+			cfg.warmup = atoi(optarg);
+			break;
+		case 'd':
+			cfg.duration = atoi(optarg);
+			break;
+		case 'b':
+			cfg.bytes = atoi(optarg);
+			break;
+		case 'o':
+			json_file = optarg;
+			break;
+		default:
+			break;
+		}
+	}
+
+	if (cfg.conns <= 0) {
+		cfg.conns = 1;
+	}
+	if (cfg.rate < 0) {
+		cfg.rate = 0;
+	}
+	if (cfg.warmup < 0) {
+		cfg.warmup = 0;
+	}
+	if (cfg.duration <= 0) {
+		cfg.duration = 1;
+	}
+	if (cfg.bytes <= 0) {
+		cfg.bytes = 1;
+	}
+
+	std::vector<int> proto_ids, mode_ids;
+	if (!parse_names(protos.c_str(), __protos, proto_ids)) {
+		usage(argv[0]);
+		return 1;
+	}
+	if (!addr.empty()) {
+		// only one run for each workload with the server given
+		mode_ids.push_back(-1);
+	} else if (!parse_names(modes.c_str(), __modes, mode_ids)) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	acl::acl_cpp_init();
+	acl::log::stdout_open(true);
+
+	acl::string json;
+	long long errors = 0;
+
+	for (size_t i = 0; i < proto_ids.size(); i++) {
+		for (size_t j = 0; j < mode_ids.size(); j++) {
+			const char* proto = __protos[proto_ids[i]];
+			const char* mode  = mode_ids[j] < 0 ?
+				"remote" : __modes[mode_ids[j]];
+			cfg.proto = proto_ids[i];
+
+			stand_in server(cfg.proto, mode);
+			if (addr.empty()) {
+				if (!server.start()) {
+					return 1;
+				}
+				cfg.addr = server.get_addr();
+			} else {
+				cfg.addr = addr;
+			}
+
+			bench_result res;
+			bench_run(cfg, res);
+			server.stop();
+
+			print_result(proto, mode, cfg, res);
+			json_result(proto, mode, cfg, res, json);
+			errors += res.errors;
+		}
+	}
+	json += "\n]\n";
+
+	if (json_file == "-") {
+		printf("%s", json.c_str());
+	} else if (!json_file.empty()) {
+		acl::ofstream out;
+		if (!out.open_trunc(json_file) || out.write(json) == -1) {
+			printf("write %s error %s\r\n", json_file.c_str(),
+				acl::last_serror());
+			return 1;
+		}
+	}
+
+	return errors > 0 ? 1 : 0;
+}
@@ -0,0 +1,520 @@
+#include "stdafx.h"
+#include "stand_in.h"
+
+static const char __hello[] = "Hello, World!";
+
+class bench_servlet : public acl::HttpServlet {
+public:
+	bench_servlet(acl::socket_stream* conn) : HttpServlet(conn) {
+		setFastParser(true).setPipelineBatch(true);
+	}
+
+	~bench_servlet(void) {}
+
+protected:
+	// @override
+	bool doGet(acl::HttpServletRequest&, acl::HttpServletResponse& res) {
+		res.setContentType("text/plain").setKeepAlive(true)
+			.setContentLength(sizeof(__hello) - 1);
+		return res.write(__hello, sizeof(__hello) - 1);
+	}
+
+	// @override
+	bool doWebSocket(acl::HttpServletRequest& req,
+		acl::HttpServletResponse&) {
+
+		acl::socket_stream& conn = req.getSocketStream();
+		acl::websocket in(conn), out(conn);
+		acl::string buf;
+
+		while (in.read_frame_head()) {
+			unsigned char opcode = in.get_frame_opcode();
+			if (opcode == acl::FRAME_CLOSE) {
+				break;
+			}
+
+			buf.clear();
+			buf.space((size_t) in.get_frame_payload_len());
+			char tmp[8192];
+			int  ret;
+			while ((ret = in.read_frame_data(tmp, sizeof(tmp))) > 0) {
+				buf.append(tmp, ret);
+			}
+			if (ret < 0) {
+				break;
+			}
+
+			out.reset().set_frame_fin(true).set_frame_opcode(opcode)
+				.set_frame_payload_len(buf.size());
+			if (!out.send_frame_data(buf.c_str(), buf.size())) {
+				break;
+			}
+		}
+		return false;
+	}
+};
+
+// the few keys set by one connection, searched one by one
+struct redis_store {
+	std::vector<acl::string> keys;
+	std::vector<acl::string> values;
+
+	acl::string* find(const acl::string& key) {
+		for (size_t i = 0; i < keys.size(); i++) {
+			if (keys[i] == key) {
+				return &values[i];
+			}
+		}
+		return NULL;
+	}
+};
+
+static void redis_reply(const std::vector<acl::string>& args,
+	redis_store& store, acl::string& out)
+{
+	if (args.size() == 1 && !strcasecmp(args[0].c_str(), "PING")) {
+		out = "+PONG\r\n";
+	} else if (args.size() == 3 && !strcasecmp(args[0].c_str(), "SET")) {
+		acl::string* value = store.find(args[1]);
+		if (value) {
+			*value = args[2];
+		} else {
+			store.keys.push_back(args[1]);
+			store.values.push_back(args[2]);
+		}
+		out = "+OK\r\n";
+	} else if (args.size() == 2 && !strcasecmp(args[0].c_str(), "GET")) {
+		const acl::string* value = store.find(args[1]);
+		if (value == NULL) {
+			out = "$-1\r\n";
+		} else {
+			out.format("$%d\r\n", (int) value->size());
+			out.append(*value).append("\r\n");
+		}
+	} else {
+		out = "-ERR unknown command\r\n";
+	}
+}
+
+static void serve_redis(acl::socket_stream& conn)
+{
+	std::vector<acl::string> args;
+	redis_store store;
+	acl::string line, out;
+
+	while (conn.gets(line) && line[0] == '*') {
+		int n = atoi(line.c_str() + 1);
+		args.resize(n > 0 ? n : 0);
+
+		for (int i = 0; i < n; i++) {
+			if (!conn.gets(line) || line[0] != '$') {
+				return;
+			}
+			int len = atoi(line.c_str() + 1);
+			if (len < 0 || !conn.read(args[i], (size_t) len + 2)) {
+				return;
+			}
+			args[i].truncate(len);
+		}
+
+		redis_reply(args, store, out);
+		if (conn.write(out) == -1) {
+			return;
+		}
+	}
+}
+
+static void serve_echo(acl::socket_stream& conn)
+{
+	char buf[8192];
+	int  ret;
+
+	while ((ret = conn.read(buf, sizeof(buf), false)) > 0) {
+		if (conn.write(buf, ret) == -1) {
+			break;
+		}
+	}
+}
+
+// serve one connection with the blocking IO, in a thread or a fiber
+static void serve(acl::socket_stream& conn, int proto)
+{
+	switch (proto) {
+	case PROTO_HTTP:
+	case PROTO_WEBSOCKET: {
+		bench_servlet servlet(&conn);
+		while (servlet.doRun()) {}
+		break;
+	}
+	case PROTO_REDIS:
+		serve_redis(conn);
+		break;
+	default:
+		serve_echo(conn);
+		break;
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+// The connection of the aio mode, the requests are read by lines except the
+// WebSocket frames, which are read by the lengths in the frame headers.
+class aio_conn : public acl::aio_callback {
+public:
+	aio_conn(acl::aio_socket_stream* conn, int proto)
+	: conn_(conn), proto_(proto), need_(0), state_(WS_HANDSHAKE)
+	, opcode_(0), masked_(false), payload_len_(0) {}
+
+	void start(void) {
+		conn_->add_read_callback(this);
+		conn_->add_close_callback(this);
+		conn_->add_timeout_callback(this);
+		conn_->keep_read(false);
+
+		if (proto_ == PROTO_ECHO) {
+			conn_->read();
+		} else {
+			conn_->gets();
+		}
+	}
+
+protected:
+	~aio_conn(void) {}
+
+	// @override
+	bool read_callback(char* data, int len) {
+		switch (proto_) {
+		case PROTO_HTTP:
+			return on_http(len);
+		case PROTO_REDIS:
+			return on_redis(data, len);
+		case PROTO_WEBSOCKET:
+			return on_websocket(data, len);
+		default:
+			conn_->write(data, len);
+			conn_->read();
+			return true;
+		}
+	}
+
+	// @override
+	void close_callback(void) {
+		delete this;
+	}
+
+	// @override
+	bool timeout_callback(void) {
+		return false;
+	}
+
+private:
+	enum {
+		WS_HANDSHAKE,
+		WS_HEAD,
+		WS_LENGTH,
+		WS_PAYLOAD,
+	};
+
+	acl::aio_socket_stream* conn_;
+	int proto_;
+	int need_;			// the lines of the redis command
+	std::vector<acl::string> args_;
+	redis_store store_;
+	acl::string buf_;
+
+	int state_;
+	acl::string ws_key_;
+	unsigned char opcode_;
+	bool masked_;
+	unsigned long long payload_len_;
+
+	bool on_http(int len) {
+		// reply when the empty line ending the header is read
+		if (len == 0) {
+			buf_.format("HTTP/1.1 200 OK\r\n"
+				"Content-Type: text/plain\r\n"
+				"Content-Length: %d\r\n"
+				"Connection: keep-alive\r\n\r\n%s",
+				(int) sizeof(__hello) - 1, __hello);
+			conn_->write(buf_.c_str(), (int) buf_.size());
+		}
+		conn_->gets();
+		return true;
+	}
+
+	bool on_redis(const char* data, int len) {
+		if (need_ == 0) {
+			if (*data != '*') {
+				return false;
+			}
+			need_ = 2 * atoi(data + 1);
+			args_.clear();
+		} else {
+			// the line of the value after the line of "$len"
+			if (need_ % 2 == 1) {
+				args_.push_back(acl::string(data, len));
+			}
+			if (--need_ == 0) {
+				redis_reply(args_, store_, buf_);
+				conn_->write(buf_.c_str(), (int) buf_.size());
+			}
+		}
+		conn_->gets();
+		return true;
+	}
+
+	bool on_websocket(char* data, int len) {
+		const unsigned char* ptr = (const unsigned char*) data;
+
+		switch (state_) {
+		case WS_HANDSHAKE:
+			return on_handshake(data, len);
+		case WS_HEAD:
+			opcode_  = ptr[0] & 0x0f;
+			masked_  = (ptr[1] & 0x80) != 0;
+			payload_len_ = ptr[1] & 0x7f;
+			if (payload_len_ == 126 || payload_len_ == 127) {
+				state_ = WS_LENGTH;
+				conn_->read(payload_len_ == 126 ? 2 : 8);
+				return true;
+			}
+			break;
+		case WS_LENGTH:
+			payload_len_ = 0;
+			for (int i = 0; i < len; i++) {
+				payload_len_ = (payload_len_ << 8) | ptr[i];
+			}
+			break;
+		default:
+			return on_payload(data, len);
+		}
+
+		int n = (int) payload_len_ + (masked_ ? 4 : 0);
+		if (n == 0) {
+			return on_payload(data, 0);
+		}
+		state_ = WS_PAYLOAD;
+		conn_->read(n);
+		return true;
+	}
+
+	bool on_handshake(const char* data, int len) {
+		static const char key[] = "Sec-WebSocket-Key:";
+
+		if (len > 0) {
+			if (strncasecmp(data, key, sizeof(key) - 1) == 0) {
+				ws_key_ = data + sizeof(key) - 1;
+				ws_key_.trim_space();
+			}
+			conn_->gets();
+			return true;
+		}
+
+		acl::http_header header(101);
+		header.set_upgrade("websocket").set_ws_accept(ws_key_);
+		header.build_response(buf_);
+		conn_->write(buf_.c_str(), (int) buf_.size());
+
+		state_ = WS_HEAD;
+		conn_->read(2);
+		return true;
+	}
+
+	bool on_payload(char* data, int len) {
+		if (opcode_ == acl::FRAME_CLOSE) {
+			return false;
+		}
+
+		char* payload = data;
+		if (masked_) {
+			const char* mask = data;
+			payload += 4;
+			len -= 4;
+			for (int i = 0; i < len; i++) {
+				payload[i] ^= mask[i % 4];
+			}
+		}
+
+		unsigned char head[10];
+		int n = 0;
+		head[n++] = 0x80 | opcode_;
+		if (len < 126) {
+			head[n++] = (unsigned char) len;
+		} else if (len <= 0xffff) {
+			head[n++] = 126;
+			head[n++] = (unsigned char) (len >> 8);
+			head[n++] = (unsigned char) len;
+		} else {
+			head[n++] = 127;
+			for (int i = 7; i >= 0; i--) {
+				head[n++] = (unsigned char) ((unsigned long long)
+					len >> (i * 8));
+			}
+		}
+
+		struct iovec iov[2];
+		iov[0].iov_base = head;
+		iov[0].iov_len  = n;
+		iov[1].iov_base = payload;
+		iov[1].iov_len  = len;
+		conn_->writev(iov, len > 0 ? 2 : 1);
+
+		state_ = WS_HEAD;
+		conn_->read(2);
+		return true;
+	}
+};
+
+class aio_acceptor : public acl::aio_accept_callback {
+public:
+	aio_acceptor(int proto) : proto_(proto) {}
+	~aio_acceptor(void) {}
+
+	// @override
+	bool accept_callback(acl::aio_socket_stream* client) {
+		aio_conn* conn = new aio_conn(client, proto_);
+		conn->start();
+		return true;
+	}
+
+private:
+	int proto_;
+};
+
+//////////////////////////////////////////////////////////////////////////////
+
+stand_in::stand_in(int proto, const char* mode)
+: proto_(proto)
+, mode_(mode)
+, stopping_(false)
+, thread_(NULL)
+, handle_(NULL)
+, listener_(NULL)
+{
+}
+
+stand_in::~stand_in(void)
+{
+	stop();
+}
+
+bool stand_in::start(void)
+{
+	if (mode_ == "aio") {
+		handle_   = new acl::aio_handle(acl::ENGINE_KERNEL);
+		listener_ = new acl::aio_listen_stream(handle_);
+		if (!listener_->open("127.0.0.1:0")) {
+			printf("listen error %s\r\n", acl::last_serror());
+			return false;
+		}
+		addr_ = listener_->get_addr();
+		thread_ = new std::thread(&stand_in::run_aio, this);
+		return true;
+	}
+
+	if (mode_ != "thread" && mode_ != "fiber") {
+		printf("unknown server mode: %s\r\n", mode_.c_str());
+		return false;
+	}
+
+	if (!ss_.open("127.0.0.1:0")) {
+		printf("listen error %s\r\n", acl::last_serror());
+		return false;
+	}
+	addr_ = ss_.get_addr();
+
+	if (mode_ == "thread") {
+		thread_ = new std::thread(&stand_in::run_threads, this);
+	} else {
+		thread_ = new std::thread(&stand_in::run_fiber, this);
+	}
+	return true;
+}
+
+void stand_in::stop(void)
+{
+	if (thread_ == NULL) {
+		return;
+	}
+
+	stopping_ = true;
+	wakeup();
+	thread_->join();
+	delete thread_;
+	thread_ = NULL;
+
+	for (std::vector<std::thread*>::iterator it = conns_.begin();
+		it != conns_.end(); ++it) {
+		(*it)->join();
+		delete *it;
+	}
+	conns_.clear();
+}
+
+// connect to the listener to return from accept
+void stand_in::wakeup(void)
+{
+	acl::socket_stream conn;
+	(void) conn.open(addr_, 1, 1);
+}
+
+void stand_in::run_threads(void)
+{
+	while (true) {
+		acl::socket_stream* conn = ss_.accept();
+		if (conn == NULL || stopping_) {
+			delete conn;
+			break;
+		}
+
+		int proto = proto_;
+		conns_.push_back(new std::thread([conn, proto] {
+			serve(*conn, proto);
+			delete conn;
+		}));
+	}
+}
+
+void stand_in::run_aio(void)
+{
+	aio_acceptor acceptor(proto_);
+	listener_->add_accept_callback(&acceptor);
+
+	while (!stopping_) {
+		handle_->check();
+	}
+
+	// the listener is freed by the handle after being closed
+	listener_->close();
+	handle_->check();
+	listener_ = NULL;
+
+	// the connections are closed by the clients before stopping
+	while (handle_->length() > 0) {
+		handle_->check();
+	}
+	delete handle_;
+	handle_ = NULL;
+}
+
+void stand_in::run_fiber(void)
+{
+	go[this] {
+		while (true) {
+			acl::socket_stream* conn = ss_.accept();
+			if (conn == NULL || stopping_) {
+				delete conn;
+				break;
+			}
+
+			int proto = proto_;
+			go[conn, proto] {
+				serve(*conn, proto);
+				delete conn;
+			};
+		}
+	};
+
+	// return after all the connections are closed
+	acl::fiber::schedule();
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+// the workloads served by the stand-ins and driven by the clients
+enum {
+	PROTO_HTTP,
+	PROTO_REDIS,
+	PROTO_ECHO,
+	PROTO_WEBSOCKET,
+};
+
+/**
+ * The local stand-in server of one workload, run in its own threads in one
+ * of the server modes: "thread" with one thread per connection, "aio" with
+ * the non-blocking callbacks of aio_handle in one thread, and "fiber" with
+ * one fiber per connection in one thread. The HTTP and WebSocket requests
+ * are served by HttpServlet in the thread and fiber modes, the same as the
+ * fiber http_server with use_fast_parser(true) does; the redis stand-in answers PING, SET and GET with
+ * the keys kept by each connection.
+ */
+class stand_in {
+public:
+	stand_in(int proto, const char* mode);
+	~stand_in(void);
+
+	/**
+	 * Listen on a random local port and start serving.
+	 * @return {bool} false if the mode is unknown or listening failed
+	 */
+	bool start(void);
+
+	/**
+	 * Stop accepting and wait for the connections closed by the clients.
+	 */
+	void stop(void);
+
+	const char* get_addr(void) const {
+		return addr_.c_str();
+	}
+
+private:
+	int proto_;
+	acl::string mode_;
+	acl::string addr_;
+	std::atomic<bool> stopping_;
+	std::thread* thread_;
+	acl::server_socket ss_;
+	acl::aio_handle* handle_;
+	acl::aio_listen_stream* listener_;
+	std::vector<std::thread*> conns_;
+
+	void run_threads(void);
+	void run_aio(void);
+	void run_fiber(void);
+	void wakeup(void);
+};
@@ -0,0 +1,271 @@
+#include "stdafx.h"
+#include <time.h>
+#include <memory>
+#include "stand_in.h"
+#include "workload.h"
+
+static long long now_us(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
+
+// the client of one connection, request() sends one request and reads
+// the reply, which is checked
+class bench_client {
+public:
+	bench_client(int bytes) : payload_(bytes) {
+		for (int i = 0; i < bytes; i++) {
+			payload_ += (char) ('a' + i % 26);
+		}
+	}
+
+	virtual ~bench_client(void) {}
+
+	virtual bool open(const char* addr) {
+		return conn_.open(addr, 10, 10);
+	}
+
+	virtual bool request(void) = 0;
+
+	static bench_client* create(int proto, int bytes);
+
+protected:
+	acl::socket_stream conn_;
+	acl::string payload_;
+	acl::string buf_;
+};
+
+class http_bench : public bench_client {
+public:
+	http_bench(int bytes) : bench_client(bytes), client_(&conn_, true) {}
+	~http_bench(void) {}
+
+	// @override
+	bool request(void) {
+		static const char req[] = "GET /plaintext HTTP/1.1\r\n"
+			"Host: 127.0.0.1\r\n"
+			"Connection: keep-alive\r\n\r\n";
+
+		if (conn_.write(req, sizeof(req) - 1) == -1) {
+			return false;
+		}
+		if (!client_.read_head() || client_.read_body(buf_) < 0) {
+			return false;
+		}
+		return client_.response_status() == 200 && !buf_.empty();
+	}
+
+private:
+	acl::http_client client_;
+};
+
+class redis_bench : public bench_client {
+public:
+	redis_bench(int bytes) : bench_client(bytes), client_(NULL)
+	, count_(0) {}
+
+	~redis_bench(void) {
+		delete client_;
+	}
+
+	// @override
+	bool open(const char* addr) {
+		client_ = new acl::redis_client(addr, 10, 10);
+		cmd_.set_client(client_);
+		return cmd_.ping();
+	}
+
+	// SET and GET in turn
+	// @override
+	bool request(void) {
+		cmd_.clear();
+		if (count_++ % 2 == 0) {
+			return cmd_.set("bench:key", payload_.c_str());
+		}
+		buf_.clear();
+		return cmd_.get("bench:key", buf_) && buf_ == payload_;
+	}
+
+private:
+	acl::redis_client* client_;
+	acl::redis cmd_;
+	long long count_;
+};
+
+class echo_bench : public bench_client {
+public:
+	echo_bench(int bytes) : bench_client(bytes) {}
+	~echo_bench(void) {}
+
+	// @override
+	bool request(void) {
+		if (conn_.write(payload_) == -1) {
+			return false;
+		}
+		return conn_.read(buf_, payload_.size()) && buf_ == payload_;
+	}
+};
+
+class websocket_bench : public bench_client {
+public:
+	websocket_bench(int bytes) : bench_client(bytes)
+	, in_(conn_), out_(conn_) {}
+	~websocket_bench(void) {}
+
+	// @override
+	bool open(const char* addr) {
+		if (!bench_client::open(addr)) {
+			return false;
+		}
+
+		acl::http_request req(&conn_);
+		req.request_header().set_ws_key("123456789")
+			.set_ws_version(13)
+			.set_upgrade("websocket")
+			.set_keep_alive(true);
+		return req.request(NULL, 0) && req.http_status() == 101;
+	}
+
+	// @override
+	bool request(void) {
+		out_.reset().set_frame_fin(true)
+			.set_frame_opcode(acl::FRAME_BINARY)
+			.set_frame_masking_key(0x12345678)
+			.set_frame_payload_len(payload_.size());
+		// the const one copies the data before masking it
+		if (!out_.send_frame_data((const void*) payload_.c_str(),
+			payload_.size())) {
+			return false;
+		}
+
+		in_.reset();
+		if (!in_.read_frame_head()) {
+			return false;
+		}
+
+		buf_.clear();
+		char tmp[8192];
+		int  ret;
+		while ((ret = in_.read_frame_data(tmp, sizeof(tmp))) > 0) {
+			buf_.append(tmp, ret);
+		}
+		return ret == 0 && buf_ == payload_;
+	}
+
+private:
+	acl::websocket in_;
+	acl::websocket out_;
+};
+
+bench_client* bench_client::create(int proto, int bytes)
+{
+	switch (proto) {
+	case PROTO_HTTP:
+		return new http_bench(bytes);
+	case PROTO_REDIS:
+		return new redis_bench(bytes);
+	case PROTO_WEBSOCKET:
+		return new websocket_bench(bytes);
+	default:
+		return new echo_bench(bytes);
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+// the state shared by the fibers of one run in the same thread
+struct bench_state {
+	const bench_config* cfg;
+	bench_result* res;
+	long long begin;	// when the first fiber begins recording
+	long long end;		// when the last reply is read
+};
+
+static void client_fiber(bench_state& state, int idx)
+{
+	const bench_config& cfg = *state.cfg;
+	bench_result& res = *state.res;
+
+	std::unique_ptr<bench_client> client(
+		bench_client::create(cfg.proto, cfg.bytes));
+	if (!client->open(cfg.addr)) {
+		printf("open %s error %s\r\n", cfg.addr.c_str(),
+			acl::last_serror());
+		res.errors++;
+		return;
+	}
+
+	// the fibers are staggered over one interval of the schedule
+	long long interval = cfg.rate > 0 ?
+		1000000LL * cfg.conns / cfg.rate : 0;
+	long long start  = now_us() + interval * idx / cfg.conns;
+	long long record = start + cfg.warmup * 1000000LL;
+	long long stop   = record + cfg.duration * 1000000LL;
+
+	if (state.begin == 0 || record < state.begin) {
+		state.begin = record;
+	}
+
+	long long intended = start;
+	while (true) {
+		long long now = now_us();
+		if (interval == 0) {
+			intended = now;
+		} else if (intended - now >= 2000) {
+			// the delay is in milliseconds and may be longer, so wake
+			// one millisecond earlier and send a little early, which
+			// is measured from the time sent
+			acl::fiber::delay((size_t) (intended - now) / 1000 - 1);
+			now = now_us();
+		}
+
+		if (intended >= stop) {
+			break;
+		}
+
+		// if the request is late for the schedule, the latency is
+		// from the time it should be sent, not when it is sent
+		long long sent = now < intended ? now : intended;
+		bool ok = client->request();
+		long long done = now_us();
+
+		if (!ok) {
+			res.errors++;
+			break;
+		}
+
+		if (intended >= record) {
+			res.latency.record(done - sent);
+			res.requests++;
+			if (done > state.end) {
+				state.end = done;
+			}
+		}
+		intended += interval;
+	}
+}
+
+void bench_run(const bench_config& cfg, bench_result& res)
+{
+	bench_state state;
+	state.cfg   = &cfg;
+	state.res   = &res;
+	state.begin = 0;
+	state.end   = 0;
+
+	std::thread thread([&] {
+		for (int i = 0; i < cfg.conns; i++) {
+			go[&state, i] {
+				client_fiber(state, i);
+			};
+		}
+		acl::fiber::schedule();
+	});
+	thread.join();
+
+	if (state.end > state.begin) {
+		res.seconds = (state.end - state.begin) / 1000000.0;
+	}
+}
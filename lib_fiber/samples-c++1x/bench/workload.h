@@ -0,0 +1,34 @@
+#pragma once
+
+#include "histogram.h"
+
+struct bench_config {
+	int  proto;		// PROTO_XXX in stand_in.h
+	acl::string addr;
+	int  conns;		// the fibers each with one connection
+	int  rate;		// the requests per second of all, 0 for closed loop
+	int  warmup;		// the seconds not recorded
+	int  duration;		// the seconds recorded
+	int  bytes;		// the payload of the requests
+};
+
+struct bench_result {
+	long long requests;
+	long long errors;
+	double    seconds;	// the recorded time of all the fibers
+	histogram latency;	// in microseconds
+
+	bench_result(void) : requests(0), errors(0), seconds(0) {}
+};
+
+/**
+ * Drive the workload with the fibers in a new thread. With the rate set,
+ * each fiber sends its requests at the fixed intervals of the open-loop
+ * schedule, and the latency of one request is measured from the time it
+ * should have been sent, so the time waiting for the previous slow replies
+ * is counted, which is left out by the closed-loop clients; that is the
+ * coordinated omission.
+ * @param cfg {const bench_config&}
+ * @param res {bench_result&}
+ */
+void bench_run(const bench_config& cfg, bench_result& res);
@@ -0,0 +1,191 @@
+#include "stdafx.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <getopt.h>
+#include <sys/time.h>
+#include <map>
+#include <string>
+#include <vector>
+#include "../stamp.h"
+
+// Add the static and the parameterized routes into http_router, then match
+// the paths of them for many times and check the results, comparing with
+// the std::map lookup of the lower case path used before, which supports
+// the static routes only.
+
+struct route {
+	std::string pattern;
+	std::string path;
+	std::string value;	// the value of the last parameter
+};
+
+static void build_routes(int count, std::vector<route>& routes)
+{
+	char buf[256];
+	for (int i = 0; i < count; i++) {
+		route r;
+		switch (i % 4) {
+		case 0:
+			snprintf(buf, sizeof(buf), "/api/v%d/Users%d/list", i % 7, i);
+			r.pattern = buf;
+			r.path    = buf;
+			break;
+		case 1:
+			snprintf(buf, sizeof(buf), "/api/v%d/users%d/:id", i % 7, i);
+			r.pattern = buf;
+			snprintf(buf, sizeof(buf), "/api/v%d/users%d/%d", i % 7, i, i);
+			r.path    = buf;
+			r.value   = strrchr(buf, '/') + 1;
+			break;
+		case 2:
+			snprintf(buf, sizeof(buf), "/api/v%d/orders%d/:oid/items/:item",
+				i % 7, i);
+			r.pattern = buf;
+			snprintf(buf, sizeof(buf), "/api/v%d/orders%d/o%d/items/item-%d",
+				i % 7, i, i, i);
+			r.path    = buf;
+			r.value   = strrchr(buf, '/') + 1;
+			break;
+		default:
+			snprintf(buf, sizeof(buf), "/static%d/*file", i);
+			r.pattern = buf;
+			snprintf(buf, sizeof(buf), "/static%d/css/site-%d.css", i, i);
+			r.path    = buf;
+			r.value   = strchr(buf + 1, '/') + 1;
+			break;
+		}
+		routes.push_back(r);
+	}
+}
+
+static void usage(const char* procname)
+{
+	printf("usage: %s -h [help]\r\n"
+		" -r routes[default: 10000]\r\n"
+		" -n lookups[default: 1000000]\r\n", procname);
+}
+
+int main(int argc, char *argv[])
+{
+	int  ch, nroutes = 10000, count = 1000000;
+
+	while ((ch = getopt(argc, argv, "hr:n:")) > 0) {
+		switch (ch) {
+		case 'h':
+			usage(argv[0]);
+			return 0;
+		case 'r':
+			nroutes = atoi(optarg);
+			break;
+		case 'n':
+			count = atoi(optarg);
+			break;
+		default:
+			break;
+		}
+	}
+
+	if (nroutes <= 0) {
+		nroutes = 1;
+	}
+
+	std::vector<route> routes;
+	build_routes(nroutes, routes);
+
+	acl::http_router<int> router;
+	std::map<acl::string, int> handlers;
+
+	struct timeval begin, end;
+	gettimeofday(&begin, NULL);
+
+	for (int i = 0; i < nroutes; i++) {
+		if (!router.add(routes[i].pattern.c_str(), i)) {
+			printf("add %s error\r\n", routes[i].pattern.c_str());
+			return 1;
+		}
+	}
+
+	gettimeofday(&end, NULL);
+	printf("add %d routes, spent %.2f ms\r\n", (int) router.size(),
+		stamp_sub(&end, &begin));
+
+	// the paths with the trailing '/' as the servlet does
+	std::vector<std::string> paths;
+	for (int i = 0; i < nroutes; i++) {
+		paths.push_back(routes[i].path + "/");
+
+		acl::string key(routes[i].path.c_str());
+		key += '/';
+		key.lower();
+		handlers[key] = i;
+	}
+
+	// check all the routes first
+	std::string buf;
+	for (int i = 0; i < nroutes; i++) {
+		acl::http_route_params params;
+		buf = paths[i];
+		const int* n = router.match(buf.c_str(), params);
+		if (n == NULL || *n != i) {
+			printf("match %s error, got %d\r\n", paths[i].c_str(),
+				n ? *n : -1);
+			return 1;
+		}
+
+		params.bind(&buf[0]);
+		const char* value = params.count > 0
+			? params.values[params.count - 1] : NULL;
+		if (routes[i].value != (value ? value : "")) {
+			printf("params of %s error, got %s\r\n",
+				paths[i].c_str(), value ? value : "NULL");
+			return 1;
+		}
+	}
+
+	acl::http_route_params params;
+	if (router.match("/not/found/", params) != NULL) {
+		printf("match /not/found/ error\r\n");
+		return 1;
+	}
+	printf("check %d routes ok\r\n", nroutes);
+
+	long long found = 0;
+	gettimeofday(&begin, NULL);
+
+	for (int i = 0; i < count; i++) {
+		const std::string& path = paths[i % nroutes];
+		if (router.match(path.c_str(), params)) {
+			found++;
+		}
+	}
+
+	gettimeofday(&end, NULL);
+	double spent = stamp_sub(&end, &begin);
+	printf("router: lookups=%d, found=%lld, spent=%.2f ms, %.2f ns/op\r\n",
+		count, found, spent, spent * 1000000 / (count > 0 ? count : 1));
+
+	// the static routes only, looked up by the map as before
+	found = 0;
+	int nstatic = 0;
+	gettimeofday(&begin, NULL);
+
+	for (int i = 0; i < count; i++) {
+		int k = (i % nroutes) & ~3;
+		if (k >= nroutes) {
+			continue;
+		}
+		nstatic++;
+		acl::string key(paths[k].c_str());
+		key.lower();
+		if (handlers.find(key) != handlers.end()) {
+			found++;
+		}
+	}
+
+	gettimeofday(&end, NULL);
+	spent = stamp_sub(&end, &begin);
+	printf("map(static only): lookups=%d, found=%lld, spent=%.2f ms, "
+		"%.2f ns/op\r\n", nstatic, found, spent,
+		spent * 1000000 / (nstatic > 0 ? nstatic : 1));
+	return 0;
+}
@@ -0,0 +1,12 @@
+// stdafx.h : the header of the standard system include files
+//
+
+#pragma once
+
+#include "lib_acl.h"
+#include "acl_cpp/lib_acl.hpp"
+#include "fiber/detail/http_router.hpp"
+
+#ifdef	WIN32
+#define	snprintf _snprintf
+#endif
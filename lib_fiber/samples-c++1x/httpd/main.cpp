@@ -97,6 +97,11 @@ int main(int argc, char *argv[]) {
 					.add_bool("success", true)
 					.add_number("number", i));
 		return res.write(json);
+	}).Get("/users/:name", [](acl::HttpRequest& req, acl::HttpResponse& res) {
+		acl::string buf;
+		buf.format("hello %s!\r\n", req.getPathParam("name"));
+		res.setContentLength(buf.size());
+		return res.write(buf.c_str(), buf.size());
 	}).Get("/test", http_test);
 
 	// start the server in alone or daemon mode
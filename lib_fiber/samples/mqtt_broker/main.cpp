@@ -0,0 +1,151 @@
+#include "stdafx.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+// The broker isn't thread safe, all the connections are handled by the
+// fibers of one thread, so fiber_threads in configure must be 1.
+static acl::mqtt_broker* __broker = NULL;
+
+class fiber_session : public acl::mqtt_session {
+public:
+	fiber_session(acl::mqtt_broker& broker, acl::socket_stream& conn)
+	: mqtt_session(broker)
+	, conn_(conn)
+	, wakeup_(0, acl::fiber_sem_t_sync)
+	, done_(0, acl::fiber_sem_t_sync)
+	, stopping_(false) {}
+
+	~fiber_session(void) {}
+
+	// called by the writer fiber, return false if it should exit.
+	bool wait(void) {
+		wakeup_.wait();
+		return !stopping_;
+	}
+
+	// called by the reader fiber, wait for the writer fiber to exit.
+	void stop(void) {
+		stopping_ = true;
+		wakeup_.post();
+		done_.wait();
+	}
+
+	void writer_done(void) {
+		done_.post();
+	}
+
+	acl::socket_stream& get_conn(void) const {
+		return conn_;
+	}
+
+protected:
+	// @override
+	bool write_iov(const struct iovec* iov, int count) {
+		return conn_.writev(iov, count) != -1;
+	}
+
+	// @override
+	void on_pending(void) {
+		// the messages queued before the writer fiber running will
+		// be written in one writev
+		wakeup_.post();
+	}
+
+private:
+	acl::socket_stream& conn_;
+	acl::fiber_sem wakeup_;
+	acl::fiber_sem done_;
+	bool stopping_;
+};
+
+// the messages to one client are written in its own fiber, so the fiber
+// publishing won't be suspended by the slow subscribers.
+class writer_fiber : public acl::fiber {
+public:
+	writer_fiber(fiber_session& sess) : sess_(sess) {}
+
+protected:
+	// @override
+	void run(void) {
+		bool ok = true;
+
+		// run until the reader fiber calling stop()
+		while (sess_.wait()) {
+			if (ok && !sess_.flush()) {
+				// wakeup the reader fiber
+				sess_.get_conn().shutdown_readwrite();
+				ok = false;
+			}
+		}
+
+		sess_.writer_done();
+		delete this;
+	}
+
+private:
+	fiber_session& sess_;
+
+	~writer_fiber(void) {}
+};
+
+//////////////////////////////////////////////////////////////////////////////
+
+class master_mqtt : public acl::master_fiber {
+public:
+	master_mqtt(void) {}
+	~master_mqtt(void) {}
+
+protected:
+	// @override
+	void on_accept(acl::socket_stream& conn) {
+		fiber_session sess(*__broker, conn);
+		writer_fiber* writer = new writer_fiber(sess);
+		writer->start();
+
+		acl::mqtt_client client(conn);
+		while (true) {
+			acl::mqtt_message* msg = client.get_message();
+			if (msg == NULL) {
+				break;
+			}
+
+			bool ret = sess.handle(*msg);
+			delete msg;
+			if (!ret) {
+				break;
+			}
+		}
+
+		sess.stop();
+	}
+
+	// @override
+	void proc_on_init(void) {
+		__broker = new acl::mqtt_broker;
+	}
+
+	// @override
+	void proc_on_exit(void) {
+		delete __broker;
+	}
+};
+
+int main(int argc, char *argv[])
+{
+	master_mqtt& mm = acl::singleton2<master_mqtt>::get_instance();
+
+	acl::acl_cpp_init();
+
+	if (argc >= 2 && strcasecmp(argv[1], "alone") == 0) {
+		const char* addr = argc >= 3 ? argv[2] : "0.0.0.0|1883";
+
+		printf("listen: %s\r\n", addr);
+		acl::log::stdout_open(true);
+
+		mm.run_alone(addr, argc >= 4 ? argv[3] : NULL);
+	} else {
+		mm.run_daemon(argc, argv);
+	}
+
+	return 0;
+}
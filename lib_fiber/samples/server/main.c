@@ -9,6 +9,7 @@ static int __stack_size = 320000;
 static int __rw_timeout = 0;
 static int __echo_data  = 0;
 static int __setsockopt_timeout = 0;
+static int __delay_ms   = 0;
 
 static void echo_client(ACL_FIBER *fiber acl_unused, void *ctx)
 {
@@ -52,6 +53,12 @@ static void echo_client(ACL_FIBER *fiber acl_unused, void *ctx)
 			continue;
 		}
 
+		// wait before replying like waiting for the backend, during
+		// which the fd isn't monitored for reading
+		if (__delay_ms > 0) {
+			acl_fiber_delay(__delay_ms);
+		}
+
 		if (acl_vstream_writen(cstream, buf, ret) == ACL_VSTREAM_EOF) {
 			printf("write error, fd: %d\r\n", SOCK(cstream));
 			break;
@@ -130,6 +137,8 @@ static void usage(const char *procname)
 		"  -q listen_queue\r\n"
 		"  -z stack_size\r\n"
 		"  -T [if using setsockopt to set the timeout option]\r\n"
+		"  -e event_type[kernel|select|poll|epoll_et, default: kernel]\r\n"
+		"  -d delay_ms[the delay before echo, default: 0]\r\n"
 		"  -w [if echo data, default: no]\r\n", procname);
 }
 
@@ -138,13 +147,14 @@ int main(int argc, char *argv[])
 	char addr[64];
 	ACL_VSTREAM *sstream;
 	int   ch, enable_sleep = 0, qlen = 128;
+	int   event_type = FIBER_EVENT_KERNEL;
 
 	acl_msg_stdout_enable(1);
 	acl_fiber_msg_stdout_enable(1);
 
 	snprintf(addr, sizeof(addr), "%s", "127.0.0.1:9002");
 
-	while ((ch = getopt(argc, argv, "hs:r:Sq:wz:T")) > 0) {
+	while ((ch = getopt(argc, argv, "hs:r:Sq:wz:Te:d:")) > 0) {
 		switch (ch) {
 		case 'h':
 			usage(argv[0]);
@@ -170,6 +180,18 @@ int main(int argc, char *argv[])
 		case 'T':
 			__setsockopt_timeout = 1;
 			break;
+		case 'd':
+			__delay_ms = atoi(optarg);
+			break;
+		case 'e':
+			if (strcmp(optarg, "select") == 0) {
+				event_type = FIBER_EVENT_SELECT;
+			} else if (strcmp(optarg, "poll") == 0) {
+				event_type = FIBER_EVENT_POLL;
+			} else if (strcmp(optarg, "epoll_et") == 0) {
+				event_type = FIBER_EVENT_EPOLL_ET;
+			}
+			break;
 		default:
 			break;
 		}
@@ -192,7 +214,7 @@ int main(int argc, char *argv[])
 	}
 
 	printf("call fiber_schedule\r\n");
-	acl_fiber_schedule();
+	acl_fiber_schedule_with(event_type);
 
 	return 0;
 }
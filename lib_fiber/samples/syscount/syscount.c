@@ -0,0 +1,202 @@
+/* Count the IO and epoll system calls of one process, which can be used to
+ * compare the costs of the different fiber event types, such as:
+ *   LD_PRELOAD=./libsyscount.so ../server/server -w -e kernel
+ *   LD_PRELOAD=./libsyscount.so ../server/server -w -e epoll_et
+ * and running ../client/client -w as the load generator in another shell;
+ * the counters will be shown when the process exits or receives SIGINT.
+ * Add -d 1 to the server to delay each reply, during which the fd is not
+ * waited for reading, so the kernel mode removes and adds the read event
+ * of each request with epoll_ctl, but the epoll_et mode doesn't.
+ */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <dlfcn.h>
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/epoll.h>
+
+enum {
+	SC_READ,
+	SC_READ_EAGAIN,
+	SC_WRITE,
+	SC_WRITE_EAGAIN,
+	SC_ACCEPT,
+	SC_EPOLL_CTL,
+	SC_EPOLL_WAIT,
+	SC_MAX,
+};
+
+static const char *__names[SC_MAX] = {
+	"read",
+	"read(EAGAIN)",
+	"write",
+	"write(EAGAIN)",
+	"accept",
+	"epoll_ctl",
+	"epoll_wait",
+};
+
+static volatile long long __counters[SC_MAX];
+
+#define	COUNT(x)	__sync_fetch_and_add(&__counters[(x)], 1)
+
+#define	RESOLVE(fn, name) do {                                              \
+	if ((fn) == NULL) {                                                 \
+		(fn) = dlsym(RTLD_NEXT, (name));                            \
+		if ((fn) == NULL) {                                         \
+			abort();                                            \
+		}                                                           \
+	}                                                                   \
+} while (0)
+
+static void count_io(ssize_t ret, int ok, int again)
+{
+	if (ret >= 0) {
+		COUNT(ok);
+	} else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+		COUNT(again);
+	} else {
+		COUNT(ok);
+	}
+}
+
+static void report(void)
+{
+	char buf[1024];
+	long long total = 0;
+	int i, n = 0;
+
+	for (i = 0; i < SC_MAX; i++) {
+		n += snprintf(buf + n, sizeof(buf) - n, "%-14s %lld\r\n",
+			__names[i], __counters[i]);
+		total += __counters[i];
+	}
+	n += snprintf(buf + n, sizeof(buf) - n, "%-14s %lld\r\n",
+		"total", total);
+
+	/* may be called in signal handler, so use write directly */
+	if (write(2, buf, (size_t) n) < 0) {
+		/* nothing to do */
+	}
+}
+
+static void on_signal(int sig)
+{
+	(void) sig;
+	report();
+	_exit(0);
+}
+
+__attribute__((constructor)) static void syscount_init(void)
+{
+	signal(SIGINT, on_signal);
+	signal(SIGTERM, on_signal);
+	atexit(report);
+}
+
+ssize_t read(int fd, void *buf, size_t count)
+{
+	static ssize_t (*fn)(int, void *, size_t) = NULL;
+	ssize_t ret;
+
+	RESOLVE(fn, "read");
+	ret = fn(fd, buf, count);
+	count_io(ret, SC_READ, SC_READ_EAGAIN);
+	return ret;
+}
+
+ssize_t readv(int fd, const struct iovec *iov, int iovcnt)
+{
+	static ssize_t (*fn)(int, const struct iovec *, int) = NULL;
+	ssize_t ret;
+
+	RESOLVE(fn, "readv");
+	ret = fn(fd, iov, iovcnt);
+	count_io(ret, SC_READ, SC_READ_EAGAIN);
+	return ret;
+}
+
+ssize_t recv(int fd, void *buf, size_t len, int flags)
+{
+	static ssize_t (*fn)(int, void *, size_t, int) = NULL;
+	ssize_t ret;
+
+	RESOLVE(fn, "recv");
+	ret = fn(fd, buf, len, flags);
+	count_io(ret, SC_READ, SC_READ_EAGAIN);
+	return ret;
+}
+
+ssize_t write(int fd, const void *buf, size_t count)
+{
+	static ssize_t (*fn)(int, const void *, size_t) = NULL;
+	ssize_t ret;
+
+	RESOLVE(fn, "write");
+	ret = fn(fd, buf, count);
+	/* don't count the writing of the report and the logs */
+	if (fd > 2) {
+		count_io(ret, SC_WRITE, SC_WRITE_EAGAIN);
+	}
+	return ret;
+}
+
+ssize_t writev(int fd, const struct iovec *iov, int iovcnt)
+{
+	static ssize_t (*fn)(int, const struct iovec *, int) = NULL;
+	ssize_t ret;
+
+	RESOLVE(fn, "writev");
+	ret = fn(fd, iov, iovcnt);
+	if (fd > 2) {
+		count_io(ret, SC_WRITE, SC_WRITE_EAGAIN);
+	}
+	return ret;
+}
+
+ssize_t send(int fd, const void *buf, size_t len, int flags)
+{
+	static ssize_t (*fn)(int, const void *, size_t, int) = NULL;
+	ssize_t ret;
+
+	RESOLVE(fn, "send");
+	ret = fn(fd, buf, len, flags);
+	count_io(ret, SC_WRITE, SC_WRITE_EAGAIN);
+	return ret;
+}
+
+int accept(int fd, struct sockaddr *addr, socklen_t *len)
+{
+	static int (*fn)(int, struct sockaddr *, socklen_t *) = NULL;
+
+	RESOLVE(fn, "accept");
+	COUNT(SC_ACCEPT);
+	return fn(fd, addr, len);
+}
+
+int epoll_ctl(int epfd, int op, int fd, struct epoll_event *event)
+{
+	static int (*fn)(int, int, int, struct epoll_event *) = NULL;
+
+	RESOLVE(fn, "epoll_ctl");
+	COUNT(SC_EPOLL_CTL);
+	return fn(epfd, op, fd, event);
+}
+
+int epoll_wait(int epfd, struct epoll_event *events, int maxevents,
+	int timeout)
+{
+	static int (*fn)(int, struct epoll_event *, int, int) = NULL;
+
+	RESOLVE(fn, "epoll_wait");
+	COUNT(SC_EPOLL_WAIT);
+	return fn(epfd, events, maxevents, timeout);
+}
@@ -1065,6 +1065,10 @@ int http_hdr_req_range(const HTTP_HDR_REQ *hdr_req, http_off_t *range_from,
 	}
 	ptr += strlen("bytes=");
 	ACL_SAFE_STRNCPY(buf, ptr, sizeof(buf));
+	/* the suffix range "bytes=-{length}" can't be held by from and to */
+	if (*buf == '-') {
+		return -1;
+	}
 	ptr1 = buf;
 	while (*ptr1) {
 		if (*ptr1 == '-' || *ptr1 == ' ') {
@@ -1078,7 +1082,8 @@ int http_hdr_req_range(const HTTP_HDR_REQ *hdr_req, http_off_t *range_from,
 			} else {
 				*range_to = acl_atoi64(ptr1);
 			}
-			if (*range_to <= 0) {
+			/* "bytes=0-0" is the first byte, so the explicit 0 is kept */
+			if (*range_to < 0) {
 				*range_to = -1;
 			}
 			return 0;